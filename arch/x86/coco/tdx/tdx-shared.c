@@ -1,6 +1,12 @@
 #include <asm/tdx.h>
 #include <asm/pgtable.h>
 
+/* TDG.VP.VMCALL status: the VMM asks to retry the rest of the operation */
+#define TDVMCALL_STATUS_RETRY		1
+
+/* Retries of MapGPA without forward progress before giving up */
+#define MAP_GPA_MAX_RETRIES		3
+
 static unsigned long try_accept_one(phys_addr_t start, unsigned long len,
 				    enum pg_level pg_level)
 {
@@ -42,6 +48,49 @@ static unsigned long try_accept_one(phys_addr_t start, unsigned long len,
 	return accept_size;
 }
 
+/*
+ * Notify the VMM about page mapping conversion. More info about ABI
+ * can be found in TDX Guest-Host-Communication Interface (GHCI),
+ * section "TDG.VP.VMCALL<MapGPA>".
+ *
+ * The whole range is handed to the VMM at once.  The VMM may convert only
+ * part of it, e.g. to not block the vCPU for too long, and ask the guest to
+ * retry from the GPA returned in R11.
+ */
+static bool tdx_map_gpa(phys_addr_t start, phys_addr_t end)
+{
+	int retries = 0;
+
+	while (retries < MAP_GPA_MAX_RETRIES) {
+		struct tdx_hypercall_args args = {
+			.r10 = TDX_HYPERCALL_STANDARD,
+			.r11 = TDVMCALL_MAP_GPA,
+			.r12 = start,
+			.r13 = end - start,
+		};
+		u64 ret, next;
+
+		ret = __tdx_hypercall(&args, TDX_HCALL_HAS_OUTPUT);
+		if (ret != TDVMCALL_STATUS_RETRY)
+			return !ret;
+
+		/* R11 comes from the untrusted VMM, sanity check it */
+		next = args.r11;
+		if (next < start || next >= end)
+			return false;
+
+		if (next == start) {
+			retries++;
+			continue;
+		}
+
+		start = next;
+		retries = 0;
+	}
+
+	return false;
+}
+
 bool tdx_enc_status_changed_phys(phys_addr_t start, phys_addr_t end, bool enc)
 {
 	if (!enc) {
@@ -50,12 +99,7 @@ bool tdx_enc_status_changed_phys(phys_addr_t start, phys_addr_t end, bool enc)
 		end   |= cc_mkdec(0);
 	}
 
-	/*
-	 * Notify the VMM about page mapping conversion. More info about ABI
-	 * can be found in TDX Guest-Host-Communication Interface (GHCI),
-	 * section "TDG.VP.VMCALL<MapGPA>"
-	 */
-	if (_tdx_hypercall(TDVMCALL_MAP_GPA, start, end - start, 0, 0))
+	if (!tdx_map_gpa(start, end))
 		return false;
 
 	/* private->shared conversion  requires only MapGPA call */
@@ -198,6 +198,17 @@ asmlinkage void aesni_gcm_finalize_avx_gen4(void *ctx,
 static __ro_after_init DEFINE_STATIC_KEY_FALSE(gcm_use_avx);
 static __ro_after_init DEFINE_STATIC_KEY_FALSE(gcm_use_avx2);
 
+#define XTS_VAES_AVX512_CHUNK	256
+
+asmlinkage void aes_xts_encrypt_vaes_avx512(const struct crypto_aes_ctx *ctx,
+					    u8 *out, const u8 *in,
+					    unsigned int len, u8 *iv);
+asmlinkage void aes_xts_decrypt_vaes_avx512(const struct crypto_aes_ctx *ctx,
+					    u8 *out, const u8 *in,
+					    unsigned int len, u8 *iv);
+
+static __ro_after_init DEFINE_STATIC_KEY_FALSE(xts_use_vaes_avx512);
+
 static inline struct
 aesni_rfc4106_gcm_ctx *aesni_rfc4106_gcm_ctx_get(struct crypto_aead *tfm)
 {
@@ -903,6 +914,43 @@ static int xts_aesni_setkey(struct crypto_skcipher *tfm, const u8 *key,
 				  key + keylen, keylen);
 }
 
+/*
+ * The VAES code only does whole 16 block chunks. The rest, which includes
+ * the last full block and the partial one for ciphertext stealing, is left
+ * to aesni_xts_{en,de}crypt().
+ */
+static void aesni_xts_crypt(const struct crypto_aes_ctx *ctx, u8 *out,
+			    const u8 *in, unsigned int len, u8 *iv, bool encrypt)
+{
+#ifdef CONFIG_X86_64
+	unsigned int rest = len % AES_BLOCK_SIZE;
+	unsigned int bulk;
+
+	if (rest)
+		rest += AES_BLOCK_SIZE;
+
+	if (IS_ENABLED(CONFIG_AS_AVX512) &&
+	    static_branch_likely(&xts_use_vaes_avx512) &&
+	    len >= XTS_VAES_AVX512_CHUNK + rest) {
+		bulk = round_down(len - rest, XTS_VAES_AVX512_CHUNK);
+		if (encrypt)
+			aes_xts_encrypt_vaes_avx512(ctx, out, in, bulk, iv);
+		else
+			aes_xts_decrypt_vaes_avx512(ctx, out, in, bulk, iv);
+
+		len -= bulk;
+		if (!len)
+			return;
+		out += bulk;
+		in += bulk;
+	}
+#endif
+	if (encrypt)
+		aesni_xts_encrypt(ctx, out, in, len, iv);
+	else
+		aesni_xts_decrypt(ctx, out, in, len, iv);
+}
+
 static int xts_crypt(struct skcipher_request *req, bool encrypt)
 {
 	struct crypto_skcipher *tfm = crypto_skcipher_reqtfm(req);
@@ -950,14 +998,9 @@ static int xts_crypt(struct skcipher_request *req, bool encrypt)
 		if (nbytes < walk.total)
 			nbytes &= ~(AES_BLOCK_SIZE - 1);
 
-		if (encrypt)
-			aesni_xts_encrypt(aes_ctx(ctx->raw_crypt_ctx),
-					  walk.dst.virt.addr, walk.src.virt.addr,
-					  nbytes, walk.iv);
-		else
-			aesni_xts_decrypt(aes_ctx(ctx->raw_crypt_ctx),
-					  walk.dst.virt.addr, walk.src.virt.addr,
-					  nbytes, walk.iv);
+		aesni_xts_crypt(aes_ctx(ctx->raw_crypt_ctx),
+				walk.dst.virt.addr, walk.src.virt.addr,
+				nbytes, walk.iv, encrypt);
 		kernel_fpu_end();
 
 		err = skcipher_walk_done(&walk, walk.nbytes - nbytes);
@@ -1257,6 +1300,15 @@ static int __init aesni_init(void)
 		static_call_update(aesni_ctr_enc_tfm, aesni_ctr_enc_avx_tfm);
 		pr_info("AES CTR mode by8 optimization enabled\n");
 	}
+	if (IS_ENABLED(CONFIG_AS_AVX512) && boot_cpu_has(X86_FEATURE_VAES) &&
+	    boot_cpu_has(X86_FEATURE_VPCLMULQDQ) &&
+	    boot_cpu_has(X86_FEATURE_AVX512F) &&
+	    boot_cpu_has(X86_FEATURE_AVX512BW) &&
+	    cpu_has_xfeatures(XFEATURE_MASK_SSE | XFEATURE_MASK_YMM |
+			      XFEATURE_MASK_AVX512, NULL)) {
+		pr_info("AES XTS VAES/AVX-512 optimization enabled\n");
+		static_branch_enable(&xts_use_vaes_avx512);
+	}
 #endif /* CONFIG_X86_64 */
 
 	err = crypto_register_alg(&aesni_cipher_alg);
@@ -314,13 +314,79 @@ static int sha256_ni_final(struct shash_desc *desc, u8 *out)
 	return sha256_ni_finup(desc, NULL, 0, out);
 }
 
+asmlinkage void sha256_ni_transform2x(struct sha256_state *digest_a,
+				      struct sha256_state *digest_b,
+				      const u8 *data_a, const u8 *data_b,
+				      int blocks);
+
+static int sha256_ni_finup_mb(struct shash_desc *desc,
+			      const u8 * const data[], unsigned int len,
+			      u8 * const outs[], unsigned int num_msgs)
+{
+	struct sha256_state *sctx = shash_desc_ctx(desc);
+	unsigned int digestsize = crypto_shash_digestsize(desc->tfm);
+	unsigned int blocks = len / SHA256_BLOCK_SIZE;
+	unsigned int tail = len % SHA256_BLOCK_SIZE;
+	unsigned int final_blocks = tail < SHA256_BLOCK_SIZE - 8 ? 1 : 2;
+	u8 pad[2][2 * SHA256_BLOCK_SIZE];
+	struct sha256_state states[2];
+	unsigned int i, j;
+
+	/*
+	 * Data buffered in @desc would have to be prepended to each message;
+	 * that isn't worth it, fs-verity and friends always start on a block
+	 * boundary.
+	 */
+	if (num_msgs != 2 || sctx->count % SHA256_BLOCK_SIZE ||
+	    !crypto_simd_usable()) {
+		SHASH_DESC_ON_STACK(desc2, desc->tfm);
+		int err = 0;
+
+		for (i = 0; i < num_msgs && !err; i++) {
+			desc2->tfm = desc->tfm;
+			*(struct sha256_state *)shash_desc_ctx(desc2) = *sctx;
+			err = sha256_ni_finup(desc2, data[i], len, outs[i]);
+		}
+		shash_desc_zero(desc2);
+		return err;
+	}
+
+	for (i = 0; i < 2; i++) {
+		states[i] = *sctx;
+		memset(pad[i], 0, sizeof(pad[i]));
+		memcpy(pad[i], data[i] + blocks * SHA256_BLOCK_SIZE, tail);
+		pad[i][tail] = 0x80;
+		put_unaligned_be64((sctx->count + len) << 3,
+				   &pad[i][final_blocks * SHA256_BLOCK_SIZE - 8]);
+	}
+
+	kernel_fpu_begin();
+	if (blocks)
+		sha256_ni_transform2x(&states[0], &states[1], data[0], data[1],
+				      blocks);
+	sha256_ni_transform2x(&states[0], &states[1], pad[0], pad[1],
+			      final_blocks);
+	kernel_fpu_end();
+
+	for (i = 0; i < 2; i++)
+		for (j = 0; j < digestsize / sizeof(__be32); j++)
+			put_unaligned_be32(states[i].state[j],
+					   outs[i] + j * sizeof(__be32));
+
+	memzero_explicit(pad, sizeof(pad));
+	memzero_explicit(states, sizeof(states));
+	return 0;
+}
+
 static struct shash_alg sha256_ni_algs[] = { {
 	.digestsize	=	SHA256_DIGEST_SIZE,
 	.init		=	sha256_base_init,
 	.update		=	sha256_ni_update,
 	.final		=	sha256_ni_final,
 	.finup		=	sha256_ni_finup,
+	.finup_mb	=	sha256_ni_finup_mb,
 	.descsize	=	sizeof(struct sha256_state),
+	.mb_max_msgs	=	2,
 	.base		=	{
 		.cra_name	=	"sha256",
 		.cra_driver_name =	"sha256-ni",
@@ -334,7 +400,9 @@ static struct shash_alg sha256_ni_algs[] = { {
 	.update		=	sha256_ni_update,
 	.final		=	sha256_ni_final,
 	.finup		=	sha256_ni_finup,
+	.finup_mb	=	sha256_ni_finup_mb,
 	.descsize	=	sizeof(struct sha256_state),
+	.mb_max_msgs	=	2,
 	.base		=	{
 		.cra_name	=	"sha224",
 		.cra_driver_name =	"sha224-ni",
@@ -110,6 +110,7 @@ KVM_X86_OP_OPTIONAL(drop_private_spte)
 KVM_X86_OP_OPTIONAL(write_block_private_pages)
 KVM_X86_OP_OPTIONAL(restore_private_page)
 KVM_X86_OP_OPTIONAL(import_private_pages)
+KVM_X86_OP_OPTIONAL(migrate_private_spte)
 KVM_X86_OP(has_wbinvd_exit)
 KVM_X86_OP(get_l2_tsc_offset)
 KVM_X86_OP(get_l2_tsc_multiplier)
@@ -156,6 +157,7 @@ KVM_X86_OP(msr_filter_changed)
 KVM_X86_OP(complete_emulated_msr)
 KVM_X86_OP(vcpu_deliver_sipi_vector)
 KVM_X86_OP(vcpu_deliver_init)
+KVM_X86_OP_OPTIONAL(vcpu_create_debugfs)
 KVM_X86_OP_OPTIONAL_RET0(vcpu_get_apicv_inhibit_reasons);
 KVM_X86_OP_OPTIONAL_RET0(update_fw)
 KVM_X86_OP_OPTIONAL_RET0(match_fw)
@@ -464,6 +464,7 @@ struct kvm_mmu_root_info {
 #define KVM_HAVE_MMU_RWLOCK
 
 struct kvm_mmu_page;
+struct kvm_private_zap_batch;
 struct kvm_page_fault;
 
 /*
@@ -1443,6 +1444,14 @@ struct kvm_arch {
 	 */
 	spinlock_t tdp_mmu_pages_lock;
 	struct workqueue_struct *tdp_mmu_zap_wq;
+
+	/*
+	 * Private leaf SPTEs that were blocked by an in-progress zap and
+	 * whose removal is deferred so that a single TLB flush, i.e. one
+	 * TDH.MEM.TRACK for TDX, covers all of them.  Only allocated for VMs
+	 * with private memory.  Protected by the MMU lock in write mode.
+	 */
+	struct kvm_private_zap_batch *private_zap_batch;
 #endif /* CONFIG_X86_64 */
 
 	/*
@@ -1492,6 +1501,15 @@ struct kvm_arch {
 #define SPLIT_DESC_CACHE_MIN_NR_OBJECTS (SPTE_ENT_PER_PAGE + 1)
 	struct kvm_mmu_memory_cache split_desc_cache;
 
+	/*
+	 * Memslots whose huge pages are still to be split in the background
+	 * after enabling dirty logging, see kvm_mmu_eager_split_worker().
+	 *
+	 * Protected by kvm->slots_lock.
+	 */
+	struct xarray eager_split_slots;
+	struct work_struct eager_split_work;
+
 #ifdef CONFIG_KVM_MMU_PRIVATE
 	gfn_t gfn_shared_mask;
 #endif
@@ -1515,6 +1533,7 @@ struct kvm_vm_stat {
 		atomic64_t pages[KVM_NR_PAGE_SIZES];
 	};
 	u64 nx_lpage_splits;
+	u64 eager_split_pending;
 	u64 max_mmu_page_hash_collisions;
 	u64 max_mmu_rmap_size;
 };
@@ -1720,6 +1739,9 @@ struct kvm_x86_ops {
 	int (*restore_private_page)(struct kvm *kvm, gfn_t gfn);
 	int (*import_private_pages)(struct kvm *kvm, uint64_t *sptes,
 				    uint64_t npages, void *opaque);
+	int (*migrate_private_spte)(struct kvm *kvm, gfn_t gfn,
+				    enum pg_level level, kvm_pfn_t old_pfn,
+				    kvm_pfn_t new_pfn);
 
 	/*
 	 * The following five operations are only for legacy MMU.
@@ -1811,6 +1833,9 @@ struct kvm_x86_ops {
 	void (*vcpu_deliver_sipi_vector)(struct kvm_vcpu *vcpu, u8 vector);
 	void (*vcpu_deliver_init)(struct kvm_vcpu *vcpu);
 
+	void (*vcpu_create_debugfs)(struct kvm_vcpu *vcpu,
+				    struct dentry *debugfs_dentry);
+
 	/*
 	 * Returns vCPU specific APICv inhibit reasons
 	 */
@@ -1920,6 +1945,10 @@ void kvm_mmu_slot_remove_write_access(struct kvm *kvm,
 void kvm_mmu_slot_try_split_huge_pages(struct kvm *kvm,
 				       const struct kvm_memory_slot *memslot,
 				       int target_level);
+void kvm_mmu_slot_queue_split_huge_pages(struct kvm *kvm,
+					 const struct kvm_memory_slot *memslot);
+void kvm_mmu_slot_cancel_split_huge_pages(struct kvm *kvm,
+					  const struct kvm_memory_slot *memslot);
 void kvm_mmu_try_split_huge_pages(struct kvm *kvm,
 				  const struct kvm_memory_slot *memslot,
 				  u64 start, u64 end,
@@ -31,6 +31,15 @@ static inline void clear_user_page(void *page, unsigned long vaddr,
 	clear_page(page);
 }
 
+#ifdef CONFIG_X86_64
+static inline void clear_user_page_nocache(void *page, unsigned long vaddr,
+					   struct page *pg)
+{
+	clear_page_nocache(page);
+}
+#define clear_user_page_nocache clear_user_page_nocache
+#endif
+
 static inline void copy_user_page(void *to, void *from, unsigned long vaddr,
 				  struct page *topage)
 {
@@ -62,6 +62,15 @@ static inline void clear_page(void *page)
 			   : "cc", "memory", "rax", "rcx");
 }
 
+void clear_page_nocache(void *page);
+unsigned long clear_page_nocache_threshold(void);
+
+/* Order the stores of clear_page_nocache() before any later store */
+static inline void clear_page_nocache_fence(void)
+{
+	asm volatile("sfence" ::: "memory");
+}
+
 void copy_page(void *to, void *from);
 
 #ifdef CONFIG_X86_5LEVEL
@@ -11,6 +11,8 @@
 
 #ifdef CONFIG_INTEL_TDX_HOST
 
+#include <linux/jump_label.h>
+#include <asm/msr.h>
 #include <asm/trapnr.h>
 
 /*
@@ -196,6 +198,24 @@ void tdx_keyid_free(int keyid);
 
 u64 __seamcall(u64 op, u64 rcx, u64 rdx, u64 r8, u64 r9, u64 r10,
 	       u64 r11, u64 r12, u64 r13, struct tdx_module_output *out);
+
+/* Per-leaf SEAMCALL statistics, enabled in debugfs x86/tdx_seamcall/ */
+DECLARE_STATIC_KEY_FALSE(tdx_seamcall_stats_key);
+void __tdx_seamcall_stats_account(u64 fn, u64 cycles, u64 err);
+
+static __always_inline u64 tdx_seamcall_stats_begin(void)
+{
+	if (static_branch_unlikely(&tdx_seamcall_stats_key))
+		return rdtsc_ordered();
+	return 0;
+}
+
+static __always_inline void tdx_seamcall_stats_end(u64 fn, u64 start, u64 err)
+{
+	/* @start is 0 if stats got enabled in the middle of the SEAMCALL */
+	if (static_branch_unlikely(&tdx_seamcall_stats_key) && start)
+		__tdx_seamcall_stats_account(fn, rdtsc_ordered() - start, err);
+}
 #else	/* !CONFIG_INTEL_TDX_HOST */
 struct tdsysinfo_struct;
 static inline const struct tdsysinfo_struct *tdx_get_sysinfo(void) { return NULL; }
@@ -207,8 +227,13 @@ static inline void tdx_keyid_free(int keyid) { }
 #endif	/* CONFIG_INTEL_TDX_HOST */
 
 #ifdef CONFIG_INTEL_TDX_MODULE_UPDATE
+int tdx_module_update_prepare(void);
 int tdx_module_update(bool live_update, bool *recoverable);
 #else /* !CONFIG_INTEL_TDX_MODULE_UPDATE */
+static inline int tdx_module_update_prepare(void)
+{
+	return -EOPNOTSUPP;
+}
 static inline int tdx_module_update(bool live_update, bool *recoverable)
 {
 	return -EOPNOTSUPP;
@@ -11,6 +11,7 @@
 #include <asm/vvar.h>
 
 DEFINE_VVAR(struct vdso_data, _vdso_data);
+DEFINE_VVAR_SINGLE(struct vdso_rng_data, _vdso_rng_data);
 /*
  * Update the vDSO data page to keep in sync with kernel timekeeping.
  */
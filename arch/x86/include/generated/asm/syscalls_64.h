@@ -450,3 +450,6 @@ __SYSCALL(448, sys_process_mrelease)
 __SYSCALL(449, sys_futex_waitv)
 __SYSCALL(450, sys_set_mempolicy_home_node)
 __SYSCALL(451, sys_memfd_restricted)
+__SYSCALL(452, sys_getdents_statx)
+__SYSCALL(453, sys_msgsnd_batch)
+__SYSCALL(454, sys_msgrcv_batch)
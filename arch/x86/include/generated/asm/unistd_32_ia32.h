@@ -442,9 +442,12 @@
 #define __NR_ia32_futex_waitv 449
 #define __NR_ia32_set_mempolicy_home_node 450
 #define __NR_ia32_memfd_restricted 451
+#define __NR_ia32_getdents_statx 452
+#define __NR_ia32_msgsnd_batch 453
+#define __NR_ia32_msgrcv_batch 454
 
 #ifdef __KERNEL__
-#define __NR_ia32_syscalls 452
+#define __NR_ia32_syscalls 455
 #endif
 
 #endif /* _UAPI_ASM_UNISTD_32_IA32_H */
@@ -442,9 +442,12 @@
 #define __NR_futex_waitv 449
 #define __NR_set_mempolicy_home_node 450
 #define __NR_memfd_restricted 451
+#define __NR_getdents_statx 452
+#define __NR_msgsnd_batch 453
+#define __NR_msgrcv_batch 454
 
 #ifdef __KERNEL__
-#define __NR_syscalls 452
+#define __NR_syscalls 455
 #endif
 
 #endif /* _UAPI_ASM_UNISTD_32_H */
@@ -317,6 +317,9 @@
 #define __NR_futex_waitv (__X32_SYSCALL_BIT + 449)
 #define __NR_set_mempolicy_home_node (__X32_SYSCALL_BIT + 450)
 #define __NR_memfd_restricted (__X32_SYSCALL_BIT + 451)
+#define __NR_getdents_statx (__X32_SYSCALL_BIT + 452)
+#define __NR_msgsnd_batch (__X32_SYSCALL_BIT + 453)
+#define __NR_msgrcv_batch (__X32_SYSCALL_BIT + 454)
 #define __NR_rt_sigaction (__X32_SYSCALL_BIT + 512)
 #define __NR_rt_sigreturn (__X32_SYSCALL_BIT + 513)
 #define __NR_ioctl (__X32_SYSCALL_BIT + 514)
@@ -640,6 +640,8 @@ struct kvm_tdx_init_vm {
 };
 
 #define KVM_TDX_MEASURE_MEMORY_REGION	(1UL << 0)
+/* kvm_tdx_cmd.data points to struct kvm_tdx_init_mem_region_timing. */
+#define KVM_TDX_MEMORY_REGION_TIMING	(1UL << 1)
 
 struct kvm_tdx_init_mem_region {
 	__u64 source_addr;
@@ -647,6 +649,14 @@ struct kvm_tdx_init_mem_region {
 	__u64 nr_pages;
 };
 
+struct kvm_tdx_init_mem_region_timing {
+	struct kvm_tdx_init_mem_region region;
+	/* Time spent in this call, including measuring, in nanoseconds */
+	__u64 total_ns;
+	/* Time spent in TDH.MR.EXTEND, in nanoseconds */
+	__u64 measure_ns;
+};
+
 struct kvm_rw_memory {
 	/* This can be GPA or HVA */
 	__u64 addr;
@@ -707,6 +717,49 @@ struct kvm_dev_tdx_mig_attr {
 	__u32 max_migs;
 };
 
+/*
+ * Use userspace memory, e.g. memory registered as io_uring fixed buffers, as
+ * the buffer list pages of a stream instead of kernel allocated pages, so
+ * that the exported data can be sent (or the data to import be received)
+ * without an extra copy.  Set after KVM_DEV_TDX_MIG_ATTR, and before the
+ * stream is mmap()ed: it fails with -EBUSY while the stream is mapped.
+ */
+#define KVM_DEV_TDX_MIG_USER_BUF	0x2
+
+struct kvm_dev_tdx_mig_user_buf {
+	/* Page aligned, buf_list_pages * 4KB large, writable anonymous memory */
+	__u64 addr;
+};
+
+#define KVM_DEV_TDX_MIG_STATS		0x3
+
+struct kvm_dev_tdx_mig_epoch_stats {
+	/* Pages exported by TDH.EXPORT.MEM */
+	__u64 exported_pages;
+	/* Pages that failed to export and were marked dirty again */
+	__u64 export_failed_pages;
+	/* Pages write-blocked for dirty tracking */
+	__u64 blocked_pages;
+	/* Blocked pages written by the guest, i.e. dirtied */
+	__u64 dirtied_pages;
+};
+
+struct kvm_dev_tdx_mig_stats {
+#define KVM_DEV_TDX_MIG_STATS_VERSION	0
+	__u32 version;
+	/* Number of epochs started by TDH.EXPORT.TRACK */
+	__u32 epoch;
+	/* TD wide counters of the current epoch */
+	struct kvm_dev_tdx_mig_epoch_stats cur;
+	/* TD wide counters of the previous epoch */
+	struct kvm_dev_tdx_mig_epoch_stats prev;
+	/* Average TDH.EXPORT.MEM cost per page on this stream */
+	__u64 export_ns_per_page;
+	/* Suggested number of pages per KVM_TDX_MIG_EXPORT_MEM on this stream */
+	__u32 suggested_batch;
+	__u32 pad;
+};
+
 #define TDX_MIG_STREAM_MBMD_MAP_OFFSET		0
 #define TDX_MIG_STREAM_GPA_LIST_MAP_OFFSET	1
 #define TDX_MIG_STREAM_MAC_LIST_MAP_OFFSET	2
@@ -76,6 +76,8 @@ void kvm_arch_create_vcpu_debugfs(struct kvm_vcpu *vcpu, struct dentry *debugfs_
 				    debugfs_dentry, vcpu,
 				    &vcpu_tsc_scaling_frac_fops);
 	}
+
+	static_call_cond(kvm_x86_vcpu_create_debugfs)(vcpu, debugfs_dentry);
 }
 
 /*
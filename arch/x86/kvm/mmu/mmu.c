@@ -6862,6 +6862,8 @@ static void kvm_mmu_invalidate_zap_pages_in_memslot(struct kvm *kvm,
 		kvm_mmu_zap_all_fast(kvm);
 }
 
+static void kvm_mmu_eager_split_worker(struct work_struct *work);
+
 int kvm_mmu_init_vm(struct kvm *kvm)
 {
 	struct kvm_page_track_notifier_node *node = &kvm->arch.mmu_sp_tracker;
@@ -6894,6 +6896,9 @@ int kvm_mmu_init_vm(struct kvm *kvm)
 	kvm->arch.split_desc_cache.kmem_cache = pte_list_desc_cache;
 	kvm->arch.split_desc_cache.gfp_zero = __GFP_ZERO;
 
+	xa_init(&kvm->arch.eager_split_slots);
+	INIT_WORK(&kvm->arch.eager_split_work, kvm_mmu_eager_split_worker);
+
 	kvm->arch.tdp_max_page_level = KVM_MAX_HUGEPAGE_LEVEL;
 	return 0;
 }
@@ -6919,6 +6924,7 @@ void kvm_mmu_uninit_vm(struct kvm *kvm)
 		kvm_mmu_uninit_tdp_mmu(kvm);
 
 	mmu_free_vm_memory_caches(kvm);
+	xa_destroy(&kvm->arch.eager_split_slots);
 }
 
 static bool kvm_rmap_zap_gfn_range(struct kvm *kvm, gfn_t gfn_start, gfn_t gfn_end)
@@ -7298,16 +7304,11 @@ void kvm_mmu_try_split_huge_pages(struct kvm *kvm,
 	 */
 }
 
-void kvm_mmu_slot_try_split_huge_pages(struct kvm *kvm,
-					const struct kvm_memory_slot *memslot,
-					int target_level)
+static void __kvm_mmu_slot_try_split_huge_pages(struct kvm *kvm,
+						const struct kvm_memory_slot *memslot,
+						u64 start, u64 end,
+						int target_level)
 {
-	u64 start = memslot->base_gfn;
-	u64 end = start + memslot->npages;
-
-	if (!tdp_mmu_enabled)
-		return;
-
 	if (kvm_memslots_have_rmaps(kvm)) {
 		write_lock(&kvm->mmu_lock);
 		kvm_shadow_mmu_try_split_huge_pages(kvm, memslot, start, end, target_level);
@@ -7317,6 +7318,19 @@ void kvm_mmu_slot_try_split_huge_pages(struct kvm *kvm,
 	read_lock(&kvm->mmu_lock);
 	kvm_tdp_mmu_try_split_huge_pages(kvm, memslot, start, end, target_level, true);
 	read_unlock(&kvm->mmu_lock);
+}
+
+void kvm_mmu_slot_try_split_huge_pages(struct kvm *kvm,
+					const struct kvm_memory_slot *memslot,
+					int target_level)
+{
+	u64 start = memslot->base_gfn;
+	u64 end = start + memslot->npages;
+
+	if (!tdp_mmu_enabled)
+		return;
+
+	__kvm_mmu_slot_try_split_huge_pages(kvm, memslot, start, end, target_level);
 
 	/*
 	 * No TLB flush is necessary here. KVM will flush TLBs after
@@ -7329,6 +7343,122 @@ void kvm_mmu_slot_try_split_huge_pages(struct kvm *kvm,
 	 */
 }
 
+/*
+ * Background eager page splitting.  Instead of splitting every huge page in a
+ * memslot from the KVM_SET_USER_MEMORY_REGION ioctl that enables dirty
+ * logging, the slot is recorded in kvm->arch.eager_split_slots, indexed by
+ * as_id and slot id, with the next GFN to split as the value.  A per-VM worker
+ * then splits KVM_EAGER_SPLIT_CHUNK_PAGES at a time, holding slots_lock only
+ * for one chunk so that memslot updates are never blocked for long.
+ *
+ * Deferring the split is safe for dirty logging: the huge SPTEs have already
+ * been write-protected (or had their dirty bit cleared) by the time the ioctl
+ * returns, and the split SPTEs inherit those bits, so the split itself never
+ * needs a TLB flush.  Until a huge page is split, guest writes to it are
+ * handled by the page fault path exactly as with eager_page_split=N.
+ */
+#define KVM_EAGER_SPLIT_CHUNK_PAGES	(KVM_PAGES_PER_HPAGE(PG_LEVEL_1G))
+
+static unsigned long kvm_eager_split_index(const struct kvm_memory_slot *memslot)
+{
+	return (unsigned long)memslot->as_id * KVM_MEM_SLOTS_NUM + memslot->id;
+}
+
+static void kvm_mmu_eager_split_worker(struct work_struct *work)
+{
+	struct kvm *kvm = container_of(work, struct kvm, arch.eager_split_work);
+	struct kvm_memory_slot *memslot;
+	unsigned long index;
+	gfn_t start, end;
+	void *entry;
+
+	for (;;) {
+		mutex_lock(&kvm->slots_lock);
+
+		index = 0;
+		entry = xa_find(&kvm->arch.eager_split_slots, &index, ULONG_MAX,
+				XA_PRESENT);
+		if (!entry) {
+			mutex_unlock(&kvm->slots_lock);
+			break;
+		}
+
+		memslot = id_to_memslot(__kvm_memslots(kvm, index / KVM_MEM_SLOTS_NUM),
+					index % KVM_MEM_SLOTS_NUM);
+		if (WARN_ON_ONCE(!memslot)) {
+			xa_erase(&kvm->arch.eager_split_slots, index);
+			mutex_unlock(&kvm->slots_lock);
+			continue;
+		}
+
+		start = xa_to_value(entry);
+		end = min_t(gfn_t, start + KVM_EAGER_SPLIT_CHUNK_PAGES,
+			    memslot->base_gfn + memslot->npages);
+
+		__kvm_mmu_slot_try_split_huge_pages(kvm, memslot, start, end,
+						    PG_LEVEL_4K);
+
+		kvm->stat.eager_split_pending -= end - start;
+		if (end == memslot->base_gfn + memslot->npages)
+			xa_erase(&kvm->arch.eager_split_slots, index);
+		else
+			xa_store(&kvm->arch.eager_split_slots, index,
+				 xa_mk_value(end), GFP_KERNEL_ACCOUNT);
+
+		mutex_unlock(&kvm->slots_lock);
+
+		cond_resched();
+	}
+}
+
+/*
+ * Queue all huge pages in @memslot to be split down to 4KiB in the background.
+ * Falls back to splitting synchronously if the slot can't be queued.  The
+ * caller is responsible for write-protecting/clearing dirty on the slot.
+ */
+void kvm_mmu_slot_queue_split_huge_pages(struct kvm *kvm,
+					 const struct kvm_memory_slot *memslot)
+{
+	void *old;
+
+	lockdep_assert_held(&kvm->slots_lock);
+
+	if (!tdp_mmu_enabled)
+		return;
+
+	old = xa_store(&kvm->arch.eager_split_slots, kvm_eager_split_index(memslot),
+		       xa_mk_value(memslot->base_gfn), GFP_KERNEL_ACCOUNT);
+	if (xa_is_err(old)) {
+		kvm_mmu_slot_try_split_huge_pages(kvm, memslot, PG_LEVEL_4K);
+		return;
+	}
+
+	/* A stale entry means a cancellation was missed, don't double count. */
+	if (WARN_ON_ONCE(old))
+		kvm->stat.eager_split_pending -= memslot->base_gfn + memslot->npages -
+						 xa_to_value(old);
+	kvm->stat.eager_split_pending += memslot->npages;
+
+	queue_work(system_unbound_wq, &kvm->arch.eager_split_work);
+}
+
+/*
+ * Forget about any background split still pending for @memslot, e.g. because
+ * the slot is being deleted or dirty logging is being disabled.
+ */
+void kvm_mmu_slot_cancel_split_huge_pages(struct kvm *kvm,
+					  const struct kvm_memory_slot *memslot)
+{
+	void *entry;
+
+	lockdep_assert_held(&kvm->slots_lock);
+
+	entry = xa_erase(&kvm->arch.eager_split_slots, kvm_eager_split_index(memslot));
+	if (entry)
+		kvm->stat.eager_split_pending -= memslot->base_gfn + memslot->npages -
+						 xa_to_value(entry);
+}
+
 static bool kvm_mmu_zap_collapsible_spte(struct kvm *kvm,
 					 struct kvm_rmap_head *rmap_head,
 					 const struct kvm_memory_slot *slot)
@@ -7463,6 +7593,21 @@ restart:
 
 void kvm_mmu_zap_all(struct kvm *kvm)
 {
+	/*
+	 * Hand the shared TDP MMU roots to the zap workqueue first, where they
+	 * are torn down in parallel with mmu_lock held for read, instead of
+	 * walking them one by one below with mmu_lock held for write.  Private
+	 * roots are skipped by kvm_tdp_mmu_invalidate_all_roots() and are still
+	 * zapped serially by kvm_tdp_mmu_zap_all().
+	 */
+	if (tdp_mmu_enabled) {
+		write_lock(&kvm->mmu_lock);
+		kvm_tdp_mmu_invalidate_all_roots(kvm);
+		write_unlock(&kvm->mmu_lock);
+
+		kvm_tdp_mmu_zap_invalidated_roots(kvm);
+	}
+
 	write_lock(&kvm->mmu_lock);
 
 	__kvm_mmu_zap_list(kvm, &kvm->arch.active_mmu_pages);
@@ -8007,6 +8152,8 @@ int kvm_mmu_post_init_vm(struct kvm *kvm)
 
 void kvm_mmu_pre_destroy_vm(struct kvm *kvm)
 {
+	cancel_work_sync(&kvm->arch.eager_split_work);
+
 	if (kvm->arch.nx_huge_page_recovery_thread)
 		kthread_stop(kvm->arch.nx_huge_page_recovery_thread);
 }
@@ -8136,6 +8283,30 @@ static void kvm_update_lpage_private_shared_mixed(struct kvm *kvm,
 	}
 }
 
+#ifdef CONFIG_HAVE_KVM_RESTRICTED_MEM
+int kvm_arch_migrate_private_page(struct kvm *kvm, struct kvm_memory_slot *slot,
+				  gfn_t gfn, kvm_pfn_t src_pfn,
+				  kvm_pfn_t dst_pfn)
+{
+	int r;
+
+	/*
+	 * Only TDs are known to relocate private pages.  Other users of
+	 * restricted memory may map the page without holding a reference, so
+	 * refuse rather than leave a stale SPTE behind.
+	 */
+	if (!tdp_mmu_enabled || !kvm_gfn_shared_mask(kvm))
+		return -EBUSY;
+
+	write_lock(&kvm->mmu_lock);
+	r = kvm_tdp_mmu_migrate_private_page(kvm, slot->as_id, gfn, src_pfn,
+					     dst_pfn);
+	write_unlock(&kvm->mmu_lock);
+
+	return r;
+}
+#endif
+
 void kvm_arch_set_memory_attributes(struct kvm *kvm,
 				    struct kvm_memory_slot *slot,
 				    unsigned long attrs,
@@ -34,6 +34,15 @@ int kvm_mmu_init_tdp_mmu(struct kvm *kvm)
 	INIT_LIST_HEAD(&kvm->arch.tdp_mmu_roots);
 	spin_lock_init(&kvm->arch.tdp_mmu_pages_lock);
 	kvm->arch.tdp_mmu_zap_wq = wq;
+	if (kvm->arch.vm_type == KVM_X86_TDX_VM) {
+		kvm->arch.private_zap_batch =
+			kzalloc(sizeof(*kvm->arch.private_zap_batch),
+				GFP_KERNEL_ACCOUNT);
+		if (!kvm->arch.private_zap_batch) {
+			destroy_workqueue(wq);
+			return -ENOMEM;
+		}
+	}
 #ifdef CONFIG_INTEL_TDX_HOST_DEBUG_MEMORY_CORRUPT
 	mutex_init(&kvm->arch.private_spt_for_split_lock);
 #endif
@@ -57,6 +66,9 @@ void kvm_mmu_uninit_tdp_mmu(struct kvm *kvm)
 	/* Also waits for any queued work items.  */
 	destroy_workqueue(kvm->arch.tdp_mmu_zap_wq);
 
+	WARN_ON(kvm->arch.private_zap_batch && kvm->arch.private_zap_batch->nr);
+	kfree(kvm->arch.private_zap_batch);
+
 	WARN_ON(atomic64_read(&kvm->arch.tdp_mmu_pages));
 	WARN_ON(!list_empty(&kvm->arch.tdp_mmu_roots));
 
@@ -93,6 +105,112 @@ static void tdp_mmu_free_sp_rcu_callback(struct rcu_head *head)
 
 static void tdp_mmu_zap_root(struct kvm *kvm, struct kvm_mmu_page *root,
 			     bool shared);
+static void tdp_mmu_zap_root_range(struct kvm *kvm, struct kvm_mmu_page *root,
+				   bool shared, gfn_t start, gfn_t end);
+static inline gfn_t tdp_mmu_max_gfn_exclusive(void);
+
+/*
+ * Upper bound on the number of workers a single invalidated root is split
+ * across.  Each chunk covers a contiguous range of top-level SPTEs, and is
+ * zapped independently under mmu_lock held for read.
+ */
+#define TDP_MMU_ZAP_MAX_CHUNKS	8
+
+struct tdp_mmu_zap_chunk {
+	struct work_struct work;
+	struct kvm *kvm;
+	struct kvm_mmu_page *root;
+	gfn_t start;
+	gfn_t end;
+};
+
+static void tdp_mmu_zap_chunk_work(struct work_struct *work)
+{
+	struct tdp_mmu_zap_chunk *chunk = container_of(work, struct tdp_mmu_zap_chunk,
+						       work);
+	struct kvm_mmu_page *root = chunk->root;
+	struct kvm *kvm = chunk->kvm;
+
+	read_lock(&kvm->mmu_lock);
+
+	/* See tdp_mmu_zap_root_work() for why no TLB flush is needed. */
+	tdp_mmu_zap_root_range(kvm, root, true, chunk->start, chunk->end);
+
+	/* Each chunk holds its own reference, the last one frees the root. */
+	kvm_tdp_mmu_put_root(kvm, root, true);
+
+	read_unlock(&kvm->mmu_lock);
+
+	kfree(chunk);
+}
+
+/*
+ * Split the zap of an invalidated root across multiple work items, one per
+ * range of top-level SPTEs, so that tearing down a huge guest isn't bounded
+ * by a single CPU.  The chunks are queued on tdp_mmu_zap_wq, i.e. flushing
+ * the workqueue waits for all of them, exactly as for a single per-root work.
+ *
+ * Returns false if the root isn't worth splitting (or allocating chunks
+ * failed), in which case the caller falls back to zapping the whole root
+ * from one worker.  On success, the reference gifted by the caller has been
+ * transferred to the first chunk and every other chunk holds an extra one.
+ */
+static bool tdp_mmu_schedule_zap_root_chunks(struct kvm *kvm,
+					     struct kvm_mmu_page *root)
+{
+	struct tdp_mmu_zap_chunk *chunks[TDP_MMU_ZAP_MAX_CHUNKS];
+	gfn_t span = KVM_PAGES_PER_HPAGE(root->role.level);
+	gfn_t max_gfn = tdp_mmu_max_gfn_exclusive();
+	int nr_entries, nr_present = 0, nr_chunks, per_chunk, i;
+
+	/*
+	 * Private (Secure-EPT) roots must be zapped with mmu_lock held for
+	 * write, leaf first, so they are never split.
+	 */
+	if (is_private_sp(root) || !root->spt)
+		return false;
+
+	nr_entries = min_t(gfn_t, DIV_ROUND_UP(max_gfn, span), SPTE_ENT_PER_PAGE);
+	for (i = 0; i < nr_entries; i++) {
+		if (is_shadow_present_pte(READ_ONCE(root->spt[i])))
+			nr_present++;
+	}
+
+	nr_chunks = min3(nr_present, (int)num_online_cpus(), TDP_MMU_ZAP_MAX_CHUNKS);
+	if (nr_chunks < 2)
+		return false;
+
+	for (i = 0; i < nr_chunks; i++) {
+		chunks[i] = kmalloc(sizeof(*chunks[i]), GFP_NOWAIT | __GFP_ACCOUNT);
+		if (!chunks[i]) {
+			while (i--)
+				kfree(chunks[i]);
+			return false;
+		}
+	}
+
+	/*
+	 * Partition the entire GFN space, not just the present top-level SPTEs,
+	 * so that an SPTE installed after the scan is still covered.
+	 */
+	per_chunk = DIV_ROUND_UP(nr_entries, nr_chunks);
+	for (i = 0; i < nr_chunks; i++) {
+		struct tdp_mmu_zap_chunk *chunk = chunks[i];
+
+		chunk->kvm = kvm;
+		chunk->root = root;
+		chunk->start = (gfn_t)i * per_chunk * span;
+		chunk->end = i == nr_chunks - 1 ? max_gfn :
+			     min_t(gfn_t, (gfn_t)(i + 1) * per_chunk * span, max_gfn);
+
+		if (i)
+			refcount_inc(&root->tdp_mmu_root_count);
+
+		INIT_WORK(&chunk->work, tdp_mmu_zap_chunk_work);
+		queue_work(kvm->arch.tdp_mmu_zap_wq, &chunk->work);
+	}
+	return true;
+}
 
 static void tdp_mmu_zap_root_work(struct work_struct *work)
 {
@@ -126,6 +244,9 @@ static void tdp_mmu_zap_root_work(struct work_struct *work)
 
 static void tdp_mmu_schedule_zap_root(struct kvm *kvm, struct kvm_mmu_page *root)
 {
+	if (tdp_mmu_schedule_zap_root_chunks(kvm, root))
+		return;
+
 	root->tdp_mmu_async_data = kvm;
 	INIT_WORK(&root->tdp_mmu_async_work, tdp_mmu_zap_root_work);
 	queue_work(kvm->arch.tdp_mmu_zap_wq, &root->tdp_mmu_async_work);
@@ -156,8 +277,8 @@ void kvm_tdp_mmu_put_root(struct kvm *kvm, struct kvm_mmu_page *root,
 	 * cannot acquire a reference to it because kvm_tdp_mmu_get_root()
 	 * rejects it.  This remains true for the rest of the execution
 	 * of this function, because readers visit valid roots only
-	 * (except for tdp_mmu_zap_root_work(), which however
-	 * does not acquire any reference itself).
+	 * (except for tdp_mmu_zap_root_work() and tdp_mmu_zap_chunk_work(),
+	 * which however do not acquire any reference themselves).
 	 *
 	 * Even though there are flows that need to visit all roots for
 	 * correctness, they all take mmu_lock for write, so they cannot yet
@@ -566,6 +687,88 @@ static void *get_private_spt(gfn_t gfn, u64 new_spte, int level)
 	return NULL;
 }
 
+/*
+ * Zapping a private leaf SPTE requires blocking the SEPT entry, a TLB flush
+ * (TDH.MEM.TRACK plus an IPI to every vCPU for TDX) and only then removing
+ * the page.  Doing the flush once per SPTE makes bulk private => shared
+ * conversion, e.g. of swiotlb bounce buffers, crawl.  While a leaf zap is in
+ * progress, only block the entries and queue their removal here so that one
+ * flush covers the whole batch.
+ */
+#define TDP_MMU_PRIVATE_ZAP_BATCH	64
+
+struct kvm_private_zap_batch {
+	bool active;
+	int nr;
+	struct {
+		gfn_t gfn;
+		kvm_pfn_t pfn;
+		enum pg_level level;
+	} entries[TDP_MMU_PRIVATE_ZAP_BATCH];
+};
+
+/*
+ * Remove the private pages queued in the batch.  Returns true if a TLB flush
+ * was done, in which case the caller doesn't need to flush for SPTEs zapped
+ * so far.
+ */
+static bool tdp_mmu_flush_private_zap_batch(struct kvm *kvm)
+{
+	struct kvm_private_zap_batch *batch = kvm->arch.private_zap_batch;
+	int i, ret;
+
+	if (!batch || !batch->nr)
+		return false;
+
+	lockdep_assert_held_write(&kvm->mmu_lock);
+
+	kvm_flush_remote_tlbs(kvm);
+	for (i = 0; i < batch->nr; i++) {
+		ret = static_call(kvm_x86_drop_private_spte)(kvm,
+							      batch->entries[i].gfn,
+							      batch->entries[i].level,
+							      batch->entries[i].pfn);
+		WARN_ON_ONCE(ret);
+	}
+	batch->nr = 0;
+
+	return true;
+}
+
+static int tdp_mmu_remove_private_spte(struct kvm *kvm, gfn_t gfn, int level,
+				       kvm_pfn_t pfn)
+{
+	struct kvm_private_zap_batch *batch = kvm->arch.private_zap_batch;
+
+	if (!batch || !batch->active)
+		return static_call(kvm_x86_remove_private_spte)(kvm, gfn, level, pfn);
+
+	if (batch->nr == TDP_MMU_PRIVATE_ZAP_BATCH)
+		tdp_mmu_flush_private_zap_batch(kvm);
+
+	batch->entries[batch->nr].gfn = gfn;
+	batch->entries[batch->nr].pfn = pfn;
+	batch->entries[batch->nr].level = level;
+	batch->nr++;
+	return 0;
+}
+
+static void tdp_mmu_start_private_zap_batch(struct kvm *kvm)
+{
+	if (kvm->arch.private_zap_batch)
+		kvm->arch.private_zap_batch->active = true;
+}
+
+/* Returns true if a TLB flush was done, see tdp_mmu_flush_private_zap_batch(). */
+static bool tdp_mmu_end_private_zap_batch(struct kvm *kvm)
+{
+	bool flushed = tdp_mmu_flush_private_zap_batch(kvm);
+
+	if (kvm->arch.private_zap_batch)
+		kvm->arch.private_zap_batch->active = false;
+	return flushed;
+}
+
 static int __must_check handle_private_zapped_spte(struct kvm *kvm, gfn_t gfn,
 						   u64 old_spte, u64 new_spte,
 						   int level)
@@ -625,7 +828,7 @@ static int __must_check handle_private_zapped_spte(struct kvm *kvm, gfn_t gfn,
 		}
 	} else {
 		lockdep_assert_held_write(&kvm->mmu_lock);
-		ret = static_call(kvm_x86_remove_private_spte)(kvm, gfn, level, old_pfn);
+		ret = tdp_mmu_remove_private_spte(kvm, gfn, level, old_pfn);
 		WARN_ON_ONCE(ret);
 	}
 
@@ -707,8 +910,8 @@ static int __must_check handle_changed_private_spte(struct kvm *kvm, gfn_t gfn,
 			KVM_BUG_ON(new_pfn, kvm);
 
 			if (!ret) {
-				ret = static_call(kvm_x86_remove_private_spte)(kvm, gfn,
-									       level, old_pfn);
+				ret = tdp_mmu_remove_private_spte(kvm, gfn, level,
+								  old_pfn);
 				WARN_ON_ONCE(ret);
 			}
 		}
@@ -1152,6 +1355,9 @@ static inline bool __must_check tdp_mmu_iter_cond_resched(struct kvm *kvm,
 		return false;
 
 	if (need_resched() || rwlock_needbreak(&kvm->mmu_lock)) {
+		/* Blocked SEPT entries must not be left behind across a yield. */
+		if (tdp_mmu_flush_private_zap_batch(kvm))
+			flush = false;
 		if (flush)
 			kvm_flush_remote_tlbs(kvm);
 
@@ -1184,13 +1390,10 @@ static inline gfn_t tdp_mmu_max_gfn_exclusive(void)
 }
 
 static void __tdp_mmu_zap_root(struct kvm *kvm, struct kvm_mmu_page *root,
-			       bool shared, int zap_level)
+			       bool shared, int zap_level, gfn_t start, gfn_t end)
 {
 	struct tdp_iter iter;
 
-	gfn_t end = tdp_mmu_max_gfn_exclusive();
-	gfn_t start = 0;
-
 	for_each_tdp_pte_min_level(iter, root, zap_level, start, end) {
 retry:
 		if (tdp_mmu_iter_cond_resched(kvm, &iter, false, shared))
@@ -1209,8 +1412,8 @@ retry:
 	}
 }
 
-static void tdp_mmu_zap_root(struct kvm *kvm, struct kvm_mmu_page *root,
-			     bool shared)
+static void tdp_mmu_zap_root_range(struct kvm *kvm, struct kvm_mmu_page *root,
+				   bool shared, gfn_t start, gfn_t end)
 {
 
 	/*
@@ -1239,12 +1442,18 @@ static void tdp_mmu_zap_root(struct kvm *kvm, struct kvm_mmu_page *root,
 	 * Because zapping a SP recurses on its children, stepping down to
 	 * PG_LEVEL_4K in the iterator itself is unnecessary.
 	 */
-	__tdp_mmu_zap_root(kvm, root, shared, PG_LEVEL_1G);
-	__tdp_mmu_zap_root(kvm, root, shared, root->role.level);
+	__tdp_mmu_zap_root(kvm, root, shared, PG_LEVEL_1G, start, end);
+	__tdp_mmu_zap_root(kvm, root, shared, root->role.level, start, end);
 
 	rcu_read_unlock();
 }
 
+static void tdp_mmu_zap_root(struct kvm *kvm, struct kvm_mmu_page *root,
+			     bool shared)
+{
+	tdp_mmu_zap_root_range(kvm, root, shared, 0, tdp_mmu_max_gfn_exclusive());
+}
+
 bool kvm_tdp_mmu_zap_sp(struct kvm *kvm, struct kvm_mmu_page *sp)
 {
 	u64 old_spte;
@@ -1312,6 +1521,9 @@ static bool tdp_mmu_zap_leafs(struct kvm *kvm, struct kvm_mmu_page *root,
 	start = kvm_gfn_for_root(kvm, root, start);
 	end = kvm_gfn_for_root(kvm, root, end);
 
+	if (zap_private)
+		tdp_mmu_start_private_zap_batch(kvm);
+
 	rcu_read_lock();
 
 	for_each_tdp_pte_min_level(iter, root, PG_LEVEL_4K, start, end) {
@@ -1344,6 +1556,8 @@ static bool tdp_mmu_zap_leafs(struct kvm *kvm, struct kvm_mmu_page *root,
 			    (gfn & mask) < start ||
 			    end < (gfn & mask) + KVM_PAGES_PER_HPAGE(iter.level)) {
 				WARN_ON_ONCE(!can_yield);
+				if (tdp_mmu_flush_private_zap_batch(kvm))
+					flush = false;
 				if (split_sp) {
 					sp = split_sp;
 					split_sp = NULL;
@@ -1385,6 +1599,9 @@ static bool tdp_mmu_zap_leafs(struct kvm *kvm, struct kvm_mmu_page *root,
 		flush = true;
 	}
 
+	if (zap_private && tdp_mmu_end_private_zap_batch(kvm))
+		flush = false;
+
 	rcu_read_unlock();
 
 	if (split_sp) {
@@ -2095,19 +2312,37 @@ bool kvm_tdp_mmu_wrprot_slot(struct kvm *kvm,
 	return spte_set;
 }
 
+/*
+ * Place the page table for a split huge page on the node that backs the huge
+ * page itself, so that walks of the new page table stay node-local to the
+ * memory they map regardless of which CPU happened to perform the split.
+ */
+static int tdp_mmu_split_nid(u64 huge_spte)
+{
+	kvm_pfn_t pfn = spte_to_pfn(huge_spte);
+
+	if (!pfn_valid(pfn))
+		return NUMA_NO_NODE;
+
+	return page_to_nid(pfn_to_page(pfn));
+}
+
 static struct kvm_mmu_page *__tdp_mmu_alloc_sp_for_split(struct kvm *kvm, gfp_t gfp,
-							 union kvm_mmu_page_role role, bool can_yield)
+							 union kvm_mmu_page_role role,
+							 int nid, bool can_yield)
 {
 	struct kvm_mmu_page *sp;
+	struct page *page;
 
 	gfp |= __GFP_ZERO;
 
-	sp = kmem_cache_alloc(mmu_page_header_cache, gfp);
+	sp = kmem_cache_alloc_node(mmu_page_header_cache, gfp, nid);
 	if (!sp)
 		return NULL;
 
 	sp->role = role;
-	sp->spt = (void *)__get_free_page(gfp);
+	page = alloc_pages_node(nid, gfp, 0);
+	sp->spt = page ? page_address(page) : NULL;
 	if (kvm_mmu_page_role_is_private(role)) {
 		if (kvm_alloc_private_spt_for_split(kvm, sp, gfp, can_yield)) {
 			free_page((unsigned long)sp->spt);
@@ -2128,6 +2363,7 @@ static struct kvm_mmu_page *tdp_mmu_alloc_sp_for_split(struct kvm *kvm,
 						       bool can_yield)
 {
 	union kvm_mmu_page_role role = tdp_iter_child_role(iter);
+	int nid = tdp_mmu_split_nid(iter->old_spte);
 	struct kvm_mmu_page *sp;
 
 	KVM_BUG_ON(kvm_mmu_page_role_is_private(role) !=
@@ -2142,7 +2378,8 @@ static struct kvm_mmu_page *tdp_mmu_alloc_sp_for_split(struct kvm *kvm,
 	 * If this allocation fails we drop the lock and retry with reclaim
 	 * allowed.
 	 */
-	sp = __tdp_mmu_alloc_sp_for_split(kvm, GFP_NOWAIT | __GFP_ACCOUNT, role, can_yield);
+	sp = __tdp_mmu_alloc_sp_for_split(kvm, GFP_NOWAIT | __GFP_ACCOUNT, role, nid,
+					  can_yield);
 	if (sp || !can_yield)
 		return sp;
 
@@ -2154,7 +2391,7 @@ static struct kvm_mmu_page *tdp_mmu_alloc_sp_for_split(struct kvm *kvm,
 		write_unlock(&kvm->mmu_lock);
 
 	iter->yielded = true;
-	sp = __tdp_mmu_alloc_sp_for_split(kvm, GFP_KERNEL_ACCOUNT, role, can_yield);
+	sp = __tdp_mmu_alloc_sp_for_split(kvm, GFP_KERNEL_ACCOUNT, role, nid, can_yield);
 
 	if (shared)
 		read_lock(&kvm->mmu_lock);
@@ -2369,6 +2606,25 @@ bool kvm_tdp_mmu_clear_dirty_slot(struct kvm *kvm,
 	return spte_set;
 }
 
+/*
+ * Write-protect a private leaf SPTE without the TDH.EXPORT.BLOCKW issued per
+ * GFN by handle_changed_private_spte().  The caller must block the GFN on the
+ * TDX side, batched with others, via kvm_x86_write_block_private_pages()
+ * before dropping mmu_lock.
+ */
+static void tdp_mmu_wrprot_private_spte_deferred(struct kvm *kvm,
+						struct tdp_iter *iter,
+						u64 new_spte)
+{
+	lockdep_assert_held_write(&kvm->mmu_lock);
+	KVM_BUG_ON(iter->level != PG_LEVEL_4K, kvm);
+
+	iter->old_spte = kvm_tdp_mmu_write_spte(iter->sptep, iter->old_spte,
+						new_spte, iter->level);
+	trace_kvm_tdp_mmu_spte_changed(iter->as_id, iter->gfn, iter->level,
+				       iter->old_spte, new_spte);
+}
+
 /*
  * Clears the dirty status of all the 4k SPTEs mapping GFNs for which a bit is
  * set in mask, starting at gfn. The given memslot is expected to contain all
@@ -2379,6 +2635,9 @@ bool kvm_tdp_mmu_clear_dirty_slot(struct kvm *kvm,
 static void clear_dirty_pt_masked(struct kvm *kvm, struct kvm_mmu_page *root,
 				  gfn_t gfn, unsigned long mask, bool wrprot)
 {
+	gfn_t private_gfns[BITS_PER_LONG];
+	bool is_private = is_private_sp(root);
+	unsigned int nr_private = 0;
 	struct tdp_iter iter;
 	u64 new_spte;
 
@@ -2400,6 +2659,18 @@ static void clear_dirty_pt_masked(struct kvm *kvm, struct kvm_mmu_page *root,
 				new_spte = iter.old_spte & ~PT_WRITABLE_MASK;
 			else
 				continue;
+
+			/*
+			 * Re-protecting the pages harvested from the dirty log
+			 * or ring of a TD: block all of them with one SEAMCALL
+			 * instead of one per page.
+			 */
+			if (is_private) {
+				tdp_mmu_wrprot_private_spte_deferred(kvm, &iter,
+								     new_spte);
+				private_gfns[nr_private++] = iter.gfn;
+				continue;
+			}
 		} else {
 			if (iter.old_spte & shadow_dirty_mask)
 				new_spte = iter.old_spte & ~shadow_dirty_mask;
@@ -2411,6 +2682,10 @@ static void clear_dirty_pt_masked(struct kvm *kvm, struct kvm_mmu_page *root,
 	}
 
 	rcu_read_unlock();
+
+	if (nr_private)
+		static_call(kvm_x86_write_block_private_pages)(kvm, private_gfns,
+							       nr_private);
 }
 
 /*
@@ -2619,6 +2894,74 @@ int kvm_tdp_mmu_restore_private_pages(struct kvm_memory_slot *slot,
 	return 0;
 }
 
+/*
+ * Move the private mapping of @gfn from @src_pfn to @dst_pfn, e.g. for
+ * compaction of the restrictedmem backing.  Returns 1 if the page was
+ * relocated, 0 if @gfn isn't mapped privately and a negative error code if it
+ * can't be moved right now.
+ */
+int kvm_tdp_mmu_migrate_private_page(struct kvm *kvm, int as_id, gfn_t gfn,
+				     kvm_pfn_t src_pfn, kvm_pfn_t dst_pfn)
+{
+	struct kvm_mmu_page *root;
+	struct tdp_iter iter;
+	u64 new_spte;
+	int ret = 0;
+
+	lockdep_assert_held_write(&kvm->mmu_lock);
+
+	if (!kvm_x86_ops.migrate_private_spte)
+		return -EOPNOTSUPP;
+
+	for_each_tdp_mmu_root(kvm, root, as_id) {
+		if (!is_private_sp(root))
+			continue;
+
+		rcu_read_lock();
+		tdp_root_for_each_pte(iter, root, gfn, gfn + 1) {
+			if (!is_last_spte(iter.old_spte, iter.level))
+				continue;
+
+			/* Still owned by the TDX module until it's removed. */
+			if (is_private_zapped_spte(iter.old_spte)) {
+				ret = -EBUSY;
+				break;
+			}
+
+			if (!is_shadow_present_pte(iter.old_spte))
+				continue;
+
+			if (iter.level > PG_LEVEL_4K ||
+			    spte_to_pfn(iter.old_spte) != src_pfn) {
+				ret = -EBUSY;
+				break;
+			}
+
+			ret = static_call(kvm_x86_migrate_private_spte)(kvm, gfn,
+						iter.level, src_pfn, dst_pfn);
+			if (ret)
+				break;
+
+			/*
+			 * Write the SPTE directly, the generic bookkeeping
+			 * doesn't allow changing the PFN of a present leaf.
+			 */
+			new_spte = (iter.old_spte & ~SPTE_BASE_ADDR_MASK) |
+				   ((u64)dst_pfn << PAGE_SHIFT);
+			kvm_tdp_mmu_write_spte(iter.sptep, iter.old_spte,
+					       new_spte, iter.level);
+			ret = 1;
+			break;
+		}
+		rcu_read_unlock();
+
+		if (ret)
+			break;
+	}
+
+	return ret;
+}
+
 int kvm_tdp_mmu_map_private(struct kvm *kvm,
 			    gfn_t *startp, gfn_t end, bool map_private)
 {
@@ -61,6 +61,8 @@ int kvm_tdp_mmu_map_private(struct kvm *kvm, gfn_t *startp, gfn_t end,
 
 int kvm_tdp_mmu_restore_private_pages(struct kvm_memory_slot *slot,
 				      gfn_t gfn_max);
+int kvm_tdp_mmu_migrate_private_page(struct kvm *kvm, int as_id, gfn_t gfn,
+				     kvm_pfn_t src_pfn, kvm_pfn_t dst_pfn);
 
 static inline void kvm_tdp_mmu_walk_lockless_begin(void)
 {
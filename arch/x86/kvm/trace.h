@@ -253,6 +253,30 @@ TRACE_EVENT(kvm_tdx_hypercall_done,
 		  __entry->rdx)
 );
 
+/*
+ * Tracepoint for TD HKID release, i.e. how long the TD waited for the
+ * TDH.PHYMEM.CACHE.WB pass covering its HKID.
+ */
+TRACE_EVENT(kvm_tdx_hkid_release,
+	TP_PROTO(int hkid, u64 wait_ns, bool cache_wb),
+	TP_ARGS(hkid, wait_ns, cache_wb),
+
+	TP_STRUCT__entry(
+		__field(	int,		hkid		)
+		__field(	u64,		wait_ns		)
+		__field(	bool,		cache_wb	)
+	),
+
+	TP_fast_assign(
+		__entry->hkid		= hkid;
+		__entry->wait_ns	= wait_ns;
+		__entry->cache_wb	= cache_wb;
+	),
+
+	TP_printk("hkid %d wait %llu ns%s", __entry->hkid, __entry->wait_ns,
+		  __entry->cache_wb ? "" : " (batched)")
+);
+
 /*
  * Tracepoint for PIO.
  */
@@ -911,6 +911,13 @@ static int vt_vcpu_mem_enc_ioctl(struct kvm_vcpu *vcpu, void __user *argp)
 	return tdx_vcpu_ioctl(vcpu, argp);
 }
 
+static void vt_vcpu_create_debugfs(struct kvm_vcpu *vcpu,
+				   struct dentry *debugfs_dentry)
+{
+	if (is_td_vcpu(vcpu))
+		tdx_vcpu_create_debugfs(vcpu, debugfs_dentry);
+}
+
 static int vt_skip_emulated_instruction(struct kvm_vcpu *vcpu)
 {
 	if (is_td_vcpu(vcpu))
@@ -1099,6 +1106,7 @@ struct kvm_x86_ops vt_x86_ops __initdata = {
 
 	.vcpu_deliver_sipi_vector = vt_vcpu_deliver_sipi_vector,
 	.vcpu_deliver_init = vt_vcpu_deliver_init,
+	.vcpu_create_debugfs = vt_vcpu_create_debugfs,
 
 	.dev_mem_enc_ioctl = tdx_dev_ioctl,
 	.mem_enc_ioctl = vt_mem_enc_ioctl,
@@ -1,5 +1,6 @@
 // SPDX-License-Identifier: GPL-2.0
 #include <linux/cpu.h>
+#include <linux/debugfs.h>
 #include <linux/mmu_context.h>
 #include <linux/misc_cgroup.h>
 
@@ -177,6 +178,19 @@ static DEFINE_MUTEX(tdx_lock);
 static struct mutex *tdx_mng_key_config_lock;
 static atomic_t nr_configured_hkid;
 
+/*
+ * TDH.PHYMEM.CACHE.WB writes back the caches of all HKIDs that are ready for
+ * it, not only the one of the TD being destroyed.  A pass over all packages
+ * that started after TDH.MNG.VPFLUSHDONE of a TD therefore covers that TD,
+ * so TDs torn down concurrently can share one pass instead of issuing one
+ * each.  tdx_cache_wb_started is incremented under tdx_lock at the start of
+ * a pass, tdx_cache_wb_done is updated at its end.  Both are protected by
+ * tdx_cache_wb_lock, which also serializes the passes.
+ */
+static DEFINE_MUTEX(tdx_cache_wb_lock);
+static unsigned long tdx_cache_wb_started;
+static unsigned long tdx_cache_wb_done;
+
 /*
  * A per-CPU list of TD vCPUs associated with a given CPU.  Used when a CPU
  * is brought down to invoke TDH_VP_FLUSH on the approapriate TD vCPUS.
@@ -332,6 +346,52 @@ static inline void tdx_disassociate_vp(struct kvm_vcpu *vcpu)
 	vcpu->cpu = -1;
 }
 
+/*
+ * Private pages are pinned with one reference per 4K page.  When the range is
+ * backed by a single (huge) folio, take and drop the references with one
+ * atomic operation on the folio instead of one per subpage.
+ */
+static struct folio *tdx_pfn_range_folio(kvm_pfn_t pfn, unsigned long nr)
+{
+	struct folio *folio = page_folio(pfn_to_page(pfn));
+
+	if (pfn + nr > folio_pfn(folio) + folio_nr_pages(folio))
+		return NULL;
+	return folio;
+}
+
+static void tdx_pin_range(kvm_pfn_t pfn, unsigned long nr)
+{
+	struct folio *folio = tdx_pfn_range_folio(pfn, nr);
+	unsigned long i;
+
+	if (folio) {
+		folio_ref_add(folio, nr);
+		return;
+	}
+
+	for (i = 0; i < nr; i++)
+		get_page(pfn_to_page(pfn + i));
+}
+
+static void tdx_unpin_range(kvm_pfn_t pfn, unsigned long nr)
+{
+	struct folio *folio;
+	unsigned long i;
+
+	if (!nr)
+		return;
+
+	folio = tdx_pfn_range_folio(pfn, nr);
+	if (folio) {
+		folio_put_refs(folio, nr);
+		return;
+	}
+
+	for (i = 0; i < nr; i++)
+		put_page(pfn_to_page(pfn + i));
+}
+
 static void tdx_clear_page(unsigned long page_pa, int size)
 {
 	const void *zero_page = (const void *) __va(page_to_phys(ZERO_PAGE(0)));
@@ -365,8 +425,8 @@ static void tdx_clear_page(unsigned long page_pa, int size)
 	__mb();
 }
 
-static int tdx_reclaim_page(hpa_t pa, enum pg_level level,
-			    bool do_wb, u16 hkid)
+static int __tdx_reclaim_page(hpa_t pa, enum pg_level level,
+			      bool do_wb, u16 hkid)
 {
 	struct tdx_module_output out;
 	u64 err;
@@ -399,11 +459,131 @@ static int tdx_reclaim_page(hpa_t pa, enum pg_level level,
 		}
 	}
 
+	return 0;
+}
+
+static int tdx_reclaim_page(hpa_t pa, enum pg_level level,
+			    bool do_wb, u16 hkid)
+{
+	int r;
+
+	r = __tdx_reclaim_page(pa, level, do_wb, hkid);
+	if (r)
+		return r;
+
 	tdx_set_page_present_level(pa, level);
 	tdx_clear_page(pa, KVM_HPAGE_SIZE(level));
 	return 0;
 }
 
+/*
+ * Private pages reclaimed at TD teardown still need to be cleared before they
+ * are given back to the host, which dominates the destroy time of a large TD.
+ * Collect the reclaimed pages into page-sized batches and let an unbound
+ * workqueue clear and release them on the NUMA node the memory belongs to,
+ * while the VM-destroy path continues to zap the rest of the Secure-EPT.
+ * The pages stay pinned until they are cleared, so nobody can reuse them
+ * before that.
+ */
+struct tdx_reclaim_entry {
+	hpa_t pa;
+	enum pg_level level;
+};
+
+struct tdx_reclaim_batch {
+	struct work_struct work;
+	int node;
+	unsigned int nr;
+	struct tdx_reclaim_entry entries[];
+};
+
+#define TDX_RECLAIM_BATCH_NR						\
+	((PAGE_SIZE - sizeof(struct tdx_reclaim_batch)) /		\
+	 sizeof(struct tdx_reclaim_entry))
+
+static struct workqueue_struct *tdx_reclaim_wq;
+
+static void tdx_reclaim_batch_fn(struct work_struct *work)
+{
+	struct tdx_reclaim_batch *batch =
+		container_of(work, struct tdx_reclaim_batch, work);
+	struct tdx_reclaim_entry *entry;
+	unsigned int i;
+
+	for (i = 0; i < batch->nr; i++) {
+		entry = &batch->entries[i];
+
+		tdx_set_page_present_level(entry->pa, entry->level);
+		tdx_clear_page(entry->pa, KVM_HPAGE_SIZE(entry->level));
+		tdx_unpin_range(PHYS_PFN(entry->pa),
+				KVM_PAGES_PER_HPAGE(entry->level));
+		cond_resched();
+	}
+	free_page((unsigned long)batch);
+}
+
+static void tdx_reclaim_batch_queue(struct tdx_reclaim_batch *batch)
+{
+	queue_work_node(batch->node, tdx_reclaim_wq, &batch->work);
+}
+
+/*
+ * Queue an already reclaimed private page for clearing and unpinning.  Returns
+ * false if the page couldn't be queued and the caller has to do it inline.
+ */
+static bool tdx_reclaim_page_deferred(struct kvm_tdx *kvm_tdx, hpa_t pa,
+				      enum pg_level level)
+{
+	int node = page_to_nid(pfn_to_page(PHYS_PFN(pa)));
+	struct tdx_reclaim_batch *batch, *full = NULL;
+	struct page *page;
+
+	if (!tdx_reclaim_wq)
+		return false;
+
+	spin_lock(&kvm_tdx->reclaim_lock);
+	batch = kvm_tdx->reclaim_batch;
+	if (batch && (batch->node != node || batch->nr == TDX_RECLAIM_BATCH_NR)) {
+		full = batch;
+		batch = NULL;
+	}
+	if (!batch) {
+		/* Called with mmu_lock held, can't sleep. */
+		page = alloc_pages_node(node, GFP_NOWAIT | __GFP_NOWARN, 0);
+		if (page) {
+			batch = page_address(page);
+			INIT_WORK(&batch->work, tdx_reclaim_batch_fn);
+			batch->node = node;
+			batch->nr = 0;
+		}
+	}
+	if (batch) {
+		batch->entries[batch->nr].pa = pa;
+		batch->entries[batch->nr].level = level;
+		batch->nr++;
+	}
+	kvm_tdx->reclaim_batch = batch;
+	spin_unlock(&kvm_tdx->reclaim_lock);
+
+	if (full)
+		tdx_reclaim_batch_queue(full);
+
+	return batch;
+}
+
+static void tdx_reclaim_flush_deferred(struct kvm_tdx *kvm_tdx)
+{
+	struct tdx_reclaim_batch *batch;
+
+	spin_lock(&kvm_tdx->reclaim_lock);
+	batch = kvm_tdx->reclaim_batch;
+	kvm_tdx->reclaim_batch = NULL;
+	spin_unlock(&kvm_tdx->reclaim_lock);
+
+	if (batch)
+		tdx_reclaim_batch_queue(batch);
+}
+
 void tdx_reclaim_td_page(unsigned long td_page_pa)
 {
 	if (!td_page_pa)
@@ -518,16 +698,76 @@ static int tdx_do_tdh_phymem_cache_wb(void *param)
 	return 0;
 }
 
-void tdx_mmu_release_hkid(struct kvm *kvm)
+static int tdx_cache_wb_all_packages(void)
 {
-	struct kvm_tdx *kvm_tdx = to_kvm_tdx(kvm);
 	cpumask_var_t packages;
 	bool cpumask_allocated;
+	int ret = 0;
+	int i;
+
+	cpumask_allocated = zalloc_cpumask_var(&packages, GFP_KERNEL);
+	cpus_read_lock();
+	for_each_online_cpu(i) {
+		if (cpumask_allocated &&
+			cpumask_test_and_set_cpu(topology_physical_package_id(i),
+						packages))
+			continue;
+
+		/*
+		 * We can destroy multiple the guest TDs simultaneously.
+		 * Prevent tdh_phymem_cache_wb from returning TDX_BUSY by
+		 * serialization.
+		 */
+		mutex_lock(&tdx_lock);
+		ret = smp_call_on_cpu(i, tdx_do_tdh_phymem_cache_wb, NULL, 1);
+		mutex_unlock(&tdx_lock);
+		if (ret)
+			break;
+	}
+	cpus_read_unlock();
+	free_cpumask_var(packages);
+
+	return ret;
+}
+
+/*
+ * Write back the caches for the HKIDs that became ready before @seq was
+ * sampled, either by waiting for a concurrent pass that started later or by
+ * doing a pass ourselves.  @did_wb is set if this call did the pass.  A failed
+ * pass doesn't count as done, the next caller retries it.
+ */
+static int tdx_cache_wb_sync(unsigned long seq, bool *did_wb)
+{
+	int ret = 0;
+
+	*did_wb = false;
+	mutex_lock(&tdx_cache_wb_lock);
+	if (tdx_cache_wb_done <= seq) {
+		mutex_lock(&tdx_lock);
+		seq = ++tdx_cache_wb_started;
+		mutex_unlock(&tdx_lock);
+
+		/* Failed packages are reported by tdx_do_tdh_phymem_cache_wb(). */
+		ret = tdx_cache_wb_all_packages();
+		if (!ret)
+			tdx_cache_wb_done = seq;
+		*did_wb = true;
+	}
+	mutex_unlock(&tdx_cache_wb_lock);
+
+	return ret;
+}
+
+void tdx_mmu_release_hkid(struct kvm *kvm)
+{
+	struct kvm_tdx *kvm_tdx = to_kvm_tdx(kvm);
 	struct kvm_vcpu *vcpu;
+	unsigned long wb_seq;
 	unsigned long j;
+	bool did_wb;
+	u64 start;
 	u64 err;
 	int ret;
-	int i;
 
 	if (!is_hkid_assigned(kvm_tdx))
 		return;
@@ -540,6 +780,8 @@ void tdx_mmu_release_hkid(struct kvm *kvm)
 
 	mutex_lock(&tdx_lock);
 	err = tdh_mng_vpflushdone(kvm_tdx->tdr_pa);
+	/* Any cache write-back pass started after this point covers us. */
+	wb_seq = tdx_cache_wb_started;
 	mutex_unlock(&tdx_lock);
 	if (WARN_ON_ONCE(err)) {
 		pr_tdx_error(TDH_MNG_VPFLUSHDONE, err, NULL);
@@ -548,27 +790,14 @@ void tdx_mmu_release_hkid(struct kvm *kvm)
 		return;
 	}
 
-	cpumask_allocated = zalloc_cpumask_var(&packages, GFP_KERNEL);
-	cpus_read_lock();
-	for_each_online_cpu(i) {
-		if (cpumask_allocated &&
-			cpumask_test_and_set_cpu(topology_physical_package_id(i),
-						packages))
-			continue;
-
-		/*
-		 * We can destroy multiple the guest TDs simultaneously.
-		 * Prevent tdh_phymem_cache_wb from returning TDX_BUSY by
-		 * serialization.
-		 */
-		mutex_lock(&tdx_lock);
-		ret = smp_call_on_cpu(i, tdx_do_tdh_phymem_cache_wb, NULL, 1);
-		mutex_unlock(&tdx_lock);
-		if (ret)
-			break;
+	start = ktime_get_ns();
+	ret = tdx_cache_wb_sync(wb_seq, &did_wb);
+	trace_kvm_tdx_hkid_release(kvm_tdx->hkid, ktime_get_ns() - start, did_wb);
+	if (ret) {
+		pr_err("tdh_phymem_cache_wb failed. HKID %d is leaked.\n",
+			kvm_tdx->hkid);
+		return;
 	}
-	cpus_read_unlock();
-	free_cpumask_var(packages);
 
 	mutex_lock(&tdx_lock);
 	err = tdh_mng_key_freeid(kvm_tdx->tdr_pa);
@@ -673,6 +902,9 @@ void tdx_vm_free(struct kvm *kvm)
 {
 	struct kvm_tdx *kvm_tdx = to_kvm_tdx(kvm);
 
+	/* Kick off clearing of the private pages zapped so far. */
+	tdx_reclaim_flush_deferred(kvm_tdx);
+
 	/* Can't reclaim or free TD pages if teardown failed. */
 	if (is_hkid_assigned(kvm_tdx))
 		return;
@@ -730,6 +962,7 @@ int tdx_vm_init(struct kvm *kvm)
 
 	kvm_tdx->has_range_blocked = false;
 	spin_lock_init(&kvm_tdx->binding_slot_lock);
+	spin_lock_init(&kvm_tdx->reclaim_lock);
 
 	/*
 	 * This function initializes only KVM software construct.  It doesn't
@@ -1171,6 +1404,147 @@ static noinstr void tdx_vcpu_enter_exit(struct kvm_vcpu *vcpu,
 	guest_exit_irqoff();
 }
 
+static enum tdx_exit_lat_reason tdx_exit_lat_reason(struct kvm_vcpu *vcpu)
+{
+	struct vcpu_tdx *tdx = to_tdx(vcpu);
+
+	if (unlikely(tdx->exit_reason.non_recoverable || tdx->exit_reason.error))
+		return TDX_EXIT_LAT_OTHER;
+
+	switch (tdx->exit_reason.basic) {
+	case EXIT_REASON_EXCEPTION_NMI:
+		return TDX_EXIT_LAT_EXCEPTION_NMI;
+	case EXIT_REASON_EXTERNAL_INTERRUPT:
+		return TDX_EXIT_LAT_EXTERNAL_INTERRUPT;
+	case EXIT_REASON_EPT_VIOLATION:
+		return TDX_EXIT_LAT_EPT_VIOLATION;
+	case EXIT_REASON_EPT_MISCONFIG:
+		return TDX_EXIT_LAT_EPT_MISCONFIG;
+	case EXIT_REASON_TDCALL:
+		break;
+	default:
+		return TDX_EXIT_LAT_OTHER;
+	}
+
+	if (tdvmcall_exit_type(vcpu))
+		return TDX_EXIT_LAT_TDVMCALL_OTHER;
+
+	switch (tdvmcall_leaf(vcpu)) {
+	case EXIT_REASON_HLT:
+		return TDX_EXIT_LAT_TDVMCALL_HLT;
+	case EXIT_REASON_IO_INSTRUCTION:
+		return TDX_EXIT_LAT_TDVMCALL_IO;
+	case EXIT_REASON_EPT_VIOLATION:
+		return TDX_EXIT_LAT_TDVMCALL_MMIO;
+	case EXIT_REASON_MSR_READ:
+		return TDX_EXIT_LAT_TDVMCALL_MSR_READ;
+	case EXIT_REASON_MSR_WRITE:
+		return TDX_EXIT_LAT_TDVMCALL_MSR_WRITE;
+	case EXIT_REASON_CPUID:
+		return TDX_EXIT_LAT_TDVMCALL_CPUID;
+	case TDG_VP_VMCALL_MAP_GPA:
+		return TDX_EXIT_LAT_TDVMCALL_MAP_GPA;
+	default:
+		return TDX_EXIT_LAT_TDVMCALL_OTHER;
+	}
+}
+
+static void tdx_exit_lat_record_entry(struct vcpu_tdx *tdx)
+{
+	struct tdx_exit_latency *lat = &tdx->exit_lat;
+	u64 delta;
+
+	/* Nothing to account on the very first entry. */
+	if (!lat->exit_tsc)
+		return;
+
+	delta = rdtsc() - lat->exit_tsc;
+	lat->hist[lat->reason][min_t(u32, ilog2(delta | 1),
+				     TDX_EXIT_LAT_NR_BUCKETS - 1)]++;
+}
+
+static void tdx_exit_lat_record_exit(struct kvm_vcpu *vcpu)
+{
+	struct vcpu_tdx *tdx = to_tdx(vcpu);
+
+	tdx->exit_lat.reason = tdx_exit_lat_reason(vcpu);
+	tdx->exit_lat.exit_tsc = rdtsc();
+}
+
+static const char * const tdx_exit_lat_names[TDX_EXIT_LAT_NR_REASONS] = {
+	[TDX_EXIT_LAT_EXCEPTION_NMI]		= "exception_nmi",
+	[TDX_EXIT_LAT_EXTERNAL_INTERRUPT]	= "external_interrupt",
+	[TDX_EXIT_LAT_EPT_VIOLATION]		= "ept_violation",
+	[TDX_EXIT_LAT_EPT_MISCONFIG]		= "ept_misconfig",
+	[TDX_EXIT_LAT_TDVMCALL_HLT]		= "tdvmcall_hlt",
+	[TDX_EXIT_LAT_TDVMCALL_IO]		= "tdvmcall_io",
+	[TDX_EXIT_LAT_TDVMCALL_MMIO]		= "tdvmcall_mmio",
+	[TDX_EXIT_LAT_TDVMCALL_MSR_READ]	= "tdvmcall_msr_read",
+	[TDX_EXIT_LAT_TDVMCALL_MSR_WRITE]	= "tdvmcall_msr_write",
+	[TDX_EXIT_LAT_TDVMCALL_CPUID]		= "tdvmcall_cpuid",
+	[TDX_EXIT_LAT_TDVMCALL_MAP_GPA]		= "tdvmcall_map_gpa",
+	[TDX_EXIT_LAT_TDVMCALL_OTHER]		= "tdvmcall_other",
+	[TDX_EXIT_LAT_OTHER]			= "other",
+};
+
+/*
+ * One line per exit reason, bucket i counts exits whose exit-to-reentry
+ * latency was in [2^i, 2^(i+1)) TSC cycles.  The counters are updated by the
+ * vCPU without synchronization, so a read racing with KVM_RUN is only a
+ * snapshot.
+ */
+static int tdx_exit_latency_show(struct seq_file *m, void *v)
+{
+	struct vcpu_tdx *tdx = to_tdx(m->private);
+	int i, j;
+
+	for (i = 0; i < TDX_EXIT_LAT_NR_REASONS; i++) {
+		seq_printf(m, "%-20s", tdx_exit_lat_names[i]);
+		for (j = 0; j < TDX_EXIT_LAT_NR_BUCKETS; j++)
+			seq_printf(m, " %llu", READ_ONCE(tdx->exit_lat.hist[i][j]));
+		seq_putc(m, '\n');
+	}
+	return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(tdx_exit_latency);
+
+void tdx_vcpu_create_debugfs(struct kvm_vcpu *vcpu, struct dentry *debugfs_dentry)
+{
+	debugfs_create_file("tdx_exit_latency", 0444, debugfs_dentry, vcpu,
+			    &tdx_exit_latency_fops);
+}
+
+/*
+ * Handle the hottest TDVMCALLs with IRQs still disabled, the same way
+ * handle_fastpath_set_msr_irqoff() does for VMX.  Only MSR writes that don't
+ * need to sleep, e.g. x2APIC ICR writes for IPIs, qualify.  MMIO, MapGPA and
+ * HLT all may need to exit to userspace, take mmu_lock or block, and so stay
+ * on the regular path.
+ */
+static fastpath_t tdx_exit_handlers_fastpath(struct kvm_vcpu *vcpu)
+{
+	struct vcpu_tdx *tdx = to_tdx(vcpu);
+	fastpath_t ret;
+
+	if (tdx->exit_reason.full != EXIT_REASON_TDCALL || is_debug_td(vcpu) ||
+	    tdvmcall_exit_type(vcpu))
+		return EXIT_FASTPATH_NONE;
+
+	switch (tdvmcall_leaf(vcpu)) {
+	case EXIT_REASON_MSR_WRITE:
+		ret = kvm_fastpath_set_msr_irqoff(vcpu, tdvmcall_a0_read(vcpu),
+						  tdvmcall_a1_read(vcpu));
+		break;
+	default:
+		return EXIT_FASTPATH_NONE;
+	}
+
+	if (ret != EXIT_FASTPATH_NONE)
+		tdvmcall_set_return_code(vcpu, TDG_VP_VMCALL_SUCCESS);
+
+	return ret;
+}
+
 fastpath_t tdx_vcpu_run(struct kvm_vcpu *vcpu)
 {
 	struct kvm_tdx *kvm_tdx = to_kvm_tdx(vcpu->kvm);
@@ -1218,6 +1592,7 @@ fastpath_t tdx_vcpu_run(struct kvm_vcpu *vcpu)
 	if (kvm_tdx->attributes & TDX_TD_ATTRIBUTE_PERFMON)
 		apic_write(APIC_LVTPC, TDX_GUEST_PMI_VECTOR);
 
+	tdx_exit_lat_record_entry(tdx);
 	tdx_vcpu_enter_exit(vcpu, tdx);
 
 	tdx_user_return_update_cache(vcpu);
@@ -1260,7 +1635,9 @@ fastpath_t tdx_vcpu_run(struct kvm_vcpu *vcpu)
 	else
 		vcpu->arch.regs_avail &= ~VMX_REGS_LAZY_LOAD_SET;
 
-	return EXIT_FASTPATH_NONE;
+	tdx_exit_lat_record_exit(vcpu);
+
+	return tdx_exit_handlers_fastpath(vcpu);
 }
 
 void tdx_inject_nmi(struct kvm_vcpu *vcpu)
@@ -2364,6 +2741,7 @@ void tdx_load_mmu_pgd(struct kvm_vcpu *vcpu, hpa_t root_hpa, int pgd_level)
 static void tdx_measure_page(struct kvm_tdx *kvm_tdx, hpa_t gpa, int size)
 {
 	struct tdx_module_output out;
+	u64 start = ktime_get_ns();
 	u64 err;
 	int i;
 
@@ -2376,15 +2754,13 @@ static void tdx_measure_page(struct kvm_tdx *kvm_tdx, hpa_t gpa, int size)
 			break;
 		}
 	}
+	kvm_tdx->measure_ns += ktime_get_ns() - start;
 }
 
 static void tdx_unpin(struct kvm *kvm, gfn_t gfn, kvm_pfn_t pfn,
 		      enum pg_level level)
 {
-	int i;
-
-	for (i = 0; i < KVM_PAGES_PER_HPAGE(level); i++)
-		put_page(pfn_to_page(pfn + i));
+	tdx_unpin_range(pfn, KVM_PAGES_PER_HPAGE(level));
 }
 
 static int tdx_sept_set_private_spte(struct kvm *kvm, gfn_t gfn,
@@ -2398,7 +2774,6 @@ static int tdx_sept_set_private_spte(struct kvm *kvm, gfn_t gfn,
 	hpa_t source_pa;
 	bool measure;
 	u64 err;
-	int i;
 
 	if (WARN_ON_ONCE(is_error_noslot_pfn(pfn) ||
 	    !kvm_pfn_to_refcounted_page(pfn)) || !kvm_tdx->td_initialized)
@@ -2412,8 +2787,7 @@ static int tdx_sept_set_private_spte(struct kvm *kvm, gfn_t gfn,
 	 * TODO: Once restricted mem introduces callback on page migration,
 	 * implement it and remove get_page/put_page().
 	 */
-	for (i = 0; i < KVM_PAGES_PER_HPAGE(level); i++)
-		get_page(pfn_to_page(pfn + i));
+	tdx_pin_range(pfn, KVM_PAGES_PER_HPAGE(level));
 
 	/* Build-time faults are induced and handled via TDH_MEM_PAGE_ADD. */
 	if (likely(is_td_finalized(kvm_tdx))) {
@@ -2522,6 +2896,7 @@ static int tdx_sept_drop_private_spte(struct kvm *kvm, gfn_t gfn,
 	struct tdx_module_output out;
 	gpa_t gpa = gfn_to_gpa(gfn);
 	hpa_t hpa = pfn_to_hpa(pfn);
+	unsigned long nr_flushed = 0;
 	hpa_t hpa_with_hkid;
 	int r = 0;
 	u64 err;
@@ -2532,9 +2907,15 @@ static int tdx_sept_drop_private_spte(struct kvm *kvm, gfn_t gfn,
 		 * The HKID assigned to this TD was already freed and cache
 		 * was already flushed. We don't have to flush again.
 		 */
-		err = tdx_reclaim_page(hpa, level, false, 0);
-		if (!err)
+		err = __tdx_reclaim_page(hpa, level, false, 0);
+		if (err)
+			return 0;
+
+		if (!tdx_reclaim_page_deferred(kvm_tdx, hpa, level)) {
+			tdx_set_page_present_level(hpa, level);
+			tdx_clear_page(hpa, KVM_HPAGE_SIZE(level));
 			tdx_unpin(kvm, gfn, pfn, level);
+		}
 		return 0;
 	}
 
@@ -2566,12 +2947,16 @@ static int tdx_sept_drop_private_spte(struct kvm *kvm, gfn_t gfn,
 		if (KVM_BUG_ON(err, kvm)) {
 			pr_tdx_error(TDH_PHYMEM_PAGE_WBINVD, err, NULL);
 			r = -EIO;
+			/* Leak this page, release the flushed ones before it. */
+			tdx_unpin_range(pfn + i - nr_flushed, nr_flushed);
+			nr_flushed = 0;
 		} else {
 			tdx_set_page_present(hpa);
-			tdx_unpin(kvm, gfn + i, pfn + i, PG_LEVEL_4K);
+			nr_flushed++;
 		}
 		hpa += PAGE_SIZE;
 	}
+	tdx_unpin_range(pfn + i - nr_flushed, nr_flushed);
 	return r;
 }
 
@@ -2797,6 +3182,77 @@ static int tdx_sept_unzap_private_spte(struct kvm *kvm, gfn_t gfn,
 	return 0;
 }
 
+/*
+ * Relocate a private 4K page for page migration/compaction of the
+ * restrictedmem backing: block the GPA, make sure no vCPU holds a stale
+ * translation, let the TDX module copy the page to @new_pfn and unblock.  The
+ * old page is then flushed and released like a removed page, and the pin is
+ * moved to the new page.
+ */
+static int tdx_sept_migrate_private_spte(struct kvm *kvm, gfn_t gfn,
+					 enum pg_level level, kvm_pfn_t old_pfn,
+					 kvm_pfn_t new_pfn)
+{
+	int tdx_level = pg_level_to_tdx_sept_level(level);
+	struct kvm_tdx *kvm_tdx = to_kvm_tdx(kvm);
+	hpa_t old_hpa = pfn_to_hpa(old_pfn);
+	hpa_t new_hpa = pfn_to_hpa(new_pfn);
+	gpa_t gpa = gfn_to_gpa(gfn);
+	struct tdx_module_output out;
+	int r = 0;
+	u64 err;
+
+	lockdep_assert_held_write(&kvm->mmu_lock);
+
+	if (level != PG_LEVEL_4K || !is_hkid_assigned(kvm_tdx) ||
+	    !is_td_finalized(kvm_tdx))
+		return -EBUSY;
+
+	err = tdh_mem_range_block(kvm_tdx->tdr_pa, gpa, tdx_level, &out);
+	if (unlikely(err == TDX_ERROR_SEPT_BUSY))
+		return -EBUSY;
+	if (KVM_BUG_ON(err, kvm)) {
+		pr_tdx_error(TDH_MEM_RANGE_BLOCK, err, &out);
+		return -EIO;
+	}
+
+	tdx_track(kvm_tdx);
+
+	err = tdh_mem_page_relocate(kvm_tdx->tdr_pa, gpa, new_hpa, &out);
+	if (err) {
+		pr_tdx_error(TDH_MEM_PAGE_RELOCATE, err, &out);
+		r = -EBUSY;
+	}
+
+	do {
+		err = tdh_mem_range_unblock(kvm_tdx->tdr_pa, gpa, tdx_level, &out);
+	} while (err == TDX_ERROR_SEPT_BUSY);
+	if (KVM_BUG_ON(err && err != (TDX_GPA_RANGE_NOT_BLOCKED | TDX_OPERAND_ID_RCX),
+		       kvm)) {
+		pr_tdx_error(TDH_MEM_RANGE_UNBLOCK, err, &out);
+		return -EIO;
+	}
+	if (r)
+		return r;
+
+	tdx_set_page_np(new_hpa);
+	tdx_pin_range(new_pfn, 1);
+
+	do {
+		err = tdh_phymem_page_wbinvd(set_hkid_to_hpa(old_hpa,
+							     (u16)kvm_tdx->hkid));
+	} while (err == (TDX_OPERAND_BUSY | TDX_OPERAND_ID_RCX));
+	if (KVM_BUG_ON(err, kvm)) {
+		/* Leak the old page. */
+		pr_tdx_error(TDH_PHYMEM_PAGE_WBINVD, err, NULL);
+		return 0;
+	}
+	tdx_set_page_present(old_hpa);
+	tdx_unpin_range(old_pfn, 1);
+
+	return 0;
+}
+
 static int tdx_sept_free_private_spt(struct kvm *kvm, gfn_t gfn,
 				     enum pg_level level, void *private_spt)
 {
@@ -3112,6 +3568,9 @@ static int __tdx_handle_exit(struct kvm_vcpu *vcpu, fastpath_t fastpath)
 		return 0;
 	}
 
+	if (fastpath == EXIT_FASTPATH_EXIT_HANDLED)
+		return 1;
+
 	WARN_ON_ONCE(fastpath != EXIT_FASTPATH_NONE);
 
 	switch (exit_reason.basic) {
@@ -4142,21 +4601,31 @@ void tdx_flush_tlb(struct kvm_vcpu *vcpu)
 
 #define TDX_SEPT_PFERR	PFERR_WRITE_MASK
 
+/*
+ * Number of source pages pinned at once.  TDH.MEM.PAGE.ADD extends MRTD, so
+ * the pages themselves still have to be added one by one, in order.
+ */
+#define TDX_INIT_MEM_PIN_BATCH	16
+
 static int tdx_init_mem_region(struct kvm *kvm, struct kvm_tdx_cmd *cmd)
 {
 	struct kvm_tdx *kvm_tdx = to_kvm_tdx(kvm);
+	struct page *pages[TDX_INIT_MEM_PIN_BATCH];
+	struct kvm_tdx_init_mem_region_timing timing;
 	struct kvm_tdx_init_mem_region region;
+	int nr_pinned = 0, next = 0;
 	struct kvm_vcpu *vcpu;
-	struct page *page;
 	u64 error_code;
 	kvm_pfn_t pfn;
 	int idx, ret = 0;
+	u64 start;
 
 	/* The BSP vCPU must be created before initializing memory regions. */
 	if (!atomic_read(&kvm->online_vcpus))
 		return -EINVAL;
 
-	if (cmd->flags & ~KVM_TDX_MEASURE_MEMORY_REGION)
+	if (cmd->flags & ~(KVM_TDX_MEASURE_MEMORY_REGION |
+			   KVM_TDX_MEMORY_REGION_TIMING))
 		return -EINVAL;
 
 	if (copy_from_user(&region, (void __user *)cmd->data, sizeof(region)))
@@ -4180,6 +4649,9 @@ static int tdx_init_mem_region(struct kvm *kvm, struct kvm_tdx_cmd *cmd)
 
 	kvm_mmu_reload(vcpu);
 
+	start = ktime_get_ns();
+	kvm_tdx->measure_ns = 0;
+
 	while (region.nr_pages) {
 		if (signal_pending(current)) {
 			ret = -ERESTARTSYS;
@@ -4189,16 +4661,23 @@ static int tdx_init_mem_region(struct kvm *kvm, struct kvm_tdx_cmd *cmd)
 		if (need_resched())
 			cond_resched();
 
-		/* Pin the source page. */
-		ret = get_user_pages_fast(region.source_addr, 1, 0, &page);
-		if (ret < 0)
-			break;
-		if (ret != 1) {
-			ret = -ENOMEM;
-			break;
+		/* Pin the next batch of source pages. */
+		if (next == nr_pinned) {
+			ret = get_user_pages_fast(region.source_addr,
+					min_t(u64, region.nr_pages,
+					      TDX_INIT_MEM_PIN_BATCH),
+					0, pages);
+			if (ret < 0)
+				break;
+			if (!ret) {
+				ret = -ENOMEM;
+				break;
+			}
+			nr_pinned = ret;
+			next = 0;
 		}
 
-		kvm_tdx->source_pa = pfn_to_hpa(page_to_pfn(page)) |
+		kvm_tdx->source_pa = pfn_to_hpa(page_to_pfn(pages[next])) |
 				     (cmd->flags & KVM_TDX_MEASURE_MEMORY_REGION);
 
 		/* TODO: large page support. */
@@ -4212,7 +4691,7 @@ static int tdx_init_mem_region(struct kvm *kvm, struct kvm_tdx_cmd *cmd)
 		else
 			ret = 0;
 
-		put_page(page);
+		put_page(pages[next++]);
 		if (ret)
 			break;
 
@@ -4221,12 +4700,23 @@ static int tdx_init_mem_region(struct kvm *kvm, struct kvm_tdx_cmd *cmd)
 		region.nr_pages--;
 	}
 
+	/* Drop the source pages that weren't consumed because of an error. */
+	while (next < nr_pinned)
+		put_page(pages[next++]);
+
+	timing.region = region;
+	timing.total_ns = ktime_get_ns() - start;
+	timing.measure_ns = kvm_tdx->measure_ns;
+
 	srcu_read_unlock(&kvm->srcu, idx);
 	vcpu_put(vcpu);
 
 	mutex_unlock(&vcpu->mutex);
 
-	if (copy_to_user((void __user *)cmd->data, &region, sizeof(region)))
+	if (cmd->flags & KVM_TDX_MEMORY_REGION_TIMING) {
+		if (copy_to_user((void __user *)cmd->data, &timing, sizeof(timing)))
+			ret = -EFAULT;
+	} else if (copy_to_user((void __user *)cmd->data, &region, sizeof(region)))
 		ret = -EFAULT;
 
 	return ret;
@@ -5323,9 +5813,15 @@ int __init tdx_hardware_setup(struct kvm_x86_ops *x86_ops)
 	x86_ops->write_unblock_private_page = tdx_write_unblock_private_page;
 	x86_ops->restore_private_page = tdx_restore_private_page;
 	x86_ops->import_private_pages = tdx_mig_stream_import_private_pages;
+	x86_ops->migrate_private_spte = tdx_sept_migrate_private_spte;
 	kvm_set_tdx_guest_pmi_handler(tdx_guest_pmi_handler);
 	mce_register_decode_chain(&tdx_mce_nb);
 
+	/* Without the workqueue, private pages are cleared synchronously. */
+	tdx_reclaim_wq = alloc_workqueue("kvm-tdx-reclaim", WQ_UNBOUND, 0);
+	if (!tdx_reclaim_wq)
+		pr_warn("Failed to allocate TD page reclaim workqueue\n");
+
 	r = kvm_tdx_mig_stream_ops_init();
 	if (r) {
 		pr_err("%s: failed to init tdx mig, %d\n", __func__, r);
@@ -5341,6 +5837,8 @@ void tdx_hardware_unsetup(void)
 		return;
 
 	kvm_tdx_mig_stream_ops_exit();
+	if (tdx_reclaim_wq)
+		destroy_workqueue(tdx_reclaim_wq);
 	mce_unregister_decode_chain(&tdx_mce_nb);
 	/* kfree accepts NULL. */
 	kfree(tdx_mng_key_config_lock);
@@ -5414,6 +5912,10 @@ static ssize_t reload_store(struct device *dev,
 			    struct device_attribute *attr,
 			    const char *buf, size_t size)
 {
+	/* Load and verify the new module without pausing TDs */
+	if (sysfs_streq(buf, "prepare"))
+		return tdx_module_update_prepare() ? : size;
+
 	if (!sysfs_streq(buf, "update"))
 		return -EINVAL;
 
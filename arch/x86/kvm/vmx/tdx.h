@@ -72,6 +72,8 @@ struct kvm_tdx {
 	bool tsx_enabled;
 
 	hpa_t source_pa;
+	/* Time spent in TDH.MR.EXTEND by the current KVM_TDX_INIT_MEM_REGION. */
+	u64 measure_ns;
 
 	bool td_initialized;
 	bool finalized;
@@ -116,6 +118,13 @@ struct kvm_tdx {
 
 	struct tdx_mig_state *mig_state;
 
+	/*
+	 * Private pages reclaimed on TD teardown that are waiting to be
+	 * cleared and released by tdx_reclaim_wq.
+	 */
+	spinlock_t reclaim_lock;
+	struct tdx_reclaim_batch *reclaim_batch;
+
 	/* A TD with vTPM enabled */
 	bool vtpm_enabled;
 };
@@ -151,6 +160,37 @@ union tdx_exit_reason {
 	u64 full;
 };
 
+/*
+ * Exit-to-reentry latency, i.e. the time KVM (and userspace, if the exit is
+ * forwarded) spends between a TD exit and the next TDH.VP.ENTER, is recorded
+ * per exit reason into log2 buckets of TSC cycles.  Hot TDVMCALL leaves get
+ * their own rows, everything else is lumped together.
+ */
+enum tdx_exit_lat_reason {
+	TDX_EXIT_LAT_EXCEPTION_NMI,
+	TDX_EXIT_LAT_EXTERNAL_INTERRUPT,
+	TDX_EXIT_LAT_EPT_VIOLATION,
+	TDX_EXIT_LAT_EPT_MISCONFIG,
+	TDX_EXIT_LAT_TDVMCALL_HLT,
+	TDX_EXIT_LAT_TDVMCALL_IO,
+	TDX_EXIT_LAT_TDVMCALL_MMIO,
+	TDX_EXIT_LAT_TDVMCALL_MSR_READ,
+	TDX_EXIT_LAT_TDVMCALL_MSR_WRITE,
+	TDX_EXIT_LAT_TDVMCALL_CPUID,
+	TDX_EXIT_LAT_TDVMCALL_MAP_GPA,
+	TDX_EXIT_LAT_TDVMCALL_OTHER,
+	TDX_EXIT_LAT_OTHER,
+	TDX_EXIT_LAT_NR_REASONS,
+};
+
+#define TDX_EXIT_LAT_NR_BUCKETS		32
+
+struct tdx_exit_latency {
+	u64 exit_tsc;
+	enum tdx_exit_lat_reason reason;
+	u64 hist[TDX_EXIT_LAT_NR_REASONS][TDX_EXIT_LAT_NR_BUCKETS];
+};
+
 struct vcpu_tdx {
 	struct kvm_vcpu	vcpu;
 
@@ -204,6 +244,8 @@ struct vcpu_tdx {
 	struct lbr_desc lbr_desc;
 
 	unsigned long dr6;
+
+	struct tdx_exit_latency exit_lat;
 };
 
 static inline bool is_td(struct kvm *kvm)
@@ -155,6 +155,17 @@ struct tdx_mig_stream {
 	struct tdx_mig_mbmd mbmd;
 	/* List of buffers to export the TD private memory data */
 	struct tdx_mig_buf_list mem_buf_list;
+	/* Userspace pages backing mem_buf_list, see KVM_DEV_TDX_MIG_USER_BUF */
+	struct page **user_buf_pages;
+	/* Serializes the stream ioctls against swapping the buffers */
+	struct mutex lock;
+	/*
+	 * Protects mmap_count, the number of vmas mapping the stream, and
+	 * the mem_buf_list entries against the fault handler.  stream->lock
+	 * can't be used there, the ioctls copy from userspace holding it.
+	 */
+	spinlock_t map_lock;
+	unsigned int mmap_count;
 	/*
 	 * List of buffers grabbed either from the private_fd allocated pages
 	 * for in place import or from mem_buf_list for non-in-place import.
@@ -174,13 +185,31 @@ struct tdx_mig_stream {
 	 * 512 bits which supports 512 pages in a batch.
 	 */
 	uint64_t first_time_import_bitmap[8];
+	/* Moving average of the TDH.EXPORT.MEM cost per page */
+	uint64_t export_ns_per_page;
 	/* GFNs of the pages to import */
 	gfn_t gfns[TDX_MIG_GPA_LIST_MAX_ENTRIES];
 	uint64_t sptes[TDX_MIG_GPA_LIST_MAX_ENTRIES];
 };
 
+struct tdx_mig_epoch_stats {
+	atomic64_t exported_pages;
+	atomic64_t export_failed_pages;
+	atomic64_t blocked_pages;
+	atomic64_t dirtied_pages;
+};
+
 struct tdx_mig_state {
 	atomic_t streams_added;
+	/*
+	 * Userspace may drive several streams from different threads, each
+	 * exporting a different part of the guest memory.  TDH.EXPORT.MEM on
+	 * different streams can run in parallel, while the operations that
+	 * change the migration epoch or export state, e.g. TDH.EXPORT.TRACK,
+	 * must not race with any in-flight memory export.  Memory export
+	 * takes the lock shared, the others take it exclusive.
+	 */
+	struct rw_semaphore export_lock;
 	/*
 	 * Array to store physical addresses of the migration stream context
 	 * pages that have been added to the TDX module. The pages can be
@@ -202,8 +231,25 @@ struct tdx_mig_state {
 	/* Index of the next vCPU to export the state */
 	uint32_t vcpu_export_next_idx;
 	struct tdx_mig_gpa_list blockw_gpa_list;
+
+	/*
+	 * Counters for userspace to judge the pre-copy convergence.  The
+	 * epoch transition, under export_lock, moves the counters of the
+	 * current epoch to prev_epoch_stats.
+	 */
+	uint32_t epoch;
+	struct tdx_mig_epoch_stats epoch_stats;
+	struct kvm_dev_tdx_mig_epoch_stats prev_epoch_stats;
 };
 
+/*
+ * Target duration of one KVM_TDX_MIG_EXPORT_MEM call.  Longer calls delay
+ * TDH.EXPORT.TRACK on other streams and the overlap of the export with the
+ * transfer of the previous batch in userspace, while shorter ones don't
+ * amortize the per-call cost.
+ */
+#define TDX_MIG_EXPORT_TARGET_NS	(500 * NSEC_PER_USEC)
+
 struct tdx_mig_capabilities {
 	uint32_t max_migs;
 	uint32_t nonmem_state_pages;
@@ -274,16 +320,13 @@ static void tdx_write_block_private_pages(struct kvm *kvm, gfn_t *gfns,
 	struct tdx_mig_state *mig_state =
 		(struct tdx_mig_state *)kvm_tdx->mig_state;
 	struct tdx_mig_gpa_list *gpa_list = &mig_state->blockw_gpa_list;
-	uint32_t max_num = PAGE_SIZE / sizeof(union tdx_mig_gpa_list_entry);
 	uint32_t start, blockw_num = 0;
 	struct tdx_module_output out;
 	uint64_t err;
 
 	for (start = 0; start < num; start += blockw_num) {
-		if (num > max_num)
-			blockw_num = max_num;
-		else
-			blockw_num = num;
+		blockw_num = min_t(uint32_t, num - start,
+				   TDX_MIG_GPA_LIST_MAX_ENTRIES);
 
 		tdx_mig_gpa_list_setup(gpa_list, gfns + start, blockw_num);
 		do {
@@ -299,6 +342,7 @@ static void tdx_write_block_private_pages(struct kvm *kvm, gfn_t *gfns,
 				__func__, err, (long)gpa_list->entries[0].gfn);
 			return;
 		}
+		atomic64_add(blockw_num, &mig_state->epoch_stats.blocked_pages);
 	}
 
 	WRITE_ONCE(kvm_tdx->has_range_blocked, true);
@@ -323,6 +367,9 @@ static void tdx_write_unblock_private_page(struct kvm *kvm,
 	tdx_track(kvm_tdx);
 
 	tdh_export_unblockw(kvm_tdx->tdr_pa, ept_info.val, &out);
+	if (kvm_tdx->mig_state)
+		atomic64_add(KVM_PAGES_PER_HPAGE(level),
+			     &kvm_tdx->mig_state->epoch_stats.dirtied_pages);
 }
 
 static void tdx_mig_stream_get_tdx_mig_attr(struct tdx_mig_stream *stream,
@@ -333,9 +380,60 @@ static void tdx_mig_stream_get_tdx_mig_attr(struct tdx_mig_stream *stream,
 	attr->buf_list_pages = stream->buf_list_pages;
 }
 
+static void tdx_mig_epoch_stats_read(struct tdx_mig_epoch_stats *stats,
+				     struct kvm_dev_tdx_mig_epoch_stats *out)
+{
+	out->exported_pages = atomic64_read(&stats->exported_pages);
+	out->export_failed_pages = atomic64_read(&stats->export_failed_pages);
+	out->blocked_pages = atomic64_read(&stats->blocked_pages);
+	out->dirtied_pages = atomic64_read(&stats->dirtied_pages);
+}
+
+/* Called with export_lock held for write on TDH.EXPORT.TRACK. */
+static void tdx_mig_epoch_stats_rotate(struct tdx_mig_state *mig_state)
+{
+	struct tdx_mig_epoch_stats *stats = &mig_state->epoch_stats;
+	struct kvm_dev_tdx_mig_epoch_stats *prev = &mig_state->prev_epoch_stats;
+
+	prev->exported_pages = atomic64_xchg(&stats->exported_pages, 0);
+	prev->export_failed_pages = atomic64_xchg(&stats->export_failed_pages, 0);
+	prev->blocked_pages = atomic64_xchg(&stats->blocked_pages, 0);
+	prev->dirtied_pages = atomic64_xchg(&stats->dirtied_pages, 0);
+	mig_state->epoch++;
+}
+
+static uint32_t tdx_mig_stream_suggested_batch(struct tdx_mig_stream *stream)
+{
+	uint64_t batch;
+
+	if (!stream->export_ns_per_page)
+		return stream->buf_list_pages;
+
+	batch = div64_u64(TDX_MIG_EXPORT_TARGET_NS, stream->export_ns_per_page);
+	return clamp_t(uint64_t, batch, 1, stream->buf_list_pages);
+}
+
+static void tdx_mig_stream_get_stats(struct tdx_mig_state *mig_state,
+				     struct tdx_mig_stream *stream,
+				     struct kvm_dev_tdx_mig_stats *stats)
+{
+	memset(stats, 0, sizeof(*stats));
+	stats->version = KVM_DEV_TDX_MIG_STATS_VERSION;
+
+	down_read(&mig_state->export_lock);
+	stats->epoch = mig_state->epoch;
+	tdx_mig_epoch_stats_read(&mig_state->epoch_stats, &stats->cur);
+	stats->prev = mig_state->prev_epoch_stats;
+	up_read(&mig_state->export_lock);
+
+	stats->export_ns_per_page = READ_ONCE(stream->export_ns_per_page);
+	stats->suggested_batch = tdx_mig_stream_suggested_batch(stream);
+}
+
 static int tdx_mig_stream_get_attr(struct kvm_device *dev,
 				   struct kvm_device_attr *attr)
 {
+	struct tdx_mig_state *mig_state = to_kvm_tdx(dev->kvm)->mig_state;
 	struct tdx_mig_stream *stream = dev->private;
 	u64 __user *uaddr = (u64 __user *)(long)attr->addr;
 
@@ -353,6 +451,19 @@ static int tdx_mig_stream_get_attr(struct kvm_device *dev,
 			return -EFAULT;
 		break;
 	}
+	case KVM_DEV_TDX_MIG_STATS: {
+		struct kvm_dev_tdx_mig_stats stats;
+
+		if (attr->attr != sizeof(struct kvm_dev_tdx_mig_stats)) {
+			pr_err("Incompatible kvm_dev_tdx_mig_stats\n");
+			return -EINVAL;
+		}
+
+		tdx_mig_stream_get_stats(mig_state, stream, &stats);
+		if (copy_to_user(uaddr, &stats, sizeof(stats)))
+			return -EFAULT;
+		break;
+	}
 	default:
 		return -EINVAL;
 	}
@@ -590,6 +701,79 @@ err_mbmd:
 	return ret;
 }
 
+static void tdx_mig_stream_user_buf_release(struct tdx_mig_stream *stream)
+{
+	uint32_t i;
+
+	if (!stream->user_buf_pages)
+		return;
+
+	/* The TDX module may have written export data into the pages */
+	unpin_user_pages_dirty_lock(stream->user_buf_pages,
+				    stream->buf_list_pages, true);
+	kvfree(stream->user_buf_pages);
+	stream->user_buf_pages = NULL;
+
+	/* Nothing left for tdx_mig_stream_buf_list_cleanup() to free. */
+	for (i = 0; i < stream->buf_list_pages; i++)
+		stream->mem_buf_list.entries[i].pfn = 0;
+}
+
+static int tdx_mig_stream_set_user_buf(struct tdx_mig_stream *stream,
+				       struct kvm_dev_tdx_mig_user_buf *buf)
+{
+	uint32_t npages = stream->buf_list_pages;
+	struct tdx_mig_buf_list *buf_list = &stream->mem_buf_list;
+	struct page **pages, **old_pages;
+	uint32_t i;
+	int ret;
+
+	if (!buf_list->entries || !PAGE_ALIGNED(buf->addr))
+		return -EINVAL;
+
+	pages = kvmalloc_array(npages, sizeof(*pages), GFP_KERNEL_ACCOUNT);
+	if (!pages)
+		return -ENOMEM;
+
+	/* The TDX module writes the exported data into the buffers. */
+	ret = pin_user_pages_fast(buf->addr, npages,
+				  FOLL_WRITE | FOLL_LONGTERM, pages);
+	if (ret != npages) {
+		if (ret > 0)
+			unpin_user_pages_dirty_lock(pages, ret, true);
+		kvfree(pages);
+		return ret < 0 ? ret : -EFAULT;
+	}
+
+	/* The previous buffers may still be mapped by userspace */
+	spin_lock(&stream->map_lock);
+	if (stream->mmap_count) {
+		spin_unlock(&stream->map_lock);
+		unpin_user_pages(pages, npages);
+		kvfree(pages);
+		return -EBUSY;
+	}
+
+	/* Drop the previous buffers, either kernel pages or userspace pages. */
+	old_pages = stream->user_buf_pages;
+	for (i = 0; i < npages; i++) {
+		if (!old_pages)
+			__free_page(pfn_to_page(buf_list->entries[i].pfn));
+		buf_list->entries[i].pfn = page_to_pfn(pages[i]);
+		/* The non-memory state export/import reuses the buffers. */
+		stream->page_list.entries[i] = page_to_phys(pages[i]);
+	}
+	stream->user_buf_pages = pages;
+	spin_unlock(&stream->map_lock);
+
+	if (old_pages) {
+		unpin_user_pages_dirty_lock(old_pages, npages, true);
+		kvfree(old_pages);
+	}
+
+	return 0;
+}
+
 static int tdx_mig_stream_set_attr(struct kvm_device *dev,
 				   struct kvm_device_attr *attr)
 {
@@ -616,6 +800,17 @@ static int tdx_mig_stream_set_attr(struct kvm_device *dev,
 		ret = tdx_mig_stream_setup(mig_state, stream);
 		break;
 	}
+	case KVM_DEV_TDX_MIG_USER_BUF: {
+		struct kvm_dev_tdx_mig_user_buf user_buf;
+
+		if (copy_from_user(&user_buf, uaddr, sizeof(user_buf)))
+			return -EFAULT;
+
+		mutex_lock(&stream->lock);
+		ret = tdx_mig_stream_set_user_buf(stream, &user_buf);
+		mutex_unlock(&stream->lock);
+		break;
+	}
 	default:
 		return -EINVAL;
 	}
@@ -658,8 +853,14 @@ static vm_fault_t tdx_mig_stream_fault(struct vm_fault *vmf)
 	} else if (tdx_mig_stream_in_mig_buf_list(vmf->pgoff,
 						  stream->buf_list_pages)) {
 		i = vmf->pgoff - TDX_MIG_STREAM_BUF_LIST_MAP_OFFSET;
+		/* Pairs with the buffer swap in tdx_mig_stream_set_user_buf() */
+		spin_lock(&stream->map_lock);
 		pfn = stream->mem_buf_list.entries[i].pfn;
 		page = pfn_to_page(pfn);
+		get_page(page);
+		spin_unlock(&stream->map_lock);
+		vmf->page = page;
+		return 0;
 	} else {
 		pr_err("%s: VM_FAULT_SIGBUS\n", __func__);
 		return VM_FAULT_SIGBUS;
@@ -670,7 +871,29 @@ static vm_fault_t tdx_mig_stream_fault(struct vm_fault *vmf)
 	return 0;
 }
 
+static void tdx_mig_stream_vm_open(struct vm_area_struct *vma)
+{
+	struct kvm_device *dev = vma->vm_file->private_data;
+	struct tdx_mig_stream *stream = dev->private;
+
+	spin_lock(&stream->map_lock);
+	stream->mmap_count++;
+	spin_unlock(&stream->map_lock);
+}
+
+static void tdx_mig_stream_vm_close(struct vm_area_struct *vma)
+{
+	struct kvm_device *dev = vma->vm_file->private_data;
+	struct tdx_mig_stream *stream = dev->private;
+
+	spin_lock(&stream->map_lock);
+	WARN_ON_ONCE(!stream->mmap_count--);
+	spin_unlock(&stream->map_lock);
+}
+
 static const struct vm_operations_struct tdx_mig_stream_ops = {
+	.open = tdx_mig_stream_vm_open,
+	.close = tdx_mig_stream_vm_close,
 	.fault = tdx_mig_stream_fault,
 };
 
@@ -678,6 +901,8 @@ static int tdx_mig_stream_mmap(struct kvm_device *dev,
 			       struct vm_area_struct *vma)
 {
 	vma->vm_ops = &tdx_mig_stream_ops;
+	/* ->open() isn't called for the initial vma */
+	tdx_mig_stream_vm_open(vma);
 
 	return 0;
 }
@@ -763,18 +988,34 @@ static void tdx_mig_buf_list_set_valid(struct tdx_mig_buf_list *mem_buf_list,
 	}
 }
 
-static void tdx_mig_handle_export_mem_error(struct kvm *kvm,
-					    struct tdx_mig_gpa_list *gpa_list,
-					    uint64_t npages)
+/* Returns the number of pages failed to export. */
+static uint64_t tdx_mig_handle_export_mem_error(struct kvm *kvm,
+						struct tdx_mig_gpa_list *gpa_list,
+						uint64_t npages)
 {
 	union tdx_mig_gpa_list_entry *entry;
-	uint64_t i;
+	uint64_t i, failed = 0;
 
 	for (i = 0; i < npages; i++) {
 		entry = &gpa_list->entries[i];
-		if (entry->status != GPA_LIST_S_SUCCESS)
+		if (entry->status != GPA_LIST_S_SUCCESS) {
 			mark_page_dirty(kvm, (gfn_t)entry->gfn);
+			failed++;
+		}
 	}
+
+	return failed;
+}
+
+static void tdx_mig_stream_update_export_cost(struct tdx_mig_stream *stream,
+					      uint64_t ns, uint64_t npages)
+{
+	uint64_t sample = div64_u64(ns, npages);
+
+	/* Exponential moving average with a weight of 1/8 for new samples. */
+	if (stream->export_ns_per_page)
+		sample = (stream->export_ns_per_page * 7 + sample) / 8;
+	WRITE_ONCE(stream->export_ns_per_page, sample);
 }
 
 static int64_t tdx_mig_stream_export_mem(struct kvm_tdx *kvm_tdx,
@@ -787,7 +1028,8 @@ static int64_t tdx_mig_stream_export_mem(struct kvm_tdx *kvm_tdx,
 	struct tdx_mig_buf_list *mem_buf_list = &stream->mem_buf_list;
 	union tdx_mig_stream_info stream_info = {.val = 0};
 	struct tdx_module_output out;
-	uint64_t npages, err;
+	uint64_t npages, err, failed = 0;
+	uint64_t start;
 	int idx;
 
 	if (mig_state->bugged)
@@ -796,7 +1038,7 @@ static int64_t tdx_mig_stream_export_mem(struct kvm_tdx *kvm_tdx,
 	if (copy_from_user(&npages, (void __user *)data, sizeof(uint64_t)))
 		return -EFAULT;
 
-	if (npages > stream->buf_list_pages)
+	if (!npages || npages > stream->buf_list_pages)
 		return -EINVAL;
 
 	/*
@@ -808,6 +1050,8 @@ static int64_t tdx_mig_stream_export_mem(struct kvm_tdx *kvm_tdx,
 	tdx_mig_buf_list_set_valid(&stream->mem_buf_list, npages);
 
 	stream_info.index = stream->idx;
+	down_read(&mig_state->export_lock);
+	start = ktime_get_ns();
 	do {
 		err = tdh_export_mem(kvm_tdx->tdr_pa,
 				     stream->mbmd.addr_and_size,
@@ -823,6 +1067,7 @@ static int64_t tdx_mig_stream_export_mem(struct kvm_tdx *kvm_tdx,
 			gpa_list->info.val = out.rcx;
 		}
 	} while (seamcall_masked_status(err) == TDX_INTERRUPTED_RESUMABLE);
+	tdx_mig_stream_update_export_cost(stream, ktime_get_ns() - start, npages);
 
 	/*
 	 * It is possible that TDX module returns a general success,
@@ -838,10 +1083,14 @@ static int64_t tdx_mig_stream_export_mem(struct kvm_tdx *kvm_tdx,
 	if (seamcall_masked_status(err) == TDX_SUCCESS) {
 		if (err != TDX_SUCCESS) {
 			idx = srcu_read_lock(&kvm_tdx->kvm.srcu);
-			tdx_mig_handle_export_mem_error(&kvm_tdx->kvm,
-							gpa_list, npages);
+			failed = tdx_mig_handle_export_mem_error(&kvm_tdx->kvm,
+								 gpa_list, npages);
 			srcu_read_unlock(&kvm_tdx->kvm.srcu, idx);
 		}
+		atomic64_add(npages - failed,
+			     &mig_state->epoch_stats.exported_pages);
+		atomic64_add(failed, &mig_state->epoch_stats.export_failed_pages);
+		up_read(&mig_state->export_lock);
 
 		/*
 		 * 1 for GPA list and 1 for MAC list
@@ -851,6 +1100,7 @@ static int64_t tdx_mig_stream_export_mem(struct kvm_tdx *kvm_tdx,
 		if (copy_to_user(data, &out.rdx, sizeof(uint64_t)))
 			return -EFAULT;
 	} else {
+		up_read(&mig_state->export_lock);
 		pr_err("%s: err=%llx, gfn=%llx\n",
 			__func__, err, (uint64_t)gpa_list->entries[0].gfn);
 		return -EIO;
@@ -1046,6 +1296,7 @@ static int tdx_mig_export_track(struct kvm_tdx *kvm_tdx,
 				struct tdx_mig_stream *stream,
 				uint64_t __user *data)
 {
+	struct tdx_mig_state *mig_state = kvm_tdx->mig_state;
 	union tdx_mig_stream_info stream_info = {.val = 0};
 	uint64_t in_order, err;
 
@@ -1057,8 +1308,13 @@ static int tdx_mig_export_track(struct kvm_tdx *kvm_tdx,
 	 * token by sending a non-0 value through tdx_cmd.data.
 	 */
 	stream_info.in_order = !!in_order;
+	/* Wait for the exports of the current epoch on all the streams. */
+	down_write(&mig_state->export_lock);
 	err = tdh_export_track(kvm_tdx->tdr_pa,
 			       stream->mbmd.addr_and_size, stream_info.val);
+	if (err == TDX_SUCCESS)
+		tdx_mig_epoch_stats_rotate(mig_state);
+	up_write(&mig_state->export_lock);
 	if (err != TDX_SUCCESS) {
 		pr_err("%s: failed, err=%llx\n", __func__, err);
 		return -EIO;
@@ -1101,9 +1357,12 @@ static int tdx_mig_import_track(struct kvm_tdx *kvm_tdx,
 
 static int tdx_mig_export_pause(struct kvm_tdx *kvm_tdx)
 {
+	struct tdx_mig_state *mig_state = kvm_tdx->mig_state;
 	uint64_t err;
 
+	down_write(&mig_state->export_lock);
 	err = tdh_export_pasue(kvm_tdx->tdr_pa);
+	up_write(&mig_state->export_lock);
 	if (err != TDX_SUCCESS) {
 		pr_err("%s: failed, err=%llx\n", __func__, err);
 		return -EIO;
@@ -1333,7 +1592,9 @@ static int tdx_mig_export_abort(struct kvm_tdx *kvm_tdx,
 	if (copy_from_user(&gfn_end, (void __user *)data, sizeof(uint64_t)))
 		return -EFAULT;
 
+	down_write(&kvm_tdx->mig_state->export_lock);
 	err = tdh_export_abort(kvm_tdx->tdr_pa, 0, 0);
+	up_write(&kvm_tdx->mig_state->export_lock);
 	if (err != TDX_SUCCESS)
 		pr_err("%s: export abort failed, err=%llx\n", __func__, err);
 
@@ -1352,6 +1613,7 @@ static long tdx_mig_stream_ioctl(struct kvm_device *dev, unsigned int ioctl,
 	if (copy_from_user(&tdx_cmd, argp, sizeof(struct kvm_tdx_cmd)))
 		return -EFAULT;
 
+	mutex_lock(&stream->lock);
 	switch (tdx_cmd.id) {
 	case KVM_TDX_MIG_EXPORT_STATE_IMMUTABLE:
 		r = tdx_mig_export_state_immutable(kvm_tdx, stream,
@@ -1405,6 +1667,7 @@ static long tdx_mig_stream_ioctl(struct kvm_device *dev, unsigned int ioctl,
 	default:
 		r = -EINVAL;
 	}
+	mutex_unlock(&stream->lock);
 
 	return r;
 }
@@ -1482,6 +1745,7 @@ static int tdx_mig_state_create(struct kvm_tdx *kvm_tdx)
 		kfree(mig_state);
 		return -ENOMEM;
 	}
+	init_rwsem(&mig_state->export_lock);
 
 	kvm_tdx->mig_state = mig_state;
 
@@ -1524,6 +1788,8 @@ static int tdx_mig_stream_create(struct kvm_device *dev, u32 type)
 		return -ENOMEM;
 
 	dev->private = stream;
+	mutex_init(&stream->lock);
+	spin_lock_init(&stream->map_lock);
 	stream->idx = atomic_inc_return(&mig_state->streams_added) - 1;
 	/* The first stream is used as the default stream */
 	if (!stream->idx) {
@@ -1560,6 +1826,7 @@ static void tdx_mig_stream_release(struct kvm_device *dev)
 	atomic_dec(&mig_state->streams_added);
 
 	free_page((unsigned long)stream->mbmd.data);
+	tdx_mig_stream_user_buf_release(stream);
 	tdx_mig_stream_buf_list_cleanup(&stream->mem_buf_list);
 	free_page((unsigned long)stream->page_list.entries);
 	free_page((unsigned long)stream->gpa_list.entries);
@@ -41,11 +41,13 @@ static inline uint64_t kvm_seamcall(u64 op, u64 rcx, u64 rdx, u64 r8,
 				    u64 r9, u64 r10, u64 r11, u64 r12,
 				    u64 r13, struct tdx_module_output *out)
 {
-	u64 err, retries = 0;
+	u64 err, start, retries = 0;
 
 	do {
+		start = tdx_seamcall_stats_begin();
 		err = __seamcall(op, rcx, rdx, r8, r9,
 				 r10, r11, r12, r13, out);
+		tdx_seamcall_stats_end(op, start, err);
 
 		/*
 		 * If seamcall happens after VMXOFF during reboot,
@@ -196,6 +196,7 @@ void tdx_set_interrupt_shadow(struct kvm_vcpu *vcpu, int mask);
 
 int tdx_vm_ioctl(struct kvm *kvm, void __user *argp);
 int tdx_vcpu_ioctl(struct kvm_vcpu *vcpu, void __user *argp);
+void tdx_vcpu_create_debugfs(struct kvm_vcpu *vcpu, struct dentry *debugfs_dentry);
 
 void tdx_flush_tlb(struct kvm_vcpu *vcpu);
 int tdx_sept_tlb_remote_flush(struct kvm *kvm);
@@ -267,6 +268,8 @@ static inline void tdx_set_interrupt_shadow(struct kvm_vcpu *vcpu, int mask) {}
 
 static inline int tdx_vm_ioctl(struct kvm *kvm, void __user *argp) { return -EOPNOTSUPP; }
 static inline int tdx_vcpu_ioctl(struct kvm_vcpu *vcpu, void __user *argp) { return -EOPNOTSUPP; }
+static inline void tdx_vcpu_create_debugfs(struct kvm_vcpu *vcpu,
+					   struct dentry *debugfs_dentry) {}
 
 static inline void tdx_flush_tlb(struct kvm_vcpu *vcpu) {}
 static inline int tdx_sept_tlb_remote_flush(struct kvm *kvm) { return 0; }
@@ -192,6 +192,10 @@ module_param(enable_pmu, bool, 0444);
 bool __read_mostly eager_page_split = true;
 module_param(eager_page_split, bool, 0644);
 
+/* Split huge pages from a background worker instead of the memslot ioctl. */
+bool __read_mostly eager_page_split_async;
+module_param(eager_page_split_async, bool, 0644);
+
 /* Enable/disable SMT_RSB bug mitigation */
 bool __read_mostly mitigate_smt_rsb;
 module_param(mitigate_smt_rsb, bool, 0444);
@@ -247,6 +251,7 @@ const struct _kvm_stats_desc kvm_vm_stats_desc[] = {
 	STATS_DESC_ICOUNTER(VM, pages_2m),
 	STATS_DESC_ICOUNTER(VM, pages_1g),
 	STATS_DESC_ICOUNTER(VM, nx_lpage_splits),
+	STATS_DESC_ICOUNTER(VM, eager_split_pending),
 	STATS_DESC_PCOUNTER(VM, max_mmu_rmap_size),
 	STATS_DESC_PCOUNTER(VM, max_mmu_page_hash_collisions)
 };
@@ -2172,26 +2177,23 @@ static int handle_fastpath_set_tscdeadline(struct kvm_vcpu *vcpu, u64 data)
 	return 0;
 }
 
-fastpath_t handle_fastpath_set_msr_irqoff(struct kvm_vcpu *vcpu)
+/*
+ * Handle a write of @data to @msr in the fastpath.  The caller is responsible
+ * for completing the instruction, e.g. skipping WRMSR or setting the TDVMCALL
+ * status, if the write was handled.
+ */
+fastpath_t kvm_fastpath_set_msr_irqoff(struct kvm_vcpu *vcpu, u32 msr, u64 data)
 {
-	u32 msr = kvm_rcx_read(vcpu);
-	u64 data;
 	fastpath_t ret = EXIT_FASTPATH_NONE;
 
 	switch (msr) {
 	case APIC_BASE_MSR + (APIC_ICR >> 4):
-		data = kvm_read_edx_eax(vcpu);
-		if (!handle_fastpath_set_x2apic_icr_irqoff(vcpu, data)) {
-			kvm_skip_emulated_instruction(vcpu);
+		if (!handle_fastpath_set_x2apic_icr_irqoff(vcpu, data))
 			ret = EXIT_FASTPATH_EXIT_HANDLED;
-		}
 		break;
 	case MSR_IA32_TSC_DEADLINE:
-		data = kvm_read_edx_eax(vcpu);
-		if (!handle_fastpath_set_tscdeadline(vcpu, data)) {
-			kvm_skip_emulated_instruction(vcpu);
+		if (!handle_fastpath_set_tscdeadline(vcpu, data))
 			ret = EXIT_FASTPATH_REENTER_GUEST;
-		}
 		break;
 	default:
 		break;
@@ -2202,6 +2204,19 @@ fastpath_t handle_fastpath_set_msr_irqoff(struct kvm_vcpu *vcpu)
 
 	return ret;
 }
+EXPORT_SYMBOL_GPL(kvm_fastpath_set_msr_irqoff);
+
+fastpath_t handle_fastpath_set_msr_irqoff(struct kvm_vcpu *vcpu)
+{
+	fastpath_t ret;
+
+	ret = kvm_fastpath_set_msr_irqoff(vcpu, kvm_rcx_read(vcpu),
+					  kvm_read_edx_eax(vcpu));
+	if (ret != EXIT_FASTPATH_NONE)
+		kvm_skip_emulated_instruction(vcpu);
+
+	return ret;
+}
 EXPORT_SYMBOL_GPL(handle_fastpath_set_msr_irqoff);
 
 /*
@@ -12704,6 +12719,14 @@ static void kvm_mmu_slot_apply_flags(struct kvm *kvm,
 	u32 new_flags = new ? new->flags : 0;
 	bool log_dirty_pages = new_flags & KVM_MEM_LOG_DIRTY_PAGES;
 
+	/*
+	 * Drop any background split still queued for the old slot, the slot
+	 * is going away or no longer needs to be split for dirty logging.  A
+	 * FLAGS_ONLY update that keeps dirty logging enabled keeps its place.
+	 */
+	if (old && (change != KVM_MR_FLAGS_ONLY || !log_dirty_pages))
+		kvm_mmu_slot_cancel_split_huge_pages(kvm, old);
+
 	if (!kvm_arch_dirty_log_supported(kvm) && log_dirty_pages)
 		return;
 
@@ -12763,8 +12786,12 @@ static void kvm_mmu_slot_apply_flags(struct kvm *kvm,
 		if (kvm_dirty_log_manual_protect_and_init_set(kvm))
 			return;
 
-		if (READ_ONCE(eager_page_split))
-			kvm_mmu_slot_try_split_huge_pages(kvm, new, PG_LEVEL_4K);
+		if (READ_ONCE(eager_page_split)) {
+			if (READ_ONCE(eager_page_split_async))
+				kvm_mmu_slot_queue_split_huge_pages(kvm, new);
+			else
+				kvm_mmu_slot_try_split_huge_pages(kvm, new, PG_LEVEL_4K);
+		}
 
 		if (kvm_x86_ops.cpu_dirty_log_size) {
 			kvm_mmu_slot_leaf_clear_dirty(kvm, new);
@@ -13786,6 +13813,7 @@ EXPORT_TRACEPOINT_SYMBOL_GPL(kvm_vmgexit_msr_protocol_enter);
 EXPORT_TRACEPOINT_SYMBOL_GPL(kvm_vmgexit_msr_protocol_exit);
 EXPORT_TRACEPOINT_SYMBOL_GPL(kvm_tdx_hypercall);
 EXPORT_TRACEPOINT_SYMBOL_GPL(kvm_tdx_hypercall_done);
+EXPORT_TRACEPOINT_SYMBOL_GPL(kvm_tdx_hkid_release);
 
 static int __init kvm_x86_init(void)
 {
@@ -308,6 +308,7 @@ int x86_decode_emulated_instruction(struct kvm_vcpu *vcpu, int emulation_type,
 				    void *insn, int insn_len);
 int x86_emulate_instruction(struct kvm_vcpu *vcpu, gpa_t cr2_or_gpa,
 			    int emulation_type, void *insn, int insn_len);
+fastpath_t kvm_fastpath_set_msr_irqoff(struct kvm_vcpu *vcpu, u32 msr, u64 data);
 fastpath_t handle_fastpath_set_msr_irqoff(struct kvm_vcpu *vcpu);
 
 extern u64 host_xcr0;
@@ -332,6 +333,7 @@ extern int pi_inject_timer;
 extern bool report_ignored_msrs;
 
 extern bool eager_page_split;
+extern bool eager_page_split_async;
 
 static inline u64 nsec_to_cycles(struct kvm_vcpu *vcpu, u64 nsec)
 {
@@ -9,6 +9,40 @@
 #include <linux/export.h>
 #include <linux/uaccess.h>
 #include <linux/highmem.h>
+#include <linux/cacheinfo.h>
+
+/*
+ * Huge pages bigger than the last level cache are cleared with non-temporal
+ * stores: clearing them through the cache only evicts the working set, and
+ * the faulting task touches the page a little at a time anyway.
+ */
+unsigned long clear_page_nocache_threshold(void)
+{
+	struct cpu_cacheinfo *ci = get_cpu_cacheinfo(raw_smp_processor_id());
+	struct cacheinfo *llc = NULL;
+	int i;
+
+	/*
+	 * x86_cache_size is L2 on AMD, so find the last level cache in the
+	 * cacheinfo leaves. Until those are populated, keep clearing through
+	 * the cache.
+	 */
+	if (!ci->info_list)
+		return ULONG_MAX;
+
+	for (i = 0; i < ci->num_leaves; i++) {
+		struct cacheinfo *leaf = &ci->info_list[i];
+
+		if (leaf->type == CACHE_TYPE_INST)
+			continue;
+		if (!llc || leaf->level > llc->level)
+			llc = leaf;
+	}
+
+	if (!llc || !llc->size)
+		return ULONG_MAX;
+	return llc->size;
+}
 
 /*
  * Zero Userspace
@@ -11,12 +11,26 @@
 #include <asm/shared/tdx.h>
 #include <asm/unaccepted_memory.h>
 
-/* Protects unaccepted memory bitmap */
+/* Protects unaccepted memory bitmap and accepting_list */
 static DEFINE_SPINLOCK(unaccepted_memory_lock);
 
+/*
+ * Ranges, in 2M units, being accepted with unaccepted_memory_lock dropped.
+ * Accepting a range takes long, CPUs accepting disjoint ranges therefore
+ * don't serialize on the lock, only on overlapping ranges.
+ */
+struct accept_range {
+	struct list_head list;
+	unsigned long start;
+	unsigned long end;
+};
+
+static LIST_HEAD(accepting_list);
+
 void accept_memory(phys_addr_t start, phys_addr_t end)
 {
 	unsigned long range_start, range_end;
+	struct accept_range range, *entry;
 	unsigned long *bitmap;
 	unsigned long flags;
 
@@ -58,11 +72,30 @@ void accept_memory(phys_addr_t start, phys_addr_t end)
 	if (!(end % PMD_SIZE))
 		end += PMD_SIZE;
 
+	range.start = range_start;
+	range.end = DIV_ROUND_UP(end, PMD_SIZE);
+retry:
 	spin_lock_irqsave(&unaccepted_memory_lock, flags);
-	for_each_set_bitrange_from(range_start, range_end, bitmap,
-				   DIV_ROUND_UP(end, PMD_SIZE)) {
+
+	/* Wait for CPUs accepting an overlapping range to finish */
+	list_for_each_entry(entry, &accepting_list, list) {
+		if (entry->end <= range.start || entry->start >= range.end)
+			continue;
+		spin_unlock_irqrestore(&unaccepted_memory_lock, flags);
+		cpu_relax();
+		goto retry;
+	}
+	list_add(&range.list, &accepting_list);
+
+	for_each_set_bitrange_from(range_start, range_end, bitmap, range.end) {
 		unsigned long len = range_end - range_start;
 
+		/*
+		 * Keep interrupts disabled: an interrupt on this CPU, which
+		 * accepts memory overlapping the range, would spin forever.
+		 */
+		spin_unlock(&unaccepted_memory_lock);
+
 		/* Platform-specific memory-acceptance call goes here */
 		if (cpu_feature_enabled(X86_FEATURE_TDX_GUEST)) {
 			tdx_accept_memory(range_start * PMD_SIZE,
@@ -71,8 +104,11 @@ void accept_memory(phys_addr_t start, phys_addr_t end)
 			panic("Cannot accept memory: unknown platform\n");
 		}
 
+		spin_lock(&unaccepted_memory_lock);
 		bitmap_clear(bitmap, range_start, len);
 	}
+
+	list_del(&range.list);
 	spin_unlock_irqrestore(&unaccepted_memory_lock, flags);
 }
 
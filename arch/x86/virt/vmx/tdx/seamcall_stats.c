@@ -0,0 +1,224 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * Per-leaf SEAMCALL statistics.
+ *
+ * When enabled through debugfs, every SEAMCALL made by the TDX host code and
+ * by KVM is accounted to its leaf function: the number of calls, how many of
+ * them returned TDX_OPERAND_BUSY or another error, and the TSC cycles spent,
+ * as a total, a maximum and a log2 histogram.  Busy returns are counted per
+ * call, so the retry loops e.g. of reclaiming pages or of the Secure-EPT
+ * operations show up as busy calls of their leaf.
+ *
+ * The counters are kept per CPU and summed when read.  When disabled, the
+ * only cost on the SEAMCALL path is a static branch.
+ */
+
+#include <linux/types.h>
+#include <linux/init.h>
+#include <linux/debugfs.h>
+#include <linux/jump_label.h>
+#include <linux/math64.h>
+#include <linux/mutex.h>
+#include <linux/percpu.h>
+#include <linux/seq_file.h>
+#include <asm/tdx.h>
+#include "tdx.h"
+
+/* Leaves kept apart; higher leaf numbers are not accounted. */
+#define SEAMCALL_STATS_NR_TDH		128
+#define SEAMCALL_STATS_NR_SEAMLDR	16
+#define SEAMCALL_STATS_NR		(SEAMCALL_STATS_NR_TDH + \
+					 SEAMCALL_STATS_NR_SEAMLDR)
+
+/*
+ * Bucket 0 counts calls below 1K cycles, bucket n > 0 calls of
+ * [2^(n+9), 2^(n+10)) cycles.  The last bucket takes everything above.
+ */
+#define SEAMCALL_STATS_NR_BUCKETS	16
+#define SEAMCALL_STATS_BUCKET_SHIFT	10
+
+/* SEAMCALL completion status class, bits 63:32 of RAX */
+#define SEAMCALL_STATUS_MASK		GENMASK_ULL(63, 32)
+#define SEAMCALL_OPERAND_BUSY		0x8000020000000000ULL
+
+struct seamcall_stat {
+	u64 calls;
+	u64 busy;
+	u64 errors;
+	u64 cycles;
+	u64 max_cycles;
+	u64 hist[SEAMCALL_STATS_NR_BUCKETS];
+};
+
+DEFINE_STATIC_KEY_FALSE(tdx_seamcall_stats_key);
+EXPORT_SYMBOL_GPL(tdx_seamcall_stats_key);
+
+static struct seamcall_stat __percpu *seamcall_stats;
+static DEFINE_MUTEX(seamcall_stats_lock);
+
+static int seamcall_stats_index(u64 fn)
+{
+	u64 leaf;
+
+	if (fn & P_SEAMLDR_SEAMCALL_BASE) {
+		leaf = fn & ~P_SEAMLDR_SEAMCALL_BASE;
+		if (leaf >= SEAMCALL_STATS_NR_SEAMLDR)
+			return -1;
+		return SEAMCALL_STATS_NR_TDH + leaf;
+	}
+
+	/* Bits 23:16 carry the leaf version, which is accounted together */
+	leaf = fn & 0xffff;
+	if (leaf >= SEAMCALL_STATS_NR_TDH)
+		return -1;
+	return leaf;
+}
+
+/*
+ * Account one SEAMCALL of leaf @fn which took @cycles and completed with
+ * @err.  Called by tdx_seamcall_stats_end() only, with stats enabled.
+ */
+void __tdx_seamcall_stats_account(u64 fn, u64 cycles, u64 err)
+{
+	struct seamcall_stat *s;
+	unsigned long flags;
+	int idx, bucket;
+
+	idx = seamcall_stats_index(fn);
+	if (idx < 0)
+		return;
+
+	bucket = min(fls64(cycles >> SEAMCALL_STATS_BUCKET_SHIFT),
+		     SEAMCALL_STATS_NR_BUCKETS - 1);
+
+	/* SEAMCALLs are also made from IRQ context, e.g. on LP init */
+	local_irq_save(flags);
+	s = this_cpu_ptr(seamcall_stats) + idx;
+	s->calls++;
+	if ((err & SEAMCALL_STATUS_MASK) == SEAMCALL_OPERAND_BUSY)
+		s->busy++;
+	else if (err)
+		s->errors++;
+	s->cycles += cycles;
+	if (cycles > s->max_cycles)
+		s->max_cycles = cycles;
+	s->hist[bucket]++;
+	local_irq_restore(flags);
+}
+EXPORT_SYMBOL_GPL(__tdx_seamcall_stats_account);
+
+static int seamcall_stats_show(struct seq_file *m, void *v)
+{
+	struct seamcall_stat sum;
+	int idx, cpu, i;
+
+	mutex_lock(&seamcall_stats_lock);
+	if (!seamcall_stats)
+		goto out;
+
+	seq_printf(m, "%-12s %12s %10s %10s %12s %12s  cycles histogram (<1K, 1K, 2K, ...)\n",
+		   "leaf", "calls", "busy", "errors", "avg_cycles", "max_cycles");
+
+	for (idx = 0; idx < SEAMCALL_STATS_NR; idx++) {
+		memset(&sum, 0, sizeof(sum));
+		for_each_possible_cpu(cpu) {
+			struct seamcall_stat *s = per_cpu_ptr(seamcall_stats, cpu) + idx;
+
+			sum.calls += s->calls;
+			sum.busy += s->busy;
+			sum.errors += s->errors;
+			sum.cycles += s->cycles;
+			sum.max_cycles = max(sum.max_cycles, s->max_cycles);
+			for (i = 0; i < SEAMCALL_STATS_NR_BUCKETS; i++)
+				sum.hist[i] += s->hist[i];
+		}
+		if (!sum.calls)
+			continue;
+
+		if (idx < SEAMCALL_STATS_NR_TDH)
+			seq_printf(m, "tdh:%-8d", idx);
+		else
+			seq_printf(m, "seamldr:%-4d", idx - SEAMCALL_STATS_NR_TDH);
+		seq_printf(m, " %12llu %10llu %10llu %12llu %12llu ",
+			   sum.calls, sum.busy, sum.errors,
+			   div64_u64(sum.cycles, sum.calls), sum.max_cycles);
+		for (i = 0; i < SEAMCALL_STATS_NR_BUCKETS; i++)
+			seq_printf(m, " %llu", sum.hist[i]);
+		seq_putc(m, '\n');
+	}
+out:
+	mutex_unlock(&seamcall_stats_lock);
+	return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(seamcall_stats);
+
+static int seamcall_stats_enable_get(void *data, u64 *val)
+{
+	*val = static_key_enabled(&tdx_seamcall_stats_key);
+	return 0;
+}
+
+static int seamcall_stats_enable_set(void *data, u64 val)
+{
+	int ret = 0;
+
+	mutex_lock(&seamcall_stats_lock);
+	if (!val) {
+		static_branch_disable(&tdx_seamcall_stats_key);
+		goto out;
+	}
+
+	/* Kept once allocated, in-flight SEAMCALLs may still account */
+	if (!seamcall_stats) {
+		seamcall_stats = __alloc_percpu(sizeof(struct seamcall_stat) *
+						SEAMCALL_STATS_NR,
+						__alignof__(struct seamcall_stat));
+		if (!seamcall_stats) {
+			ret = -ENOMEM;
+			goto out;
+		}
+	}
+	static_branch_enable(&tdx_seamcall_stats_key);
+out:
+	mutex_unlock(&seamcall_stats_lock);
+	return ret;
+}
+
+DEFINE_DEBUGFS_ATTRIBUTE(seamcall_stats_enable_fops, seamcall_stats_enable_get,
+			 seamcall_stats_enable_set, "%llu\n");
+
+static int seamcall_stats_reset_set(void *data, u64 val)
+{
+	int cpu;
+
+	mutex_lock(&seamcall_stats_lock);
+	/* Racy against SEAMCALLs in flight, good enough for a reset */
+	if (seamcall_stats) {
+		for_each_possible_cpu(cpu)
+			memset(per_cpu_ptr(seamcall_stats, cpu), 0,
+			       sizeof(struct seamcall_stat) * SEAMCALL_STATS_NR);
+	}
+	mutex_unlock(&seamcall_stats_lock);
+	return 0;
+}
+
+DEFINE_DEBUGFS_ATTRIBUTE(seamcall_stats_reset_fops, NULL,
+			 seamcall_stats_reset_set, "%llu\n");
+
+static int __init seamcall_stats_init(void)
+{
+	struct dentry *dir;
+
+	if (!platform_tdx_enabled())
+		return 0;
+
+	dir = debugfs_create_dir("tdx_seamcall", arch_debugfs_dir);
+	debugfs_create_file("enable", 0600, dir, NULL,
+			    &seamcall_stats_enable_fops);
+	debugfs_create_file("reset", 0200, dir, NULL,
+			    &seamcall_stats_reset_fops);
+	debugfs_create_file("stats", 0400, dir, NULL, &seamcall_stats_fops);
+
+	return 0;
+}
+late_initcall(seamcall_stats_init);
@@ -25,6 +25,8 @@
 #include <linux/sort.h>
 #include <linux/firmware.h>
 #include <linux/platform_device.h>
+#include <linux/ktime.h>
+#include <linux/workqueue.h>
 #include <asm/pgtable_types.h>
 #include <asm/msr.h>
 #include <asm/cpu.h>
@@ -54,6 +56,11 @@ static enum tdx_module_status_t tdx_module_status;
 /* Prevent concurrent attempts on TDX detection and initialization */
 static DEFINE_MUTEX(tdx_module_lock);
 
+#ifdef CONFIG_INTEL_TDX_MODULE_UPDATE
+/* Time the TDX module was out of service during the last update */
+static u64 tdx_module_blackout_us;
+#endif
+
 #ifdef CONFIG_SYSFS
 static bool sysfs_registered;
 static int tdx_module_sysfs_init(void);
@@ -358,9 +365,10 @@ out:
 static int seamcall(u64 fn, u64 rcx, u64 rdx, u64 r8, u64 r9,
 		    u64 *seamcall_ret, struct tdx_module_output *out)
 {
-	u64 sret;
+	u64 sret, start;
 	int err;
 
+	start = tdx_seamcall_stats_begin();
 	if (fn & P_SEAMLDR_SEAMCALL_BASE) {
 		err = __seamldr_seamcall(fn, rcx, rdx, r8, r9, out, &sret);
 		if (err)
@@ -368,6 +376,7 @@ static int seamcall(u64 fn, u64 rcx, u64 rdx, u64 r8, u64 r9,
 	} else {
 		sret = __seamcall(fn, rcx, rdx, r8, r9, 0, 0, 0, 0, out);
 	}
+	tdx_seamcall_stats_end(fn, start, sret);
 
 	/* Save SEAMCALL return code if the caller wants it */
 	if (seamcall_ret)
@@ -762,6 +771,62 @@ static int tdmr_get_nid(struct tdmr_info *tdmr, struct list_head *tmb_list)
 	return 0;
 }
 
+struct tdmr_work {
+	struct work_struct work;
+	struct tdmr_info *tdmr;
+	int (*fn)(struct tdmr_info *tdmr, void *data);
+	void *data;
+	int ret;
+};
+
+static void tdmr_work_fn(struct work_struct *work)
+{
+	struct tdmr_work *tw = container_of(work, struct tdmr_work, work);
+
+	tw->ret = tw->fn(tw->tdmr, tw->data);
+}
+
+/*
+ * Run @fn for all TDMRs in parallel, each on a CPU of the NUMA node
+ * tdmr_get_nid() picks for it.  Return the first error, after all TDMRs
+ * are done.  Falls back to a serial loop if the works can't be allocated.
+ */
+static int tdmrs_run_on_nodes(struct tdmr_info_list *tdmr_list,
+			      struct list_head *tmb_list,
+			      int (*fn)(struct tdmr_info *tdmr, void *data),
+			      void *data)
+{
+	struct tdmr_work *works;
+	int i, ret = 0;
+
+	works = kcalloc(tdmr_list->nr_tdmrs, sizeof(*works), GFP_KERNEL);
+	if (!works) {
+		for (i = 0; i < tdmr_list->nr_tdmrs && !ret; i++)
+			ret = fn(tdmr_entry(tdmr_list, i), data);
+		return ret;
+	}
+
+	for (i = 0; i < tdmr_list->nr_tdmrs; i++) {
+		struct tdmr_work *tw = &works[i];
+
+		INIT_WORK(&tw->work, tdmr_work_fn);
+		tw->tdmr = tdmr_entry(tdmr_list, i);
+		tw->fn = fn;
+		tw->data = data;
+		queue_work_node(tdmr_get_nid(tw->tdmr, tmb_list),
+				system_unbound_wq, &tw->work);
+	}
+
+	for (i = 0; i < tdmr_list->nr_tdmrs; i++) {
+		flush_work(&works[i].work);
+		if (!ret)
+			ret = works[i].ret;
+	}
+
+	kfree(works);
+	return ret;
+}
+
 /*
  * Allocate PAMTs from the local NUMA node of some memory in @tmb_list
  * within @tdmr, and set up PAMTs for @tdmr.
@@ -866,23 +931,36 @@ static void tdmrs_free_pamt_all(struct tdmr_info_list *tdmr_list)
 		tdmr_free_pamt(tdmr_entry(tdmr_list, i));
 }
 
-/* Allocate and set up PAMTs for all TDMRs */
+struct tdmr_pamt_args {
+	struct list_head *tmb_list;
+	u16 pamt_entry_size;
+};
+
+static int tdmr_set_up_pamt_fn(struct tdmr_info *tdmr, void *data)
+{
+	struct tdmr_pamt_args *args = data;
+
+	return tdmr_set_up_pamt(tdmr, args->tmb_list, args->pamt_entry_size);
+}
+
+/*
+ * Allocate and set up PAMTs for all TDMRs.  Finding contiguous ranges
+ * for big PAMTs can take a while, do it on all nodes at the same time.
+ */
 static int tdmrs_set_up_pamt_all(struct tdmr_info_list *tdmr_list,
 				 struct list_head *tmb_list,
 				 u16 pamt_entry_size)
 {
-	int i, ret = 0;
-
-	for (i = 0; i < tdmr_list->nr_tdmrs; i++) {
-		ret = tdmr_set_up_pamt(tdmr_entry(tdmr_list, i), tmb_list,
-				pamt_entry_size);
-		if (ret)
-			goto err;
-	}
+	struct tdmr_pamt_args args = {
+		.tmb_list = tmb_list,
+		.pamt_entry_size = pamt_entry_size,
+	};
+	int ret;
 
-	return 0;
-err:
-	tdmrs_free_pamt_all(tdmr_list);
+	ret = tdmrs_run_on_nodes(tdmr_list, tmb_list, tdmr_set_up_pamt_fn,
+				 &args);
+	if (ret)
+		tdmrs_free_pamt_all(tdmr_list);
 	return ret;
 }
 
@@ -1249,23 +1327,20 @@ static int init_tdmr(struct tdmr_info *tdmr)
 	return 0;
 }
 
-static int init_tdmrs(struct tdmr_info_list *tdmr_list)
+static int init_tdmr_fn(struct tdmr_info *tdmr, void *data)
 {
-	int i;
+	return init_tdmr(tdmr);
+}
 
+static int init_tdmrs(struct tdmr_info_list *tdmr_list)
+{
 	/*
-	 * This operation is costly.  It can be parallelized,
-	 * but keep it simple for now.
+	 * This operation is costly: the TDX module initializes the PAMT
+	 * of the whole TDMR.  TDH.SYS.TDMR.INIT can be invoked for
+	 * different TDMRs concurrently, so initialize them in parallel,
+	 * each on the node holding its PAMT.
 	 */
-	for (i = 0; i < tdmr_list->nr_tdmrs; i++) {
-		int ret;
-
-		ret = init_tdmr(tdmr_entry(tdmr_list, i));
-		if (ret)
-			return ret;
-	}
-
-	return 0;
+	return tdmrs_run_on_nodes(tdmr_list, &tdx_memlist, init_tdmr_fn, NULL);
 }
 
 static void do_lp_init(void *data)
@@ -1561,6 +1636,24 @@ static struct kobj_attribute tdx_module_status_attr = {
 	.show = tdx_module_status_show,
 };
 
+#ifdef CONFIG_INTEL_TDX_MODULE_UPDATE
+static ssize_t tdx_module_blackout_us_show(struct kobject *kobj, struct kobj_attribute *attr, char *buf)
+{
+	u64 blackout_us;
+
+	mutex_lock(&tdx_module_lock);
+	blackout_us = tdx_module_blackout_us;
+	mutex_unlock(&tdx_module_lock);
+
+	return sprintf(buf, "%llu", blackout_us);
+}
+
+static struct kobj_attribute tdx_module_blackout_us_attr = {
+	.attr = { .name = "update_blackout_us", .mode = 0444 },
+	.show = tdx_module_blackout_us_show,
+};
+#endif
+
 static int __init tdx_sysfs_init(void)
 {
 	int ret;
@@ -1583,8 +1676,16 @@ static int __init tdx_sysfs_init(void)
 		return -EINVAL;
 	}
 	ret = sysfs_create_file(tdx_module_kobj, &tdx_module_status_attr.attr);
-	if (ret)
+	if (ret) {
 		pr_err("Sysfs exporting tdx module status failed %d\n", ret);
+		return ret;
+	}
+
+#ifdef CONFIG_INTEL_TDX_MODULE_UPDATE
+	ret = sysfs_create_file(tdx_module_kobj, &tdx_module_blackout_us_attr.attr);
+	if (ret)
+		pr_err("Sysfs exporting tdx module update blackout failed %d\n", ret);
+#endif
 
 	return ret;
 }
@@ -1644,6 +1745,9 @@ static int tdx_module_sysfs_init(void)
 #ifdef CONFIG_INTEL_TDX_MODULE_UPDATE
 static struct p_seamldr_info p_seamldr_info;
 
+/* Update staged by tdx_module_update_prepare(), protected by tdx_module_lock */
+static struct seamldr_params *tdx_staged_params;
+
 static bool can_preserve_td(const struct seam_sigstruct *sigstruct)
 {
 	u64 ret;
@@ -1709,8 +1813,7 @@ static void free_seamldr_params(struct seamldr_params *params)
 
 /* Allocate and populate a seamldr_params */
 static struct seamldr_params *alloc_seamldr_params(const void *module, int module_size,
-						   const void *sig, int sig_size,
-						   bool live_update)
+						   const void *sig, int sig_size)
 {
 	struct seamldr_params *params;
 	unsigned long page;
@@ -1733,10 +1836,6 @@ static struct seamldr_params *alloc_seamldr_params(const void *module, int modul
 	if (!params)
 		return ERR_PTR(-ENOMEM);
 
-	if (live_update)
-		params->scenario = SEAMLDR_SCENARIO_UPDATE;
-	else
-		params->scenario = SEAMLDR_SCENARIO_LOAD;
 	params->num_module_pages = module_size >> PAGE_SHIFT;
 
 	/*
@@ -1933,44 +2032,118 @@ static int init_tdx_module_via_handoff_data(void)
 }
 
 /*
- * @recoverable is used to tell the caller if the old TDX module still works after
- * an update failure.
+ * Load the new module and its sigstruct from the firmware directory and check
+ * the module against the hash in the sigstruct. This is the slow part of an
+ * update and doesn't involve the running module, so it can be done before TDs
+ * are paused; see tdx_module_update_prepare().
  */
-int tdx_module_update(bool live_update, bool *recoverable)
+static struct seamldr_params *load_seamldr_params(void)
 {
-	int ret;
 	struct seamldr_params *params;
 	/* Fake device for request_firmware */
 	struct platform_device *tdx_pdev;
 	const struct firmware *module, *sig;
-	const struct seam_sigstruct *seam_sig;
+	int ret;
 
-	*recoverable = true;
 	tdx_pdev = platform_device_register_simple("tdx", -1, NULL, 0);
 	if (IS_ERR(tdx_pdev))
-		return PTR_ERR(tdx_pdev);
+		return ERR_CAST(tdx_pdev);
 
 	ret = request_firmware_direct(&module, "intel-seam/libtdx.bin",
 				      &tdx_pdev->dev);
-	if (ret)
+	if (ret) {
+		params = ERR_PTR(ret);
 		goto unregister;
+	}
 
 	ret = request_firmware_direct(&sig, "intel-seam/libtdx.bin.sigstruct",
 				      &tdx_pdev->dev);
-	if (ret)
+	if (ret) {
+		params = ERR_PTR(ret);
 		goto release_module;
+	}
 
-	seam_sig = (void *)sig->data;
-	params = alloc_seamldr_params(module->data, module->size, sig->data, sig->size,
-				      live_update);
-	if (IS_ERR(params)) {
-		ret = PTR_ERR(params);
+	params = alloc_seamldr_params(module->data, module->size, sig->data, sig->size);
+	if (IS_ERR(params))
 		goto release_sig;
+
+	ret = verify_hash(module->data, module->size,
+			  ((const struct seam_sigstruct *)sig->data)->seamhash);
+	if (ret) {
+		free_seamldr_params(params);
+		params = ERR_PTR(ret);
 	}
 
-	ret = verify_hash(module->data, module->size, seam_sig->seamhash);
-	if (ret)
-		goto free;
+release_sig:
+	release_firmware(sig);
+release_module:
+	release_firmware(module);
+unregister:
+	platform_device_unregister(tdx_pdev);
+	return params;
+}
+
+/**
+ * tdx_module_update_prepare - Stage a TDX module update
+ *
+ * Load and verify the new TDX module ahead of tdx_module_update(), so that
+ * TDs only have to be paused for the handoff and the install. A later call
+ * replaces the staged module.
+ *
+ * Return 0 on success, otherwise error.
+ */
+int tdx_module_update_prepare(void)
+{
+	struct seamldr_params *params, *old;
+
+	params = load_seamldr_params();
+	if (IS_ERR(params))
+		return PTR_ERR(params);
+
+	mutex_lock(&tdx_module_lock);
+	old = tdx_staged_params;
+	tdx_staged_params = params;
+	mutex_unlock(&tdx_module_lock);
+
+	if (old)
+		free_seamldr_params(old);
+	return 0;
+}
+EXPORT_SYMBOL_GPL(tdx_module_update_prepare);
+
+/*
+ * @recoverable is used to tell the caller if the old TDX module still works after
+ * an update failure.
+ *
+ * The module staged by tdx_module_update_prepare() is used if there is one,
+ * otherwise the module is loaded here.
+ */
+int tdx_module_update(bool live_update, bool *recoverable)
+{
+	const struct seam_sigstruct *seam_sig;
+	struct seamldr_params *params;
+	ktime_t start;
+	int ret;
+
+	*recoverable = true;
+
+	mutex_lock(&tdx_module_lock);
+	params = tdx_staged_params;
+	tdx_staged_params = NULL;
+	mutex_unlock(&tdx_module_lock);
+
+	if (!params) {
+		params = load_seamldr_params();
+		if (IS_ERR(params))
+			return PTR_ERR(params);
+	}
+
+	/* alloc_seamldr_params() keeps a copy of the sigstruct */
+	seam_sig = __va(params->sigstruct_pa);
+	if (live_update)
+		params->scenario = SEAMLDR_SCENARIO_UPDATE;
+	else
+		params->scenario = SEAMLDR_SCENARIO_LOAD;
 
 	/* Prevent TDX module initialization */
 	mutex_lock(&tdx_module_lock);
@@ -1990,6 +2163,9 @@ int tdx_module_update(bool live_update, bool *recoverable)
 		goto unlock;
 	}
 
+	/* The module is out of service from here on */
+	start = ktime_get();
+
 	if (live_update) {
 		ret = tdx_prepare_handoff_data(seam_sig);
 		if (ret)
@@ -2011,18 +2187,15 @@ int tdx_module_update(bool live_update, bool *recoverable)
 		ret = __tdx_enable(live_update);
 	}
 
+	tdx_module_blackout_us = ktime_us_delta(ktime_get(), start);
+	if (!ret)
+		pr_info("TDX module updated, out of service for %llu us\n",
+			tdx_module_blackout_us);
+
 unlock:
 	cpus_read_unlock();
 	mutex_unlock(&tdx_module_lock);
-free:
 	free_seamldr_params(params);
-
-release_sig:
-	release_firmware(sig);
-release_module:
-	release_firmware(module);
-unregister:
-	platform_device_unregister(tdx_pdev);
 	return ret;
 }
 EXPORT_SYMBOL_GPL(tdx_module_update);
@@ -44,7 +44,8 @@
  * /sys/fs/cgroup/io.cost.model.
  *
  * If needed, tools/cgroup/iocost_coef_gen.py can be used to generate
- * device-specific coefficients.
+ * device-specific coefficients.  Alternatively, "ctrl=calib" makes the
+ * controller calibrate the coefficients online, see 2-2.
  *
  * 2. Control Strategy
  *
@@ -99,6 +100,13 @@
  * at the vrate of 75%, all cgroups added up would only be able to issue
  * 750ms worth of IOs per second, and vice-versa for speeding up.
  *
+ * A vrate that settles away from 100% means that the cost model is off by
+ * that factor for the current device and workload.  With "ctrl=calib" in
+ * io.cost.model, once the vrate has stayed more than CALIB_THR_PCT away
+ * from 100% in the same direction for CALIB_CYCLE_NSEC, the factor is
+ * folded into the model coefficients and the vrate is brought back
+ * towards 100% by the same factor, so the issue rate doesn't change.
+ *
  * Device business is determined using two criteria - rq wait and
  * completion latencies.
  *
@@ -260,6 +268,16 @@ enum {
 
 	/* switch iff the conditions are met for longer than this */
 	AUTOP_CYCLE_NSEC	= 10LLU * NSEC_PER_SEC,
+
+	/*
+	 * Online cost model calibration. Only act on vrate deviations beyond
+	 * the threshold which persisted for the whole cycle and bound how far
+	 * a single step can move the coefficients.
+	 */
+	CALIB_CYCLE_NSEC	= 10LLU * NSEC_PER_SEC,
+	CALIB_THR_PCT		= 10,
+	CALIB_MIN_SCALE_PCT	= 50,
+	CALIB_MAX_SCALE_PCT	= 200,
 };
 
 enum {
@@ -445,6 +463,11 @@ struct ioc {
 	int				autop_idx;
 	bool				user_qos_params:1;
 	bool				user_cost_model:1;
+	bool				calib_cost_model:1;
+
+	/* online cost model calibration, see ioc_calibrate_cost_model() */
+	u64				calib_at;
+	int				calib_dir;
 };
 
 struct iocg_pcpu_stat {
@@ -1024,6 +1047,60 @@ static void ioc_adjust_base_vrate(struct ioc *ioc, u32 rq_wait_pct,
 	ioc_refresh_margins(ioc);
 }
 
+/*
+ * With ctrl=calib, fold a persistent vrate deviation into the linear model
+ * coefficients. Scaling all of bps, seqiops and randiops by the vrate and
+ * dividing the vrate by the same amount leaves the issue rate unchanged while
+ * keeping the model close to what the device actually delivers.
+ */
+static void ioc_calibrate_cost_model(struct ioc *ioc)
+{
+	u64 vrate = ioc->vtime_base_rate;
+	u32 vrate_pct, scale_pct;
+	u64 now_ns;
+	int dir, i;
+
+	lockdep_assert_held(&ioc->lock);
+
+	if (!ioc->calib_cost_model)
+		return;
+
+	vrate_pct = div64_u64(vrate * 100, VTIME_PER_USEC);
+	if (vrate_pct > 100 + CALIB_THR_PCT)
+		dir = 1;
+	else if (vrate_pct < 100 - CALIB_THR_PCT)
+		dir = -1;
+	else
+		dir = 0;
+
+	now_ns = ktime_get_ns();
+	if (!dir || dir != ioc->calib_dir) {
+		ioc->calib_dir = dir;
+		ioc->calib_at = dir ? now_ns : 0;
+		return;
+	}
+	if (now_ns - ioc->calib_at < CALIB_CYCLE_NSEC)
+		return;
+
+	scale_pct = clamp_t(u32, vrate_pct, CALIB_MIN_SCALE_PCT,
+			    CALIB_MAX_SCALE_PCT);
+	for (i = 0; i < NR_I_LCOEFS; i++) {
+		u64 *u = &ioc->params.i_lcoefs[i];
+
+		if (*u)
+			*u = max_t(u64, div64_u64(*u * scale_pct, 100), 1);
+	}
+	ioc_refresh_lcoefs(ioc);
+
+	vrate = max_t(u64, div64_u64(vrate * 100, scale_pct), VRATE_MIN);
+	ioc->vtime_base_rate = vrate;
+	atomic64_set(&ioc->vtime_rate, vrate);
+	ioc_refresh_margins(ioc);
+
+	ioc->calib_dir = 0;
+	ioc->calib_at = 0;
+}
+
 /* take a snapshot of the current [v]time and vrate */
 static void ioc_now(struct ioc *ioc, struct ioc_now *now)
 {
@@ -2407,6 +2484,8 @@ static void ioc_timer_fn(struct timer_list *timer)
 	ioc_adjust_base_vrate(ioc, rq_wait_pct, nr_lagging, nr_shortages,
 			      prev_busy_level, missed_ppm);
 
+	ioc_calibrate_cost_model(ioc);
+
 	ioc_refresh_params(ioc, false);
 
 	ioc_forgive_debts(ioc, usage_us_sum, nr_debtors, &now);
@@ -3324,7 +3403,8 @@ static u64 ioc_cost_model_prfill(struct seq_file *sf,
 	seq_printf(sf, "%s ctrl=%s model=linear "
 		   "rbps=%llu rseqiops=%llu rrandiops=%llu "
 		   "wbps=%llu wseqiops=%llu wrandiops=%llu\n",
-		   dname, ioc->user_cost_model ? "user" : "auto",
+		   dname, ioc->calib_cost_model ? "calib" :
+		   ioc->user_cost_model ? "user" : "auto",
 		   u[I_LCOEF_RBPS], u[I_LCOEF_RSEQIOPS], u[I_LCOEF_RRANDIOPS],
 		   u[I_LCOEF_WBPS], u[I_LCOEF_WSEQIOPS], u[I_LCOEF_WRANDIOPS]);
 	return 0;
@@ -3362,7 +3442,7 @@ static ssize_t ioc_cost_model_write(struct kernfs_open_file *of, char *input,
 	struct request_queue *q;
 	struct ioc *ioc;
 	u64 u[NR_I_LCOEFS];
-	bool user;
+	bool user, calib;
 	char *p;
 	int ret;
 
@@ -3385,6 +3465,7 @@ static ssize_t ioc_cost_model_write(struct kernfs_open_file *of, char *input,
 	spin_lock_irq(&ioc->lock);
 	memcpy(u, ioc->params.i_lcoefs, sizeof(u));
 	user = ioc->user_cost_model;
+	calib = ioc->calib_cost_model;
 
 	while ((p = strsep(&input, " \t\n"))) {
 		substring_t args[MAX_OPT_ARGS];
@@ -3398,12 +3479,19 @@ static ssize_t ioc_cost_model_write(struct kernfs_open_file *of, char *input,
 		switch (match_token(p, cost_ctrl_tokens, args)) {
 		case COST_CTRL:
 			match_strlcpy(buf, &args[0], sizeof(buf));
-			if (!strcmp(buf, "auto"))
+			if (!strcmp(buf, "auto")) {
 				user = false;
-			else if (!strcmp(buf, "user"))
+				calib = false;
+			} else if (!strcmp(buf, "user")) {
 				user = true;
-			else
+				calib = false;
+			} else if (!strcmp(buf, "calib")) {
+				/* start from the current coefficients */
+				user = true;
+				calib = true;
+			} else {
 				goto einval;
+			}
 			continue;
 		case COST_MODEL:
 			match_strlcpy(buf, &args[0], sizeof(buf));
@@ -3427,6 +3515,9 @@ static ssize_t ioc_cost_model_write(struct kernfs_open_file *of, char *input,
 	} else {
 		ioc->user_cost_model = false;
 	}
+	ioc->calib_cost_model = calib;
+	ioc->calib_dir = 0;
+	ioc->calib_at = 0;
 	ioc_refresh_params(ioc, true);
 	spin_unlock_irq(&ioc->lock);
 
@@ -283,6 +283,23 @@ static struct bio *bio_split_rw(struct bio *bio, const struct queue_limits *lim,
 	struct bvec_iter iter;
 	unsigned nsegs = 0, bytes = 0;
 
+	/*
+	 * Fast path for bios whose remaining data is a single physically
+	 * contiguous range, such as a bio built from one large folio: it is
+	 * a single segment if it fits the size limit and the first segment
+	 * starting at it covers all of it, so there is nothing to walk.
+	 */
+	if (bio->bi_vcnt == 1) {
+		bv = mp_bvec_iter_bvec(bio->bi_io_vec, bio->bi_iter);
+		if (bv.bv_len == bio->bi_iter.bi_size &&
+		    bv.bv_len <= max_bytes && lim->max_segments &&
+		    get_max_segment_size(lim, bv.bv_page, bv.bv_offset) >=
+		    bv.bv_len) {
+			*segs = 1;
+			return NULL;
+		}
+	}
+
 	bio_for_each_bvec(bv, bio, iter) {
 		/*
 		 * If the queue doesn't support SG gaps and adding this
@@ -115,9 +115,24 @@ unsigned long blk_mq_get_tags(struct blk_mq_alloc_data *data, int nr_tags,
 	struct sbitmap_queue *bt = &tags->bitmap_tags;
 	unsigned long ret;
 
-	if (data->shallow_depth ||data->flags & BLK_MQ_REQ_RESERVED ||
-	    data->hctx->flags & BLK_MQ_F_TAG_QUEUE_SHARED)
+	if (data->shallow_depth ||data->flags & BLK_MQ_REQ_RESERVED)
 		return 0;
+
+	/*
+	 * With a shared tag map, only take as many tags as this queue's fair
+	 * share still allows. The caller accounts them as active right away,
+	 * so that concurrent batches see them.
+	 */
+	if (data->hctx->flags & BLK_MQ_F_TAG_QUEUE_SHARED) {
+		unsigned int budget;
+
+		if (data->q->elevator)
+			return 0;
+		budget = hctx_tag_budget(data->hctx, bt);
+		if (budget < 2)
+			return 0;
+		nr_tags = min_t(unsigned int, nr_tags, budget);
+	}
 	ret = __sbitmap_queue_get_batch(bt, nr_tags, offset);
 	*offset += tags->nr_reserved_tags;
 	return ret;
@@ -444,6 +444,7 @@ __blk_mq_alloc_requests_batch(struct blk_mq_alloc_data *data,
 	struct blk_mq_tags *tags;
 	struct request *rq;
 	unsigned long tag_mask;
+	bool shared;
 	int i, nr = 0;
 
 	tag_mask = blk_mq_get_tags(data, data->nr_tags, &tag_offset);
@@ -451,6 +452,7 @@ __blk_mq_alloc_requests_batch(struct blk_mq_alloc_data *data,
 		return NULL;
 
 	tags = blk_mq_tags_from_data(data);
+	shared = data->hctx->flags & BLK_MQ_F_TAG_QUEUE_SHARED;
 	for (i = 0; tag_mask; i++) {
 		if (!(tag_mask & (1UL << i)))
 			continue;
@@ -458,9 +460,18 @@ __blk_mq_alloc_requests_batch(struct blk_mq_alloc_data *data,
 		prefetch(tags->static_rqs[tag]);
 		tag_mask &= ~(1UL << i);
 		rq = blk_mq_rq_ctx_init(data, tags, tag, alloc_time_ns);
+		if (shared)
+			rq->rq_flags |= RQF_MQ_INFLIGHT;
 		rq_list_add(data->cached_rq, rq);
 		nr++;
 	}
+	/*
+	 * Account the whole batch as active with a single atomic instead of
+	 * one per request in __blk_mq_get_driver_tag(). Unused cached requests
+	 * drop it again when freed.
+	 */
+	if (shared)
+		__blk_mq_add_active_requests(data->hctx, nr);
 	/* caller already holds a reference, add for remainder */
 	percpu_ref_get_many(&data->q->q_usage_counter, nr - 1);
 	data->nr_tags -= nr;
@@ -221,12 +221,18 @@ static inline int blk_mq_get_rq_budget_token(struct request *rq)
 	return -1;
 }
 
-static inline void __blk_mq_inc_active_requests(struct blk_mq_hw_ctx *hctx)
+static inline void __blk_mq_add_active_requests(struct blk_mq_hw_ctx *hctx,
+		int val)
 {
 	if (blk_mq_is_shared_tags(hctx->flags))
-		atomic_inc(&hctx->queue->nr_active_requests_shared_tags);
+		atomic_add(val, &hctx->queue->nr_active_requests_shared_tags);
 	else
-		atomic_inc(&hctx->nr_active);
+		atomic_add(val, &hctx->nr_active);
+}
+
+static inline void __blk_mq_inc_active_requests(struct blk_mq_hw_ctx *hctx)
+{
+	__blk_mq_add_active_requests(hctx, 1);
 }
 
 static inline void __blk_mq_sub_active_requests(struct blk_mq_hw_ctx *hctx,
@@ -337,41 +343,50 @@ static inline void blk_mq_free_requests(struct list_head *list)
 /*
  * For shared tag users, we track the number of currently active users
  * and attempt to provide a fair share of the tag depth for each of them.
+ * Returns how many more tags @hctx may take from @bt, UINT_MAX if it isn't
+ * limited.
  */
-static inline bool hctx_may_queue(struct blk_mq_hw_ctx *hctx,
-				  struct sbitmap_queue *bt)
+static inline unsigned int hctx_tag_budget(struct blk_mq_hw_ctx *hctx,
+					   struct sbitmap_queue *bt)
 {
-	unsigned int depth, users;
+	unsigned int depth, users, active;
 
 	if (!hctx || !(hctx->flags & BLK_MQ_F_TAG_QUEUE_SHARED))
-		return true;
+		return UINT_MAX;
 
 	/*
 	 * Don't try dividing an ant
 	 */
 	if (bt->sb.depth == 1)
-		return true;
+		return UINT_MAX;
 
 	if (blk_mq_is_shared_tags(hctx->flags)) {
 		struct request_queue *q = hctx->queue;
 
 		if (!test_bit(QUEUE_FLAG_HCTX_ACTIVE, &q->queue_flags))
-			return true;
+			return UINT_MAX;
 	} else {
 		if (!test_bit(BLK_MQ_S_TAG_ACTIVE, &hctx->state))
-			return true;
+			return UINT_MAX;
 	}
 
 	users = atomic_read(&hctx->tags->active_queues);
 
 	if (!users)
-		return true;
+		return UINT_MAX;
 
 	/*
 	 * Allow at least some tags
 	 */
 	depth = max((bt->sb.depth + users - 1) / users, 4U);
-	return __blk_mq_active_requests(hctx) < depth;
+	active = __blk_mq_active_requests(hctx);
+	return active < depth ? depth - active : 0;
+}
+
+static inline bool hctx_may_queue(struct blk_mq_hw_ctx *hctx,
+				  struct sbitmap_queue *bt)
+{
+	return hctx_tag_budget(hctx, bt) > 0;
 }
 
 /* run the code block in @dispatch_ops with rcu/srcu read lock held */
@@ -105,6 +105,15 @@ struct deadline_data {
 
 	spinlock_t lock;
 	spinlock_t zone_lock;
+
+	/*
+	 * Newly inserted requests, moved onto the per-priority lists by the
+	 * next dispatch. Protected by insert_lock so that submitters don't
+	 * contend on dd->lock with the dispatcher.
+	 */
+	spinlock_t insert_lock;
+	struct list_head at_head;
+	struct list_head at_tail;
 };
 
 /* Maps an I/O priority class to a deadline scheduler priority. */
@@ -561,6 +570,8 @@ static struct request *dd_dispatch_prio_aged_requests(struct deadline_data *dd,
 	return NULL;
 }
 
+static void dd_do_insert(struct blk_mq_hw_ctx *hctx, struct deadline_data *dd);
+
 /*
  * Called from blk_mq_run_hw_queue() -> __blk_mq_sched_dispatch_requests().
  *
@@ -577,6 +588,7 @@ static struct request *dd_dispatch_request(struct blk_mq_hw_ctx *hctx)
 	enum dd_prio prio;
 
 	spin_lock(&dd->lock);
+	dd_do_insert(hctx, dd);
 	rq = dd_dispatch_prio_aged_requests(dd, now);
 	if (rq)
 		goto unlock;
@@ -640,6 +652,9 @@ static void dd_exit_sched(struct elevator_queue *e)
 	struct deadline_data *dd = e->elevator_data;
 	enum dd_prio prio;
 
+	WARN_ON_ONCE(!list_empty(&dd->at_head));
+	WARN_ON_ONCE(!list_empty(&dd->at_tail));
+
 	for (prio = 0; prio <= DD_PRIO_MAX; prio++) {
 		struct dd_per_prio *per_prio = &dd->per_prio[prio];
 		const struct io_stats_per_prio *stats = &per_prio->stats;
@@ -699,6 +714,9 @@ static int dd_init_sched(struct request_queue *q, struct elevator_type *e)
 	dd->prio_aging_expire = prio_aging_expire;
 	spin_lock_init(&dd->lock);
 	spin_lock_init(&dd->zone_lock);
+	spin_lock_init(&dd->insert_lock);
+	INIT_LIST_HEAD(&dd->at_head);
+	INIT_LIST_HEAD(&dd->at_tail);
 
 	/* We dispatch from request queue wide instead of hw queue */
 	blk_queue_flag_set(QUEUE_FLAG_SQ_SCHED, q);
@@ -754,7 +772,12 @@ static bool dd_bio_merge(struct request_queue *q, struct bio *bio,
 	struct request *free = NULL;
 	bool ret;
 
-	spin_lock(&dd->lock);
+	/*
+	 * Merging is opportunistic, don't add to dd->lock contention for it.
+	 * If the lock is busy, the bio simply gets a request of its own.
+	 */
+	if (!spin_trylock(&dd->lock))
+		return false;
 	ret = blk_mq_sched_try_merge(q, bio, nr_segs, &free);
 	spin_unlock(&dd->lock);
 
@@ -823,6 +846,8 @@ static void dd_insert_request(struct blk_mq_hw_ctx *hctx, struct request *rq,
 
 /*
  * Called from blk_mq_sched_insert_request() or blk_mq_sched_insert_requests().
+ * Only queue the requests here, dd_do_insert() sorts them into the scheduler
+ * lists from the dispatch path.
  */
 static void dd_insert_requests(struct blk_mq_hw_ctx *hctx,
 			       struct list_head *list, bool at_head)
@@ -830,15 +855,44 @@ static void dd_insert_requests(struct blk_mq_hw_ctx *hctx,
 	struct request_queue *q = hctx->queue;
 	struct deadline_data *dd = q->elevator->elevator_data;
 
-	spin_lock(&dd->lock);
-	while (!list_empty(list)) {
+	spin_lock(&dd->insert_lock);
+	list_splice_tail_init(list, at_head ? &dd->at_head : &dd->at_tail);
+	spin_unlock(&dd->insert_lock);
+}
+
+/*
+ * Move the requests queued by dd_insert_requests() onto the scheduler lists,
+ * in the order they would have been inserted there directly.
+ */
+static void dd_do_insert(struct blk_mq_hw_ctx *hctx, struct deadline_data *dd)
+{
+	LIST_HEAD(at_head);
+	LIST_HEAD(at_tail);
+
+	lockdep_assert_held(&dd->lock);
+
+	if (list_empty_careful(&dd->at_head) && list_empty_careful(&dd->at_tail))
+		return;
+
+	spin_lock(&dd->insert_lock);
+	list_splice_init(&dd->at_head, &at_head);
+	list_splice_init(&dd->at_tail, &at_tail);
+	spin_unlock(&dd->insert_lock);
+
+	while (!list_empty(&at_head)) {
 		struct request *rq;
 
-		rq = list_first_entry(list, struct request, queuelist);
+		rq = list_first_entry(&at_head, struct request, queuelist);
 		list_del_init(&rq->queuelist);
-		dd_insert_request(hctx, rq, at_head);
+		dd_insert_request(hctx, rq, true);
+	}
+	while (!list_empty(&at_tail)) {
+		struct request *rq;
+
+		rq = list_first_entry(&at_tail, struct request, queuelist);
+		list_del_init(&rq->queuelist);
+		dd_insert_request(hctx, rq, false);
 	}
-	spin_unlock(&dd->lock);
 }
 
 /* Callback from inside blk_mq_rq_ctx_init(). */
@@ -856,7 +910,9 @@ static bool dd_has_write_work(struct blk_mq_hw_ctx *hctx)
 		if (!list_empty_careful(&dd->per_prio[p].fifo_list[DD_WRITE]))
 			return true;
 
-	return false;
+	/* not sorted yet, may hold writes */
+	return !list_empty_careful(&dd->at_head) ||
+		!list_empty_careful(&dd->at_tail);
 }
 
 /*
@@ -917,6 +973,10 @@ static bool dd_has_work(struct blk_mq_hw_ctx *hctx)
 	struct deadline_data *dd = hctx->queue->elevator->elevator_data;
 	enum dd_prio prio;
 
+	if (!list_empty_careful(&dd->at_head) ||
+	    !list_empty_careful(&dd->at_tail))
+		return true;
+
 	for (prio = 0; prio <= DD_PRIO_MAX; prio++)
 		if (dd_has_work_for_prio(&dd->per_prio[prio]))
 			return true;
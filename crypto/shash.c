@@ -184,6 +184,52 @@ int crypto_shash_finup(struct shash_desc *desc, const u8 *data,
 }
 EXPORT_SYMBOL_GPL(crypto_shash_finup);
 
+static int shash_finup_mb_fallback(struct shash_desc *desc,
+				   const u8 * const data[], unsigned int len,
+				   u8 * const outs[], unsigned int num_msgs)
+{
+	struct crypto_shash *tfm = desc->tfm;
+	SHASH_DESC_ON_STACK(desc2, tfm);
+	unsigned int i;
+	int err = 0;
+
+	for (i = 0; i < num_msgs && !err; i++) {
+		desc2->tfm = tfm;
+		memcpy(shash_desc_ctx(desc2), shash_desc_ctx(desc),
+		       crypto_shash_descsize(tfm));
+		err = crypto_shash_finup(desc2, data[i], len, outs[i]);
+	}
+
+	shash_desc_zero(desc2);
+	return err;
+}
+
+int crypto_shash_finup_mb(struct shash_desc *desc, const u8 * const data[],
+			  unsigned int len, u8 * const outs[],
+			  unsigned int num_msgs)
+{
+	struct crypto_shash *tfm = desc->tfm;
+	struct shash_alg *shash = crypto_shash_alg(tfm);
+	unsigned long alignmask = crypto_shash_alignmask(tfm);
+	unsigned int i;
+
+	if (num_msgs < 2 || num_msgs > shash->mb_max_msgs)
+		goto fallback;
+
+	if (alignmask) {
+		for (i = 0; i < num_msgs; i++)
+			if (((unsigned long)data[i] | (unsigned long)outs[i]) &
+			    alignmask)
+				goto fallback;
+	}
+
+	return shash->finup_mb(desc, data, len, outs, num_msgs);
+
+fallback:
+	return shash_finup_mb_fallback(desc, data, len, outs, num_msgs);
+}
+EXPORT_SYMBOL_GPL(crypto_shash_finup_mb);
+
 static int shash_digest_unaligned(struct shash_desc *desc, const u8 *data,
 				  unsigned int len, u8 *out)
 {
@@ -532,6 +578,9 @@ static int shash_prepare_alg(struct shash_alg *alg)
 	if ((alg->export && !alg->import) || (alg->import && !alg->export))
 		return -EINVAL;
 
+	if (alg->mb_max_msgs > 1 && !alg->finup_mb)
+		return -EINVAL;
+
 	base->cra_type = &crypto_shash_type;
 	base->cra_flags &= ~CRYPTO_ALG_TYPE_MASK;
 	base->cra_flags |= CRYPTO_ALG_TYPE_SHASH;
@@ -547,6 +596,8 @@ static int shash_prepare_alg(struct shash_alg *alg)
 	}
 	if (!alg->setkey)
 		alg->setkey = shash_no_setkey;
+	if (!alg->mb_max_msgs)
+		alg->mb_max_msgs = 1;
 
 	return 0;
 }
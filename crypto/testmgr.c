@@ -1258,6 +1258,76 @@ static inline int check_shash_op(const char *op, int err,
 	return err;
 }
 
+/*
+ * Check that finup_mb() gives the same digests as finup() of each message.
+ * The messages differ in their first byte, so that mixing them up is caught.
+ * @desc is the state before the last update and must not be modified.
+ */
+static int test_shash_finup_mb(struct shash_desc *desc, const u8 *data,
+			       unsigned int len, const char *driver,
+			       const char *vec_name,
+			       const struct testvec_config *cfg)
+{
+	struct crypto_shash *tfm = desc->tfm;
+	const unsigned int num_msgs = crypto_shash_mb_max_msgs(tfm);
+	const unsigned int digestsize = crypto_shash_digestsize(tfm);
+	SHASH_DESC_ON_STACK(desc2, tfm);
+	const u8 **msgs;
+	u8 **outs;
+	u8 *bufs, *expected;
+	unsigned int i;
+	int err;
+
+	msgs = kcalloc(num_msgs, sizeof(*msgs) + sizeof(*outs), GFP_KERNEL);
+	bufs = kmalloc_array(num_msgs, len + 2 * digestsize, GFP_KERNEL);
+	if (!msgs || !bufs) {
+		err = -ENOMEM;
+		goto out;
+	}
+	outs = (u8 **)(msgs + num_msgs);
+	expected = bufs + num_msgs * (len + digestsize);
+
+	for (i = 0; i < num_msgs; i++) {
+		u8 *msg = bufs + i * len;
+
+		memcpy(msg, data, len);
+		if (len)
+			msg[0] ^= i;
+		msgs[i] = msg;
+		outs[i] = bufs + num_msgs * len + i * digestsize;
+	}
+
+	if (cfg->nosimd)
+		crypto_disable_simd_for_test();
+	err = crypto_shash_finup_mb(desc, msgs, len, outs, num_msgs);
+	if (cfg->nosimd)
+		crypto_reenable_simd_for_test();
+	err = check_shash_op("finup_mb", err, driver, vec_name, cfg);
+	if (err)
+		goto out;
+
+	for (i = 0; i < num_msgs; i++) {
+		desc2->tfm = tfm;
+		memcpy(shash_desc_ctx(desc2), shash_desc_ctx(desc),
+		       crypto_shash_descsize(tfm));
+		err = crypto_shash_finup(desc2, msgs[i], len, expected);
+		err = check_shash_op("finup", err, driver, vec_name, cfg);
+		if (err)
+			goto out;
+		if (memcmp(outs[i], expected, digestsize)) {
+			pr_err("alg: shash: %s finup_mb() message %u differs from finup() on test vector %s, cfg=\"%s\"\n",
+			       driver, i, vec_name, cfg->name);
+			err = -EINVAL;
+			goto out;
+		}
+	}
+out:
+	shash_desc_zero(desc2);
+	kfree(bufs);
+	kfree(msgs);
+	return err;
+}
+
 /* Test one hash test vector in one configuration, using the shash API */
 static int test_shash_vec_cfg(const struct hash_testvec *vec,
 			      const char *vec_name,
@@ -1349,6 +1419,15 @@ static int test_shash_vec_cfg(const struct hash_testvec *vec,
 	for (i = 0; i < tsgl->nents; i++) {
 		if (i + 1 == tsgl->nents &&
 		    cfg->finalization_type == FINALIZATION_TYPE_FINUP) {
+			if (crypto_shash_mb_max_msgs(tfm) > 1) {
+				err = test_shash_finup_mb(desc,
+							  sg_virt(&tsgl->sgl[i]),
+							  tsgl->sgl[i].length,
+							  driver, vec_name,
+							  cfg);
+				if (err)
+					return err;
+			}
 			if (divs[i]->nosimd)
 				crypto_disable_simd_for_test();
 			err = crypto_shash_finup(desc, sg_virt(&tsgl->sgl[i]),
@@ -81,6 +81,7 @@ struct loop_device {
 struct loop_cmd {
 	struct list_head list_entry;
 	bool use_aio; /* use AIO interface to handle I/O */
+	bool nowait_again; /* NOWAIT attempt got -EAGAIN, punt to worker */
 	atomic_t ref; /* only for aio */
 	long ret;
 	struct kiocb iocb;
@@ -341,6 +342,18 @@ static void lo_complete_rq(struct request *rq)
 	struct loop_cmd *cmd = blk_mq_rq_to_pdu(rq);
 	blk_status_t ret = BLK_STS_OK;
 
+	/*
+	 * The backing file may also fail a NOWAIT submission from its
+	 * completion path, retry the whole request from the worker.
+	 */
+	if (cmd->use_aio && cmd->ret == -EAGAIN &&
+	    (cmd->iocb.ki_flags & IOCB_NOWAIT)) {
+		cmd->ret = 0;
+		cmd->nowait_again = true;
+		blk_mq_requeue_request(rq, true);
+		return;
+	}
+
 	if (!cmd->use_aio || cmd->ret < 0 || cmd->ret == blk_rq_bytes(rq) ||
 	    req_op(rq) != REQ_OP_READ) {
 		if (cmd->ret < 0)
@@ -392,7 +405,7 @@ static void lo_rw_aio_complete(struct kiocb *iocb, long ret)
 }
 
 static int lo_rw_aio(struct loop_device *lo, struct loop_cmd *cmd,
-		     loff_t pos, int rw)
+		     loff_t pos, int rw, bool nowait)
 {
 	struct iov_iter iter;
 	struct req_iterator rq_iter;
@@ -446,6 +459,8 @@ static int lo_rw_aio(struct loop_device *lo, struct loop_cmd *cmd,
 	cmd->iocb.ki_filp = file;
 	cmd->iocb.ki_complete = lo_rw_aio_complete;
 	cmd->iocb.ki_flags = IOCB_DIRECT;
+	if (nowait)
+		cmd->iocb.ki_flags |= IOCB_NOWAIT;
 	cmd->iocb.ki_ioprio = IOPRIO_PRIO_VALUE(IOPRIO_CLASS_NONE, 0);
 
 	if (rw == ITER_SOURCE)
@@ -453,6 +468,13 @@ static int lo_rw_aio(struct loop_device *lo, struct loop_cmd *cmd,
 	else
 		ret = call_read_iter(file, &cmd->iocb, &iter);
 
+	/* nothing was issued, the caller hands the request to the worker */
+	if (nowait && ret == -EAGAIN) {
+		kfree(cmd->bvec);
+		cmd->bvec = NULL;
+		return -EAGAIN;
+	}
+
 	lo_rw_aio_do_completion(cmd);
 
 	if (ret != -EIOCBQUEUED)
@@ -490,12 +512,12 @@ static int do_req_filebacked(struct loop_device *lo, struct request *rq)
 		return lo_fallocate(lo, rq, pos, FALLOC_FL_PUNCH_HOLE);
 	case REQ_OP_WRITE:
 		if (cmd->use_aio)
-			return lo_rw_aio(lo, cmd, pos, ITER_SOURCE);
+			return lo_rw_aio(lo, cmd, pos, ITER_SOURCE, false);
 		else
 			return lo_write_simple(lo, rq, pos);
 	case REQ_OP_READ:
 		if (cmd->use_aio)
-			return lo_rw_aio(lo, cmd, pos, ITER_DEST);
+			return lo_rw_aio(lo, cmd, pos, ITER_DEST, false);
 		else
 			return lo_read_simple(lo, rq, pos);
 	default:
@@ -1805,6 +1827,102 @@ static const struct kernel_param_ops loop_hw_qdepth_param_ops = {
 device_param_cb(hw_queue_depth, &loop_hw_qdepth_param_ops, &hw_queue_depth, 0444);
 MODULE_PARM_DESC(hw_queue_depth, "Queue depth for each hardware queue. Default: 128");
 
+static unsigned int nr_hw_queues = 1;
+
+static int loop_set_nr_hw_queues(const char *s, const struct kernel_param *p)
+{
+	int ret = kstrtouint(s, 10, &nr_hw_queues);
+
+	return (ret || !nr_hw_queues || nr_hw_queues > nr_cpu_ids) ?
+		-EINVAL : 0;
+}
+
+static const struct kernel_param_ops loop_nr_hw_queues_param_ops = {
+	.set	= loop_set_nr_hw_queues,
+	.get	= param_get_uint,
+};
+
+device_param_cb(nr_hw_queues, &loop_nr_hw_queues_param_ops, &nr_hw_queues, 0444);
+MODULE_PARM_DESC(nr_hw_queues, "Number of hardware queues. Default: 1");
+
+static bool nowait_dio;
+module_param(nowait_dio, bool, 0444);
+MODULE_PARM_DESC(nowait_dio, "Issue direct I/O with NOWAIT from the submitter. Default: false");
+
+#ifdef CONFIG_BLK_CGROUP
+static inline bool loop_css_is_current(struct cgroup_subsys_state *css)
+{
+	bool ret;
+
+	rcu_read_lock();
+	ret = css == task_css(current, io_cgrp_id);
+	rcu_read_unlock();
+	return ret;
+}
+#else
+static inline bool loop_css_is_current(struct cgroup_subsys_state *css)
+{
+	return false;
+}
+#endif
+
+/*
+ * Direct I/O to a backing file that supports NOWAIT can be issued straight
+ * from ->queue_rq(), which saves the hop through the worker and lets a
+ * plugged batch of requests reach the backing file back to back.  This is
+ * only done when the I/O would be attributed to the same blkcg as the
+ * worker would use, and when no bvec table has to be allocated.
+ *
+ * Devices are only set up for this with the nowait_dio parameter, as the
+ * backing filesystem may sleep and ->queue_rq() then has to be allowed to
+ * block.
+ */
+static bool loop_can_queue_nowait(struct loop_device *lo, struct loop_cmd *cmd)
+{
+	struct request *rq = blk_mq_rq_from_pdu(cmd);
+
+	if (!(lo->tag_set.flags & BLK_MQ_F_BLOCKING))
+		return false;
+	if (!cmd->use_aio || cmd->nowait_again)
+		return false;
+	if (!(lo->lo_backing_file->f_mode & FMODE_NOWAIT))
+		return false;
+	if (op_is_write(req_op(rq)) && (lo->lo_flags & LO_FLAGS_READ_ONLY))
+		return false;
+	if (rq->bio != rq->biotail)
+		return false;
+	return !cmd->blkcg_css || loop_css_is_current(cmd->blkcg_css);
+}
+
+static bool loop_queue_nowait(struct loop_device *lo, struct loop_cmd *cmd)
+{
+	struct request *rq = blk_mq_rq_from_pdu(cmd);
+	loff_t pos = ((loff_t) blk_rq_pos(rq) << 9) + lo->lo_offset;
+	struct cgroup_subsys_state *cmd_memcg_css = cmd->memcg_css;
+	struct mem_cgroup *old_memcg = NULL;
+	unsigned int noio_flag;
+	int ret;
+
+	noio_flag = memalloc_noio_save();
+	if (cmd_memcg_css)
+		old_memcg = set_active_memcg(
+			mem_cgroup_from_css(cmd_memcg_css));
+
+	ret = lo_rw_aio(lo, cmd, pos, op_is_write(req_op(rq)) ?
+			ITER_SOURCE : ITER_DEST, true);
+
+	if (cmd_memcg_css)
+		set_active_memcg(old_memcg);
+	memalloc_noio_restore(noio_flag);
+
+	if (ret == -EAGAIN)
+		return false;
+
+	if (cmd_memcg_css)
+		css_put(cmd_memcg_css);
+	return true;
+}
+
 MODULE_LICENSE("GPL");
 MODULE_ALIAS_BLOCKDEV_MAJOR(LOOP_MAJOR);
 
@@ -1846,6 +1964,10 @@ static blk_status_t loop_queue_rq(struct blk_mq_hw_ctx *hctx,
 #endif
 	}
 #endif
+	if (loop_can_queue_nowait(lo, cmd) && loop_queue_nowait(lo, cmd))
+		return BLK_STS_OK;
+
+	cmd->nowait_again = false;
 	loop_queue_work(lo, cmd);
 
 	return BLK_STS_OK;
@@ -1986,12 +2108,15 @@ static int loop_add(int i)
 	i = err;
 
 	lo->tag_set.ops = &loop_mq_ops;
-	lo->tag_set.nr_hw_queues = 1;
+	lo->tag_set.nr_hw_queues = nr_hw_queues;
 	lo->tag_set.queue_depth = hw_queue_depth;
 	lo->tag_set.numa_node = NUMA_NO_NODE;
 	lo->tag_set.cmd_size = sizeof(struct loop_cmd);
 	lo->tag_set.flags = BLK_MQ_F_SHOULD_MERGE | BLK_MQ_F_STACKING |
 		BLK_MQ_F_NO_SCHED_BY_DEFAULT;
+	/* ->queue_rq() may sleep when issuing NOWAIT direct I/O inline */
+	if (nowait_dio)
+		lo->tag_set.flags |= BLK_MQ_F_BLOCKING;
 	lo->tag_set.driver_data = lo;
 
 	err = blk_mq_alloc_tag_set(&lo->tag_set);
@@ -220,6 +220,9 @@ struct global_params {
  * @last_io_update:	Last time when IO wake flag was set
  * @sched_flags:	Store scheduler flags for possible cross CPU update
  * @hwp_boost_min:	Last HWP boosted min performance
+ * @hwp_hint_min:	HWP min performance from scheduler hints
+ * @hwp_hint_epp:	HWP EPP from scheduler hints, or -EINVAL
+ * @hwp_req_boosted:	Last HWP Request MSR written by boost or hints
  * @suspended:		Whether or not the driver has been suspended.
  * @hwp_notify_work:	workqueue for HWP notifications.
  *
@@ -259,6 +262,9 @@ struct cpudata {
 	u64 last_io_update;
 	unsigned int sched_flags;
 	u32 hwp_boost_min;
+	u32 hwp_hint_min;
+	s16 hwp_hint_epp;
+	u64 hwp_req_boosted;
 	bool suspended;
 	struct delayed_work hwp_notify_work;
 };
@@ -298,6 +304,7 @@ static int hwp_active __read_mostly;
 static int hwp_mode_bdw __read_mostly;
 static bool per_cpu_limits __read_mostly;
 static bool hwp_boost __read_mostly;
+static bool hwp_sched_hints __read_mostly;
 static bool hwp_forced __read_mostly;
 
 static struct cpufreq_driver *intel_pstate_driver __read_mostly;
@@ -724,6 +731,8 @@ static int intel_pstate_set_epp(struct cpudata *cpu, u32 epp)
 	ret = wrmsrl_on_cpu(cpu->cpu, MSR_HWP_REQUEST, value);
 	if (!ret)
 		cpu->epp_cached = epp;
+	/* Make boost and scheduler hints, if any, apply again */
+	WRITE_ONCE(cpu->hwp_req_boosted, 0);
 
 	return ret;
 }
@@ -982,6 +991,8 @@ static void intel_pstate_hwp_set(unsigned int cpu)
 skip_epp:
 	WRITE_ONCE(cpu_data->hwp_req_cached, value);
 	wrmsrl_on_cpu(cpu, MSR_HWP_REQUEST, value);
+	/* Make boost and scheduler hints, if any, apply again */
+	WRITE_ONCE(cpu_data->hwp_req_boosted, 0);
 }
 
 static void intel_pstate_disable_hwp_interrupt(struct cpudata *cpudata);
@@ -1433,6 +1444,31 @@ static ssize_t store_hwp_dynamic_boost(struct kobject *a,
 	return count;
 }
 
+static ssize_t show_hwp_sched_hints(struct kobject *kobj,
+				    struct kobj_attribute *attr, char *buf)
+{
+	return sprintf(buf, "%u\n", hwp_sched_hints);
+}
+
+static ssize_t store_hwp_sched_hints(struct kobject *a,
+				     struct kobj_attribute *b,
+				     const char *buf, size_t count)
+{
+	unsigned int input;
+	int ret;
+
+	ret = kstrtouint(buf, 10, &input);
+	if (ret)
+		return ret;
+
+	mutex_lock(&intel_pstate_driver_lock);
+	hwp_sched_hints = !!input;
+	intel_pstate_update_policies();
+	mutex_unlock(&intel_pstate_driver_lock);
+
+	return count;
+}
+
 static ssize_t show_energy_efficiency(struct kobject *kobj, struct kobj_attribute *attr,
 				      char *buf)
 {
@@ -1469,6 +1505,7 @@ define_one_global_rw(min_perf_pct);
 define_one_global_ro(turbo_pct);
 define_one_global_ro(num_pstates);
 define_one_global_rw(hwp_dynamic_boost);
+define_one_global_rw(hwp_sched_hints);
 define_one_global_rw(energy_efficiency);
 
 static struct attribute *intel_pstate_attributes[] = {
@@ -1557,6 +1594,9 @@ static void intel_pstate_sysfs_expose_hwp_dynamic_boost(void)
 
 	rc = sysfs_create_file(intel_pstate_kobject, &hwp_dynamic_boost.attr);
 	WARN_ON_ONCE(rc);
+
+	rc = sysfs_create_file(intel_pstate_kobject, &hwp_sched_hints.attr);
+	WARN_ON_ONCE(rc);
 }
 
 static void intel_pstate_sysfs_hide_hwp_dynamic_boost(void)
@@ -1565,6 +1605,7 @@ static void intel_pstate_sysfs_hide_hwp_dynamic_boost(void)
 		return;
 
 	sysfs_remove_file(intel_pstate_kobject, &hwp_dynamic_boost.attr);
+	sysfs_remove_file(intel_pstate_kobject, &hwp_sched_hints.attr);
 }
 
 /************************** sysfs end ************************/
@@ -2033,6 +2074,31 @@ static void intel_pstate_get_cpu_pstates(struct cpudata *cpu)
  */
 static int hwp_boost_hold_time_ns = 3 * NSEC_PER_MSEC;
 
+/*
+ * Write the cached HWP request with the min performance raised to the boost
+ * and scheduler hint levels and the EPP lowered to the hint level, skipping
+ * the MSR write if that is what was written last time.
+ */
+static inline void intel_pstate_hwp_write_boosted(struct cpudata *cpu)
+{
+	u64 hwp_req = READ_ONCE(cpu->hwp_req_cached);
+	u32 min_perf = max(cpu->hwp_boost_min, cpu->hwp_hint_min);
+
+	if (min_perf > HWP_MIN_PERF(hwp_req))
+		hwp_req = (hwp_req & ~GENMASK_ULL(7, 0)) | min_perf;
+
+	if (cpu->hwp_hint_epp >= 0 &&
+	    cpu->hwp_hint_epp < ((hwp_req >> 24) & 0xff))
+		hwp_req = (hwp_req & ~GENMASK_ULL(31, 24)) |
+			  HWP_ENERGY_PERF_PREFERENCE(cpu->hwp_hint_epp);
+
+	if (hwp_req == cpu->hwp_req_boosted)
+		return;
+
+	cpu->hwp_req_boosted = hwp_req;
+	wrmsrl(MSR_HWP_REQUEST, hwp_req);
+}
+
 static inline void intel_pstate_hwp_boost_up(struct cpudata *cpu)
 {
 	u64 hwp_req = READ_ONCE(cpu->hwp_req_cached);
@@ -2075,8 +2141,7 @@ static inline void intel_pstate_hwp_boost_up(struct cpudata *cpu)
 	else
 		return;
 
-	hwp_req = (hwp_req & ~GENMASK_ULL(7, 0)) | cpu->hwp_boost_min;
-	wrmsrl(MSR_HWP_REQUEST, hwp_req);
+	intel_pstate_hwp_write_boosted(cpu);
 	cpu->last_update = cpu->sample.time;
 }
 
@@ -2089,18 +2154,61 @@ static inline void intel_pstate_hwp_boost_down(struct cpudata *cpu)
 		expired = time_after64(cpu->sample.time, cpu->last_update +
 				       hwp_boost_hold_time_ns);
 		if (expired) {
-			wrmsrl(MSR_HWP_REQUEST, cpu->hwp_req_cached);
 			cpu->hwp_boost_min = 0;
+			intel_pstate_hwp_write_boosted(cpu);
 		}
 	}
 	cpu->last_update = cpu->sample.time;
 }
 
+/*
+ * Map the minimum utilization the scheduler requests for the CPU, from the
+ * uclamp min of the runnable tasks and their cgroups or from the latency nice
+ * value of the current task, to HWP min performance and EPP.  The requested
+ * utilization only changes when such tasks come and go, so the MSR is not
+ * written on every update.
+ */
+static inline void intel_pstate_hwp_sched_hints(struct cpudata *cpu)
+{
+	u64 hwp_req = READ_ONCE(cpu->hwp_req_cached);
+	unsigned long util_min = cpufreq_get_util_min(cpu->cpu);
+	u32 max_limit = (hwp_req & 0xff00) >> 8;
+
+	if (!util_min) {
+		cpu->hwp_hint_min = 0;
+		cpu->hwp_hint_epp = -EINVAL;
+	} else {
+		cpu->hwp_hint_min = DIV_ROUND_UP(util_min * max_limit,
+						 SCHED_CAPACITY_SCALE);
+		/* Full utilization clamp means EPP 0, i.e. performance */
+		if (boot_cpu_has(X86_FEATURE_HWP_EPP))
+			cpu->hwp_hint_epp = ((hwp_req >> 24) & 0xff) *
+					    (SCHED_CAPACITY_SCALE - util_min) /
+					    SCHED_CAPACITY_SCALE;
+	}
+
+	intel_pstate_hwp_write_boosted(cpu);
+}
+
 static inline void intel_pstate_update_util_hwp_local(struct cpudata *cpu,
 						      u64 time)
 {
 	cpu->sample.time = time;
 
+	/* Either may have been turned off while raising the HWP request */
+	if (!hwp_boost)
+		cpu->hwp_boost_min = 0;
+
+	if (hwp_sched_hints) {
+		intel_pstate_hwp_sched_hints(cpu);
+	} else {
+		cpu->hwp_hint_min = 0;
+		cpu->hwp_hint_epp = -EINVAL;
+	}
+
+	if (!hwp_boost)
+		return;
+
 	if (cpu->sched_flags & SCHED_CPUFREQ_IOWAIT) {
 		bool do_io = false;
 
@@ -2441,6 +2549,7 @@ static int intel_pstate_init_cpu(unsigned int cpunum)
 
 	cpu->epp_powersave = -EINVAL;
 	cpu->epp_policy = 0;
+	cpu->hwp_hint_epp = -EINVAL;
 
 	intel_pstate_get_cpu_pstates(cpu);
 
@@ -2453,7 +2562,7 @@ static void intel_pstate_set_update_util_hook(unsigned int cpu_num)
 {
 	struct cpudata *cpu = all_cpu_data[cpu_num];
 
-	if (hwp_active && !hwp_boost)
+	if (hwp_active && !hwp_boost && !hwp_sched_hints)
 		return;
 
 	if (cpu->update_util_set)
@@ -2580,11 +2689,11 @@ static int intel_pstate_set_policy(struct cpufreq_policy *policy)
 
 	if (hwp_active) {
 		/*
-		 * When hwp_boost was active before and dynamically it
-		 * was turned off, in that case we need to clear the
-		 * update util hook.
+		 * When hwp_boost or the scheduler hints were active before
+		 * and dynamically got turned off, in that case we need to
+		 * clear the update util hook.
 		 */
-		if (!hwp_boost)
+		if (!hwp_boost && !hwp_sched_hints)
 			intel_pstate_clear_update_util_hook(policy->cpu);
 		intel_pstate_hwp_set(policy->cpu);
 	}
@@ -0,0 +1,280 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * Wakeup source oriented CPU idle governor
+ */
+
+/**
+ * DOC: wakeup-description
+ *
+ * The menu and teo governors predict the upcoming idle duration from recent
+ * idle intervals, which works well as long as they are similar.  Request
+ * driven workloads often have bimodal idle intervals though: short ones when
+ * the next request (an I/O interrupt or an IPI from another CPU) comes in
+ * quickly, and long ones ending with a timer.  Averaging over both or only
+ * checking for a majority of early wakeups tends to select a deep idle state
+ * and to pay its exit latency on the request path.
+ *
+ * This governor handles the two kinds of wakeups separately.  A wakeup at or
+ * after the sleep length (the time till the closest timer event) is a timer
+ * wakeup, which the sleep length predicts by itself.  Any other wakeup is
+ * caused by a non-timer event and its measured idle duration is recorded.
+ *
+ * The last %NR_HIST wakeups of each CPU are kept.  If more than %NR_EARLY of
+ * them are non-timer wakeups, the idle duration is predicted as the duration
+ * of the (%NR_EARLY + 1)th shortest one of them, so that the target residency
+ * of the selected state would have been missed by at most %NR_EARLY of the
+ * recent wakeups.  Otherwise the sleep length is used.
+ *
+ * The deepest enabled idle state whose target residency does not exceed the
+ * prediction is selected, subject to the PM QoS latency limit for the CPU:
+ * both the global CPU latency QoS and the resume latency of the CPU device
+ * (power/pm_qos_resume_latency_us in sysfs), which latency sensitive services
+ * can set for the CPUs they run on.
+ */
+
+#include <linux/cpuidle.h>
+#include <linux/jiffies.h>
+#include <linux/kernel.h>
+#include <linux/sched/clock.h>
+#include <linux/tick.h>
+
+/* Number of the most recent wakeups to take into account. */
+#define NR_HIST		8
+
+/* Number of recent non-timer wakeups allowed to be shorter than predicted. */
+#define NR_EARLY	2
+
+/**
+ * struct wakeup_cpu - CPU data used by the wakeup cpuidle governor.
+ * @time_span_ns: Time between idle state selection and post-wakeup update.
+ * @sleep_length_ns: Time till the closest timer event (at the selection time).
+ * @hist_ns: Idle durations of recent wakeups, %U64_MAX for timer wakeups.
+ * @next_hist_idx: Index of the next @hist_ns entry to update.
+ */
+struct wakeup_cpu {
+	s64 time_span_ns;
+	s64 sleep_length_ns;
+	u64 hist_ns[NR_HIST];
+	int next_hist_idx;
+};
+
+static DEFINE_PER_CPU(struct wakeup_cpu, wakeup_cpus);
+
+/**
+ * wakeup_update - Record the last wakeup of a CPU.
+ * @drv: cpuidle driver containing state data.
+ * @dev: Target CPU.
+ */
+static void wakeup_update(struct cpuidle_driver *drv,
+			  struct cpuidle_device *dev)
+{
+	struct wakeup_cpu *cpu_data = per_cpu_ptr(&wakeup_cpus, dev->cpu);
+	u64 measured_ns;
+
+	if (cpu_data->time_span_ns >= cpu_data->sleep_length_ns) {
+		/* Timer wakeup, or one of the safety nets has triggered. */
+		measured_ns = U64_MAX;
+	} else {
+		u64 lat_ns = drv->states[dev->last_state_idx].exit_latency_ns;
+
+		/*
+		 * As in teo, take 1/2 of the exit latency as a rough
+		 * approximation of the average wakeup delay included in the
+		 * last residency.
+		 */
+		measured_ns = dev->last_residency_ns;
+		if (measured_ns >= lat_ns)
+			measured_ns -= lat_ns / 2;
+		else
+			measured_ns /= 2;
+	}
+
+	cpu_data->hist_ns[cpu_data->next_hist_idx++] = measured_ns;
+	if (cpu_data->next_hist_idx >= NR_HIST)
+		cpu_data->next_hist_idx = 0;
+}
+
+/**
+ * wakeup_predict - Predict the upcoming idle duration of a CPU.
+ * @cpu_data: Governor data of the CPU.
+ * @sleep_length_ns: Time till the closest timer event.
+ */
+static s64 wakeup_predict(struct wakeup_cpu *cpu_data, s64 sleep_length_ns)
+{
+	u64 early[NR_HIST];
+	int i, j, nr = 0;
+
+	/* Insertion sort of the non-timer wakeups, there are only a few. */
+	for (i = 0; i < NR_HIST; i++) {
+		u64 val = cpu_data->hist_ns[i];
+
+		if (val == U64_MAX)
+			continue;
+
+		for (j = nr++; j > 0 && early[j - 1] > val; j--)
+			early[j] = early[j - 1];
+		early[j] = val;
+	}
+
+	if (nr <= NR_EARLY || early[NR_EARLY] >= sleep_length_ns)
+		return sleep_length_ns;
+
+	return early[NR_EARLY];
+}
+
+/**
+ * wakeup_find_shallower_state - Find shallower idle state matching duration.
+ * @drv: cpuidle driver containing state data.
+ * @dev: Target CPU.
+ * @state_idx: Index of the capping idle state.
+ * @duration_ns: Idle duration value to match.
+ */
+static int wakeup_find_shallower_state(struct cpuidle_driver *drv,
+				       struct cpuidle_device *dev,
+				       int state_idx, s64 duration_ns)
+{
+	int i;
+
+	for (i = state_idx - 1; i >= 0; i--) {
+		if (dev->states_usage[i].disable)
+			continue;
+
+		state_idx = i;
+		if (drv->states[i].target_residency_ns <= duration_ns)
+			break;
+	}
+	return state_idx;
+}
+
+/**
+ * wakeup_select - Selects the next idle state to enter.
+ * @drv: cpuidle driver containing state data.
+ * @dev: Target CPU.
+ * @stop_tick: Indication on whether or not to stop the scheduler tick.
+ */
+static int wakeup_select(struct cpuidle_driver *drv, struct cpuidle_device *dev,
+			 bool *stop_tick)
+{
+	struct wakeup_cpu *cpu_data = per_cpu_ptr(&wakeup_cpus, dev->cpu);
+	s64 latency_req = cpuidle_governor_latency_req(dev->cpu);
+	ktime_t delta_tick;
+	s64 duration_ns;
+	int i, idx = -1;
+
+	if (dev->last_state_idx >= 0) {
+		wakeup_update(drv, dev);
+		dev->last_state_idx = -1;
+	}
+
+	cpu_data->time_span_ns = local_clock();
+
+	cpu_data->sleep_length_ns = tick_nohz_get_sleep_length(&delta_tick);
+	duration_ns = wakeup_predict(cpu_data, cpu_data->sleep_length_ns);
+
+	/*
+	 * If the tick is already stopped, nothing but the closest timer will
+	 * wake up a CPU staying in a shallow state for too long, so only go
+	 * by the sleep length then.
+	 */
+	if (tick_nohz_tick_stopped() && duration_ns < TICK_NSEC)
+		duration_ns = cpu_data->sleep_length_ns;
+
+	for (i = 0; i < drv->state_count; i++) {
+		struct cpuidle_state *s = &drv->states[i];
+
+		if (dev->states_usage[i].disable)
+			continue;
+
+		if (idx < 0) {
+			idx = i; /* first enabled state */
+			continue;
+		}
+
+		if (s->target_residency_ns > duration_ns ||
+		    s->exit_latency_ns > latency_req)
+			break;
+
+		idx = i;
+	}
+
+	if (idx < 0)
+		idx = 0; /* No states enabled, must use 0. */
+
+	/*
+	 * Don't stop the tick if the selected state is a polling one or if the
+	 * expected idle duration is shorter than the tick period length.
+	 */
+	if (((drv->states[idx].flags & CPUIDLE_FLAG_POLLING) ||
+	    duration_ns < TICK_NSEC) && !tick_nohz_tick_stopped()) {
+		*stop_tick = false;
+
+		/*
+		 * The tick is not going to be stopped, so if the target
+		 * residency of the state to be returned is not within the time
+		 * till the closest timer including the tick, try to correct
+		 * that.
+		 */
+		if (drv->states[idx].target_residency_ns > delta_tick)
+			idx = wakeup_find_shallower_state(drv, dev, idx,
+							  delta_tick);
+	}
+
+	return idx;
+}
+
+/**
+ * wakeup_reflect - Note that governor data for the CPU need to be updated.
+ * @dev: Target CPU.
+ * @state: Entered state.
+ */
+static void wakeup_reflect(struct cpuidle_device *dev, int state)
+{
+	struct wakeup_cpu *cpu_data = per_cpu_ptr(&wakeup_cpus, dev->cpu);
+
+	dev->last_state_idx = state;
+	/*
+	 * If the wakeup was not "natural", but triggered by one of the safety
+	 * nets, count it as a timer wakeup.
+	 */
+	if (dev->poll_time_limit ||
+	    (tick_nohz_idle_got_tick() && cpu_data->sleep_length_ns > TICK_NSEC)) {
+		dev->poll_time_limit = false;
+		cpu_data->time_span_ns = cpu_data->sleep_length_ns;
+	} else {
+		cpu_data->time_span_ns = local_clock() - cpu_data->time_span_ns;
+	}
+}
+
+/**
+ * wakeup_enable_device - Initialize the governor's data for the target CPU.
+ * @drv: cpuidle driver (not used).
+ * @dev: Target CPU.
+ */
+static int wakeup_enable_device(struct cpuidle_driver *drv,
+				struct cpuidle_device *dev)
+{
+	struct wakeup_cpu *cpu_data = per_cpu_ptr(&wakeup_cpus, dev->cpu);
+	int i;
+
+	memset(cpu_data, 0, sizeof(*cpu_data));
+
+	for (i = 0; i < NR_HIST; i++)
+		cpu_data->hist_ns[i] = U64_MAX;
+
+	return 0;
+}
+
+static struct cpuidle_governor wakeup_governor = {
+	.name =		"wakeup",
+	.rating =	15,
+	.enable =	wakeup_enable_device,
+	.select =	wakeup_select,
+	.reflect =	wakeup_reflect,
+};
+
+static int __init wakeup_governor_init(void)
+{
+	return cpuidle_register_governor(&wakeup_governor);
+}
+
+postcore_initcall(wakeup_governor_init);
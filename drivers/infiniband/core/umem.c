@@ -45,6 +45,9 @@
 
 #include "uverbs.h"
 
+/* Maximum number of pages pinned by one pin_user_pages_fast() call */
+#define IB_UMEM_PIN_BATCH (SZ_64K / sizeof(struct page *))
+
 static void __ib_umem_release(struct ib_device *dev, struct ib_umem *umem, int dirty)
 {
 	bool make_dirty = umem->writable && dirty;
@@ -154,7 +157,7 @@ struct ib_umem *ib_umem_get(struct ib_device *device, unsigned long addr,
 	unsigned long cur_base;
 	unsigned long dma_attr = 0;
 	struct mm_struct *mm;
-	unsigned long npages;
+	unsigned long npages, batch;
 	int pinned, ret;
 	unsigned int gup_flags = FOLL_LONGTERM;
 
@@ -187,16 +190,22 @@ struct ib_umem *ib_umem_get(struct ib_device *device, unsigned long addr,
 	umem->owning_mm = mm = current->mm;
 	mmgrab(mm);
 
-	page_list = (struct page **) __get_free_page(GFP_KERNEL);
-	if (!page_list) {
-		ret = -ENOMEM;
-		goto umem_kfree;
-	}
-
 	npages = ib_umem_num_pages(umem);
 	if (npages == 0 || npages > UINT_MAX) {
 		ret = -EINVAL;
-		goto out;
+		goto umem_kfree;
+	}
+
+	/*
+	 * Pin large batches, so that huge pages are taken as a whole by
+	 * pin_user_pages_fast() and few appends to the SG table are needed
+	 * to coalesce contiguous pages into large entries.
+	 */
+	batch = min_t(unsigned long, npages, IB_UMEM_PIN_BATCH);
+	page_list = kvmalloc_array(batch, sizeof(*page_list), GFP_KERNEL);
+	if (!page_list) {
+		ret = -ENOMEM;
+		goto umem_kfree;
 	}
 
 	lock_limit = rlimit(RLIMIT_MEMLOCK) >> PAGE_SHIFT;
@@ -216,9 +225,7 @@ struct ib_umem *ib_umem_get(struct ib_device *device, unsigned long addr,
 	while (npages) {
 		cond_resched();
 		pinned = pin_user_pages_fast(cur_base,
-					  min_t(unsigned long, npages,
-						PAGE_SIZE /
-						sizeof(struct page *)),
+					  min_t(unsigned long, npages, batch),
 					  gup_flags, page_list);
 		if (pinned < 0) {
 			ret = pinned;
@@ -250,7 +257,7 @@ umem_release:
 	__ib_umem_release(device, umem, 0);
 	atomic64_sub(ib_umem_num_pages(umem), &mm->pinned_vm);
 out:
-	free_page((unsigned long) page_list);
+	kvfree(page_list);
 umem_kfree:
 	if (ret) {
 		mmdrop(umem->owning_mm);
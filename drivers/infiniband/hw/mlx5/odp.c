@@ -82,6 +82,9 @@ struct mlx5_pagefault {
 
 #define MAX_PREFETCH_LEN (4*1024*1024U)
 
+/* Asynchronous prefetch is split into chunks of this size faulted in parallel */
+#define MLX5_PREFETCH_CHUNK_LEN SZ_256M
+
 /* Timeout in ms to wait for an active mmu notifier to complete when handling
  * a pagefault. */
 #define MMU_NOTIFIER_TIMEOUT 1000
@@ -1788,13 +1791,83 @@ static int mlx5_ib_prefetch_sg_list(struct ib_pd *pd,
 	return 0;
 }
 
+/*
+ * A single work faults its ranges one after the other, which takes long for
+ * large MRs.  Queue one work per chunk instead, the unbound workqueue runs
+ * them on as many CPUs as are available.
+ */
+static int mlx5_ib_prefetch_split(struct ib_pd *pd,
+				  enum ib_uverbs_advise_mr_advice advice,
+				  u32 pf_flags, struct ib_sge *sg_list,
+				  u32 num_sge)
+{
+	struct prefetch_mr_work **works;
+	u32 i, nr = 0, nr_works = 0;
+	int ret = 0;
+
+	for (i = 0; i < num_sge; ++i)
+		nr_works += DIV_ROUND_UP(sg_list[i].length,
+					 MLX5_PREFETCH_CHUNK_LEN);
+
+	works = kvcalloc(nr_works, sizeof(*works), GFP_KERNEL);
+	if (!works)
+		return -ENOMEM;
+
+	for (i = 0; i < num_sge && !ret; ++i) {
+		u64 io_virt = sg_list[i].addr;
+		u32 left = sg_list[i].length;
+		struct mlx5_ib_mr *mr;
+
+		mr = get_prefetchable_mr(pd, advice, sg_list[i].lkey);
+		if (IS_ERR(mr)) {
+			ret = PTR_ERR(mr);
+			break;
+		}
+
+		while (left) {
+			struct prefetch_mr_work *work;
+			u32 len = min_t(u32, left, MLX5_PREFETCH_CHUNK_LEN);
+
+			work = kvzalloc(struct_size(work, frags, 1), GFP_KERNEL);
+			if (!work) {
+				ret = -ENOMEM;
+				break;
+			}
+			INIT_WORK(&work->work, mlx5_ib_prefetch_mr_work);
+			work->pf_flags = pf_flags;
+			work->frags[0].io_virt = io_virt;
+			work->frags[0].length = len;
+			work->frags[0].mr = mr;
+			/* Each work holds its own reference, see destroy_prefetch_work() */
+			refcount_inc(&mr->mmkey.usecount);
+			work->num_sge = 1;
+			works[nr++] = work;
+
+			io_virt += len;
+			left -= len;
+		}
+		mlx5r_deref_odp_mkey(&mr->mmkey);
+	}
+
+	for (i = 0; i < nr; ++i) {
+		if (ret)
+			destroy_prefetch_work(works[i]);
+		else
+			queue_work(system_unbound_wq, &works[i]->work);
+	}
+	kvfree(works);
+	return ret;
+}
+
 int mlx5_ib_advise_mr_prefetch(struct ib_pd *pd,
 			       enum ib_uverbs_advise_mr_advice advice,
 			       u32 flags, struct ib_sge *sg_list, u32 num_sge)
 {
 	u32 pf_flags = 0;
 	struct prefetch_mr_work *work;
+	u64 length = 0;
 	int rc;
+	u32 i;
 
 	if (advice == IB_UVERBS_ADVISE_MR_ADVICE_PREFETCH)
 		pf_flags |= MLX5_PF_FLAGS_DOWNGRADE;
@@ -1806,6 +1879,12 @@ int mlx5_ib_advise_mr_prefetch(struct ib_pd *pd,
 		return mlx5_ib_prefetch_sg_list(pd, advice, pf_flags, sg_list,
 						num_sge);
 
+	for (i = 0; i < num_sge; ++i)
+		length += sg_list[i].length;
+	if (length > MLX5_PREFETCH_CHUNK_LEN)
+		return mlx5_ib_prefetch_split(pd, advice, pf_flags, sg_list,
+					      num_sge);
+
 	work = kvzalloc(struct_size(work, frags, num_sge), GFP_KERNEL);
 	if (!work)
 		return -ENOMEM;
@@ -4218,6 +4218,10 @@ static int prepare_domain_attach_device(struct iommu_domain *domain,
 	if (dmar_domain->force_snooping && !ecap_sc_support(iommu->ecap))
 		return -EINVAL;
 
+	if (dmar_domain->dirty_tracking &&
+	    (!sm_supported(iommu) || !ecap_slads(iommu->ecap)))
+		return -EINVAL;
+
 	/* check if this iommu agaw is sufficient for max mapped address */
 	addr_width = agaw_to_width(iommu->agaw);
 	if (addr_width > cap_mgaw(iommu->cap))
@@ -4463,6 +4467,111 @@ static bool intel_iommu_enforce_cache_coherency(struct iommu_domain *domain)
 	return true;
 }
 
+static int intel_iommu_set_dirty_tracking(struct iommu_domain *domain,
+					  bool enable)
+{
+	struct dmar_domain *dmar_domain = to_dmar_domain(domain);
+	struct device_domain_info *info;
+	unsigned long flags;
+	int ret = 0;
+
+	/* Only the second level page table has hardware set dirty bits */
+	if (dmar_domain->use_first_level)
+		return -EOPNOTSUPP;
+
+	spin_lock_irqsave(&dmar_domain->lock, flags);
+	if (dmar_domain->dirty_tracking == enable)
+		goto out_unlock;
+
+	list_for_each_entry(info, &dmar_domain->devices, link) {
+		if (!sm_supported(info->iommu)) {
+			ret = -EOPNOTSUPP;
+			goto err_unwind;
+		}
+
+		ret = intel_pasid_setup_dirty_tracking(info->iommu, info->dev,
+						       PASID_RID2PASID, enable);
+		if (ret)
+			goto err_unwind;
+	}
+
+	dmar_domain->dirty_tracking = enable;
+out_unlock:
+	spin_unlock_irqrestore(&dmar_domain->lock, flags);
+	return 0;
+
+err_unwind:
+	list_for_each_entry(info, &dmar_domain->devices, link)
+		if (sm_supported(info->iommu))
+			intel_pasid_setup_dirty_tracking(info->iommu, info->dev,
+							 PASID_RID2PASID,
+							 dmar_domain->dirty_tracking);
+	spin_unlock_irqrestore(&dmar_domain->lock, flags);
+	return ret;
+}
+
+static int intel_iommu_read_and_clear_dirty(struct iommu_domain *domain,
+					    unsigned long iova, size_t size,
+					    unsigned long *bitmap,
+					    unsigned long pgshift)
+{
+	struct dmar_domain *dmar_domain = to_dmar_domain(domain);
+	unsigned long start = iova, end = iova + size;
+	struct iommu_domain_info *info;
+	unsigned long nrpages, i;
+	bool dirty = false;
+
+	if (!dmar_domain->dirty_tracking)
+		return -EINVAL;
+
+	while (iova < end) {
+		unsigned long first, last, next, pgsize;
+		struct dma_pte *pte;
+		int level = 0;
+
+		pte = pfn_to_dma_pte(dmar_domain, iova >> VTD_PAGE_SHIFT,
+				     &level);
+		if (!pte)
+			break;
+
+		/* Skip to the next IOPTE, a superpage counts as a whole */
+		pgsize = level_size(level) << VTD_PAGE_SHIFT;
+		next = (iova & ~(pgsize - 1)) + pgsize;
+		if (next > end || next < iova)
+			next = end;
+
+		if (dma_pte_present(pte) &&
+		    dma_sl_pte_test_and_clear_dirty(pte)) {
+			first = (iova - start) >> pgshift;
+			last = (next - 1 - start) >> pgshift;
+			bitmap_set(bitmap, first, last - first + 1);
+			dirty = true;
+		}
+		iova = next;
+	}
+
+	if (!dirty)
+		return 0;
+
+	/*
+	 * Cached translations keep the dirty state, so the IOTLB and device
+	 * TLBs have to be flushed for the bits to be set again on the next
+	 * write.
+	 */
+	nrpages = aligned_nrpages(start, size);
+	if (nrpages > UINT_MAX) {
+		intel_flush_iotlb_all(domain);
+		return 0;
+	}
+
+	xa_for_each(&dmar_domain->iommu_array, i, info)
+		iommu_flush_iotlb_psi(info->iommu, dmar_domain,
+				      mm_to_dma_pfn(IOVA_PFN(start)),
+				      nrpages, 0, 0);
+
+	return 0;
+}
+
 static bool intel_iommu_capable(struct device *dev, enum iommu_cap cap)
 {
 	struct device_domain_info *info = dev_iommu_priv_get(dev);
@@ -4476,6 +4585,9 @@ static bool intel_iommu_capable(struct device *dev, enum iommu_cap cap)
 		return dmar_platform_optin();
 	case IOMMU_CAP_ENFORCE_CACHE_COHERENCY:
 		return ecap_sc_support(info->iommu->ecap);
+	case IOMMU_CAP_DIRTY:
+		return sm_supported(info->iommu) &&
+		       ecap_slads(info->iommu->ecap);
 	default:
 		return false;
 	}
@@ -4801,6 +4913,8 @@ const struct iommu_ops intel_iommu_ops = {
 		.iova_to_phys		= intel_iommu_iova_to_phys,
 		.free			= intel_iommu_domain_free,
 		.enforce_cache_coherency = intel_iommu_enforce_cache_coherency,
+		.set_dirty_tracking	= intel_iommu_set_dirty_tracking,
+		.read_and_clear_dirty	= intel_iommu_read_and_clear_dirty,
 	}
 };
 
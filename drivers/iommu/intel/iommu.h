@@ -42,6 +42,9 @@
 #define DMA_PTE_LARGE_PAGE	BIT_ULL(7)
 #define DMA_PTE_SNP		BIT_ULL(11)
 
+#define DMA_SL_PTE_DIRTY_BIT	9
+#define DMA_SL_PTE_DIRTY	BIT_ULL(DMA_SL_PTE_DIRTY_BIT)
+
 #define DMA_FL_PTE_PRESENT	BIT_ULL(0)
 #define DMA_FL_PTE_US		BIT_ULL(2)
 #define DMA_FL_PTE_ACCESS	BIT_ULL(5)
@@ -536,6 +539,9 @@ struct dmar_domain {
 					 * otherwise, goes through the second
 					 * level.
 					 */
+	u8 dirty_tracking:1;		/* Dirty bits of the second level
+					 * page table are set by hardware
+					 */
 
 	spinlock_t lock;		/* Protect device tracking lists */
 	struct list_head devices;	/* all devices' list */
@@ -685,6 +691,14 @@ static inline bool dma_pte_superpage(struct dma_pte *pte)
 	return (pte->val & DMA_PTE_LARGE_PAGE);
 }
 
+static inline bool dma_sl_pte_test_and_clear_dirty(struct dma_pte *pte)
+{
+	if (!(READ_ONCE(pte->val) & DMA_SL_PTE_DIRTY))
+		return false;
+	return test_and_clear_bit(DMA_SL_PTE_DIRTY_BIT,
+				  (unsigned long *)&pte->val);
+}
+
 static inline bool first_pte_in_page(struct dma_pte *pte)
 {
 	return IS_ALIGNED((unsigned long)pte, VTD_PAGE_SIZE);
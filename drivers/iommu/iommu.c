@@ -2641,6 +2641,48 @@ int iommu_set_pgtable_quirks(struct iommu_domain *domain,
 }
 EXPORT_SYMBOL_GPL(iommu_set_pgtable_quirks);
 
+/**
+ * iommu_set_dirty_tracking() - Start or stop dirty tracking on a domain
+ * @domain: the unmanaged domain
+ * @enable: whether the IOMMU should mark the IOPTEs DMA is written through
+ *
+ * Return: 0 on success, -EOPNOTSUPP if the IOMMU of any device attached to
+ * @domain can't track dirty pages.
+ */
+int iommu_set_dirty_tracking(struct iommu_domain *domain, bool enable)
+{
+	if (domain->type != IOMMU_DOMAIN_UNMANAGED)
+		return -EINVAL;
+	if (!domain->ops->set_dirty_tracking)
+		return -EOPNOTSUPP;
+	return domain->ops->set_dirty_tracking(domain, enable);
+}
+EXPORT_SYMBOL_GPL(iommu_set_dirty_tracking);
+
+/**
+ * iommu_read_and_clear_dirty() - Harvest the dirty bits of a range
+ * @domain: the unmanaged domain with dirty tracking enabled
+ * @iova: start of the range
+ * @size: size of the range
+ * @bitmap: bitmap to set the dirty pages in, bit 0 is @iova
+ * @pgshift: log2 of the size tracked by one bit of @bitmap
+ *
+ * Bits of @bitmap are only ever set, so the dirty pages of several domains
+ * can be gathered in the same bitmap.
+ */
+int iommu_read_and_clear_dirty(struct iommu_domain *domain,
+			       unsigned long iova, size_t size,
+			       unsigned long *bitmap, unsigned long pgshift)
+{
+	if (domain->type != IOMMU_DOMAIN_UNMANAGED)
+		return -EINVAL;
+	if (!domain->ops->read_and_clear_dirty)
+		return -EOPNOTSUPP;
+	return domain->ops->read_and_clear_dirty(domain, iova, size, bitmap,
+						 pgshift);
+}
+EXPORT_SYMBOL_GPL(iommu_read_and_clear_dirty);
+
 void iommu_get_resv_regions(struct device *dev, struct list_head *list)
 {
 	const struct iommu_ops *ops = dev_iommu_ops(dev);
@@ -15,7 +15,11 @@
 /* The anchor node sits above the top of the usable address space */
 #define IOVA_ANCHOR	~0UL
 
-#define IOVA_RANGE_CACHE_MAX_SIZE 6	/* log of max cached IOVA range size (in pages) */
+/*
+ * Cache ranges up to 1MB, so that large mappings of fast NICs and NVMe
+ * devices don't all serialise on iova_rbtree_lock under a strict IOMMU.
+ */
+#define IOVA_RANGE_CACHE_MAX_SIZE 9	/* log of max cached IOVA range size (in pages) */
 
 static bool iova_rcache_insert(struct iova_domain *iovad,
 			       unsigned long pfn,
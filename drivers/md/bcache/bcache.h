@@ -373,6 +373,7 @@ struct cached_dev {
 	unsigned int		writeback_metadata:1;
 	unsigned int		writeback_running:1;
 	unsigned int		writeback_consider_fragment:1;
+	unsigned int		writeback_consider_congestion:1;
 	unsigned char		writeback_percent;
 	unsigned int		writeback_delay;
 
@@ -10,6 +10,7 @@
 #include "bcache.h"
 #include "btree.h"
 #include "debug.h"
+#include "request.h"
 #include "writeback.h"
 
 #include <linux/delay.h>
@@ -87,6 +88,7 @@ static void __update_writeback_rate(struct cached_dev *dc)
 		div_s64(error, dc->writeback_rate_p_term_inverse);
 	int64_t integral_scaled;
 	uint32_t new_rate;
+	bool congested = false;
 
 	/*
 	 * We need to consider the number of dirty buckets as well
@@ -126,8 +128,22 @@ static void __update_writeback_rate(struct cached_dev *dc)
 		}
 	}
 
+	/*
+	 * Writeback reads compete with foreground I/O on the cache device.
+	 * While the cache device is congested, i.e. its latency is above
+	 * congested_read/write_threshold_us and foreground requests are
+	 * already being bypassed to the backing device, hold back: don't
+	 * wind up the integral term and halve the proportional one.  The
+	 * rate recovers on its own once the latency drops again.
+	 */
+	if (dc->writeback_consider_congestion && bch_get_congested(c)) {
+		congested = true;
+		if (proportional_scaled > 0)
+			proportional_scaled >>= 1;
+	}
+
 	if ((error < 0 && dc->writeback_rate_integral > 0) ||
-	    (error > 0 && time_before64(local_clock(),
+	    (error > 0 && !congested && time_before64(local_clock(),
 			 dc->writeback_rate.next + NSEC_PER_MSEC))) {
 		/*
 		 * Only decrease the integral term if it's more than
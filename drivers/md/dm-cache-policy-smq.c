@@ -15,6 +15,8 @@
 #include <linux/mutex.h>
 #include <linux/vmalloc.h>
 #include <linux/math64.h>
+#include <linux/percpu.h>
+#include <linux/seqlock.h>
 
 #define DM_MSG_PREFIX "cache-policy-smq"
 
@@ -549,6 +551,12 @@ static void stats_miss(struct stats *s)
 	s->misses++;
 }
 
+/* Accesses counted by lookup_hit_lockless(), see fold_lockless_stats() */
+struct lockless_stats {
+	unsigned long hits;
+	unsigned long misses;
+};
+
 /*
  * There are times when we don't have any confidence in the hotspot queue.
  * Such as when a fresh cache is created and the blocks have been spread
@@ -797,6 +805,21 @@ struct smq_policy {
 
 	/* protects everything */
 	spinlock_t lock;
+
+	/*
+	 * Bumped around every update made under the lock, so that hits
+	 * that don't need requeueing can be looked up without it.  See
+	 * lookup_hit_lockless().
+	 */
+	seqcount_spinlock_t seq;
+
+	/*
+	 * Accesses taken by lookup_hit_lockless(), folded into cache_stats
+	 * from the tick.
+	 */
+	struct lockless_stats __percpu *lockless_stats;
+	struct lockless_stats lockless_folded;
+
 	dm_cblock_t cache_size;
 	sector_t cache_block_size;
 
@@ -1360,11 +1383,86 @@ static void smq_destroy(struct dm_cache_policy *p)
 	free_bitset(mq->hotspot_hit_bits);
 	free_bitset(mq->cache_hit_bits);
 	space_exit(&mq->es);
+	free_percpu(mq->lockless_stats);
 	kfree(mq);
 }
 
 /*----------------------------------------------------------------*/
 
+/*
+ * Bound on the hash chain walk done without the lock; a chain being
+ * rewritten underneath us could otherwise be followed for ever.
+ */
+#define LOCKLESS_MAX_CHAIN 16u
+
+/*
+ * A hit on an entry with no pending work, whose cache hit bit is already
+ * set for this period, leaves the policy state untouched apart from the
+ * access statistics: requeue() is a noop for it.  Such hits, which are the
+ * common case for a warm cache, are resolved here without taking
+ * mq->lock.  Entries live in a preallocated array and are never freed, so
+ * the walk is always over valid memory; the seqcount tells us whether
+ * anything changed while we looked.  Anything else falls back to the
+ * locked path.
+ */
+static bool lookup_hit_lockless(struct smq_policy *mq, dm_oblock_t oblock,
+				dm_cblock_t *cblock)
+{
+	struct smq_hash_table *ht = &mq->table;
+	unsigned int h, steps = 0, level;
+	struct entry *e;
+	dm_cblock_t cb;
+	unsigned int seq;
+
+	seq = raw_read_seqcount(&mq->seq);
+	if (seq & 1)
+		return false;
+
+	h = hash_64(from_oblock(oblock), ht->hash_bits);
+	for (e = h_head(ht, h); e; e = h_next(ht, e)) {
+		if (++steps > LOCKLESS_MAX_CHAIN)
+			return false;
+		if (e->oblock == oblock)
+			break;
+	}
+
+	if (!e || e->pending_work)
+		return false;
+
+	cb = infer_cblock(mq, e);
+	if (!test_bit(from_cblock(cb), mq->cache_hit_bits))
+		return false;
+	level = e->level;
+
+	if (read_seqcount_retry(&mq->seq, seq))
+		return false;
+
+	/* As stats_level_accessed() does for the locked path */
+	if (level >= mq->cache_stats.hit_threshold)
+		this_cpu_inc(mq->lockless_stats->hits);
+	else
+		this_cpu_inc(mq->lockless_stats->misses);
+	*cblock = cb;
+	return true;
+}
+
+static void fold_lockless_stats(struct smq_policy *mq)
+{
+	struct lockless_stats total = { 0, 0 };
+	int cpu;
+
+	for_each_possible_cpu(cpu) {
+		struct lockless_stats *s = per_cpu_ptr(mq->lockless_stats, cpu);
+
+		total.hits += READ_ONCE(s->hits);
+		total.misses += READ_ONCE(s->misses);
+	}
+
+	mq->cache_stats.hits += total.hits - mq->lockless_folded.hits;
+	mq->cache_stats.misses += total.misses - mq->lockless_folded.misses;
+	mq->lockless_folded = total;
+}
+
 static int __lookup(struct smq_policy *mq, dm_oblock_t oblock, dm_cblock_t *cblock,
 		    int data_dir, bool fast_copy,
 		    struct policy_work **work, bool *background_work)
@@ -1408,10 +1506,17 @@ static int smq_lookup(struct dm_cache_policy *p, dm_oblock_t oblock, dm_cblock_t
 	unsigned long flags;
 	struct smq_policy *mq = to_smq_policy(p);
 
+	if (lookup_hit_lockless(mq, oblock, cblock)) {
+		*background_work = false;
+		return 0;
+	}
+
 	spin_lock_irqsave(&mq->lock, flags);
+	write_seqcount_begin(&mq->seq);
 	r = __lookup(mq, oblock, cblock,
 		     data_dir, fast_copy,
 		     NULL, background_work);
+	write_seqcount_end(&mq->seq);
 	spin_unlock_irqrestore(&mq->lock, flags);
 
 	return r;
@@ -1427,8 +1532,13 @@ static int smq_lookup_with_work(struct dm_cache_policy *p,
 	unsigned long flags;
 	struct smq_policy *mq = to_smq_policy(p);
 
+	if (lookup_hit_lockless(mq, oblock, cblock))
+		return 0;
+
 	spin_lock_irqsave(&mq->lock, flags);
+	write_seqcount_begin(&mq->seq);
 	r = __lookup(mq, oblock, cblock, data_dir, fast_copy, work, &background_queued);
+	write_seqcount_end(&mq->seq);
 	spin_unlock_irqrestore(&mq->lock, flags);
 
 	return r;
@@ -1442,6 +1552,7 @@ static int smq_get_background_work(struct dm_cache_policy *p, bool idle,
 	struct smq_policy *mq = to_smq_policy(p);
 
 	spin_lock_irqsave(&mq->lock, flags);
+	write_seqcount_begin(&mq->seq);
 	r = btracker_issue(mq->bg_work, result);
 	if (r == -ENODATA) {
 		if (!clean_target_met(mq, idle)) {
@@ -1449,6 +1560,7 @@ static int smq_get_background_work(struct dm_cache_policy *p, bool idle,
 			r = btracker_issue(mq->bg_work, result);
 		}
 	}
+	write_seqcount_end(&mq->seq);
 	spin_unlock_irqrestore(&mq->lock, flags);
 
 	return r;
@@ -1512,7 +1624,9 @@ static void smq_complete_background_work(struct dm_cache_policy *p,
 	struct smq_policy *mq = to_smq_policy(p);
 
 	spin_lock_irqsave(&mq->lock, flags);
+	write_seqcount_begin(&mq->seq);
 	__complete_background_work(mq, work, success);
+	write_seqcount_end(&mq->seq);
 	spin_unlock_irqrestore(&mq->lock, flags);
 }
 
@@ -1536,7 +1650,9 @@ static void smq_set_dirty(struct dm_cache_policy *p, dm_cblock_t cblock)
 	struct smq_policy *mq = to_smq_policy(p);
 
 	spin_lock_irqsave(&mq->lock, flags);
+	write_seqcount_begin(&mq->seq);
 	__smq_set_clear_dirty(mq, cblock, true);
+	write_seqcount_end(&mq->seq);
 	spin_unlock_irqrestore(&mq->lock, flags);
 }
 
@@ -1546,7 +1662,9 @@ static void smq_clear_dirty(struct dm_cache_policy *p, dm_cblock_t cblock)
 	unsigned long flags;
 
 	spin_lock_irqsave(&mq->lock, flags);
+	write_seqcount_begin(&mq->seq);
 	__smq_set_clear_dirty(mq, cblock, false);
+	write_seqcount_end(&mq->seq);
 	spin_unlock_irqrestore(&mq->lock, flags);
 }
 
@@ -1581,14 +1699,23 @@ static int smq_invalidate_mapping(struct dm_cache_policy *p, dm_cblock_t cblock)
 {
 	struct smq_policy *mq = to_smq_policy(p);
 	struct entry *e = get_entry(&mq->cache_alloc, from_cblock(cblock));
+	unsigned long flags;
 
 	if (!e->allocated)
 		return -ENODATA;
 
+	/*
+	 * Lookups may run concurrently now that hits skip the lock, so the
+	 * removal has to be visible to lookup_hit_lockless().
+	 */
+	spin_lock_irqsave(&mq->lock, flags);
+	write_seqcount_begin(&mq->seq);
 	// FIXME: what if this block has pending background work?
 	del_queue(mq, e);
 	h_remove(&mq->table, e);
 	free_entry(&mq->cache_alloc, e);
+	write_seqcount_end(&mq->seq);
+	spin_unlock_irqrestore(&mq->lock, flags);
 	return 0;
 }
 
@@ -1622,10 +1749,13 @@ static void smq_tick(struct dm_cache_policy *p, bool can_block)
 	unsigned long flags;
 
 	spin_lock_irqsave(&mq->lock, flags);
+	write_seqcount_begin(&mq->seq);
 	mq->tick++;
+	fold_lockless_stats(mq);
 	update_sentinels(mq);
 	end_hotspot_period(mq);
 	end_cache_period(mq);
+	write_seqcount_end(&mq->seq);
 	spin_unlock_irqrestore(&mq->lock, flags);
 }
 
@@ -1781,6 +1911,7 @@ static struct dm_cache_policy *__smq_create(dm_cblock_t cache_size,
 
 	mq->tick = 0;
 	spin_lock_init(&mq->lock);
+	seqcount_spinlock_init(&mq->seq, &mq->lock);
 
 	q_init(&mq->hotspot, &mq->es, NR_HOTSPOT_LEVELS);
 	mq->hotspot.nr_top_levels = 8;
@@ -1809,10 +1940,16 @@ static struct dm_cache_policy *__smq_create(dm_cblock_t cache_size,
 	if (!mq->bg_work)
 		goto bad_btracker;
 
+	mq->lockless_stats = alloc_percpu(struct lockless_stats);
+	if (!mq->lockless_stats)
+		goto bad_lockless_stats;
+
 	mq->migrations_allowed = migrations_allowed;
 
 	return &mq->policy;
 
+bad_lockless_stats:
+	btracker_destroy(mq->bg_work);
 bad_btracker:
 	h_exit(&mq->hotspot_table);
 bad_alloc_hotspot_table:
@@ -136,7 +136,7 @@ struct iv_elephant_private {
 enum flags { DM_CRYPT_SUSPENDED, DM_CRYPT_KEY_VALID,
 	     DM_CRYPT_SAME_CPU, DM_CRYPT_NO_OFFLOAD,
 	     DM_CRYPT_NO_READ_WORKQUEUE, DM_CRYPT_NO_WRITE_WORKQUEUE,
-	     DM_CRYPT_WRITE_INLINE };
+	     DM_CRYPT_WRITE_INLINE, DM_CRYPT_NO_WRITE_WORKQUEUE_IDLE };
 
 enum cipher_flags {
 	CRYPT_MODE_INTEGRITY_AEAD,	/* Use authenticated mode for cipher */
@@ -155,6 +155,7 @@ struct crypt_config {
 
 	struct workqueue_struct *io_queue;
 	struct workqueue_struct *crypt_queue;
+	atomic_t crypt_queued;		/* ios waiting for or in crypt_queue */
 
 	spinlock_t write_thread_lock;
 	struct task_struct *write_thread;
@@ -2219,6 +2220,28 @@ static void kcryptd_crypt_tasklet(unsigned long work)
 	kcryptd_crypt((struct work_struct *)work);
 }
 
+static void kcryptd_crypt_queued(struct work_struct *work)
+{
+	struct dm_crypt_io *io = container_of(work, struct dm_crypt_io, work);
+	struct crypt_config *cc = io->cc;
+
+	kcryptd_crypt(work);
+	atomic_dec(&cc->crypt_queued);
+}
+
+/*
+ * With no_write_workqueue_when_idle, a write submitted from task context is
+ * encrypted by the submitter as long as the crypt workqueue has nothing
+ * pending: handing it to an idle kcryptd worker only adds a wakeup and a
+ * cache-cold cpu to the latency.  Under load the workqueue still spreads
+ * the encryption across cpus.
+ */
+static bool kcryptd_crypt_write_idle(struct crypt_config *cc)
+{
+	return test_bit(DM_CRYPT_NO_WRITE_WORKQUEUE_IDLE, &cc->flags) &&
+	       in_task() && !atomic_read(&cc->crypt_queued);
+}
+
 static void kcryptd_queue_crypt(struct dm_crypt_io *io)
 {
 	struct crypt_config *cc = io->cc;
@@ -2241,7 +2264,13 @@ static void kcryptd_queue_crypt(struct dm_crypt_io *io)
 		return;
 	}
 
-	INIT_WORK(&io->work, kcryptd_crypt);
+	if (bio_data_dir(io->base_bio) == WRITE && kcryptd_crypt_write_idle(cc)) {
+		kcryptd_crypt(&io->work);
+		return;
+	}
+
+	atomic_inc(&cc->crypt_queued);
+	INIT_WORK(&io->work, kcryptd_crypt_queued);
 	queue_work(cc->crypt_queue, &io->work);
 }
 
@@ -3070,7 +3099,7 @@ static int crypt_ctr_optional(struct dm_target *ti, unsigned int argc, char **ar
 	struct crypt_config *cc = ti->private;
 	struct dm_arg_set as;
 	static const struct dm_arg _args[] = {
-		{0, 8, "Invalid number of feature args"},
+		{0, 9, "Invalid number of feature args"},
 	};
 	unsigned int opt_params, val;
 	const char *opt_string, *sval;
@@ -3104,6 +3133,8 @@ static int crypt_ctr_optional(struct dm_target *ti, unsigned int argc, char **ar
 			set_bit(DM_CRYPT_NO_READ_WORKQUEUE, &cc->flags);
 		else if (!strcasecmp(opt_string, "no_write_workqueue"))
 			set_bit(DM_CRYPT_NO_WRITE_WORKQUEUE, &cc->flags);
+		else if (!strcasecmp(opt_string, "no_write_workqueue_when_idle"))
+			set_bit(DM_CRYPT_NO_WRITE_WORKQUEUE_IDLE, &cc->flags);
 		else if (sscanf(opt_string, "integrity:%u:", &val) == 1) {
 			if (val == 0 || val > MAX_TAG_SIZE) {
 				ti->error = "Invalid integrity arguments";
@@ -3483,6 +3514,7 @@ static void crypt_status(struct dm_target *ti, status_type_t type,
 		num_feature_args += test_bit(DM_CRYPT_NO_OFFLOAD, &cc->flags);
 		num_feature_args += test_bit(DM_CRYPT_NO_READ_WORKQUEUE, &cc->flags);
 		num_feature_args += test_bit(DM_CRYPT_NO_WRITE_WORKQUEUE, &cc->flags);
+		num_feature_args += test_bit(DM_CRYPT_NO_WRITE_WORKQUEUE_IDLE, &cc->flags);
 		num_feature_args += cc->sector_size != (1 << SECTOR_SHIFT);
 		num_feature_args += test_bit(CRYPT_IV_LARGE_SECTORS, &cc->cipher_flags);
 		if (cc->on_disk_tag_size)
@@ -3499,6 +3531,8 @@ static void crypt_status(struct dm_target *ti, status_type_t type,
 				DMEMIT(" no_read_workqueue");
 			if (test_bit(DM_CRYPT_NO_WRITE_WORKQUEUE, &cc->flags))
 				DMEMIT(" no_write_workqueue");
+			if (test_bit(DM_CRYPT_NO_WRITE_WORKQUEUE_IDLE, &cc->flags))
+				DMEMIT(" no_write_workqueue_when_idle");
 			if (cc->on_disk_tag_size)
 				DMEMIT(" integrity:%u:%s", cc->on_disk_tag_size, cc->cipher_auth);
 			if (cc->sector_size != (1 << SECTOR_SHIFT))
@@ -3518,6 +3552,8 @@ static void crypt_status(struct dm_target *ti, status_type_t type,
 		       'y' : 'n');
 		DMEMIT(",no_write_workqueue=%c", test_bit(DM_CRYPT_NO_WRITE_WORKQUEUE, &cc->flags) ?
 		       'y' : 'n');
+		DMEMIT(",no_write_workqueue_when_idle=%c",
+		       test_bit(DM_CRYPT_NO_WRITE_WORKQUEUE_IDLE, &cc->flags) ? 'y' : 'n');
 		DMEMIT(",iv_large_sectors=%c", test_bit(CRYPT_IV_LARGE_SECTORS, &cc->cipher_flags) ?
 		       'y' : 'n');
 
@@ -3639,7 +3675,7 @@ static void crypt_io_hints(struct dm_target *ti, struct queue_limits *limits)
 
 static struct target_type crypt_target = {
 	.name   = "crypt",
-	.version = {1, 24, 0},
+	.version = {1, 25, 0},
 	.module = THIS_MODULE,
 	.ctr    = crypt_ctr,
 	.dtr    = crypt_dtr,
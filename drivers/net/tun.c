@@ -2417,7 +2417,7 @@ static void tun_put_page(struct tun_page *tpage)
 static int tun_xdp_one(struct tun_struct *tun,
 		       struct tun_file *tfile,
 		       struct xdp_buff *xdp, int *flush,
-		       struct tun_page *tpage)
+		       struct tun_page *tpage, struct list_head *rx_list)
 {
 	unsigned int datasize = xdp->data_end - xdp->data;
 	struct tun_xdp_hdr *hdr = xdp->data_hard_start;
@@ -2510,7 +2510,7 @@ build:
 		spin_unlock(&queue->lock);
 		ret = 1;
 	} else {
-		netif_receive_skb(skb);
+		list_add_tail(&skb->list, rx_list);
 		ret = 0;
 	}
 
@@ -2542,6 +2542,7 @@ static int tun_sendmsg(struct socket *sock, struct msghdr *m, size_t total_len)
 		struct tun_page tpage;
 		int n = ctl->num;
 		int flush = 0, queued = 0;
+		LIST_HEAD(rx_list);
 
 		memset(&tpage, 0, sizeof(tpage));
 
@@ -2550,11 +2551,15 @@ static int tun_sendmsg(struct socket *sock, struct msghdr *m, size_t total_len)
 
 		for (i = 0; i < n; i++) {
 			xdp = &((struct xdp_buff *)ctl->ptr)[i];
-			ret = tun_xdp_one(tun, tfile, xdp, &flush, &tpage);
+			ret = tun_xdp_one(tun, tfile, xdp, &flush, &tpage,
+					  &rx_list);
 			if (ret > 0)
 				queued += ret;
 		}
 
+		/* hand the whole batch to the stack at once */
+		netif_receive_skb_list(&rx_list);
+
 		if (flush)
 			xdp_do_flush();
 
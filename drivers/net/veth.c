@@ -347,7 +347,13 @@ drop:
 		atomic64_inc(&priv->dropped);
 	}
 
-	if (use_napi)
+	/* Kick the peer NAPI once per xmit batch, e.g. per GSO train, and not
+	 * for every segment; a batch ending with an skb which bypassed NAPI
+	 * still has to flush what the previous ones queued.
+	 */
+	if (rq && !netdev_xmit_more() &&
+	    (use_napi || (rcu_access_pointer(rq->napi) &&
+			  !__ptr_ring_empty(&rq->xdp_ring))))
 		__veth_xdp_flush(rq);
 
 	rcu_read_unlock();
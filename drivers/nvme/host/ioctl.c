@@ -463,26 +463,35 @@ static inline struct nvme_uring_cmd_pdu *nvme_uring_cmd_pdu(
 	return (struct nvme_uring_cmd_pdu *)&ioucmd->pdu;
 }
 
-static void nvme_uring_task_meta_cb(struct io_uring_cmd *ioucmd,
-				    unsigned issue_flags)
+/* Copy out the metadata, unmap the data and return the command status. */
+static int nvme_uring_meta_finish(struct nvme_uring_cmd_pdu *pdu,
+				  struct request *req)
 {
-	struct nvme_uring_cmd_pdu *pdu = nvme_uring_cmd_pdu(ioucmd);
-	struct request *req = pdu->req;
 	int status;
-	u64 result;
 
 	if (nvme_req(req)->flags & NVME_REQ_CANCELLED)
 		status = -EINTR;
 	else
 		status = nvme_req(req)->status;
 
-	result = le64_to_cpu(nvme_req(req)->result.u64);
-
 	if (pdu->meta_len)
 		status = nvme_finish_user_metadata(req, pdu->u.meta_buffer,
 					pdu->u.meta, pdu->meta_len, status);
 	if (req->bio)
 		blk_rq_unmap_user(req->bio);
+	return status;
+}
+
+static void nvme_uring_task_meta_cb(struct io_uring_cmd *ioucmd,
+				    unsigned issue_flags)
+{
+	struct nvme_uring_cmd_pdu *pdu = nvme_uring_cmd_pdu(ioucmd);
+	struct request *req = pdu->req;
+	int status;
+	u64 result;
+
+	result = le64_to_cpu(nvme_req(req)->result.u64);
+	status = nvme_uring_meta_finish(pdu, req);
 	blk_mq_free_request(req);
 
 	io_uring_cmd_done(ioucmd, status, result, issue_flags);
@@ -536,14 +545,20 @@ static enum rq_end_io_ret nvme_uring_cmd_end_io_meta(struct request *req,
 	pdu->req = req;
 
 	/*
-	 * For iopoll, complete it directly.
-	 * Otherwise, move the completion to task work.
+	 * For iopoll, complete it directly and hand the request back to the
+	 * block layer, so that its tag is released together with the rest of
+	 * the polled batch. Otherwise, move the completion to task work, which
+	 * frees the request.
 	 */
-	if (cookie != NULL && blk_rq_is_poll(req))
-		nvme_uring_task_meta_cb(ioucmd, IO_URING_F_UNLOCKED);
-	else
-		io_uring_cmd_complete_in_task(ioucmd, nvme_uring_task_meta_cb);
+	if (cookie != NULL && blk_rq_is_poll(req)) {
+		u64 result = le64_to_cpu(nvme_req(req)->result.u64);
+		int status = nvme_uring_meta_finish(pdu, req);
+
+		io_uring_cmd_done(ioucmd, status, result, IO_URING_F_UNLOCKED);
+		return RQ_END_IO_FREE;
+	}
 
+	io_uring_cmd_complete_in_task(ioucmd, nvme_uring_task_meta_cb);
 	return RQ_END_IO_NONE;
 }
 
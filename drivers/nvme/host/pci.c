@@ -105,6 +105,30 @@ static bool noacpi;
 module_param(noacpi, bool, 0444);
 MODULE_PARM_DESC(noacpi, "disable acpi bios quirks");
 
+static unsigned char irq_coalesce_thr;
+module_param(irq_coalesce_thr, byte, 0444);
+MODULE_PARM_DESC(irq_coalesce_thr,
+	"Aggregation threshold (0's based number of completions) for adaptive "
+	"per-queue interrupt coalescing. Use 0 to disable coalescing.");
+
+static unsigned char irq_coalesce_time = 1;
+module_param(irq_coalesce_time, byte, 0444);
+MODULE_PARM_DESC(irq_coalesce_time,
+	"Aggregation time (in 100us units) for adaptive interrupt coalescing.");
+
+/*
+ * Adaptive interrupt coalescing: every NVME_COALESCE_INTERVAL, an IO queue
+ * completing at least NVME_COALESCE_MIN_CQES commands, with at least
+ * NVME_COALESCE_ON_DEPTH completions found per interrupt, gets coalescing
+ * enabled on its vector. It is disabled again once the queue gets below half
+ * that rate or below NVME_COALESCE_OFF_DEPTH completions per interrupt, so
+ * that shallow, latency sensitive queues keep an interrupt per completion.
+ */
+#define NVME_COALESCE_INTERVAL		HZ
+#define NVME_COALESCE_MIN_CQES		10000
+#define NVME_COALESCE_ON_DEPTH		4
+#define NVME_COALESCE_OFF_DEPTH		2
+
 struct nvme_dev;
 struct nvme_queue;
 
@@ -141,6 +165,8 @@ struct nvme_dev {
 	struct nvme_ctrl ctrl;
 	u32 last_ps;
 	bool hmb;
+	bool irq_coalesce;
+	struct delayed_work coalesce_work;
 
 	mempool_t *iod_mempool;
 
@@ -214,6 +240,12 @@ struct nvme_queue {
 	__le32 *dbbuf_sq_ei;
 	__le32 *dbbuf_cq_ei;
 	struct completion delete_done;
+	/* adaptive interrupt coalescing, counters only written from nvme_irq */
+	u32 nr_irqs;
+	u32 nr_irq_cqes;
+	u32 last_nr_irqs;
+	u32 last_nr_irq_cqes;
+	bool irq_coalesced;
 };
 
 /*
@@ -1132,8 +1164,12 @@ static irqreturn_t nvme_irq(int irq, void *data)
 {
 	struct nvme_queue *nvmeq = data;
 	DEFINE_IO_COMP_BATCH(iob);
+	int found;
 
-	if (nvme_poll_cq(nvmeq, &iob)) {
+	found = nvme_poll_cq(nvmeq, &iob);
+	if (found) {
+		nvmeq->nr_irqs++;
+		nvmeq->nr_irq_cqes += found;
 		if (!rq_list_empty(iob.req_list))
 			nvme_pci_complete_batch(&iob);
 		return IRQ_HANDLED;
@@ -2626,6 +2662,13 @@ static void nvme_dev_disable(struct nvme_dev *dev, bool shutdown)
 	struct pci_dev *pdev = to_pci_dev(dev->dev);
 	bool dead;
 
+	/*
+	 * Stop the coalescing work, a reset sets it up again.  Don't wait for
+	 * it, it may be stuck on an admin command that the disable cancels.
+	 */
+	WRITE_ONCE(dev->irq_coalesce, false);
+	cancel_delayed_work(&dev->coalesce_work);
+
 	mutex_lock(&dev->shutdown_lock);
 	dead = nvme_pci_ctrl_is_dead(dev);
 	if (dev->ctrl.state == NVME_CTRL_LIVE ||
@@ -2738,6 +2781,108 @@ static void nvme_pci_free_ctrl(struct nvme_ctrl *ctrl)
 	kfree(dev);
 }
 
+static int nvme_set_irq_coalesce(struct nvme_dev *dev, u16 vector,
+		bool coalesce)
+{
+	u32 dword11 = vector;
+
+	if (!coalesce)
+		dword11 |= NVME_IRQ_CONFIG_CD;
+	return nvme_set_features(&dev->ctrl, NVME_FEAT_IRQ_CONFIG, dword11,
+				 NULL, 0, NULL);
+}
+
+static bool nvme_queue_want_coalesce(struct nvme_queue *nvmeq)
+{
+	u32 irqs = READ_ONCE(nvmeq->nr_irqs);
+	u32 cqes = READ_ONCE(nvmeq->nr_irq_cqes);
+	u32 d_irqs = irqs - nvmeq->last_nr_irqs;
+	u32 d_cqes = cqes - nvmeq->last_nr_irq_cqes;
+
+	nvmeq->last_nr_irqs = irqs;
+	nvmeq->last_nr_irq_cqes = cqes;
+
+	if (!nvmeq->irq_coalesced)
+		return d_cqes >= NVME_COALESCE_MIN_CQES &&
+			d_cqes >= NVME_COALESCE_ON_DEPTH * d_irqs;
+	return d_cqes >= NVME_COALESCE_MIN_CQES / 2 &&
+		d_cqes >= NVME_COALESCE_OFF_DEPTH * d_irqs;
+}
+
+static void nvme_irq_coalesce_work(struct work_struct *work)
+{
+	struct nvme_dev *dev = container_of(to_delayed_work(work),
+					    struct nvme_dev, coalesce_work);
+	unsigned int i;
+
+	if (!READ_ONCE(dev->irq_coalesce))
+		return;
+
+	for (i = 1; i < dev->online_queues; i++) {
+		struct nvme_queue *nvmeq = &dev->queues[i];
+		bool coalesce;
+
+		if (dev->ctrl.state != NVME_CTRL_LIVE)
+			return;
+		if (test_bit(NVMEQ_POLLED, &nvmeq->flags))
+			continue;
+
+		coalesce = nvme_queue_want_coalesce(nvmeq);
+		if (coalesce == nvmeq->irq_coalesced)
+			continue;
+		if (nvme_set_irq_coalesce(dev, nvmeq->cq_vector, coalesce))
+			continue;
+		nvmeq->irq_coalesced = coalesce;
+	}
+
+	if (READ_ONCE(dev->irq_coalesce))
+		queue_delayed_work(nvme_wq, &dev->coalesce_work,
+				   NVME_COALESCE_INTERVAL);
+}
+
+/*
+ * Enable controller interrupt coalescing, but turn it off for every IO queue
+ * vector. nvme_irq_coalesce_work() then turns it on for the vectors of the
+ * queues that benefit from it. A controller reset brings back the defaults,
+ * so this runs from every reset.
+ */
+static void nvme_setup_irq_coalesce(struct nvme_dev *dev)
+{
+	unsigned int i;
+	u32 dword11;
+
+	dev->irq_coalesce = false;
+	/* the admin queue vector is never coalesced, don't share it */
+	if (!irq_coalesce_thr || dev->num_vecs == 1)
+		return;
+
+	dword11 = irq_coalesce_thr | (irq_coalesce_time << 8);
+	if (nvme_set_features(&dev->ctrl, NVME_FEAT_IRQ_COALESCE, dword11,
+			      NULL, 0, NULL))
+		return;
+
+	for (i = 1; i < dev->online_queues; i++) {
+		struct nvme_queue *nvmeq = &dev->queues[i];
+
+		nvmeq->irq_coalesced = false;
+		nvmeq->last_nr_irqs = READ_ONCE(nvmeq->nr_irqs);
+		nvmeq->last_nr_irq_cqes = READ_ONCE(nvmeq->nr_irq_cqes);
+		if (test_bit(NVMEQ_POLLED, &nvmeq->flags))
+			continue;
+		if (nvme_set_irq_coalesce(dev, nvmeq->cq_vector, false)) {
+			dev_warn(dev->ctrl.device,
+				 "failed to configure interrupt coalescing\n");
+			nvme_set_features(&dev->ctrl, NVME_FEAT_IRQ_COALESCE, 0,
+					  NULL, 0, NULL);
+			return;
+		}
+	}
+
+	dev->irq_coalesce = true;
+	queue_delayed_work(nvme_wq, &dev->coalesce_work,
+			   NVME_COALESCE_INTERVAL);
+}
+
 static void nvme_reset_work(struct work_struct *work)
 {
 	struct nvme_dev *dev =
@@ -2822,6 +2967,7 @@ static void nvme_reset_work(struct work_struct *work)
 	}
 
 	nvme_start_ctrl(&dev->ctrl);
+	nvme_setup_irq_coalesce(dev);
 	return;
 
  out_unlock:
@@ -2974,6 +3120,7 @@ static struct nvme_dev *nvme_pci_alloc_dev(struct pci_dev *pdev,
 	if (!dev)
 		return ERR_PTR(-ENOMEM);
 	INIT_WORK(&dev->ctrl.reset_work, nvme_reset_work);
+	INIT_DELAYED_WORK(&dev->coalesce_work, nvme_irq_coalesce_work);
 	mutex_init(&dev->shutdown_lock);
 
 	dev->nr_write_queues = write_queues;
@@ -3155,6 +3302,7 @@ static void nvme_shutdown(struct pci_dev *pdev)
 {
 	struct nvme_dev *dev = pci_get_drvdata(pdev);
 
+	cancel_delayed_work_sync(&dev->coalesce_work);
 	nvme_disable_prepare_reset(dev, true);
 }
 
@@ -3176,6 +3324,7 @@ static void nvme_remove(struct pci_dev *pdev)
 	}
 
 	flush_work(&dev->ctrl.reset_work);
+	cancel_delayed_work_sync(&dev->coalesce_work);
 	nvme_stop_ctrl(&dev->ctrl);
 	nvme_remove_namespaces(&dev->ctrl);
 	nvme_dev_disable(dev, true);
@@ -3211,6 +3360,9 @@ static int nvme_resume(struct device *dev)
 	if (ctrl->hmpre && nvme_setup_host_mem(ndev))
 		goto reset;
 
+	if (ndev->irq_coalesce)
+		queue_delayed_work(nvme_wq, &ndev->coalesce_work,
+				   NVME_COALESCE_INTERVAL);
 	return 0;
 reset:
 	return nvme_try_sched_reset(ctrl);
@@ -3224,6 +3376,7 @@ static int nvme_suspend(struct device *dev)
 	int ret = -EBUSY;
 
 	ndev->last_ps = U32_MAX;
+	cancel_delayed_work_sync(&ndev->coalesce_work);
 
 	/*
 	 * The platform does not remove power for a kernel managed suspend so
@@ -3289,6 +3442,10 @@ static int nvme_suspend(struct device *dev)
 	}
 unfreeze:
 	nvme_unfreeze(ctrl);
+	/* Not suspended after all, nvme_resume() won't restart the work */
+	if (ret < 0 && ndev->irq_coalesce)
+		queue_delayed_work(nvme_wq, &ndev->coalesce_work,
+				   NVME_COALESCE_INTERVAL);
 	return ret;
 }
 
@@ -103,6 +103,7 @@ enum nvme_tcp_queue_flags {
 	NVME_TCP_Q_ALLOCATED	= 0,
 	NVME_TCP_Q_LIVE		= 1,
 	NVME_TCP_Q_POLLING	= 2,
+	NVME_TCP_Q_IO_CPU_SET	= 3,
 };
 
 enum nvme_tcp_recv_state {
@@ -174,6 +175,8 @@ struct nvme_tcp_ctrl {
 static LIST_HEAD(nvme_tcp_ctrl_list);
 static DEFINE_MUTEX(nvme_tcp_ctrl_mutex);
 static struct workqueue_struct *nvme_tcp_wq;
+/* number of I/O queues whose io_work is bound to each cpu */
+static atomic_t nvme_tcp_cpu_queues[NR_CPUS];
 static const struct blk_mq_ops nvme_tcp_mq_ops;
 static const struct blk_mq_ops nvme_tcp_admin_mq_ops;
 static int nvme_tcp_try_send(struct nvme_tcp_queue *queue);
@@ -1305,6 +1308,9 @@ static void nvme_tcp_free_queue(struct nvme_ctrl *nctrl, int qid)
 	if (!test_and_clear_bit(NVME_TCP_Q_ALLOCATED, &queue->flags))
 		return;
 
+	if (test_and_clear_bit(NVME_TCP_Q_IO_CPU_SET, &queue->flags))
+		atomic_dec(&nvme_tcp_cpu_queues[queue->io_cpu]);
+
 	if (queue->hdr_digest || queue->data_digest)
 		nvme_tcp_free_crypto(queue);
 
@@ -1484,6 +1490,58 @@ static void nvme_tcp_set_queue_io_cpu(struct nvme_tcp_queue *queue)
 	queue->io_cpu = cpumask_next_wrap(n - 1, cpu_online_mask, -1, false);
 }
 
+/*
+ * Once the I/O tag set is mapped, move io_work onto one of the cpus that
+ * actually submit to this hctx, so that the submitting context and io_work
+ * share caches and nvme_tcp_queue_request() can send inline.  Among the
+ * candidate cpus pick the one driving the fewest queues so that several
+ * controllers don't pile their io_work onto the same cpu.
+ */
+static void nvme_tcp_map_queue_io_cpu(struct nvme_tcp_queue *queue)
+{
+	struct nvme_tcp_ctrl *ctrl = queue->ctrl;
+	struct blk_mq_tag_set *set = &ctrl->tag_set;
+	int qid = nvme_tcp_queue_id(queue);
+	unsigned int *mq_map = NULL;
+	int cpu, min_queues = INT_MAX, io_cpu = WORK_CPU_UNBOUND;
+
+	if (test_and_clear_bit(NVME_TCP_Q_IO_CPU_SET, &queue->flags))
+		atomic_dec(&nvme_tcp_cpu_queues[queue->io_cpu]);
+
+	if (nvme_tcp_default_queue(queue))
+		mq_map = set->map[HCTX_TYPE_DEFAULT].mq_map;
+	else if (nvme_tcp_read_queue(queue))
+		mq_map = set->map[HCTX_TYPE_READ].mq_map;
+	else if (nvme_tcp_poll_queue(queue))
+		mq_map = set->map[HCTX_TYPE_POLL].mq_map;
+
+	if (WARN_ON(!mq_map))
+		return;
+
+	for_each_online_cpu(cpu) {
+		int num_queues;
+
+		if (mq_map[cpu] != qid - 1)
+			continue;
+
+		num_queues = atomic_read(&nvme_tcp_cpu_queues[cpu]);
+		if (num_queues < min_queues) {
+			io_cpu = cpu;
+			min_queues = num_queues;
+		}
+	}
+
+	/* no online cpu maps to this hctx, keep the index based choice */
+	if (io_cpu == WORK_CPU_UNBOUND)
+		return;
+
+	queue->io_cpu = io_cpu;
+	atomic_inc(&nvme_tcp_cpu_queues[io_cpu]);
+	set_bit(NVME_TCP_Q_IO_CPU_SET, &queue->flags);
+	dev_dbg(ctrl->ctrl.device, "queue %d: using cpu %d\n",
+		qid, queue->io_cpu);
+}
+
 static int nvme_tcp_alloc_queue(struct nvme_ctrl *nctrl, int qid)
 {
 	struct nvme_tcp_ctrl *ctrl = to_tcp_ctrl(nctrl);
@@ -1655,6 +1713,8 @@ static void nvme_tcp_stop_queue(struct nvme_ctrl *nctrl, int qid)
 	mutex_lock(&queue->queue_lock);
 	if (test_and_clear_bit(NVME_TCP_Q_LIVE, &queue->flags))
 		__nvme_tcp_stop_queue(queue);
+	if (test_and_clear_bit(NVME_TCP_Q_IO_CPU_SET, &queue->flags))
+		atomic_dec(&nvme_tcp_cpu_queues[queue->io_cpu]);
 	mutex_unlock(&queue->queue_lock);
 }
 
@@ -1680,6 +1740,9 @@ static int nvme_tcp_start_queue(struct nvme_ctrl *nctrl, int idx)
 	struct nvme_tcp_queue *queue = &ctrl->queues[idx];
 	int ret;
 
+	if (idx)
+		nvme_tcp_map_queue_io_cpu(queue);
+
 	queue->rd_enabled = true;
 	nvme_tcp_init_recv_ctx(queue);
 	nvme_tcp_setup_sock_ops(queue);
@@ -1226,11 +1226,18 @@ done_recv:
 	return 1;
 }
 
+/*
+ * Commands received in one batch are executed under a single plug, so that
+ * the bdev and passthru backends hand their bios and requests to blk-mq as
+ * a batch instead of kicking the device once per command.
+ */
 static int nvmet_tcp_try_recv(struct nvmet_tcp_queue *queue,
 		int budget, int *recvs)
 {
+	struct blk_plug plug;
 	int i, ret = 0;
 
+	blk_start_plug(&plug);
 	for (i = 0; i < budget; i++) {
 		ret = nvmet_tcp_try_recv_one(queue);
 		if (unlikely(ret < 0)) {
@@ -1242,6 +1249,7 @@ static int nvmet_tcp_try_recv(struct nvmet_tcp_queue *queue,
 		(*recvs)++;
 	}
 done:
+	blk_finish_plug(&plug);
 	return ret;
 }
 
@@ -76,6 +76,7 @@ struct vfio_iommu {
 	bool			v2;
 	bool			nesting;
 	bool			dirty_page_tracking;
+	bool			dirty_hw_tracking;	/* by the IOMMUs */
 	bool			container_open;
 	struct list_head	emulated_iommu_groups;
 };
@@ -286,6 +287,55 @@ static void vfio_iommu_populate_bitmap_full(struct vfio_iommu *iommu)
 	}
 }
 
+/*
+ * Have the IOMMUs of all domains set the dirty bit of the IOPTEs DMA is
+ * written through, so that devices which don't pin pages don't make every
+ * mapped page dirty. Either all domains track DMA or none does.
+ */
+static void vfio_iommu_dirty_hw_start(struct vfio_iommu *iommu)
+{
+	struct vfio_domain *d;
+
+	list_for_each_entry(d, &iommu->domain_list, next) {
+		if (iommu_set_dirty_tracking(d->domain, true))
+			goto unwind;
+	}
+	iommu->dirty_hw_tracking = !list_empty(&iommu->domain_list);
+	return;
+
+unwind:
+	list_for_each_entry_continue_reverse(d, &iommu->domain_list, next)
+		iommu_set_dirty_tracking(d->domain, false);
+}
+
+static void vfio_iommu_dirty_hw_stop(struct vfio_iommu *iommu)
+{
+	struct vfio_domain *d;
+
+	if (!iommu->dirty_hw_tracking)
+		return;
+
+	list_for_each_entry(d, &iommu->domain_list, next)
+		iommu_set_dirty_tracking(d->domain, false);
+	iommu->dirty_hw_tracking = false;
+}
+
+static int vfio_dma_read_dirty(struct vfio_iommu *iommu, struct vfio_dma *dma,
+			       unsigned long pgshift)
+{
+	struct vfio_domain *d;
+	int ret;
+
+	list_for_each_entry(d, &iommu->domain_list, next) {
+		ret = iommu_read_and_clear_dirty(d->domain, dma->iova,
+						 dma->size, dma->bitmap,
+						 pgshift);
+		if (ret)
+			return ret;
+	}
+	return 0;
+}
+
 static int vfio_dma_bitmap_alloc_all(struct vfio_iommu *iommu, size_t pgsize)
 {
 	struct rb_node *n;
@@ -475,7 +525,14 @@ static int put_pfn(unsigned long pfn, int prot)
 	return 0;
 }
 
-#define VFIO_BATCH_MAX_CAPACITY (PAGE_SIZE / sizeof(struct page *))
+/*
+ * Pin up to 16MB worth of pages per pin_user_pages_remote() call, so that a
+ * 1GB hugepage takes 64 calls rather than 512.  Falls back to a single page of
+ * page pointers if the larger array can't be allocated.
+ */
+#define VFIO_BATCH_ORDER 3
+#define VFIO_BATCH_MAX_CAPACITY ((PAGE_SIZE << VFIO_BATCH_ORDER) / sizeof(struct page *))
+#define VFIO_BATCH_MIN_CAPACITY (PAGE_SIZE / sizeof(struct page *))
 
 static void vfio_batch_init(struct vfio_batch *batch)
 {
@@ -485,11 +542,18 @@ static void vfio_batch_init(struct vfio_batch *batch)
 	if (unlikely(disable_hugepages))
 		goto fallback;
 
+	batch->pages = (struct page **) __get_free_pages(GFP_KERNEL | __GFP_NOWARN,
+							 VFIO_BATCH_ORDER);
+	if (batch->pages) {
+		batch->capacity = VFIO_BATCH_MAX_CAPACITY;
+		return;
+	}
+
 	batch->pages = (struct page **) __get_free_page(GFP_KERNEL);
 	if (!batch->pages)
 		goto fallback;
 
-	batch->capacity = VFIO_BATCH_MAX_CAPACITY;
+	batch->capacity = VFIO_BATCH_MIN_CAPACITY;
 	return;
 
 fallback:
@@ -511,9 +575,36 @@ static void vfio_batch_unpin(struct vfio_batch *batch, struct vfio_dma *dma)
 static void vfio_batch_fini(struct vfio_batch *batch)
 {
 	if (batch->capacity == VFIO_BATCH_MAX_CAPACITY)
+		free_pages((unsigned long)batch->pages, VFIO_BATCH_ORDER);
+	else if (batch->capacity == VFIO_BATCH_MIN_CAPACITY)
 		free_page((unsigned long)batch->pages);
 }
 
+/*
+ * Return the number of pages, at most @max, starting at the batch's next entry
+ * that are consecutive pages of the same large folio, i.e. that can be
+ * consumed as one physically contiguous run.
+ */
+static long vfio_batch_folio_run(struct vfio_batch *batch, long max)
+{
+	struct page *page = batch->pages[batch->offset];
+	struct folio *folio = page_folio(page);
+	long nr, i;
+
+	if (!folio_test_large(folio))
+		return 1;
+
+	nr = min3(max, (long)batch->size,
+		  (long)(folio_nr_pages(folio) - folio_page_idx(folio, page)));
+
+	for (i = 1; i < nr; i++) {
+		if (batch->pages[batch->offset + i] != nth_page(page, i))
+			break;
+	}
+
+	return i;
+}
+
 static int follow_fault_pfn(struct vm_area_struct *vma, struct mm_struct *mm,
 			    unsigned long vaddr, unsigned long *pfn,
 			    bool write_fault)
@@ -718,32 +809,50 @@ static long vfio_pin_pages_remote(struct vfio_dma *dma, unsigned long vaddr,
 		 * !VM_PFNMAP vma.
 		 */
 		while (true) {
+			long nr = 1, acct;
+
 			if (pfn != *pfn_base + pinned ||
 			    rsvd != is_invalid_reserved_pfn(pfn))
 				goto out;
 
+			/*
+			 * Consume a whole run of a large folio at once if no
+			 * page in it can have been pinned externally, i.e.
+			 * there's nothing to look up per page.
+			 */
+			if (batch->size > 1 && !rsvd &&
+			    RB_EMPTY_ROOT(&dma->pfn_list))
+				nr = vfio_batch_folio_run(batch, npage);
+
 			/*
 			 * Reserved pages aren't counted against the user,
 			 * externally pinned pages are already counted against
 			 * the user.
 			 */
-			if (!rsvd && !vfio_find_vpfn(dma, iova)) {
+			if (rsvd)
+				acct = 0;
+			else if (nr > 1)
+				acct = nr;
+			else
+				acct = !vfio_find_vpfn(dma, iova);
+
+			if (acct) {
 				if (!dma->lock_cap &&
-				    mm->locked_vm + lock_acct + 1 > limit) {
+				    mm->locked_vm + lock_acct + acct > limit) {
 					pr_warn("%s: RLIMIT_MEMLOCK (%ld) exceeded\n",
 						__func__, limit << PAGE_SHIFT);
 					ret = -ENOMEM;
 					goto unpin_out;
 				}
-				lock_acct++;
+				lock_acct += acct;
 			}
 
-			pinned++;
-			npage--;
-			vaddr += PAGE_SIZE;
-			iova += PAGE_SIZE;
-			batch->offset++;
-			batch->size--;
+			pinned += nr;
+			npage -= nr;
+			vaddr += nr << PAGE_SHIFT;
+			iova += nr << PAGE_SHIFT;
+			batch->offset += nr;
+			batch->size -= nr;
 
 			if (!batch->size)
 				break;
@@ -1238,9 +1347,12 @@ static int update_user_bitmap(u64 __user *bitmap, struct vfio_iommu *iommu,
 
 	/*
 	 * mark all pages dirty if any IOMMU capable device is not able
-	 * to report dirty pages and all pages are pinned and mapped.
+	 * to report dirty pages and all pages are pinned and mapped, unless
+	 * the IOMMUs track the pages the devices wrote to.
 	 */
-	if (iommu->num_non_pinned_groups && dma->iommu_mapped)
+	if (iommu->num_non_pinned_groups && dma->iommu_mapped &&
+	    (!iommu->dirty_hw_tracking ||
+	     vfio_dma_read_dirty(iommu, dma, pgshift)))
 		bitmap_set(dma->bitmap, 0, nbits);
 
 	if (shift) {
@@ -2401,6 +2513,11 @@ static int vfio_iommu_type1_attach_group(void *iommu_data,
 
 	list_add(&domain->next, &iommu->domain_list);
 	vfio_update_pgsize_bitmap(iommu);
+
+	/* Fall back to reporting all pages dirty if the new IOMMU can't */
+	if (iommu->dirty_hw_tracking &&
+	    iommu_set_dirty_tracking(domain->domain, true))
+		vfio_iommu_dirty_hw_stop(iommu);
 done:
 	/* Delete the old one and insert new iova list */
 	vfio_iommu_iova_insert_copy(iommu, &iova_copy);
@@ -3014,8 +3131,10 @@ static int vfio_iommu_type1_dirty_pages(struct vfio_iommu *iommu,
 		pgsize = 1 << __ffs(iommu->pgsize_bitmap);
 		if (!iommu->dirty_page_tracking) {
 			ret = vfio_dma_bitmap_alloc_all(iommu, pgsize);
-			if (!ret)
+			if (!ret) {
 				iommu->dirty_page_tracking = true;
+				vfio_iommu_dirty_hw_start(iommu);
+			}
 		}
 		mutex_unlock(&iommu->lock);
 		return ret;
@@ -3023,6 +3142,7 @@ static int vfio_iommu_type1_dirty_pages(struct vfio_iommu *iommu,
 		mutex_lock(&iommu->lock);
 		if (iommu->dirty_page_tracking) {
 			iommu->dirty_page_tracking = false;
+			vfio_iommu_dirty_hw_stop(iommu);
 			vfio_dma_bitmap_free_all(iommu);
 		}
 		mutex_unlock(&iommu->lock);
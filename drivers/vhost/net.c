@@ -19,6 +19,7 @@
 #include <linux/sched/clock.h>
 #include <linux/sched/signal.h>
 #include <linux/vmalloc.h>
+#include <linux/hrtimer.h>
 
 #include <linux/net.h>
 #include <linux/if_packet.h>
@@ -40,6 +41,11 @@ module_param(experimental_zcopytx, int, 0444);
 MODULE_PARM_DESC(experimental_zcopytx, "Enable Zero Copy TX;"
 		                       " 1 -Enable; 0 - Disable");
 
+static unsigned int tx_batch_budget_us = 50;
+module_param(tx_batch_budget_us, uint, 0644);
+MODULE_PARM_DESC(tx_batch_budget_us, "Max time TX completions may be held back"
+		 " when VHOST_BACKEND_F_TX_BATCH is negotiated; 0 - Disable");
+
 /* Max number of bytes transferred before requeueing the job.
  * Using this limit prevents one virtqueue from starving others. */
 #define VHOST_NET_WEIGHT 0x80000
@@ -77,7 +83,8 @@ enum {
 };
 
 enum {
-	VHOST_NET_BACKEND_FEATURES = (1ULL << VHOST_BACKEND_F_IOTLB_MSG_V2)
+	VHOST_NET_BACKEND_FEATURES = (1ULL << VHOST_BACKEND_F_IOTLB_MSG_V2) |
+				     (1ULL << VHOST_BACKEND_F_TX_BATCH)
 };
 
 enum {
@@ -117,6 +124,10 @@ struct vhost_net_virtqueue {
 	int done_idx;
 	/* Number of XDP frames batched */
 	int batched_xdp;
+	/* For TX, the done_idx heads were kept back across handle_tx() runs
+	 * and are still to be added to the used ring.
+	 */
+	bool used_deferred;
 	/* an array of userspace buffers info */
 	struct ubuf_info_msgzc *ubuf_info;
 	/* Reference counting for outstanding ubufs.
@@ -140,6 +151,9 @@ struct vhost_net {
 	unsigned tx_zcopy_err;
 	/* Flush in progress. Protected by tx vq lock. */
 	bool tx_flush;
+	/* Bounds how long deferred TX completions are held back. */
+	struct hrtimer tx_batch_timer;
+	struct vhost_work tx_batch_work;
 	/* Private page frag */
 	struct page_frag page_frag;
 	/* Refcount bias of page frag */
@@ -307,6 +321,7 @@ static void vhost_net_vq_reset(struct vhost_net *n)
 
 	for (i = 0; i < VHOST_NET_VQ_MAX; i++) {
 		n->vqs[i].done_idx = 0;
+		n->vqs[i].used_deferred = false;
 		n->vqs[i].upend_idx = 0;
 		n->vqs[i].ubufs = NULL;
 		n->vqs[i].vhost_hlen = 0;
@@ -451,6 +466,7 @@ static void vhost_net_signal_used(struct vhost_net_virtqueue *nvq)
 	struct vhost_virtqueue *vq = &nvq->vq;
 	struct vhost_dev *dev = vq->dev;
 
+	nvq->used_deferred = false;
 	if (!nvq->done_idx)
 		return;
 
@@ -458,10 +474,60 @@ static void vhost_net_signal_used(struct vhost_net_virtqueue *nvq)
 	nvq->done_idx = 0;
 }
 
-static void vhost_tx_batch(struct vhost_net *net,
-			   struct vhost_net_virtqueue *nvq,
-			   struct socket *sock,
-			   struct msghdr *msghdr)
+/*
+ * With VHOST_BACKEND_F_TX_BATCH, the completions left at the end of a
+ * handle_tx() run are not written to the used ring right away: the next run
+ * keeps appending to them, so that a single used ring update and at most one
+ * guest interrupt covers up to VHOST_NET_BATCH packets.  The timer armed by
+ * the first deferral bounds how long any completion is held back.
+ *
+ * Returns true if the completions were deferred.  Caller must hold the TX
+ * vq mutex.
+ */
+static bool vhost_net_tx_defer_used(struct vhost_net *net,
+				    struct vhost_net_virtqueue *nvq)
+{
+	unsigned int budget_us = READ_ONCE(tx_batch_budget_us);
+
+	if (!budget_us || !vhost_backend_has_feature(&nvq->vq, VHOST_BACKEND_F_TX_BATCH))
+		return false;
+
+	if (nvq->done_idx >= VHOST_NET_BATCH)
+		return false;
+
+	if (!nvq->used_deferred) {
+		nvq->used_deferred = true;
+		hrtimer_start(&net->tx_batch_timer, us_to_ktime(budget_us),
+			      HRTIMER_MODE_REL);
+	}
+	return true;
+}
+
+static enum hrtimer_restart vhost_net_tx_batch_timer(struct hrtimer *timer)
+{
+	struct vhost_net *net = container_of(timer, struct vhost_net,
+					     tx_batch_timer);
+
+	vhost_vq_work_queue(&net->vqs[VHOST_NET_VQ_TX].vq, &net->tx_batch_work);
+	return HRTIMER_NORESTART;
+}
+
+static void handle_tx_batch_flush(struct vhost_work *work)
+{
+	struct vhost_net *net = container_of(work, struct vhost_net,
+					     tx_batch_work);
+	struct vhost_net_virtqueue *nvq = &net->vqs[VHOST_NET_VQ_TX];
+
+	mutex_lock_nested(&nvq->vq.mutex, VHOST_NET_VQ_TX);
+	if (nvq->used_deferred)
+		vhost_net_signal_used(nvq);
+	mutex_unlock(&nvq->vq.mutex);
+}
+
+static void __vhost_tx_batch(struct vhost_net *net,
+			     struct vhost_net_virtqueue *nvq,
+			     struct socket *sock,
+			     struct msghdr *msghdr, bool can_defer)
 {
 	struct tun_msg_ctl ctl = {
 		.type = TUN_MSG_PTR,
@@ -485,16 +551,26 @@ static void vhost_tx_batch(struct vhost_net *net,
 		 */
 		for (i = 0; i < nvq->batched_xdp; ++i)
 			put_page(virt_to_head_page(nvq->xdp[i].data));
+		/* Heads deferred from earlier runs were sent, keep them. */
+		nvq->done_idx -= nvq->batched_xdp;
 		nvq->batched_xdp = 0;
-		nvq->done_idx = 0;
 		return;
 	}
 
 signal_used:
-	vhost_net_signal_used(nvq);
+	if (!can_defer || !vhost_net_tx_defer_used(net, nvq))
+		vhost_net_signal_used(nvq);
 	nvq->batched_xdp = 0;
 }
 
+static void vhost_tx_batch(struct vhost_net *net,
+			   struct vhost_net_virtqueue *nvq,
+			   struct socket *sock,
+			   struct msghdr *msghdr)
+{
+	__vhost_tx_batch(net, nvq, sock, msghdr, false);
+}
+
 static int sock_has_rx_data(struct socket *sock)
 {
 	if (unlikely(!sock))
@@ -545,7 +621,7 @@ static void vhost_net_busy_poll(struct vhost_net *net,
 	endtime = busy_clock() + busyloop_timeout;
 
 	while (vhost_can_busy_poll(endtime)) {
-		if (vhost_has_work(&net->dev)) {
+		if (vhost_vq_has_work(poll_rx ? rvq : tvq)) {
 			*busyloop_intr = true;
 			break;
 		}
@@ -852,7 +928,7 @@ done:
 		++nvq->done_idx;
 	} while (likely(!vhost_exceeds_weight(vq, ++sent_pkts, total_len)));
 
-	vhost_tx_batch(net, nvq, sock, &msg);
+	__vhost_tx_batch(net, nvq, sock, &msg, true);
 }
 
 static void handle_tx_zerocopy(struct vhost_net *net, struct socket *sock)
@@ -1331,6 +1407,7 @@ static int vhost_net_open(struct inode *inode, struct file *f)
 		n->vqs[i].upend_idx = 0;
 		n->vqs[i].done_idx = 0;
 		n->vqs[i].batched_xdp = 0;
+		n->vqs[i].used_deferred = false;
 		n->vqs[i].vhost_hlen = 0;
 		n->vqs[i].sock_hlen = 0;
 		n->vqs[i].rx_ring = NULL;
@@ -1341,8 +1418,14 @@ static int vhost_net_open(struct inode *inode, struct file *f)
 		       VHOST_NET_PKT_WEIGHT, VHOST_NET_WEIGHT, true,
 		       NULL);
 
-	vhost_poll_init(n->poll + VHOST_NET_VQ_TX, handle_tx_net, EPOLLOUT, dev);
-	vhost_poll_init(n->poll + VHOST_NET_VQ_RX, handle_rx_net, EPOLLIN, dev);
+	vhost_poll_init(n->poll + VHOST_NET_VQ_TX, handle_tx_net, EPOLLOUT, dev,
+			vqs[VHOST_NET_VQ_TX]);
+	vhost_poll_init(n->poll + VHOST_NET_VQ_RX, handle_rx_net, EPOLLIN, dev,
+			vqs[VHOST_NET_VQ_RX]);
+
+	hrtimer_init(&n->tx_batch_timer, CLOCK_MONOTONIC, HRTIMER_MODE_REL);
+	n->tx_batch_timer.function = vhost_net_tx_batch_timer;
+	vhost_work_init(&n->tx_batch_work, handle_tx_batch_flush);
 
 	f->private_data = n;
 	n->page_frag.page = NULL;
@@ -1373,6 +1456,14 @@ static void vhost_net_stop(struct vhost_net *n, struct socket **tx_sock,
 {
 	*tx_sock = vhost_net_stop_vq(n, &n->vqs[VHOST_NET_VQ_TX].vq);
 	*rx_sock = vhost_net_stop_vq(n, &n->vqs[VHOST_NET_VQ_RX].vq);
+
+	/*
+	 * Without a backend no more TX completions can be deferred, so the
+	 * timer won't be rearmed.  Hand any completions still held back to
+	 * the worker, the caller's flush waits for them to be written.
+	 */
+	hrtimer_cancel(&n->tx_batch_timer);
+	vhost_vq_work_queue(&n->vqs[VHOST_NET_VQ_TX].vq, &n->tx_batch_work);
 }
 
 static void vhost_net_flush(struct vhost_net *n)
@@ -1536,6 +1627,9 @@ static long vhost_net_set_backend(struct vhost_net *n, unsigned index, int fd)
 		}
 
 		vhost_net_disable_vq(n, vq);
+		/* done_idx means something else for a zerocopy socket. */
+		if (nvq->used_deferred)
+			vhost_net_signal_used(nvq);
 		vhost_vq_set_backend(vq, sock);
 		vhost_net_buf_unproduce(nvq);
 		r = vhost_vq_init_access(vq);
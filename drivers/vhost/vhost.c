@@ -187,12 +187,14 @@ EXPORT_SYMBOL_GPL(vhost_work_init);
 
 /* Init poll structure */
 void vhost_poll_init(struct vhost_poll *poll, vhost_work_fn_t fn,
-		     __poll_t mask, struct vhost_dev *dev)
+		     __poll_t mask, struct vhost_dev *dev,
+		     struct vhost_virtqueue *vq)
 {
 	init_waitqueue_func_entry(&poll->wait, vhost_poll_wakeup);
 	init_poll_funcptr(&poll->table, vhost_poll_func);
 	poll->mask = mask;
 	poll->dev = dev;
+	poll->vq = vq;
 	poll->wqh = NULL;
 
 	vhost_work_init(&poll->work, fn);
@@ -231,17 +233,37 @@ void vhost_poll_stop(struct vhost_poll *poll)
 }
 EXPORT_SYMBOL_GPL(vhost_poll_stop);
 
-void vhost_dev_flush(struct vhost_dev *dev)
+static void vhost_worker_queue(struct vhost_worker *worker,
+			       struct vhost_work *work)
+{
+	if (!test_and_set_bit(VHOST_WORK_QUEUED, &work->flags)) {
+		/* We can only add the work to the list after we're
+		 * sure it was not in the list.
+		 * test_and_set_bit() implies a memory barrier.
+		 */
+		llist_add(&work->node, &worker->work_list);
+		wake_up_process(worker->task);
+	}
+}
+
+static void vhost_worker_flush(struct vhost_worker *worker)
 {
 	struct vhost_flush_struct flush;
 
-	if (dev->worker) {
-		init_completion(&flush.wait_event);
-		vhost_work_init(&flush.work, vhost_flush_work);
+	init_completion(&flush.wait_event);
+	vhost_work_init(&flush.work, vhost_flush_work);
 
-		vhost_work_queue(dev, &flush.work);
-		wait_for_completion(&flush.wait_event);
-	}
+	vhost_worker_queue(worker, &flush.work);
+	wait_for_completion(&flush.wait_event);
+}
+
+void vhost_dev_flush(struct vhost_dev *dev)
+{
+	struct vhost_worker *worker;
+	unsigned long i;
+
+	xa_for_each(&dev->worker_xa, i, worker)
+		vhost_worker_flush(worker);
 }
 EXPORT_SYMBOL_GPL(vhost_dev_flush);
 
@@ -250,27 +272,44 @@ void vhost_work_queue(struct vhost_dev *dev, struct vhost_work *work)
 	if (!dev->worker)
 		return;
 
-	if (!test_and_set_bit(VHOST_WORK_QUEUED, &work->flags)) {
-		/* We can only add the work to the list after we're
-		 * sure it was not in the list.
-		 * test_and_set_bit() implies a memory barrier.
-		 */
-		llist_add(&work->node, &dev->work_list);
-		wake_up_process(dev->worker);
-	}
+	vhost_worker_queue(dev->worker, work);
 }
 EXPORT_SYMBOL_GPL(vhost_work_queue);
 
+/* Queue @work on the worker serving @vq, which may not be the default one. */
+void vhost_vq_work_queue(struct vhost_virtqueue *vq, struct vhost_work *work)
+{
+	struct vhost_worker *worker = READ_ONCE(vq->worker);
+
+	if (!worker)
+		return;
+
+	vhost_worker_queue(worker, work);
+}
+EXPORT_SYMBOL_GPL(vhost_vq_work_queue);
+
 /* A lockless hint for busy polling code to exit the loop */
 bool vhost_has_work(struct vhost_dev *dev)
 {
-	return !llist_empty(&dev->work_list);
+	return dev->worker && !llist_empty(&dev->worker->work_list);
 }
 EXPORT_SYMBOL_GPL(vhost_has_work);
 
+/* Same as vhost_has_work(), for the worker serving @vq. */
+bool vhost_vq_has_work(struct vhost_virtqueue *vq)
+{
+	struct vhost_worker *worker = READ_ONCE(vq->worker);
+
+	return worker && !llist_empty(&worker->work_list);
+}
+EXPORT_SYMBOL_GPL(vhost_vq_has_work);
+
 void vhost_poll_queue(struct vhost_poll *poll)
 {
-	vhost_work_queue(poll->dev, &poll->work);
+	if (poll->vq)
+		vhost_vq_work_queue(poll->vq, &poll->work);
+	else
+		vhost_work_queue(poll->dev, &poll->work);
 }
 EXPORT_SYMBOL_GPL(vhost_poll_queue);
 
@@ -335,7 +374,8 @@ static void vhost_vq_reset(struct vhost_dev *dev,
 
 static int vhost_worker(void *data)
 {
-	struct vhost_dev *dev = data;
+	struct vhost_worker *worker = data;
+	struct vhost_dev *dev = worker->dev;
 	struct vhost_work *work, *work_next;
 	struct llist_node *node;
 
@@ -350,7 +390,7 @@ static int vhost_worker(void *data)
 			break;
 		}
 
-		node = llist_del_all(&dev->work_list);
+		node = llist_del_all(&worker->work_list);
 		if (!node)
 			schedule();
 
@@ -474,12 +514,12 @@ void vhost_dev_init(struct vhost_dev *dev,
 	dev->iotlb = NULL;
 	dev->mm = NULL;
 	dev->worker = NULL;
+	xa_init_flags(&dev->worker_xa, XA_FLAGS_ALLOC);
 	dev->iov_limit = iov_limit;
 	dev->weight = weight;
 	dev->byte_weight = byte_weight;
 	dev->use_worker = use_worker;
 	dev->msg_handler = msg_handler;
-	init_llist_head(&dev->work_list);
 	init_waitqueue_head(&dev->wait);
 	INIT_LIST_HEAD(&dev->read_list);
 	INIT_LIST_HEAD(&dev->pending_list);
@@ -492,11 +532,12 @@ void vhost_dev_init(struct vhost_dev *dev,
 		vq->indirect = NULL;
 		vq->heads = NULL;
 		vq->dev = dev;
+		vq->worker = NULL;
 		mutex_init(&vq->mutex);
 		vhost_vq_reset(dev, vq);
 		if (vq->handle_kick)
 			vhost_poll_init(&vq->poll, vq->handle_kick,
-					EPOLLIN, dev);
+					EPOLLIN, dev, vq);
 	}
 }
 EXPORT_SYMBOL_GPL(vhost_dev_init);
@@ -523,17 +564,187 @@ static void vhost_attach_cgroups_work(struct vhost_work *work)
 	s->ret = cgroup_attach_task_all(s->owner, current);
 }
 
-static int vhost_attach_cgroups(struct vhost_dev *dev)
+static int vhost_attach_cgroups(struct vhost_worker *worker)
 {
 	struct vhost_attach_cgroups_struct attach;
 
 	attach.owner = current;
 	vhost_work_init(&attach.work, vhost_attach_cgroups_work);
-	vhost_work_queue(dev, &attach.work);
-	vhost_dev_flush(dev);
+	vhost_worker_queue(worker, &attach.work);
+	vhost_worker_flush(worker);
 	return attach.ret;
 }
 
+static void vhost_worker_free(struct vhost_dev *dev, struct vhost_worker *worker)
+{
+	WARN_ON(!llist_empty(&worker->work_list));
+	xa_erase(&dev->worker_xa, worker->id);
+	kthread_stop(worker->task);
+	kfree(worker);
+}
+
+static void vhost_workers_free(struct vhost_dev *dev)
+{
+	struct vhost_worker *worker;
+	unsigned long i;
+
+	if (!dev->use_worker)
+		return;
+
+	for (i = 0; i < dev->nvqs; i++)
+		dev->vqs[i]->worker = NULL;
+
+	xa_for_each(&dev->worker_xa, i, worker)
+		vhost_worker_free(dev, worker);
+	xa_destroy(&dev->worker_xa);
+	dev->worker = NULL;
+}
+
+/*
+ * Create a worker thread for @dev, optionally restricted to @cpu, that runs
+ * in the owner's mm and cgroups.  The first worker created is the default
+ * one and keeps the historical "vhost-<pid>" name.
+ */
+static struct vhost_worker *vhost_worker_create(struct vhost_dev *dev, int cpu)
+{
+	struct vhost_worker *worker;
+	struct task_struct *task;
+	u32 id;
+	int ret;
+
+	worker = kzalloc(sizeof(*worker), GFP_KERNEL_ACCOUNT);
+	if (!worker)
+		return ERR_PTR(-ENOMEM);
+
+	worker->dev = dev;
+	init_llist_head(&worker->work_list);
+
+	ret = xa_alloc(&dev->worker_xa, &id, worker, xa_limit_32b, GFP_KERNEL);
+	if (ret < 0)
+		goto free_worker;
+	worker->id = id;
+
+	if (id)
+		task = kthread_create(vhost_worker, worker, "vhost-%d-%u",
+				      current->pid, id);
+	else
+		task = kthread_create(vhost_worker, worker, "vhost-%d",
+				      current->pid);
+	if (IS_ERR(task)) {
+		ret = PTR_ERR(task);
+		goto erase_id;
+	}
+
+	if (cpu != VHOST_WORKER_CPU_ANY) {
+		ret = set_cpus_allowed_ptr(task, cpumask_of(cpu));
+		if (ret) {
+			kthread_stop(task);
+			goto erase_id;
+		}
+	}
+
+	worker->task = task;
+	wake_up_process(task); /* avoid contributing to loadavg */
+
+	ret = vhost_attach_cgroups(worker);
+	if (ret) {
+		vhost_worker_free(dev, worker);
+		return ERR_PTR(ret);
+	}
+
+	return worker;
+
+erase_id:
+	xa_erase(&dev->worker_xa, id);
+free_worker:
+	kfree(worker);
+	return ERR_PTR(ret);
+}
+
+static int vhost_new_worker(struct vhost_dev *dev,
+			    struct vhost_worker_state __user *argp)
+{
+	struct vhost_worker_state state;
+	struct vhost_worker *worker;
+
+	if (!dev->use_worker)
+		return -EOPNOTSUPP;
+
+	if (copy_from_user(&state, argp, sizeof(state)))
+		return -EFAULT;
+
+	if (state.cpu != VHOST_WORKER_CPU_ANY &&
+	    (state.cpu < 0 || state.cpu >= nr_cpu_ids || !cpu_online(state.cpu)))
+		return -EINVAL;
+
+	worker = vhost_worker_create(dev, state.cpu);
+	if (IS_ERR(worker))
+		return PTR_ERR(worker);
+
+	state.worker_id = worker->id;
+	if (copy_to_user(argp, &state, sizeof(state))) {
+		vhost_worker_free(dev, worker);
+		return -EFAULT;
+	}
+
+	return 0;
+}
+
+static int vhost_free_worker(struct vhost_dev *dev,
+			     struct vhost_worker_state __user *argp)
+{
+	struct vhost_worker_state state;
+	struct vhost_worker *worker;
+
+	if (copy_from_user(&state, argp, sizeof(state)))
+		return -EFAULT;
+
+	worker = xa_load(&dev->worker_xa, state.worker_id);
+	if (!worker)
+		return -ENODEV;
+
+	/* The default worker lives as long as the owner. */
+	if (worker == dev->worker || worker->attachment_cnt)
+		return -EBUSY;
+
+	vhost_worker_free(dev, worker);
+	return 0;
+}
+
+/* Caller must have device mutex and @vq->mutex */
+static int vhost_vq_attach_worker(struct vhost_virtqueue *vq,
+				  struct vhost_vring_worker *info)
+{
+	struct vhost_dev *dev = vq->dev;
+	struct vhost_worker *worker, *old;
+
+	if (!dev->use_worker)
+		return -EOPNOTSUPP;
+
+	/*
+	 * vq->worker is read locklessly when queueing work, so it can only be
+	 * switched while nothing can queue work for the virtqueue, i.e. before
+	 * it's kicked or has a backend.
+	 */
+	if (vq->kick || vq->private_data)
+		return -EBUSY;
+
+	worker = xa_load(&dev->worker_xa, info->worker_id);
+	if (!worker)
+		return -ENODEV;
+
+	old = vq->worker;
+	if (old == worker)
+		return 0;
+
+	if (old && old != dev->worker)
+		old->attachment_cnt--;
+	if (worker != dev->worker)
+		worker->attachment_cnt++;
+	WRITE_ONCE(vq->worker, worker);
+	return 0;
+}
+
 /* Caller should have device mutex */
 bool vhost_dev_has_owner(struct vhost_dev *dev)
 {
@@ -574,8 +785,8 @@ static void vhost_detach_mm(struct vhost_dev *dev)
 /* Caller should have device mutex */
 long vhost_dev_set_owner(struct vhost_dev *dev)
 {
-	struct task_struct *worker;
-	int err;
+	struct vhost_worker *worker;
+	int err, i;
 
 	/* Is there an owner already? */
 	if (vhost_dev_has_owner(dev)) {
@@ -587,31 +798,24 @@ long vhost_dev_set_owner(struct vhost_dev *dev)
 
 	dev->kcov_handle = kcov_common_handle();
 	if (dev->use_worker) {
-		worker = kthread_create(vhost_worker, dev,
-					"vhost-%d", current->pid);
+		worker = vhost_worker_create(dev, VHOST_WORKER_CPU_ANY);
 		if (IS_ERR(worker)) {
 			err = PTR_ERR(worker);
 			goto err_worker;
 		}
 
 		dev->worker = worker;
-		wake_up_process(worker); /* avoid contributing to loadavg */
-
-		err = vhost_attach_cgroups(dev);
-		if (err)
-			goto err_cgroup;
+		for (i = 0; i < dev->nvqs; i++)
+			WRITE_ONCE(dev->vqs[i]->worker, worker);
 	}
 
 	err = vhost_dev_alloc_iovecs(dev);
 	if (err)
-		goto err_cgroup;
+		goto err_iovecs;
 
 	return 0;
-err_cgroup:
-	if (dev->worker) {
-		kthread_stop(dev->worker);
-		dev->worker = NULL;
-	}
+err_iovecs:
+	vhost_workers_free(dev);
 err_worker:
 	vhost_detach_mm(dev);
 	dev->kcov_handle = 0;
@@ -705,10 +909,8 @@ void vhost_dev_cleanup(struct vhost_dev *dev)
 	dev->iotlb = NULL;
 	vhost_clear_msg(dev);
 	wake_up_interruptible_poll(&dev->wait, EPOLLIN | EPOLLRDNORM);
-	WARN_ON(!llist_empty(&dev->work_list));
 	if (dev->worker) {
-		kthread_stop(dev->worker);
-		dev->worker = NULL;
+		vhost_workers_free(dev);
 		dev->kcov_handle = 0;
 	}
 	vhost_detach_mm(dev);
@@ -1600,6 +1802,7 @@ long vhost_vring_ioctl(struct vhost_dev *d, unsigned int ioctl, void __user *arg
 	struct eventfd_ctx *ctx = NULL;
 	u32 __user *idxp = argp;
 	struct vhost_virtqueue *vq;
+	struct vhost_vring_worker w;
 	struct vhost_vring_state s;
 	struct vhost_vring_file f;
 	u32 idx;
@@ -1622,6 +1825,23 @@ long vhost_vring_ioctl(struct vhost_dev *d, unsigned int ioctl, void __user *arg
 	mutex_lock(&vq->mutex);
 
 	switch (ioctl) {
+	case VHOST_ATTACH_VRING_WORKER:
+		if (copy_from_user(&w, argp, sizeof(w))) {
+			r = -EFAULT;
+			break;
+		}
+		r = vhost_vq_attach_worker(vq, &w);
+		break;
+	case VHOST_GET_VRING_WORKER:
+		if (!vq->worker) {
+			r = -EOPNOTSUPP;
+			break;
+		}
+		w.index = idx;
+		w.worker_id = vq->worker->id;
+		if (copy_to_user(argp, &w, sizeof(w)))
+			r = -EFAULT;
+		break;
 	case VHOST_SET_VRING_BASE:
 		/* Moving base with an active backend?
 		 * You don't want to do that. */
@@ -1777,6 +1997,12 @@ long vhost_dev_ioctl(struct vhost_dev *d, unsigned int ioctl, void __user *argp)
 		goto done;
 
 	switch (ioctl) {
+	case VHOST_NEW_WORKER:
+		r = vhost_new_worker(d, argp);
+		break;
+	case VHOST_FREE_WORKER:
+		r = vhost_free_worker(d, argp);
+		break;
 	case VHOST_SET_MEM_TABLE:
 		r = vhost_set_memory(d, argp);
 		break;
@@ -308,6 +308,29 @@ static int search_csum_tree(struct btrfs_fs_info *fs_info,
 
 		if (in_range(disk_bytenr, csum_start, csum_len))
 			goto found;
+
+		/*
+		 * Sequential reads mostly continue into the next csum item of
+		 * the same leaf, take it without searching the tree again.
+		 */
+		if (path->slots[0] + 1 < btrfs_header_nritems(path->nodes[0])) {
+			btrfs_item_key_to_cpu(path->nodes[0], &key,
+					      path->slots[0] + 1);
+			itemsize = btrfs_item_size(path->nodes[0],
+						   path->slots[0] + 1);
+			csum_start = key.offset;
+			csum_len = (itemsize / csum_size) * sectorsize;
+
+			if (key.objectid == BTRFS_EXTENT_CSUM_OBJECTID &&
+			    key.type == BTRFS_EXTENT_CSUM_KEY &&
+			    in_range(disk_bytenr, csum_start, csum_len)) {
+				path->slots[0]++;
+				item = btrfs_item_ptr(path->nodes[0],
+						      path->slots[0],
+						      struct btrfs_csum_item);
+				goto found;
+			}
+		}
 	}
 
 	/* Current item doesn't contain the desired range, search again */
@@ -2259,18 +2259,39 @@ static void scrub_submit(struct scrub_ctx *sctx)
 	submit_bio(sbio->bio);
 }
 
+/*
+ * Limit of read bios in flight at once.  Can be lowered from the default of
+ * SCRUB_BIOS_PER_SCTX via /sys/fs/UUID/devinfo/devid/scrub_queue_depth, to
+ * keep the latency of other I/O to the device down while scrub is running.
+ */
+static int scrub_queue_depth(struct btrfs_device *device)
+{
+	u32 depth = READ_ONCE(device->scrub_queue_depth);
+
+	if (depth == 0 || depth > SCRUB_BIOS_PER_SCTX)
+		return SCRUB_BIOS_PER_SCTX;
+	return depth;
+}
+
 static int scrub_add_sector_to_rd_bio(struct scrub_ctx *sctx,
 				      struct scrub_sector *sector)
 {
 	struct scrub_block *sblock = sector->sblock;
 	struct scrub_bio *sbio;
 	const u32 sectorsize = sctx->fs_info->sectorsize;
+	int depth;
 	int ret;
 
 again:
 	/*
 	 * grab a fresh bio or wait for one to become available
 	 */
+	if (sctx->curr == -1) {
+		depth = scrub_queue_depth(sblock->dev);
+		if (depth < SCRUB_BIOS_PER_SCTX)
+			wait_event(sctx->list_wait,
+				   atomic_read(&sctx->bios_in_flight) < depth);
+	}
 	while (sctx->curr == -1) {
 		spin_lock(&sctx->list_lock);
 		sctx->curr = sctx->first_free;
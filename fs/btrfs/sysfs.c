@@ -1712,6 +1712,35 @@ static ssize_t btrfs_devinfo_scrub_speed_max_store(struct kobject *kobj,
 BTRFS_ATTR_RW(devid, scrub_speed_max, btrfs_devinfo_scrub_speed_max_show,
 	      btrfs_devinfo_scrub_speed_max_store);
 
+static ssize_t btrfs_devinfo_scrub_queue_depth_show(struct kobject *kobj,
+						    struct kobj_attribute *a,
+						    char *buf)
+{
+	struct btrfs_device *device = container_of(kobj, struct btrfs_device,
+						   devid_kobj);
+
+	return sysfs_emit(buf, "%u\n", READ_ONCE(device->scrub_queue_depth));
+}
+
+static ssize_t btrfs_devinfo_scrub_queue_depth_store(struct kobject *kobj,
+						     struct kobj_attribute *a,
+						     const char *buf, size_t len)
+{
+	struct btrfs_device *device = container_of(kobj, struct btrfs_device,
+						   devid_kobj);
+	u32 depth;
+	int ret;
+
+	ret = kstrtou32(buf, 0, &depth);
+	if (ret)
+		return ret;
+
+	WRITE_ONCE(device->scrub_queue_depth, depth);
+	return len;
+}
+BTRFS_ATTR_RW(devid, scrub_queue_depth, btrfs_devinfo_scrub_queue_depth_show,
+	      btrfs_devinfo_scrub_queue_depth_store);
+
 static ssize_t btrfs_devinfo_writeable_show(struct kobject *kobj,
 					    struct kobj_attribute *a, char *buf)
 {
@@ -1775,6 +1804,7 @@ static struct attribute *devid_attrs[] = {
 	BTRFS_ATTR_PTR(devid, missing),
 	BTRFS_ATTR_PTR(devid, replace_target),
 	BTRFS_ATTR_PTR(devid, scrub_speed_max),
+	BTRFS_ATTR_PTR(devid, scrub_queue_depth),
 	BTRFS_ATTR_PTR(devid, writeable),
 	NULL
 };
@@ -180,6 +180,9 @@ struct btrfs_device {
 
 	/* Bandwidth limit for scrub, in bytes */
 	u64 scrub_speed_max;
+
+	/* Limit of scrub bios in flight, 0 for the built-in maximum */
+	u32 scrub_queue_depth;
 };
 
 /*
@@ -2064,7 +2064,11 @@ int ceph_trim_caps(struct ceph_mds_client *mdsc,
 			trim_caps - remaining);
 	}
 
-	ceph_flush_cap_releases(mdsc, session);
+	/* Don't bounce through the workqueue if nothing was released */
+	spin_lock(&session->s_cap_lock);
+	if (session->s_num_cap_releases)
+		ceph_flush_cap_releases(mdsc, session);
+	spin_unlock(&session->s_cap_lock);
 	return 0;
 }
 
@@ -174,6 +174,33 @@ static long get_nr_dentry_negative(void)
 	return sum < 0 ? 0 : sum;
 }
 
+/*
+ * Unused negative dentries only cache failed lookups. Past
+ * dentry-negative-max of them, a negative dentry which is not on the LRU yet
+ * is killed on its final dput() rather than added; the ones already cached
+ * keep their place and age out through the shrinker as usual.
+ */
+static unsigned long dentry_negative_max __read_mostly;
+static unsigned long dentry_negative_stamp;
+static bool dentry_negative_over;
+
+static bool d_negative_over_limit(void)
+{
+	unsigned long max = READ_ONCE(dentry_negative_max);
+	unsigned long now = jiffies;
+
+	if (!max)
+		return false;
+
+	/* summing up the per-cpu counters is not cheap, do it once a tick */
+	if (READ_ONCE(dentry_negative_stamp) != now) {
+		WRITE_ONCE(dentry_negative_stamp, now);
+		WRITE_ONCE(dentry_negative_over,
+			   get_nr_dentry_negative() > max);
+	}
+	return READ_ONCE(dentry_negative_over);
+}
+
 static int proc_nr_dentry(struct ctl_table *table, int write, void *buffer,
 			  size_t *lenp, loff_t *ppos)
 {
@@ -191,6 +218,13 @@ static struct ctl_table fs_dcache_sysctls[] = {
 		.mode		= 0444,
 		.proc_handler	= proc_nr_dentry,
 	},
+	{
+		.procname	= "dentry-negative-max",
+		.data		= &dentry_negative_max,
+		.maxlen		= sizeof(dentry_negative_max),
+		.mode		= 0644,
+		.proc_handler	= proc_doulongvec_minmax,
+	},
 	{ }
 };
 
@@ -200,6 +234,11 @@ static int __init init_fs_dcache_sysctls(void)
 	return 0;
 }
 fs_initcall(init_fs_dcache_sysctls);
+#else
+static inline bool d_negative_over_limit(void)
+{
+	return false;
+}
 #endif
 
 /*
@@ -679,6 +718,10 @@ static inline bool retain_dentry(struct dentry *dentry)
 	if (unlikely(dentry->d_flags & DCACHE_DONTCACHE))
 		return false;
 
+	if (unlikely(d_is_negative(dentry)) &&
+	    !(dentry->d_flags & DCACHE_LRU_LIST) && d_negative_over_limit())
+		return false;
+
 	/* retain; LRU fodder */
 	dentry->d_lockref.count--;
 	if (unlikely(!(dentry->d_flags & DCACHE_LRU_LIST)))
@@ -1616,8 +1616,8 @@ struct ext4_sb_info {
 	unsigned int s_mb_max_inode_prealloc;
 	unsigned int s_max_dir_size_kb;
 	/* where last allocation was done - for stream allocation */
-	unsigned long s_mb_last_group;
-	unsigned long s_mb_last_start;
+	ext4_group_t *s_mb_last_groups;	/* stream allocation goals */
+	unsigned int s_mb_nr_global_goals;
 	unsigned int s_mb_prefetch;
 	unsigned int s_mb_prefetch_limit;
 
@@ -1758,6 +1758,8 @@ struct ext4_sb_info {
 	spinlock_t s_fc_lock;
 	struct buffer_head *s_fc_bh;
 	struct ext4_fc_stats s_fc_stats;
+	ktime_t s_fc_last_end;		/* when the last fast commit ended */
+	pid_t s_fc_last_sync_writer;	/* task that did the last fast commit */
 	tid_t s_fc_ineligible_tid;
 #ifdef CONFIG_EXT4_DEBUG
 	int s_fc_debug_max_replay;
@@ -1180,6 +1180,40 @@ static void ext4_fc_update_stats(struct super_block *sb, int status,
 	trace_ext4_fc_commit_stop(sb, nblks, status, commit_tid);
 }
 
+/*
+ * As jbd2_journal_stop() does for full commits, let other fsync()ers queue
+ * their inodes when a burst starts right after a fast commit, so that a
+ * single fast commit covers them all. The wait is bounded by the average
+ * fast commit time and the journal batch times. A task issuing a stream of
+ * fsyncs on its own has nobody to wait for.
+ */
+static void ext4_fc_batch_wait(struct ext4_sb_info *sbi, journal_t *journal)
+{
+	u64 commit_time, since_last;
+	pid_t pid = current->pid;
+	ktime_t now, expires;
+
+	if (!journal->j_max_batch_time ||
+	    READ_ONCE(sbi->s_fc_last_sync_writer) == pid)
+		return;
+
+	WRITE_ONCE(sbi->s_fc_last_sync_writer, pid);
+
+	commit_time = READ_ONCE(sbi->s_fc_stats.s_fc_avg_commit_time);
+	commit_time = clamp_t(u64, commit_time,
+			      1000 * journal->j_min_batch_time,
+			      1000 * journal->j_max_batch_time);
+
+	now = ktime_get();
+	since_last = ktime_to_ns(ktime_sub(now, READ_ONCE(sbi->s_fc_last_end)));
+	if (since_last >= commit_time)
+		return;
+
+	expires = ktime_add_ns(now, commit_time - since_last);
+	set_current_state(TASK_UNINTERRUPTIBLE);
+	schedule_hrtimeout(&expires, HRTIMER_MODE_ABS);
+}
+
 /*
  * The main commit entry point. Performs a fast commit for transaction
  * commit_tid if needed. If it's not possible to perform a fast commit
@@ -1191,7 +1225,7 @@ int ext4_fc_commit(journal_t *journal, tid_t commit_tid)
 	struct super_block *sb = journal->j_private;
 	struct ext4_sb_info *sbi = EXT4_SB(sb);
 	int nblks = 0, ret, bsize = journal->j_blocksize;
-	int subtid = atomic_read(&sbi->s_fc_subtid);
+	int subtid;
 	int status = EXT4_FC_STATUS_OK, fc_bufs_before = 0;
 	ktime_t start_time, commit_time;
 
@@ -1200,6 +1234,9 @@ int ext4_fc_commit(journal_t *journal, tid_t commit_tid)
 
 	trace_ext4_fc_commit_start(sb, commit_tid);
 
+	ext4_fc_batch_wait(sbi, journal);
+	subtid = atomic_read(&sbi->s_fc_subtid);
+
 	start_time = ktime_get();
 
 restart_fc:
@@ -1245,11 +1282,12 @@ restart_fc:
 	}
 	atomic_inc(&sbi->s_fc_subtid);
 	ret = jbd2_fc_end_commit(journal);
+	WRITE_ONCE(sbi->s_fc_last_end, ktime_get());
 	/*
 	 * weight the commit time higher than the average time so we
 	 * don't react too strongly to vast changes in the commit time
 	 */
-	commit_time = ktime_to_ns(ktime_sub(ktime_get(), start_time));
+	commit_time = ktime_to_ns(ktime_sub(sbi->s_fc_last_end, start_time));
 	ext4_fc_update_stats(sb, status, commit_time, nblks, commit_tid);
 	return ret;
 
@@ -411,6 +411,8 @@ void __init files_init(void)
 {
 	filp_cachep = kmem_cache_create("filp", sizeof(struct file), 0,
 			SLAB_HWCACHE_ALIGN | SLAB_PANIC | SLAB_ACCOUNT, NULL);
+	/* open/close heavy workloads churn through struct file */
+	kmem_cache_setup_percpu_array(filp_cachep, 32);
 	percpu_counter_init(&nr_files, 0, GFP_KERNEL);
 }
 
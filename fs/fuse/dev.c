@@ -206,13 +206,19 @@ static unsigned int fuse_req_hash(u64 unique)
 
 /**
  * A new request is available, wake fiq->waitq
+ *
+ * The wakeup is done after dropping fiq->lock, so that the woken reader does
+ * not immediately spin on the lock still held by the waker.  The reader
+ * rechecks request_pending() after queueing itself on fiq->waitq, and the
+ * caller holds a reference on the connection, so this cannot miss a wakeup
+ * or touch a freed queue.
  */
 static void fuse_dev_wake_and_unlock(struct fuse_iqueue *fiq)
 __releases(fiq->lock)
 {
+	spin_unlock(&fiq->lock);
 	wake_up(&fiq->waitq);
 	kill_fasync(&fiq->fasync, SIGIO, POLL_IN);
-	spin_unlock(&fiq->lock);
 }
 
 const struct fuse_iqueue_ops fuse_dev_fiq_ops = {
@@ -2280,6 +2286,32 @@ static long fuse_dev_ioctl(struct file *file, unsigned int cmd,
 			}
 		}
 		break;
+	case FUSE_DEV_IOC_BACKING_OPEN: {
+		struct fuse_backing_map map;
+
+		res = -EFAULT;
+		if (copy_from_user(&map, (void __user *)arg, sizeof(map)))
+			break;
+
+		res = -EINVAL;
+		fud = fuse_get_dev(file);
+		if (fud)
+			res = fuse_backing_open(fud->fc, &map);
+		break;
+	}
+	case FUSE_DEV_IOC_BACKING_CLOSE: {
+		__u32 backing_id;
+
+		res = -EFAULT;
+		if (get_user(backing_id, (__u32 __user *)arg))
+			break;
+
+		res = -EINVAL;
+		fud = fuse_get_dev(file);
+		if (fud)
+			res = fuse_backing_close(fud->fc, backing_id);
+		break;
+	}
 	default:
 		res = -ENOTTY;
 		break;
@@ -31,6 +31,7 @@
 #include <linux/pid_namespace.h>
 #include <linux/refcount.h>
 #include <linux/user_namespace.h>
+#include <linux/idr.h>
 
 /** Default max number of pages that can be used in a single read request */
 #define FUSE_DEFAULT_MAX_PAGES_PER_REQ 32
@@ -226,6 +227,20 @@ struct fuse_file {
 
 	/** Has flock been performed on this file? */
 	bool flock:1;
+
+	/** Backing file for FOPEN_PASSTHROUGH, NULL otherwise */
+	struct fuse_backing *passthrough;
+};
+
+/** Backing file registered with FUSE_DEV_IOC_BACKING_OPEN */
+struct fuse_backing {
+	struct file *file;
+
+	/** Credentials of the server, used for I/O on @file */
+	const struct cred *cred;
+
+	/** Held by fuse_conn->backing_files_map and each passthrough file */
+	refcount_t count;
 };
 
 /** One input argument of a request */
@@ -787,6 +802,12 @@ struct fuse_conn {
 	/* Is tmpfile not implemented by fs? */
 	unsigned int no_tmpfile:1;
 
+	/* Can files be opened with FOPEN_PASSTHROUGH? */
+	unsigned int passthrough:1;
+
+	/* Backing files must be on a filesystem below this stack depth */
+	unsigned int max_stack_depth;
+
 	/** The number of requests waiting for completion */
 	atomic_t num_waiting;
 
@@ -836,6 +857,9 @@ struct fuse_conn {
 
 	/* New writepages go into this bucket */
 	struct fuse_sync_bucket __rcu *curr_bucket;
+
+	/** Backing files by backing_id, protected by fc->lock */
+	struct idr backing_files_map;
 };
 
 /*
@@ -1318,5 +1342,16 @@ struct fuse_file *fuse_file_open(struct fuse_mount *fm, u64 nodeid,
 				 unsigned int open_flags, bool isdir);
 void fuse_file_release(struct inode *inode, struct fuse_file *ff,
 		       unsigned int open_flags, fl_owner_t id, bool isdir);
+bool fuse_file_is_fuse(const struct file *file);
+
+/* passthrough.c */
+int fuse_backing_open(struct fuse_conn *fc, struct fuse_backing_map *map);
+int fuse_backing_close(struct fuse_conn *fc, int backing_id);
+void fuse_backing_files_free(struct fuse_conn *fc);
+void fuse_passthrough_open(struct fuse_conn *fc, struct fuse_file *ff,
+			   int backing_id);
+void fuse_passthrough_release(struct fuse_file *ff);
+ssize_t fuse_passthrough_read_iter(struct kiocb *iocb, struct iov_iter *to);
+ssize_t fuse_passthrough_write_iter(struct kiocb *iocb, struct iov_iter *from);
 
 #endif /* _FS_FUSE_I_H */
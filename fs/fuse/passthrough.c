@@ -0,0 +1,263 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * FUSE passthrough: read and write on a backing file without a round trip
+ * to the server.
+ *
+ * The server registers an open file with FUSE_DEV_IOC_BACKING_OPEN and
+ * replies to OPEN or CREATE with FOPEN_PASSTHROUGH and the returned
+ * backing_id.  Data I/O on the fuse file is then done by the kernel on the
+ * backing file, with the credentials the server had when registering it.
+ * The backing file is used with the open flags the server gave it, so e.g.
+ * O_DIRECT on the fuse file only takes effect if the backing file has it.
+ */
+
+#include "fuse_i.h"
+
+#include <linux/capability.h>
+#include <linux/cred.h>
+#include <linux/file.h>
+#include <linux/uio.h>
+
+static struct fuse_backing *fuse_backing_get(struct fuse_backing *fb)
+{
+	refcount_inc(&fb->count);
+	return fb;
+}
+
+static void fuse_backing_put(struct fuse_backing *fb)
+{
+	if (refcount_dec_and_test(&fb->count)) {
+		fput(fb->file);
+		put_cred(fb->cred);
+		kfree(fb);
+	}
+}
+
+int fuse_backing_open(struct fuse_conn *fc, struct fuse_backing_map *map)
+{
+	struct fuse_backing *fb;
+	struct file *file;
+	int res;
+
+	/* Any user of the mount does I/O on the file as the server */
+	if (!fc->passthrough || !capable(CAP_SYS_ADMIN))
+		return -EPERM;
+
+	if (map->flags || map->padding)
+		return -EINVAL;
+
+	file = fget(map->fd);
+	if (!file)
+		return -EBADF;
+
+	/*
+	 * Only regular files of other filesystems: the fuse device or a fuse
+	 * file would make the connection hold a reference to itself, or
+	 * recurse into fuse on I/O.
+	 */
+	res = -EINVAL;
+	if (!d_is_reg(file->f_path.dentry) || fuse_file_is_fuse(file))
+		goto out_fput;
+
+	res = -EOPNOTSUPP;
+	if (!file->f_op->read_iter || !file->f_op->write_iter)
+		goto out_fput;
+
+	/* This mount is stacked at max_stack_depth, above its backing files */
+	res = -ELOOP;
+	if (file_inode(file)->i_sb->s_stack_depth >= fc->max_stack_depth)
+		goto out_fput;
+
+	res = -ENOMEM;
+	fb = kmalloc(sizeof(*fb), GFP_KERNEL);
+	if (!fb)
+		goto out_fput;
+
+	fb->file = file;
+	fb->cred = get_current_cred();
+	refcount_set(&fb->count, 1);
+
+	idr_preload(GFP_KERNEL);
+	spin_lock(&fc->lock);
+	res = idr_alloc_cyclic(&fc->backing_files_map, fb, 1, 0, GFP_ATOMIC);
+	spin_unlock(&fc->lock);
+	idr_preload_end();
+
+	if (res < 0)
+		fuse_backing_put(fb);
+	return res;
+
+out_fput:
+	fput(file);
+	return res;
+}
+
+int fuse_backing_close(struct fuse_conn *fc, int backing_id)
+{
+	struct fuse_backing *fb;
+
+	if (!fc->passthrough || !capable(CAP_SYS_ADMIN))
+		return -EPERM;
+
+	if (backing_id <= 0)
+		return -EINVAL;
+
+	spin_lock(&fc->lock);
+	fb = idr_remove(&fc->backing_files_map, backing_id);
+	spin_unlock(&fc->lock);
+	if (!fb)
+		return -ENOENT;
+
+	/* Files already opened in passthrough mode keep their reference */
+	fuse_backing_put(fb);
+	return 0;
+}
+
+static int fuse_backing_id_free(int id, void *p, void *data)
+{
+	fuse_backing_put(p);
+	return 0;
+}
+
+void fuse_backing_files_free(struct fuse_conn *fc)
+{
+	idr_for_each(&fc->backing_files_map, fuse_backing_id_free, NULL);
+	idr_destroy(&fc->backing_files_map);
+}
+
+/*
+ * Attach the backing file to a file opened with FOPEN_PASSTHROUGH.  If the
+ * server did not negotiate FUSE_PASSTHROUGH or passed an unknown backing_id,
+ * the file falls back to doing I/O through the server.
+ */
+void fuse_passthrough_open(struct fuse_conn *fc, struct fuse_file *ff,
+			   int backing_id)
+{
+	struct fuse_backing *fb = NULL;
+
+	if (fc->passthrough && backing_id > 0) {
+		spin_lock(&fc->lock);
+		fb = idr_find(&fc->backing_files_map, backing_id);
+		if (fb)
+			fuse_backing_get(fb);
+		spin_unlock(&fc->lock);
+	}
+
+	if (!fb) {
+		pr_warn_ratelimited("fuse: invalid backing_id %d, passthrough disabled\n",
+				    backing_id);
+		ff->open_flags &= ~FOPEN_PASSTHROUGH;
+		return;
+	}
+
+	ff->passthrough = fb;
+}
+
+void fuse_passthrough_release(struct fuse_file *ff)
+{
+	if (ff->passthrough) {
+		fuse_backing_put(ff->passthrough);
+		ff->passthrough = NULL;
+	}
+}
+
+static rwf_t fuse_iocb_to_rwf(int ifl)
+{
+	rwf_t flags = 0;
+
+	if (ifl & IOCB_NOWAIT)
+		flags |= RWF_NOWAIT;
+	if (ifl & IOCB_HIPRI)
+		flags |= RWF_HIPRI;
+	if (ifl & IOCB_DSYNC)
+		flags |= RWF_DSYNC;
+	if (ifl & IOCB_SYNC)
+		flags |= RWF_SYNC;
+	if (ifl & IOCB_APPEND)
+		flags |= RWF_APPEND;
+
+	return flags;
+}
+
+/*
+ * The fuse inode may still have page cache from mmap, which is served by the
+ * server.  Write back dirty pages over the range before going to the backing
+ * file, the same way direct I/O does.
+ */
+static int fuse_passthrough_sync_range(struct inode *inode, loff_t pos,
+				       size_t count)
+{
+	return filemap_write_and_wait_range(inode->i_mapping, pos,
+					    pos + count - 1);
+}
+
+ssize_t fuse_passthrough_read_iter(struct kiocb *iocb, struct iov_iter *to)
+{
+	struct file *file = iocb->ki_filp;
+	struct inode *inode = file_inode(file);
+	struct fuse_file *ff = file->private_data;
+	struct fuse_backing *fb = ff->passthrough;
+	const struct cred *old_cred;
+	ssize_t ret;
+
+	if (!iov_iter_count(to))
+		return 0;
+
+	ret = fuse_passthrough_sync_range(inode, iocb->ki_pos,
+					  iov_iter_count(to));
+	if (ret)
+		return ret;
+
+	old_cred = override_creds(fb->cred);
+	ret = vfs_iter_read(fb->file, to, &iocb->ki_pos,
+			    fuse_iocb_to_rwf(iocb->ki_flags));
+	revert_creds(old_cred);
+
+	fuse_invalidate_atime(inode);
+	return ret;
+}
+
+ssize_t fuse_passthrough_write_iter(struct kiocb *iocb, struct iov_iter *from)
+{
+	struct file *file = iocb->ki_filp;
+	struct inode *inode = file_inode(file);
+	struct fuse_file *ff = file->private_data;
+	struct fuse_backing *fb = ff->passthrough;
+	struct address_space *mapping = inode->i_mapping;
+	size_t count = iov_iter_count(from);
+	const struct cred *old_cred;
+	loff_t pos;
+	ssize_t ret;
+
+	if (!count)
+		return 0;
+
+	inode_lock(inode);
+	if (iocb->ki_flags & IOCB_APPEND)
+		ret = filemap_write_and_wait(mapping);
+	else
+		ret = fuse_passthrough_sync_range(inode, iocb->ki_pos, count);
+	if (ret)
+		goto out_unlock;
+
+	old_cred = override_creds(fb->cred);
+	file_start_write(fb->file);
+	ret = vfs_iter_write(fb->file, from, &iocb->ki_pos,
+			     fuse_iocb_to_rwf(iocb->ki_flags));
+	file_end_write(fb->file);
+	revert_creds(old_cred);
+
+	if (ret > 0) {
+		fuse_write_update_attr(inode, iocb->ki_pos, ret);
+
+		/* Drop cached pages the write went around */
+		pos = iocb->ki_pos - ret;
+		if (mapping->nrpages)
+			invalidate_inode_pages2_range(mapping,
+					pos >> PAGE_SHIFT,
+					(iocb->ki_pos - 1) >> PAGE_SHIFT);
+	}
+out_unlock:
+	inode_unlock(inode);
+	return ret;
+}
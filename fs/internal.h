@@ -197,6 +197,7 @@ int sb_init_dio_done_wq(struct super_block *sb);
 int getname_statx_lookup_flags(int flags);
 int do_statx(int dfd, struct filename *filename, unsigned int flags,
 	     unsigned int mask, struct statx __user *buffer);
+void kstat_to_statx(const struct kstat *stat, struct statx *stx);
 
 /*
  * fs/splice.c:
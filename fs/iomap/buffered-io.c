@@ -25,13 +25,16 @@
 
 /*
  * Structure allocated for each folio when block size < folio size
- * to track sub-folio uptodate status and I/O completions.
+ * to track sub-folio uptodate and dirty status and I/O completions.
+ *
+ * The first nr_blocks bits of @state are the per-block uptodate bits, the
+ * next nr_blocks bits the per-block dirty bits.
  */
 struct iomap_page {
 	atomic_t		read_bytes_pending;
 	atomic_t		write_bytes_pending;
-	spinlock_t		uptodate_lock;
-	unsigned long		uptodate[];
+	spinlock_t		state_lock;
+	unsigned long		state[];
 };
 
 static inline struct iomap_page *to_iomap_page(struct folio *folio)
@@ -58,12 +61,14 @@ iomap_page_create(struct inode *inode, struct folio *folio, unsigned int flags)
 	else
 		gfp = GFP_NOFS | __GFP_NOFAIL;
 
-	iop = kzalloc(struct_size(iop, uptodate, BITS_TO_LONGS(nr_blocks)),
+	iop = kzalloc(struct_size(iop, state, BITS_TO_LONGS(2 * nr_blocks)),
 		      gfp);
 	if (iop) {
-		spin_lock_init(&iop->uptodate_lock);
+		spin_lock_init(&iop->state_lock);
 		if (folio_test_uptodate(folio))
-			bitmap_fill(iop->uptodate, nr_blocks);
+			bitmap_set(iop->state, 0, nr_blocks);
+		if (folio_test_dirty(folio))
+			bitmap_set(iop->state, nr_blocks, nr_blocks);
 		folio_attach_private(folio, iop);
 	}
 	return iop;
@@ -79,7 +84,7 @@ static void iomap_page_release(struct folio *folio)
 		return;
 	WARN_ON_ONCE(atomic_read(&iop->read_bytes_pending));
 	WARN_ON_ONCE(atomic_read(&iop->write_bytes_pending));
-	WARN_ON_ONCE(bitmap_full(iop->uptodate, nr_blocks) !=
+	WARN_ON_ONCE(bitmap_full(iop->state, nr_blocks) !=
 			folio_test_uptodate(folio));
 	kfree(iop);
 }
@@ -110,7 +115,7 @@ static void iomap_adjust_read_range(struct inode *inode, struct folio *folio,
 
 		/* move forward for each leading block marked uptodate */
 		for (i = first; i <= last; i++) {
-			if (!test_bit(i, iop->uptodate))
+			if (!test_bit(i, iop->state))
 				break;
 			*pos += block_size;
 			poff += block_size;
@@ -120,7 +125,7 @@ static void iomap_adjust_read_range(struct inode *inode, struct folio *folio,
 
 		/* truncate len if we find any trailing uptodate block(s) */
 		for ( ; i <= last; i++) {
-			if (test_bit(i, iop->uptodate)) {
+			if (test_bit(i, iop->state)) {
 				plen -= (last - i + 1) * block_size;
 				last = i - 1;
 				break;
@@ -152,11 +157,11 @@ static void iomap_iop_set_range_uptodate(struct folio *folio,
 	unsigned last = (off + len - 1) >> inode->i_blkbits;
 	unsigned long flags;
 
-	spin_lock_irqsave(&iop->uptodate_lock, flags);
-	bitmap_set(iop->uptodate, first, last - first + 1);
-	if (bitmap_full(iop->uptodate, i_blocks_per_folio(inode, folio)))
+	spin_lock_irqsave(&iop->state_lock, flags);
+	bitmap_set(iop->state, first, last - first + 1);
+	if (bitmap_full(iop->state, i_blocks_per_folio(inode, folio)))
 		folio_mark_uptodate(folio);
-	spin_unlock_irqrestore(&iop->uptodate_lock, flags);
+	spin_unlock_irqrestore(&iop->state_lock, flags);
 }
 
 static void iomap_set_range_uptodate(struct folio *folio,
@@ -168,6 +173,48 @@ static void iomap_set_range_uptodate(struct folio *folio,
 		folio_mark_uptodate(folio);
 }
 
+static bool iomap_block_is_dirty(struct folio *folio, struct iomap_page *iop,
+		unsigned int block)
+{
+	struct inode *inode = folio->mapping->host;
+
+	return test_bit(block + i_blocks_per_folio(inode, folio), iop->state);
+}
+
+static void iomap_iop_set_range_dirty(struct folio *folio,
+		struct iomap_page *iop, size_t off, size_t len, bool dirty)
+{
+	struct inode *inode = folio->mapping->host;
+	unsigned int nr_blocks = i_blocks_per_folio(inode, folio);
+	unsigned first = off >> inode->i_blkbits;
+	unsigned last = (off + len - 1) >> inode->i_blkbits;
+	unsigned long flags;
+
+	spin_lock_irqsave(&iop->state_lock, flags);
+	if (dirty)
+		bitmap_set(iop->state, nr_blocks + first, last - first + 1);
+	else
+		bitmap_clear(iop->state, nr_blocks + first, last - first + 1);
+	spin_unlock_irqrestore(&iop->state_lock, flags);
+}
+
+static void iomap_set_range_dirty(struct folio *folio, size_t off, size_t len)
+{
+	struct iomap_page *iop = to_iomap_page(folio);
+
+	if (iop && len)
+		iomap_iop_set_range_dirty(folio, iop, off, len, true);
+}
+
+static void iomap_clear_range_dirty(struct folio *folio, size_t off,
+		size_t len)
+{
+	struct iomap_page *iop = to_iomap_page(folio);
+
+	if (iop && len)
+		iomap_iop_set_range_dirty(folio, iop, off, len, false);
+}
+
 static void iomap_finish_folio_read(struct folio *folio, size_t offset,
 		size_t len, int error)
 {
@@ -451,7 +498,7 @@ bool iomap_is_partially_uptodate(struct folio *folio, size_t from, size_t count)
 	last = (from + count - 1) >> inode->i_blkbits;
 
 	for (i = first; i <= last; i++)
-		if (!test_bit(i, iop->uptodate))
+		if (!test_bit(i, iop->state))
 			return false;
 	return true;
 }
@@ -497,6 +544,22 @@ void iomap_invalidate_folio(struct folio *folio, size_t offset, size_t len)
 }
 EXPORT_SYMBOL_GPL(iomap_invalidate_folio);
 
+/*
+ * Dirtying a folio from outside the buffered write path, e.g. through a write
+ * fault, dirties all of its blocks.  Filesystems that use iomap for buffered
+ * writeback must use this as their ->dirty_folio method so that the per-block
+ * dirty state stays in sync with the folio.
+ */
+bool iomap_dirty_folio(struct address_space *mapping, struct folio *folio)
+{
+	struct inode *inode = mapping->host;
+
+	iomap_page_create(inode, folio, 0);
+	iomap_set_range_dirty(folio, 0, folio_size(folio));
+	return filemap_dirty_folio(mapping, folio);
+}
+EXPORT_SYMBOL_GPL(iomap_dirty_folio);
+
 static void
 iomap_write_failed(struct inode *inode, loff_t pos, unsigned len)
 {
@@ -686,6 +749,7 @@ static size_t __iomap_write_end(struct inode *inode, loff_t pos, size_t len,
 	if (unlikely(copied < len && !folio_test_uptodate(folio)))
 		return 0;
 	iomap_set_range_uptodate(folio, iop, offset_in_folio(folio, pos), len);
+	iomap_set_range_dirty(folio, offset_in_folio(folio, pos), copied);
 	filemap_dirty_folio(inode->i_mapping, folio);
 	return copied;
 }
@@ -872,12 +936,46 @@ EXPORT_SYMBOL_GPL(iomap_file_buffered_write);
  * This function uses [start_byte, end_byte) intervals (i.e. open ended) to
  * simplify range iterations.
  */
+static int iomap_write_delalloc_iop_punch(struct inode *inode,
+		struct folio *folio, loff_t start_byte, loff_t end_byte,
+		int (*punch)(struct inode *inode, loff_t offset, loff_t length))
+{
+	struct iomap_page *iop = to_iomap_page(folio);
+	unsigned int first_blk, last_blk, i;
+	u8 blkbits = inode->i_blkbits;
+	loff_t last_byte;
+	int error;
+
+	/*
+	 * With per-block dirty tracking, a dirty folio can have clean blocks
+	 * that writeback won't touch.  Punch those out, or their delalloc
+	 * reservations leak.
+	 */
+	if (!iop)
+		return 0;
+
+	last_byte = min_t(loff_t, end_byte - 1,
+			folio_pos(folio) + folio_size(folio) - 1);
+	first_blk = offset_in_folio(folio, start_byte) >> blkbits;
+	last_blk = offset_in_folio(folio, last_byte) >> blkbits;
+	for (i = first_blk; i <= last_blk; i++) {
+		if (iomap_block_is_dirty(folio, iop, i))
+			continue;
+		error = punch(inode, folio_pos(folio) + ((loff_t)i << blkbits),
+				1 << blkbits);
+		if (error)
+			return error;
+	}
+	return 0;
+}
+
 static int iomap_write_delalloc_scan(struct inode *inode,
 		loff_t *punch_start_byte, loff_t start_byte, loff_t end_byte,
 		int (*punch)(struct inode *inode, loff_t offset, loff_t length))
 {
 	while (start_byte < end_byte) {
 		struct folio	*folio;
+		int		error;
 
 		/* grab locked page */
 		folio = filemap_lock_folio(inode->i_mapping,
@@ -891,8 +989,6 @@ static int iomap_write_delalloc_scan(struct inode *inode,
 		/* if dirty, punch up to offset */
 		if (folio_test_dirty(folio)) {
 			if (start_byte > *punch_start_byte) {
-				int	error;
-
 				error = punch(inode, *punch_start_byte,
 						start_byte - *punch_start_byte);
 				if (error) {
@@ -902,6 +998,15 @@ static int iomap_write_delalloc_scan(struct inode *inode,
 				}
 			}
 
+			/* Punch the clean blocks within the folio */
+			error = iomap_write_delalloc_iop_punch(inode, folio,
+					start_byte, end_byte, punch);
+			if (error) {
+				folio_unlock(folio);
+				folio_put(folio);
+				return error;
+			}
+
 			/*
 			 * Make sure the next punch start is correctly bound to
 			 * the end of this data range, not the end of the folio.
@@ -1590,7 +1695,7 @@ iomap_writepage_map(struct iomap_writepage_ctx *wpc,
 		struct writeback_control *wbc, struct inode *inode,
 		struct folio *folio, u64 end_pos)
 {
-	struct iomap_page *iop = iomap_page_create(inode, folio, 0);
+	struct iomap_page *iop = to_iomap_page(folio);
 	struct iomap_ioend *ioend, *next;
 	unsigned len = i_blocksize(inode);
 	unsigned nblocks = i_blocks_per_folio(inode, folio);
@@ -1598,6 +1703,16 @@ iomap_writepage_map(struct iomap_writepage_ctx *wpc,
 	int error = 0, count = 0, i;
 	LIST_HEAD(submit_list);
 
+	/*
+	 * The folio was dirtied without going through iomap (the dirty flag
+	 * has already been cleared for this writeback), so all blocks up to
+	 * EOF have to be written.
+	 */
+	if (!iop && nblocks > 1) {
+		iop = iomap_page_create(inode, folio, 0);
+		iomap_set_range_dirty(folio, 0, end_pos - pos);
+	}
+
 	WARN_ON_ONCE(iop && atomic_read(&iop->write_bytes_pending) != 0);
 
 	/*
@@ -1606,7 +1721,7 @@ iomap_writepage_map(struct iomap_writepage_ctx *wpc,
 	 * invalid, grab a new one.
 	 */
 	for (i = 0; i < nblocks && pos < end_pos; i++, pos += len) {
-		if (iop && !test_bit(i, iop->uptodate))
+		if (iop && !iomap_block_is_dirty(folio, iop, i))
 			continue;
 
 		error = wpc->ops->map_blocks(wpc, inode, pos);
@@ -1629,6 +1744,13 @@ iomap_writepage_map(struct iomap_writepage_ctx *wpc,
 	WARN_ON_ONCE(folio_test_writeback(folio));
 	WARN_ON_ONCE(folio_test_dirty(folio));
 
+	/*
+	 * A write fault on the folio straddling EOF dirties blocks past EOF
+	 * that are never written back, so clear the dirty bits of the whole
+	 * folio rather than just the range walked above.
+	 */
+	iomap_clear_range_dirty(folio, 0, folio_size(folio));
+
 	/*
 	 * We cannot cancel the ioend directly here on error.  We may have
 	 * already set other pages under writeback and hence we have to run I/O
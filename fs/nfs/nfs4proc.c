@@ -5938,8 +5938,9 @@ static ssize_t __nfs4_get_acl_uncached(struct inode *inode, void *buf,
 	int ret = -ENOMEM, i;
 	struct nfs_server *server = NFS_SERVER(inode);
 
+	/* Probing for the size, the ACL still has to fit in one reply */
 	if (buflen == 0)
-		buflen = server->rsize;
+		buflen = min_t(unsigned int, server->rsize, SZ_1M);
 
 	npages = DIV_ROUND_UP(buflen, PAGE_SIZE) + 1;
 	pages = kmalloc_array(npages, sizeof(struct page *), GFP_KERNEL);
@@ -239,7 +239,8 @@ static int ovl_copy_up_file(struct ovl_fs *ofs, struct dentry *dentry,
 	loff_t old_pos = 0;
 	loff_t new_pos = 0;
 	loff_t cloned;
-	loff_t data_pos = -1;
+	loff_t data_pos;
+	loff_t data_end = 0;
 	loff_t hole_len;
 	bool skip_hole = false;
 	int error = 0;
@@ -283,14 +284,14 @@ static int ovl_copy_up_file(struct ovl_fs *ofs, struct dentry *dentry,
 		 *
 		 * Detail logic of hole detection as below:
 		 * When we detect next data position is larger than current
-		 * position we will skip that hole, otherwise we copy
-		 * data in the size of OVL_COPY_UP_CHUNK_SIZE. Actually,
-		 * it may not recognize all kind of holes and sometimes
-		 * only skips partial of hole area. However, it will be
-		 * enough for most of the use cases.
+		 * position we will skip that hole, otherwise we look up
+		 * where the data extent ends with SEEK_HOLE and copy data
+		 * in chunks of up to OVL_COPY_UP_CHUNK_SIZE until there.
+		 * That way a chunk never runs into the next hole, which
+		 * matters for large sparse files such as database files.
 		 */
 
-		if (skip_hole && data_pos < old_pos) {
+		if (skip_hole && old_pos >= data_end) {
 			data_pos = vfs_llseek(old_file, old_pos, SEEK_DATA);
 			if (data_pos > old_pos) {
 				hole_len = data_pos - old_pos;
@@ -301,8 +302,15 @@ static int ovl_copy_up_file(struct ovl_fs *ofs, struct dentry *dentry,
 				break;
 			} else if (data_pos < 0) {
 				skip_hole = false;
+			} else {
+				data_end = vfs_llseek(old_file, old_pos,
+						      SEEK_HOLE);
+				if (data_end <= old_pos)
+					skip_hole = false;
 			}
 		}
+		if (skip_hole && this_len > data_end - old_pos)
+			this_len = data_end - old_pos;
 
 		bytes = do_splice_direct(old_file, &old_pos,
 					 new_file, &new_pos,
@@ -21,9 +21,13 @@
 #include <linux/unistd.h>
 #include <linux/compat.h>
 #include <linux/uaccess.h>
+#include <linux/namei.h>
 
 #include <asm/unaligned.h>
 
+#include "internal.h"
+#include "mount.h"
+
 /*
  * Note the "unsafe_put_user() semantics: we goto a
  * label for errors.
@@ -383,6 +387,167 @@ SYSCALL_DEFINE3(getdents64, unsigned int, fd,
 	return error;
 }
 
+struct getdents_statx_callback {
+	struct dir_context ctx;
+	struct dirent_statx __user *current_dir;
+	struct file *file;
+	unsigned int mask;
+	unsigned int flags;
+	bool may_lookup;
+	int prev_reclen;
+	int count;
+	int error;
+};
+
+/*
+ * Only dentries which are already in the dcache and don't need to be
+ * revalidated are looked at: a lookup or a ->d_revalidate() going to the
+ * filesystem could take the directory lock we are iterating under, and
+ * would cost as much as the statx() call it is meant to save.
+ */
+static void dirent_statx_fill(struct getdents_statx_callback *buf,
+			      const char *name, int namlen, struct statx *stx)
+{
+	struct dentry *parent = buf->file->f_path.dentry;
+	struct path path = { .mnt = buf->file->f_path.mnt };
+	struct qstr this = QSTR_INIT(name, namlen);
+	struct kstat stat;
+
+	memset(stx, 0, sizeof(*stx));
+
+	if (!buf->may_lookup)
+		return;
+	if (name[0] == '.' && (namlen == 1 || (namlen == 2 && name[1] == '.')))
+		return;
+
+	this.hash = full_name_hash(parent, name, namlen);
+	if ((parent->d_flags & DCACHE_OP_HASH) &&
+	    parent->d_op->d_hash(parent, &this) < 0)
+		return;
+
+	path.dentry = d_lookup(parent, &this);
+	if (!path.dentry)
+		return;
+
+	if (!(path.dentry->d_flags & DCACHE_OP_REVALIDATE) &&
+	    d_really_is_positive(path.dentry) && !d_mountpoint(path.dentry) &&
+	    !vfs_getattr(&path, &stat, buf->mask, buf->flags)) {
+		stat.mnt_id = real_mount(path.mnt)->mnt_id;
+		stat.result_mask |= STATX_MNT_ID;
+		stat.attributes_mask |= STATX_ATTR_MOUNT_ROOT;
+		kstat_to_statx(&stat, stx);
+	}
+
+	dput(path.dentry);
+}
+
+static bool filldir_statx(struct dir_context *ctx, const char *name, int namlen,
+			  loff_t offset, u64 ino, unsigned int d_type)
+{
+	struct dirent_statx __user *dirent, *prev;
+	struct getdents_statx_callback *buf =
+		container_of(ctx, struct getdents_statx_callback, ctx);
+	int reclen = ALIGN(offsetof(struct dirent_statx, d_name) + namlen + 1,
+		sizeof(u64));
+	int prev_reclen;
+	struct statx stx;
+
+	buf->error = verify_dirent_name(name, namlen);
+	if (unlikely(buf->error))
+		return false;
+	buf->error = -EINVAL;	/* only used if we fail.. */
+	if (reclen > buf->count)
+		return false;
+	prev_reclen = buf->prev_reclen;
+	if (prev_reclen && signal_pending(current))
+		return false;
+
+	dirent_statx_fill(buf, name, namlen, &stx);
+
+	dirent = buf->current_dir;
+	prev = (void __user *)dirent - prev_reclen;
+	if (copy_to_user(&dirent->d_stx, &stx, sizeof(stx)))
+		goto efault;
+	if (!user_write_access_begin(prev, reclen + prev_reclen))
+		goto efault;
+
+	/* This might be 'dirent->d_off', but if so it will get overwritten */
+	unsafe_put_user(offset, &prev->d_off, efault_end);
+	unsafe_put_user(ino, &dirent->d_ino, efault_end);
+	unsafe_put_user(reclen, &dirent->d_reclen, efault_end);
+	unsafe_put_user(d_type, &dirent->d_type, efault_end);
+	unsafe_copy_dirent_name(dirent->d_name, name, namlen, efault_end);
+	user_write_access_end();
+
+	buf->prev_reclen = reclen;
+	buf->current_dir = (void __user *)dirent + reclen;
+	buf->count -= reclen;
+	return true;
+
+efault_end:
+	user_write_access_end();
+efault:
+	buf->error = -EFAULT;
+	return false;
+}
+
+/**
+ * sys_getdents_statx - Read directory entries along with their attributes
+ * @fd: Directory to read
+ * @dirent: Buffer for struct dirent_statx records
+ * @count: Size of @dirent
+ * @mask: STATX_* attributes wanted for each entry
+ * @flags: AT_STATX_SYNC_AS_STAT or AT_STATX_DONT_SYNC
+ *
+ * Works like getdents64(), except that each directory entry also carries
+ * the statx() attributes of the file it names, for those entries which can
+ * be looked up without going to the filesystem. See struct dirent_statx.
+ */
+SYSCALL_DEFINE5(getdents_statx, unsigned int, fd,
+		struct dirent_statx __user *, dirent, unsigned int, count,
+		unsigned int, mask, unsigned int, flags)
+{
+	struct fd f;
+	struct getdents_statx_callback buf = {
+		.ctx.actor = filldir_statx,
+		.count = count,
+		.current_dir = dirent,
+		.mask = mask,
+		.flags = flags,
+	};
+	int error;
+
+	if (mask & STATX__RESERVED)
+		return -EINVAL;
+	/* Forcing a sync per entry would make this slower than statx() */
+	if (flags & ~AT_STATX_DONT_SYNC)
+		return -EINVAL;
+
+	f = fdget_pos(fd);
+	if (!f.file)
+		return -EBADF;
+	buf.file = f.file;
+	/* statx() of an entry needs search permission on the directory */
+	buf.may_lookup = !inode_permission(file_mnt_user_ns(f.file),
+					   file_inode(f.file), MAY_EXEC);
+
+	error = iterate_dir(f.file, &buf.ctx);
+	if (error >= 0)
+		error = buf.error;
+	if (buf.prev_reclen) {
+		struct dirent_statx __user * lastdirent;
+		typeof(lastdirent->d_off) d_off = buf.ctx.pos;
+
+		lastdirent = (void __user *) buf.current_dir - buf.prev_reclen;
+		if (put_user(d_off, &lastdirent->d_off))
+			error = -EFAULT;
+		else
+			error = count - buf.count;
+	}
+	fdput_pos(f);
+	return error;
+}
+
 #ifdef CONFIG_COMPAT
 struct compat_old_linux_dirent {
 	compat_ulong_t	d_ino;
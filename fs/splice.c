@@ -1178,17 +1178,33 @@ static int iter_to_pipe(struct iov_iter *from,
 			buf.page = pages[i];
 			buf.offset = start;
 			buf.len = size;
+			left -= size;
+			start = 0;
+
+			/*
+			 * Back to back subpages of one large folio share a
+			 * buffer; the folio reference taken for the first one
+			 * pins them all. Gifted pages stay one per buffer, they
+			 * may be stolen.
+			 */
+			while (!(flags & PIPE_BUF_FLAG_GIFT) && i + 1 < n &&
+			       pages[i + 1] == nth_page(pages[i], 1) &&
+			       page_folio(pages[i + 1]) == page_folio(buf.page)) {
+				size = min_t(int, left, PAGE_SIZE);
+				put_page(pages[++i]);
+				buf.len += size;
+				left -= size;
+			}
+
 			ret = add_to_pipe(pipe, &buf);
 			if (unlikely(ret < 0)) {
-				iov_iter_revert(from, left);
+				iov_iter_revert(from, left + buf.len);
 				// this one got dropped by add_to_pipe()
 				while (++i < n)
 					put_page(pages[i]);
 				goto out;
 			}
 			total += ret;
-			left -= size;
-			start = 0;
 		}
 	}
 out:
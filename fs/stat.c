@@ -595,40 +595,44 @@ SYSCALL_DEFINE4(fstatat64, int, dfd, const char __user *, filename,
 }
 #endif /* __ARCH_WANT_STAT64 || __ARCH_WANT_COMPAT_STAT64 */
 
+void kstat_to_statx(const struct kstat *stat, struct statx *stx)
+{
+	memset(stx, 0, sizeof(*stx));
+
+	stx->stx_mask = stat->result_mask;
+	stx->stx_blksize = stat->blksize;
+	stx->stx_attributes = stat->attributes;
+	stx->stx_nlink = stat->nlink;
+	stx->stx_uid = from_kuid_munged(current_user_ns(), stat->uid);
+	stx->stx_gid = from_kgid_munged(current_user_ns(), stat->gid);
+	stx->stx_mode = stat->mode;
+	stx->stx_ino = stat->ino;
+	stx->stx_size = stat->size;
+	stx->stx_blocks = stat->blocks;
+	stx->stx_attributes_mask = stat->attributes_mask;
+	stx->stx_atime.tv_sec = stat->atime.tv_sec;
+	stx->stx_atime.tv_nsec = stat->atime.tv_nsec;
+	stx->stx_btime.tv_sec = stat->btime.tv_sec;
+	stx->stx_btime.tv_nsec = stat->btime.tv_nsec;
+	stx->stx_ctime.tv_sec = stat->ctime.tv_sec;
+	stx->stx_ctime.tv_nsec = stat->ctime.tv_nsec;
+	stx->stx_mtime.tv_sec = stat->mtime.tv_sec;
+	stx->stx_mtime.tv_nsec = stat->mtime.tv_nsec;
+	stx->stx_rdev_major = MAJOR(stat->rdev);
+	stx->stx_rdev_minor = MINOR(stat->rdev);
+	stx->stx_dev_major = MAJOR(stat->dev);
+	stx->stx_dev_minor = MINOR(stat->dev);
+	stx->stx_mnt_id = stat->mnt_id;
+	stx->stx_dio_mem_align = stat->dio_mem_align;
+	stx->stx_dio_offset_align = stat->dio_offset_align;
+}
+
 static noinline_for_stack int
 cp_statx(const struct kstat *stat, struct statx __user *buffer)
 {
 	struct statx tmp;
 
-	memset(&tmp, 0, sizeof(tmp));
-
-	tmp.stx_mask = stat->result_mask;
-	tmp.stx_blksize = stat->blksize;
-	tmp.stx_attributes = stat->attributes;
-	tmp.stx_nlink = stat->nlink;
-	tmp.stx_uid = from_kuid_munged(current_user_ns(), stat->uid);
-	tmp.stx_gid = from_kgid_munged(current_user_ns(), stat->gid);
-	tmp.stx_mode = stat->mode;
-	tmp.stx_ino = stat->ino;
-	tmp.stx_size = stat->size;
-	tmp.stx_blocks = stat->blocks;
-	tmp.stx_attributes_mask = stat->attributes_mask;
-	tmp.stx_atime.tv_sec = stat->atime.tv_sec;
-	tmp.stx_atime.tv_nsec = stat->atime.tv_nsec;
-	tmp.stx_btime.tv_sec = stat->btime.tv_sec;
-	tmp.stx_btime.tv_nsec = stat->btime.tv_nsec;
-	tmp.stx_ctime.tv_sec = stat->ctime.tv_sec;
-	tmp.stx_ctime.tv_nsec = stat->ctime.tv_nsec;
-	tmp.stx_mtime.tv_sec = stat->mtime.tv_sec;
-	tmp.stx_mtime.tv_nsec = stat->mtime.tv_nsec;
-	tmp.stx_rdev_major = MAJOR(stat->rdev);
-	tmp.stx_rdev_minor = MINOR(stat->rdev);
-	tmp.stx_dev_major = MAJOR(stat->dev);
-	tmp.stx_dev_minor = MINOR(stat->dev);
-	tmp.stx_mnt_id = stat->mnt_id;
-	tmp.stx_dio_mem_align = stat->dio_mem_align;
-	tmp.stx_dio_offset_align = stat->dio_offset_align;
-
+	kstat_to_statx(stat, &tmp);
 	return copy_to_user(buffer, &tmp, sizeof(tmp)) ? -EFAULT : 0;
 }
 
@@ -1456,6 +1456,13 @@ xlog_get_iclog_buffer_size(
 {
 	if (mp->m_logbufs <= 0)
 		mp->m_logbufs = XLOG_MAX_ICLOGS;
+
+	/*
+	 * Larger iclogs split a CIL checkpoint over fewer log writes, but
+	 * they are allocated for every mount up front: logbsize=256k costs
+	 * 2MB of memory per filesystem with the default 8 iclogs, so it is
+	 * left for the admin to ask for.
+	 */
 	if (mp->m_logbsize <= 0)
 		mp->m_logbsize = XLOG_BIG_RECORD_BSIZE;
 
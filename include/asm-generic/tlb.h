@@ -14,6 +14,7 @@
 #include <linux/mmu_notifier.h>
 #include <linux/swap.h>
 #include <linux/hugetlb_inline.h>
+#include <linux/llist.h>
 #include <asm/tlbflush.h>
 #include <asm/cacheflush.h>
 
@@ -244,6 +245,7 @@ static inline void tlb_remove_table_sync_one(void) { }
 
 struct mmu_gather_batch {
 	struct mmu_gather_batch	*next;
+	struct llist_node	async_node;
 	unsigned int		nr;
 	unsigned int		max;
 	struct encoded_page	*encoded_pages[];
@@ -337,6 +339,12 @@ struct mmu_gather {
 	unsigned int		vma_huge : 1;
 	unsigned int		vma_pfn  : 1;
 
+	/*
+	 * full page batches are handed to a per-node worker for freeing
+	 * instead of being freed inline, see tlb_batch_pages_defer()
+	 */
+	unsigned int		async_free : 1;
+
 	unsigned int		batch_count;
 
 #ifndef CONFIG_MMU_GATHER_NO_GATHER
@@ -174,6 +174,11 @@ struct shash_desc {
  * @final: see struct ahash_alg
  * @finup: see struct ahash_alg
  * @digest: see struct ahash_alg
+ * @finup_mb: **[optional]** Finish the digests of @num_msgs messages of the
+ *	      same length @len at once, each continuing from the state in
+ *	      @desc, which is not modified. Implementations interleave the
+ *	      messages to get better throughput than hashing them one after
+ *	      the other. @num_msgs is at least 2 and at most @mb_max_msgs.
  * @export: see struct ahash_alg
  * @import: see struct ahash_alg
  * @setkey: see struct ahash_alg
@@ -193,6 +198,8 @@ struct shash_desc {
  * @descsize: Size of the operational state for the message digest. This state
  * 	      size is the memory size that needs to be allocated for
  *	      shash_desc.__ctx
+ * @mb_max_msgs: Maximum number of messages @finup_mb takes; 1 if @finup_mb
+ *	      isn't implemented
  * @base: internally used
  */
 struct shash_alg {
@@ -204,6 +211,9 @@ struct shash_alg {
 		     unsigned int len, u8 *out);
 	int (*digest)(struct shash_desc *desc, const u8 *data,
 		      unsigned int len, u8 *out);
+	int (*finup_mb)(struct shash_desc *desc, const u8 * const data[],
+			unsigned int len, u8 * const outs[],
+			unsigned int num_msgs);
 	int (*export)(struct shash_desc *desc, void *out);
 	int (*import)(struct shash_desc *desc, const void *in);
 	int (*setkey)(struct crypto_shash *tfm, const u8 *key,
@@ -212,6 +222,7 @@ struct shash_alg {
 	void (*exit_tfm)(struct crypto_shash *tfm);
 
 	unsigned int descsize;
+	unsigned int mb_max_msgs;
 
 	/* These fields must match hash_alg_common. */
 	unsigned int digestsize
@@ -795,6 +806,19 @@ static inline unsigned int crypto_shash_statesize(struct crypto_shash *tfm)
 	return crypto_shash_alg(tfm)->statesize;
 }
 
+/**
+ * crypto_shash_mb_max_msgs() - obtain the number of messages hashed at once
+ * @tfm: cipher handle
+ *
+ * Return: the largest number of messages for which crypto_shash_finup_mb()
+ *	   is faster than hashing the messages one by one; 1 if the algorithm
+ *	   has no multibuffer support
+ */
+static inline unsigned int crypto_shash_mb_max_msgs(struct crypto_shash *tfm)
+{
+	return crypto_shash_alg(tfm)->mb_max_msgs;
+}
+
 static inline u32 crypto_shash_get_flags(struct crypto_shash *tfm)
 {
 	return crypto_tfm_get_flags(crypto_shash_tfm(tfm));
@@ -998,6 +1022,27 @@ int crypto_shash_final(struct shash_desc *desc, u8 *out);
 int crypto_shash_finup(struct shash_desc *desc, const u8 *data,
 		       unsigned int len, u8 *out);
 
+/**
+ * crypto_shash_finup_mb() - finish the digests of several messages at once
+ * @desc: the state the messages continue from; it is not modified
+ * @data: the messages, all @len bytes long
+ * @len: the length of each message
+ * @outs: where to store the message digests
+ * @num_msgs: the number of messages
+ *
+ * This calculates the same digests as calling crypto_shash_finup() on a
+ * copy of @desc for each message, but more quickly if @num_msgs is up to
+ * crypto_shash_mb_max_msgs() and the algorithm interleaves the messages.
+ * Any number of messages is accepted.
+ *
+ * Context: Any context.
+ * Return: 0 if the message digest creation was successful; < 0 if an error
+ *	   occurred
+ */
+int crypto_shash_finup_mb(struct shash_desc *desc, const u8 * const data[],
+			  unsigned int len, u8 * const outs[],
+			  unsigned int num_msgs);
+
 static inline void shash_desc_zero(struct shash_desc *desc)
 {
 	memzero_explicit(desc,
@@ -173,6 +173,7 @@ struct backing_dev_info {
 	unsigned int capabilities; /* Device capabilities */
 	unsigned int min_ratio;
 	unsigned int max_ratio, max_prop_frac;
+	unsigned long max_pause;	/* dirty throttling pause limit, 0: default */
 
 	/*
 	 * Sum of avg_write_bw of wbs with dirty inodes.  > 0 if there are
@@ -114,6 +114,8 @@ int bdi_set_max_ratio_no_scale(struct backing_dev_info *bdi, unsigned int max_ra
 int bdi_set_min_bytes(struct backing_dev_info *bdi, u64 min_bytes);
 int bdi_set_max_bytes(struct backing_dev_info *bdi, u64 max_bytes);
 int bdi_set_strict_limit(struct backing_dev_info *bdi, unsigned int strict_limit);
+unsigned int bdi_get_max_pause_ms(struct backing_dev_info *bdi);
+int bdi_set_max_pause_ms(struct backing_dev_info *bdi, unsigned int msecs);
 
 /*
  * Flags in backing_dev_info::capability
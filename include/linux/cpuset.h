@@ -134,6 +134,8 @@ extern bool current_cpuset_is_being_rebound(void);
 
 extern void rebuild_sched_domains(void);
 
+extern bool cpuset_cpu_is_isolated(int cpu);
+
 extern void cpuset_print_current_mems_allowed(void);
 
 /*
@@ -199,6 +201,11 @@ static inline void cpuset_wait_for_hotplug(void) { }
 static inline void cpuset_read_lock(void) { }
 static inline void cpuset_read_unlock(void) { }
 
+static inline bool cpuset_cpu_is_isolated(int cpu)
+{
+	return false;
+}
+
 static inline void cpuset_cpus_allowed(struct task_struct *p,
 				       struct cpumask *mask)
 {
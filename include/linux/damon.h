@@ -103,10 +103,51 @@ enum damos_action {
 	NR_DAMOS_ACTIONS,
 };
 
+/**
+ * enum damos_quota_goal_metric - Represents the metric to be used as the goal
+ *
+ * @DAMOS_QUOTA_USER_INPUT:	User-input value.
+ * @DAMOS_QUOTA_SOME_MEM_PSI_US:	System level some memory PSI in us.
+ * @NR_DAMOS_QUOTA_GOAL_METRICS:	Number of DAMOS quota goal metrics.
+ *
+ * Metrics equal to larger than @NR_DAMOS_QUOTA_GOAL_METRICS are unsupported.
+ */
+enum damos_quota_goal_metric {
+	DAMOS_QUOTA_USER_INPUT,
+	DAMOS_QUOTA_SOME_MEM_PSI_US,
+	NR_DAMOS_QUOTA_GOAL_METRICS,
+};
+
+/**
+ * struct damos_quota_goal - DAMOS scheme quota auto-tuning goal.
+ * @metric:		Metric to be used for representing the goal.
+ * @target_value:	Target value of @metric to achieve with the tuning.
+ * @current_value:	Current value of @metric.
+ *
+ * Data structure for getting the current score of the quota tuning goal.  The
+ * score is calculated by how close @current_value and @target_value are.  The
+ * quota is then tuned towards achieving the score of 10,000, i.e. a higher
+ * @current_value makes the scheme less aggressive.
+ *
+ * If @metric is DAMOS_QUOTA_USER_INPUT, @current_value should be manually
+ * entered by the user, probably inside the kdamond callbacks.  Otherwise,
+ * DAMON sets @current_value with the self-retrieved value, once per
+ * &damos_quota->reset_interval.  A zero @target_value disables the goal.
+ */
+struct damos_quota_goal {
+	enum damos_quota_goal_metric metric;
+	unsigned long target_value;
+	unsigned long current_value;
+/* private: */
+	/* metric-dependent fields */
+	u64 last_psi_total;
+};
+
 /**
  * struct damos_quota - Controls the aggressiveness of the given scheme.
  * @ms:			Maximum milliseconds that the scheme can use.
  * @sz:			Maximum bytes of memory that the action can be applied.
+ * @goal:		Quota auto-tuning goal.
  * @reset_interval:	Charge reset interval in milliseconds.
  *
  * @weight_sz:		Weight of the region's size for prioritization.
@@ -125,6 +166,12 @@ enum damos_action {
  * throughput of the scheme's action.  DAMON then compares it against &sz and
  * uses smaller one as the effective quota.
  *
+ * If a non-zero &goal->target_value is set, DAMON also runs a simple feedback
+ * loop that grows an internal size quota while the goal is under-achieved and
+ * shrinks it while the goal is over-achieved, once per &reset_interval.  The
+ * smallest among that and the two quotas above is used as the effective quota.
+ * With only &goal set, the feedback loop alone drives the aggressiveness.
+ *
  * For selecting regions within the quota, DAMON prioritizes current scheme's
  * target memory regions using the &struct damon_operations->get_scheme_score.
  * You could customize the prioritization logic by setting &weight_sz,
@@ -134,6 +181,7 @@ enum damos_action {
 struct damos_quota {
 	unsigned long ms;
 	unsigned long sz;
+	struct damos_quota_goal goal;
 	unsigned long reset_interval;
 
 	unsigned int weight_sz;
@@ -146,6 +194,7 @@ struct damos_quota {
 	unsigned long total_charged_ns;
 
 	unsigned long esz;	/* Effective size quota in bytes */
+	unsigned long esz_bp;	/* Goal-tuned size quota in basis points */
 
 	/* For charging the quota */
 	unsigned long charged_sz;
@@ -255,6 +255,9 @@ void dma_common_free_remap(void *cpu_addr, size_t size);
 struct page *dma_alloc_from_pool(struct device *dev, size_t size,
 		void **cpu_addr, gfp_t flags,
 		bool (*phys_addr_ok)(struct device *, phys_addr_t, size_t));
+struct page *dma_alloc_from_shared_pool(struct device *dev, size_t size,
+		void **cpu_addr, gfp_t flags,
+		bool (*phys_addr_ok)(struct device *, phys_addr_t, size_t));
 bool dma_free_from_pool(struct device *dev, void *start, size_t size);
 
 int dma_direct_set_offset(struct device *dev, phys_addr_t cpu_start,
@@ -914,6 +914,11 @@ struct fown_struct {
  *      the first of these pages is accessed.
  * @ra_pages: Maximum size of a readahead request, copied from the bdi.
  * @mmap_miss: How many mmap accesses missed in the page cache.
+ * @seq_confidence: How many readahead windows in a row were consumed
+ *      sequentially, decays on random accesses.
+ * @stride_hits: How many sync misses in a row were @stride pages apart.
+ * @stride: Gap in pages between the end of the previous read request and
+ *      the most recent sync miss, i.e. the pages a strided scan skips.
  * @prev_pos: The last byte in the most recent read request.
  *
  * When this structure is passed to ->readahead(), the "most recent"
@@ -925,6 +930,9 @@ struct file_ra_state {
 	unsigned int async_size;
 	unsigned int ra_pages;
 	unsigned int mmap_miss;
+	unsigned short seq_confidence;
+	unsigned short stride_hits;
+	long stride;
 	loff_t prev_pos;
 };
 
@@ -75,6 +75,10 @@ void futex_exit_recursive(struct task_struct *tsk);
 void futex_exit_release(struct task_struct *tsk);
 void futex_exec_release(struct task_struct *tsk);
 
+void futex_mm_init(struct mm_struct *mm);
+int futex_private_hash_alloc(struct mm_struct *mm);
+void futex_private_hash_free(struct mm_struct *mm);
+
 long do_futex(u32 __user *uaddr, int op, u32 val, ktime_t *timeout,
 	      u32 __user *uaddr2, u32 val2, u32 val3);
 #else
@@ -82,6 +86,9 @@ static inline void futex_init_task(struct task_struct *tsk) { }
 static inline void futex_exit_recursive(struct task_struct *tsk) { }
 static inline void futex_exit_release(struct task_struct *tsk) { }
 static inline void futex_exec_release(struct task_struct *tsk) { }
+static inline void futex_mm_init(struct mm_struct *mm) { }
+static inline int futex_private_hash_alloc(struct mm_struct *mm) { return 0; }
+static inline void futex_private_hash_free(struct mm_struct *mm) { }
 static inline long do_futex(u32 __user *uaddr, int op, u32 val,
 			    ktime_t *timeout, u32 __user *uaddr2,
 			    u32 val2, u32 val3)
@@ -208,6 +208,26 @@ static inline void clear_user_highpage(struct page *page, unsigned long vaddr)
 }
 #endif
 
+/*
+ * Clear a page with stores which bypass the cache, for large extents which
+ * would otherwise evict the whole cache. Pages cleared this way must be
+ * followed by clear_page_nocache_fence() before they are mapped.
+ */
+#ifndef clear_user_page_nocache
+#define clear_user_page_nocache(addr, vaddr, page) \
+	clear_user_page(addr, vaddr, page)
+#define clear_page_nocache_fence() do { } while (0)
+#define clear_page_nocache_threshold() ULONG_MAX
+#endif
+
+static inline void clear_user_highpage_nocache(struct page *page,
+					       unsigned long vaddr)
+{
+	void *addr = kmap_local_page(page);
+	clear_user_page_nocache(addr, vaddr, page);
+	kunmap_local(addr);
+}
+
 #ifndef __HAVE_ARCH_ALLOC_ZEROED_USER_HIGHPAGE_MOVABLE
 /**
  * alloc_zeroed_user_highpage_movable - Allocate a zeroed HIGHMEM page for a VMA that the caller knows can move
@@ -116,6 +116,20 @@ extern struct kobj_attribute shmem_enabled_attr;
 
 extern unsigned long transparent_hugepage_flags;
 
+/*
+ * Orders of anonymous folios that may be allocated at fault time below PMD
+ * size. Order-1 is excluded because a large folio needs its third page for
+ * the deferred split list.
+ */
+#define THP_ORDERS_ANON_MTHP \
+	((BIT(HPAGE_PMD_ORDER) - 1) & ~(BIT(0) | BIT(1)))
+
+extern unsigned long huge_anon_orders_always;
+extern unsigned long huge_anon_orders_madvise;
+extern unsigned long huge_anon_orders_inherit;
+
+unsigned long thp_vma_anon_orders(struct vm_area_struct *vma);
+
 #define hugepage_flags_enabled()					       \
 	(transparent_hugepage_flags &				       \
 	 ((1<<TRANSPARENT_HUGEPAGE_FLAG) |		       \
@@ -329,6 +343,11 @@ static inline bool hugepage_vma_check(struct vm_area_struct *vma,
 	return false;
 }
 
+static inline unsigned long thp_vma_anon_orders(struct vm_area_struct *vma)
+{
+	return 0;
+}
+
 static inline void prep_transhuge_page(struct page *page) {}
 
 #define transparent_hugepage_flags 0UL
@@ -298,6 +298,53 @@ extern bool initcall_debug;
 
 #define __initcall(fn) device_initcall(fn)
 
+/*
+ * Asynchronous initcalls run in parallel with the other initcalls of their
+ * level; do_initcalls() waits for all of them before it starts the next
+ * level. Nothing in their own level, including the _sync initcalls, may
+ * rely on them, except other asynchronous initcalls declared with one of
+ * the _after() variants: those only run once @dep, an asynchronous initcall
+ * defined earlier in the same file, in the same or an earlier level, has
+ * returned. A @dep from a later level triggers a warning at boot, and is
+ * then run ahead of its level.
+ */
+struct async_initcall {
+	initcall_t		fn;
+	struct async_initcall	*dep;
+	struct async_initcall	*next;
+	bool			queued;
+	bool			done;
+	u64			start;
+	u64			end;
+};
+
+int async_initcall_schedule(struct async_initcall *ic);
+
+#define __define_async_initcall(func, __dep, id)			\
+	static struct async_initcall __async_initcall_##func __initdata = { \
+		.fn	= func,						\
+		.dep	= __dep,					\
+	};								\
+	static int __init __async_initcall_stub_##func(void)		\
+	{								\
+		return async_initcall_schedule(&__async_initcall_##func); \
+	}								\
+	__define_initcall(__async_initcall_stub_##func, id)
+
+#define subsys_initcall_async(fn)	__define_async_initcall(fn, NULL, 4)
+#define fs_initcall_async(fn)		__define_async_initcall(fn, NULL, 5)
+#define device_initcall_async(fn)	__define_async_initcall(fn, NULL, 6)
+#define late_initcall_async(fn)		__define_async_initcall(fn, NULL, 7)
+
+#define subsys_initcall_async_after(fn, dep)				\
+	__define_async_initcall(fn, &__async_initcall_##dep, 4)
+#define fs_initcall_async_after(fn, dep)				\
+	__define_async_initcall(fn, &__async_initcall_##dep, 5)
+#define device_initcall_async_after(fn, dep)				\
+	__define_async_initcall(fn, &__async_initcall_##dep, 6)
+#define late_initcall_async_after(fn, dep)				\
+	__define_async_initcall(fn, &__async_initcall_##dep, 7)
+
 #define __exitcall(fn)						\
 	static exitcall_t __exitcall_##fn __exit_call = fn
 
@@ -266,6 +266,14 @@ struct io_ring_ctx {
 	struct wait_queue_head	sqo_sq_wait;
 	struct list_head	sqd_list;
 
+	/* SQPOLL fairness and stats, only modified by the SQPOLL thread */
+	unsigned int		sq_weight;
+	unsigned int		sq_idle_passes;
+	unsigned int		sq_skip;
+	u64			sq_submitted;
+	u64			sq_busy_passes;
+	u64			sq_idle_skipped;
+
 	unsigned long		check_cq;
 
 	unsigned int		file_alloc_start;
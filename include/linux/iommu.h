@@ -129,6 +129,8 @@ enum iommu_cap {
 	 * this device.
 	 */
 	IOMMU_CAP_ENFORCE_CACHE_COHERENCY,
+	/* IOMMU can track the pages DMA'd to by the device (dirty bits) */
+	IOMMU_CAP_DIRTY,
 };
 
 /* These are the possible reserved region types */
@@ -312,6 +314,12 @@ struct iommu_ops {
  *                           specific mechanisms.
  * @enable_nesting: Enable nesting
  * @set_pgtable_quirks: Set io page table quirks (IO_PGTABLE_QUIRK_*)
+ * @set_dirty_tracking: Make the IOMMU set the dirty bit of the IOPTEs the
+ *                      devices attached to the domain write through
+ * @read_and_clear_dirty: Clear the dirty bit of the IOPTEs mapping
+ *                        [@iova, @iova + @size) and set the bits of @bitmap,
+ *                        one per 1 << @pgshift bytes from @iova, for those
+ *                        which had it set. The IOTLB is flushed on return.
  * @free: Release the domain after use.
  */
 struct iommu_domain_ops {
@@ -344,6 +352,11 @@ struct iommu_domain_ops {
 	int (*enable_nesting)(struct iommu_domain *domain);
 	int (*set_pgtable_quirks)(struct iommu_domain *domain,
 				  unsigned long quirks);
+	int (*set_dirty_tracking)(struct iommu_domain *domain, bool enable);
+	int (*read_and_clear_dirty)(struct iommu_domain *domain,
+				    unsigned long iova, size_t size,
+				    unsigned long *bitmap,
+				    unsigned long pgshift);
 
 	void (*free)(struct iommu_domain *domain);
 };
@@ -532,6 +545,10 @@ extern struct iommu_domain *iommu_group_default_domain(struct iommu_group *);
 int iommu_enable_nesting(struct iommu_domain *domain);
 int iommu_set_pgtable_quirks(struct iommu_domain *domain,
 		unsigned long quirks);
+int iommu_set_dirty_tracking(struct iommu_domain *domain, bool enable);
+int iommu_read_and_clear_dirty(struct iommu_domain *domain,
+			       unsigned long iova, size_t size,
+			       unsigned long *bitmap, unsigned long pgshift);
 
 void iommu_set_dma_strict(void);
 
@@ -957,6 +974,20 @@ static inline int iommu_set_pgtable_quirks(struct iommu_domain *domain,
 	return 0;
 }
 
+static inline int iommu_set_dirty_tracking(struct iommu_domain *domain,
+					   bool enable)
+{
+	return -EOPNOTSUPP;
+}
+
+static inline int iommu_read_and_clear_dirty(struct iommu_domain *domain,
+					     unsigned long iova, size_t size,
+					     unsigned long *bitmap,
+					     unsigned long pgshift)
+{
+	return -EOPNOTSUPP;
+}
+
 static inline int iommu_device_register(struct iommu_device *iommu,
 					const struct iommu_ops *ops,
 					struct device *hwdev)
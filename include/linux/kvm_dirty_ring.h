@@ -16,6 +16,7 @@
  *               limit, vcpu that owns this ring should exit to userspace
  *               to allow userspace to harvest all the dirty pages
  * @dirty_gfns:  the array to keep the dirty gfns
+ * @reset_gfns:  scratch buffer used to sort harvested gfns on reset
  * @index:       index of this dirty ring
  */
 struct kvm_dirty_ring {
@@ -24,6 +25,7 @@ struct kvm_dirty_ring {
 	u32 size;
 	u32 soft_limit;
 	struct kvm_dirty_gfn *dirty_gfns;
+	struct kvm_dirty_gfn *reset_gfns;
 	int index;
 };
 
@@ -388,6 +388,7 @@ struct kvm_vcpu {
 #endif
 	bool preempted;
 	bool ready;
+	bool halt_polling;
 	bool load_mmu_pgd_pending;
 	struct kvm_vcpu_arch arch;
 	struct kvm_vcpu_stat stat;
@@ -2405,6 +2406,9 @@ static inline int kvm_restricted_mem_get_pfn(struct kvm_memory_slot *slot,
 }
 
 void kvm_arch_memory_mce(struct kvm *kvm);
+int kvm_arch_migrate_private_page(struct kvm *kvm, struct kvm_memory_slot *slot,
+				  gfn_t gfn, kvm_pfn_t src_pfn,
+				  kvm_pfn_t dst_pfn);
 #endif /* CONFIG_HAVE_KVM_RESTRICTED_MEM */
 
 #define KVM_FIRMWARE_TDX_MODULE		0
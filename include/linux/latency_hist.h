@@ -0,0 +1,43 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+#ifndef _LINUX_LATENCY_HIST_H
+#define _LINUX_LATENCY_HIST_H
+
+#include <linux/jump_label.h>
+#include <linux/sched/clock.h>
+#include <uapi/linux/latency_hist.h>
+
+#ifdef CONFIG_LATENCY_HIST
+DECLARE_STATIC_KEY_FALSE(lat_hist_enabled);
+
+void __lat_hist_record(enum lat_hist_type type, unsigned int id, u64 delta);
+
+/* Returns 0 if the histograms are disabled */
+static __always_inline u64 lat_hist_start(void)
+{
+	if (static_branch_unlikely(&lat_hist_enabled))
+		return local_clock();
+	return 0;
+}
+
+static __always_inline void lat_hist_end(enum lat_hist_type type,
+					 unsigned int id, u64 start)
+{
+	if (static_branch_unlikely(&lat_hist_enabled) && start)
+		__lat_hist_record(type, id, local_clock() - start);
+}
+
+static __always_inline void lat_hist_record(enum lat_hist_type type,
+					    unsigned int id, u64 delta)
+{
+	if (static_branch_unlikely(&lat_hist_enabled))
+		__lat_hist_record(type, id, delta);
+}
+#else
+static inline u64 lat_hist_start(void) { return 0; }
+static inline void lat_hist_end(enum lat_hist_type type, unsigned int id,
+				u64 start) { }
+static inline void lat_hist_record(enum lat_hist_type type, unsigned int id,
+				   u64 delta) { }
+#endif
+
+#endif /* _LINUX_LATENCY_HIST_H */
@@ -535,9 +535,16 @@ struct anon_vma_name {
 struct vm_area_struct {
 	/* The first cache line has the info for VMA tree walking. */
 
-	unsigned long vm_start;		/* Our start address within vm_mm. */
-	unsigned long vm_end;		/* The first byte after our end address
-					   within vm_mm. */
+	union {
+		struct {
+			/* VMA covers [vm_start; vm_end) addresses within mm */
+			unsigned long vm_start;
+			unsigned long vm_end;
+		};
+#ifdef CONFIG_PER_VMA_LOCK
+		struct rcu_head vm_rcu;	/* Used for deferred freeing. */
+#endif
+	};
 
 	struct mm_struct *vm_mm;	/* The address space we belong to. */
 
@@ -548,6 +555,19 @@ struct vm_area_struct {
 	pgprot_t vm_page_prot;
 	unsigned long vm_flags;		/* Flags, see mm.h. */
 
+#ifdef CONFIG_PER_VMA_LOCK
+	/*
+	 * Page faults on this VMA may be handled under vm_lock rather than
+	 * mmap_lock, see lock_vma_under_rcu(). The VMA is write-locked while
+	 * vm_lock_seq equals mm->mm_lock_seq, and mmap_write_unlock() unlocks
+	 * all VMAs at once by bumping mm->mm_lock_seq.
+	 */
+	int vm_lock_seq;
+	struct rw_semaphore vm_lock;
+	/* Flag to indicate areas removed from the VMA tree */
+	bool detached;
+#endif
+
 	/*
 	 * For areas with an address space and backing store,
 	 * linkage into the address_space->i_mmap interval tree.
@@ -597,6 +617,12 @@ struct vm_area_struct {
 	struct vm_userfaultfd_ctx vm_userfaultfd_ctx;
 } __randomize_layout;
 
+/* Recent runtime of an mm's threads on one CPU, see account_mm_sched() */
+struct mm_sched {
+	u64 runtime;
+	unsigned long epoch;
+};
+
 struct kioctx_table;
 struct mm_struct {
 	struct {
@@ -667,6 +693,14 @@ struct mm_struct {
 		 * cacheline.
 		 */
 		struct rw_semaphore mmap_lock;
+#ifdef CONFIG_PER_VMA_LOCK
+		/*
+		 * Incremented by mmap_write_unlock() and
+		 * mmap_write_downgrade(), which unlocks all VMAs write-locked
+		 * by vma_start_write(). Written under the exclusive mmap_lock.
+		 */
+		int mm_lock_seq;
+#endif
 
 		struct list_head mmlist; /* List of maybe swapped mm's.	These
 					  * are globally strung together off
@@ -750,6 +784,23 @@ struct mm_struct {
 
 		/* numa_scan_seq prevents two threads remapping PTEs. */
 		int numa_scan_seq;
+#endif
+#ifdef CONFIG_SCHED_CACHE
+		struct mm_sched __percpu *pcpu_sched;
+
+		/*
+		 * A CPU in the LLC where the threads ran most recently, or
+		 * -1, and the time it is next updated at.
+		 */
+		int mm_sched_cpu;
+		unsigned long mm_sched_next;
+#endif
+#ifdef CONFIG_FUTEX
+		/*
+		 * Hash buckets of the PROCESS_PRIVATE futexes, allocated
+		 * once the mm is first shared and freed with the mm.
+		 */
+		struct futex_private_hash *futex_phash;
 #endif
 		/*
 		 * An operation with batched TLB flushing is going on. Anything
@@ -913,6 +964,8 @@ static inline void vma_iter_init(struct vma_iterator *vmi,
 struct mmu_gather;
 extern void tlb_gather_mmu(struct mmu_gather *tlb, struct mm_struct *mm);
 extern void tlb_gather_mmu_fullmm(struct mmu_gather *tlb, struct mm_struct *mm);
+extern void tlb_gather_mmu_async(struct mmu_gather *tlb, struct mm_struct *mm,
+				 unsigned long size);
 extern void tlb_finish_mmu(struct mmu_gather *tlb);
 
 struct vm_fault;
@@ -1045,6 +1098,8 @@ typedef struct {
  *                      mapped after the fault.
  * @FAULT_FLAG_ORIG_PTE_VALID: whether the fault has vmf->orig_pte cached.
  *                        We should only access orig_pte if this flag set.
+ * @FAULT_FLAG_VMA_LOCK: The fault is handled under VMA lock instead of
+ *                       mmap_lock.
  *
  * About @FAULT_FLAG_ALLOW_RETRY and @FAULT_FLAG_TRIED: we can specify
  * whether we would allow page faults to retry by specifying these two
@@ -1082,6 +1137,7 @@ enum fault_flag {
 	FAULT_FLAG_INTERRUPTIBLE =	1 << 9,
 	FAULT_FLAG_UNSHARE =		1 << 10,
 	FAULT_FLAG_ORIG_PTE_VALID =	1 << 11,
+	FAULT_FLAG_VMA_LOCK =		1 << 12,
 };
 
 typedef unsigned int __bitwise zap_flags_t;
@@ -60,9 +60,31 @@ static inline void __mmap_lock_trace_released(struct mm_struct *mm, bool write)
 
 #endif /* CONFIG_TRACING */
 
+#ifdef CONFIG_PER_VMA_LOCK
+static inline void mm_lock_seq_init(struct mm_struct *mm)
+{
+	mm->mm_lock_seq = 0;
+}
+
+/*
+ * Drop all currently-held per-VMA write locks by invalidating the sequence
+ * number they were taken with. Only called with mmap_lock held exclusively.
+ */
+static inline void vma_end_write_all(struct mm_struct *mm)
+{
+	lockdep_assert_held_write(&mm->mmap_lock);
+	/* No races during update due to exclusive mmap_lock being held */
+	WRITE_ONCE(mm->mm_lock_seq, mm->mm_lock_seq + 1);
+}
+#else
+static inline void mm_lock_seq_init(struct mm_struct *mm) {}
+static inline void vma_end_write_all(struct mm_struct *mm) {}
+#endif
+
 static inline void mmap_init_lock(struct mm_struct *mm)
 {
 	init_rwsem(&mm->mmap_lock);
+	mm_lock_seq_init(mm);
 }
 
 static inline void mmap_write_lock(struct mm_struct *mm)
@@ -102,12 +124,14 @@ static inline bool mmap_write_trylock(struct mm_struct *mm)
 static inline void mmap_write_unlock(struct mm_struct *mm)
 {
 	__mmap_lock_trace_released(mm, true);
+	vma_end_write_all(mm);
 	up_write(&mm->mmap_lock);
 }
 
 static inline void mmap_write_downgrade(struct mm_struct *mm)
 {
 	__mmap_lock_trace_acquire_returned(mm, false, true);
+	vma_end_write_all(mm);
 	downgrade_write(&mm->mmap_lock);
 }
 
@@ -8,10 +8,11 @@
 /*
  * To change the maximum rsize and wsize supported by the NFS client, adjust
  * NFS_MAX_FILE_IO_SIZE.  64KB is a typical maximum, but some servers can
- * support a megabyte or more.  The default is left at 4096 bytes, which is
- * reasonable for NFS over UDP.
+ * support several megabytes.  The actual size is further limited by what the
+ * server advertises, the transport and, for NFSv4.1+, the session.  The
+ * default is left at 4096 bytes, which is reasonable for NFS over UDP.
  */
-#define NFS_MAX_FILE_IO_SIZE	(1048576U)
+#define NFS_MAX_FILE_IO_SIZE	(4194304U)
 #define NFS_DEF_FILE_IO_SIZE	(4096U)
 #define NFS_MIN_FILE_IO_SIZE	(1024U)
 
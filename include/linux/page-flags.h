@@ -192,6 +192,9 @@ enum pageflags {
 	/* Only valid for buddy pages. Used to track pages that are reported */
 	PG_reported = PG_uptodate,
 
+	/* Only valid for buddy pages. Used to track pages known to be zero */
+	PG_zeroed = PG_owner_priv_1,
+
 #ifdef CONFIG_MEMORY_HOTPLUG
 	/* For self-hosted memmap pages */
 	PG_vmemmap_self_hosted = PG_owner_priv_1,
@@ -607,6 +610,13 @@ PAGEFLAG_FALSE(SkipKASanPoison, skip_kasan_poison)
  */
 __PAGEFLAG(Reported, reported, PF_NO_COMPOUND)
 
+/*
+ * PageZeroed() is used to track free pages within the Buddy allocator that
+ * have been zeroed in the background, see mm/page_prezero.c. Like
+ * PageReported(), it is only changed under the zone lock.
+ */
+__PAGEFLAG(Zeroed, zeroed, PF_NO_COMPOUND)
+
 #ifdef CONFIG_MEMORY_HOTPLUG
 PAGEFLAG(VmemmapSelfHosted, vmemmap_self_hosted, PF_ANY)
 #else
@@ -168,6 +168,9 @@ struct psi_group {
 	u64 avg_last_update;
 	u64 avg_next_update;
 
+	/* Jiffies of the last read of the averages, see psi_avgs_monitored() */
+	unsigned long avg_last_read;
+
 	/* Aggregator work control */
 	struct delayed_work avgs_work;
 
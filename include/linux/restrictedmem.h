@@ -3,6 +3,7 @@
 
 #include <linux/file.h>
 #include <linux/magic.h>
+#include <linux/migrate_mode.h>
 #include <linux/pfn_t.h>
 
 struct restrictedmem_notifier;
@@ -14,6 +15,14 @@ struct restrictedmem_notifier_ops {
 			       pgoff_t start, pgoff_t end);
 	void (*error)(struct restrictedmem_notifier *notifier,
 			       pgoff_t start, pgoff_t end);
+	/*
+	 * Optional.  Move whatever the notifier has mapped at @index from @src
+	 * to @dst, including the contents and any page references held.
+	 * Returns 1 if the page was relocated, 0 if nothing was mapped at
+	 * @index and a negative error code if the page can't be moved now.
+	 */
+	int (*migrate)(struct restrictedmem_notifier *notifier, pgoff_t index,
+		       struct page *src, struct page *dst);
 };
 
 struct restrictedmem_notifier {
@@ -38,6 +47,10 @@ static inline bool file_is_restrictedmem(struct file *file)
 
 void restrictedmem_error_page(struct page *page, struct address_space *mapping);
 
+int restrictedmem_migrate_folio(struct address_space *mapping,
+				struct folio *dst, struct folio *src,
+				enum migrate_mode mode);
+
 #else
 
 static inline void restrictedmem_register_notifier(struct file *file,
@@ -66,6 +79,14 @@ static inline void restrictedmem_error_page(struct page *page,
 {
 }
 
+static inline int restrictedmem_migrate_folio(struct address_space *mapping,
+					      struct folio *dst,
+					      struct folio *src,
+					      enum migrate_mode mode)
+{
+	return -EOPNOTSUPP;
+}
+
 #endif /* CONFIG_RESTRICTEDMEM */
 
 #endif /* _LINUX_RESTRICTEDMEM_H */
@@ -23,6 +23,7 @@ typedef void (*rethook_handler_t) (struct rethook_node *, void *, struct pt_regs
  * @pool: The pool of struct rethook_node.
  * @ref: The reference counter.
  * @rcu: The rcu_head for deferred freeing.
+ * @nodes: The storage of the nodes if allocated by rethook_alloc_nodes().
  *
  * Don't embed to another data structure, because this is a self-destructive
  * data structure when all rethook_node are freed.
@@ -33,6 +34,7 @@ struct rethook {
 	struct freelist_head	pool;
 	refcount_t		ref;
 	struct rcu_head		rcu;
+	void			*nodes;
 };
 
 /**
@@ -61,6 +63,7 @@ struct rethook_node {
 struct rethook *rethook_alloc(void *data, rethook_handler_t handler);
 void rethook_free(struct rethook *rh);
 void rethook_add_node(struct rethook *rh, struct rethook_node *node);
+int rethook_alloc_nodes(struct rethook *rh, size_t size, int num);
 struct rethook_node *rethook_try_get(struct rethook *rh);
 void rethook_recycle(struct rethook_node *node);
 void rethook_hook(struct rethook_node *node, struct pt_regs *regs, bool mcount);
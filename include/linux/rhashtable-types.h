@@ -24,6 +24,7 @@ struct rhlist_head {
 };
 
 struct bucket_table;
+struct mem_cgroup;
 
 /**
  * struct rhashtable_compare_arg - Key for the function rhashtable_compare
@@ -52,6 +53,7 @@ typedef int (*rht_obj_cmpfn_t)(struct rhashtable_compare_arg *arg,
  * @hashfn: Hash function (default: jhash2 if !(key_len % 4), or jhash)
  * @obj_hashfn: Function to hash object
  * @obj_cmpfn: Function to compare key with object
+ * @memcg: Memory cgroup to charge the bucket tables to, or NULL
  */
 struct rhashtable_params {
 	u16			nelem_hint;
@@ -64,6 +66,7 @@ struct rhashtable_params {
 	rht_hashfn_t		hashfn;
 	rht_obj_hashfn_t	obj_hashfn;
 	rht_obj_cmpfn_t		obj_cmpfn;
+	struct mem_cgroup	*memcg;
 };
 
 /**
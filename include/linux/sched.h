@@ -558,6 +558,9 @@ struct sched_entity {
 
 	u64				nr_migrations;
 
+	/* MIN_LATENCY_NICE..MAX_LATENCY_NICE, see sched_slice() */
+	int				latency_nice;
+
 #ifdef CONFIG_FAIR_GROUP_SCHED
 	int				depth;
 	struct sched_entity		*parent;
@@ -861,6 +864,11 @@ struct task_struct {
 
 	struct sched_info		sched_info;
 
+#ifdef CONFIG_LATENCY_HIST
+	/* local_clock() at syscall entry, 0 if not recorded */
+	u64				lat_hist_syscall_start;
+#endif
+
 	struct list_head		tasks;
 #ifdef CONFIG_SMP
 	struct plist_node		pushable_tasks;
@@ -1300,6 +1308,11 @@ struct task_struct {
 	unsigned long			numa_pages_migrated;
 #endif /* CONFIG_NUMA_BALANCING */
 
+#ifdef CONFIG_SCHED_CACHE
+	/* Updates mm->mm_sched_cpu, see task_tick_cache() */
+	struct callback_head		cache_work;
+#endif
+
 #ifdef CONFIG_RSEQ
 	struct rseq __user *rseq;
 	u32 rseq_sig;
@@ -1878,6 +1891,7 @@ static inline int dl_task_check_affinity(struct task_struct *p, const struct cpu
 
 extern int yield_to(struct task_struct *p, bool preempt);
 extern void set_user_nice(struct task_struct *p, long nice);
+extern int sched_set_latency_nice(struct task_struct *p, int latency_nice);
 extern int task_prio(const struct task_struct *p);
 
 /**
@@ -0,0 +1,30 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+#ifndef _LINUX_SCHED_FAIR_OPS_H
+#define _LINUX_SCHED_FAIR_OPS_H
+
+#include <linux/types.h>
+
+struct task_struct;
+
+#define SCHED_FAIR_OPS_NAME_LEN	16
+
+/**
+ * struct sched_fair_ops - BPF hooks into SCHED_NORMAL/SCHED_BATCH decisions
+ *
+ * Implemented by a BPF_MAP_TYPE_STRUCT_OPS map. Each hook is optional and
+ * may return a negative value to leave the decision to CFS. At most one set
+ * of ops is registered at a time.
+ *
+ * @select_cpu: pick the CPU for @p on wakeup, fork and exec. The CPU must be
+ *	in @p->cpus_ptr. @wake_flags are the WF_* flags.
+ * @wakeup_preempt: return 1 if the waking @p should preempt @curr, 0 if it
+ *	should not.
+ * @name: name of the policy, for messages.
+ */
+struct sched_fair_ops {
+	s32 (*select_cpu)(struct task_struct *p, s32 prev_cpu, u64 wake_flags);
+	s32 (*wakeup_preempt)(struct task_struct *p, struct task_struct *curr);
+	char name[SCHED_FAIR_OPS_NAME_LEN];
+};
+
+#endif /* _LINUX_SCHED_FAIR_OPS_H */
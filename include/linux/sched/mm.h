@@ -37,6 +37,18 @@ static inline void mmgrab(struct mm_struct *mm)
 	atomic_inc(&mm->mm_count);
 }
 
+#ifdef CONFIG_SCHED_CACHE
+extern int mm_sched_init(struct mm_struct *mm);
+extern void mm_sched_destroy(struct mm_struct *mm);
+#else
+static inline int mm_sched_init(struct mm_struct *mm)
+{
+	return 0;
+}
+
+static inline void mm_sched_destroy(struct mm_struct *mm) { }
+#endif
+
 extern void __mmdrop(struct mm_struct *mm);
 
 static inline void mmdrop(struct mm_struct *mm)
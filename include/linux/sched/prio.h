@@ -6,6 +6,14 @@
 #define MIN_NICE	-20
 #define NICE_WIDTH	(MAX_NICE - MIN_NICE + 1)
 
+/*
+ * Latency nice is a hint for the fair scheduler: negative values ask for
+ * lower wakeup latency, positive ones tolerate more, at the same CPU share.
+ */
+#define MAX_LATENCY_NICE	19
+#define MIN_LATENCY_NICE	-20
+#define LATENCY_NICE_WIDTH	(MAX_LATENCY_NICE - MIN_LATENCY_NICE + 1)
+
 /*
  * Priority of a process goes from 0..MAX_PRIO-1, valid RT
  * priority is 0..MAX_RT_PRIO-1, and SCHED_NORMAL/SCHED_BATCH
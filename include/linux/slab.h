@@ -487,6 +487,20 @@ void kmem_cache_free(struct kmem_cache *s, void *objp);
 void kmem_cache_free_bulk(struct kmem_cache *s, size_t size, void **p);
 int kmem_cache_alloc_bulk(struct kmem_cache *s, gfp_t flags, size_t size, void **p);
 
+/*
+ * Opt-in per cpu array of free objects for caches with high alloc/free churn.
+ * Only SLUB implements it, it is a no-op for the other allocators.
+ */
+#ifdef CONFIG_SLUB
+int kmem_cache_setup_percpu_array(struct kmem_cache *s, unsigned int count);
+#else
+static inline int kmem_cache_setup_percpu_array(struct kmem_cache *s,
+						unsigned int count)
+{
+	return 0;
+}
+#endif
+
 /*
  * Caller must not use kfree_bulk() on memory not originally allocated
  * by kmalloc(), because the SLOB allocator cannot handle this.
@@ -39,6 +39,10 @@ enum stat_item {
 	CPU_PARTIAL_FREE,	/* Refill cpu partial on free */
 	CPU_PARTIAL_NODE,	/* Refill cpu partial from node partial */
 	CPU_PARTIAL_DRAIN,	/* Drain cpu partial to node partial */
+	ALLOC_PCA,		/* Allocation from percpu array */
+	FREE_PCA,		/* Free to percpu array */
+	PCA_REFILL,		/* Refill percpu array from cpu slab */
+	PCA_FLUSH,		/* Flush percpu array to slabs */
 	NR_SLUB_STAT_ITEMS };
 
 #ifndef CONFIG_SLUB_TINY
@@ -58,6 +62,18 @@ struct kmem_cache_cpu {
 	unsigned stat[NR_SLUB_STAT_ITEMS];
 #endif
 };
+
+/*
+ * Optional per cpu array of free objects in front of the cpu slab, set up
+ * with kmem_cache_setup_percpu_array(). Freed objects are pushed and
+ * allocations pop the most recently freed, cache hot, one.
+ */
+struct slub_percpu_array {
+	local_lock_t lock;	/* Protects the fields below */
+	unsigned int count;	/* Capacity of objects[] */
+	unsigned int used;	/* Number of objects cached */
+	void *objects[];
+};
 #endif /* CONFIG_SLUB_TINY */
 
 #ifdef CONFIG_SLUB_CPU_PARTIAL
@@ -92,6 +108,7 @@ struct kmem_cache_order_objects {
 struct kmem_cache {
 #ifndef CONFIG_SLUB_TINY
 	struct kmem_cache_cpu __percpu *cpu_slab;
+	struct slub_percpu_array __percpu *cpu_array;
 #endif
 	/* Used for retrieving partial slabs, etc. */
 	slab_flags_t flags;
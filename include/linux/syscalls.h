@@ -10,6 +10,7 @@
 #define _LINUX_SYSCALLS_H
 
 struct __aio_sigset;
+struct dirent_statx;
 struct epoll_event;
 struct iattr;
 struct inode;
@@ -23,6 +24,7 @@ struct linux_dirent64;
 struct list_head;
 struct mmap_arg_struct;
 struct msgbuf;
+struct msg_batch;
 struct user_msghdr;
 struct mmsghdr;
 struct msqid_ds;
@@ -491,6 +493,10 @@ asmlinkage long sys_quotactl_fd(unsigned int fd, unsigned int cmd, qid_t id,
 asmlinkage long sys_getdents64(unsigned int fd,
 				struct linux_dirent64 __user *dirent,
 				unsigned int count);
+asmlinkage long sys_getdents_statx(unsigned int fd,
+				   struct dirent_statx __user *dirent,
+				   unsigned int count, unsigned int mask,
+				   unsigned int flags);
 
 /* fs/read_write.c */
 asmlinkage long sys_llseek(unsigned int fd, unsigned long offset_high,
@@ -815,6 +821,10 @@ asmlinkage long sys_msgrcv(int msqid, struct msgbuf __user *msgp,
 				size_t msgsz, long msgtyp, int msgflg);
 asmlinkage long sys_msgsnd(int msqid, struct msgbuf __user *msgp,
 				size_t msgsz, int msgflg);
+asmlinkage long sys_msgrcv_batch(int msqid, struct msg_batch __user *vec,
+				 unsigned int vlen, long msgtyp, int msgflg);
+asmlinkage long sys_msgsnd_batch(int msqid, struct msg_batch __user *vec,
+				 unsigned int vlen, int msgflg);
 
 /* ipc/sem.c */
 asmlinkage long sys_semget(key_t key, int nsems, int semflg);
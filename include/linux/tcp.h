@@ -450,6 +450,7 @@ struct tcp_sock {
 	 */
 	struct request_sock __rcu *fastopen_rsk;
 	struct saved_syn *saved_syn;
+	struct tcp_latency_hist *lat_hist; /* TCP_LATENCY_HIST, if enabled */
 };
 
 enum tsq_enum {
@@ -461,6 +462,7 @@ enum tsq_enum {
 	TCP_MTU_REDUCED_DEFERRED,  /* tcp_v{4|6}_err() could not call
 				    * tcp_v{4|6}_mtu_reduced()
 				    */
+	TCP_ACK_BATCHED,	   /* ACK postponed to tcp_tasklet_func() */
 };
 
 enum tsq_flags {
@@ -470,6 +472,7 @@ enum tsq_flags {
 	TCPF_WRITE_TIMER_DEFERRED	= (1UL << TCP_WRITE_TIMER_DEFERRED),
 	TCPF_DELACK_TIMER_DEFERRED	= (1UL << TCP_DELACK_TIMER_DEFERRED),
 	TCPF_MTU_REDUCED_DEFERRED	= (1UL << TCP_MTU_REDUCED_DEFERRED),
+	TCPF_ACK_BATCHED		= (1UL << TCP_ACK_BATCHED),
 };
 
 static inline struct tcp_sock *tcp_sk(const struct sock *sk)
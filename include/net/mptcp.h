@@ -96,9 +96,31 @@ struct mptcp_out_options {
 #endif
 };
 
+#define MPTCP_SCHED_NAME_MAX	16
+
+/* MPTCP packet scheduler: picks the subflow to push data on, for new data
+ * and for reinjection. Both are called with the msk socket lock held and
+ * may return NULL when no subflow can currently send.
+ */
+struct mptcp_sched_ops {
+	struct sock *(*get_send)(struct mptcp_sock *msk);
+	struct sock *(*get_retrans)(struct mptcp_sock *msk);
+
+	/* optional per connection setup and teardown */
+	void (*init)(struct mptcp_sock *msk);
+	void (*release)(struct mptcp_sock *msk);
+
+	char			name[MPTCP_SCHED_NAME_MAX];
+	struct module		*owner;
+	struct list_head	list;
+} ____cacheline_aligned_in_smp;
+
 #ifdef CONFIG_MPTCP
 void mptcp_init(void);
 
+int mptcp_register_scheduler(struct mptcp_sched_ops *sched);
+void mptcp_unregister_scheduler(struct mptcp_sched_ops *sched);
+
 static inline bool sk_is_mptcp(const struct sock *sk)
 {
 	return tcp_sk(sk)->is_mptcp;
@@ -323,6 +323,7 @@ extern struct hlist_nulls_head *nf_conntrack_hash;
 extern unsigned int nf_conntrack_htable_size;
 extern seqcount_spinlock_t nf_conntrack_generation;
 extern unsigned int nf_conntrack_max;
+extern u8 nf_conntrack_hash_autogrow;
 
 /* must be called with rcu read lock held */
 static inline void
@@ -197,6 +197,11 @@ struct page_pool {
 #ifdef CONFIG_PAGE_POOL_STATS
 	/* recycle stats are per-cpu to avoid locking */
 	struct page_pool_recycle_stats __percpu *recycle_stats;
+
+	/* ptr_ring growth, driven by recycle_stats.ring_full */
+	unsigned long ring_resize_next;
+	u64 ring_full_last;
+	unsigned int ring_size_max;
 #endif
 	atomic_t pages_state_release_cnt;
 
@@ -26,6 +26,7 @@ struct xdp_buff_xsk {
 	struct xsk_buff_pool *pool;
 	u64 orig_addr;
 	struct list_head free_list_node;
+	struct list_head xskb_list_node;
 };
 
 struct xsk_dma_map {
@@ -49,6 +50,8 @@ struct xsk_buff_pool {
 	struct xdp_umem *umem;
 	struct work_struct work;
 	struct list_head free_list;
+	/* Frags of the multi-buffer frame being built by the ZC driver */
+	struct list_head xskb_list;
 	u32 heads_cnt;
 	u16 queue_id;
 
@@ -205,6 +208,11 @@ static inline u32 xp_aligned_extract_idx(struct xsk_buff_pool *pool, u64 addr)
 	return xp_aligned_extract_addr(pool, addr) >> pool->chunk_shift;
 }
 
+static inline bool xp_mb_desc(struct xdp_desc *desc)
+{
+	return desc->options & XDP_PKT_CONTD;
+}
+
 static inline void xp_release(struct xdp_buff_xsk *xskb)
 {
 	if (xskb->pool->unaligned)
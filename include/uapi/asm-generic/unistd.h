@@ -889,8 +889,16 @@ __SYSCALL(__NR_set_mempolicy_home_node, sys_set_mempolicy_home_node)
 #define __NR_memfd_restricted 451
 __SYSCALL(__NR_memfd_restricted, sys_memfd_restricted)
 
+#define __NR_getdents_statx 452
+__SYSCALL(__NR_getdents_statx, sys_getdents_statx)
+
+#define __NR_msgsnd_batch 453
+__SC_COMP(__NR_msgsnd_batch, sys_msgsnd_batch, compat_sys_msgsnd_batch)
+#define __NR_msgrcv_batch 454
+__SC_COMP(__NR_msgrcv_batch, sys_msgrcv_batch, compat_sys_msgrcv_batch)
+
 #undef __NR_syscalls
-#define __NR_syscalls 452
+#define __NR_syscalls 455
 
 /*
  * 32 bit systems traditionally used different
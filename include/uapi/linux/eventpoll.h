@@ -18,6 +18,7 @@
 /* For O_CLOEXEC */
 #include <linux/fcntl.h>
 #include <linux/types.h>
+#include <linux/ioctl.h>
 
 /* Flags for epoll_create1.  */
 #define EPOLL_CLOEXEC O_CLOEXEC
@@ -85,6 +86,26 @@ struct epoll_event {
 	__u64 data;
 } EPOLL_PACKED;
 
+/*
+ * Per epoll instance busy poll settings: busy_poll_usecs overrides the
+ * net.core.busy_poll sysctl, busy_poll_budget the number of packets polled
+ * per NAPI iteration, and prefer_busy_poll keeps the device interrupts of
+ * the polled NAPI masked for as long as the application keeps polling, at
+ * the pace set by the device's napi_defer_hard_irqs and gro_flush_timeout.
+ */
+struct epoll_params {
+	__u32 busy_poll_usecs;
+	__u16 busy_poll_budget;
+	__u8 prefer_busy_poll;
+
+	/* pad the struct to a multiple of 64bits */
+	__u8 __pad;
+};
+
+#define EPOLL_IOC_TYPE 0x8A
+#define EPIOCSPARAMS _IOW(EPOLL_IOC_TYPE, 0x01, struct epoll_params)
+#define EPIOCGPARAMS _IOR(EPOLL_IOC_TYPE, 0x02, struct epoll_params)
+
 #ifdef CONFIG_PM_SLEEP
 static inline void ep_take_care_of_epollwakeup(struct epoll_event *epev)
 {
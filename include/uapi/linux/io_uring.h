@@ -223,6 +223,10 @@ enum io_uring_op {
 	IORING_OP_URING_CMD,
 	IORING_OP_SEND_ZC,
 	IORING_OP_SENDMSG_ZC,
+	IORING_OP_RECV_ZC,
+	IORING_OP_READ_MULTISHOT,
+	IORING_OP_READV_FIXED,
+	IORING_OP_WRITEV_FIXED,
 
 	/* this goes last, obviously */
 	IORING_OP_LAST,
@@ -371,11 +375,15 @@ struct io_uring_cqe {
  * IORING_CQE_F_SOCK_NONEMPTY	If set, more data to read after socket recv
  * IORING_CQE_F_NOTIF	Set for notification CQEs. Can be used to distinct
  * 			them from sends.
+ * IORING_CQE_F_BUF_MORE	If set, the buffer ID set in the completion will
+ *			get more completions, i.e. it wasn't fully consumed
+ *			(IOU_PBUF_RING_INC buffer rings only).
  */
 #define IORING_CQE_F_BUFFER		(1U << 0)
 #define IORING_CQE_F_MORE		(1U << 1)
 #define IORING_CQE_F_SOCK_NONEMPTY	(1U << 2)
 #define IORING_CQE_F_NOTIF		(1U << 3)
+#define IORING_CQE_F_BUF_MORE		(1U << 4)
 
 enum {
 	IORING_CQE_BUFFER_SHIFT		= 16,
@@ -516,6 +524,9 @@ enum {
 	/* register a range of fixed file slots for automatic slot allocation */
 	IORING_REGISTER_FILE_ALLOC_RANGE	= 25,
 
+	/* set the SQPOLL submission weight of the ring, __u32 argument */
+	IORING_REGISTER_SQ_WEIGHT		= 26,
+
 	/* this goes last */
 	IORING_REGISTER_LAST
 };
@@ -629,12 +640,37 @@ struct io_uring_buf_ring {
 	};
 };
 
+/*
+ * Flags for IORING_REGISTER_PBUF_RING.
+ *
+ * IOU_PBUF_RING_INC:	Buffers are consumed incrementally.  A buffer is only
+ *			retired once it has been filled, until then each
+ *			completion consumes just the bytes it transferred,
+ *			the kernel advances the entry's addr/len and the CQE
+ *			carries IORING_CQE_F_BUF_MORE.
+ */
+enum {
+	IOU_PBUF_RING_INC	= 2,
+};
+
+/*
+ * Segment of an IORING_OP_READV_FIXED/WRITEV_FIXED request. sqe->addr points
+ * to an array of sqe->len of these, each one must lie entirely within the
+ * registered buffer at @buf_index.
+ */
+struct io_uring_fixed_vec {
+	__u64	addr;
+	__u32	len;
+	__u16	buf_index;
+	__u16	resv;
+};
+
 /* argument for IORING_(UN)REGISTER_PBUF_RING */
 struct io_uring_buf_reg {
 	__u64	ring_addr;
 	__u32	ring_entries;
 	__u16	bgid;
-	__u16	pad;
+	__u16	flags;
 	__u64	resv[3];
 };
 
@@ -0,0 +1,43 @@
+/* SPDX-License-Identifier: GPL-2.0 WITH Linux-syscall-note */
+#ifndef _UAPI_LINUX_LATENCY_HIST_H
+#define _UAPI_LINUX_LATENCY_HIST_H
+
+#include <linux/types.h>
+
+/*
+ * Layout of the tracefs latency_hist/hist file: a struct lat_hist_header
+ * followed by @nr_records struct lat_hist_record, each with @nr_buckets
+ * counts. Only histograms with samples are reported, summed over all CPUs.
+ *
+ * Latencies are in nanoseconds. Bucket i < 2^@sub_bucket_bits counts the
+ * value i; above that, each power of two is split in 2^@sub_bucket_bits
+ * linear buckets. The last bucket also counts everything larger.
+ */
+#define LAT_HIST_MAGIC		0x4c415448	/* "LATH" */
+#define LAT_HIST_VERSION	1
+
+enum lat_hist_type {
+	LAT_HIST_SYSCALL,	/* id: native syscall number */
+	LAT_HIST_FAULT,		/* id: 0 for kernel, 1 for user faults */
+	LAT_HIST_SOFTIRQ,	/* id: softirq vector */
+	LAT_HIST_RUNQ_WAIT,	/* id: 0 */
+	NR_LAT_HIST_TYPES,
+};
+
+struct lat_hist_header {
+	__u32	magic;
+	__u32	version;
+	__u32	nr_buckets;
+	__u32	sub_bucket_bits;
+	__u32	nr_records;
+	__u32	__reserved;
+};
+
+struct lat_hist_record {
+	__u16	type;
+	__u16	__reserved;
+	__u32	id;
+	__u64	counts[];
+};
+
+#endif /* _UAPI_LINUX_LATENCY_HIST_H */
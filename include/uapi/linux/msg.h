@@ -40,6 +40,16 @@ struct msgbuf {
 	char mtext[1];                  /* message text */
 };
 
+/* one message of the msgsnd_batch and msgrcv_batch calls */
+struct msg_batch {
+	__u64 msgp;			/* struct msgbuf pointer */
+	__u64 msgsz;			/* size of mtext */
+	__s64 result;			/* bytes received, 0 if sent or -errno */
+};
+
+/* maximum number of messages moved by one batch call */
+#define MSG_BATCH_MAX	64
+
 /* buffer for msgctl calls IPC_INFO, MSG_INFO */
 struct msginfo {
 	int msgpool;
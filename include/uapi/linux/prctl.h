@@ -281,6 +281,13 @@ struct prctl_mm_map {
 # define PR_SME_VL_LEN_MASK		0xffff
 # define PR_SME_VL_INHERIT		(1 << 17) /* inherit across exec */
 
+/*
+ * Per-thread latency hint for SCHED_NORMAL/SCHED_BATCH, -20..19.
+ * Kept out of the sequential range, which upstream keeps allocating from.
+ */
+#define PR_SET_LATENCY_NICE		0x4c4e4953	/* "LNIS" */
+#define PR_GET_LATENCY_NICE		0x4c4e4947	/* "LNIG" */
+
 #define PR_SET_VMA		0x53564d41
 # define PR_SET_VMA_ANON_NAME		0
 
@@ -4,5 +4,9 @@
 
 /* flags for memfd_restricted */
 #define RMFD_USERMNT		0x0001U
+/* Back the memory with transparent huge pages (PMD-sized folios) */
+#define RMFD_HUGEPAGE		0x0002U
+/* Allocate according to the calling task's memory policy, see set_mempolicy(2) */
+#define RMFD_MPOL		0x0004U
 
 #endif /* _UAPI_LINUX_RESTRICTEDMEM_H */
\ No newline at end of file
@@ -131,6 +131,24 @@ struct statx {
 	/* 0x100 */
 };
 
+/*
+ * Directory entry returned by getdents_statx().
+ *
+ * d_stx holds the attributes asked for in the mask argument, as statx() with
+ * AT_SYMLINK_NOFOLLOW would return them.  They are only filled in for entries
+ * whose dentry is already cached and that are not mount points; for all other
+ * entries d_stx.stx_mask is 0 and the caller has to fall back to statx().
+ */
+struct dirent_statx {
+	__u64	d_ino;
+	__s64	d_off;		/* Offset of the next entry */
+	__u16	d_reclen;	/* Length of this record */
+	__u8	d_type;		/* DT_* type of the entry */
+	__u8	__spare0[5];
+	struct statx d_stx;
+	char	d_name[];	/* NUL terminated name */
+};
+
 /*
  * Flags to be stx_mask
  *
@@ -129,6 +129,9 @@ enum {
 
 #define TCP_TX_DELAY		37	/* delay outgoing packets by XX usec */
 
+/* Well above the range upstream allocates from */
+#define TCP_LATENCY_HIST	128	/* Record/get latency histograms */
+
 
 #define TCP_REPAIR_ON		1
 #define TCP_REPAIR_OFF		0
@@ -365,4 +368,21 @@ struct tcp_zerocopy_receive {
 	__u32 msg_flags;
 	__u32 reserved; /* set to 0 for now */
 };
+
+/* getsockopt(fd, IPPROTO_TCP, TCP_LATENCY_HIST, ...)
+ *
+ * Bucket 0 counts samples below 1 usec, bucket i > 0 samples in
+ * [2^(i-1), 2^i) usec; the last bucket also counts everything above.
+ */
+#define TCP_LATENCY_HIST_BUCKETS	24
+
+struct tcp_latency_hist {
+	__u32	tcpl_rtt[TCP_LATENCY_HIST_BUCKETS];	  /* RTT samples */
+	__u32	tcpl_app_limited[TCP_LATENCY_HIST_BUCKETS]; /* Periods with
+							     * nothing to send
+							     */
+	__u32	tcpl_rcvq_dwell[TCP_LATENCY_HIST_BUCKETS]; /* Arrival to
+							    * recvmsg()
+							    */
+};
 #endif /* _UAPI_LINUX_TCP_H */
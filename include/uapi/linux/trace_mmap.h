@@ -0,0 +1,59 @@
+/* SPDX-License-Identifier: GPL-2.0 WITH Linux-syscall-note */
+#ifndef _UAPI_TRACE_MMAP_H_
+#define _UAPI_TRACE_MMAP_H_
+
+#include <linux/types.h>
+
+/**
+ * struct trace_buffer_meta - Ring-buffer meta-page description
+ * @meta_page_size:	Size of this meta-page.
+ * @meta_struct_len:	Size of this structure.
+ * @subbuf_size:	Size of each sub-buffer, including its header.
+ * @nr_subbufs:		Number of sub-buffers in the ring-buffer, including
+ *			the reader.
+ * @reader.lost_events:	Number of events lost before the data of the reader
+ *			sub-buffer.
+ * @reader.id:		ID of the reader sub-buffer, in [0 : @nr_subbufs - 1].
+ * @reader.read:	Offset in the reader sub-buffer data where the events
+ *			not seen yet start.
+ * @flags:		0 for now.
+ * @entries:		Number of entries in the ring-buffer.
+ * @overrun:		Number of entries lost in the ring-buffer.
+ * @read:		Number of entries that have been read.
+ *
+ * The meta-page is the first page of the mapping, sub-buffer @id follows at
+ * offset (@id + 1) * @meta_page_size. Each sub-buffer starts with a 64-bit
+ * timestamp and a word holding the committed data size, as described by
+ * events/header_page.
+ */
+struct trace_buffer_meta {
+	__u32		meta_page_size;
+	__u32		meta_struct_len;
+
+	__u32		subbuf_size;
+	__u32		nr_subbufs;
+
+	struct {
+		__u64	lost_events;
+		__u32	id;
+		__u32	read;
+	} reader;
+
+	__u64	flags;
+
+	__u64	entries;
+	__u64	overrun;
+	__u64	read;
+
+	__u64	Reserved1;
+	__u64	Reserved2;
+};
+
+/*
+ * Make the next unread data of the buffer available in the reader
+ * sub-buffer and mark it as consumed. Blocks until data is available unless
+ * the file was opened with O_NONBLOCK.
+ */
+#define TRACE_MMAP_IOCTL_GET_READER		_IO('R', 0x20)
+
+#endif /* _UAPI_TRACE_MMAP_H_ */
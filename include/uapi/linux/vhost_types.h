@@ -27,6 +27,28 @@ struct vhost_vring_file {
 
 };
 
+struct vhost_worker_state {
+	/*
+	 * For VHOST_NEW_WORKER the kernel will return the new vhost_worker id.
+	 * For VHOST_FREE_WORKER this must be set to the id of the vhost_worker
+	 * to free.
+	 */
+	unsigned int worker_id;
+	/*
+	 * For VHOST_NEW_WORKER, the CPU the new vhost_worker is allowed to run
+	 * on, or VHOST_WORKER_CPU_ANY to leave its affinity unrestricted.
+	 */
+#define VHOST_WORKER_CPU_ANY -1
+	int cpu;
+};
+
+struct vhost_vring_worker {
+	/* vring index */
+	unsigned int index;
+	/* The id of the vhost_worker returned from VHOST_NEW_WORKER */
+	unsigned int worker_id;
+};
+
 struct vhost_vring_addr {
 	unsigned int index;
 	/* Option flags. */
@@ -163,5 +185,9 @@ struct vhost_vdpa_iova_range {
 #define VHOST_BACKEND_F_IOTLB_ASID  0x3
 /* Device can be suspended */
 #define VHOST_BACKEND_F_SUSPEND  0x4
+/* vhost-net may defer TX used ring updates and guest notifications across
+ * handler runs, bounded by a latency budget, to batch completions
+ */
+#define VHOST_BACKEND_F_TX_BATCH  0x5
 
 #endif
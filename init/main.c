@@ -78,6 +78,7 @@
 #include <linux/kgdb.h>
 #include <linux/ftrace.h>
 #include <linux/async.h>
+#include <linux/wait_bit.h>
 #include <linux/shmem_fs.h>
 #include <linux/slab.h>
 #include <linux/perf_event.h>
@@ -1364,9 +1365,108 @@ static int __init ignore_unknown_bootoption(char *param, char *val,
 	return 0;
 }
 
+/*
+ * initcall_async=0 runs the asynchronous initcalls synchronously, in
+ * dependency order, which helps to track down missing dependencies.
+ */
+static bool initcall_async __initdata = true;
+
+static int __init initcall_async_setup(char *str)
+{
+	return kstrtobool(str, &initcall_async) == 0;
+}
+__setup("initcall_async=", initcall_async_setup);
+
+static ASYNC_DOMAIN(initcall_domain);
+
+/* Asynchronous initcalls queued in the current level, latest first */
+static struct async_initcall *async_initcalls __initdata;
+
+static void __init async_initcall_run(struct async_initcall *ic)
+{
+	struct async_initcall *dep = ic->dep;
+
+	if (dep)
+		wait_var_event(&dep->done, smp_load_acquire(&dep->done));
+
+	ic->start = local_clock();
+	do_one_initcall(ic->fn);
+	ic->end = local_clock();
+
+	smp_store_release(&ic->done, true);
+	wake_up_var(&ic->done);
+}
+
+static void __init do_async_initcall(void *data, async_cookie_t cookie)
+{
+	async_initcall_run(data);
+}
+
+int __init async_initcall_schedule(struct async_initcall *ic)
+{
+	if (ic->queued)
+		return 0;
+
+	/*
+	 * A @dep that isn't queued yet sits in a later level, which can't
+	 * start before @ic returns, so @ic would wait for it forever. Pull it
+	 * in ahead of its level instead, as initcall_async=0 does.
+	 */
+	if (ic->dep && WARN(!ic->dep->queued,
+			    "initcall %pS runs before its dependency %pS\n",
+			    ic->fn, ic->dep->fn))
+		async_initcall_schedule(ic->dep);
+
+	ic->queued = true;
+	ic->next = async_initcalls;
+	async_initcalls = ic;
+
+	if (initcall_async) {
+		async_schedule_domain(do_async_initcall, ic, &initcall_domain);
+		return 0;
+	}
+
+	if (ic->dep)
+		async_initcall_schedule(ic->dep);
+	async_initcall_run(ic);
+	return 0;
+}
+
+/*
+ * Wait for the asynchronous initcalls of @level. With initcall_debug, report
+ * the time the level took and its critical path: the chain of asynchronous
+ * initcalls which finished last.
+ */
+static void __init async_initcalls_wait(int level, u64 start)
+{
+	struct async_initcall *ic, *last = NULL;
+
+	async_synchronize_full_domain(&initcall_domain);
+
+	if (initcall_debug) {
+		for (ic = async_initcalls; ic; ic = ic->next) {
+			if (!last || ic->end > last->end)
+				last = ic;
+		}
+
+		printk(KERN_DEBUG "initcall level %s took %llu usecs\n",
+		       initcall_level_names[level],
+		       (local_clock() - start) / NSEC_PER_USEC);
+
+		for (ic = last; ic && ic->end >= start; ic = ic->dep)
+			printk(KERN_DEBUG "  %s %pS: %llu usecs, done at +%llu usecs\n",
+			       ic == last ? "critical path" : "  after",
+			       ic->fn, (ic->end - ic->start) / NSEC_PER_USEC,
+			       (ic->end - start) / NSEC_PER_USEC);
+	}
+
+	async_initcalls = NULL;
+}
+
 static void __init do_initcall_level(int level, char *command_line)
 {
 	initcall_entry_t *fn;
+	u64 start;
 
 	parse_args(initcall_level_names[level],
 		   command_line, __start___param,
@@ -1375,8 +1475,10 @@ static void __init do_initcall_level(int level, char *command_line)
 		   NULL, ignore_unknown_bootoption);
 
 	trace_initcall_level(initcall_level_names[level]);
+	start = local_clock();
 	for (fn = initcall_levels[level]; fn < initcall_levels[level+1]; fn++)
 		do_one_initcall(initcall_from_entry(fn));
+	async_initcalls_wait(level, start);
 }
 
 static void __init do_initcalls(void)
@@ -1624,6 +1726,7 @@ static noinline void __init kernel_init_freeable(void)
 
 	smp_init();
 	sched_init_smp();
+	workqueue_init_topology();
 
 	padata_init();
 	page_alloc_init_late();
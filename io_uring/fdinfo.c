@@ -146,6 +146,12 @@ static __cold void __io_uring_show_fdinfo(struct io_ring_ctx *ctx,
 
 	seq_printf(m, "SqThread:\t%d\n", sq ? task_pid_nr(sq->thread) : -1);
 	seq_printf(m, "SqThreadCpu:\t%d\n", sq ? task_cpu(sq->thread) : -1);
+	if (sq) {
+		seq_printf(m, "SqWeight:\t%u\n", READ_ONCE(ctx->sq_weight));
+		seq_printf(m, "SqSubmitted:\t%llu\n", READ_ONCE(ctx->sq_submitted));
+		seq_printf(m, "SqBusyPasses:\t%llu\n", READ_ONCE(ctx->sq_busy_passes));
+		seq_printf(m, "SqIdleSkipped:\t%llu\n", READ_ONCE(ctx->sq_idle_skipped));
+	}
 	seq_printf(m, "UserFiles:\t%u\n", ctx->nr_user_files);
 	for (i = 0; has_lock && i < ctx->nr_user_files; i++) {
 		struct file *f = io_file_from_index(&ctx->file_table, i);
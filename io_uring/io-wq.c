@@ -463,14 +463,19 @@ static bool io_wait_on_hash(struct io_wqe *wqe, unsigned int hash)
 	return ret;
 }
 
-static struct io_wq_work *io_get_next_work(struct io_wqe_acct *acct,
-					   struct io_worker *worker)
+/*
+ * Pull the first runnable item off @acct, which belongs to @wqe.  Hashed work
+ * is taken as a whole [work, tail] chain.  The hash map is shared by all
+ * nodes of the io_wq, so this also serializes hashed work that is picked up
+ * by a worker of another node.
+ */
+static struct io_wq_work *__io_get_next_work(struct io_wqe *wqe,
+					     struct io_wqe_acct *acct,
+					     unsigned int *stall_hash)
 	__must_hold(acct->lock)
 {
 	struct io_wq_work_node *node, *prev;
 	struct io_wq_work *work, *tail;
-	unsigned int stall_hash = -1U;
-	struct io_wqe *wqe = worker->wqe;
 
 	wq_list_for_each(node, prev, &acct->work_list) {
 		unsigned int hash;
@@ -493,12 +498,27 @@ static struct io_wq_work *io_get_next_work(struct io_wqe_acct *acct,
 			wq_list_cut(&acct->work_list, &tail->list, prev);
 			return work;
 		}
-		if (stall_hash == -1U)
-			stall_hash = hash;
+		if (*stall_hash == -1U)
+			*stall_hash = hash;
 		/* fast forward to a next hash, for-each will fix up @prev */
 		node = &tail->list;
 	}
 
+	return NULL;
+}
+
+static struct io_wq_work *io_get_next_work(struct io_wqe_acct *acct,
+					   struct io_worker *worker)
+	__must_hold(acct->lock)
+{
+	unsigned int stall_hash = -1U;
+	struct io_wqe *wqe = worker->wqe;
+	struct io_wq_work *work;
+
+	work = __io_get_next_work(wqe, acct, &stall_hash);
+	if (work)
+		return work;
+
 	if (stall_hash != -1U) {
 		bool unstalled;
 
@@ -520,6 +540,71 @@ static struct io_wq_work *io_get_next_work(struct io_wqe_acct *acct,
 	return NULL;
 }
 
+static inline bool io_wqe_is_victim(struct io_wqe *wqe, struct io_wqe *victim)
+{
+	return victim && victim != wqe;
+}
+
+/*
+ * Check whether another node has queued work of @worker's type, without
+ * taking any locks.  Used by idle workers before going to sleep.
+ */
+static bool io_wq_can_steal(struct io_worker *worker)
+{
+	struct io_wqe *wqe = worker->wqe;
+	int index = io_wqe_get_acct(worker)->index;
+	int node;
+
+	if (nr_node_ids == 1)
+		return false;
+
+	for_each_node(node) {
+		struct io_wqe *victim = wqe->wq->wqes[node];
+
+		if (!io_wqe_is_victim(wqe, victim))
+			continue;
+		if (!wq_list_empty(&victim->acct[index].work_list) &&
+		    !test_bit(IO_ACCT_STALLED_BIT, &victim->acct[index].flags))
+			return true;
+	}
+	return false;
+}
+
+/*
+ * The local queue is empty or stalled on hashed work, take work queued on
+ * another node.  Contended queues are skipped rather than waited on, their
+ * own workers are busy with them anyway.
+ */
+static struct io_wq_work *io_steal_work(struct io_worker *worker)
+{
+	struct io_wqe *wqe = worker->wqe;
+	int index = io_wqe_get_acct(worker)->index;
+	int node;
+
+	if (nr_node_ids == 1)
+		return NULL;
+
+	for_each_node(node) {
+		struct io_wqe *victim = wqe->wq->wqes[node];
+		unsigned int stall_hash = -1U;
+		struct io_wqe_acct *acct;
+		struct io_wq_work *work;
+
+		if (!io_wqe_is_victim(wqe, victim))
+			continue;
+		acct = &victim->acct[index];
+		if (wq_list_empty(&acct->work_list))
+			continue;
+		if (!raw_spin_trylock(&acct->lock))
+			continue;
+		work = __io_get_next_work(victim, acct, &stall_hash);
+		raw_spin_unlock(&acct->lock);
+		if (work)
+			return work;
+	}
+	return NULL;
+}
+
 static void io_assign_current_work(struct io_worker *worker,
 				   struct io_wq_work *work)
 {
@@ -556,6 +641,8 @@ static void io_worker_handle_work(struct io_worker *worker)
 		raw_spin_lock(&acct->lock);
 		work = io_get_next_work(acct, worker);
 		raw_spin_unlock(&acct->lock);
+		if (!work)
+			work = io_steal_work(worker);
 		if (work) {
 			__io_worker_busy(wqe, worker);
 
@@ -630,6 +717,9 @@ static int io_wqe_worker(void *data)
 		set_current_state(TASK_INTERRUPTIBLE);
 		while (io_acct_run_queue(acct))
 			io_worker_handle_work(worker);
+		/* nothing left locally, help out other nodes before sleeping */
+		if (io_wq_can_steal(worker))
+			io_worker_handle_work(worker);
 
 		raw_spin_lock(&wqe->lock);
 		/* timed out, exit unless we're the last worker */
@@ -900,12 +990,43 @@ static bool io_wq_work_match_item(struct io_wq_work *work, void *data)
 	return work == data;
 }
 
+/*
+ * The local pool can't take more workers, wake an idle worker of the same
+ * type on another node.  It will steal the work once its own queue is empty.
+ */
+static bool io_wq_activate_remote_worker(struct io_wqe *wqe,
+					 struct io_wqe_acct *acct)
+{
+	bool ret = false;
+	int node;
+
+	if (nr_node_ids == 1)
+		return false;
+
+	for_each_node(node) {
+		struct io_wqe *victim = wqe->wq->wqes[node];
+
+		if (!io_wqe_is_victim(wqe, victim))
+			continue;
+
+		raw_spin_lock(&victim->lock);
+		rcu_read_lock();
+		ret = io_wqe_activate_free_worker(victim,
+						  &victim->acct[acct->index]);
+		rcu_read_unlock();
+		raw_spin_unlock(&victim->lock);
+		if (ret)
+			break;
+	}
+	return ret;
+}
+
 static void io_wqe_enqueue(struct io_wqe *wqe, struct io_wq_work *work)
 {
 	struct io_wqe_acct *acct = io_work_get_acct(wqe, work);
 	struct io_cb_cancel_data match;
 	unsigned work_flags = work->flags;
-	bool do_create;
+	bool do_create, saturated;
 
 	/*
 	 * If io-wq is exiting for this task, or if the request has explicitly
@@ -926,9 +1047,12 @@ static void io_wqe_enqueue(struct io_wqe *wqe, struct io_wq_work *work)
 	rcu_read_lock();
 	do_create = !io_wqe_activate_free_worker(wqe, acct);
 	rcu_read_unlock();
-
+	saturated = acct->nr_workers >= acct->max_workers;
 	raw_spin_unlock(&wqe->lock);
 
+	if (do_create && saturated && io_wq_activate_remote_worker(wqe, acct))
+		return;
+
 	if (do_create && ((work_flags & IO_WQ_WORK_CONCURRENT) ||
 	    !atomic_read(&acct->nr_running))) {
 		bool did_create;
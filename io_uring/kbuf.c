@@ -74,7 +74,43 @@ void io_kbuf_recycle_legacy(struct io_kiocb *req, unsigned issue_flags)
 	return;
 }
 
-unsigned int __io_put_kbuf(struct io_kiocb *req, unsigned issue_flags)
+static struct io_uring_buf *io_ring_head_to_buf(struct io_buffer_list *bl,
+						__u16 head)
+{
+	head &= bl->mask;
+	if (head < IO_BUFFER_LIST_BUF_PER_PAGE)
+		return &bl->buf_ring->bufs[head];
+
+	return (struct io_uring_buf *)
+		page_address(bl->buf_pages[head / IO_BUFFER_LIST_BUF_PER_PAGE]) +
+		(head & (IO_BUFFER_LIST_BUF_PER_PAGE - 1));
+}
+
+/*
+ * Consume @len bytes of the buffer at the head of an IOBL_INC ring.  The
+ * entry is only retired once it has been filled completely, until then its
+ * addr/len are advanced in place and the next selection continues where
+ * this one stopped.  Returns true if the buffer was retired.
+ *
+ * Must be called with ->uring_lock held since the buffer was selected.
+ */
+bool io_kbuf_inc_commit(struct io_buffer_list *bl, int len)
+{
+	struct io_uring_buf *buf = io_ring_head_to_buf(bl, bl->head);
+	u32 buf_len = READ_ONCE(buf->len);
+
+	if (len <= 0)
+		return false;
+	if (len < buf_len) {
+		WRITE_ONCE(buf->addr, READ_ONCE(buf->addr) + len);
+		WRITE_ONCE(buf->len, buf_len - len);
+		return false;
+	}
+	bl->head++;
+	return true;
+}
+
+unsigned int __io_put_kbuf(struct io_kiocb *req, int len, unsigned issue_flags)
 {
 	unsigned int cflags;
 
@@ -92,17 +128,17 @@ unsigned int __io_put_kbuf(struct io_kiocb *req, unsigned issue_flags)
 	 */
 	if (req->flags & REQ_F_BUFFER_RING) {
 		/* no buffers to recycle for this case */
-		cflags = __io_put_kbuf_list(req, NULL);
+		cflags = __io_put_kbuf_list(req, len, NULL);
 	} else if (issue_flags & IO_URING_F_UNLOCKED) {
 		struct io_ring_ctx *ctx = req->ctx;
 
 		spin_lock(&ctx->completion_lock);
-		cflags = __io_put_kbuf_list(req, &ctx->io_buffers_comp);
+		cflags = __io_put_kbuf_list(req, len, &ctx->io_buffers_comp);
 		spin_unlock(&ctx->completion_lock);
 	} else {
 		lockdep_assert_held(&req->ctx->uring_lock);
 
-		cflags = __io_put_kbuf_list(req, &req->ctx->io_buffers_cache);
+		cflags = __io_put_kbuf_list(req, len, &req->ctx->io_buffers_cache);
 	}
 	return cflags;
 }
@@ -132,21 +168,16 @@ static void __user *io_ring_buffer_select(struct io_kiocb *req, size_t *len,
 	struct io_uring_buf_ring *br = bl->buf_ring;
 	struct io_uring_buf *buf;
 	__u16 head = bl->head;
+	u32 buf_len;
 
 	if (unlikely(smp_load_acquire(&br->tail) == head))
 		return NULL;
 
-	head &= bl->mask;
-	if (head < IO_BUFFER_LIST_BUF_PER_PAGE) {
-		buf = &br->bufs[head];
-	} else {
-		int off = head & (IO_BUFFER_LIST_BUF_PER_PAGE - 1);
-		int index = head / IO_BUFFER_LIST_BUF_PER_PAGE;
-		buf = page_address(bl->buf_pages[index]);
-		buf += off;
-	}
-	if (*len == 0 || *len > buf->len)
-		*len = buf->len;
+	buf = io_ring_head_to_buf(bl, head);
+	/* incrementally consumed entries are updated by the kernel */
+	buf_len = (bl->flags & IOBL_INC) ? READ_ONCE(buf->len) : buf->len;
+	if (*len == 0 || *len > buf_len)
+		*len = buf_len;
 	req->flags |= REQ_F_BUFFER_RING;
 	req->buf_list = bl;
 	req->buf_index = buf->bid;
@@ -161,11 +192,15 @@ static void __user *io_ring_buffer_select(struct io_kiocb *req, size_t *len,
 		 * mode. For the locked case, the caller must call commit when
 		 * the transfer completes (or if we get -EAGAIN and must poll of
 		 * retry).
+		 *
+		 * IOBL_INC buffers are consumed whole in that case as well,
+		 * incremental consumption relies on the commit happening under
+		 * the same ->uring_lock section as the selection.
 		 */
 		req->buf_list = NULL;
 		bl->head++;
 	}
-	return u64_to_user_ptr(buf->addr);
+	return u64_to_user_ptr(READ_ONCE(buf->addr));
 }
 
 void __user *io_buffer_select(struct io_kiocb *req, size_t *len,
@@ -475,7 +510,9 @@ int io_register_pbuf_ring(struct io_ring_ctx *ctx, void __user *arg)
 	if (copy_from_user(&reg, arg, sizeof(reg)))
 		return -EFAULT;
 
-	if (reg.pad || reg.resv[0] || reg.resv[1] || reg.resv[2])
+	if (reg.flags & ~IOU_PBUF_RING_INC)
+		return -EINVAL;
+	if (reg.resv[0] || reg.resv[1] || reg.resv[2])
 		return -EINVAL;
 	if (!reg.ring_addr)
 		return -EFAULT;
@@ -519,6 +556,9 @@ int io_register_pbuf_ring(struct io_ring_ctx *ctx, void __user *arg)
 	bl->nr_entries = reg.ring_entries;
 	bl->buf_ring = br;
 	bl->mask = reg.ring_entries - 1;
+	bl->flags = 0;
+	if (reg.flags & IOU_PBUF_RING_INC)
+		bl->flags |= IOBL_INC;
 	io_buffer_add_list(ctx, bl, reg.bgid);
 	return 0;
 }
@@ -530,7 +570,7 @@ int io_unregister_pbuf_ring(struct io_ring_ctx *ctx, void __user *arg)
 
 	if (copy_from_user(&reg, arg, sizeof(reg)))
 		return -EFAULT;
-	if (reg.pad || reg.resv[0] || reg.resv[1] || reg.resv[2])
+	if (reg.flags || reg.resv[0] || reg.resv[1] || reg.resv[2])
 		return -EINVAL;
 
 	bl = io_buffer_get_list(ctx, reg.bgid);
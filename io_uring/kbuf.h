@@ -23,6 +23,12 @@ struct io_buffer_list {
 	__u16 nr_entries;
 	__u16 head;
 	__u16 mask;
+	__u16 flags;
+};
+
+enum {
+	/* ring entries are consumed incrementally, see io_kbuf_inc_commit() */
+	IOBL_INC		= 1,
 };
 
 struct io_buffer {
@@ -46,7 +52,8 @@ int io_provide_buffers(struct io_kiocb *req, unsigned int issue_flags);
 int io_register_pbuf_ring(struct io_ring_ctx *ctx, void __user *arg);
 int io_unregister_pbuf_ring(struct io_ring_ctx *ctx, void __user *arg);
 
-unsigned int __io_put_kbuf(struct io_kiocb *req, unsigned issue_flags);
+unsigned int __io_put_kbuf(struct io_kiocb *req, int len, unsigned issue_flags);
+bool io_kbuf_inc_commit(struct io_buffer_list *bl, int len);
 
 void io_kbuf_recycle_legacy(struct io_kiocb *req, unsigned issue_flags);
 
@@ -92,15 +99,20 @@ static inline void io_kbuf_recycle(struct io_kiocb *req, unsigned issue_flags)
 		io_kbuf_recycle_ring(req);
 }
 
-static inline unsigned int __io_put_kbuf_list(struct io_kiocb *req,
+static inline unsigned int __io_put_kbuf_list(struct io_kiocb *req, int len,
 					      struct list_head *list)
 {
 	unsigned int ret = IORING_CQE_F_BUFFER | (req->buf_index << IORING_CQE_BUFFER_SHIFT);
 
 	if (req->flags & REQ_F_BUFFER_RING) {
-		if (req->buf_list) {
-			req->buf_index = req->buf_list->bgid;
-			req->buf_list->head++;
+		struct io_buffer_list *bl = req->buf_list;
+
+		if (bl) {
+			req->buf_index = bl->bgid;
+			if (!(bl->flags & IOBL_INC))
+				bl->head++;
+			else if (!io_kbuf_inc_commit(bl, len))
+				ret |= IORING_CQE_F_BUF_MORE;
 		}
 		req->flags &= ~REQ_F_BUFFER_RING;
 	} else {
@@ -118,15 +130,15 @@ static inline unsigned int io_put_kbuf_comp(struct io_kiocb *req)
 
 	if (!(req->flags & (REQ_F_BUFFER_SELECTED|REQ_F_BUFFER_RING)))
 		return 0;
-	return __io_put_kbuf_list(req, &req->ctx->io_buffers_comp);
+	return __io_put_kbuf_list(req, 0, &req->ctx->io_buffers_comp);
 }
 
-static inline unsigned int io_put_kbuf(struct io_kiocb *req,
+static inline unsigned int io_put_kbuf(struct io_kiocb *req, int len,
 				       unsigned issue_flags)
 {
 
 	if (!(req->flags & (REQ_F_BUFFER_SELECTED|REQ_F_BUFFER_RING)))
 		return 0;
-	return __io_put_kbuf(req, issue_flags);
+	return __io_put_kbuf(req, len, issue_flags);
 }
 #endif
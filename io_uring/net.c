@@ -7,6 +7,7 @@
 #include <linux/compat.h>
 #include <net/compat.h>
 #include <linux/io_uring.h>
+#include <net/tcp.h>
 
 #include <uapi/linux/io_uring.h>
 
@@ -50,6 +51,13 @@ struct io_connect {
 	bool				seen_econnaborted;
 };
 
+struct io_recvzc {
+	struct file			*file;
+	struct tcp_zerocopy_receive __user *uzc;
+	unsigned			len;
+	u16				flags;
+};
+
 struct io_sr_msg {
 	struct file			*file;
 	union {
@@ -824,7 +832,7 @@ retry_multishot:
 	else
 		io_kbuf_recycle(req, issue_flags);
 
-	cflags = io_put_kbuf(req, issue_flags);
+	cflags = io_put_kbuf(req, ret, issue_flags);
 	if (kmsg->msg.msg_inq)
 		cflags |= IORING_CQE_F_SOCK_NONEMPTY;
 
@@ -926,7 +934,7 @@ out_free:
 	else
 		io_kbuf_recycle(req, issue_flags);
 
-	cflags = io_put_kbuf(req, issue_flags);
+	cflags = io_put_kbuf(req, ret, issue_flags);
 	if (msg.msg_inq)
 		cflags |= IORING_CQE_F_SOCK_NONEMPTY;
 
@@ -936,6 +944,76 @@ out_free:
 	return ret;
 }
 
+int io_recv_zc_prep(struct io_kiocb *req, const struct io_uring_sqe *sqe)
+{
+	struct io_recvzc *zc = io_kiocb_to_cmd(req, struct io_recvzc);
+
+	if (unlikely(sqe->off || sqe->addr2 || sqe->file_index ||
+		     sqe->msg_flags || sqe->buf_index))
+		return -EINVAL;
+
+	zc->uzc = u64_to_user_ptr(READ_ONCE(sqe->addr));
+	zc->len = READ_ONCE(sqe->len);
+	zc->flags = READ_ONCE(sqe->ioprio);
+	if (zc->flags & ~IORING_RECVSEND_POLL_FIRST)
+		return -EINVAL;
+	if (zc->len < offsetofend(struct tcp_zerocopy_receive, length) ||
+	    zc->len > sizeof(struct tcp_zerocopy_receive))
+		return -EINVAL;
+	return 0;
+}
+
+/*
+ * Zero-copy receive: map page-aligned payload of the TCP receive queue into
+ * the socket's mmap()ed receive area, exactly like getsockopt() with
+ * TCP_ZEROCOPY_RECEIVE, but without blocking the submitter.  If nothing is
+ * queued, poll is armed and the request is retried once data arrives.
+ * Mapped pages are handed back to the stack by unmapping or remapping the
+ * area, as with the sockopt.
+ */
+int io_recv_zc(struct io_kiocb *req, unsigned int issue_flags)
+{
+#if defined(CONFIG_INET) && defined(CONFIG_MMU)
+	struct io_recvzc *zc = io_kiocb_to_cmd(req, struct io_recvzc);
+	struct tcp_zerocopy_receive tzc = {};
+	unsigned int cflags = 0;
+	struct socket *sock;
+	int ret;
+
+	if (!(req->flags & REQ_F_POLLED) &&
+	    (zc->flags & IORING_RECVSEND_POLL_FIRST))
+		return -EAGAIN;
+
+	sock = sock_from_file(req->file);
+	if (unlikely(!sock))
+		return -ENOTSOCK;
+	if (!sk_is_tcp(sock->sk))
+		return -EOPNOTSUPP;
+
+	if (copy_from_user(&tzc, zc->uzc, zc->len))
+		return -EFAULT;
+
+	ret = tcp_zerocopy_receive_kern(sock->sk, &tzc);
+	if (!ret && !tzc.length && !tzc.copybuf_len && !tzc.inq &&
+	    (issue_flags & IO_URING_F_NONBLOCK))
+		return -EAGAIN;
+
+	if (!ret && copy_to_user(zc->uzc, &tzc, zc->len))
+		ret = -EFAULT;
+	if (ret < 0) {
+		req_set_fail(req);
+	} else {
+		ret = tzc.length + tzc.copybuf_len;
+		if (tzc.inq)
+			cflags |= IORING_CQE_F_SOCK_NONEMPTY;
+	}
+	io_req_set_res(req, ret, cflags);
+	return IOU_OK;
+#else
+	return -EOPNOTSUPP;
+#endif
+}
+
 void io_send_zc_cleanup(struct io_kiocb *req)
 {
 	struct io_sr_msg *zc = io_kiocb_to_cmd(req, struct io_sr_msg);
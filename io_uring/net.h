@@ -44,6 +44,9 @@ int io_recvmsg_prep(struct io_kiocb *req, const struct io_uring_sqe *sqe);
 int io_recvmsg(struct io_kiocb *req, unsigned int issue_flags);
 int io_recv(struct io_kiocb *req, unsigned int issue_flags);
 
+int io_recv_zc_prep(struct io_kiocb *req, const struct io_uring_sqe *sqe);
+int io_recv_zc(struct io_kiocb *req, unsigned int issue_flags);
+
 void io_sendrecv_fail(struct io_kiocb *req);
 
 int io_accept_prep(struct io_kiocb *req, const struct io_uring_sqe *sqe);
@@ -1202,14 +1202,115 @@ done:
 	return pages;
 }
 
+struct io_imu_folio_data {
+	/* head folio can be partially included in the buffer */
+	unsigned int	nr_pages_head;
+	/* for non-head/tail folios, must be fully included */
+	unsigned int	nr_pages_mid;
+	/* page index of the first buffer page within the head folio */
+	unsigned int	first_page_idx;
+	unsigned int	folio_shift;
+	unsigned int	nr_folios;
+};
+
+/*
+ * Check whether the pinned pages are made of equally sized folios that are
+ * fully covered by the buffer, except possibly the first and the last one,
+ * and that the pages inside every folio are contiguous. If so, the buffer
+ * can be described by one bvec per folio.
+ */
+static bool io_check_coalesce_buffer(struct page **page_array, int nr_pages,
+				     struct io_imu_folio_data *data)
+{
+	struct folio *folio = page_folio(page_array[0]);
+	unsigned int count = 1, nr_folios = 1;
+	int i;
+
+	data->nr_pages_mid = folio_nr_pages(folio);
+	if (data->nr_pages_mid == 1)
+		return false;
+	data->folio_shift = folio_shift(folio);
+	data->first_page_idx = folio_page_idx(folio, page_array[0]);
+
+	for (i = 1; i < nr_pages; i++) {
+		if (page_folio(page_array[i]) == folio &&
+		    page_array[i] == page_array[i - 1] + 1) {
+			count++;
+			continue;
+		}
+
+		if (nr_folios == 1) {
+			if (folio_page_idx(folio, page_array[i - 1]) !=
+			    data->nr_pages_mid - 1)
+				return false;
+			data->nr_pages_head = count;
+		} else if (count != data->nr_pages_mid) {
+			return false;
+		}
+
+		folio = page_folio(page_array[i]);
+		if (folio_size(folio) != (1UL << data->folio_shift) ||
+		    folio_page_idx(folio, page_array[i]) != 0)
+			return false;
+
+		count = 1;
+		nr_folios++;
+	}
+	if (nr_folios == 1)
+		data->nr_pages_head = count;
+
+	data->nr_folios = nr_folios;
+	return true;
+}
+
+/*
+ * Replace the page array with one holding a single page per folio. Only one
+ * pin is kept per folio, which is what io_buffer_unmap() drops for every bvec.
+ */
+static bool io_coalesce_buffer(struct page ***pages, int *nr_pages,
+			       struct io_imu_folio_data *data)
+{
+	struct page **page_array = *pages, **new_array;
+	int nr_pages_left = *nr_pages, i, j;
+
+	new_array = kvmalloc_array(data->nr_folios, sizeof(struct page *),
+				   GFP_KERNEL);
+	if (!new_array)
+		return false;
+
+	new_array[0] = compound_head(page_array[0]);
+	if (data->nr_pages_head > 1)
+		unpin_user_pages(&page_array[1], data->nr_pages_head - 1);
+
+	j = data->nr_pages_head;
+	nr_pages_left -= data->nr_pages_head;
+	for (i = 1; i < data->nr_folios; i++) {
+		unsigned int nr_unpin;
+
+		new_array[i] = page_array[j];
+		nr_unpin = min_t(unsigned int, nr_pages_left - 1,
+				 data->nr_pages_mid - 1);
+		if (nr_unpin)
+			unpin_user_pages(&page_array[j + 1], nr_unpin);
+		j += data->nr_pages_mid;
+		nr_pages_left -= data->nr_pages_mid;
+	}
+	kvfree(page_array);
+	*pages = new_array;
+	*nr_pages = data->nr_folios;
+	return true;
+}
+
 static int io_sqe_buffer_register(struct io_ring_ctx *ctx, struct iovec *iov,
 				  struct io_mapped_ubuf **pimu,
 				  struct page **last_hpage)
 {
 	struct io_mapped_ubuf *imu = NULL;
 	struct page **pages = NULL;
+	struct io_imu_folio_data data;
+	bool coalesced = false;
 	unsigned long off;
-	size_t size;
+	size_t size, seg_size;
 	int ret, nr_pages, i;
 
 	*pimu = ctx->dummy_ubuf;
@@ -1225,6 +1326,10 @@ static int io_sqe_buffer_register(struct io_ring_ctx *ctx, struct iovec *iov,
 		goto done;
 	}
 
+	/* if it's backed by huge pages, use a bvec per folio, not per page */
+	if (nr_pages > 1 && io_check_coalesce_buffer(pages, nr_pages, &data))
+		coalesced = io_coalesce_buffer(&pages, &nr_pages, &data);
+
 	imu = kvmalloc(struct_size(imu, bvec, nr_pages), GFP_KERNEL);
 	if (!imu)
 		goto done;
@@ -1235,12 +1340,18 @@ static int io_sqe_buffer_register(struct io_ring_ctx *ctx, struct iovec *iov,
 		goto done;
 	}
 
+	imu->folio_shift = PAGE_SHIFT;
 	off = (unsigned long) iov->iov_base & ~PAGE_MASK;
+	if (coalesced) {
+		imu->folio_shift = data.folio_shift;
+		off += (unsigned long) data.first_page_idx << PAGE_SHIFT;
+	}
+	seg_size = 1UL << imu->folio_shift;
 	size = iov->iov_len;
 	for (i = 0; i < nr_pages; i++) {
 		size_t vec_len;
 
-		vec_len = min_t(size_t, size, PAGE_SIZE - off);
+		vec_len = min_t(size_t, size, seg_size - off);
 		imu->bvec[i].bv_page = pages[i];
 		imu->bvec[i].bv_len = vec_len;
 		imu->bvec[i].bv_offset = off;
@@ -1355,14 +1466,14 @@ int io_import_fixed(int ddir, struct iov_iter *iter,
 		 * we know that:
 		 *
 		 * 1) it's a BVEC iter, we set it up
-		 * 2) all bvecs are PAGE_SIZE in size, except potentially the
-		 *    first and last bvec
+		 * 2) all bvecs are 1 << imu->folio_shift in size, except
+		 *    potentially the first and last bvec
 		 *
 		 * So just find our index, and adjust the iterator afterwards.
 		 * If the offset is within the first bvec (or the whole first
 		 * bvec, just use iov_iter_advance(). This makes it easier
 		 * since we can just skip the first segment, which may not
-		 * be PAGE_SIZE aligned.
+		 * be aligned to the segment size.
 		 */
 		const struct bio_vec *bvec = imu->bvec;
 
@@ -1373,14 +1484,69 @@ int io_import_fixed(int ddir, struct iov_iter *iter,
 
 			/* skip first vec */
 			offset -= bvec->bv_len;
-			seg_skip = 1 + (offset >> PAGE_SHIFT);
+			seg_skip = 1 + (offset >> imu->folio_shift);
 
 			iter->bvec = bvec + seg_skip;
 			iter->nr_segs -= seg_skip;
 			iter->count -= bvec->bv_len + offset;
-			iter->iov_offset = offset & ~PAGE_MASK;
+			iter->iov_offset = offset & ((1UL << imu->folio_shift) - 1);
 		}
 	}
 
 	return 0;
 }
+
+/* Index of the bvec holding byte @offset of @imu, and the offset within it. */
+static unsigned int io_imu_bvec_idx(struct io_mapped_ubuf *imu, size_t offset,
+				    size_t *seg_off)
+{
+	size_t first_len = imu->bvec[0].bv_len;
+
+	if (offset < first_len) {
+		*seg_off = offset;
+		return 0;
+	}
+	offset -= first_len;
+	*seg_off = offset & ((1UL << imu->folio_shift) - 1);
+	return 1 + (offset >> imu->folio_shift);
+}
+
+/*
+ * Copy the bvecs of @imu backing [@buf_addr, @buf_addr + @len) to @bvec,
+ * trimmed to the range, and return how many were used. If @bvec is NULL,
+ * only return how many would be needed.
+ */
+int io_fixed_to_bvec(struct io_mapped_ubuf *imu, u64 buf_addr, size_t len,
+		     struct bio_vec *bvec)
+{
+	unsigned int first, last, i;
+	size_t off, last_off;
+	u64 buf_end;
+
+	if (unlikely(check_add_overflow(buf_addr, (u64)len, &buf_end)))
+		return -EFAULT;
+	/* not inside the mapped region */
+	if (unlikely(buf_addr < imu->ubuf || buf_end > imu->ubuf_end))
+		return -EFAULT;
+	if (!len)
+		return 0;
+
+	first = io_imu_bvec_idx(imu, buf_addr - imu->ubuf, &off);
+	last = io_imu_bvec_idx(imu, buf_end - 1 - imu->ubuf, &last_off);
+	if (!bvec)
+		return last - first + 1;
+
+	for (i = first; i <= last; i++, bvec++) {
+		size_t start = 0;
+
+		*bvec = imu->bvec[i];
+		if (i == first) {
+			start = off;
+			bvec->bv_offset += off;
+			bvec->bv_len -= off;
+		}
+		if (i == last)
+			bvec->bv_len = last_off + 1 - start;
+	}
+	return last - first + 1;
+}
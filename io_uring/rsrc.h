@@ -49,6 +49,8 @@ struct io_mapped_ubuf {
 	u64		ubuf;
 	u64		ubuf_end;
 	unsigned int	nr_bvecs;
+	/* every bvec but the first and last spans 1 << folio_shift bytes */
+	unsigned int	folio_shift;
 	unsigned long	acct_pages;
 	struct bio_vec	bvec[];
 };
@@ -68,6 +70,8 @@ void io_rsrc_node_switch(struct io_ring_ctx *ctx,
 int io_import_fixed(int ddir, struct iov_iter *iter,
 			   struct io_mapped_ubuf *imu,
 			   u64 buf_addr, size_t len);
+int io_fixed_to_bvec(struct io_mapped_ubuf *imu, u64 buf_addr, size_t len,
+		     struct bio_vec *bvec);
 
 void __io_sqe_buffers_unregister(struct io_ring_ctx *ctx);
 int io_sqe_buffers_unregister(struct io_ring_ctx *ctx);
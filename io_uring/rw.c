@@ -122,6 +122,103 @@ int io_prep_rw(struct io_kiocb *req, const struct io_uring_sqe *sqe)
 	return 0;
 }
 
+/*
+ * Build the bvec for a vectored fixed buffer request from the registered
+ * buffers up front, so issue and any retry just reuse it and nothing is
+ * pinned per I/O. The request holds the rsrc node, which keeps the
+ * registered buffers alive until it completes.
+ */
+static int io_prep_rw_fixed_vec(struct io_kiocb *req, int ddir)
+{
+	struct io_rw *rw = io_kiocb_to_cmd(req, struct io_rw);
+	struct io_ring_ctx *ctx = req->ctx;
+	struct io_uring_fixed_vec *vecs;
+	struct bio_vec *bvec = NULL;
+	unsigned int nr_bvecs = 0, i;
+	struct io_async_rw *io;
+	size_t total = 0;
+	int ret;
+
+	if (!rw->len || rw->len > UIO_MAXIOV)
+		return -EINVAL;
+	vecs = memdup_user(u64_to_user_ptr(rw->addr),
+			   array_size(rw->len, sizeof(*vecs)));
+	if (IS_ERR(vecs))
+		return PTR_ERR(vecs);
+
+	for (i = 0; i < rw->len; i++) {
+		struct io_mapped_ubuf *imu;
+		u16 index;
+
+		ret = -EINVAL;
+		if (vecs[i].resv)
+			goto out;
+		total += vecs[i].len;
+		if (total > MAX_RW_COUNT)
+			goto out;
+		ret = -EFAULT;
+		if (unlikely(vecs[i].buf_index >= ctx->nr_user_bufs))
+			goto out;
+		index = array_index_nospec(vecs[i].buf_index, ctx->nr_user_bufs);
+		imu = ctx->user_bufs[index];
+		ret = io_fixed_to_bvec(imu, vecs[i].addr, vecs[i].len, NULL);
+		if (ret < 0)
+			goto out;
+		nr_bvecs += ret;
+	}
+
+	ret = -ENOMEM;
+	bvec = kvmalloc_array(nr_bvecs, sizeof(*bvec), GFP_KERNEL);
+	if (!bvec)
+		goto out;
+	nr_bvecs = 0;
+	for (i = 0; i < rw->len; i++) {
+		u16 index = array_index_nospec(vecs[i].buf_index,
+					       ctx->nr_user_bufs);
+
+		nr_bvecs += io_fixed_to_bvec(ctx->user_bufs[index],
+					     vecs[i].addr, vecs[i].len,
+					     bvec + nr_bvecs);
+	}
+
+	if (io_alloc_async_data(req))
+		goto out;
+	io = req->async_data;
+	io->free_iovec = NULL;
+	io->free_bvec = bvec;
+	io->bytes_done = 0;
+	iov_iter_bvec(&io->s.iter, ddir, bvec, nr_bvecs, total);
+	iov_iter_save_state(&io->s.iter, &io->s.iter_state);
+	req->flags |= REQ_F_NEED_CLEANUP;
+	io_req_set_rsrc_node(req, ctx, 0);
+	bvec = NULL;
+	ret = 0;
+out:
+	kvfree(bvec);
+	kfree(vecs);
+	return ret;
+}
+
+int io_prep_readv_fixed(struct io_kiocb *req, const struct io_uring_sqe *sqe)
+{
+	int ret;
+
+	ret = io_prep_rw(req, sqe);
+	if (unlikely(ret))
+		return ret;
+	return io_prep_rw_fixed_vec(req, ITER_DEST);
+}
+
+int io_prep_writev_fixed(struct io_kiocb *req, const struct io_uring_sqe *sqe)
+{
+	int ret;
+
+	ret = io_prep_rw(req, sqe);
+	if (unlikely(ret))
+		return ret;
+	return io_prep_rw_fixed_vec(req, ITER_SOURCE);
+}
+
 void io_readv_writev_cleanup(struct io_kiocb *req)
 {
 	struct io_async_rw *io = req->async_data;
@@ -129,6 +226,13 @@ void io_readv_writev_cleanup(struct io_kiocb *req)
 	kfree(io->free_iovec);
 }
 
+void io_rw_fixed_vec_cleanup(struct io_kiocb *req)
+{
+	struct io_async_rw *io = req->async_data;
+
+	kvfree(io->free_bvec);
+}
+
 static inline void io_rw_done(struct kiocb *kiocb, ssize_t ret)
 {
 	switch (ret) {
@@ -290,7 +394,7 @@ static void io_req_rw_complete(struct io_kiocb *req, bool *locked)
 	if (req->flags & (REQ_F_BUFFER_SELECTED|REQ_F_BUFFER_RING)) {
 		unsigned issue_flags = *locked ? 0 : IO_URING_F_UNLOCKED;
 
-		req->cqe.flags |= io_put_kbuf(req, issue_flags);
+		req->cqe.flags |= io_put_kbuf(req, req->cqe.res, issue_flags);
 	}
 	io_req_task_complete(req, locked);
 }
@@ -342,7 +446,7 @@ static int kiocb_done(struct io_kiocb *req, ssize_t ret,
 			 */
 			io_req_io_end(req);
 			io_req_set_res(req, final_ret,
-				       io_put_kbuf(req, issue_flags));
+				       io_put_kbuf(req, ret, issue_flags));
 			return IOU_OK;
 		}
 	} else {
@@ -430,6 +534,7 @@ static ssize_t loop_rw_iter(int ddir, struct io_rw *rw, struct iov_iter *iter)
 {
 	struct kiocb *kiocb = &rw->kiocb;
 	struct file *file = kiocb->ki_filp;
+	u8 opcode = cmd_to_io_kiocb(rw)->opcode;
 	ssize_t ret = 0;
 	loff_t *ppos;
 
@@ -443,6 +548,9 @@ static ssize_t loop_rw_iter(int ddir, struct io_rw *rw, struct iov_iter *iter)
 	if ((kiocb->ki_flags & IOCB_NOWAIT) &&
 	    !(kiocb->ki_filp->f_flags & O_NONBLOCK))
 		return -EAGAIN;
+	/* segments from several registered buffers have no single user range */
+	if (opcode == IORING_OP_READV_FIXED || opcode == IORING_OP_WRITEV_FIXED)
+		return -EOPNOTSUPP;
 
 	ppos = io_kiocb_ppos(kiocb);
 
@@ -847,6 +955,98 @@ done:
 	return kiocb_done(req, ret, issue_flags);
 }
 
+int io_read_mshot_prep(struct io_kiocb *req, const struct io_uring_sqe *sqe)
+{
+	int ret;
+
+	/* must be used with provided buffers */
+	if (!(req->flags & REQ_F_BUFFER_SELECT))
+		return -EINVAL;
+
+	ret = io_prep_rw(req, sqe);
+	if (unlikely(ret))
+		return ret;
+
+	req->flags |= REQ_F_APOLL_MULTISHOT;
+	return 0;
+}
+
+/*
+ * Multishot read: keep reading into provided buffers and posting a CQE with
+ * IORING_CQE_F_MORE per read for as long as data is available, then arm poll
+ * and continue once the file is readable again.  Only for pollable files,
+ * e.g. pipes and sockets, which all support nonblocking reads.
+ */
+int io_read_mshot(struct io_kiocb *req, unsigned int issue_flags)
+{
+	struct io_rw *rw = io_kiocb_to_cmd(req, struct io_rw);
+	struct io_rw_state __s, *s = &__s;
+	struct kiocb *kiocb = &rw->kiocb;
+	unsigned int cflags = 0;
+	struct iovec *iovec;
+	loff_t *ppos;
+	ssize_t ret;
+
+	/* multishot must be used on a pollable file */
+	if (!file_can_poll(req->file))
+		return -EBADFD;
+
+	/*
+	 * With DEFER_TASKRUN, extra CQEs may only be posted from the original
+	 * task context, see io_check_multishot().
+	 */
+	if ((issue_flags & IO_URING_F_IOWQ) &&
+	    (issue_flags & IO_URING_F_MULTISHOT) && req->ctx->task_complete)
+		return -EAGAIN;
+
+	ret = io_rw_init_file(req, FMODE_READ);
+	if (unlikely(ret))
+		return ret;
+	kiocb->ki_flags |= IOCB_NOWAIT;
+
+retry_multishot:
+	ret = io_import_iovec(ITER_DEST, req, &iovec, s, issue_flags);
+	if (unlikely(ret < 0))
+		goto done;
+
+	ppos = io_kiocb_update_pos(req);
+	ret = rw_verify_area(READ, req->file, ppos, iov_iter_count(&s->iter));
+	if (likely(!ret))
+		ret = io_iter_do_read(rw, &s->iter);
+
+	if (ret == -EAGAIN) {
+		io_kbuf_recycle(req, issue_flags);
+		/* get the length from the next provided buffer */
+		rw->len = 0;
+		if (issue_flags & IO_URING_F_MULTISHOT)
+			return IOU_ISSUE_SKIP_COMPLETE;
+		return -EAGAIN;
+	}
+
+	if (req->flags & REQ_F_CUR_POS)
+		req->file->f_pos = kiocb->ki_pos;
+
+	if (ret > 0) {
+		cflags = io_put_kbuf(req, ret, issue_flags);
+		rw->len = 0;
+		if (io_aux_cqe(req->ctx, issue_flags & IO_URING_F_COMPLETE_DEFER,
+			       req->cqe.user_data, ret,
+			       cflags | IORING_CQE_F_MORE, true))
+			goto retry_multishot;
+		/* Otherwise stop multishot but use the current result. */
+	} else {
+		/* EOF or error, terminate with the final result */
+		io_kbuf_recycle(req, issue_flags);
+	}
+done:
+	if (ret < 0)
+		req_set_fail(req);
+	io_req_set_res(req, ret, cflags);
+	if (issue_flags & IO_URING_F_MULTISHOT)
+		return IOU_STOP_MULTISHOT;
+	return IOU_OK;
+}
+
 int io_write(struct io_kiocb *req, unsigned int issue_flags)
 {
 	struct io_rw *rw = io_kiocb_to_cmd(req, struct io_rw);
@@ -1061,7 +1261,7 @@ int io_do_iopoll(struct io_ring_ctx *ctx, bool force_nonspin)
 		if (unlikely(req->flags & REQ_F_CQE_SKIP))
 			continue;
 
-		req->cqe.flags = io_put_kbuf(req, 0);
+		req->cqe.flags = io_put_kbuf(req, req->cqe.res, 0);
 		if (unlikely(!__io_fill_cqe_req(ctx, req))) {
 			spin_lock(&ctx->completion_lock);
 			io_req_cqe_overflow(req);
@@ -11,14 +11,21 @@ struct io_rw_state {
 struct io_async_rw {
 	struct io_rw_state		s;
 	const struct iovec		*free_iovec;
+	/* only for IORING_OP_READV_FIXED/WRITEV_FIXED */
+	struct bio_vec			*free_bvec;
 	size_t				bytes_done;
 	struct wait_page_queue		wpq;
 };
 
 int io_prep_rw(struct io_kiocb *req, const struct io_uring_sqe *sqe);
+int io_prep_readv_fixed(struct io_kiocb *req, const struct io_uring_sqe *sqe);
+int io_prep_writev_fixed(struct io_kiocb *req, const struct io_uring_sqe *sqe);
 int io_read(struct io_kiocb *req, unsigned int issue_flags);
+int io_read_mshot_prep(struct io_kiocb *req, const struct io_uring_sqe *sqe);
+int io_read_mshot(struct io_kiocb *req, unsigned int issue_flags);
 int io_readv_prep_async(struct io_kiocb *req);
 int io_write(struct io_kiocb *req, unsigned int issue_flags);
 int io_writev_prep_async(struct io_kiocb *req);
 void io_readv_writev_cleanup(struct io_kiocb *req);
+void io_rw_fixed_vec_cleanup(struct io_kiocb *req);
 void io_rw_fail(struct io_kiocb *req);
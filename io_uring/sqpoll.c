@@ -18,6 +18,16 @@
 #include "sqpoll.h"
 
 #define IORING_SQPOLL_CAP_ENTRIES_VALUE 8
+#define IORING_SQPOLL_MAX_WEIGHT	64
+
+/*
+ * A ring that found nothing to do for IORING_SQPOLL_IDLE_PASSES passes in a
+ * row is only looked at every 2^n passes of a shared SQPOLL thread, with n
+ * growing by one for every further IORING_SQPOLL_IDLE_PASSES idle passes, up
+ * to IORING_SQPOLL_IDLE_SHIFT_MAX.
+ */
+#define IORING_SQPOLL_IDLE_PASSES	8
+#define IORING_SQPOLL_IDLE_SHIFT_MAX	6
 
 enum {
 	IO_SQ_THREAD_SHOULD_STOP = 0,
@@ -170,9 +180,17 @@ static int __io_sq_thread(struct io_ring_ctx *ctx, bool cap_entries)
 	int ret = 0;
 
 	to_submit = io_sqring_entries(ctx);
-	/* if we're handling multiple rings, cap submit size for fairness */
-	if (cap_entries && to_submit > IORING_SQPOLL_CAP_ENTRIES_VALUE)
-		to_submit = IORING_SQPOLL_CAP_ENTRIES_VALUE;
+	/*
+	 * If we're handling multiple rings, cap submit size for fairness. The
+	 * cap scales with the ring's weight, see IORING_REGISTER_SQ_WEIGHT.
+	 */
+	if (cap_entries) {
+		unsigned int cap = IORING_SQPOLL_CAP_ENTRIES_VALUE *
+				   READ_ONCE(ctx->sq_weight);
+
+		if (to_submit > cap)
+			to_submit = cap;
+	}
 
 	if (!wq_list_empty(&ctx->iopoll_list) || to_submit) {
 		const struct cred *creds = NULL;
@@ -202,6 +220,40 @@ static int __io_sq_thread(struct io_ring_ctx *ctx, bool cap_entries)
 	return ret;
 }
 
+/* Returns true if @ctx is backed off and should be skipped this pass. */
+static bool io_sq_ctx_backoff(struct io_ring_ctx *ctx)
+{
+	if (!ctx->sq_skip)
+		return false;
+	ctx->sq_skip--;
+	ctx->sq_idle_skipped++;
+	return true;
+}
+
+static void io_sq_ctx_update(struct io_ring_ctx *ctx, int ret)
+{
+	unsigned int shift;
+
+	if (ret > 0 || !wq_list_empty(&ctx->iopoll_list)) {
+		ctx->sq_idle_passes = 0;
+		ctx->sq_busy_passes++;
+		if (ret > 0)
+			ctx->sq_submitted += ret;
+		return;
+	}
+
+	shift = ++ctx->sq_idle_passes / IORING_SQPOLL_IDLE_PASSES;
+	if (shift)
+		ctx->sq_skip = (1U << min_t(unsigned int, shift,
+					    IORING_SQPOLL_IDLE_SHIFT_MAX)) - 1;
+}
+
+static void io_sq_ctx_reset_backoff(struct io_ring_ctx *ctx)
+{
+	ctx->sq_idle_passes = 0;
+	ctx->sq_skip = 0;
+}
+
 static bool io_sqd_handle_event(struct io_sq_data *sqd)
 {
 	bool did_sig = false;
@@ -247,8 +299,14 @@ static int io_sq_thread(void *data)
 
 		cap_entries = !list_is_singular(&sqd->ctx_list);
 		list_for_each_entry(ctx, &sqd->ctx_list, sqd_list) {
-			int ret = __io_sq_thread(ctx, cap_entries);
+			int ret;
+
+			/* back off idle rings only when sharing the thread */
+			if (cap_entries && io_sq_ctx_backoff(ctx))
+				continue;
 
+			ret = __io_sq_thread(ctx, cap_entries);
+			io_sq_ctx_update(ctx, ret);
 			if (!sqt_spin && (ret > 0 || !wq_list_empty(&ctx->iopoll_list)))
 				sqt_spin = true;
 		}
@@ -292,9 +350,15 @@ static int io_sq_thread(void *data)
 				schedule();
 				mutex_lock(&sqd->lock);
 			}
-			list_for_each_entry(ctx, &sqd->ctx_list, sqd_list)
+			/*
+			 * Whichever ring woke us up must be looked at right
+			 * away, drop any backoff.
+			 */
+			list_for_each_entry(ctx, &sqd->ctx_list, sqd_list) {
 				atomic_andnot(IORING_SQ_NEED_WAKEUP,
 						&ctx->rings->sq_flags);
+				io_sq_ctx_reset_backoff(ctx);
+			}
 		}
 
 		finish_wait(&sqd->wait, &wait);
@@ -366,6 +430,7 @@ __cold int io_sq_offload_create(struct io_ring_ctx *ctx,
 
 		ctx->sq_creds = get_current_cred();
 		ctx->sq_data = sqd;
+		ctx->sq_weight = 1;
 		ctx->sq_thread_idle = msecs_to_jiffies(p->sq_thread_idle);
 		if (!ctx->sq_thread_idle)
 			ctx->sq_thread_idle = HZ;
@@ -419,3 +484,21 @@ err:
 	io_sq_thread_finish(ctx);
 	return ret;
 }
+
+int io_register_sq_weight(struct io_ring_ctx *ctx, void __user *arg)
+{
+	u32 weight;
+
+	if (!(ctx->flags & IORING_SETUP_SQPOLL) || !ctx->sq_data)
+		return -EINVAL;
+	if (copy_from_user(&weight, arg, sizeof(weight)))
+		return -EFAULT;
+	if (!weight)
+		weight = 1;
+	if (weight > IORING_SQPOLL_MAX_WEIGHT)
+		return -EINVAL;
+
+	/* read locklessly by the SQPOLL thread, no need to park it */
+	WRITE_ONCE(ctx->sq_weight, weight);
+	return 0;
+}
@@ -845,28 +845,46 @@ static inline int pipelined_send(struct msg_queue *msq, struct msg_msg *msg,
 	return 0;
 }
 
-static long do_msgsnd(int msqid, long mtype, void __user *mtext,
-		size_t msgsz, int msgflg)
+static struct msg_msg *prepare_msg(struct ipc_namespace *ns, long mtype,
+				   void __user *mtext, size_t msgsz)
 {
-	struct msg_queue *msq;
 	struct msg_msg *msg;
-	int err;
-	struct ipc_namespace *ns;
-	DEFINE_WAKE_Q(wake_q);
 
-	ns = current->nsproxy->ipc_ns;
-
-	if (msgsz > ns->msg_ctlmax || (long) msgsz < 0 || msqid < 0)
-		return -EINVAL;
+	if (msgsz > ns->msg_ctlmax || (long) msgsz < 0)
+		return ERR_PTR(-EINVAL);
 	if (mtype < 1)
-		return -EINVAL;
+		return ERR_PTR(-EINVAL);
 
 	msg = load_msg(mtext, msgsz);
 	if (IS_ERR(msg))
-		return PTR_ERR(msg);
+		return msg;
 
 	msg->m_type = mtype;
 	msg->m_ts = msgsz;
+	return msg;
+}
+
+static inline void msg_enqueue(struct ipc_namespace *ns, struct msg_queue *msq,
+			       struct msg_msg *msg, struct wake_q_head *wake_q)
+{
+	if (!pipelined_send(msq, msg, wake_q)) {
+		/* no one is waiting for this message, enqueue it */
+		list_add_tail(&msg->m_list, &msq->q_messages);
+		msq->q_cbytes += msg->m_ts;
+		msq->q_qnum++;
+		percpu_counter_add_local(&ns->percpu_msg_bytes, msg->m_ts);
+		percpu_counter_add_local(&ns->percpu_msg_hdrs, 1);
+	}
+}
+
+/* Send the prepared @msg, waiting for room if needed; consumes @msg. */
+static long msgsnd_prepared(struct ipc_namespace *ns, int msqid,
+			    struct msg_msg *msg, int msgflg)
+{
+	struct msg_queue *msq;
+	size_t msgsz = msg->m_ts;
+	int err;
+	DEFINE_WAKE_Q(wake_q);
 
 	rcu_read_lock();
 	msq = msq_obtain_object_check(ns, msqid);
@@ -936,14 +954,7 @@ static long do_msgsnd(int msqid, long mtype, void __user *mtext,
 	ipc_update_pid(&msq->q_lspid, task_tgid(current));
 	msq->q_stime = ktime_get_real_seconds();
 
-	if (!pipelined_send(msq, msg, &wake_q)) {
-		/* no one is waiting for this message, enqueue it */
-		list_add_tail(&msg->m_list, &msq->q_messages);
-		msq->q_cbytes += msgsz;
-		msq->q_qnum++;
-		percpu_counter_add_local(&ns->percpu_msg_bytes, msgsz);
-		percpu_counter_add_local(&ns->percpu_msg_hdrs, 1);
-	}
+	msg_enqueue(ns, msq, msg, &wake_q);
 
 	err = 0;
 	msg = NULL;
@@ -958,6 +969,22 @@ out_unlock1:
 	return err;
 }
 
+static long do_msgsnd(int msqid, long mtype, void __user *mtext,
+		size_t msgsz, int msgflg)
+{
+	struct ipc_namespace *ns = current->nsproxy->ipc_ns;
+	struct msg_msg *msg;
+
+	if (msqid < 0)
+		return -EINVAL;
+
+	msg = prepare_msg(ns, mtype, mtext, msgsz);
+	if (IS_ERR(msg))
+		return PTR_ERR(msg);
+
+	return msgsnd_prepared(ns, msqid, msg, msgflg);
+}
+
 long ksys_msgsnd(int msqid, struct msgbuf __user *msgp, size_t msgsz,
 		 int msgflg)
 {
@@ -1303,6 +1330,315 @@ COMPAT_SYSCALL_DEFINE5(msgrcv, int, msqid, compat_uptr_t, msgp,
 }
 #endif
 
+/*
+ * Batched msgsnd()/msgrcv(): move up to MSG_BATCH_MAX messages with one
+ * queue lookup and one acquisition of the queue lock.  The message bodies
+ * are copied from and to user space without the lock held, as with the
+ * single message calls.  Like sendmmsg(), a batch call only sleeps while
+ * nothing was transferred yet, and returns the number of messages moved
+ * once that is non-zero; the status of each message is in its result field.
+ */
+static int msgbuf_get_head(void __user *msgp, long *mtype, void __user **mtext)
+{
+	struct msgbuf __user *up = msgp;
+
+	*mtext = up->mtext;
+	return get_user(*mtype, &up->mtype);
+}
+
+static long do_msgsnd_batch(int msqid, struct msg_batch __user *uvec,
+			    unsigned int vlen, int msgflg,
+			    int (*get_head)(void __user *, long *, void __user **))
+{
+	struct ipc_namespace *ns = current->nsproxy->ipc_ns;
+	unsigned int i, nr, first, sent = 0;
+	struct msg_queue *msq;
+	struct msg_batch *vec;
+	struct msg_msg **msgs;
+	long err, load_err = 0;
+	DEFINE_WAKE_Q(wake_q);
+
+	if (msqid < 0)
+		return -EINVAL;
+	if (!vlen)
+		return 0;
+	vlen = min_t(unsigned int, vlen, MSG_BATCH_MAX);
+
+	vec = kmalloc_array(vlen, sizeof(*vec) + sizeof(*msgs), GFP_KERNEL);
+	if (!vec)
+		return -ENOMEM;
+	msgs = (struct msg_msg **)(vec + vlen);
+
+	if (copy_from_user(vec, uvec, vlen * sizeof(*vec))) {
+		kfree(vec);
+		return -EFAULT;
+	}
+
+	for (nr = 0; nr < vlen; nr++) {
+		void __user *mtext;
+		long mtype;
+
+		if (vec[nr].msgsz > ns->msg_ctlmax) {
+			load_err = -EINVAL;
+			break;
+		}
+		if (get_head(u64_to_user_ptr(vec[nr].msgp), &mtype, &mtext)) {
+			load_err = -EFAULT;
+			break;
+		}
+		msgs[nr] = prepare_msg(ns, mtype, mtext, vec[nr].msgsz);
+		if (IS_ERR(msgs[nr])) {
+			load_err = PTR_ERR(msgs[nr]);
+			break;
+		}
+	}
+	err = load_err;
+	if (!nr)
+		goto out_free;
+
+again:
+	first = sent;
+	wake_q_init(&wake_q);
+	rcu_read_lock();
+	msq = msq_obtain_object_check(ns, msqid);
+	if (IS_ERR(msq)) {
+		err = PTR_ERR(msq);
+		goto out_unlock1;
+	}
+
+	ipc_lock_object(&msq->q_perm);
+
+	err = -EACCES;
+	if (ipcperms(ns, &msq->q_perm, S_IWUGO))
+		goto out_unlock0;
+
+	/* raced with RMID? */
+	err = -EIDRM;
+	if (!ipc_valid_object(&msq->q_perm))
+		goto out_unlock0;
+
+	for (err = 0; sent < nr; sent++) {
+		struct msg_msg *msg = msgs[sent];
+
+		err = security_msg_queue_msgsnd(&msq->q_perm, msg, msgflg);
+		if (err)
+			break;
+
+		if (!msg_fits_inqueue(msq, msg->m_ts)) {
+			err = -EAGAIN;
+			break;
+		}
+
+		msg_enqueue(ns, msq, msg, &wake_q);
+		msgs[sent] = NULL;
+	}
+
+	if (sent > first) {
+		ipc_update_pid(&msq->q_lspid, task_tgid(current));
+		msq->q_stime = ktime_get_real_seconds();
+	}
+
+out_unlock0:
+	ipc_unlock_object(&msq->q_perm);
+	wake_up_q(&wake_q);
+out_unlock1:
+	rcu_read_unlock();
+
+	if (!sent && err == -EAGAIN && !(msgflg & IPC_NOWAIT)) {
+		/* The queue is full: wait for room for the first message */
+		err = msgsnd_prepared(ns, msqid, msgs[0], msgflg);
+		msgs[0] = NULL;
+		if (!err && ++sent < nr)
+			goto again;
+	}
+
+	if (sent == nr)
+		err = load_err;
+	for (i = 0; i < sent; i++)
+		vec[i].result = 0;
+	if (sent < vlen)
+		vec[sent].result = err;
+	if (copy_to_user(uvec, vec, min(sent + 1, vlen) * sizeof(*vec)) &&
+	    !sent)
+		err = -EFAULT;
+
+	for (i = sent; i < nr; i++) {
+		if (msgs[i])
+			free_msg(msgs[i]);
+	}
+out_free:
+	kfree(vec);
+	return sent ? sent : err;
+}
+
+static long do_msgrcv_batch(int msqid, struct msg_batch __user *uvec,
+			    unsigned int vlen, long msgtyp, int msgflg,
+			    long (*msg_handler)(void __user *, struct msg_msg *, size_t))
+{
+	struct ipc_namespace *ns = current->nsproxy->ipc_ns;
+	long type, err = 0, orig_msgtyp = msgtyp;
+	unsigned int i, nr = 0;
+	struct msg_queue *msq;
+	struct msg_batch *vec;
+	struct msg_msg **msgs;
+	int mode;
+	DEFINE_WAKE_Q(wake_q);
+
+	if (msqid < 0 || (msgflg & MSG_COPY))
+		return -EINVAL;
+	if (!vlen)
+		return 0;
+	vlen = min_t(unsigned int, vlen, MSG_BATCH_MAX);
+
+	vec = kmalloc_array(vlen, sizeof(*vec) + sizeof(*msgs), GFP_KERNEL);
+	if (!vec)
+		return -ENOMEM;
+	msgs = (struct msg_msg **)(vec + vlen);
+
+	if (copy_from_user(vec, uvec, vlen * sizeof(*vec))) {
+		err = -EFAULT;
+		goto out_free;
+	}
+	for (i = 0; i < vlen; i++) {
+		if (vec[i].msgsz > LONG_MAX) {
+			err = -EINVAL;
+			goto out_free;
+		}
+	}
+
+	mode = convert_mode(&msgtyp, msgflg);
+
+	rcu_read_lock();
+	msq = msq_obtain_object_check(ns, msqid);
+	if (IS_ERR(msq)) {
+		err = PTR_ERR(msq);
+		goto out_unlock1;
+	}
+
+	err = -EACCES;
+	if (ipcperms(ns, &msq->q_perm, S_IRUGO))
+		goto out_unlock1;
+
+	ipc_lock_object(&msq->q_perm);
+
+	/* raced with RMID? */
+	err = -EIDRM;
+	if (!ipc_valid_object(&msq->q_perm))
+		goto out_unlock0;
+
+	for (err = 0; nr < vlen; nr++) {
+		struct msg_msg *msg;
+
+		/* find_msg() updates the type for SEARCH_LESSEQUAL */
+		type = msgtyp;
+		msg = find_msg(msq, &type, mode);
+		if (IS_ERR(msg)) {
+			err = PTR_ERR(msg);
+			break;
+		}
+		if ((vec[nr].msgsz < msg->m_ts) && !(msgflg & MSG_NOERROR)) {
+			err = -E2BIG;
+			break;
+		}
+
+		list_del(&msg->m_list);
+		msq->q_qnum--;
+		msq->q_cbytes -= msg->m_ts;
+		percpu_counter_sub_local(&ns->percpu_msg_bytes, msg->m_ts);
+		percpu_counter_sub_local(&ns->percpu_msg_hdrs, 1);
+		msgs[nr] = msg;
+	}
+
+	if (nr) {
+		msq->q_rtime = ktime_get_real_seconds();
+		ipc_update_pid(&msq->q_lrpid, task_tgid(current));
+		ss_wakeup(msq, &wake_q, false);
+	}
+
+out_unlock0:
+	ipc_unlock_object(&msq->q_perm);
+	wake_up_q(&wake_q);
+out_unlock1:
+	rcu_read_unlock();
+
+	if (err == -EAGAIN)
+		err = -ENOMSG;
+
+	if (!nr) {
+		if (err != -ENOMSG || (msgflg & IPC_NOWAIT))
+			goto out_free;
+
+		/* The queue is empty: wait for the first message */
+		err = do_msgrcv(msqid, u64_to_user_ptr(vec[0].msgp),
+				vec[0].msgsz, orig_msgtyp, msgflg, msg_handler);
+		if (err < 0)
+			goto out_free;
+		vec[0].result = err;
+		nr = 1;
+		err = -ENOMSG;
+	} else {
+		for (i = 0; i < nr; i++) {
+			vec[i].result = msg_handler(u64_to_user_ptr(vec[i].msgp),
+						    msgs[i], vec[i].msgsz);
+			free_msg(msgs[i]);
+		}
+	}
+
+	if (nr < vlen)
+		vec[nr].result = err;
+	/* As with msgrcv(), the messages are lost on a fault */
+	if (copy_to_user(uvec, vec, min(nr + 1, vlen) * sizeof(*vec))) {
+		nr = 0;
+		err = -EFAULT;
+	}
+out_free:
+	kfree(vec);
+	return nr ? nr : err;
+}
+
+SYSCALL_DEFINE4(msgsnd_batch, int, msqid, struct msg_batch __user *, vec,
+		unsigned int, vlen, int, msgflg)
+{
+	return do_msgsnd_batch(msqid, vec, vlen, msgflg, msgbuf_get_head);
+}
+
+SYSCALL_DEFINE5(msgrcv_batch, int, msqid, struct msg_batch __user *, vec,
+		unsigned int, vlen, long, msgtyp, int, msgflg)
+{
+	return do_msgrcv_batch(msqid, vec, vlen, msgtyp, msgflg, do_msg_fill);
+}
+
+#ifdef CONFIG_COMPAT
+static int compat_msgbuf_get_head(void __user *msgp, long *mtype,
+				  void __user **mtext)
+{
+	struct compat_msgbuf __user *up = msgp;
+	compat_long_t ctype;
+
+	*mtext = up->mtext;
+	if (get_user(ctype, &up->mtype))
+		return -EFAULT;
+	*mtype = ctype;
+	return 0;
+}
+
+COMPAT_SYSCALL_DEFINE4(msgsnd_batch, int, msqid,
+		       struct msg_batch __user *, vec, unsigned int, vlen,
+		       int, msgflg)
+{
+	return do_msgsnd_batch(msqid, vec, vlen, msgflg,
+			       compat_msgbuf_get_head);
+}
+
+COMPAT_SYSCALL_DEFINE5(msgrcv_batch, int, msqid,
+		       struct msg_batch __user *, vec, unsigned int, vlen,
+		       compat_long_t, msgtyp, int, msgflg)
+{
+	return do_msgrcv_batch(msqid, vec, vlen, msgtyp, msgflg,
+			       compat_do_msg_fill);
+}
+#endif
+
 int msg_init_ns(struct ipc_namespace *ns)
 {
 	int ret;
@@ -9,4 +9,8 @@ BPF_STRUCT_OPS_TYPE(bpf_dummy_ops)
 #include <net/tcp.h>
 BPF_STRUCT_OPS_TYPE(tcp_congestion_ops)
 #endif
+#ifdef CONFIG_SCHED_FAIR_OPS
+#include <linux/sched/fair_ops.h>
+BPF_STRUCT_OPS_TYPE(sched_fair_ops)
+#endif
 #endif
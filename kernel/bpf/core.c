@@ -1732,7 +1732,14 @@ select_insn:
 		DST = (u32) IMM;
 		CONT;
 	ALU64_MOV_X:
-		DST = SRC;
+		/* Only reachable if the JIT failed after the verifier
+		 * inlined a per-CPU access.
+		 */
+		if (unlikely(insn->off == BPF_ADDR_PERCPU))
+			DST = (unsigned long)this_cpu_ptr((const void __percpu *)
+							  (unsigned long)SRC);
+		else
+			DST = SRC;
 		CONT;
 	ALU64_MOV_K:
 		DST = IMM;
@@ -2723,6 +2730,12 @@ bool __weak bpf_jit_supports_kfunc_call(void)
 	return false;
 }
 
+/* Return TRUE if the JIT backend handles BPF_MOV64_PERCPU_REG. */
+bool __weak bpf_jit_supports_percpu_insn(void)
+{
+	return false;
+}
+
 /* To execute LD_ABS/LD_IND instructions __bpf_prog_run() may call
  * skb_copy_bits(), so provide a weak definition of it for NET-less config.
  */
@@ -35,6 +35,11 @@
  */
 #define LLIST_NODE_SZ sizeof(struct llist_node)
 
+/* Largest unit of the variable size caches. Units above PAGE_SIZE are
+ * backed by the page allocator, so keep this to a few pages.
+ */
+#define BPF_MEM_ALLOC_MAX_SIZE	16384
+
 /* similar to kmalloc, but sizeof == 8 bucket is gone */
 static u8 size_index[24] __ro_after_init = {
 	3,	/* 8 */
@@ -65,7 +70,7 @@ static u8 size_index[24] __ro_after_init = {
 
 static int bpf_mem_cache_idx(size_t size)
 {
-	if (!size || size > 4096)
+	if (!size || size > BPF_MEM_ALLOC_MAX_SIZE)
 		return -1;
 
 	if (size <= 192)
@@ -74,7 +79,7 @@ static int bpf_mem_cache_idx(size_t size)
 	return fls(size - 1) - 2;
 }
 
-#define NUM_CACHES 11
+#define NUM_CACHES 13
 
 struct bpf_mem_cache {
 	/* per-cpu list of free objects of size 'unit_size'.
@@ -336,14 +341,16 @@ static void notrace irq_work_raise(struct bpf_mem_cache *c)
  * bucket and all buckets are used the total amount of memory in freelists
  * on each cpu will be:
  * 64*16 + 64*32 + 64*64 + 64*96 + 64*128 + 64*196 + 64*256 + 32*512 + 16*1024 + 8*2048 + 4*4096
- * == ~ 116 Kbyte using below heuristic.
+ * + 2*8192 + 2*16384
+ * == ~ 164 Kbyte using below heuristic.
  * Initialized, but unused bpf allocator (not bpf map specific one) will
- * consume ~ 11 Kbyte per cpu.
- * Typical case will be between 11K and 116K closer to 11K.
+ * consume ~ 11 Kbyte per cpu, since the caches above PAGE_SIZE are not
+ * prefilled.
+ * Typical case will be between 11K and 164K closer to 11K.
  * bpf progs can and should share bpf_mem_cache when possible.
  */
 
-static void prefill_mem_cache(struct bpf_mem_cache *c, int cpu)
+static void init_refill_work(struct bpf_mem_cache *c)
 {
 	init_irq_work(&c->refill_work, bpf_mem_refill);
 	if (c->unit_size <= 256) {
@@ -359,6 +366,11 @@ static void prefill_mem_cache(struct bpf_mem_cache *c, int cpu)
 		c->high_watermark = max(96 * 256 / c->unit_size, 3);
 	}
 	c->batch = max((c->high_watermark - c->low_watermark) / 4 * 3, 1);
+}
+
+static void prefill_mem_cache(struct bpf_mem_cache *c, int cpu)
+{
+	init_refill_work(c);
 
 	/* To avoid consuming memory assume that 1st run of bpf
 	 * prog won't be doing more than 4 map_update_elem from
@@ -370,13 +382,14 @@ static void prefill_mem_cache(struct bpf_mem_cache *c, int cpu)
 /* When size != 0 bpf_mem_cache for each cpu.
  * This is typical bpf hash map use case when all elements have equal size.
  *
- * When size == 0 allocate 11 bpf_mem_cache-s for each cpu, then rely on
- * kmalloc/kfree. Max allocation size is 4096 in this case.
+ * When size == 0 allocate 13 bpf_mem_cache-s for each cpu, then rely on
+ * kmalloc/kfree. Max allocation size is 16384 in this case.
  * This is bpf_dynptr and bpf_kptr use case.
  */
 int bpf_mem_alloc_init(struct bpf_mem_alloc *ma, int size, bool percpu)
 {
-	static u16 sizes[NUM_CACHES] = {96, 192, 16, 32, 64, 128, 256, 512, 1024, 2048, 4096};
+	static u16 sizes[NUM_CACHES] = {96, 192, 16, 32, 64, 128, 256, 512, 1024, 2048, 4096,
+					8192, 16384};
 	struct bpf_mem_caches *cc, __percpu *pcc;
 	struct bpf_mem_cache *c, __percpu *pc;
 	struct obj_cgroup *objcg = NULL;
@@ -424,7 +437,15 @@ int bpf_mem_alloc_init(struct bpf_mem_alloc *ma, int size, bool percpu)
 			c = &cc->cache[i];
 			c->unit_size = sizes[i];
 			c->objcg = objcg;
-			prefill_mem_cache(c, cpu);
+			/* Multi-page caches are only filled once an allocation
+			 * from them was attempted, so that unused ones don't
+			 * pin memory on every cpu. The first allocation of such
+			 * a size may fail.
+			 */
+			if (c->unit_size > PAGE_SIZE)
+				init_refill_work(c);
+			else
+				prefill_mem_cache(c, cpu);
 		}
 	}
 	ma->caches = pcc;
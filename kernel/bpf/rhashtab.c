@@ -0,0 +1,390 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+ * Resizable hash map backed by rhashtable.
+ *
+ * Unlike BPF_MAP_TYPE_HASH, the bucket array is not sized for max_entries
+ * up front: it starts small and is grown (and shrunk) by the rhashtable
+ * worker as elements come and go, so max_entries is only an upper bound.
+ * Lookups are lockless under RCU.
+ *
+ * Inserting and removing elements may kick the rhashtable worker with
+ * schedule_work(), which isn't safe with the scheduler locks held, so
+ * tracing programs can't use this map, see check_map_prog_compatibility().
+ */
+#include <linux/bpf.h>
+#include <linux/btf.h>
+#include <linux/btf_ids.h>
+#include <linux/err.h>
+#include <linux/memcontrol.h>
+#include <linux/rhashtable.h>
+#include <linux/slab.h>
+
+/* Elements are always allocated on update, BPF_F_NO_PREALLOC is implied */
+#define RHTAB_CREATE_FLAG_MASK \
+	(BPF_F_NO_PREALLOC | BPF_F_NUMA_NODE | BPF_F_ACCESS_MASK)
+
+struct bpf_rhtab {
+	struct bpf_map map;
+	struct rhashtable ht;
+	struct rhashtable_params params;
+	atomic_t count;
+	u32 elem_size;
+	/* Per CPU nesting count of updaters, see rhtab_lock() */
+	int __percpu *map_locked;
+};
+
+struct rhtab_elem {
+	struct rhash_head node;
+	struct rcu_head rcu;
+	char key[] __aligned(8);
+};
+
+static struct bpf_rhtab *to_rhtab(struct bpf_map *map)
+{
+	return container_of(map, struct bpf_rhtab, map);
+}
+
+static void *rhtab_elem_value(const struct bpf_rhtab *rhtab,
+			      struct rhtab_elem *elem)
+{
+	return elem->key + round_up(rhtab->map.key_size, 8);
+}
+
+/*
+ * The bucket locks of the rhashtable are taken with interrupts disabled, so
+ * only NMI or a program traced from within the rhashtable code can nest in
+ * them. Refuse a nested update on this CPU instead of deadlocking on the
+ * bucket lock, the same way htab_lock_bucket() does.
+ */
+static int rhtab_lock(struct bpf_rhtab *rhtab)
+{
+	if (in_nmi())
+		return -EBUSY;
+
+	preempt_disable();
+	if (unlikely(__this_cpu_inc_return(*rhtab->map_locked) != 1)) {
+		__this_cpu_dec(*rhtab->map_locked);
+		preempt_enable();
+		return -EBUSY;
+	}
+	return 0;
+}
+
+static void rhtab_unlock(struct bpf_rhtab *rhtab)
+{
+	__this_cpu_dec(*rhtab->map_locked);
+	preempt_enable();
+}
+
+static int rhtab_map_alloc_check(union bpf_attr *attr)
+{
+	if (!bpf_capable())
+		return -EPERM;
+
+	if (attr->map_flags & ~RHTAB_CREATE_FLAG_MASK ||
+	    !bpf_map_flags_access_ok(attr->map_flags))
+		return -EINVAL;
+
+	if (attr->max_entries == 0 || attr->key_size == 0 ||
+	    attr->value_size == 0)
+		return -EINVAL;
+
+	/* rhashtable takes the key length as an u16 */
+	if (attr->key_size > U16_MAX)
+		return -E2BIG;
+
+	if ((u64)round_up(attr->key_size, 8) + attr->value_size >=
+	    KMALLOC_MAX_SIZE - sizeof(struct rhtab_elem))
+		return -E2BIG;
+
+	return 0;
+}
+
+static struct bpf_map *rhtab_map_alloc(union bpf_attr *attr)
+{
+	struct bpf_rhtab *rhtab;
+	int err;
+
+	rhtab = bpf_map_area_alloc(sizeof(*rhtab),
+				   bpf_map_attr_numa_node(attr));
+	if (!rhtab)
+		return ERR_PTR(-ENOMEM);
+
+	bpf_map_init_from_attr(&rhtab->map, attr);
+
+	rhtab->elem_size = sizeof(struct rhtab_elem) +
+			   round_up(attr->key_size, 8) +
+			   round_up(attr->value_size, 8);
+	rhtab->params = (struct rhashtable_params) {
+		.head_offset = offsetof(struct rhtab_elem, node),
+		.key_offset = offsetof(struct rhtab_elem, key),
+		.key_len = attr->key_size,
+		.nelem_hint = min_t(u32, attr->max_entries, 64),
+		.automatic_shrinking = true,
+		/* The map isn't charged yet, so use the creator's memcg */
+		.memcg = get_mem_cgroup_from_mm(current->mm),
+	};
+	atomic_set(&rhtab->count, 0);
+
+	err = -ENOMEM;
+	rhtab->map_locked = bpf_map_alloc_percpu(&rhtab->map, sizeof(int),
+						 sizeof(int), GFP_USER);
+	if (!rhtab->map_locked)
+		goto free_rhtab;
+
+	err = rhashtable_init(&rhtab->ht, &rhtab->params);
+	if (err)
+		goto free_map_locked;
+
+	return &rhtab->map;
+
+free_map_locked:
+	free_percpu(rhtab->map_locked);
+free_rhtab:
+	mem_cgroup_put(rhtab->params.memcg);
+	bpf_map_area_free(rhtab);
+	return ERR_PTR(err);
+}
+
+static void rhtab_free_elem(void *ptr, void *arg)
+{
+	kfree(container_of(ptr, struct rhtab_elem, node));
+}
+
+/*
+ * Called once no program uses the map anymore and all syscall users are
+ * gone, so elements can be freed right away. Elements already removed
+ * are freed by kfree_rcu() and don't reference the map.
+ */
+static void rhtab_map_free(struct bpf_map *map)
+{
+	struct bpf_rhtab *rhtab = to_rhtab(map);
+
+	rhashtable_free_and_destroy(&rhtab->ht, rhtab_free_elem, NULL);
+	free_percpu(rhtab->map_locked);
+	mem_cgroup_put(rhtab->params.memcg);
+	bpf_map_area_free(rhtab);
+}
+
+static struct rhtab_elem *rhtab_lookup(struct bpf_rhtab *rhtab, void *key)
+{
+	WARN_ON_ONCE(!rcu_read_lock_held() && !rcu_read_lock_bh_held());
+
+	return rhashtable_lookup(&rhtab->ht, key, rhtab->params);
+}
+
+static void *rhtab_map_lookup_elem(struct bpf_map *map, void *key)
+{
+	struct bpf_rhtab *rhtab = to_rhtab(map);
+	struct rhtab_elem *elem = rhtab_lookup(rhtab, key);
+
+	return elem ? rhtab_elem_value(rhtab, elem) : NULL;
+}
+
+static long rhtab_map_update_elem(struct bpf_map *map, void *key, void *value,
+				  u64 map_flags)
+{
+	struct bpf_rhtab *rhtab = to_rhtab(map);
+	struct rhtab_elem *old, *new;
+	int ret;
+
+	if (unlikely(map_flags > BPF_EXIST))
+		/* unknown flags, BPF_F_LOCK isn't supported */
+		return -EINVAL;
+
+	ret = rhtab_lock(rhtab);
+	if (ret)
+		return ret;
+
+	new = bpf_map_kmalloc_node(map, rhtab->elem_size,
+				   GFP_ATOMIC | __GFP_NOWARN, map->numa_node);
+	if (!new) {
+		ret = -ENOMEM;
+		goto out;
+	}
+	memcpy(new->key, key, map->key_size);
+	copy_map_value(map, rhtab_elem_value(rhtab, new), value);
+
+	/*
+	 * Elements are replaced rather than updated in place, so that a
+	 * concurrent lookup never sees a partially written value. If another
+	 * CPU inserts or removes the same key in between, try again with what
+	 * it left behind.
+	 */
+again:
+	old = rhtab_lookup(rhtab, key);
+	if (old) {
+		ret = -EEXIST;
+		if (map_flags == BPF_NOEXIST)
+			goto free_new;
+
+		ret = rhashtable_replace_fast(&rhtab->ht, &old->node,
+					      &new->node, rhtab->params);
+		if (ret == -ENOENT)
+			goto again;
+		if (ret)
+			goto free_new;
+
+		kfree_rcu(old, rcu);
+		goto out;
+	}
+
+	ret = -ENOENT;
+	if (map_flags == BPF_EXIST)
+		goto free_new;
+
+	ret = -E2BIG;
+	if (atomic_inc_return(&rhtab->count) > map->max_entries)
+		goto dec_count;
+
+	ret = rhashtable_lookup_insert_fast(&rhtab->ht, &new->node,
+					    rhtab->params);
+	if (!ret)
+		goto out;
+	if (ret == -EEXIST) {
+		atomic_dec(&rhtab->count);
+		goto again;
+	}
+
+dec_count:
+	atomic_dec(&rhtab->count);
+free_new:
+	kfree(new);
+out:
+	rhtab_unlock(rhtab);
+	return ret;
+}
+
+static long rhtab_map_delete_elem(struct bpf_map *map, void *key)
+{
+	struct bpf_rhtab *rhtab = to_rhtab(map);
+	struct rhtab_elem *elem;
+	int ret;
+
+	ret = rhtab_lock(rhtab);
+	if (ret)
+		return ret;
+
+	ret = -ENOENT;
+	elem = rhtab_lookup(rhtab, key);
+	if (elem)
+		ret = rhashtable_remove_fast(&rhtab->ht, &elem->node,
+					     rhtab->params);
+	if (!ret) {
+		atomic_dec(&rhtab->count);
+		kfree_rcu(elem, rcu);
+	}
+
+	rhtab_unlock(rhtab);
+	return ret;
+}
+
+/* Copy out the key of the first element in buckets @hash and above of @tbl */
+static int rhtab_next_key_from(struct bpf_rhtab *rhtab,
+			       struct bucket_table *tbl, unsigned int hash,
+			       void *next_key)
+{
+	struct rhtab_elem *elem;
+	struct rhash_head *pos;
+
+	for (; hash < tbl->size; hash++) {
+		rht_for_each_entry_rcu(elem, pos, tbl, hash, node) {
+			memcpy(next_key, elem->key, rhtab->map.key_size);
+			return 0;
+		}
+	}
+	return -ENOENT;
+}
+
+/*
+ * Walk the buckets in order, continuing after the bucket of @key. While the
+ * table is being resized elements move from the old table to the future
+ * one, so both are walked; an element can then be returned twice, but none
+ * present during the whole walk is skipped.
+ */
+static int rhtab_map_get_next_key(struct bpf_map *map, void *key,
+				  void *next_key)
+{
+	struct bpf_rhtab *rhtab = to_rhtab(map);
+	struct bucket_table *tbl, *start_tbl = NULL;
+	unsigned int hash = 0;
+	struct rhtab_elem *elem;
+	struct rhash_head *pos;
+	int ret = -ENOENT;
+
+	rcu_read_lock();
+	tbl = rht_dereference_rcu(rhtab->ht.tbl, &rhtab->ht);
+
+	for (; key && tbl && !start_tbl;
+	     tbl = rht_dereference_rcu(tbl->future_tbl, &rhtab->ht)) {
+		hash = rht_key_hashfn(&rhtab->ht, tbl, key, rhtab->params);
+		rht_for_each_entry_rcu(elem, pos, tbl, hash, node) {
+			if (memcmp(elem->key, key, map->key_size))
+				continue;
+
+			/* Return the next element of the same bucket */
+			pos = rcu_dereference_raw(pos->next);
+			if (!rht_is_a_nulls(pos)) {
+				elem = rht_obj(&rhtab->ht, pos);
+				memcpy(next_key, elem->key, map->key_size);
+				ret = 0;
+				goto out;
+			}
+			start_tbl = tbl;
+			hash++;
+			break;
+		}
+	}
+
+	/* The key is gone, start over like htab_map_get_next_key() does */
+	if (!start_tbl) {
+		start_tbl = rht_dereference_rcu(rhtab->ht.tbl, &rhtab->ht);
+		hash = 0;
+	}
+
+	for (tbl = start_tbl; tbl;
+	     tbl = rht_dereference_rcu(tbl->future_tbl, &rhtab->ht)) {
+		ret = rhtab_next_key_from(rhtab, tbl, hash, next_key);
+		if (!ret)
+			break;
+		hash = 0;
+	}
+out:
+	rcu_read_unlock();
+	return ret;
+}
+
+static void rhtab_map_seq_show_elem(struct bpf_map *map, void *key,
+				    struct seq_file *m)
+{
+	void *value;
+
+	rcu_read_lock();
+
+	value = rhtab_map_lookup_elem(map, key);
+	if (!value) {
+		rcu_read_unlock();
+		return;
+	}
+
+	btf_type_seq_show(map->btf, map->btf_key_type_id, key, m);
+	seq_puts(m, ": ");
+	btf_type_seq_show(map->btf, map->btf_value_type_id, value, m);
+	seq_puts(m, "\n");
+
+	rcu_read_unlock();
+}
+
+BTF_ID_LIST_SINGLE(rhtab_map_btf_ids, struct, bpf_rhtab)
+const struct bpf_map_ops rhtab_map_ops = {
+	.map_meta_equal = bpf_map_meta_equal,
+	.map_alloc_check = rhtab_map_alloc_check,
+	.map_alloc = rhtab_map_alloc,
+	.map_free = rhtab_map_free,
+	.map_get_next_key = rhtab_map_get_next_key,
+	.map_lookup_elem = rhtab_map_lookup_elem,
+	.map_update_elem = rhtab_map_update_elem,
+	.map_delete_elem = rhtab_map_delete_elem,
+	.map_seq_show_elem = rhtab_map_seq_show_elem,
+	.map_btf_id = &rhtab_map_btf_ids[0],
+};
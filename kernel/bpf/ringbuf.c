@@ -35,6 +35,8 @@ struct bpf_ringbuf {
 	wait_queue_head_t waitq;
 	struct irq_work work;
 	u64 mask;
+	/* consumer is only woken up once this many bytes are pending */
+	u64 wakeup_wm;
 	struct page **pages;
 	int nr_pages;
 	spinlock_t spinlock ____cacheline_aligned_in_smp;
@@ -160,7 +162,8 @@ static void bpf_ringbuf_notify(struct irq_work *work)
 	wake_up_all(&rb->waitq);
 }
 
-static struct bpf_ringbuf *bpf_ringbuf_alloc(size_t data_sz, int numa_node)
+static struct bpf_ringbuf *bpf_ringbuf_alloc(size_t data_sz, u64 wakeup_wm,
+					     int numa_node)
 {
 	struct bpf_ringbuf *rb;
 
@@ -174,6 +177,7 @@ static struct bpf_ringbuf *bpf_ringbuf_alloc(size_t data_sz, int numa_node)
 	init_irq_work(&rb->work, bpf_ringbuf_notify);
 
 	rb->mask = data_sz - 1;
+	rb->wakeup_wm = wakeup_wm;
 	rb->consumer_pos = 0;
 	rb->producer_pos = 0;
 
@@ -192,6 +196,12 @@ static struct bpf_map *ringbuf_map_alloc(union bpf_attr *attr)
 	    !PAGE_ALIGNED(attr->max_entries))
 		return ERR_PTR(-EINVAL);
 
+	/* map_extra is the wakeup watermark in bytes, see bpf_ringbuf_commit() */
+	if (attr->map_extra &&
+	    (attr->map_type != BPF_MAP_TYPE_RINGBUF ||
+	     attr->map_extra >= attr->max_entries))
+		return ERR_PTR(-EINVAL);
+
 #ifdef CONFIG_64BIT
 	/* on 32-bit arch, it's impossible to overflow record's hdr->pgoff */
 	if (attr->max_entries > RINGBUF_MAX_DATA_SZ)
@@ -204,7 +214,8 @@ static struct bpf_map *ringbuf_map_alloc(union bpf_attr *attr)
 
 	bpf_map_init_from_attr(&rb_map->map, attr);
 
-	rb_map->rb = bpf_ringbuf_alloc(attr->max_entries, rb_map->map.numa_node);
+	rb_map->rb = bpf_ringbuf_alloc(attr->max_entries, attr->map_extra,
+				       rb_map->map.numa_node);
 	if (!rb_map->rb) {
 		bpf_map_area_free(rb_map);
 		return ERR_PTR(-ENOMEM);
@@ -314,11 +325,13 @@ static __poll_t ringbuf_map_poll_kern(struct bpf_map *map, struct file *filp,
 				      struct poll_table_struct *pts)
 {
 	struct bpf_ringbuf_map *rb_map;
+	struct bpf_ringbuf *rb;
 
 	rb_map = container_of(map, struct bpf_ringbuf_map, map);
-	poll_wait(filp, &rb_map->rb->waitq, pts);
+	rb = rb_map->rb;
+	poll_wait(filp, &rb->waitq, pts);
 
-	if (ringbuf_avail_data_sz(rb_map->rb))
+	if (ringbuf_avail_data_sz(rb) >= max(rb->wakeup_wm, 1ULL))
 		return EPOLLIN | EPOLLRDNORM;
 	return 0;
 }
@@ -453,16 +466,39 @@ const struct bpf_func_proto bpf_ringbuf_reserve_proto = {
 	.arg3_type	= ARG_ANYTHING,
 };
 
+/*
+ * Without a watermark, the consumer only needs a wakeup when it has caught
+ * up and waits for this very record. With one, it is woken up by the record
+ * which makes the pending data reach the watermark, or by the record it waits
+ * for if enough data is pending behind it already.
+ */
+static bool bpf_ringbuf_wakeup_due(struct bpf_ringbuf *rb,
+				   unsigned long rec_pos,
+				   unsigned long cons_pos, u32 rec_len)
+{
+	unsigned long ahead;
+
+	if (!rb->wakeup_wm)
+		return cons_pos == rec_pos;
+
+	/* consumer may have moved past the record already, then ahead wraps */
+	ahead = (rec_pos - cons_pos) & rb->mask;
+	if (!ahead)
+		return ringbuf_avail_data_sz(rb) >= rb->wakeup_wm;
+	return ahead < rb->wakeup_wm && ahead + rec_len >= rb->wakeup_wm;
+}
+
 static void bpf_ringbuf_commit(void *sample, u64 flags, bool discard)
 {
 	unsigned long rec_pos, cons_pos;
 	struct bpf_ringbuf_hdr *hdr;
 	struct bpf_ringbuf *rb;
-	u32 new_len;
+	u32 new_len, rec_len;
 
 	hdr = sample - BPF_RINGBUF_HDR_SZ;
 	rb = bpf_ringbuf_restore_from_rec(hdr);
 	new_len = hdr->len ^ BPF_RINGBUF_BUSY_BIT;
+	rec_len = round_up(new_len + BPF_RINGBUF_HDR_SZ, 8);
 	if (discard)
 		new_len |= BPF_RINGBUF_DISCARD_BIT;
 
@@ -477,7 +513,8 @@ static void bpf_ringbuf_commit(void *sample, u64 flags, bool discard)
 
 	if (flags & BPF_RB_FORCE_WAKEUP)
 		irq_work_queue(&rb->work);
-	else if (cons_pos == rec_pos && !(flags & BPF_RB_NO_WAKEUP))
+	else if (!(flags & BPF_RB_NO_WAKEUP) &&
+		 bpf_ringbuf_wakeup_due(rb, rec_pos, cons_pos, rec_len))
 		irq_work_queue(&rb->work);
 }
 
@@ -7,7 +7,9 @@
 #include <linux/fs.h>
 #include <linux/fdtable.h>
 #include <linux/filter.h>
+#include <linux/btf.h>
 #include <linux/btf_ids.h>
+#include <linux/sched/cputime.h>
 #include "mmap_unlock_work.h"
 
 static const char * const iter_task_type_names[] = {
@@ -724,7 +726,7 @@ static struct bpf_iter_reg task_reg_info = {
 	.ctx_arg_info_size	= 1,
 	.ctx_arg_info		= {
 		{ offsetof(struct bpf_iter__task, task),
-		  PTR_TO_BTF_ID_OR_NULL },
+		  PTR_TO_BTF_ID_OR_NULL | PTR_TRUSTED },
 	},
 	.seq_info		= &task_seq_info,
 	.fill_link_info		= bpf_iter_fill_link_info,
@@ -745,7 +747,7 @@ static struct bpf_iter_reg task_file_reg_info = {
 	.ctx_arg_info_size	= 2,
 	.ctx_arg_info		= {
 		{ offsetof(struct bpf_iter__task_file, task),
-		  PTR_TO_BTF_ID_OR_NULL },
+		  PTR_TO_BTF_ID_OR_NULL | PTR_TRUSTED },
 		{ offsetof(struct bpf_iter__task_file, file),
 		  PTR_TO_BTF_ID_OR_NULL },
 	},
@@ -768,7 +770,7 @@ static struct bpf_iter_reg task_vma_reg_info = {
 	.ctx_arg_info_size	= 2,
 	.ctx_arg_info		= {
 		{ offsetof(struct bpf_iter__task_vma, task),
-		  PTR_TO_BTF_ID_OR_NULL },
+		  PTR_TO_BTF_ID_OR_NULL | PTR_TRUSTED },
 		{ offsetof(struct bpf_iter__task_vma, vma),
 		  PTR_TO_BTF_ID_OR_NULL },
 	},
@@ -823,6 +825,75 @@ const struct bpf_func_proto bpf_find_vma_proto = {
 	.arg5_type	= ARG_ANYTHING,
 };
 
+__diag_push();
+__diag_ignore_all("-Wmissing-prototypes",
+		  "Global functions as their definitions will be in vmlinux BTF");
+
+/**
+ * bpf_task_mm_counter - Read an RSS counter of the mm of a task, without
+ * walking its page tables or taking its mmap_lock.
+ * @task: The task whose mm is read.
+ * @member: The counter: MM_FILEPAGES, MM_ANONPAGES, MM_SWAPENTS or
+ *	    MM_SHMEMPAGES.
+ *
+ * Returns the counter in pages, -EINVAL for an unknown counter, -ENOENT if
+ * the task has no mm, or -EBUSY if the mm can not be pinned from the
+ * current context.
+ */
+s64 bpf_task_mm_counter(struct task_struct *task, int member)
+{
+	s64 ret = -ENOENT;
+
+	if (member < 0 || member >= NR_MM_COUNTERS)
+		return -EINVAL;
+
+	/*
+	 * task_lock() keeps task->mm from being released. The program may
+	 * run in interrupt context or with the lock already held, so only
+	 * try it from task context.
+	 */
+	if (!in_task() || !spin_trylock(&task->alloc_lock))
+		return -EBUSY;
+
+	if (task->mm && !(task->flags & PF_KTHREAD))
+		ret = get_mm_counter(task->mm, member);
+	task_unlock(task);
+
+	return ret;
+}
+
+/**
+ * bpf_task_cputime - Read the user and system time of a task in nanoseconds.
+ * Unlike the raw task_struct fields, this includes the pending time of a task
+ * running on a nohz_full CPU.
+ * @task: The task whose times are read.
+ * @utime: Returns the user time.
+ * @stime: Returns the system time.
+ *
+ * Returns 0 or -EBUSY in NMI context, where the vtime sequence count can not
+ * be read safely.
+ */
+int bpf_task_cputime(struct task_struct *task, u64 *utime, u64 *stime)
+{
+	if (in_nmi())
+		return -EBUSY;
+
+	task_cputime(task, utime, stime);
+	return 0;
+}
+
+__diag_pop();
+
+BTF_SET8_START(task_iter_btf_ids)
+BTF_ID_FLAGS(func, bpf_task_mm_counter, KF_TRUSTED_ARGS)
+BTF_ID_FLAGS(func, bpf_task_cputime, KF_TRUSTED_ARGS)
+BTF_SET8_END(task_iter_btf_ids)
+
+static const struct btf_kfunc_id_set task_iter_kfunc_set = {
+	.owner = THIS_MODULE,
+	.set   = &task_iter_btf_ids,
+};
+
 DEFINE_PER_CPU(struct mmap_unlock_irq_work, mmap_unlock_work);
 
 static void do_mmap_read_unlock(struct irq_work *entry)
@@ -846,6 +917,10 @@ static int __init task_iter_init(void)
 		init_irq_work(&work->irq_work, do_mmap_read_unlock);
 	}
 
+	ret = register_btf_kfunc_id_set(BPF_PROG_TYPE_TRACING, &task_iter_kfunc_set);
+	if (ret)
+		return ret;
+
 	task_reg_info.ctx_arg_info[0].btf_id = btf_tracing_ids[BTF_TRACING_TYPE_TASK];
 	ret = bpf_iter_reg_target(&task_reg_info);
 	if (ret)
@@ -417,6 +417,12 @@ void cpuset_read_unlock(void)
 
 static DEFINE_SPINLOCK(callback_lock);
 
+/*
+ * CPUs in valid isolated partitions. Written with cpuset_rwsem and
+ * callback_lock held, read locklessly through cpuset_cpu_is_isolated().
+ */
+static cpumask_var_t	isolated_cpus;
+
 static struct workqueue_struct *cpuset_migrate_mm_wq;
 
 /*
@@ -1688,6 +1694,49 @@ update_parent_subparts:
 		rebuild_sched_domains_locked();
 }
 
+/*
+ * Recompute isolated_cpus after a partition or its CPUs changed.
+ * Called with cpuset_rwsem held.
+ */
+static void update_isolated_cpus(void)
+{
+	static struct cpumask new_isolated;	/* protected by cpuset_rwsem */
+	struct cpuset *cs;
+	struct cgroup_subsys_state *pos_css;
+
+	percpu_rwsem_assert_held(&cpuset_rwsem);
+
+	cpumask_clear(&new_isolated);
+	rcu_read_lock();
+	cpuset_for_each_descendant_pre(cs, pos_css, &top_cpuset) {
+		if (cs->partition_root_state == PRS_ISOLATED)
+			cpumask_or(&new_isolated, &new_isolated,
+				   cs->effective_cpus);
+	}
+	rcu_read_unlock();
+
+	if (cpumask_equal(&new_isolated, isolated_cpus))
+		return;
+
+	spin_lock_irq(&callback_lock);
+	cpumask_copy(isolated_cpus, &new_isolated);
+	spin_unlock_irq(&callback_lock);
+}
+
+/**
+ * cpuset_cpu_is_isolated - Check if @cpu is in an isolated partition
+ * @cpu: the CPU to check
+ *
+ * Isolated partitions are set up at runtime; kernel housekeeping work which
+ * can be deferred should leave their CPUs alone, just like CPUs isolated
+ * at boot.
+ */
+bool cpuset_cpu_is_isolated(int cpu)
+{
+	return cpumask_test_cpu(cpu, isolated_cpus);
+}
+EXPORT_SYMBOL_GPL(cpuset_cpu_is_isolated);
+
 /**
  * update_sibling_cpumasks - Update siblings cpumasks
  * @parent:  Parent cpuset
@@ -1859,6 +1908,7 @@ static int update_cpumask(struct cpuset *cs, struct cpuset *trialcs,
 		if (parent->child_ecpus_count)
 			update_sibling_cpumasks(parent, cs, &tmp);
 	}
+	update_isolated_cpus();
 	return 0;
 }
 
@@ -2345,6 +2395,7 @@ out:
 	if (!list_empty(&cs->css.children))
 		update_cpumasks_hier(cs, &tmpmask, !new_prs);
 
+	update_isolated_cpus();
 	notify_partition_change(cs, old_prs);
 	free_cpumasks(NULL, &tmpmask);
 	return 0;
@@ -2632,6 +2683,7 @@ typedef enum {
 	FILE_EFFECTIVE_CPULIST,
 	FILE_EFFECTIVE_MEMLIST,
 	FILE_SUBPARTS_CPULIST,
+	FILE_ISOLATED_CPULIST,
 	FILE_CPU_EXCLUSIVE,
 	FILE_MEM_EXCLUSIVE,
 	FILE_MEM_HARDWALL,
@@ -2819,6 +2871,9 @@ static int cpuset_common_seq_show(struct seq_file *sf, void *v)
 	case FILE_SUBPARTS_CPULIST:
 		seq_printf(sf, "%*pbl\n", cpumask_pr_args(cs->subparts_cpus));
 		break;
+	case FILE_ISOLATED_CPULIST:
+		seq_printf(sf, "%*pbl\n", cpumask_pr_args(isolated_cpus));
+		break;
 	default:
 		ret = -EINVAL;
 	}
@@ -3096,6 +3151,13 @@ static struct cftype dfl_files[] = {
 		.flags = CFTYPE_DEBUG,
 	},
 
+	{
+		.name = "cpus.isolated",
+		.seq_show = cpuset_common_seq_show,
+		.private = FILE_ISOLATED_CPULIST,
+		.flags = CFTYPE_ONLY_ON_ROOT,
+	},
+
 	{ }	/* terminate */
 };
 
@@ -3411,6 +3473,7 @@ int __init cpuset_init(void)
 	top_cpuset.relax_domain_level = -1;
 
 	BUG_ON(!alloc_cpumask_var(&cpus_attach, GFP_KERNEL));
+	BUG_ON(!zalloc_cpumask_var(&isolated_cpus, GFP_KERNEL));
 
 	return 0;
 }
@@ -3744,6 +3807,13 @@ static void cpuset_hotplug_workfn(struct work_struct *work)
 		rebuild_sched_domains();
 	}
 
+	/* hotplug may have invalidated or restored isolated partitions */
+	if (cpus_updated) {
+		percpu_down_write(&cpuset_rwsem);
+		update_isolated_cpus();
+		percpu_up_write(&cpuset_rwsem);
+	}
+
 	free_cpumasks(NULL, ptmp);
 }
 
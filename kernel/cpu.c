@@ -36,6 +36,7 @@
 #include <linux/cpuset.h>
 #include <linux/random.h>
 #include <linux/cc_platform.h>
+#include <linux/delay.h>
 
 #include <trace/events/power.h>
 #define CREATE_TRACE_POINTS
@@ -61,6 +62,7 @@
  * @result:	Result of the operation
  * @done_up:	Signal completion to the issuer of the task for cpu-up
  * @done_down:	Signal completion to the issuer of the task for cpu-down
+ * @ap_sync_state:	State for AP synchronization with the control CPU
  */
 struct cpuhp_cpu_state {
 	enum cpuhp_state	state;
@@ -79,6 +81,9 @@ struct cpuhp_cpu_state {
 	struct completion	done_up;
 	struct completion	done_down;
 #endif
+#ifdef CONFIG_HOTPLUG_SPLIT_STARTUP
+	atomic_t		ap_sync_state;
+#endif
 };
 
 static DEFINE_PER_CPU(struct cpuhp_cpu_state, cpuhp_state) = {
@@ -558,7 +563,7 @@ static int cpuhp_kick_ap(int cpu, struct cpuhp_cpu_state *st,
 	return ret;
 }
 
-static int bringup_wait_for_ap(unsigned int cpu)
+static int bringup_wait_for_ap_online(unsigned int cpu)
 {
 	struct cpuhp_cpu_state *st = per_cpu_ptr(&cpuhp_state, cpu);
 
@@ -579,6 +584,88 @@ static int bringup_wait_for_ap(unsigned int cpu)
 	 */
 	if (!cpu_smt_allowed(cpu))
 		return -ECANCELED;
+	return 0;
+}
+
+#ifdef CONFIG_HOTPLUG_SPLIT_STARTUP
+enum cpuhp_sync_state {
+	SYNC_STATE_KICKED,
+	SYNC_STATE_ALIVE,
+	SYNC_STATE_SHOULD_ONLINE,
+};
+
+/**
+ * cpuhp_ap_sync_alive - Synchronize AP with the control CPU once it is alive
+ *
+ * Called by the architecture code on the AP once it has left the low level
+ * startup code and no longer depends on any state the control CPU set up for
+ * it. Reports the AP alive and waits until the control CPU releases it in
+ * CPUHP_BRINGUP_CPU. Interrupts are disabled.
+ */
+void cpuhp_ap_sync_alive(void)
+{
+	atomic_t *st = this_cpu_ptr(&cpuhp_state.ap_sync_state);
+
+	atomic_set_release(st, SYNC_STATE_ALIVE);
+
+	/* Wait for the control CPU to release it */
+	while (atomic_read_acquire(st) != SYNC_STATE_SHOULD_ONLINE)
+		cpu_relax();
+}
+
+static int cpuhp_bp_sync_alive(unsigned int cpu)
+{
+	atomic_t *st = per_cpu_ptr(&cpuhp_state.ap_sync_state, cpu);
+	ktime_t timeout = ktime_add_ms(ktime_get(), 10 * MSEC_PER_SEC);
+	unsigned int tries = 0;
+
+	while (atomic_read_acquire(st) != SYNC_STATE_ALIVE) {
+		if (ktime_after(ktime_get(), timeout)) {
+			pr_err("CPU%u failed to report alive state\n", cpu);
+			return -EIO;
+		}
+		/* Poll briefly first, the AP usually is there already */
+		if (++tries < 10)
+			udelay(10);
+		else
+			usleep_range(USEC_PER_MSEC / 2, USEC_PER_MSEC);
+	}
+
+	atomic_set_release(st, SYNC_STATE_SHOULD_ONLINE);
+	return 0;
+}
+
+/*
+ * Sends the startup IPI to the AP. Nothing in here may wait for the AP to
+ * respond; with parallel bringup the kick of all APs happens before the
+ * first one is waited for in CPUHP_BRINGUP_CPU.
+ */
+static int cpuhp_kick_ap_alive(unsigned int cpu)
+{
+	atomic_set(per_cpu_ptr(&cpuhp_state.ap_sync_state, cpu),
+		   SYNC_STATE_KICKED);
+
+	return arch_cpuhp_kick_ap_alive(cpu, idle_thread_get(cpu));
+}
+
+static int cpuhp_bringup_ap(unsigned int cpu)
+{
+	struct cpuhp_cpu_state *st = per_cpu_ptr(&cpuhp_state, cpu);
+	int ret;
+
+	/*
+	 * Some architectures have to walk the irq descriptors to
+	 * setup the vector space for the cpu which comes online.
+	 * Prevent irq alloc/free across the bringup.
+	 */
+	irq_lock_sparse();
+
+	ret = cpuhp_bp_sync_alive(cpu);
+	if (!ret)
+		ret = bringup_wait_for_ap_online(cpu);
+	irq_unlock_sparse();
+	if (ret)
+		return ret;
 
 	if (st->target <= CPUHP_AP_ONLINE_IDLE)
 		return 0;
@@ -586,17 +673,13 @@ static int bringup_wait_for_ap(unsigned int cpu)
 	return cpuhp_kick_ap(cpu, st, st->target);
 }
 
+#else
 static int bringup_cpu(unsigned int cpu)
 {
+	struct cpuhp_cpu_state *st = per_cpu_ptr(&cpuhp_state, cpu);
 	struct task_struct *idle = idle_thread_get(cpu);
 	int ret;
 
-	/*
-	 * Reset stale stack state from the last time this CPU was online.
-	 */
-	scs_task_reset(idle);
-	kasan_unpoison_task_stack(idle);
-
 	/*
 	 * Some architectures have to walk the irq descriptors to
 	 * setup the vector space for the cpu which comes online.
@@ -609,8 +692,17 @@ static int bringup_cpu(unsigned int cpu)
 	irq_unlock_sparse();
 	if (ret)
 		return ret;
-	return bringup_wait_for_ap(cpu);
+
+	ret = bringup_wait_for_ap_online(cpu);
+	if (ret)
+		return ret;
+
+	if (st->target <= CPUHP_AP_ONLINE_IDLE)
+		return 0;
+
+	return cpuhp_kick_ap(cpu, st, st->target);
 }
+#endif
 
 static int finish_cpu(unsigned int cpu)
 {
@@ -1383,6 +1475,14 @@ static int _cpu_up(unsigned int cpu, int tasks_frozen, enum cpuhp_state target)
 			ret = PTR_ERR(idle);
 			goto out;
 		}
+
+		/*
+		 * Reset stale stack state from the last time this CPU was
+		 * online. With split startup the AP is kicked before
+		 * CPUHP_BRINGUP_CPU, so this cannot wait until then.
+		 */
+		scs_task_reset(idle);
+		kasan_unpoison_task_stack(idle);
 	}
 
 	cpuhp_tasks_frozen = tasks_frozen;
@@ -1502,10 +1602,75 @@ int bringup_hibernate_cpu(unsigned int sleep_cpu)
 	return 0;
 }
 
+#ifdef CONFIG_HOTPLUG_PARALLEL
+static bool __cpuhp_parallel_bringup __ro_after_init = true;
+
+static int __init parallel_bringup_parse_param(char *arg)
+{
+	return kstrtobool(arg, &__cpuhp_parallel_bringup);
+}
+early_param("cpuhp.parallel", parallel_bringup_parse_param);
+
+static void __init cpuhp_bringup_mask(unsigned int ncpus,
+				      enum cpuhp_state target)
+{
+	unsigned int cpu;
+
+	for_each_present_cpu(cpu) {
+		struct cpuhp_cpu_state *st = per_cpu_ptr(&cpuhp_state, cpu);
+
+		if (!ncpus)
+			break;
+		if (cpu_online(cpu))
+			continue;
+		ncpus--;
+
+		if (cpu_up(cpu, target) && can_rollback_cpu(st)) {
+			/*
+			 * A failing final online only rolls back to
+			 * CPUHP_BP_KICK_AP. Clean that up; this is a NOOP
+			 * when the CPU is already offline.
+			 */
+			WARN_ON(cpuhp_invoke_callback_range(false, cpu, st,
+							    CPUHP_OFFLINE));
+		}
+	}
+}
+
+/*
+ * Invoke the BP prepare states of all APs to be onlined first. The last of
+ * them kicks the AP, so all APs run through the low level bringup code in
+ * parallel while the following ones are still being kicked. They wait in
+ * cpuhp_ap_sync_alive() until the control CPU releases them one by one for
+ * the final onlining, which no longer has to wait for each AP to respond to
+ * its startup IPI.
+ */
+static bool __init cpuhp_bringup_cpus_parallel(unsigned int ncpus)
+{
+	if (!__cpuhp_parallel_bringup)
+		return false;
+
+	if (!arch_cpuhp_init_parallel_bringup()) {
+		__cpuhp_parallel_bringup = false;
+		return false;
+	}
+
+	cpuhp_bringup_mask(ncpus, CPUHP_BP_KICK_AP);
+	cpuhp_bringup_mask(ncpus, CPUHP_ONLINE);
+	return true;
+}
+#else
+static inline bool cpuhp_bringup_cpus_parallel(unsigned int ncpus) { return false; }
+#endif /* CONFIG_HOTPLUG_PARALLEL */
+
 void bringup_nonboot_cpus(unsigned int setup_max_cpus)
 {
 	unsigned int cpu;
 
+	if (setup_max_cpus > num_online_cpus() &&
+	    cpuhp_bringup_cpus_parallel(setup_max_cpus - num_online_cpus()))
+		return;
+
 	for_each_present_cpu(cpu) {
 		if (num_online_cpus() >= setup_max_cpus)
 			break;
@@ -1740,6 +1905,26 @@ static struct cpuhp_step cpuhp_hp_states[] = {
 		.startup.single		= timers_prepare_cpu,
 		.teardown.single	= timers_dead_cpu,
 	},
+#ifdef CONFIG_HOTPLUG_SPLIT_STARTUP
+	/*
+	 * Kicks the AP alive. The AP waits in cpuhp_ap_sync_alive() until
+	 * the next step releases it.
+	 */
+	[CPUHP_BP_KICK_AP] = {
+		.name			= "cpu:kick_ap",
+		.startup.single		= cpuhp_kick_ap_alive,
+	},
+	/*
+	 * Waits for the AP to reach cpuhp_ap_sync_alive() and then releases
+	 * it for the complete bringup.
+	 */
+	[CPUHP_BRINGUP_CPU] = {
+		.name			= "cpu:bringup",
+		.startup.single		= cpuhp_bringup_ap,
+		.teardown.single	= finish_cpu,
+		.cant_stop		= true,
+	},
+#else
 	/* Kicks the plugged cpu into life */
 	[CPUHP_BRINGUP_CPU] = {
 		.name			= "cpu:bringup",
@@ -1747,6 +1932,7 @@ static struct cpuhp_step cpuhp_hp_states[] = {
 		.teardown.single	= finish_cpu,
 		.cant_stop		= true,
 	},
+#endif
 	/* Final state before CPU kills itself */
 	[CPUHP_AP_IDLE_DEAD] = {
 		.name			= "idle:dead",
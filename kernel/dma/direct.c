@@ -5,6 +5,7 @@
  * DMA operations that map physical memory directly without using an IOMMU.
  */
 #include <linux/memblock.h> /* for max_pfn */
+#include <linux/cc_platform.h>
 #include <linux/export.h>
 #include <linux/mm.h>
 #include <linux/dma-map-ops.h>
@@ -12,6 +13,7 @@
 #include <linux/pfn.h>
 #include <linux/vmalloc.h>
 #include <linux/set_memory.h>
+#include <linux/sizes.h>
 #include <linux/slab.h>
 #include "direct.h"
 
@@ -168,6 +170,24 @@ static bool dma_direct_use_pool(struct device *dev, gfp_t gfp)
 	return !gfpflags_allow_blocking(gfp) && !is_swiotlb_for_alloc(dev);
 }
 
+/*
+ * Converting pages to shared in a confidential computing guest is a round trip
+ * to the hypervisor, and so is converting them back on free.  Serve small
+ * coherent allocations, e.g. virtio rings and request buffers, that can block
+ * from the shared pools: like the atomic pools they stay shared and grow in
+ * large chunks that are converted at once, but they are grown synchronously
+ * and leave the atomic pools to the callers that can't block.
+ */
+#define DMA_DIRECT_SHARED_POOL_MAX	SZ_64K
+
+static bool dma_direct_use_shared_pool(struct device *dev, size_t size)
+{
+	return IS_ENABLED(CONFIG_DMA_COHERENT_POOL) &&
+		cc_platform_has(CC_ATTR_GUEST_MEM_ENCRYPT) &&
+		!is_swiotlb_for_alloc(dev) &&
+		size <= DMA_DIRECT_SHARED_POOL_MAX;
+}
+
 static void *dma_direct_alloc_from_pool(struct device *dev, size_t size,
 		dma_addr_t *dma_handle, gfp_t gfp)
 {
@@ -187,6 +207,23 @@ static void *dma_direct_alloc_from_pool(struct device *dev, size_t size,
 	return ret;
 }
 
+static void *dma_direct_alloc_from_shared_pool(struct device *dev, size_t size,
+		dma_addr_t *dma_handle, gfp_t gfp)
+{
+	struct page *page;
+	u64 phys_mask;
+	void *ret;
+
+	gfp |= dma_direct_optimal_gfp_mask(dev, dev->coherent_dma_mask,
+					   &phys_mask);
+	page = dma_alloc_from_shared_pool(dev, size, &ret, gfp,
+					  dma_coherent_ok);
+	if (!page)
+		return NULL;
+	*dma_handle = phys_to_dma_direct(dev, page_to_phys(page));
+	return ret;
+}
+
 static void *dma_direct_alloc_no_mapping(struct device *dev, size_t size,
 		dma_addr_t *dma_handle, gfp_t gfp)
 {
@@ -259,10 +296,20 @@ void *dma_direct_alloc(struct device *dev, size_t size,
 
 	/*
 	 * Decrypting memory may block, so allocate the memory from the atomic
-	 * pools if we can't block.
+	 * pools if we can't block.  Otherwise prefer the shared pools for
+	 * small allocations, and fall back to decrypting fresh pages.
 	 */
-	if (force_dma_unencrypted(dev) && dma_direct_use_pool(dev, gfp))
-		return dma_direct_alloc_from_pool(dev, size, dma_handle, gfp);
+	if (force_dma_unencrypted(dev)) {
+		if (dma_direct_use_pool(dev, gfp))
+			return dma_direct_alloc_from_pool(dev, size,
+					dma_handle, gfp);
+		if (dma_direct_use_shared_pool(dev, size)) {
+			ret = dma_direct_alloc_from_shared_pool(dev, size,
+					dma_handle, gfp);
+			if (ret)
+				return ret;
+		}
+	}
 
 	/* we always manually zero the memory once we are done */
 	page = __dma_direct_alloc_pages(dev, size, gfp & ~__GFP_ZERO, true);
@@ -9,6 +9,7 @@
 #include <linux/dma-direct.h>
 #include <linux/init.h>
 #include <linux/genalloc.h>
+#include <linux/mutex.h>
 #include <linux/set_memory.h>
 #include <linux/slab.h>
 #include <linux/workqueue.h>
@@ -26,6 +27,16 @@ static size_t atomic_pool_size;
 /* Dynamic background expansion when the atomic pool is near capacity */
 static struct work_struct atomic_pool_work;
 
+/*
+ * Pools for the blocking allocations of dma_alloc_from_shared_pool().  They
+ * are kept apart from the atomic pools so that such allocations can't drain
+ * those, and are grown by the caller under shared_pool_mutex.
+ */
+static struct gen_pool *shared_pool_dma;
+static struct gen_pool *shared_pool_dma32;
+static struct gen_pool *shared_pool_kernel;
+static DEFINE_MUTEX(shared_pool_mutex);
+
 static int __init early_coherent_pool(char *p)
 {
 	atomic_pool_size = memparse(p, &p);
@@ -76,8 +87,7 @@ static bool cma_in_zone(gfp_t gfp)
 	return true;
 }
 
-static int atomic_pool_expand(struct gen_pool *pool, size_t pool_size,
-			      gfp_t gfp)
+static int __pool_expand(struct gen_pool *pool, size_t pool_size, gfp_t gfp)
 {
 	unsigned int order;
 	struct page *page = NULL;
@@ -122,7 +132,6 @@ static int atomic_pool_expand(struct gen_pool *pool, size_t pool_size,
 	if (ret)
 		goto encrypt_mapping;
 
-	dma_atomic_pool_size_add(gfp, pool_size);
 	return 0;
 
 encrypt_mapping:
@@ -142,6 +151,18 @@ out:
 	return ret;
 }
 
+static int atomic_pool_expand(struct gen_pool *pool, size_t pool_size,
+			      gfp_t gfp)
+{
+	size_t old_size = gen_pool_size(pool);
+	int ret;
+
+	ret = __pool_expand(pool, pool_size, gfp);
+	if (!ret)
+		dma_atomic_pool_size_add(gfp, gen_pool_size(pool) - old_size);
+	return ret;
+}
+
 static void atomic_pool_resize(struct gen_pool *pool, gfp_t gfp)
 {
 	if (pool && gen_pool_avail(pool) < atomic_pool_size)
@@ -254,9 +275,6 @@ static struct page *__dma_alloc_from_pool(struct device *dev, size_t size,
 		return NULL;
 	}
 
-	if (gen_pool_avail(pool) < atomic_pool_size)
-		schedule_work(&atomic_pool_work);
-
 	*cpu_addr = (void *)addr;
 	memset(*cpu_addr, 0, size);
 	return pfn_to_page(__phys_to_pfn(phys));
@@ -270,19 +288,87 @@ struct page *dma_alloc_from_pool(struct device *dev, size_t size,
 	struct page *page;
 
 	while ((pool = dma_guess_pool(pool, gfp))) {
+		page = __dma_alloc_from_pool(dev, size, pool, cpu_addr,
+					     phys_addr_ok);
+		if (page) {
+			if (gen_pool_avail(pool) < atomic_pool_size)
+				schedule_work(&atomic_pool_work);
+			return page;
+		}
+	}
+
+	WARN(!(gfp & __GFP_NOWARN), "Failed to get suitable pool for %s\n",
+	     dev_name(dev));
+	return NULL;
+}
+
+static struct gen_pool **dma_shared_pool(gfp_t gfp)
+{
+	if (IS_ENABLED(CONFIG_ZONE_DMA) && (gfp & GFP_DMA))
+		return &shared_pool_dma;
+	if (IS_ENABLED(CONFIG_ZONE_DMA32) && (gfp & GFP_DMA32))
+		return &shared_pool_dma32;
+	return &shared_pool_kernel;
+}
+
+/*
+ * Allocate from a pool of unencrypted memory in a context that can block.
+ * An empty pool is grown right away by at least the atomic pool size, so
+ * that one conversion covers many allocations.  Like the atomic pools, the
+ * shared pools never shrink.
+ */
+struct page *dma_alloc_from_shared_pool(struct device *dev, size_t size,
+		void **cpu_addr, gfp_t gfp,
+		bool (*phys_addr_ok)(struct device *, phys_addr_t, size_t))
+{
+	struct gen_pool **poolp = dma_shared_pool(gfp);
+	gfp_t pool_gfp = GFP_KERNEL | (gfp & (GFP_DMA | GFP_DMA32));
+	struct gen_pool *pool;
+	struct page *page;
+
+	might_sleep();
+
+	pool = smp_load_acquire(poolp);
+	if (pool) {
 		page = __dma_alloc_from_pool(dev, size, pool, cpu_addr,
 					     phys_addr_ok);
 		if (page)
 			return page;
 	}
 
-	WARN(1, "Failed to get suitable pool for %s\n", dev_name(dev));
+	mutex_lock(&shared_pool_mutex);
+	pool = *poolp;
+	if (!pool) {
+		pool = gen_pool_create(PAGE_SHIFT, NUMA_NO_NODE);
+		if (!pool)
+			goto out_unlock;
+		gen_pool_set_algo(pool, gen_pool_first_fit_order_align, NULL);
+		smp_store_release(poolp, pool);
+	}
+
+	/* Someone else may have grown the pool meanwhile */
+	page = __dma_alloc_from_pool(dev, size, pool, cpu_addr, phys_addr_ok);
+	if (!page &&
+	    !__pool_expand(pool, max(size, atomic_pool_size), pool_gfp))
+		page = __dma_alloc_from_pool(dev, size, pool, cpu_addr,
+					     phys_addr_ok);
+	mutex_unlock(&shared_pool_mutex);
+	return page;
+
+out_unlock:
+	mutex_unlock(&shared_pool_mutex);
 	return NULL;
 }
 
 bool dma_free_from_pool(struct device *dev, void *start, size_t size)
 {
+	struct gen_pool *shared_pools[] = {
+		READ_ONCE(shared_pool_kernel),
+		READ_ONCE(shared_pool_dma32),
+		READ_ONCE(shared_pool_dma),
+	};
 	struct gen_pool *pool = NULL;
+	int i;
 
 	while ((pool = dma_guess_pool(pool, 0))) {
 		if (!gen_pool_has_addr(pool, (unsigned long)start, size))
@@ -291,5 +377,13 @@ bool dma_free_from_pool(struct device *dev, void *start, size_t size)
 		return true;
 	}
 
+	for (i = 0; i < ARRAY_SIZE(shared_pools); i++) {
+		pool = shared_pools[i];
+		if (!pool || !gen_pool_has_addr(pool, (unsigned long)start, size))
+			continue;
+		gen_pool_free(pool, (unsigned long)start, size);
+		return true;
+	}
+
 	return false;
 }
@@ -1,11 +1,13 @@
 // SPDX-License-Identifier: GPL-2.0
 
+#include <linux/compat.h>
 #include <linux/context_tracking.h>
 #include <linux/entry-common.h>
 #include <linux/resume_user_mode.h>
 #include <linux/highmem.h>
 #include <linux/jump_label.h>
 #include <linux/kmsan.h>
+#include <linux/latency_hist.h>
 #include <linux/livepatch.h>
 #include <linux/audit.h>
 #include <linux/tick.h>
@@ -93,6 +95,11 @@ __syscall_enter_from_user_work(struct pt_regs *regs, long syscall)
 	if (work & SYSCALL_WORK_ENTER)
 		syscall = syscall_trace_enter(regs, syscall, work);
 
+#ifdef CONFIG_LATENCY_HIST
+	/* Compat syscall numbers don't match the native ones, skip them */
+	current->lat_hist_syscall_start =
+		in_compat_syscall() ? 0 : lat_hist_start();
+#endif
 	return syscall;
 }
 
@@ -281,6 +288,10 @@ static void syscall_exit_to_user_mode_prepare(struct pt_regs *regs)
 
 static __always_inline void __syscall_exit_to_user_mode_work(struct pt_regs *regs)
 {
+#ifdef CONFIG_LATENCY_HIST
+	lat_hist_end(LAT_HIST_SYSCALL, syscall_get_nr(current, regs),
+		     current->lat_hist_syscall_start);
+#endif
 	syscall_exit_to_user_mode_prepare(regs);
 	local_irq_disable_exit_to_user();
 	exit_to_user_mode_prepare(regs);
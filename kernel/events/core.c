@@ -55,6 +55,7 @@
 #include <linux/pgtable.h>
 #include <linux/buildid.h>
 #include <linux/task_work.h>
+#include <linux/jhash.h>
 
 #include "internal.h"
 
@@ -375,6 +376,9 @@ enum event_type_t {
 	EVENT_TIME = 0x4,
 	/* see ctx_resched() for details */
 	EVENT_CPU = 0x8,
+	/* see perf_cgroup_switch() for details */
+	EVENT_CGROUP = 0x10,
+	EVENT_FLAGS = EVENT_CGROUP,
 	EVENT_ALL = EVENT_FLEXIBLE | EVENT_PINNED,
 };
 
@@ -684,19 +688,29 @@ do {									\
 	___p;								\
 })
 
-static void perf_ctx_disable(struct perf_event_context *ctx)
+/*
+ * Iterate the PMU contexts of @ctx; with @cgroup set, only those which have
+ * cgroup events.
+ */
+#define for_each_epc(_epc, _ctx, _cgroup)				\
+	list_for_each_entry(_epc, &(_ctx)->pmu_ctx_list, pmu_ctx_entry)	\
+		if (_cgroup && !_epc->nr_cgroups)			\
+			continue;					\
+		else
+
+static void perf_ctx_disable(struct perf_event_context *ctx, bool cgroup)
 {
 	struct perf_event_pmu_context *pmu_ctx;
 
-	list_for_each_entry(pmu_ctx, &ctx->pmu_ctx_list, pmu_ctx_entry)
+	for_each_epc(pmu_ctx, ctx, cgroup)
 		perf_pmu_disable(pmu_ctx->pmu);
 }
 
-static void perf_ctx_enable(struct perf_event_context *ctx)
+static void perf_ctx_enable(struct perf_event_context *ctx, bool cgroup)
 {
 	struct perf_event_pmu_context *pmu_ctx;
 
-	list_for_each_entry(pmu_ctx, &ctx->pmu_ctx_list, pmu_ctx_entry)
+	for_each_epc(pmu_ctx, ctx, cgroup)
 		perf_pmu_enable(pmu_ctx->pmu);
 }
 
@@ -856,9 +870,14 @@ static void perf_cgroup_switch(struct task_struct *task)
 		return;
 
 	perf_ctx_lock(cpuctx, cpuctx->task_ctx);
-	perf_ctx_disable(&cpuctx->ctx);
+	/*
+	 * Only the PMUs which have cgroup events need to be reprogrammed;
+	 * leave the others, e.g. uncore or software PMUs, alone so that a
+	 * cgroup switch doesn't touch their hardware.
+	 */
+	perf_ctx_disable(&cpuctx->ctx, true);
 
-	ctx_sched_out(&cpuctx->ctx, EVENT_ALL);
+	ctx_sched_out(&cpuctx->ctx, EVENT_ALL|EVENT_CGROUP);
 	/*
 	 * must not be done before ctxswout due
 	 * to update_cgrp_time_from_cpuctx() in
@@ -870,9 +889,9 @@ static void perf_cgroup_switch(struct task_struct *task)
 	 * perf_cgroup_set_timestamp() in ctx_sched_in()
 	 * to not have to pass task around
 	 */
-	ctx_sched_in(&cpuctx->ctx, EVENT_ALL);
+	ctx_sched_in(&cpuctx->ctx, EVENT_ALL|EVENT_CGROUP);
 
-	perf_ctx_enable(&cpuctx->ctx);
+	perf_ctx_enable(&cpuctx->ctx, true);
 	perf_ctx_unlock(cpuctx, cpuctx->task_ctx);
 }
 
@@ -971,6 +990,7 @@ perf_cgroup_event_enable(struct perf_event *event, struct perf_event_context *ct
 	 */
 	cpuctx = container_of(ctx, struct perf_cpu_context, ctx);
 
+	event->pmu_ctx->nr_cgroups++;
 	if (ctx->nr_cgroups++)
 		return;
 
@@ -991,6 +1011,7 @@ perf_cgroup_event_disable(struct perf_event *event, struct perf_event_context *c
 	 */
 	cpuctx = container_of(ctx, struct perf_cpu_context, ctx);
 
+	event->pmu_ctx->nr_cgroups--;
 	if (--ctx->nr_cgroups)
 		return;
 
@@ -2295,6 +2316,9 @@ group_sched_out(struct perf_event *group_event, struct perf_event_context *ctx)
 #define DETACH_CHILD	0x02UL
 #define DETACH_DEAD	0x04UL
 
+static void perf_aggr_flush(struct perf_event *event);
+static void perf_event_aggr_sync(struct perf_event *event);
+
 /*
  * Cross CPU call to remove a performance event
  *
@@ -2322,6 +2346,7 @@ __perf_remove_from_context(struct perf_event *event,
 	if (flags & DETACH_DEAD)
 		event->pending_disable = 1;
 	event_sched_out(event, ctx);
+	perf_aggr_flush(event);
 	if (flags & DETACH_GROUP)
 		perf_group_detach(event);
 	if (flags & DETACH_CHILD)
@@ -2405,10 +2430,16 @@ static void __perf_event_disable(struct perf_event *event,
 
 	perf_pmu_disable(event->pmu_ctx->pmu);
 
-	if (event == event->group_leader)
+	if (event == event->group_leader) {
+		struct perf_event *sibling;
+
 		group_sched_out(event, ctx);
-	else
+		for_each_sibling_event(sibling, event)
+			perf_aggr_flush(sibling);
+	} else {
 		event_sched_out(event, ctx);
+	}
+	perf_aggr_flush(event);
 
 	perf_event_set_state(event, PERF_EVENT_STATE_OFF);
 	perf_cgroup_event_disable(event, ctx);
@@ -2677,9 +2708,9 @@ static void ctx_resched(struct perf_cpu_context *cpuctx,
 
 	event_type &= EVENT_ALL;
 
-	perf_ctx_disable(&cpuctx->ctx);
+	perf_ctx_disable(&cpuctx->ctx, false);
 	if (task_ctx) {
-		perf_ctx_disable(task_ctx);
+		perf_ctx_disable(task_ctx, false);
 		task_ctx_sched_out(task_ctx, event_type);
 	}
 
@@ -2697,9 +2728,9 @@ static void ctx_resched(struct perf_cpu_context *cpuctx,
 
 	perf_event_sched_in(cpuctx, task_ctx);
 
-	perf_ctx_enable(&cpuctx->ctx);
+	perf_ctx_enable(&cpuctx->ctx, false);
 	if (task_ctx)
-		perf_ctx_enable(task_ctx);
+		perf_ctx_enable(task_ctx, false);
 }
 
 void perf_pmu_resched(struct pmu *pmu)
@@ -3244,6 +3275,9 @@ ctx_sched_out(struct perf_event_context *ctx, enum event_type_t event_type)
 	struct perf_cpu_context *cpuctx = this_cpu_ptr(&perf_cpu_context);
 	struct perf_event_pmu_context *pmu_ctx;
 	int is_active = ctx->is_active;
+	bool cgroup = event_type & EVENT_CGROUP;
+
+	event_type &= ~EVENT_FLAGS;
 
 	lockdep_assert_held(&ctx->lock);
 
@@ -3290,7 +3324,7 @@ ctx_sched_out(struct perf_event_context *ctx, enum event_type_t event_type)
 
 	is_active ^= ctx->is_active; /* changed bits */
 
-	list_for_each_entry(pmu_ctx, &ctx->pmu_ctx_list, pmu_ctx_entry)
+	for_each_epc(pmu_ctx, ctx, cgroup)
 		__pmu_ctx_sched_out(pmu_ctx, is_active);
 }
 
@@ -3482,7 +3516,7 @@ perf_event_context_sched_out(struct task_struct *task, struct task_struct *next)
 		raw_spin_lock_nested(&next_ctx->lock, SINGLE_DEPTH_NESTING);
 		if (context_equiv(ctx, next_ctx)) {
 
-			perf_ctx_disable(ctx);
+			perf_ctx_disable(ctx, false);
 
 			/* PMIs are disabled; ctx->nr_pending is stable. */
 			if (local_read(&ctx->nr_pending) ||
@@ -3502,7 +3536,7 @@ perf_event_context_sched_out(struct task_struct *task, struct task_struct *next)
 			perf_ctx_sched_task_cb(ctx, false);
 			perf_event_swap_task_ctx_data(ctx, next_ctx);
 
-			perf_ctx_enable(ctx);
+			perf_ctx_enable(ctx, false);
 
 			/*
 			 * RCU_INIT_POINTER here is safe because we've not
@@ -3526,13 +3560,13 @@ unlock:
 
 	if (do_switch) {
 		raw_spin_lock(&ctx->lock);
-		perf_ctx_disable(ctx);
+		perf_ctx_disable(ctx, false);
 
 inside_switch:
 		perf_ctx_sched_task_cb(ctx, false);
 		task_ctx_sched_out(ctx, EVENT_ALL);
 
-		perf_ctx_enable(ctx);
+		perf_ctx_enable(ctx, false);
 		raw_spin_unlock(&ctx->lock);
 	}
 }
@@ -3818,7 +3852,8 @@ static int merge_sched_in(struct perf_event *event, void *data)
 	return 0;
 }
 
-static void ctx_pinned_sched_in(struct perf_event_context *ctx, struct pmu *pmu)
+static void ctx_pinned_sched_in(struct perf_event_context *ctx, struct pmu *pmu,
+				bool cgroup)
 {
 	struct perf_event_pmu_context *pmu_ctx;
 	int can_add_hw = 1;
@@ -3828,7 +3863,7 @@ static void ctx_pinned_sched_in(struct perf_event_context *ctx, struct pmu *pmu)
 				   smp_processor_id(), pmu,
 				   merge_sched_in, &can_add_hw);
 	} else {
-		list_for_each_entry(pmu_ctx, &ctx->pmu_ctx_list, pmu_ctx_entry) {
+		for_each_epc(pmu_ctx, ctx, cgroup) {
 			can_add_hw = 1;
 			visit_groups_merge(ctx, &ctx->pinned_groups,
 					   smp_processor_id(), pmu_ctx->pmu,
@@ -3837,7 +3872,8 @@ static void ctx_pinned_sched_in(struct perf_event_context *ctx, struct pmu *pmu)
 	}
 }
 
-static void ctx_flexible_sched_in(struct perf_event_context *ctx, struct pmu *pmu)
+static void ctx_flexible_sched_in(struct perf_event_context *ctx, struct pmu *pmu,
+				  bool cgroup)
 {
 	struct perf_event_pmu_context *pmu_ctx;
 	int can_add_hw = 1;
@@ -3847,7 +3883,7 @@ static void ctx_flexible_sched_in(struct perf_event_context *ctx, struct pmu *pm
 				   smp_processor_id(), pmu,
 				   merge_sched_in, &can_add_hw);
 	} else {
-		list_for_each_entry(pmu_ctx, &ctx->pmu_ctx_list, pmu_ctx_entry) {
+		for_each_epc(pmu_ctx, ctx, cgroup) {
 			can_add_hw = 1;
 			visit_groups_merge(ctx, &ctx->flexible_groups,
 					   smp_processor_id(), pmu_ctx->pmu,
@@ -3858,7 +3894,7 @@ static void ctx_flexible_sched_in(struct perf_event_context *ctx, struct pmu *pm
 
 static void __pmu_ctx_sched_in(struct perf_event_context *ctx, struct pmu *pmu)
 {
-	ctx_flexible_sched_in(ctx, pmu);
+	ctx_flexible_sched_in(ctx, pmu, false);
 }
 
 static void
@@ -3866,6 +3902,9 @@ ctx_sched_in(struct perf_event_context *ctx, enum event_type_t event_type)
 {
 	struct perf_cpu_context *cpuctx = this_cpu_ptr(&perf_cpu_context);
 	int is_active = ctx->is_active;
+	bool cgroup = event_type & EVENT_CGROUP;
+
+	event_type &= ~EVENT_FLAGS;
 
 	lockdep_assert_held(&ctx->lock);
 
@@ -3898,11 +3937,11 @@ ctx_sched_in(struct perf_event_context *ctx, enum event_type_t event_type)
 	 * in order to give them the best chance of going on.
 	 */
 	if (is_active & EVENT_PINNED)
-		ctx_pinned_sched_in(ctx, NULL);
+		ctx_pinned_sched_in(ctx, NULL, cgroup);
 
 	/* Then walk through the lower prio flexible groups */
 	if (is_active & EVENT_FLEXIBLE)
-		ctx_flexible_sched_in(ctx, NULL);
+		ctx_flexible_sched_in(ctx, NULL, cgroup);
 }
 
 static void perf_event_context_sched_in(struct task_struct *task)
@@ -3917,11 +3956,11 @@ static void perf_event_context_sched_in(struct task_struct *task)
 
 	if (cpuctx->task_ctx == ctx) {
 		perf_ctx_lock(cpuctx, ctx);
-		perf_ctx_disable(ctx);
+		perf_ctx_disable(ctx, false);
 
 		perf_ctx_sched_task_cb(ctx, true);
 
-		perf_ctx_enable(ctx);
+		perf_ctx_enable(ctx, false);
 		perf_ctx_unlock(cpuctx, ctx);
 		goto rcu_unlock;
 	}
@@ -3934,7 +3973,7 @@ static void perf_event_context_sched_in(struct task_struct *task)
 	if (!ctx->nr_events)
 		goto unlock;
 
-	perf_ctx_disable(ctx);
+	perf_ctx_disable(ctx, false);
 	/*
 	 * We want to keep the following priority order:
 	 * cpu pinned (that don't need to move), task pinned,
@@ -3944,7 +3983,7 @@ static void perf_event_context_sched_in(struct task_struct *task)
 	 * events, no need to flip the cpuctx's events around.
 	 */
 	if (!RB_EMPTY_ROOT(&ctx->pinned_groups.tree)) {
-		perf_ctx_disable(&cpuctx->ctx);
+		perf_ctx_disable(&cpuctx->ctx, false);
 		ctx_sched_out(&cpuctx->ctx, EVENT_FLEXIBLE);
 	}
 
@@ -3953,9 +3992,9 @@ static void perf_event_context_sched_in(struct task_struct *task)
 	perf_ctx_sched_task_cb(cpuctx->task_ctx, true);
 
 	if (!RB_EMPTY_ROOT(&ctx->pinned_groups.tree))
-		perf_ctx_enable(&cpuctx->ctx);
+		perf_ctx_enable(&cpuctx->ctx, false);
 
-	perf_ctx_enable(ctx);
+	perf_ctx_enable(ctx, false);
 
 unlock:
 	perf_ctx_unlock(cpuctx, ctx);
@@ -5169,6 +5208,7 @@ static void _free_event(struct perf_event *event)
 	perf_event_free_bpf_prog(event);
 	perf_addr_filters_splice(event, NULL);
 	kfree(event->addr_filter_ranges);
+	kvfree(event->sample_aggr);
 
 	if (event->destroy)
 		event->destroy(event);
@@ -5610,6 +5650,7 @@ perf_read(struct file *file, char __user *buf, size_t count, loff_t *ppos)
 		return ret;
 
 	ctx = perf_event_ctx_lock(event);
+	perf_event_aggr_sync(event);
 	ret = __perf_read(event, buf, count);
 	perf_event_ctx_unlock(event, ctx);
 
@@ -5811,6 +5852,7 @@ static long _perf_ioctl(struct perf_event *event, unsigned int cmd, unsigned lon
 		func = _perf_event_disable;
 		break;
 	case PERF_EVENT_IOC_RESET:
+		perf_event_aggr_sync(event);
 		func = _perf_event_reset;
 		break;
 
@@ -7801,6 +7843,230 @@ perf_event_output(struct perf_event *event,
 	return __perf_event_output(event, data, regs, perf_output_begin);
 }
 
+/*
+ * In-kernel aggregation of callchain samples, see
+ * perf_event_attr::aggregate_callchain.
+ *
+ * Samples are counted per (pid, tid, callchain) in a small direct-mapped
+ * table of the event. An entry is written out as PERF_RECORD_SAMPLE_AGGR
+ * when another callchain evicts it, once it has been counting for
+ * PERF_AGGR_FLUSH_NS, on read() and PERF_EVENT_IOC_RESET, and when the event
+ * is disabled or removed. Each sample also checks one other entry in turn,
+ * so a callchain that is not hit again still gets written out in time.
+ *
+ * The table is used by the overflow handler, and by perf_aggr_flush() either
+ * with the event scheduled out or from an IPI on the CPU of the event. 'busy'
+ * keeps them apart: an overflow that nests inside another user of the table,
+ * e.g. from NMI, writes a regular sample instead, and an IPI that interrupts
+ * the overflow handler leaves the table alone.
+ */
+#define PERF_AGGR_ENTRIES	64
+#define PERF_AGGR_MAX_IPS	64
+#define PERF_AGGR_FLUSH_NS	NSEC_PER_SEC
+
+struct perf_aggr_entry {
+	u64		count;
+	u64		period;
+	u64		start;
+	u32		hash;
+	u32		pid;
+	u32		tid;
+	u32		nr;
+	u64		ip[PERF_AGGR_MAX_IPS];
+};
+
+struct perf_sample_aggr {
+	struct perf_aggr_entry	entries[PERF_AGGR_ENTRIES];
+	unsigned int		scan;
+	int			busy;
+};
+
+static void perf_aggr_output(struct perf_event *event,
+			     struct perf_aggr_entry *ent)
+{
+	struct perf_output_handle handle;
+	struct perf_sample_data sample;
+	int ret;
+
+	struct {
+		struct perf_event_header	header;
+		u32				pid;
+		u32				tid;
+		u64				count;
+		u64				period;
+		u64				nr;
+	} aggr_event = {
+		.header = {
+			.type = PERF_RECORD_SAMPLE_AGGR,
+			.misc = 0,
+			.size = sizeof(aggr_event) + ent->nr * sizeof(u64),
+		},
+		.pid	= ent->pid,
+		.tid	= ent->tid,
+		.count	= ent->count,
+		.period	= ent->period,
+		.nr	= ent->nr,
+	};
+
+	ent->count = 0;
+
+	perf_event_header__init_id(&aggr_event.header, &sample, event);
+	/* A flush may run from another task, report the sampled one */
+	if (event->attr.sample_type & PERF_SAMPLE_TID) {
+		sample.tid_entry.pid = ent->pid;
+		sample.tid_entry.tid = ent->tid;
+	}
+
+	ret = perf_output_begin(&handle, &sample, event,
+				aggr_event.header.size);
+	if (ret)
+		return;
+
+	perf_output_put(&handle, aggr_event);
+	perf_output_copy(&handle, ent->ip, ent->nr * sizeof(u64));
+	perf_event__output_id_sample(event, &handle, &sample);
+	perf_output_end(&handle);
+}
+
+static void perf_aggr_flush(struct perf_event *event)
+{
+	struct perf_sample_aggr *aggr = event->sample_aggr;
+	int i;
+
+	if (!aggr)
+		return;
+
+	for (i = 0; i < PERF_AGGR_ENTRIES; i++) {
+		if (aggr->entries[i].count)
+			perf_aggr_output(event, &aggr->entries[i]);
+	}
+}
+
+static void perf_aggr_sync_one(struct perf_event *event)
+{
+	struct perf_sample_aggr *aggr = event->sample_aggr;
+
+	/* We interrupted the overflow handler, the table is in use */
+	if (!aggr || READ_ONCE(aggr->busy))
+		return;
+
+	WRITE_ONCE(aggr->busy, 1);
+	barrier();
+	perf_aggr_flush(event);
+	barrier();
+	WRITE_ONCE(aggr->busy, 0);
+}
+
+static void __perf_aggr_sync(struct perf_event *event,
+			     struct perf_cpu_context *cpuctx,
+			     struct perf_event_context *ctx,
+			     void *info)
+{
+	struct perf_event *sibling;
+
+	perf_aggr_sync_one(event);
+
+	if (event == event->group_leader &&
+	    (event->attr.read_format & PERF_FORMAT_GROUP)) {
+		for_each_sibling_event(sibling, event)
+			perf_aggr_sync_one(sibling);
+	}
+}
+
+/*
+ * Write out the samples aggregated so far, so that they are in the buffer
+ * by the time read() returns the counts they add up to.
+ */
+static void perf_event_aggr_sync(struct perf_event *event)
+{
+	struct perf_event *sibling;
+	bool aggr = !!event->sample_aggr;
+
+	if (event == event->group_leader &&
+	    (event->attr.read_format & PERF_FORMAT_GROUP)) {
+		for_each_sibling_event(sibling, event)
+			aggr |= !!sibling->sample_aggr;
+	}
+
+	if (aggr)
+		event_function_call(event, __perf_aggr_sync, NULL);
+}
+
+static void perf_event_aggr_output(struct perf_event *event,
+				   struct perf_sample_data *data,
+				   struct pt_regs *regs)
+{
+	struct perf_sample_aggr *aggr = event->sample_aggr;
+	struct perf_callchain_entry *callchain;
+	struct perf_aggr_entry *ent;
+	struct perf_aggr_entry *stale;
+	u32 pid, tid, hash;
+	u64 now;
+
+	if (READ_ONCE(aggr->busy)) {
+		perf_event_output(event, data, regs);
+		return;
+	}
+	WRITE_ONCE(aggr->busy, 1);
+	barrier();
+
+	rcu_read_lock();
+
+	if (data->sample_flags & PERF_SAMPLE_CALLCHAIN)
+		callchain = data->callchain;
+	else
+		callchain = perf_callchain(event, regs);
+
+	if (callchain->nr > PERF_AGGR_MAX_IPS) {
+		rcu_read_unlock();
+
+		/* Too deep to be aggregated, write a regular sample */
+		data->callchain = callchain;
+		data->sample_flags |= PERF_SAMPLE_CALLCHAIN;
+		perf_event_output(event, data, regs);
+		goto out;
+	}
+
+	pid = perf_event_pid(event, current);
+	tid = perf_event_tid(event, current);
+	hash = jhash2((u32 *)callchain->ip,
+		      callchain->nr * (sizeof(u64) / sizeof(u32)),
+		      jhash_2words(pid, tid, 0));
+	ent = &aggr->entries[hash % PERF_AGGR_ENTRIES];
+	now = perf_event_clock(event);
+
+	if (ent->count &&
+	    (ent->hash != hash || ent->pid != pid || ent->tid != tid ||
+	     ent->nr != callchain->nr ||
+	     memcmp(ent->ip, callchain->ip, callchain->nr * sizeof(u64))))
+		perf_aggr_output(event, ent);
+
+	if (!ent->count) {
+		ent->hash = hash;
+		ent->pid = pid;
+		ent->tid = tid;
+		ent->nr = callchain->nr;
+		memcpy(ent->ip, callchain->ip, callchain->nr * sizeof(u64));
+		ent->period = 0;
+		ent->start = now;
+	}
+
+	ent->count++;
+	ent->period += data->period;
+
+	if (now - ent->start >= PERF_AGGR_FLUSH_NS)
+		perf_aggr_output(event, ent);
+
+	stale = &aggr->entries[aggr->scan++ % PERF_AGGR_ENTRIES];
+	if (stale->count && now - stale->start >= PERF_AGGR_FLUSH_NS)
+		perf_aggr_output(event, stale);
+
+	rcu_read_unlock();
+out:
+	barrier();
+	WRITE_ONCE(aggr->busy, 0);
+}
+
 /*
  * read event_id
  */
@@ -11865,6 +12131,9 @@ perf_event_alloc(struct perf_event_attr *attr, int cpu,
 	if (overflow_handler) {
 		event->overflow_handler	= overflow_handler;
 		event->overflow_handler_context = context;
+	} else if (attr->aggregate_callchain) {
+		event->overflow_handler = perf_event_aggr_output;
+		event->overflow_handler_context = NULL;
 	} else if (is_write_backward(event)){
 		event->overflow_handler = perf_event_output_backward;
 		event->overflow_handler_context = NULL;
@@ -11962,15 +12231,25 @@ perf_event_alloc(struct perf_event_attr *attr, int cpu,
 		}
 	}
 
+	if (attr->aggregate_callchain) {
+		err = -ENOMEM;
+		event->sample_aggr = kvzalloc_node(sizeof(*event->sample_aggr),
+						   GFP_KERNEL, node);
+		if (!event->sample_aggr)
+			goto err_callchain_buffer;
+	}
+
 	err = security_perf_event_alloc(event);
 	if (err)
-		goto err_callchain_buffer;
+		goto err_sample_aggr;
 
 	/* symmetric to unaccount_event() in _free_event() */
 	account_event(event);
 
 	return event;
 
+err_sample_aggr:
+	kvfree(event->sample_aggr);
 err_callchain_buffer:
 	if (!event->parent) {
 		if (event->attr.sample_type & PERF_SAMPLE_CALLCHAIN)
@@ -12113,6 +12392,10 @@ static int perf_copy_attr(struct perf_event_attr __user *uattr,
 	if (attr->sigtrap && !attr->remove_on_exec)
 		return -EINVAL;
 
+	if (attr->aggregate_callchain &&
+	    !(attr->sample_type & PERF_SAMPLE_CALLCHAIN))
+		return -EINVAL;
+
 out:
 	return ret;
 
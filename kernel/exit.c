@@ -119,14 +119,15 @@ static __init int kernel_exit_sysfs_init(void)
 late_initcall(kernel_exit_sysfs_init);
 #endif
 
-static void __unhash_process(struct task_struct *p, bool group_dead)
+static void __unhash_process(struct pid **pids, struct task_struct *p,
+			     bool group_dead)
 {
 	nr_threads--;
-	detach_pid(p, PIDTYPE_PID);
+	detach_pid(pids, p, PIDTYPE_PID);
 	if (group_dead) {
-		detach_pid(p, PIDTYPE_TGID);
-		detach_pid(p, PIDTYPE_PGID);
-		detach_pid(p, PIDTYPE_SID);
+		detach_pid(pids, p, PIDTYPE_TGID);
+		detach_pid(pids, p, PIDTYPE_PGID);
+		detach_pid(pids, p, PIDTYPE_SID);
 
 		list_del_rcu(&p->tasks);
 		list_del_init(&p->sibling);
@@ -137,9 +138,10 @@ static void __unhash_process(struct task_struct *p, bool group_dead)
 }
 
 /*
- * This function expects the tasklist_lock write-locked.
+ * This function expects the tasklist_lock write-locked. The pids which are
+ * no longer used are returned in @pids.
  */
-static void __exit_signal(struct task_struct *tsk)
+static void __exit_signal(struct pid **pids, struct task_struct *tsk)
 {
 	struct signal_struct *sig = tsk->signal;
 	bool group_dead = thread_group_leader(tsk);
@@ -172,9 +174,6 @@ static void __exit_signal(struct task_struct *tsk)
 			sig->curr_target = next_thread(tsk);
 	}
 
-	add_device_randomness((const void*) &tsk->se.sum_exec_runtime,
-			      sizeof(unsigned long long));
-
 	/*
 	 * Accumulate here the counters for all threads as they die. We could
 	 * skip the group leader because it is the last user of signal_struct,
@@ -195,7 +194,7 @@ static void __exit_signal(struct task_struct *tsk)
 	task_io_accounting_add(&sig->ioac, &tsk->ioac);
 	sig->sum_sched_runtime += tsk->se.sum_exec_runtime;
 	sig->nr_threads--;
-	__unhash_process(tsk, group_dead);
+	__unhash_process(pids, tsk, group_dead);
 	write_sequnlock(&sig->stats_lock);
 
 	/*
@@ -237,10 +236,13 @@ void __weak release_thread(struct task_struct *dead_task)
 
 void release_task(struct task_struct *p)
 {
+	struct pid *pids[PIDTYPE_MAX];
 	struct task_struct *leader;
 	struct pid *thread_pid;
 	int zap_leader;
 repeat:
+	memset(pids, 0, sizeof(pids));
+
 	/* don't need to get the RCU readlock here - the process is dead and
 	 * can't be modifying its own credentials. But shut RCU-lockdep up */
 	rcu_read_lock();
@@ -252,7 +254,7 @@ repeat:
 	write_lock_irq(&tasklist_lock);
 	ptrace_release_task(p);
 	thread_pid = get_pid(p->thread_pid);
-	__exit_signal(p);
+	__exit_signal(pids, p);
 
 	/*
 	 * If we are the last non-leader member of the thread
@@ -274,6 +276,14 @@ repeat:
 	}
 
 	write_unlock_irq(&tasklist_lock);
+
+	/*
+	 * Everything below does not need tasklist_lock; keeping it out of
+	 * the critical section matters when many tasks exit at once.
+	 */
+	free_pids(pids);
+	add_device_randomness((const void*) &p->se.sum_exec_runtime,
+			      sizeof(unsigned long long));
 	seccomp_filter_release(p);
 	proc_flush_pid(thread_pid);
 	put_pid(thread_pid);
@@ -53,6 +53,19 @@ static struct {
 #define futex_queues   (__futex_data.queues)
 #define futex_hashsize (__futex_data.hashsize)
 
+/*
+ * PROCESS_PRIVATE futexes can only ever be matched by tasks sharing the mm,
+ * so a multi-threaded process hashes them into buckets of its own instead of
+ * contending on the global hash with every other process in the system.
+ */
+struct futex_private_hash {
+	unsigned long			hashsize;
+	struct futex_hash_bucket	queues[];
+};
+
+/* Buckets per private hash, 0 if private hashes are disabled */
+static unsigned long futex_private_hashsize __read_mostly;
+
 
 /*
  * Fault injections for futexes.
@@ -105,18 +118,84 @@ late_initcall(fail_futex_debugfs);
 
 #endif /* CONFIG_FAIL_FUTEX */
 
+static void futex_hash_init(struct futex_hash_bucket *queues,
+			    unsigned long hashsize)
+{
+	unsigned long i;
+
+	for (i = 0; i < hashsize; i++) {
+		atomic_set(&queues[i].waiters, 0);
+		plist_head_init(&queues[i].chain);
+		spin_lock_init(&queues[i].lock);
+	}
+}
+
+void futex_mm_init(struct mm_struct *mm)
+{
+	mm->futex_phash = NULL;
+}
+
+/**
+ * futex_private_hash_alloc - Allocate the private futex hash of an mm
+ * @mm:		The mm which is about to be shared by another task
+ *
+ * Called when a task is cloned with CLONE_VM. Until then the mm has a single
+ * user whose private futexes live in the global hash; nobody else can be
+ * waiting on them, so switching to the private hash here is safe. Once
+ * allocated, the private hash stays until the mm is freed.
+ *
+ * Return: 0 on success, -ENOMEM if the hash could not be allocated.
+ */
+int futex_private_hash_alloc(struct mm_struct *mm)
+{
+	struct futex_private_hash *fph;
+
+	if (!futex_private_hashsize || READ_ONCE(mm->futex_phash))
+		return 0;
+
+	fph = kvmalloc(struct_size(fph, queues, futex_private_hashsize),
+		       GFP_KERNEL_ACCOUNT);
+	if (!fph)
+		return -ENOMEM;
+
+	fph->hashsize = futex_private_hashsize;
+	futex_hash_init(fph->queues, fph->hashsize);
+
+	/* Pairs with the smp_load_acquire() in futex_hash() */
+	if (cmpxchg_release(&mm->futex_phash, NULL, fph))
+		kvfree(fph);
+
+	return 0;
+}
+
+void futex_private_hash_free(struct mm_struct *mm)
+{
+	kvfree(mm->futex_phash);
+	mm->futex_phash = NULL;
+}
+
 /**
- * futex_hash - Return the hash bucket in the global hash
+ * futex_hash - Return the hash bucket in the global or private hash
  * @key:	Pointer to the futex key for which the hash is calculated
  *
  * We hash on the keys returned from get_futex_key (see below) and return the
- * corresponding hash bucket in the global hash.
+ * corresponding hash bucket, in the private hash of the mm for
+ * PROCESS_PRIVATE futexes of a multi-threaded process and in the global hash
+ * otherwise.
  */
 struct futex_hash_bucket *futex_hash(union futex_key *key)
 {
 	u32 hash = jhash2((u32 *)key, offsetof(typeof(*key), both.offset) / 4,
 			  key->both.offset);
 
+	if (!(key->both.offset & (FUT_OFF_INODE | FUT_OFF_MMSHARED))) {
+		struct futex_private_hash *fph;
+
+		fph = smp_load_acquire(&key->private.mm->futex_phash);
+		if (fph)
+			return &fph->queues[hash & (fph->hashsize - 1)];
+	}
+
 	return &futex_queues[hash & (futex_hashsize - 1)];
 }
 
@@ -1123,7 +1202,6 @@ void futex_exit_release(struct task_struct *tsk)
 static int __init futex_init(void)
 {
 	unsigned int futex_shift;
-	unsigned long i;
 
 #if CONFIG_BASE_SMALL
 	futex_hashsize = 16;
@@ -1138,11 +1216,17 @@ static int __init futex_init(void)
 					       futex_hashsize, futex_hashsize);
 	futex_hashsize = 1UL << futex_shift;
 
-	for (i = 0; i < futex_hashsize; i++) {
-		atomic_set(&futex_queues[i].waiters, 0);
-		plist_head_init(&futex_queues[i].chain);
-		spin_lock_init(&futex_queues[i].lock);
-	}
+	futex_hash_init(futex_queues, futex_hashsize);
+
+#if !CONFIG_BASE_SMALL
+	/*
+	 * Enough buckets for the threads of a process to spread their
+	 * futexes over, without making every multi-threaded process pay for
+	 * a hash sized like the global one.
+	 */
+	futex_private_hashsize = clamp(roundup_pow_of_two(4 * num_possible_cpus()),
+				       16UL, 256UL);
+#endif
 
 	return 0;
 }
@@ -49,6 +49,15 @@ LOCK_EVENT(lock_use_node4)	/* # of locking ops that use 4th percpu node */
 LOCK_EVENT(lock_no_node)	/* # of locking ops w/o using percpu node    */
 #endif /* CONFIG_QUEUED_SPINLOCKS */
 
+/*
+ * Locking events for mutex and the optimistic spin queue
+ */
+LOCK_EVENT(mutex_opt_lock)	/* # of opt-acquired mutexes		*/
+LOCK_EVENT(mutex_opt_fail)	/* # of failed mutex optspins		*/
+LOCK_EVENT(mutex_sleep)		/* # of mutex waiter sleeps		*/
+LOCK_EVENT(mutex_handoff)	/* # of mutex handoffs			*/
+LOCK_EVENT(osq_unqueue)		/* # of spinners leaving the OSQ early	*/
+
 /*
  * Locking events for rwsem
  */
@@ -61,6 +70,7 @@ LOCK_EVENT(rwsem_opt_fail)	/* # of failed optspins			*/
 LOCK_EVENT(rwsem_opt_nospin)	/* # of disabled optspins		*/
 LOCK_EVENT(rwsem_rlock)		/* # of read locks acquired		*/
 LOCK_EVENT(rwsem_rlock_steal)	/* # of read locks by lock stealing	*/
+LOCK_EVENT(rwsem_rlock_spin)	/* # of read locks by reader optspin	*/
 LOCK_EVENT(rwsem_rlock_fast)	/* # of fast read locks acquired	*/
 LOCK_EVENT(rwsem_rlock_fail)	/* # of failed read lock acquisitions	*/
 LOCK_EVENT(rwsem_rlock_handoff)	/* # of read lock handoffs		*/
@@ -35,6 +35,7 @@
 
 #ifndef CONFIG_PREEMPT_RT
 #include "mutex.h"
+#include "lock_events.h"
 
 #ifdef CONFIG_DEBUG_MUTEXES
 # define MUTEX_WARN_ON(cond) DEBUG_LOCKS_WARN_ON(cond)
@@ -488,6 +489,7 @@ mutex_optimistic_spin(struct mutex *lock, struct ww_acquire_ctx *ww_ctx,
 	if (!waiter)
 		osq_unlock(&lock->osq);
 
+	lockevent_inc(mutex_opt_lock);
 	return true;
 
 
@@ -496,6 +498,7 @@ fail_unlock:
 		osq_unlock(&lock->osq);
 
 fail:
+	lockevent_inc(mutex_opt_fail);
 	/*
 	 * If we fell out of the spin path because of need_resched(),
 	 * reschedule now, before we try-lock the mutex. This avoids getting
@@ -676,6 +679,7 @@ __mutex_lock_common(struct mutex *lock, unsigned int state, unsigned int subclas
 		}
 
 		raw_spin_unlock(&lock->wait_lock);
+		lockevent_inc(mutex_sleep);
 		schedule_preempt_disabled();
 
 		first = __mutex_waiter_is_first(lock, &waiter);
@@ -943,8 +947,10 @@ static noinline void __sched __mutex_unlock_slowpath(struct mutex *lock, unsigne
 		wake_q_add(&wake_q, next);
 	}
 
-	if (owner & MUTEX_FLAG_HANDOFF)
+	if (owner & MUTEX_FLAG_HANDOFF) {
 		__mutex_handoff(lock, next);
+		lockevent_inc(mutex_handoff);
+	}
 
 	raw_spin_unlock(&lock->wait_lock);
 
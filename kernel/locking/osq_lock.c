@@ -3,6 +3,8 @@
 #include <linux/sched.h>
 #include <linux/osq_lock.h>
 
+#include "lock_events.h"
+
 /*
  * An MCS like lock especially tailored for optimistic spinning for sleeping
  * lock implementations (mutex, rwsem, etc).
@@ -145,6 +147,7 @@ bool osq_lock(struct optimistic_spin_queue *lock)
 		return true;
 
 	/* unqueue */
+	lockevent_inc(osq_unqueue);
 	/*
 	 * Step - A  -- stabilize @prev
 	 *
@@ -942,6 +942,55 @@ done:
 	return taken;
 }
 
+/*
+ * Spin as a reader while a writer holds the lock and is running. The reader
+ * bias is already in the count, so the read lock is ours as soon as the
+ * writer releases it, unless a writer waiter has asked for a handoff in the
+ * meantime.
+ */
+static bool rwsem_reader_spin(struct rw_semaphore *sem)
+{
+	bool taken = false;
+	long count;
+
+	preempt_disable();
+
+	/* Let only one reader poll the owner, the others would just queue */
+	if (!osq_lock(&sem->osq))
+		goto done;
+
+	for (;;) {
+		enum owner_state owner_state;
+
+		count = atomic_long_read(&sem->count);
+		if (!(count & RWSEM_WRITER_LOCKED)) {
+			taken = !(count & RWSEM_FLAG_HANDOFF);
+			break;
+		}
+
+		owner_state = rwsem_spin_on_owner(sem);
+		if (!(owner_state & OWNER_SPINNABLE))
+			break;
+
+		/* See rwsem_optimistic_spin() for RT tasks and a NULL owner */
+		if (owner_state != OWNER_WRITER &&
+		    (need_resched() || rt_task(current)))
+			break;
+
+		cpu_relax();
+	}
+	osq_unlock(&sem->osq);
+done:
+	preempt_enable();
+
+	if (taken) {
+		/* Provide lock ACQUIRE */
+		smp_acquire__after_ctrl_dep();
+		lockevent_inc(rwsem_rlock_spin);
+	}
+	return taken;
+}
+
 /*
  * Clear the owner's RWSEM_NONSPINNABLE bit if it is set. This should
  * only be called when the reader count reaches 0.
@@ -963,6 +1012,11 @@ static inline bool rwsem_optimistic_spin(struct rw_semaphore *sem)
 	return false;
 }
 
+static inline bool rwsem_reader_spin(struct rw_semaphore *sem)
+{
+	return false;
+}
+
 static inline void clear_nonspinnable(struct rw_semaphore *sem) { }
 
 static inline enum owner_state
@@ -1039,6 +1093,16 @@ rwsem_down_read_slowpath(struct rw_semaphore *sem, long count, unsigned int stat
 		return sem;
 	}
 
+	/*
+	 * Spin on a running writer, but only while nobody is queued so that
+	 * spinning readers can't starve the waiters.
+	 */
+	if ((count & RWSEM_WRITER_LOCKED) && !(count & RWSEM_FLAG_WAITERS) &&
+	    rwsem_can_spin_on_owner(sem) && rwsem_reader_spin(sem)) {
+		rwsem_set_reader_owned(sem);
+		return sem;
+	}
+
 queue:
 	waiter.task = current;
 	waiter.type = RWSEM_WAITING_FOR_READ;
@@ -123,13 +123,12 @@ static void delayed_put_pid(struct rcu_head *rhp)
 	put_pid(pid);
 }
 
-void free_pid(struct pid *pid)
+static void __free_pid(struct pid *pid)
 {
-	/* We can be called with write_lock_irq(&tasklist_lock) held */
 	int i;
-	unsigned long flags;
 
-	spin_lock_irqsave(&pidmap_lock, flags);
+	lockdep_assert_held(&pidmap_lock);
+
 	for (i = 0; i <= pid->level; i++) {
 		struct upid *upid = pid->numbers + i;
 		struct pid_namespace *ns = upid->ns;
@@ -151,11 +150,43 @@ void free_pid(struct pid *pid)
 
 		idr_remove(&ns->idr, upid->nr);
 	}
+}
+
+void free_pid(struct pid *pid)
+{
+	/* We can be called with write_lock_irq(&tasklist_lock) held */
+	unsigned long flags;
+
+	spin_lock_irqsave(&pidmap_lock, flags);
+	__free_pid(pid);
 	spin_unlock_irqrestore(&pidmap_lock, flags);
 
 	call_rcu(&pid->rcu, delayed_put_pid);
 }
 
+/**
+ * free_pids - free the pids collected by detach_pid()
+ * @pids: array of PIDTYPE_MAX entries, NULL entries are skipped
+ *
+ * Takes pidmap_lock once for all of them. Meant to be called after
+ * tasklist_lock has been dropped.
+ */
+void free_pids(struct pid **pids)
+{
+	unsigned long flags;
+	int type;
+
+	spin_lock_irqsave(&pidmap_lock, flags);
+	for (type = 0; type < PIDTYPE_MAX; type++)
+		if (pids[type])
+			__free_pid(pids[type]);
+	spin_unlock_irqrestore(&pidmap_lock, flags);
+
+	for (type = 0; type < PIDTYPE_MAX; type++)
+		if (pids[type])
+			call_rcu(&pids[type]->rcu, delayed_put_pid);
+}
+
 struct pid *alloc_pid(struct pid_namespace *ns, pid_t *set_tid,
 		      size_t set_tid_size)
 {
@@ -334,8 +365,8 @@ void attach_pid(struct task_struct *task, enum pid_type type)
 	hlist_add_head_rcu(&task->pid_links[type], &pid->tasks[type]);
 }
 
-static void __change_pid(struct task_struct *task, enum pid_type type,
-			struct pid *new)
+static void __change_pid(struct pid **pids, struct task_struct *task,
+			 enum pid_type type, struct pid *new)
 {
 	struct pid **pid_ptr = task_pid_ptr(task, type);
 	struct pid *pid;
@@ -350,18 +381,28 @@ static void __change_pid(struct task_struct *task, enum pid_type type,
 		if (pid_has_task(pid, tmp))
 			return;
 
-	free_pid(pid);
+	if (pids) {
+		WARN_ON(pids[type]);
+		pids[type] = pid;
+	} else {
+		free_pid(pid);
+	}
 }
 
-void detach_pid(struct task_struct *task, enum pid_type type)
+/*
+ * A pid which lost its last task is not freed here but stored in @pids, to
+ * be released by free_pids() outside of tasklist_lock.
+ */
+void detach_pid(struct pid **pids, struct task_struct *task,
+		enum pid_type type)
 {
-	__change_pid(task, type, NULL);
+	__change_pid(pids, task, type, NULL);
 }
 
 void change_pid(struct task_struct *task, enum pid_type type,
 		struct pid *pid)
 {
-	__change_pid(task, type, pid);
+	__change_pid(NULL, task, type, pid);
 	attach_pid(task, type);
 }
 
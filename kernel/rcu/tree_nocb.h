@@ -1457,12 +1457,14 @@ static void rcu_spawn_cpu_nocb_kthread(int cpu)
 	rdp_gp = rdp->nocb_gp_rdp;
 	mutex_lock(&rdp_gp->nocb_gp_kthread_mutex);
 	if (!rdp_gp->nocb_gp_kthread) {
-		t = kthread_run(rcu_nocb_gp_kthread, rdp_gp,
-				"rcuog/%d", rdp_gp->cpu);
+		t = kthread_create_on_node(rcu_nocb_gp_kthread, rdp_gp,
+					   cpu_to_node(rdp_gp->cpu),
+					   "rcuog/%d", rdp_gp->cpu);
 		if (WARN_ONCE(IS_ERR(t), "%s: Could not start rcuo GP kthread, OOM is now expected behavior\n", __func__)) {
 			mutex_unlock(&rdp_gp->nocb_gp_kthread_mutex);
 			goto end;
 		}
+		wake_up_process(t);
 		WRITE_ONCE(rdp_gp->nocb_gp_kthread, t);
 		if (kthread_prio)
 			sched_setscheduler_nocheck(t, SCHED_FIFO, &sp);
@@ -1470,10 +1472,11 @@ static void rcu_spawn_cpu_nocb_kthread(int cpu)
 	mutex_unlock(&rdp_gp->nocb_gp_kthread_mutex);
 
 	/* Spawn the kthread for this CPU. */
-	t = kthread_run(rcu_nocb_cb_kthread, rdp,
-			"rcuo%c/%d", rcu_state.abbr, cpu);
+	t = kthread_create_on_node(rcu_nocb_cb_kthread, rdp, cpu_to_node(cpu),
+				   "rcuo%c/%d", rcu_state.abbr, cpu);
 	if (WARN_ONCE(IS_ERR(t), "%s: Could not start rcuo CB kthread, OOM is now expected behavior\n", __func__))
 		goto end;
+	wake_up_process(t);
 
 	if (IS_ENABLED(CONFIG_RCU_NOCB_CPU_CB_BOOST) && kthread_prio)
 		sched_setscheduler_nocheck(t, SCHED_FIFO, &sp);
@@ -1494,8 +1497,15 @@ end:
 static int rcu_nocb_gp_stride = -1;
 module_param(rcu_nocb_gp_stride, int, 0444);
 
+/* Keep each GP kthread's CB CPU IDs within a single NUMA node? */
+static bool rcu_nocb_gp_numa = true;
+module_param(rcu_nocb_gp_numa, bool, 0444);
+
 /*
- * Initialize GP-CB relationships for all no-CBs CPU.
+ * Initialize GP-CB relationships for all no-CBs CPU.  Unless
+ * rcu_nocb_gp_numa is cleared, a group is also cut short where the CPU
+ * IDs cross into another NUMA node, so that an rcuog kthread never has
+ * to touch the callback lists of CPUs on a remote node.
  */
 static void __init rcu_organize_nocb_kthreads(void)
 {
@@ -1505,6 +1515,7 @@ static void __init rcu_organize_nocb_kthreads(void)
 	bool gotnocbscbs = true;
 	int ls = rcu_nocb_gp_stride;
 	int nl = 0;  /* Next GP kthread. */
+	int node = NUMA_NO_NODE;  /* Node of current GP kthread. */
 	struct rcu_data *rdp;
 	struct rcu_data *rdp_gp = NULL;  /* Suppress misguided gcc warn. */
 
@@ -1522,10 +1533,12 @@ static void __init rcu_organize_nocb_kthreads(void)
 	 */
 	for_each_possible_cpu(cpu) {
 		rdp = per_cpu_ptr(&rcu_data, cpu);
-		if (rdp->cpu >= nl) {
+		if (rdp->cpu >= nl ||
+		    (rcu_nocb_gp_numa && cpu_to_node(cpu) != node)) {
 			/* New GP kthread, set up for CBs & next GP. */
 			gotnocbs = true;
 			nl = DIV_ROUND_UP(rdp->cpu + 1, ls) * ls;
+			node = cpu_to_node(cpu);
 			rdp_gp = rdp;
 			INIT_LIST_HEAD(&rdp->nocb_head_rdp);
 			if (dump_tree) {
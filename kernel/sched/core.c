@@ -4457,6 +4457,7 @@ static void __sched_fork(unsigned long clone_flags, struct task_struct *p)
 	p->capture_control = NULL;
 #endif
 	init_numa_balancing(clone_flags, p);
+	init_sched_mm(p);
 #ifdef CONFIG_SMP
 	p->wake_entry.u_flags = CSD_TYPE_TTWU;
 	p->migration_pending = NULL;
@@ -4677,6 +4678,9 @@ int sched_fork(unsigned long clone_flags, struct task_struct *p)
 		} else if (PRIO_TO_NICE(p->static_prio) < 0)
 			p->static_prio = NICE_TO_PRIO(0);
 
+		if (p->se.latency_nice < 0)
+			p->se.latency_nice = 0;
+
 		p->prio = p->normal_prio = p->static_prio;
 		set_load_weight(p, false);
 
@@ -5981,6 +5985,43 @@ extern void task_vruntime_update(struct rq *rq, struct task_struct *p, bool in_f
 
 static void queue_core_balance(struct rq *rq);
 
+/*
+ * The core-wide pick in pick_next_task() looks at the best task of every
+ * sibling and reschedules the siblings that have to switch. When the core
+ * already runs @cookie, nothing is forced idle and this CPU's own best task
+ * has @cookie too, schedule that one without touching the siblings: every
+ * sibling runs @cookie or idles already, so the isolation guarantee holds.
+ *
+ * Giving up the core-wide priority comparison here is what makes this cheap:
+ * a sibling with a more important task of another cookie does the core-wide
+ * pick itself the next time it schedules, and forces this CPU over then.
+ */
+static struct task_struct *
+sched_core_lazy_pick(struct rq *rq, const struct cpumask *smt_mask,
+		     unsigned long cookie)
+{
+	struct task_struct *next;
+	struct rq *rq_i;
+	int i;
+
+	next = pick_task(rq);
+	if (next->core_cookie != cookie)
+		return NULL;
+
+	/* All siblings are serialized by the core-wide rq lock */
+	for_each_cpu(i, smt_mask) {
+		rq_i = cpu_rq(i);
+		if (rq_i == rq)
+			continue;
+		if (!cookie_equals(rq_i->curr, cookie))
+			return NULL;
+		if (rq_i->core_pick && !cookie_equals(rq_i->core_pick, cookie))
+			return NULL;
+	}
+
+	return next;
+}
+
 static struct task_struct *
 pick_next_task(struct rq *rq, struct task_struct *prev, struct rq_flags *rf)
 {
@@ -6036,7 +6077,8 @@ pick_next_task(struct rq *rq, struct task_struct *prev, struct rq_flags *rf)
 	put_prev_task_balance(rq, prev, rf);
 
 	smt_mask = cpu_smt_mask(cpu);
-	need_sync = !!rq->core->core_cookie;
+	cookie = rq->core->core_cookie;
+	need_sync = !!cookie;
 
 	/* reset state */
 	rq->core->core_cookie = 0UL;
@@ -6082,6 +6124,14 @@ pick_next_task(struct rq *rq, struct task_struct *prev, struct rq_flags *rf)
 			task_vruntime_update(rq, next, false);
 			goto out_set_next;
 		}
+	} else if (sched_feat(CORE_LAZY_PICK) && !fi_before) {
+		next = sched_core_lazy_pick(rq, smt_mask, cookie);
+		if (next) {
+			rq->core->core_cookie = cookie;
+			rq->core_pick = NULL;
+			task_vruntime_update(rq, next, false);
+			goto out_set_next;
+		}
 	}
 
 	/*
@@ -7155,6 +7205,30 @@ out_unlock:
 }
 EXPORT_SYMBOL(set_user_nice);
 
+/**
+ * sched_set_latency_nice - set the latency hint of a task
+ * @p: the task in question.
+ * @latency_nice: the new latency nice value.
+ *
+ * Doesn't change the CPU share of @p, only how quickly it gets to run when
+ * it wakes up and how long it runs at once. Lowering it requires
+ * CAP_SYS_NICE, like lowering nice does.
+ *
+ * Return: 0 on success, -EINVAL for an invalid value, -EPERM otherwise.
+ */
+int sched_set_latency_nice(struct task_struct *p, int latency_nice)
+{
+	if (latency_nice < MIN_LATENCY_NICE || latency_nice > MAX_LATENCY_NICE)
+		return -EINVAL;
+
+	if (latency_nice < p->se.latency_nice && !capable(CAP_SYS_NICE))
+		return -EPERM;
+
+	/* Read locklessly by the fair class, takes effect on its next use */
+	WRITE_ONCE(p->se.latency_nice, latency_nice);
+	return 0;
+}
+
 /*
  * is_nice_reduction - check if nice value is an actual reduction
  *
@@ -11023,6 +11097,21 @@ static int cpu_idle_write_s64(struct cgroup_subsys_state *css,
 {
 	return sched_group_set_idle(css_tg(css), idle);
 }
+
+static s64 cpu_latency_nice_read_s64(struct cgroup_subsys_state *css,
+				     struct cftype *cft)
+{
+	return css_tg(css)->latency_nice;
+}
+
+static int cpu_latency_nice_write_s64(struct cgroup_subsys_state *css,
+				      struct cftype *cft, s64 latency_nice)
+{
+	if (latency_nice < MIN_LATENCY_NICE || latency_nice > MAX_LATENCY_NICE)
+		return -ERANGE;
+
+	return sched_group_set_latency_nice(css_tg(css), latency_nice);
+}
 #endif
 
 static struct cftype cpu_legacy_files[] = {
@@ -11037,6 +11126,11 @@ static struct cftype cpu_legacy_files[] = {
 		.read_s64 = cpu_idle_read_s64,
 		.write_s64 = cpu_idle_write_s64,
 	},
+	{
+		.name = "latency_nice",
+		.read_s64 = cpu_latency_nice_read_s64,
+		.write_s64 = cpu_latency_nice_write_s64,
+	},
 #endif
 #ifdef CONFIG_CFS_BANDWIDTH
 	{
@@ -11254,6 +11348,12 @@ static struct cftype cpu_files[] = {
 		.read_s64 = cpu_idle_read_s64,
 		.write_s64 = cpu_idle_write_s64,
 	},
+	{
+		.name = "latency.nice",
+		.flags = CFTYPE_NOT_ON_ROOT,
+		.read_s64 = cpu_latency_nice_read_s64,
+		.write_s64 = cpu_latency_nice_write_s64,
+	},
 #endif
 #ifdef CONFIG_CFS_BANDWIDTH
 	{
@@ -72,3 +72,32 @@ bool cpufreq_this_cpu_can_update(struct cpufreq_policy *policy)
 		(policy->dvfs_possible_from_any_cpu &&
 		 rcu_dereference_sched(*this_cpu_ptr(&cpufreq_update_util_data)));
 }
+
+/**
+ * cpufreq_get_util_min - Get the minimum utilization requested for a CPU.
+ * @cpu: The local CPU, called from an update_util hook.
+ *
+ * Return the max-aggregated uclamp min of the tasks runnable on @cpu, which
+ * includes the clamps of their task groups, raised in proportion to a
+ * negative latency nice value of the current task.  The result is in the
+ * range [0..SCHED_CAPACITY_SCALE].
+ */
+unsigned long cpufreq_get_util_min(int cpu)
+{
+	struct rq *rq = cpu_rq(cpu);
+	unsigned long util_min = 0;
+	int latency_nice;
+
+#ifdef CONFIG_UCLAMP_TASK
+	util_min = uclamp_rq_get(rq, UCLAMP_MIN);
+#endif
+
+	/* update_util hooks run with the rq lock held, pinning rq->curr */
+	latency_nice = READ_ONCE(rq->curr->se.latency_nice);
+	if (latency_nice < 0)
+		util_min = max(util_min, (unsigned long)-latency_nice *
+			       SCHED_CAPACITY_SCALE / -MIN_LATENCY_NICE);
+
+	return util_min;
+}
+EXPORT_SYMBOL_GPL(cpufreq_get_util_min);
@@ -742,6 +742,7 @@ static u64 sched_slice(struct cfs_rq *cfs_rq, struct sched_entity *se)
 {
 	unsigned int nr_running = cfs_rq->nr_running;
 	struct sched_entity *init_se = se;
+	int latency_nice = 0;
 	unsigned int min_gran;
 	u64 slice;
 
@@ -765,6 +766,20 @@ static u64 sched_slice(struct cfs_rq *cfs_rq, struct sched_entity *se)
 			load = &lw;
 		}
 		slice = __calc_delta(slice, se->load.weight, load);
+		latency_nice = min(latency_nice, READ_ONCE(se->latency_nice));
+	}
+
+	/*
+	 * Latency sensitive entities, or the ones in a latency sensitive
+	 * group, run in shorter slices: each step below 0 takes off 1/20th.
+	 * They get the same share of the CPU, in more but shorter pieces.
+	 */
+	if (latency_nice < 0) {
+		u64 scaled = div_u64(slice * (LATENCY_NICE_WIDTH / 2 + latency_nice),
+				     LATENCY_NICE_WIDTH / 2);
+
+		slice = max_t(u64, scaled,
+			      min_t(u64, slice, sysctl_sched_min_granularity));
 	}
 
 	if (sched_feat(BASE_SLICE)) {
@@ -891,6 +906,9 @@ static void update_tg_load_avg(struct cfs_rq *cfs_rq)
 }
 #endif /* CONFIG_SMP */
 
+static void account_mm_sched(struct rq *rq, struct task_struct *p,
+			     u64 delta_exec);
+
 /*
  * Update the current task's runtime statistics.
  */
@@ -929,6 +947,7 @@ static void update_curr(struct cfs_rq *cfs_rq)
 		trace_sched_stat_runtime(curtask, delta_exec, curr->vruntime);
 		cgroup_account_cputime(curtask, delta_exec);
 		account_group_exec_runtime(curtask, delta_exec);
+		account_mm_sched(rq_of(cfs_rq), curtask, delta_exec);
 	}
 
 	account_cfs_rq_runtime(cfs_rq, delta_exec);
@@ -3211,6 +3230,202 @@ static inline void update_scan_period(struct task_struct *p, int new_cpu)
 
 #endif /* CONFIG_NUMA_BALANCING */
 
+#ifdef CONFIG_SCHED_CACHE
+/*
+ * Cache aware placement: the load balancer spreads the threads of a process
+ * by load alone, so threads that share data end up in different LLCs and
+ * pay for it in cross-die traffic. Track where the threads of each mm have
+ * been running and steer them towards the LLC they used most.
+ *
+ * Each CPU accounts the runtime of the mm's threads in mm->pcpu_sched,
+ * halved every EPOCH_PERIOD. Every MM_SCHED_SCAN, one of the threads sums
+ * this up per LLC from task_work and records a CPU of the busiest LLC in
+ * mm->mm_sched_cpu.
+ */
+#define EPOCH_PERIOD	DIV_ROUND_UP(HZ, 100)	/* 10ms */
+#define EPOCH_OLD	5			/* older runtime is dropped */
+#define MM_SCHED_SCAN	(4 * EPOCH_PERIOD)
+
+int mm_sched_init(struct mm_struct *mm)
+{
+	mm->pcpu_sched = alloc_percpu(struct mm_sched);
+	if (!mm->pcpu_sched)
+		return -ENOMEM;
+
+	mm->mm_sched_cpu = -1;
+	mm->mm_sched_next = jiffies;
+	return 0;
+}
+
+void mm_sched_destroy(struct mm_struct *mm)
+{
+	free_percpu(mm->pcpu_sched);
+	mm->pcpu_sched = NULL;
+}
+
+static void account_mm_sched(struct rq *rq, struct task_struct *p,
+			     u64 delta_exec)
+{
+	unsigned long epoch = jiffies / EPOCH_PERIOD;
+	struct mm_struct *mm = p->mm;
+	struct mm_sched *pcpu;
+	unsigned long n;
+
+	if (!sched_feat(SCHED_CACHE) || !mm || !mm->pcpu_sched)
+		return;
+
+	/* Only ever written by this CPU, under the rq lock */
+	pcpu = per_cpu_ptr(mm->pcpu_sched, cpu_of(rq));
+	n = epoch - pcpu->epoch;
+	if (n) {
+		WRITE_ONCE(pcpu->runtime, n > EPOCH_OLD ? 0 : pcpu->runtime >> n);
+		WRITE_ONCE(pcpu->epoch, epoch);
+	}
+	WRITE_ONCE(pcpu->runtime, pcpu->runtime + delta_exec);
+}
+
+/* Decayed runtime of @mm on the CPUs sharing the LLC of @cpu */
+static u64 mm_sched_llc_runtime(struct mm_struct *mm,
+				const struct cpumask *llc, unsigned long epoch)
+{
+	struct mm_sched *pcpu;
+	u64 runtime = 0;
+	long n;
+	int i;
+
+	for_each_cpu(i, llc) {
+		pcpu = per_cpu_ptr(mm->pcpu_sched, i);
+		n = epoch - READ_ONCE(pcpu->epoch);
+		if (n > EPOCH_OLD)
+			continue;
+		runtime += READ_ONCE(pcpu->runtime) >> max(n, 0L);
+	}
+
+	return runtime;
+}
+
+static void task_cache_work(struct callback_head *work)
+{
+	unsigned long next, epoch = jiffies / EPOCH_PERIOD;
+	struct task_struct *p = current;
+	struct mm_struct *mm = p->mm;
+	u64 runtime, best_runtime = 0, pref_runtime = 0;
+	int cpu, pref, best = -1;
+	struct sched_domain *sd;
+
+	SCHED_WARN_ON(p != container_of(work, struct task_struct, cache_work));
+
+	work->next = work;
+
+	if (p->flags & PF_EXITING)
+		return;
+
+	/* One thread per MM_SCHED_SCAN does the update */
+	next = READ_ONCE(mm->mm_sched_next);
+	if (time_before(jiffies, next) ||
+	    !try_cmpxchg(&mm->mm_sched_next, &next, jiffies + MM_SCHED_SCAN))
+		return;
+
+	pref = READ_ONCE(mm->mm_sched_cpu);
+
+	rcu_read_lock();
+	for_each_online_cpu(cpu) {
+		const struct cpumask *llc = cpumask_of(cpu);
+
+		/* Look at every LLC once, through its first CPU */
+		sd = rcu_dereference(per_cpu(sd_llc, cpu));
+		if (sd) {
+			llc = sched_domain_span(sd);
+			if (cpumask_first(llc) != cpu)
+				continue;
+		}
+
+		runtime = mm_sched_llc_runtime(mm, llc, epoch);
+		if (pref >= 0 && cpumask_test_cpu(pref, llc))
+			pref_runtime = runtime;
+		if (runtime > best_runtime) {
+			best_runtime = runtime;
+			best = cpu;
+		}
+	}
+	rcu_read_unlock();
+
+	/* Don't bounce between LLCs that are used about as much */
+	if (pref >= 0 && best >= 0 && !cpus_share_cache(pref, best) &&
+	    best_runtime < pref_runtime + (pref_runtime >> 2))
+		return;
+
+	WRITE_ONCE(mm->mm_sched_cpu, best);
+}
+
+void init_sched_mm(struct task_struct *p)
+{
+	/* Protect against double add, see task_tick_cache() */
+	p->cache_work.next = &p->cache_work;
+	init_task_work(&p->cache_work, task_cache_work);
+}
+
+static void task_tick_cache(struct rq *rq, struct task_struct *curr)
+{
+	struct callback_head *work = &curr->cache_work;
+	struct mm_struct *mm = curr->mm;
+
+	if (!sched_feat(SCHED_CACHE) || !mm || !mm->pcpu_sched ||
+	    (curr->flags & (PF_EXITING | PF_KTHREAD)) || work->next != work)
+		return;
+
+	/* A single thread has no one to share its LLC with */
+	if (atomic_read(&mm->mm_users) <= 1)
+		return;
+
+	if (!time_before(jiffies, READ_ONCE(mm->mm_sched_next)))
+		task_work_add(curr, work, TWA_RESUME);
+}
+
+/*
+ * Wake @p in the LLC its process prefers, if that has an idle CPU @p may
+ * use. Otherwise leave the choice to the usual wakeup path.
+ */
+static int select_cache_cpu(struct task_struct *p, int prev_cpu)
+{
+	struct sched_domain_shared *sds;
+	struct mm_struct *mm = p->mm;
+	int cpu;
+
+	if (!sched_feat(SCHED_CACHE) || !mm || !mm->pcpu_sched)
+		return prev_cpu;
+
+	cpu = READ_ONCE(mm->mm_sched_cpu);
+	if (cpu < 0 || cpus_share_cache(cpu, prev_cpu))
+		return prev_cpu;
+
+	rcu_read_lock();
+	sds = rcu_dereference(per_cpu(sd_llc_shared, cpu));
+	if (sds)
+		cpu = cpumask_any_and_distribute(sds_idle_cpus(sds), p->cpus_ptr);
+	else
+		cpu = nr_cpu_ids;
+	rcu_read_unlock();
+
+	return cpu < nr_cpu_ids ? cpu : prev_cpu;
+}
+
+#else
+static inline void account_mm_sched(struct rq *rq, struct task_struct *p,
+				    u64 delta_exec)
+{
+}
+
+static inline void task_tick_cache(struct rq *rq, struct task_struct *curr)
+{
+}
+
+static inline int select_cache_cpu(struct task_struct *p, int prev_cpu)
+{
+	return prev_cpu;
+}
+#endif /* CONFIG_SCHED_CACHE */
+
 static void
 account_entity_enqueue(struct cfs_rq *cfs_rq, struct sched_entity *se)
 {
@@ -5508,22 +5723,108 @@ unthrottle_throttle:
 		resched_curr(rq);
 }
 
-static void distribute_cfs_runtime(struct cfs_bandwidth *cfs_b)
+#ifdef CONFIG_SMP
+static void __cfsb_csd_unthrottle(void *arg)
 {
-	struct cfs_rq *cfs_rq;
+	struct cfs_rq *cursor, *tmp;
+	struct rq *rq = arg;
+	struct rq_flags rf;
+
+	rq_lock(rq, &rf);
+
+	/*
+	 * The rq lock protects the CSD list; the RCU read side pairs with
+	 * sched_free_group_rcu() so that a group can't be freed between
+	 * dropping it from the list and advancing to the next entry.
+	 */
+	rcu_read_lock();
+
+	list_for_each_entry_safe(cursor, tmp, &rq->cfsb_csd_list,
+				 throttled_csd_list) {
+		list_del_init(&cursor->throttled_csd_list);
+
+		if (cfs_rq_throttled(cursor))
+			unthrottle_cfs_rq(cursor);
+	}
+
+	rcu_read_unlock();
+
+	rq_unlock(rq, &rf);
+}
+
+static inline void __unthrottle_cfs_rq_async(struct cfs_rq *cfs_rq)
+{
+	struct rq *rq = rq_of(cfs_rq);
+	bool first;
+
+	if (rq == this_rq()) {
+		unthrottle_cfs_rq(cfs_rq);
+		return;
+	}
+
+	/* Already enqueued */
+	if (SCHED_WARN_ON(!list_empty(&cfs_rq->throttled_csd_list)))
+		return;
+
+	first = list_empty(&rq->cfsb_csd_list);
+	list_add_tail(&cfs_rq->throttled_csd_list, &rq->cfsb_csd_list);
+	if (first)
+		smp_call_function_single_async(cpu_of(rq), &rq->cfsb_csd);
+}
+#else
+static inline void __unthrottle_cfs_rq_async(struct cfs_rq *cfs_rq)
+{
+	unthrottle_cfs_rq(cfs_rq);
+}
+#endif
+
+/*
+ * Unthrottle @cfs_rq from the CPU that owns it. The timer distributing
+ * runtime then only has to take each remote rq lock long enough to hand over
+ * the runtime, rather than for the whole enqueue of the hierarchy.
+ */
+static void unthrottle_cfs_rq_async(struct cfs_rq *cfs_rq)
+{
+	lockdep_assert_rq_held(rq_of(cfs_rq));
+
+	if (SCHED_WARN_ON(!cfs_rq_throttled(cfs_rq) ||
+	    cfs_rq->runtime_remaining <= 0))
+		return;
+
+	__unthrottle_cfs_rq_async(cfs_rq);
+}
+
+static bool distribute_cfs_runtime(struct cfs_bandwidth *cfs_b)
+{
+	struct cfs_rq *local_unthrottle = NULL;
+	int this_cpu = smp_processor_id();
 	u64 runtime, remaining = 1;
+	bool throttled = false;
+	struct cfs_rq *cfs_rq;
+	struct rq_flags rf;
+	struct rq *rq;
 
 	rcu_read_lock();
 	list_for_each_entry_rcu(cfs_rq, &cfs_b->throttled_cfs_rq,
 				throttled_list) {
-		struct rq *rq = rq_of(cfs_rq);
-		struct rq_flags rf;
+		rq = rq_of(cfs_rq);
+
+		if (!remaining) {
+			throttled = true;
+			break;
+		}
 
 		rq_lock_irqsave(rq, &rf);
 		if (!cfs_rq_throttled(cfs_rq))
 			goto next;
 
-		/* By the above check, this should never be true */
+#ifdef CONFIG_SMP
+		/* Already queued for async unthrottle */
+		if (!list_empty(&cfs_rq->throttled_csd_list))
+			goto next;
+#endif
+
+		/* By the above checks, this should never be true */
 		SCHED_WARN_ON(cfs_rq->runtime_remaining > 0);
 
 		raw_spin_lock(&cfs_b->lock);
@@ -5537,16 +5838,30 @@ static void distribute_cfs_runtime(struct cfs_bandwidth *cfs_b)
 		cfs_rq->runtime_remaining += runtime;
 
 		/* we check whether we're throttled above */
-		if (cfs_rq->runtime_remaining > 0)
-			unthrottle_cfs_rq(cfs_rq);
+		if (cfs_rq->runtime_remaining > 0) {
+			if (cpu_of(rq) != this_cpu ||
+			    SCHED_WARN_ON(local_unthrottle))
+				unthrottle_cfs_rq_async(cfs_rq);
+			else
+				local_unthrottle = cfs_rq;
+		} else {
+			throttled = true;
+		}
 
 next:
 		rq_unlock_irqrestore(rq, &rf);
-
-		if (!remaining)
-			break;
 	}
 	rcu_read_unlock();
+
+	if (local_unthrottle) {
+		rq = cpu_rq(this_cpu);
+		rq_lock_irqsave(rq, &rf);
+		if (cfs_rq_throttled(local_unthrottle))
+			unthrottle_cfs_rq(local_unthrottle);
+		rq_unlock_irqrestore(rq, &rf);
+	}
+
+	return throttled;
 }
 
 /*
@@ -5591,10 +5906,8 @@ static int do_sched_cfs_period_timer(struct cfs_bandwidth *cfs_b, int overrun, u
 	while (throttled && cfs_b->runtime > 0) {
 		raw_spin_unlock_irqrestore(&cfs_b->lock, flags);
 		/* we can't nest cfs_b->lock while distributing bandwidth */
-		distribute_cfs_runtime(cfs_b);
+		throttled = distribute_cfs_runtime(cfs_b);
 		raw_spin_lock_irqsave(&cfs_b->lock, flags);
-
-		throttled = !list_empty(&cfs_b->throttled_cfs_rq);
 	}
 
 	/*
@@ -5871,6 +6184,9 @@ static void init_cfs_rq_runtime(struct cfs_rq *cfs_rq)
 {
 	cfs_rq->runtime_enabled = 0;
 	INIT_LIST_HEAD(&cfs_rq->throttled_list);
+#ifdef CONFIG_SMP
+	INIT_LIST_HEAD(&cfs_rq->throttled_csd_list);
+#endif
 }
 
 void start_cfs_bandwidth(struct cfs_bandwidth *cfs_b)
@@ -5887,12 +6203,34 @@ void start_cfs_bandwidth(struct cfs_bandwidth *cfs_b)
 
 static void destroy_cfs_bandwidth(struct cfs_bandwidth *cfs_b)
 {
+	int __maybe_unused i;
+
 	/* init_cfs_bandwidth() was not called */
 	if (!cfs_b->throttled_cfs_rq.next)
 		return;
 
 	hrtimer_cancel(&cfs_b->period_timer);
 	hrtimer_cancel(&cfs_b->slack_timer);
+
+	/*
+	 * The last task may have left the group after a timer queued one of
+	 * its cfs_rqs for async unthrottle but before the remote CPU got to
+	 * it. No cfs_rq of this group can join a CSD list anymore, so just
+	 * flush whatever is pending inline.
+	 */
+#ifdef CONFIG_SMP
+	for_each_possible_cpu(i) {
+		struct rq *rq = cpu_rq(i);
+		unsigned long flags;
+
+		if (list_empty(&rq->cfsb_csd_list))
+			continue;
+
+		local_irq_save(flags);
+		__cfsb_csd_unthrottle(rq);
+		local_irq_restore(flags);
+	}
+#endif
 }
 
 /*
@@ -6673,6 +7011,33 @@ unlock:
 	rcu_read_unlock();
 }
 
+/*
+ * Track the CPUs of each LLC that run their idle task in
+ * sd_llc_shared->idle_cpus_span, so that select_idle_cpu() only needs to look
+ * at those. Only write the shared cacheline when the bit actually changes.
+ */
+void update_idle_cpumask(int cpu, bool idle)
+{
+	struct sched_domain_shared *sds;
+	struct cpumask *mask;
+
+	rcu_read_lock();
+	sds = rcu_dereference(per_cpu(sd_llc_shared, cpu));
+	if (!sds)
+		goto unlock;
+
+	mask = sds_idle_cpus(sds);
+	if (cpumask_test_cpu(cpu, mask) == idle)
+		goto unlock;
+
+	if (idle)
+		cpumask_set_cpu(cpu, mask);
+	else
+		cpumask_clear_cpu(cpu, mask);
+unlock:
+	rcu_read_unlock();
+}
+
 /*
  * Scan the entire LLC domain for idle cores; this dynamically switches off if
  * there are no idle cores left in the system; tracked through
@@ -6795,15 +7160,42 @@ static int select_idle_cpu(struct task_struct *p, struct sched_domain *sd, bool
 		time = cpu_clock(this);
 	}
 
-	if (sched_feat(SIS_UTIL)) {
-		sd_share = rcu_dereference(per_cpu(sd_llc_shared, target));
-		if (sd_share) {
-			/* because !--nr is the condition to stop scan */
-			nr = READ_ONCE(sd_share->nr_idle_scan) + 1;
-			/* overloaded LLC is unlikely to have idle cpu/core */
-			if (nr == 1)
-				return -1;
+	sd_share = rcu_dereference(per_cpu(sd_llc_shared, target));
+
+	if (sched_feat(SIS_UTIL) && sd_share) {
+		/* because !--nr is the condition to stop scan */
+		nr = READ_ONCE(sd_share->nr_idle_scan) + 1;
+		/* overloaded LLC is unlikely to have idle cpu/core */
+		if (nr == 1)
+			return -1;
+	}
+
+	if (sched_feat(SIS_FILTER) && sd_share) {
+		/*
+		 * Busy CPUs, including the ones only running SCHED_IDLE
+		 * tasks, are skipped; select_idle_sibling() checks target
+		 * and prev for those already.
+		 */
+		cpumask_and(cpus, cpus, sds_idle_cpus(sd_share));
+
+#ifdef CONFIG_SCHED_CLUSTER
+		/*
+		 * Idle CPUs sharing the cluster's cache with target come
+		 * first. An idle core still takes precedence.
+		 */
+		if (!has_idle_core) {
+			const struct cpumask *cluster = cpu_clustergroup_mask(target);
+
+			for_each_cpu_and(cpu, cluster, cpus) {
+				if (!--nr)
+					return -1;
+				idle_cpu = __select_idle_cpu(cpu, p);
+				if ((unsigned int)idle_cpu < nr_cpumask_bits)
+					goto out;
+			}
+			cpumask_andnot(cpus, cpus, cluster);
 		}
+#endif
 	}
 
 	for_each_cpu_wrap(cpu, cpus, target + 1) {
@@ -6824,6 +7216,9 @@ static int select_idle_cpu(struct task_struct *p, struct sched_domain *sd, bool
 	if (has_idle_core)
 		set_idle_cores(target, false);
 
+#ifdef CONFIG_SCHED_CLUSTER
+out:
+#endif
 	if (sched_feat(SIS_PROP) && this_sd && !has_idle_core) {
 		time = cpu_clock(this) - time;
 
@@ -7421,6 +7816,15 @@ select_task_rq_fair(struct task_struct *p, int prev_cpu, int wake_flags)
 	 * required for stable ->cpus_allowed
 	 */
 	lockdep_assert_held(&p->pi_lock);
+
+	new_cpu = sched_fair_ops_select_cpu(p, prev_cpu, wake_flags);
+	if (new_cpu >= 0)
+		return new_cpu;
+
+	if (wake_flags & WF_TTWU)
+		prev_cpu = select_cache_cpu(p, prev_cpu);
+	new_cpu = prev_cpu;
+
 	if (wake_flags & WF_TTWU) {
 		record_wakee(p);
 
@@ -7564,11 +7968,31 @@ static unsigned long wakeup_gran(struct sched_entity *se)
  *  w(c, s3) =  1
  *
  */
+/*
+ * Difference of the latency hints of @se and @curr, as the wakeup preemption
+ * advantage of @se: with latency nice -20, an entity preempts an otherwise
+ * equal one up to a whole sched_latency period earlier, and with 19, almost
+ * a period later. vruntime itself is left alone, so the CPU share doesn't
+ * change.
+ */
+static s64 wakeup_latency_gran(struct sched_entity *curr, struct sched_entity *se)
+{
+	int diff = READ_ONCE(curr->latency_nice) - READ_ONCE(se->latency_nice);
+
+	if (likely(!diff))
+		return 0;
+
+	diff = clamp(diff, -LATENCY_NICE_WIDTH / 2, LATENCY_NICE_WIDTH / 2);
+	return div_s64((s64)diff * sysctl_sched_latency, LATENCY_NICE_WIDTH / 2);
+}
+
 static int
 wakeup_preempt_entity(struct sched_entity *curr, struct sched_entity *se)
 {
 	s64 gran, vdiff = curr->vruntime - se->vruntime;
 
+	vdiff += wakeup_latency_gran(curr, se);
+
 	if (vdiff <= 0)
 		return -1;
 
@@ -7649,6 +8073,13 @@ static void check_preempt_wakeup(struct rq *rq, struct task_struct *p, int wake_
 	if (test_tsk_need_resched(curr))
 		return;
 
+	switch (sched_fair_ops_wakeup_preempt(p, curr)) {
+	case 1:
+		goto preempt;
+	case 0:
+		return;
+	}
+
 	/* Idle tasks are by definition preempted by non-idle tasks. */
 	if (unlikely(task_has_idle_policy(curr)) &&
 	    likely(!task_has_idle_policy(p)))
@@ -8261,6 +8692,43 @@ static inline int migrate_degrades_locality(struct task_struct *p,
 }
 #endif
 
+#ifdef CONFIG_SCHED_CACHE
+/*
+ * Returns 1, if task migration takes @p out of its preferred LLC
+ * Returns 0, if task migration takes @p into its preferred LLC
+ * Returns -1, if task migration is not affected by that.
+ */
+static int migrate_degrades_llc(struct task_struct *p, struct lb_env *env)
+{
+	struct mm_struct *mm = p->mm;
+	int cpu;
+
+	if (!sched_feat(SCHED_CACHE) || !mm || !mm->pcpu_sched)
+		return -1;
+
+	/* Balancing within an LLC */
+	if (env->sd->flags & SD_SHARE_PKG_RESOURCES)
+		return -1;
+
+	cpu = READ_ONCE(mm->mm_sched_cpu);
+	if (cpu < 0)
+		return -1;
+
+	if (cpus_share_cache(cpu, env->dst_cpu))
+		return 0;
+	if (cpus_share_cache(cpu, env->src_cpu))
+		return 1;
+
+	return -1;
+}
+#else
+static inline int migrate_degrades_llc(struct task_struct *p,
+				       struct lb_env *env)
+{
+	return -1;
+}
+#endif
+
 /*
  * can_migrate_task - may task p from runqueue rq be migrated to this_cpu?
  */
@@ -8336,7 +8804,9 @@ int can_migrate_task(struct task_struct *p, struct lb_env *env)
 	if (env->flags & LBF_ACTIVE_LB)
 		return 1;
 
-	tsk_cache_hot = migrate_degrades_locality(p, env);
+	tsk_cache_hot = migrate_degrades_llc(p, env);
+	if (tsk_cache_hot == -1)
+		tsk_cache_hot = migrate_degrades_locality(p, env);
 	if (tsk_cache_hot == -1)
 		tsk_cache_hot = task_hot(p, env);
 
@@ -11884,6 +12354,8 @@ static void task_tick_fair(struct rq *rq, struct task_struct *curr, int queued)
 	if (static_branch_unlikely(&sched_numa_balancing))
 		task_tick_numa(rq, curr);
 
+	task_tick_cache(rq, curr);
+
 	update_misfit_status(curr, rq);
 	update_overutilized_status(task_rq(curr));
 
@@ -12282,6 +12754,7 @@ void init_tg_cfs_entry(struct task_group *tg, struct cfs_rq *cfs_rq,
 	se->my_q = cfs_rq;
 	/* guarantee group entities always have weight */
 	update_load_set(&se->load, NICE_0_LOAD);
+	se->latency_nice = tg->latency_nice;
 	se->parent = parent;
 }
 
@@ -12410,6 +12883,23 @@ next_cpu:
 	return 0;
 }
 
+int sched_group_set_latency_nice(struct task_group *tg, int latency_nice)
+{
+	int i;
+
+	if (tg == &root_task_group)
+		return -EINVAL;
+
+	mutex_lock(&shares_mutex);
+	tg->latency_nice = latency_nice;
+	/* Read locklessly, like the task's value */
+	for_each_possible_cpu(i)
+		WRITE_ONCE(tg->se[i]->latency_nice, latency_nice);
+	mutex_unlock(&shares_mutex);
+
+	return 0;
+}
+
 #else /* CONFIG_FAIR_GROUP_SCHED */
 
 void free_fair_sched_group(struct task_group *tg) { }
@@ -12534,6 +13024,11 @@ __init void init_sched_fair_class(void)
 	for_each_possible_cpu(i) {
 		zalloc_cpumask_var_node(&per_cpu(load_balance_mask, i), GFP_KERNEL, cpu_to_node(i));
 		zalloc_cpumask_var_node(&per_cpu(select_rq_mask,    i), GFP_KERNEL, cpu_to_node(i));
+
+#ifdef CONFIG_CFS_BANDWIDTH
+		INIT_CSD(&cpu_rq(i)->cfsb_csd, __cfsb_csd_unthrottle, cpu_rq(i));
+		INIT_LIST_HEAD(&cpu_rq(i)->cfsb_csd_list);
+#endif
 	}
 
 	open_softirq(SCHED_SOFTIRQ, run_rebalance_domains);
@@ -0,0 +1,268 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * BPF struct_ops hooks into CFS task placement and wakeup preemption
+ *
+ * A registered struct sched_fair_ops may take the select_task_rq_fair() and
+ * check_preempt_wakeup() decisions for fair tasks. Everything else, picking
+ * the next task, load balancing and bandwidth control, stays with CFS, so a
+ * misbehaving policy can make bad decisions but cannot stall tasks.
+ *
+ * A policy that returns an invalid CPU is switched off until it is
+ * unregistered, and CFS takes over all decisions again.
+ */
+#include <linux/bpf.h>
+#include <linux/bpf_verifier.h>
+#include <linux/btf.h>
+#include <linux/btf_ids.h>
+#include <linux/filter.h>
+#include <linux/sched/fair_ops.h>
+
+#include "sched.h"
+
+/* "extern" is to avoid sparse warning.  It is only used in bpf_struct_ops.c. */
+extern struct bpf_struct_ops bpf_sched_fair_ops;
+
+DEFINE_STATIC_KEY_FALSE(sched_fair_ops_enabled);
+
+static struct sched_fair_ops __rcu *sched_fair_ops_cur;
+static DEFINE_MUTEX(sched_fair_ops_mutex);
+static bool sched_fair_ops_failed;
+
+static void sched_fair_ops_fail(struct sched_fair_ops *ops, const char *why)
+{
+	if (!xchg(&sched_fair_ops_failed, true))
+		pr_warn("sched_fair_ops %s: %s, falling back to CFS\n",
+			ops->name, why);
+}
+
+static struct sched_fair_ops *sched_fair_ops_get(void)
+{
+	struct sched_fair_ops *ops = rcu_dereference(sched_fair_ops_cur);
+
+	if (!ops || READ_ONCE(sched_fair_ops_failed))
+		return NULL;
+
+	return ops;
+}
+
+int __sched_fair_ops_select_cpu(struct task_struct *p, int prev_cpu,
+				int wake_flags)
+{
+	struct sched_fair_ops *ops;
+	int cpu = -1;
+
+	rcu_read_lock();
+	ops = sched_fair_ops_get();
+	if (!ops || !ops->select_cpu)
+		goto unlock;
+
+	cpu = ops->select_cpu(p, prev_cpu, wake_flags);
+	if (cpu < 0) {
+		cpu = -1;
+		goto unlock;
+	}
+
+	if (cpu >= nr_cpu_ids || !cpumask_test_cpu(cpu, p->cpus_ptr)) {
+		sched_fair_ops_fail(ops, "select_cpu() returned a disallowed CPU");
+		cpu = -1;
+	} else if (!cpu_active(cpu)) {
+		/* Raced with hotplug, not the policy's fault */
+		cpu = -1;
+	}
+unlock:
+	rcu_read_unlock();
+	return cpu;
+}
+
+int __sched_fair_ops_wakeup_preempt(struct task_struct *p,
+				    struct task_struct *curr)
+{
+	struct sched_fair_ops *ops;
+	int ret = -1;
+
+	rcu_read_lock();
+	ops = sched_fair_ops_get();
+	if (ops && ops->wakeup_preempt) {
+		ret = ops->wakeup_preempt(p, curr);
+		if (ret > 0)
+			ret = 1;
+		else if (ret < 0)
+			ret = -1;
+	}
+	rcu_read_unlock();
+
+	return ret;
+}
+
+/*
+ * Helpers for topology aware policies.
+ */
+__diag_push();
+__diag_ignore_all("-Wmissing-prototypes",
+		  "Global functions as their definitions will be in vmlinux BTF");
+
+/**
+ * bpf_sched_cpu_idle - Is @cpu idle, i.e. a good spot for a waking task?
+ * @cpu: CPU to check
+ */
+__bpf_kfunc bool bpf_sched_cpu_idle(s32 cpu)
+{
+	if ((u32)cpu >= nr_cpu_ids)
+		return false;
+
+	return available_idle_cpu(cpu);
+}
+
+/**
+ * bpf_sched_cpu_llc_id - Identify the last level cache of @cpu
+ * @cpu: CPU to look up
+ *
+ * Returns the first CPU of the LLC domain of @cpu, so that CPUs sharing
+ * their LLC have the same ID, or -EINVAL for an invalid @cpu.
+ */
+__bpf_kfunc s32 bpf_sched_cpu_llc_id(s32 cpu)
+{
+	if ((u32)cpu >= nr_cpu_ids)
+		return -EINVAL;
+
+	return per_cpu(sd_llc_id, cpu);
+}
+
+/**
+ * bpf_sched_cpu_nr_running - Number of tasks runnable on @cpu
+ * @cpu: CPU to look up
+ */
+__bpf_kfunc u32 bpf_sched_cpu_nr_running(s32 cpu)
+{
+	if ((u32)cpu >= nr_cpu_ids)
+		return 0;
+
+	return READ_ONCE(cpu_rq(cpu)->nr_running);
+}
+
+__diag_pop();
+
+BTF_SET8_START(sched_fair_ops_kfunc_ids)
+BTF_ID_FLAGS(func, bpf_sched_cpu_idle)
+BTF_ID_FLAGS(func, bpf_sched_cpu_llc_id)
+BTF_ID_FLAGS(func, bpf_sched_cpu_nr_running)
+BTF_SET8_END(sched_fair_ops_kfunc_ids)
+
+static const struct btf_kfunc_id_set sched_fair_ops_kfunc_set = {
+	.owner = THIS_MODULE,
+	.set   = &sched_fair_ops_kfunc_ids,
+};
+
+static bool sched_fair_ops_is_valid_access(int off, int size,
+					   enum bpf_access_type type,
+					   const struct bpf_prog *prog,
+					   struct bpf_insn_access_aux *info)
+{
+	return bpf_tracing_btf_ctx_access(off, size, type, prog, info);
+}
+
+static int sched_fair_ops_btf_struct_access(struct bpf_verifier_log *log,
+					    const struct bpf_reg_state *reg,
+					    int off, int size,
+					    enum bpf_access_type atype,
+					    u32 *next_btf_id,
+					    enum bpf_type_flag *flag)
+{
+	if (atype == BPF_READ)
+		return btf_struct_access(log, reg, off, size, atype,
+					 next_btf_id, flag);
+
+	bpf_log(log, "only read is supported\n");
+	return -EACCES;
+}
+
+static const struct bpf_func_proto *
+sched_fair_ops_get_func_proto(enum bpf_func_id func_id,
+			      const struct bpf_prog *prog)
+{
+	return bpf_base_func_proto(func_id);
+}
+
+static const struct bpf_verifier_ops sched_fair_ops_verifier_ops = {
+	.get_func_proto		= sched_fair_ops_get_func_proto,
+	.is_valid_access	= sched_fair_ops_is_valid_access,
+	.btf_struct_access	= sched_fair_ops_btf_struct_access,
+};
+
+static int sched_fair_ops_init(struct btf *btf)
+{
+	return 0;
+}
+
+static int sched_fair_ops_init_member(const struct btf_type *t,
+				      const struct btf_member *member,
+				      void *kdata, const void *udata)
+{
+	const struct sched_fair_ops *uops = udata;
+	struct sched_fair_ops *ops = kdata;
+	u32 moff;
+
+	moff = __btf_member_bit_offset(t, member) / 8;
+	switch (moff) {
+	case offsetof(struct sched_fair_ops, name):
+		if (bpf_obj_name_cpy(ops->name, uops->name,
+				     sizeof(ops->name)) <= 0)
+			return -EINVAL;
+		return 1;
+	}
+
+	return 0;
+}
+
+static int sched_fair_ops_check_member(const struct btf_type *t,
+				       const struct btf_member *member)
+{
+	return 0;
+}
+
+static int sched_fair_ops_reg(void *kdata)
+{
+	int ret = 0;
+
+	mutex_lock(&sched_fair_ops_mutex);
+	if (rcu_access_pointer(sched_fair_ops_cur)) {
+		ret = -EEXIST;
+		goto unlock;
+	}
+
+	WRITE_ONCE(sched_fair_ops_failed, false);
+	rcu_assign_pointer(sched_fair_ops_cur, kdata);
+	static_branch_enable(&sched_fair_ops_enabled);
+unlock:
+	mutex_unlock(&sched_fair_ops_mutex);
+	return ret;
+}
+
+static void sched_fair_ops_unreg(void *kdata)
+{
+	mutex_lock(&sched_fair_ops_mutex);
+	if (rcu_access_pointer(sched_fair_ops_cur) == kdata) {
+		static_branch_disable(&sched_fair_ops_enabled);
+		RCU_INIT_POINTER(sched_fair_ops_cur, NULL);
+		/* The hooks run in RCU read-side sections */
+		synchronize_rcu();
+	}
+	mutex_unlock(&sched_fair_ops_mutex);
+}
+
+struct bpf_struct_ops bpf_sched_fair_ops = {
+	.verifier_ops = &sched_fair_ops_verifier_ops,
+	.reg = sched_fair_ops_reg,
+	.unreg = sched_fair_ops_unreg,
+	.check_member = sched_fair_ops_check_member,
+	.init_member = sched_fair_ops_init_member,
+	.init = sched_fair_ops_init,
+	.name = "sched_fair_ops",
+};
+
+static int __init sched_fair_ops_kfunc_init(void)
+{
+	return register_btf_kfunc_id_set(BPF_PROG_TYPE_STRUCT_OPS,
+					 &sched_fair_ops_kfunc_set);
+}
+late_initcall(sched_fair_ops_kfunc_init);
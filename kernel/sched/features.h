@@ -62,6 +62,25 @@ SCHED_FEAT(TTWU_QUEUE, true)
  */
 SCHED_FEAT(SIS_PROP, false)
 SCHED_FEAT(SIS_UTIL, true)
+/*
+ * Only scan the CPUs the LLC's idle cpumask says are idle, and the ones in
+ * the cluster of the target first.
+ */
+SCHED_FEAT(SIS_FILTER, true)
+
+/*
+ * Keep the threads of a process in the LLC they have run in most, see
+ * select_cache_cpu() and migrate_degrades_llc().
+ */
+#ifdef CONFIG_SCHED_CACHE
+SCHED_FEAT(SCHED_CACHE, true)
+#endif
+
+/*
+ * With core scheduling, skip the core-wide pick while this CPU's best task
+ * has the cookie the core runs already, see sched_core_lazy_pick().
+ */
+SCHED_FEAT(CORE_LAZY_PICK, true)
 
 /*
  * Issue a WARN when we do multiple update_rq_clock() calls
@@ -159,6 +159,13 @@ __setup("psi=", setup_psi);
 #define EXP_60s		1981		/* 1/exp(2s/60s) */
 #define EXP_300s	2034		/* 1/exp(2s/300s) */
 
+/*
+ * Cgroup averages are only sampled periodically while somebody reads them.
+ * Without a reader for this long, the aggregation clock of a cgroup is no
+ * longer restarted by task changes; the next read catches up in one go.
+ */
+#define PSI_AVGS_LAZY_TIMEOUT	(300*HZ)
+
 /* PSI trigger definitions */
 #define WINDOW_MIN_US 500000	/* Min window size is 500ms */
 #define WINDOW_MAX_US 10000000	/* Max window size is 10s */
@@ -186,6 +193,7 @@ static void group_init(struct psi_group *group)
 		seqcount_init(&per_cpu_ptr(group->pcpu, cpu)->seq);
 	group->avg_last_update = sched_clock();
 	group->avg_next_update = group->avg_last_update + psi_period;
+	group->avg_last_read = jiffies - PSI_AVGS_LAZY_TIMEOUT;
 	INIT_DELAYED_WORK(&group->avgs_work, psi_avgs_work);
 	mutex_init(&group->avgs_lock);
 	/* Init trigger-related members */
@@ -384,7 +392,48 @@ static void collect_percpu_times(struct psi_group *group,
 		*pchanged_states = changed_states;
 }
 
-static u64 update_averages(struct psi_group *group, u64 now)
+/*
+ * The system averages are always maintained. Those of a cgroup only while
+ * they were read recently; the cumulative totals and the triggers do not
+ * depend on the averaging clock.
+ */
+static bool psi_avgs_monitored(struct psi_group *group)
+{
+	if (group == &psi_system)
+		return true;
+
+	return time_before(jiffies, READ_ONCE(group->avg_last_read) +
+				    PSI_AVGS_LAZY_TIMEOUT);
+}
+
+/*
+ * Nobody sampled the group since @group->avg_last_update, although there
+ * may have been activity. Feed the mean pressure over the whole span into
+ * all the periods it covers, instead of accounting it to the last one.
+ */
+static void catchup_averages(struct psi_group *group, u64 now,
+			     unsigned long periods)
+{
+	u64 span = now - group->avg_last_update;
+	int s;
+
+	for (s = 0; s < NR_PSI_STATES - 1; s++) {
+		unsigned long pct;
+		u64 sample;
+
+		sample = group->total[PSI_AVGS][s] - group->avg_total[s];
+		if (sample > span)
+			sample = span;
+		group->avg_total[s] += sample;
+
+		pct = div64_u64(sample * 100, span) * FIXED_1;
+		group->avg[s][0] = calc_load_n(group->avg[s][0], EXP_10s, pct, periods);
+		group->avg[s][1] = calc_load_n(group->avg[s][1], EXP_60s, pct, periods);
+		group->avg[s][2] = calc_load_n(group->avg[s][2], EXP_300s, pct, periods);
+	}
+}
+
+static u64 update_averages(struct psi_group *group, u64 now, bool catchup)
 {
 	unsigned long missed_periods = 0;
 	u64 expires, period;
@@ -404,6 +453,13 @@ static u64 update_averages(struct psi_group *group, u64 now)
 	 * are based on the actual time elapsing between clock ticks.
 	 */
 	avg_next_update = expires + ((1 + missed_periods) * psi_period);
+
+	if (catchup) {
+		catchup_averages(group, now, missed_periods + 1);
+		group->avg_last_update = now;
+		return avg_next_update;
+	}
+
 	period = now - (group->avg_last_update + (missed_periods * psi_period));
 	group->avg_last_update = now;
 
@@ -460,9 +516,10 @@ static void psi_avgs_work(struct work_struct *work)
 	 * go - see calc_avgs() and missed_periods.
 	 */
 	if (now >= group->avg_next_update)
-		group->avg_next_update = update_averages(group, now);
+		group->avg_next_update = update_averages(group, now, false);
 
-	if (changed_states & PSI_STATE_RESCHEDULE) {
+	if ((changed_states & PSI_STATE_RESCHEDULE) &&
+	    psi_avgs_monitored(group)) {
 		schedule_delayed_work(dwork, nsecs_to_jiffies(
 				group->avg_next_update - now) + 1);
 	}
@@ -854,7 +911,8 @@ static void psi_group_change(struct psi_group *group, int cpu,
 	if (state_mask & group->poll_states)
 		psi_schedule_poll_work(group, 1, false);
 
-	if (wake_clock && !delayed_work_pending(&group->avgs_work))
+	if (wake_clock && psi_avgs_monitored(group) &&
+	    !delayed_work_pending(&group->avgs_work))
 		schedule_delayed_work(&group->avgs_work, PSI_FREQ);
 }
 
@@ -1210,6 +1268,7 @@ void psi_cgroup_restart(struct psi_group *group)
 int psi_show(struct seq_file *m, struct psi_group *group, enum psi_res res)
 {
 	bool only_full = false;
+	bool catchup;
 	int full;
 	u64 now;
 
@@ -1219,9 +1278,11 @@ int psi_show(struct seq_file *m, struct psi_group *group, enum psi_res res)
 	/* Update averages before reporting them */
 	mutex_lock(&group->avgs_lock);
 	now = sched_clock();
+	catchup = !psi_avgs_monitored(group);
+	WRITE_ONCE(group->avg_last_read, jiffies);
 	collect_percpu_times(group, PSI_AVGS, NULL);
 	if (now >= group->avg_next_update)
-		group->avg_next_update = update_averages(group, now);
+		group->avg_next_update = update_averages(group, now, catchup);
 	mutex_unlock(&group->avgs_lock);
 
 #ifdef CONFIG_IRQ_TIME_ACCOUNTING
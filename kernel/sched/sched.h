@@ -40,6 +40,7 @@
 #include <linux/kref_api.h>
 #include <linux/kthread.h>
 #include <linux/ktime_api.h>
+#include <linux/latency_hist.h>
 #include <linux/lockdep_api.h>
 #include <linux/lockdep.h>
 #include <linux/minmax.h>
@@ -379,6 +380,9 @@ struct task_group {
 	/* A positive value indicates that this is a SCHED_IDLE group. */
 	int			idle;
 
+	/* Latency hint for the group's entities, see sched_slice() */
+	int			latency_nice;
+
 #ifdef	CONFIG_SMP
 	/*
 	 * load_avg can be heavily contended at clock tick time, so put
@@ -487,6 +491,7 @@ extern void sched_move_task(struct task_struct *tsk);
 extern int sched_group_set_shares(struct task_group *tg, unsigned long shares);
 
 extern int sched_group_set_idle(struct task_group *tg, long idle);
+extern int sched_group_set_latency_nice(struct task_group *tg, int latency_nice);
 
 #ifdef CONFIG_SMP
 extern void set_task_rq_fair(struct sched_entity *se,
@@ -645,6 +650,9 @@ struct cfs_rq {
 	int			throttled;
 	int			throttle_count;
 	struct list_head	throttled_list;
+#ifdef CONFIG_SMP
+	struct list_head	throttled_csd_list;
+#endif
 #endif /* CONFIG_CFS_BANDWIDTH */
 #endif /* CONFIG_FAIR_GROUP_SCHED */
 };
@@ -1154,6 +1162,12 @@ struct rq {
 
 	/* Scratch cpumask to be temporarily used under rq_lock */
 	cpumask_var_t		scratch_mask;
+
+#if defined(CONFIG_CFS_BANDWIDTH) && defined(CONFIG_SMP)
+	/* cfs_rqs unthrottled remotely by a period or slack timer */
+	call_single_data_t	cfsb_csd;
+	struct list_head	cfsb_csd_list;
+#endif
 };
 
 #ifdef CONFIG_FAIR_GROUP_SCHED
@@ -1402,6 +1416,50 @@ static inline void update_idle_core(struct rq *rq)
 static inline void update_idle_core(struct rq *rq) { }
 #endif
 
+#ifdef CONFIG_SMP
+extern void update_idle_cpumask(int cpu, bool idle);
+#else
+static inline void update_idle_cpumask(int cpu, bool idle) { }
+#endif
+
+#ifdef CONFIG_SCHED_FAIR_OPS
+DECLARE_STATIC_KEY_FALSE(sched_fair_ops_enabled);
+extern int __sched_fair_ops_select_cpu(struct task_struct *p, int prev_cpu,
+				       int wake_flags);
+extern int __sched_fair_ops_wakeup_preempt(struct task_struct *p,
+					   struct task_struct *curr);
+
+/* Returns the CPU picked by the BPF policy, or -1 to let CFS pick */
+static inline int sched_fair_ops_select_cpu(struct task_struct *p,
+					    int prev_cpu, int wake_flags)
+{
+	if (static_branch_unlikely(&sched_fair_ops_enabled))
+		return __sched_fair_ops_select_cpu(p, prev_cpu, wake_flags);
+	return -1;
+}
+
+/* Returns 1 to preempt @curr, 0 not to, or -1 to let CFS decide */
+static inline int sched_fair_ops_wakeup_preempt(struct task_struct *p,
+						struct task_struct *curr)
+{
+	if (static_branch_unlikely(&sched_fair_ops_enabled))
+		return __sched_fair_ops_wakeup_preempt(p, curr);
+	return -1;
+}
+#else
+static inline int sched_fair_ops_select_cpu(struct task_struct *p,
+					    int prev_cpu, int wake_flags)
+{
+	return -1;
+}
+
+static inline int sched_fair_ops_wakeup_preempt(struct task_struct *p,
+						struct task_struct *curr)
+{
+	return -1;
+}
+#endif
+
 #ifdef CONFIG_FAIR_GROUP_SCHED
 static inline struct task_struct *task_of(struct sched_entity *se)
 {
@@ -1730,6 +1788,12 @@ init_numa_balancing(unsigned long clone_flags, struct task_struct *p)
 }
 #endif /* CONFIG_NUMA_BALANCING */
 
+#ifdef CONFIG_SCHED_CACHE
+extern void init_sched_mm(struct task_struct *p);
+#else
+static inline void init_sched_mm(struct task_struct *p) { }
+#endif
+
 #ifdef CONFIG_SMP
 
 static inline void
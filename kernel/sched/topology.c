@@ -1641,6 +1641,13 @@ sd_init(struct sched_domain_topology_level *tl,
 		sd->shared = *per_cpu_ptr(sdd->sds, sd_id);
 		atomic_inc(&sd->shared->ref);
 		atomic_set(&sd->shared->nr_busy_cpus, sd_weight);
+		/*
+		 * Start from all CPUs. A CPU sets its bit when it switches to
+		 * idle and clears it when it switches away, so a busy CPU
+		 * shows as idle until its next switch out of idle, but no
+		 * idle CPU is missing from the mask.
+		 */
+		cpumask_copy(sds_idle_cpus(sd->shared), sd_span);
 	}
 
 	sd->private = sdd;
@@ -2106,7 +2113,7 @@ static int __sdt_alloc(const struct cpumask *cpu_map)
 
 			*per_cpu_ptr(sdd->sd, j) = sd;
 
-			sds = kzalloc_node(sizeof(struct sched_domain_shared),
+			sds = kzalloc_node(sizeof(struct sched_domain_shared) + cpumask_size(),
 					GFP_KERNEL, cpu_to_node(j));
 			if (!sds)
 				return -ENOMEM;
@@ -27,6 +27,7 @@
 #include <linux/tick.h>
 #include <linux/irq.h>
 #include <linux/wait_bit.h>
+#include <linux/latency_hist.h>
 
 #include <asm/softirq_stack.h>
 
@@ -559,6 +560,7 @@ restart:
 	while ((softirq_bit = ffs(pending))) {
 		unsigned int vec_nr;
 		int prev_count;
+		u64 start;
 
 		h += softirq_bit - 1;
 
@@ -568,7 +570,9 @@ restart:
 		kstat_incr_softirqs_this_cpu(vec_nr);
 
 		trace_softirq_entry(vec_nr);
+		start = lat_hist_start();
 		h->action(h);
+		lat_hist_end(LAT_HIST_SOFTIRQ, vec_nr, start);
 		trace_softirq_exit(vec_nr);
 		if (unlikely(prev_count != preempt_count())) {
 			pr_err("huh, entered softirq %u %s %p with preempt_count %08x, exited with %08x?\n",
@@ -2639,6 +2639,17 @@ SYSCALL_DEFINE5(prctl, int, option, unsigned long, arg2, unsigned long, arg3,
 	case PR_SET_VMA:
 		error = prctl_set_vma(arg2, arg3, arg4, arg5);
 		break;
+	case PR_SET_LATENCY_NICE:
+		if (arg3 || arg4 || arg5)
+			return -EINVAL;
+		error = sched_set_latency_nice(me, (int)arg2);
+		break;
+	case PR_GET_LATENCY_NICE:
+		if (arg3 || arg4 || arg5)
+			return -EINVAL;
+		error = put_user(READ_ONCE(me->se.latency_nice),
+				 (int __user *)arg2);
+		break;
 	default:
 		error = -EINVAL;
 		break;
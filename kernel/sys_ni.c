@@ -214,6 +214,10 @@ COND_SYSCALL(msgrcv);
 COND_SYSCALL_COMPAT(msgrcv);
 COND_SYSCALL(msgsnd);
 COND_SYSCALL_COMPAT(msgsnd);
+COND_SYSCALL(msgrcv_batch);
+COND_SYSCALL_COMPAT(msgrcv_batch);
+COND_SYSCALL(msgsnd_batch);
+COND_SYSCALL_COMPAT(msgsnd_batch);
 
 /* ipc/sem.c */
 COND_SYSCALL(semget);
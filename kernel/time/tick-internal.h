@@ -166,6 +166,25 @@ DECLARE_PER_CPU(struct hrtimer_cpu_base, hrtimer_bases);
 extern u64 get_next_timer_interrupt(unsigned long basej, u64 basem);
 void timer_clear_idle(void);
 
+#if defined(CONFIG_SMP) && defined(CONFIG_NO_HZ_COMMON)
+extern void timer_expire_remote(unsigned int cpu);
+extern bool fetch_next_timer_interrupt_remote(unsigned int cpu,
+					      unsigned long *next);
+
+extern void tmigr_handle_remote(void);
+extern bool tmigr_requires_handle_remote(void);
+extern void tmigr_cpu_activate(void);
+extern bool tmigr_cpu_deactivate(bool pending, unsigned long *next);
+#else
+static inline void tmigr_handle_remote(void) { }
+static inline bool tmigr_requires_handle_remote(void) { return false; }
+static inline void tmigr_cpu_activate(void) { }
+static inline bool tmigr_cpu_deactivate(bool pending, unsigned long *next)
+{
+	return pending;
+}
+#endif
+
 #define CLOCK_SET_WALL							\
 	(BIT(HRTIMER_BASE_REALTIME) | BIT(HRTIMER_BASE_REALTIME_SOFT) |	\
 	 BIT(HRTIMER_BASE_TAI) | BIT(HRTIMER_BASE_TAI_SOFT))
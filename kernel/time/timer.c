@@ -41,6 +41,7 @@
 #include <linux/sched/sysctl.h>
 #include <linux/sched/nohz.h>
 #include <linux/sched/debug.h>
+#include <linux/sched/isolation.h>
 #include <linux/slab.h>
 #include <linux/compat.h>
 #include <linux/random.h>
@@ -181,18 +182,21 @@ EXPORT_SYMBOL(jiffies_64);
 #define WHEEL_TIMEOUT_MAX	(WHEEL_TIMEOUT_CUTOFF - LVL_GRAN(LVL_DEPTH - 1))
 
 /*
- * The resulting wheel size. If NOHZ is configured we allocate two
- * wheels so we have a separate storage for the deferrable timers.
+ * The resulting wheel size. If NOHZ is configured we allocate three
+ * wheels: pinned timers, non pinned (global) timers which idle CPUs hand
+ * over to the timer migration groups, and deferrable timers.
  */
 #define WHEEL_SIZE	(LVL_SIZE * LVL_DEPTH)
 
 #ifdef CONFIG_NO_HZ_COMMON
-# define NR_BASES	2
-# define BASE_STD	0
-# define BASE_DEF	1
+# define NR_BASES	3
+# define BASE_LOCAL	0
+# define BASE_GLOBAL	1
+# define BASE_DEF	2
 #else
 # define NR_BASES	1
-# define BASE_STD	0
+# define BASE_LOCAL	0
+# define BASE_GLOBAL	0
 # define BASE_DEF	0
 #endif
 
@@ -230,10 +234,23 @@ DEFINE_STATIC_KEY_FALSE(timers_migration_enabled);
 
 static void timers_update_migration(void)
 {
-	if (sysctl_timer_migration && tick_nohz_active)
+	unsigned int cpu;
+
+	if (sysctl_timer_migration && tick_nohz_active) {
 		static_branch_enable(&timers_migration_enabled);
-	else
-		static_branch_disable(&timers_migration_enabled);
+		return;
+	}
+
+	if (!static_key_enabled(&timers_migration_enabled))
+		return;
+
+	static_branch_disable(&timers_migration_enabled);
+
+	/* Idle CPUs have to wake up for their global timers themselves again */
+	cpus_read_lock();
+	for_each_online_cpu(cpu)
+		wake_up_nohz_cpu(cpu);
+	cpus_read_unlock();
 }
 
 #ifdef CONFIG_SYSCTL
@@ -587,9 +604,15 @@ trigger_dyntick_cpu(struct timer_base *base, struct timer_list *timer)
 	/*
 	 * We might have to IPI the remote CPU if the base is idle and the
 	 * timer is not deferrable. If the other CPU is on the way to idle
-	 * then it can't set base->is_idle as we hold the base lock:
+	 * then it can't set base->is_idle as we hold the base lock.
+	 *
+	 * A non pinned timer only ends up on an idle base when it is rearmed
+	 * while running. The expiry in progress, either on the idle CPU
+	 * itself or remotely on behalf of it, picks up the new expiry, so
+	 * there is no need to wake the CPU up:
 	 */
-	if (base->is_idle)
+	if (base->is_idle && (timer->flags & TIMER_PINNED ||
+			      base->running_timer != timer))
 		wake_up_nohz_cpu(base->cpu);
 }
 
@@ -900,30 +923,25 @@ static int detach_if_pending(struct timer_list *timer, struct timer_base *base,
 	return 1;
 }
 
-static inline struct timer_base *get_timer_cpu_base(u32 tflags, u32 cpu)
+static inline unsigned int get_timer_base_index(u32 tflags)
 {
-	struct timer_base *base = per_cpu_ptr(&timer_bases[BASE_STD], cpu);
-
 	/*
 	 * If the timer is deferrable and NO_HZ_COMMON is set then we need
 	 * to use the deferrable base.
 	 */
 	if (IS_ENABLED(CONFIG_NO_HZ_COMMON) && (tflags & TIMER_DEFERRABLE))
-		base = per_cpu_ptr(&timer_bases[BASE_DEF], cpu);
-	return base;
+		return BASE_DEF;
+	return tflags & TIMER_PINNED ? BASE_LOCAL : BASE_GLOBAL;
 }
 
-static inline struct timer_base *get_timer_this_cpu_base(u32 tflags)
+static inline struct timer_base *get_timer_cpu_base(u32 tflags, u32 cpu)
 {
-	struct timer_base *base = this_cpu_ptr(&timer_bases[BASE_STD]);
+	return per_cpu_ptr(&timer_bases[get_timer_base_index(tflags)], cpu);
+}
 
-	/*
-	 * If the timer is deferrable and NO_HZ_COMMON is set then we need
-	 * to use the deferrable base.
-	 */
-	if (IS_ENABLED(CONFIG_NO_HZ_COMMON) && (tflags & TIMER_DEFERRABLE))
-		base = this_cpu_ptr(&timer_bases[BASE_DEF]);
-	return base;
+static inline struct timer_base *get_timer_this_cpu_base(u32 tflags)
+{
+	return this_cpu_ptr(&timer_bases[get_timer_base_index(tflags)]);
 }
 
 static inline struct timer_base *get_timer_base(u32 tflags)
@@ -935,8 +953,14 @@ static inline struct timer_base *
 get_target_base(struct timer_base *base, unsigned tflags)
 {
 #if defined(CONFIG_SMP) && defined(CONFIG_NO_HZ_COMMON)
+	/*
+	 * Non pinned timers stay on the local CPU; when it goes idle, they
+	 * are pulled by an active CPU of its timer migration group. Only
+	 * CPUs excluded from timer housekeeping still push them away.
+	 */
 	if (static_branch_likely(&timers_migration_enabled) &&
-	    !(tflags & TIMER_PINNED))
+	    !(tflags & TIMER_PINNED) &&
+	    !housekeeping_cpu(smp_processor_id(), HK_TYPE_TIMER))
 		return get_timer_cpu_base(tflags, get_nohz_timer_target());
 #endif
 	return get_timer_this_cpu_base(tflags);
@@ -1264,6 +1288,9 @@ void add_timer_on(struct timer_list *timer, int cpu)
 	if (WARN_ON_ONCE(timer_pending(timer)))
 		return;
 
+	/* The timer must not be expired remotely on behalf of an idle @cpu */
+	timer->flags |= TIMER_PINNED;
+
 	new_base = get_timer_cpu_base(timer->flags, cpu);
 
 	/*
@@ -1910,28 +1937,15 @@ static u64 cmp_next_hrtimer_event(u64 basem, u64 expires)
 	return DIV_ROUND_UP_ULL(nextevt, TICK_NSEC) * TICK_NSEC;
 }
 
-/**
- * get_next_timer_interrupt - return the time (clock mono) of the next timer
- * @basej:	base time jiffies
- * @basem:	base time clock monotonic
- *
- * Returns the tick aligned clock monotonic time of the next pending
- * timer or KTIME_MAX if no timer is pending.
+/*
+ * Recalculate the next expiry of @base if required and forward its clock.
+ * Caller must hold base->lock.
  */
-u64 get_next_timer_interrupt(unsigned long basej, u64 basem)
+static unsigned long next_timer_interrupt_forward(struct timer_base *base,
+						  unsigned long basej)
 {
-	struct timer_base *base = this_cpu_ptr(&timer_bases[BASE_STD]);
-	u64 expires = KTIME_MAX;
 	unsigned long nextevt;
 
-	/*
-	 * Pretend that there is no timer pending if the cpu is offline.
-	 * Possible pending timers will be migrated later to an active cpu.
-	 */
-	if (cpu_is_offline(smp_processor_id()))
-		return expires;
-
-	raw_spin_lock(&base->lock);
 	if (base->next_expiry_recalc)
 		base->next_expiry = __next_timer_interrupt(base);
 	nextevt = base->next_expiry;
@@ -1948,23 +1962,91 @@ u64 get_next_timer_interrupt(unsigned long basej, u64 basem)
 			base->clk = nextevt;
 	}
 
-	if (time_before_eq(nextevt, basej)) {
+	return nextevt;
+}
+
+static inline u64 timer_expiry_to_ns(unsigned long nextevt, unsigned long basej,
+				     u64 basem)
+{
+	if (time_before_eq(nextevt, basej))
+		return basem;
+	return basem + (u64)(nextevt - basej) * TICK_NSEC;
+}
+
+/**
+ * get_next_timer_interrupt - return the time (clock mono) of the next timer
+ * @basej:	base time jiffies
+ * @basem:	base time clock monotonic
+ *
+ * Returns the tick aligned clock monotonic time of the next pending
+ * timer or KTIME_MAX if no timer is pending.
+ *
+ * When the tick is going to be stopped, the global timers of the CPU are
+ * handed over to its timer migration group; the CPU then only has to wake
+ * up for them if it is the last active CPU of the group.
+ */
+u64 get_next_timer_interrupt(unsigned long basej, u64 basem)
+{
+	struct timer_base *base_local = this_cpu_ptr(&timer_bases[BASE_LOCAL]);
+	struct timer_base *base_global = this_cpu_ptr(&timer_bases[BASE_GLOBAL]);
+	unsigned long next_local, next_global;
+	u64 expires = KTIME_MAX, expires_global = KTIME_MAX;
+	bool idle = false;
+
+	/*
+	 * Pretend that there is no timer pending if the cpu is offline.
+	 * Possible pending timers will be migrated later to an active cpu.
+	 */
+	if (cpu_is_offline(smp_processor_id()))
+		return expires;
+
+	raw_spin_lock(&base_local->lock);
+	raw_spin_lock_nested(&base_global->lock, SINGLE_DEPTH_NESTING);
+
+	next_local = next_timer_interrupt_forward(base_local, basej);
+	next_global = next_timer_interrupt_forward(base_global, basej);
+
+	if (time_before_eq(next_local, basej) ||
+	    time_before_eq(next_global, basej)) {
 		expires = basem;
-		base->is_idle = false;
 	} else {
-		if (base->timers_pending)
-			expires = basem + (u64)(nextevt - basej) * TICK_NSEC;
+		if (base_local->timers_pending)
+			expires = timer_expiry_to_ns(next_local, basej, basem);
+		if (base_global->timers_pending)
+			expires_global = timer_expiry_to_ns(next_global, basej,
+							    basem);
 		/*
-		 * If we expect to sleep more than a tick, mark the base idle.
+		 * If we expect to sleep more than a tick, mark the bases idle.
 		 * Also the tick is stopped so any added timer must forward
 		 * the base clk itself to keep granularity small. This idle
-		 * logic is only maintained for the BASE_STD base, deferrable
-		 * timers may still see large granularity skew (by design).
+		 * logic is only maintained for the local and global bases,
+		 * deferrable timers may still see large granularity skew (by
+		 * design).
 		 */
-		if ((expires - basem) > TICK_NSEC)
-			base->is_idle = true;
+		idle = (min(expires, expires_global) - basem) > TICK_NSEC;
+
+		if (idle) {
+			/*
+			 * Hand the global timers over to the timer migration
+			 * group; @next_global is updated to the group expiry
+			 * this CPU has to take care of, if any.
+			 */
+			if (tmigr_cpu_deactivate(base_global->timers_pending,
+						 &next_global))
+				expires_global = timer_expiry_to_ns(next_global,
+								    basej,
+								    basem);
+			else
+				expires_global = KTIME_MAX;
+		}
+		expires = min(expires, expires_global);
 	}
-	raw_spin_unlock(&base->lock);
+
+	base_local->is_idle = idle;
+	base_global->is_idle = idle;
+
+	raw_spin_unlock(&base_global->lock);
+	raw_spin_unlock(&base_local->lock);
 
 	return cmp_next_hrtimer_event(basem, expires);
 }
@@ -1976,15 +2058,17 @@ u64 get_next_timer_interrupt(unsigned long basej, u64 basem)
  */
 void timer_clear_idle(void)
 {
-	struct timer_base *base = this_cpu_ptr(&timer_bases[BASE_STD]);
-
 	/*
 	 * We do this unlocked. The worst outcome is a remote enqueue sending
 	 * a pointless IPI, but taking the lock would just make the window for
 	 * sending the IPI a few instructions smaller for the cost of taking
 	 * the lock in the exit from idle path.
 	 */
-	base->is_idle = false;
+	__this_cpu_write(timer_bases[BASE_LOCAL].is_idle, false);
+	__this_cpu_write(timer_bases[BASE_GLOBAL].is_idle, false);
+
+	/* The CPU takes care of its global timers itself again */
+	tmigr_cpu_activate();
 }
 #endif
 
@@ -2003,6 +2087,13 @@ static inline void __run_timers(struct timer_base *base)
 	timer_base_lock_expiry(base);
 	raw_spin_lock_irq(&base->lock);
 
+	/*
+	 * The global base of an idle CPU may be expired remotely while its
+	 * owner wakes up; whoever got there first expires all due timers.
+	 */
+	if (base->running_timer)
+		goto out_unlock;
+
 	while (time_after_eq(jiffies, base->clk) &&
 	       time_after_eq(jiffies, base->next_expiry)) {
 		levels = collect_expired_timers(base, heads);
@@ -2021,20 +2112,60 @@ static inline void __run_timers(struct timer_base *base)
 		while (levels--)
 			expire_timers(base, heads + levels);
 	}
+out_unlock:
 	raw_spin_unlock_irq(&base->lock);
 	timer_base_unlock_expiry(base);
 }
 
+#if defined(CONFIG_SMP) && defined(CONFIG_NO_HZ_COMMON)
+/**
+ * timer_expire_remote - Expire the global timers of an idle CPU
+ * @cpu:	The idle CPU
+ *
+ * Called from the timer migration code on behalf of an idle CPU of the
+ * same group.
+ */
+void timer_expire_remote(unsigned int cpu)
+{
+	__run_timers(per_cpu_ptr(&timer_bases[BASE_GLOBAL], cpu));
+}
+
+/**
+ * fetch_next_timer_interrupt_remote - First global expiry of a remote CPU
+ * @cpu:	The remote CPU
+ * @next:	Filled with the expiry (jiffies) of the first global timer
+ *
+ * Returns true if the global base of @cpu has a timer queued.
+ */
+bool fetch_next_timer_interrupt_remote(unsigned int cpu, unsigned long *next)
+{
+	struct timer_base *base = per_cpu_ptr(&timer_bases[BASE_GLOBAL], cpu);
+	bool pending;
+
+	raw_spin_lock_irq(&base->lock);
+	if (base->next_expiry_recalc)
+		base->next_expiry = __next_timer_interrupt(base);
+	*next = base->next_expiry;
+	pending = base->timers_pending;
+	raw_spin_unlock_irq(&base->lock);
+
+	return pending;
+}
+#endif
+
 /*
  * This function runs timers and the timer-tq in bottom half context.
  */
 static __latent_entropy void run_timer_softirq(struct softirq_action *h)
 {
-	struct timer_base *base = this_cpu_ptr(&timer_bases[BASE_STD]);
+	struct timer_base *base = this_cpu_ptr(&timer_bases[BASE_LOCAL]);
 
 	__run_timers(base);
-	if (IS_ENABLED(CONFIG_NO_HZ_COMMON))
+	if (IS_ENABLED(CONFIG_NO_HZ_COMMON)) {
+		__run_timers(this_cpu_ptr(&timer_bases[BASE_GLOBAL]));
 		__run_timers(this_cpu_ptr(&timer_bases[BASE_DEF]));
+		tmigr_handle_remote();
+	}
 }
 
 /*
@@ -2042,19 +2173,22 @@ static __latent_entropy void run_timer_softirq(struct softirq_action *h)
  */
 static void run_local_timers(void)
 {
-	struct timer_base *base = this_cpu_ptr(&timer_bases[BASE_STD]);
+	struct timer_base *base = this_cpu_ptr(&timer_bases[BASE_LOCAL]);
 
 	hrtimer_run_queues();
-	/* Raise the softirq only if required. */
-	if (time_before(jiffies, base->next_expiry)) {
-		if (!IS_ENABLED(CONFIG_NO_HZ_COMMON))
-			return;
-		/* CPU is awake, so check the deferrable base. */
-		base++;
-		if (time_before(jiffies, base->next_expiry))
+
+	/*
+	 * Raise the softirq only if required. The CPU is awake, so check the
+	 * deferrable base and the global timers of idle group members as
+	 * well.
+	 */
+	for (int i = 0; i < NR_BASES; i++, base++) {
+		if (time_after_eq(jiffies, base->next_expiry) ||
+		    (i == BASE_DEF && tmigr_requires_handle_remote())) {
+			raise_softirq(TIMER_SOFTIRQ);
 			return;
+		}
 	}
-	raise_softirq(TIMER_SOFTIRQ);
 }
 
 /*
@@ -0,0 +1,327 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+ * Infrastructure for migratable timers
+ *
+ * Non pinned timers are queued on the CPU which arms them. When a CPU stops
+ * its tick, it does not push those timers to a busy CPU; instead it
+ * publishes the first expiry of its global timer base to its group and an
+ * active group member - the migrator - pulls and expires them when they are
+ * due. An idle CPU therefore only needs to wake up for its pinned timers,
+ * unless it is the last CPU of the group going idle: that one has to take
+ * care of the first global timer of the whole group.
+ *
+ * The timers of all idle CPUs of a group which expire in the same jiffy are
+ * handled by one CPU in one pass of the timer softirq, so a group of idle
+ * CPUs only sees a single wakeup for them.
+ */
+
+#include <linux/cpuhotplug.h>
+#include <linux/jiffies.h>
+#include <linux/slab.h>
+#include <linux/smp.h>
+#include <linux/spinlock.h>
+#include <linux/timer.h>
+#include <linux/sched/isolation.h>
+#include <linux/sched/nohz.h>
+
+#include "tick-internal.h"
+#include "timer_migration.h"
+
+static struct tmigr_group *tmigr_groups __read_mostly;
+static DEFINE_PER_CPU(struct tmigr_cpu, tmigr_cpu);
+
+/*
+ * The timerqueue compares its keys as plain integers, which a wrapping
+ * jiffies value can't be. Extend @j to 64 bits around the current time.
+ */
+static u64 tmigr_jiffies_64(unsigned long j)
+{
+	u64 now = get_jiffies_64();
+
+	return now + (long)(j - (unsigned long)now);
+}
+
+/*
+ * Update the published expiry of @tmc and propagate the first expiry of the
+ * group to the lockless readers.
+ */
+static void tmigr_update_cpu(struct tmigr_group *group, struct tmigr_cpu *tmc,
+			     bool pending, unsigned long next)
+{
+	struct timerqueue_node *first;
+
+	if (timerqueue_node_queued(&tmc->event))
+		timerqueue_del(&group->events, &tmc->event);
+
+	if (pending) {
+		tmc->event.expires = tmigr_jiffies_64(next);
+		timerqueue_add(&group->events, &tmc->event);
+	}
+
+	first = timerqueue_getnext(&group->events);
+	if (first)
+		WRITE_ONCE(group->next_expiry, (unsigned long)first->expires);
+	WRITE_ONCE(group->timers_pending, !!first);
+}
+
+static void tmigr_set_migrator(struct tmigr_group *group)
+{
+	WRITE_ONCE(group->migrator, cpumask_first(group->active));
+}
+
+/**
+ * tmigr_cpu_activate - Mark the current CPU active again
+ *
+ * Called with interrupts disabled when the tick of the CPU is restarted. The
+ * CPU takes care of its own global timers from now on.
+ */
+void tmigr_cpu_activate(void)
+{
+	struct tmigr_cpu *tmc = this_cpu_ptr(&tmigr_cpu);
+	struct tmigr_group *group = tmc->group;
+	unsigned int cpu = smp_processor_id();
+
+	if (!tmc->online || !tmc->idle)
+		return;
+
+	raw_spin_lock(&group->lock);
+	tmc->idle = false;
+	cpumask_set_cpu(cpu, group->active);
+	if (group->migrator >= nr_cpu_ids)
+		WRITE_ONCE(group->migrator, cpu);
+	tmigr_update_cpu(group, tmc, false, 0);
+	raw_spin_unlock(&group->lock);
+}
+
+/**
+ * tmigr_cpu_deactivate - Hand the global timers of the current CPU to its group
+ * @pending:	Whether the global timer base of the CPU has a timer queued
+ * @next:	Expiry (jiffies) of the first global timer of the CPU; on
+ *		return the global expiry the CPU has to wake up for
+ *
+ * Called with interrupts disabled and the timer bases of the CPU locked when
+ * the tick is about to be stopped.
+ *
+ * Returns true when the CPU has to wake up for @next; that is when it does
+ * not take part in timer migration or when it is the last active CPU of its
+ * group.
+ */
+bool tmigr_cpu_deactivate(bool pending, unsigned long *next)
+{
+	struct tmigr_cpu *tmc = this_cpu_ptr(&tmigr_cpu);
+	struct tmigr_group *group = tmc->group;
+	unsigned int cpu = smp_processor_id();
+	bool ret = false;
+
+	if (!tmc->online)
+		return pending;
+
+	raw_spin_lock(&group->lock);
+	if (!tmc->idle) {
+		tmc->idle = true;
+		cpumask_clear_cpu(cpu, group->active);
+		if (group->migrator == cpu)
+			tmigr_set_migrator(group);
+	}
+	tmc->seq++;
+	tmigr_update_cpu(group, tmc, pending, *next);
+
+	if (!static_branch_likely(&timers_migration_enabled)) {
+		ret = pending;
+	} else if (cpumask_empty(group->active)) {
+		ret = group->timers_pending;
+		*next = group->next_expiry;
+	}
+	raw_spin_unlock(&group->lock);
+
+	return ret;
+}
+
+/**
+ * tmigr_requires_handle_remote - Check whether remote timers are due
+ *
+ * Called from the tick. Only the migrator of the group, or any member while
+ * the whole group is idle, expires the timers of the idle members.
+ */
+bool tmigr_requires_handle_remote(void)
+{
+	struct tmigr_cpu *tmc = this_cpu_ptr(&tmigr_cpu);
+	struct tmigr_group *group = tmc->group;
+	unsigned int migrator;
+
+	if (!static_branch_likely(&timers_migration_enabled) || !tmc->online)
+		return false;
+
+	if (!READ_ONCE(group->timers_pending))
+		return false;
+
+	migrator = READ_ONCE(group->migrator);
+	if (migrator < nr_cpu_ids && migrator != smp_processor_id())
+		return false;
+
+	return time_after_eq(jiffies, READ_ONCE(group->next_expiry));
+}
+
+/**
+ * tmigr_handle_remote - Expire the due global timers of idle group members
+ *
+ * Called from the timer softirq.
+ */
+void tmigr_handle_remote(void)
+{
+	struct tmigr_group *group;
+	unsigned int nr;
+	u64 jnow;
+
+	if (!tmigr_requires_handle_remote())
+		return;
+
+	group = this_cpu_ptr(&tmigr_cpu)->group;
+	jnow = get_jiffies_64();
+
+	raw_spin_lock_irq(&group->lock);
+	/*
+	 * A CPU whose timers were expired here may publish an expiry which is
+	 * already due again; leave that to the next tick rather than loop.
+	 */
+	nr = cpumask_weight(group->cpus);
+	while (nr--) {
+		struct timerqueue_node *first;
+		struct tmigr_cpu *tmc;
+		unsigned long next;
+		unsigned int seq;
+		bool pending;
+
+		first = timerqueue_getnext(&group->events);
+		if (!first || (u64)first->expires > jnow)
+			break;
+		tmc = container_of(first, struct tmigr_cpu, event);
+
+		/*
+		 * Take the CPU out of the group expiry while its timers are
+		 * expired here. If it goes idle again meanwhile it publishes
+		 * a fresh expiry itself, which must not be overwritten.
+		 */
+		tmigr_update_cpu(group, tmc, false, 0);
+		tmc->remote = true;
+		seq = tmc->seq;
+		raw_spin_unlock_irq(&group->lock);
+
+		timer_expire_remote(tmc->cpu);
+		pending = fetch_next_timer_interrupt_remote(tmc->cpu, &next);
+
+		raw_spin_lock_irq(&group->lock);
+		tmc->remote = false;
+		if (tmc->idle && tmc->seq == seq)
+			tmigr_update_cpu(group, tmc, pending, next);
+	}
+	raw_spin_unlock_irq(&group->lock);
+}
+
+static int tmigr_cpu_online(unsigned int cpu)
+{
+	struct tmigr_cpu *tmc = per_cpu_ptr(&tmigr_cpu, cpu);
+	struct tmigr_group *group;
+	int node;
+
+	/* CPUs excluded from timer housekeeping handle their timers alone */
+	if (!housekeeping_cpu(cpu, HK_TYPE_TIMER))
+		return 0;
+
+	node = cpu_to_node(cpu);
+	if (node == NUMA_NO_NODE)
+		node = 0;
+	group = &tmigr_groups[node];
+
+	raw_spin_lock_irq(&group->lock);
+	tmc->group = group;
+	tmc->cpu = cpu;
+	tmc->idle = false;
+	timerqueue_init(&tmc->event);
+	cpumask_set_cpu(cpu, group->cpus);
+	cpumask_set_cpu(cpu, group->active);
+	if (group->migrator >= nr_cpu_ids)
+		WRITE_ONCE(group->migrator, cpu);
+	WRITE_ONCE(tmc->online, true);
+	raw_spin_unlock_irq(&group->lock);
+
+	return 0;
+}
+
+static int tmigr_cpu_offline(unsigned int cpu)
+{
+	struct tmigr_cpu *tmc = per_cpu_ptr(&tmigr_cpu, cpu);
+	struct tmigr_group *group = tmc->group;
+	unsigned int target = nr_cpu_ids;
+
+	if (!tmc->online)
+		return 0;
+
+	raw_spin_lock_irq(&group->lock);
+	WRITE_ONCE(tmc->online, false);
+
+	/*
+	 * The timers of the CPU are migrated when it is dead; a remote
+	 * expiry of its global base has to be finished by then.
+	 */
+	while (tmc->remote) {
+		raw_spin_unlock_irq(&group->lock);
+		cpu_relax();
+		raw_spin_lock_irq(&group->lock);
+	}
+
+	tmigr_update_cpu(group, tmc, false, 0);
+	cpumask_clear_cpu(cpu, group->cpus);
+	cpumask_clear_cpu(cpu, group->active);
+	if (group->migrator == cpu)
+		tmigr_set_migrator(group);
+
+	/* Make an idle member pick up the group timers if nobody is left */
+	if (group->timers_pending && cpumask_empty(group->active))
+		target = cpumask_first(group->cpus);
+	raw_spin_unlock_irq(&group->lock);
+
+	if (target < nr_cpu_ids)
+		wake_up_nohz_cpu(target);
+
+	return 0;
+}
+
+static int __init tmigr_init(void)
+{
+	int node, ret = -ENOMEM;
+
+	tmigr_groups = kcalloc(nr_node_ids, sizeof(*tmigr_groups), GFP_KERNEL);
+	if (!tmigr_groups)
+		goto err;
+
+	for (node = 0; node < nr_node_ids; node++) {
+		struct tmigr_group *group = &tmigr_groups[node];
+
+		raw_spin_lock_init(&group->lock);
+		timerqueue_init_head(&group->events);
+		group->migrator = nr_cpu_ids;
+		if (!zalloc_cpumask_var(&group->cpus, GFP_KERNEL) ||
+		    !zalloc_cpumask_var(&group->active, GFP_KERNEL))
+			goto err_free;
+	}
+
+	ret = cpuhp_setup_state(CPUHP_AP_ONLINE_DYN, "tmigr:online",
+				tmigr_cpu_online, tmigr_cpu_offline);
+	if (ret < 0)
+		goto err_free;
+
+	return 0;
+
+err_free:
+	for (node = 0; node < nr_node_ids; node++) {
+		free_cpumask_var(tmigr_groups[node].cpus);
+		free_cpumask_var(tmigr_groups[node].active);
+	}
+	kfree(tmigr_groups);
+	tmigr_groups = NULL;
+err:
+	pr_err("Timer migration setup failed\n");
+	return ret;
+}
+early_initcall(tmigr_init);
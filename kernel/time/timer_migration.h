@@ -0,0 +1,59 @@
+/* SPDX-License-Identifier: GPL-2.0-only */
+#ifndef _KERNEL_TIME_MIGRATION_H
+#define _KERNEL_TIME_MIGRATION_H
+
+#include <linux/timerqueue.h>
+
+/**
+ * struct tmigr_group - timer migration group
+ * @lock:		Lock protecting the group and the per CPU state of
+ *			its members
+ * @migrator:		CPU which expires the timers of idle group members;
+ *			>= nr_cpu_ids when all members are idle
+ * @timers_pending:	Whether @next_expiry is valid
+ * @next_expiry:	First expiry (jiffies) of the global timers of the
+ *			idle group members, the first entry of @events
+ * @events:		Published expiries of the idle group members, ordered
+ *			by 64-bit jiffies
+ * @cpus:		Online CPUs of the group
+ * @active:		Group members which have their tick running
+ *
+ * All CPUs of a NUMA node form a group. An idle CPU hands its non pinned
+ * (global) timers to the group; they are expired by the migrator, or, when
+ * the whole group is idle, by the CPU which went idle last. Publishing an
+ * expiry costs O(log n) in the number of idle members, so @lock is never
+ * held across a walk of the group.
+ */
+struct tmigr_group {
+	raw_spinlock_t		lock;
+	unsigned int		migrator;
+	bool			timers_pending;
+	unsigned long		next_expiry;
+	struct timerqueue_head	events;
+	cpumask_var_t		cpus;
+	cpumask_var_t		active;
+};
+
+/**
+ * struct tmigr_cpu - timer migration per CPU state
+ * @group:		Group the CPU belongs to
+ * @cpu:		The CPU
+ * @online:		The CPU takes part in timer migration
+ * @idle:		The tick of the CPU is stopped
+ * @remote:		The global timers of the CPU are expired remotely
+ * @event:		First expiry of the CPU's global timers; only queued
+ *			in the group while the CPU is idle and its timers
+ *			are not expired remotely
+ * @seq:		Incremented whenever the CPU publishes @event
+ */
+struct tmigr_cpu {
+	struct tmigr_group	*group;
+	unsigned int		cpu;
+	bool			online;
+	bool			idle;
+	bool			remote;
+	struct timerqueue_node	event;
+	unsigned int		seq;
+};
+
+#endif
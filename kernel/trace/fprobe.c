@@ -125,7 +125,7 @@ static void fprobe_init(struct fprobe *fp)
 
 static int fprobe_init_rethook(struct fprobe *fp, int num)
 {
-	int i, size;
+	int size, ret;
 
 	if (num < 0)
 		return -EINVAL;
@@ -143,18 +143,18 @@ static int fprobe_init_rethook(struct fprobe *fp, int num)
 	fp->rethook = rethook_alloc((void *)fp, fprobe_exit_handler);
 	if (!fp->rethook)
 		return -ENOMEM;
-	for (i = 0; i < size; i++) {
-		struct fprobe_rethook_node *node;
-
-		node = kzalloc(sizeof(*node), GFP_KERNEL);
-		if (!node) {
-			rethook_free(fp->rethook);
-			fp->rethook = NULL;
-			return -ENOMEM;
-		}
-		rethook_add_node(fp->rethook, &node->node);
+
+	/*
+	 * The pool scales with the number of probed functions; with thousands
+	 * of them, allocating each node separately dominates registration.
+	 */
+	ret = rethook_alloc_nodes(fp->rethook, sizeof(struct fprobe_rethook_node),
+				  size);
+	if (ret) {
+		rethook_free(fp->rethook);
+		fp->rethook = NULL;
 	}
-	return 0;
+	return ret;
 }
 
 static void fprobe_fail_cleanup(struct fprobe *fp)
@@ -0,0 +1,299 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * Always-on latency histograms
+ *
+ * Per CPU log-linear histograms of the duration of system calls, page
+ * faults and softirqs, and of the time tasks wait on a runqueue. The hooks
+ * are behind a static key, so they cost a nop while disabled. The counters
+ * are allocated the first time the histograms are enabled and are never
+ * cleared, consumers compute the deltas between two reads.
+ *
+ * The tracefs latency_hist directory has:
+ *   enable - write 1 to record, 0 to stop
+ *   hist   - binary snapshot, see <uapi/linux/latency_hist.h>
+ */
+
+#include <linux/interrupt.h>
+#include <linux/latency_hist.h>
+#include <linux/mutex.h>
+#include <linux/slab.h>
+#include <linux/tracefs.h>
+#include <linux/uaccess.h>
+#include <asm/unistd.h>
+
+#include "trace.h"
+
+#define LAT_HIST_SUB_BITS	1
+#define LAT_HIST_SUB_BUCKETS	(1 << LAT_HIST_SUB_BITS)
+/* the last bucket starts at ~3.2s */
+#define LAT_HIST_BUCKETS	64
+
+struct lat_hist_cpu {
+	u64	syscall[NR_syscalls][LAT_HIST_BUCKETS];
+	u64	fault[2][LAT_HIST_BUCKETS];
+	u64	softirq[NR_SOFTIRQS][LAT_HIST_BUCKETS];
+	u64	runq_wait[1][LAT_HIST_BUCKETS];
+};
+
+static const unsigned int lat_hist_nr_ids[NR_LAT_HIST_TYPES] = {
+	[LAT_HIST_SYSCALL]	= NR_syscalls,
+	[LAT_HIST_FAULT]	= 2,
+	[LAT_HIST_SOFTIRQ]	= NR_SOFTIRQS,
+	[LAT_HIST_RUNQ_WAIT]	= 1,
+};
+
+DEFINE_STATIC_KEY_FALSE(lat_hist_enabled);
+
+/* Protects lat_hist_cpus allocation and the static key */
+static DEFINE_MUTEX(lat_hist_mutex);
+static struct lat_hist_cpu **lat_hist_cpus;
+
+struct lat_hist_snapshot {
+	size_t		size;
+	char		data[];
+};
+
+static unsigned int lat_hist_bucket(u64 delta)
+{
+	unsigned int msb, idx;
+
+	if (delta < LAT_HIST_SUB_BUCKETS)
+		return delta;
+
+	msb = fls64(delta) - 1;
+	idx = (msb - LAT_HIST_SUB_BITS + 1) << LAT_HIST_SUB_BITS;
+	idx |= (delta >> (msb - LAT_HIST_SUB_BITS)) & (LAT_HIST_SUB_BUCKETS - 1);
+
+	return min_t(unsigned int, idx, LAT_HIST_BUCKETS - 1);
+}
+
+static u64 *lat_hist_counts(struct lat_hist_cpu *h, enum lat_hist_type type,
+			    unsigned int id)
+{
+	switch (type) {
+	case LAT_HIST_SYSCALL:
+		return h->syscall[id];
+	case LAT_HIST_FAULT:
+		return h->fault[id];
+	case LAT_HIST_SOFTIRQ:
+		return h->softirq[id];
+	case LAT_HIST_RUNQ_WAIT:
+		return h->runq_wait[id];
+	default:
+		return NULL;
+	}
+}
+
+void notrace __lat_hist_record(enum lat_hist_type type, unsigned int id,
+			       u64 delta)
+{
+	u64 *counts;
+
+	if (type >= NR_LAT_HIST_TYPES || id >= lat_hist_nr_ids[type])
+		return;
+
+	/*
+	 * Only the CPU itself updates its counters, and the contexts that
+	 * can nest on a CPU (task, softirq, scheduler) all use different
+	 * histograms.
+	 */
+	preempt_disable_notrace();
+	counts = lat_hist_counts(lat_hist_cpus[smp_processor_id()], type, id);
+	counts[lat_hist_bucket(delta)]++;
+	preempt_enable_notrace();
+}
+
+static int lat_hist_alloc(void)
+{
+	struct lat_hist_cpu **cpus;
+	int cpu;
+
+	lockdep_assert_held(&lat_hist_mutex);
+
+	if (lat_hist_cpus)
+		return 0;
+
+	cpus = kcalloc(nr_cpu_ids, sizeof(*cpus), GFP_KERNEL);
+	if (!cpus)
+		return -ENOMEM;
+
+	for_each_possible_cpu(cpu) {
+		cpus[cpu] = kvzalloc_node(sizeof(**cpus), GFP_KERNEL,
+					  cpu_to_node(cpu));
+		if (!cpus[cpu])
+			goto err;
+	}
+
+	lat_hist_cpus = cpus;
+	return 0;
+
+err:
+	for_each_possible_cpu(cpu)
+		kvfree(cpus[cpu]);
+	kfree(cpus);
+	return -ENOMEM;
+}
+
+static ssize_t lat_hist_enable_read(struct file *filp, char __user *ubuf,
+				    size_t cnt, loff_t *ppos)
+{
+	char buf[4];
+	int r;
+
+	r = scnprintf(buf, sizeof(buf), "%d\n",
+		      static_key_enabled(&lat_hist_enabled));
+
+	return simple_read_from_buffer(ubuf, cnt, ppos, buf, r);
+}
+
+static ssize_t lat_hist_enable_write(struct file *filp,
+				     const char __user *ubuf,
+				     size_t cnt, loff_t *ppos)
+{
+	bool enable;
+	int ret;
+
+	ret = kstrtobool_from_user(ubuf, cnt, &enable);
+	if (ret)
+		return ret;
+
+	mutex_lock(&lat_hist_mutex);
+	if (enable) {
+		ret = lat_hist_alloc();
+		if (!ret)
+			static_branch_enable(&lat_hist_enabled);
+	} else {
+		static_branch_disable(&lat_hist_enabled);
+	}
+	mutex_unlock(&lat_hist_mutex);
+
+	if (ret)
+		return ret;
+
+	*ppos += cnt;
+	return cnt;
+}
+
+static const struct file_operations lat_hist_enable_fops = {
+	.open		= tracing_open_generic,
+	.read		= lat_hist_enable_read,
+	.write		= lat_hist_enable_write,
+	.llseek		= default_llseek,
+};
+
+static int lat_hist_open(struct inode *inode, struct file *filp)
+{
+	size_t rec_size = struct_size((struct lat_hist_record *)NULL, counts,
+				      LAT_HIST_BUCKETS);
+	struct lat_hist_snapshot *snap;
+	struct lat_hist_header *hdr;
+	unsigned int max_records = 0;
+	unsigned int type, id, i;
+	char *p;
+	int ret, cpu;
+
+	ret = tracing_check_open_get_tr(NULL);
+	if (ret)
+		return ret;
+
+	mutex_lock(&lat_hist_mutex);
+
+	if (lat_hist_cpus) {
+		for (type = 0; type < NR_LAT_HIST_TYPES; type++)
+			max_records += lat_hist_nr_ids[type];
+	}
+
+	snap = kvzalloc(sizeof(*snap) + sizeof(*hdr) + max_records * rec_size,
+			GFP_KERNEL);
+	if (!snap) {
+		mutex_unlock(&lat_hist_mutex);
+		return -ENOMEM;
+	}
+
+	hdr = (struct lat_hist_header *)snap->data;
+	hdr->magic = LAT_HIST_MAGIC;
+	hdr->version = LAT_HIST_VERSION;
+	hdr->nr_buckets = LAT_HIST_BUCKETS;
+	hdr->sub_bucket_bits = LAT_HIST_SUB_BITS;
+	p = (char *)(hdr + 1);
+
+	for (type = 0; max_records && type < NR_LAT_HIST_TYPES; type++) {
+		for (id = 0; id < lat_hist_nr_ids[type]; id++) {
+			struct lat_hist_record *rec = (void *)p;
+			u64 total = 0;
+
+			for_each_possible_cpu(cpu) {
+				u64 *counts = lat_hist_counts(lat_hist_cpus[cpu],
+							      type, id);
+
+				for (i = 0; i < LAT_HIST_BUCKETS; i++) {
+					u64 val = READ_ONCE(counts[i]);
+
+					rec->counts[i] += val;
+					total += val;
+				}
+			}
+
+			if (!total) {
+				memset(rec, 0, rec_size);
+				continue;
+			}
+
+			rec->type = type;
+			rec->id = id;
+			hdr->nr_records++;
+			p += rec_size;
+		}
+	}
+
+	mutex_unlock(&lat_hist_mutex);
+
+	snap->size = p - snap->data;
+	filp->private_data = snap;
+
+	return 0;
+}
+
+static ssize_t lat_hist_read(struct file *filp, char __user *ubuf,
+			     size_t cnt, loff_t *ppos)
+{
+	struct lat_hist_snapshot *snap = filp->private_data;
+
+	return simple_read_from_buffer(ubuf, cnt, ppos, snap->data, snap->size);
+}
+
+static int lat_hist_release(struct inode *inode, struct file *filp)
+{
+	kvfree(filp->private_data);
+	return 0;
+}
+
+static const struct file_operations lat_hist_fops = {
+	.open		= lat_hist_open,
+	.read		= lat_hist_read,
+	.release	= lat_hist_release,
+	.llseek		= default_llseek,
+};
+
+static __init int lat_hist_init_tracefs(void)
+{
+	struct dentry *dir;
+	int ret;
+
+	ret = tracing_init_dentry();
+	if (ret)
+		return 0;
+
+	dir = tracefs_create_dir("latency_hist", NULL);
+	if (!dir) {
+		pr_warn("Could not create tracefs 'latency_hist' directory\n");
+		return 0;
+	}
+
+	trace_create_file("enable", TRACE_MODE_WRITE, dir, NULL,
+			  &lat_hist_enable_fops);
+	trace_create_file("hist", TRACE_MODE_READ, dir, NULL, &lat_hist_fops);
+
+	return 0;
+}
+fs_initcall(lat_hist_init_tracefs);
@@ -9,6 +9,7 @@
 #include <linux/rethook.h>
 #include <linux/slab.h>
 #include <linux/sort.h>
+#include <linux/vmalloc.h>
 
 /* Return hook list (shadow stack by list) */
 
@@ -33,6 +34,14 @@ void rethook_flush_task(struct task_struct *tk)
 	}
 }
 
+static void rethook_put(struct rethook *rh, int count)
+{
+	if (refcount_sub_and_test(count, &rh->ref)) {
+		kvfree(rh->nodes);
+		kfree(rh);
+	}
+}
+
 static void rethook_free_rcu(struct rcu_head *head)
 {
 	struct rethook *rh = container_of(head, struct rethook, rcu);
@@ -44,13 +53,13 @@ static void rethook_free_rcu(struct rcu_head *head)
 	while (node) {
 		rhn = container_of(node, struct rethook_node, freelist);
 		node = node->next;
-		kfree(rhn);
+		if (!rh->nodes)
+			kfree(rhn);
 		count++;
 	}
 
 	/* The rh->ref is the number of pooled node + 1 */
-	if (refcount_sub_and_test(count, &rh->ref))
-		kfree(rh);
+	rethook_put(rh, count);
 }
 
 /**
@@ -111,13 +120,47 @@ void rethook_add_node(struct rethook *rh, struct rethook_node *node)
 	refcount_inc(&rh->ref);
 }
 
+/**
+ * rethook_alloc_nodes() - Allocate and add the nodes of the rethook at once.
+ * @rh: the struct rethook.
+ * @size: the size of the user's data structure, which must start with a
+ *        struct rethook_node.
+ * @num: the number of nodes.
+ *
+ * Allocate @num zeroed nodes in one allocation and add them to @rh. This
+ * is much cheaper than adding many separately allocated nodes, and the
+ * storage is freed together with @rh. This must not be mixed with
+ * rethook_add_node() on the same @rh.
+ *
+ * Return 0 on success, -errno if not.
+ */
+int rethook_alloc_nodes(struct rethook *rh, size_t size, int num)
+{
+	char *nodes;
+	int i;
+
+	if (WARN_ON_ONCE(rh->nodes || rh->pool.head || size < sizeof(struct rethook_node)))
+		return -EINVAL;
+
+	nodes = kvcalloc(num, size, GFP_KERNEL);
+	if (!nodes)
+		return -ENOMEM;
+
+	rh->nodes = nodes;
+	for (i = 0; i < num; i++)
+		rethook_add_node(rh, (struct rethook_node *)(nodes + i * size));
+
+	return 0;
+}
+
 static void free_rethook_node_rcu(struct rcu_head *head)
 {
 	struct rethook_node *node = container_of(head, struct rethook_node, rcu);
+	struct rethook *rh = node->rethook;
 
-	if (refcount_dec_and_test(&node->rethook->ref))
-		kfree(node->rethook);
-	kfree(node);
+	if (!rh->nodes)
+		kfree(node);
+	rethook_put(rh, 1);
 }
 
 /**
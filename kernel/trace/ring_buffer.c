@@ -331,6 +331,7 @@ struct buffer_page {
 	unsigned	 read;		/* index for next read */
 	local_t		 entries;	/* entries on this page */
 	unsigned long	 real_end;	/* real end of data */
+	unsigned	 id;		/* ID for external mapping */
 	struct buffer_data_page *page;	/* Actual data page */
 };
 
@@ -536,6 +537,12 @@ struct ring_buffer_per_cpu {
 	struct completion		update_done;
 
 	struct rb_irq_work		irq_work;
+
+	/* user space mapping, see ring_buffer_map() */
+	struct mutex			mapping_lock;
+	unsigned long			*subbuf_ids;	/* ID to subbuf addr */
+	struct trace_buffer_meta	*meta_page;
+	unsigned int			mapped;
 };
 
 struct trace_buffer {
@@ -1735,6 +1742,7 @@ rb_allocate_cpu_buffer(struct trace_buffer *buffer, long nr_pages, int cpu)
 	init_irq_work(&cpu_buffer->irq_work.work, rb_wake_up_waiters);
 	init_waitqueue_head(&cpu_buffer->irq_work.waiters);
 	init_waitqueue_head(&cpu_buffer->irq_work.full_waiters);
+	mutex_init(&cpu_buffer->mapping_lock);
 
 	bpage = kzalloc_node(ALIGN(sizeof(*bpage), cache_line_size()),
 			    GFP_KERNEL, cpu_to_node(cpu));
@@ -5254,6 +5262,24 @@ unsigned long ring_buffer_size(struct trace_buffer *buffer, int cpu)
 }
 EXPORT_SYMBOL_GPL(ring_buffer_size);
 
+/* Must be called with the reader_lock held */
+static void rb_update_meta_page(struct ring_buffer_per_cpu *cpu_buffer,
+				unsigned int read, unsigned long lost_events)
+{
+	struct trace_buffer_meta *meta = cpu_buffer->meta_page;
+
+	meta->reader.read = read;
+	meta->reader.id = cpu_buffer->reader_page->id;
+	meta->reader.lost_events = lost_events;
+
+	meta->entries = local_read(&cpu_buffer->entries);
+	meta->overrun = local_read(&cpu_buffer->overrun);
+	meta->read = cpu_buffer->read;
+
+	/* Some archs do not have data cache coherency with user space */
+	flush_dcache_page(virt_to_page(meta));
+}
+
 static void
 rb_reset_cpu(struct ring_buffer_per_cpu *cpu_buffer)
 {
@@ -5298,6 +5324,9 @@ rb_reset_cpu(struct ring_buffer_per_cpu *cpu_buffer)
 	memset(cpu_buffer->event_stamp, 0, sizeof(cpu_buffer->event_stamp));
 
 	cpu_buffer->lost_events = 0;
+
+	if (cpu_buffer->mapped)
+		rb_update_meta_page(cpu_buffer, 0, 0);
 	cpu_buffer->last_overrun = 0;
 
 	rb_head_page_activate(cpu_buffer);
@@ -5532,6 +5561,10 @@ int ring_buffer_swap_cpu(struct trace_buffer *buffer_a,
 	if (atomic_read(&cpu_buffer_b->record_disabled))
 		goto out;
 
+	ret = -EBUSY;
+	if (READ_ONCE(cpu_buffer_a->mapped) || READ_ONCE(cpu_buffer_b->mapped))
+		goto out;
+
 	/*
 	 * We can't do a synchronize_rcu here because this
 	 * function can be called in atomic context.
@@ -5727,6 +5760,12 @@ int ring_buffer_read_page(struct trace_buffer *buffer,
 
 	raw_spin_lock_irqsave(&cpu_buffer->reader_lock, flags);
 
+	/* The pages of a mapped buffer must stay in the ring */
+	if (cpu_buffer->mapped) {
+		ret = -EBUSY;
+		goto out_unlock;
+	}
+
 	reader = rb_get_reader_page(cpu_buffer);
 	if (!reader)
 		goto out_unlock;
@@ -5864,6 +5903,306 @@ int ring_buffer_read_page(struct trace_buffer *buffer,
 }
 EXPORT_SYMBOL_GPL(ring_buffer_read_page);
 
+static void rb_setup_ids_meta_page(struct ring_buffer_per_cpu *cpu_buffer,
+				   unsigned long *subbuf_ids)
+{
+	struct trace_buffer_meta *meta = cpu_buffer->meta_page;
+	unsigned int nr_subbufs = cpu_buffer->nr_pages + 1;
+	struct buffer_page *first_subbuf, *subbuf;
+	int id = 0;
+
+	subbuf_ids[id] = (unsigned long)cpu_buffer->reader_page->page;
+	cpu_buffer->reader_page->id = id++;
+
+	first_subbuf = subbuf = rb_set_head_page(cpu_buffer);
+	do {
+		if (WARN_ON(id >= nr_subbufs))
+			break;
+
+		subbuf_ids[id] = (unsigned long)subbuf->page;
+		subbuf->id = id;
+
+		rb_inc_page(&subbuf);
+		id++;
+	} while (subbuf != first_subbuf);
+
+	/* The ids don't change as long as the buffer is mapped */
+	cpu_buffer->subbuf_ids = subbuf_ids;
+
+	meta->meta_page_size = PAGE_SIZE;
+	meta->meta_struct_len = sizeof(*meta);
+	meta->subbuf_size = PAGE_SIZE;
+	meta->nr_subbufs = nr_subbufs;
+	meta->flags = 0;
+
+	rb_update_meta_page(cpu_buffer, cpu_buffer->reader_page->read, 0);
+}
+
+static int __rb_map_vma(struct ring_buffer_per_cpu *cpu_buffer,
+			struct vm_area_struct *vma)
+{
+	unsigned long nr_pages, nr_vma_pages, pgoff = vma->vm_pgoff;
+	struct page **pages;
+	unsigned long i;
+	int err;
+
+	lockdep_assert_held(&cpu_buffer->mapping_lock);
+
+	if (vma->vm_flags & (VM_WRITE | VM_EXEC) ||
+	    !(vma->vm_flags & VM_MAYSHARE))
+		return -EPERM;
+
+	/* meta page and sub-buffers, reader included */
+	nr_pages = cpu_buffer->nr_pages + 2;
+	nr_vma_pages = vma_pages(vma);
+	if (!nr_vma_pages || pgoff >= nr_pages ||
+	    nr_vma_pages > nr_pages - pgoff)
+		return -EINVAL;
+
+	vma->vm_flags |= VM_DONTCOPY | VM_DONTEXPAND | VM_DONTDUMP;
+	vma->vm_flags &= ~VM_MAYWRITE;
+
+	pages = kcalloc(nr_vma_pages, sizeof(*pages), GFP_KERNEL);
+	if (!pages)
+		return -ENOMEM;
+
+	for (i = 0; i < nr_vma_pages; i++) {
+		if (pgoff + i == 0)
+			pages[i] = virt_to_page(cpu_buffer->meta_page);
+		else
+			pages[i] = virt_to_page((void *)
+					cpu_buffer->subbuf_ids[pgoff + i - 1]);
+	}
+
+	err = vm_insert_pages(vma, vma->vm_start, pages, &nr_vma_pages);
+	kfree(pages);
+
+	return err;
+}
+
+/**
+ * ring_buffer_map - map a per CPU buffer into user space
+ * @buffer: the buffer the per CPU buffer belongs to
+ * @cpu: the CPU of the buffer to map
+ * @vma: the read-only, shared mapping to set up
+ *
+ * The first page of the mapping is a struct trace_buffer_meta, followed by
+ * the sub-buffers in the order of their IDs. User space consumes the reader
+ * sub-buffer in place and gets the next one with ring_buffer_map_get_reader().
+ * While the buffer is mapped it can't be resized, and its pages can't be
+ * swapped out by ring_buffer_read_page().
+ *
+ * Returns 0 on success, or a negative error code.
+ */
+int ring_buffer_map(struct trace_buffer *buffer, int cpu,
+		    struct vm_area_struct *vma)
+{
+	struct ring_buffer_per_cpu *cpu_buffer;
+	unsigned long flags, *subbuf_ids;
+	int err = 0;
+
+	if (!cpumask_test_cpu(cpu, buffer->cpumask))
+		return -EINVAL;
+
+	cpu_buffer = buffer->buffers[cpu];
+
+	mutex_lock(&cpu_buffer->mapping_lock);
+
+	if (cpu_buffer->mapped) {
+		err = __rb_map_vma(cpu_buffer, vma);
+		if (!err)
+			cpu_buffer->mapped++;
+		goto out;
+	}
+
+	/* Taking the buffer mutex waits for a resize in progress */
+	mutex_lock(&buffer->mutex);
+	atomic_inc(&cpu_buffer->resize_disabled);
+	mutex_unlock(&buffer->mutex);
+
+	err = -ENOMEM;
+	cpu_buffer->meta_page = (void *)get_zeroed_page(GFP_KERNEL);
+	if (!cpu_buffer->meta_page)
+		goto out_enable_resize;
+
+	subbuf_ids = kcalloc(cpu_buffer->nr_pages + 1, sizeof(*subbuf_ids),
+			     GFP_KERNEL);
+	if (!subbuf_ids)
+		goto out_free_meta;
+
+	raw_spin_lock_irqsave(&cpu_buffer->reader_lock, flags);
+	rb_setup_ids_meta_page(cpu_buffer, subbuf_ids);
+	cpu_buffer->mapped = 1;
+	raw_spin_unlock_irqrestore(&cpu_buffer->reader_lock, flags);
+
+	err = __rb_map_vma(cpu_buffer, vma);
+	if (!err)
+		goto out;
+
+	raw_spin_lock_irqsave(&cpu_buffer->reader_lock, flags);
+	cpu_buffer->mapped = 0;
+	raw_spin_unlock_irqrestore(&cpu_buffer->reader_lock, flags);
+
+	kfree(cpu_buffer->subbuf_ids);
+	cpu_buffer->subbuf_ids = NULL;
+ out_free_meta:
+	free_page((unsigned long)cpu_buffer->meta_page);
+	cpu_buffer->meta_page = NULL;
+ out_enable_resize:
+	atomic_dec(&cpu_buffer->resize_disabled);
+ out:
+	mutex_unlock(&cpu_buffer->mapping_lock);
+
+	return err;
+}
+EXPORT_SYMBOL_GPL(ring_buffer_map);
+
+/**
+ * ring_buffer_map_dup - account a copy of a mapping set up by ring_buffer_map()
+ * @buffer: the buffer the per CPU buffer belongs to
+ * @cpu: the CPU of the mapped buffer
+ *
+ * For a vma that got duplicated, by mremap() or fork(), and that will be
+ * torn down with its own ring_buffer_unmap().
+ *
+ * Returns 0 on success, or -ENODEV if the buffer is not mapped.
+ */
+int ring_buffer_map_dup(struct trace_buffer *buffer, int cpu)
+{
+	struct ring_buffer_per_cpu *cpu_buffer;
+	int err = 0;
+
+	if (!cpumask_test_cpu(cpu, buffer->cpumask))
+		return -EINVAL;
+
+	cpu_buffer = buffer->buffers[cpu];
+
+	mutex_lock(&cpu_buffer->mapping_lock);
+	if (cpu_buffer->mapped)
+		cpu_buffer->mapped++;
+	else
+		err = -ENODEV;
+	mutex_unlock(&cpu_buffer->mapping_lock);
+
+	return err;
+}
+EXPORT_SYMBOL_GPL(ring_buffer_map_dup);
+
+/**
+ * ring_buffer_unmap - tear down a mapping set up by ring_buffer_map()
+ * @buffer: the buffer the per CPU buffer belongs to
+ * @cpu: the CPU of the mapped buffer
+ *
+ * Returns 0 on success, or -ENODEV if the buffer is not mapped.
+ */
+int ring_buffer_unmap(struct trace_buffer *buffer, int cpu)
+{
+	struct ring_buffer_per_cpu *cpu_buffer;
+	unsigned long flags;
+	int err = 0;
+
+	if (!cpumask_test_cpu(cpu, buffer->cpumask))
+		return -EINVAL;
+
+	cpu_buffer = buffer->buffers[cpu];
+
+	mutex_lock(&cpu_buffer->mapping_lock);
+
+	if (!cpu_buffer->mapped) {
+		err = -ENODEV;
+		goto out;
+	}
+
+	if (cpu_buffer->mapped > 1) {
+		cpu_buffer->mapped--;
+		goto out;
+	}
+
+	raw_spin_lock_irqsave(&cpu_buffer->reader_lock, flags);
+	cpu_buffer->mapped = 0;
+	raw_spin_unlock_irqrestore(&cpu_buffer->reader_lock, flags);
+
+	/* The pages inserted in user space hold their own reference */
+	kfree(cpu_buffer->subbuf_ids);
+	cpu_buffer->subbuf_ids = NULL;
+	free_page((unsigned long)cpu_buffer->meta_page);
+	cpu_buffer->meta_page = NULL;
+
+	atomic_dec(&cpu_buffer->resize_disabled);
+ out:
+	mutex_unlock(&cpu_buffer->mapping_lock);
+
+	return err;
+}
+EXPORT_SYMBOL_GPL(ring_buffer_unmap);
+
+/**
+ * ring_buffer_map_get_reader - get the next data to read of a mapped buffer
+ * @buffer: the buffer the per CPU buffer belongs to
+ * @cpu: the CPU of the mapped buffer
+ *
+ * If the reader sub-buffer has been consumed entirely, swap it with the
+ * head of the ring. Everything committed to the reader sub-buffer is then
+ * accounted as read, and the meta page tells user space where the data it
+ * has not seen yet starts: reader.read up to the commit of the sub-buffer.
+ *
+ * Returns 0 on success, or -ENODEV if the buffer is not mapped.
+ */
+int ring_buffer_map_get_reader(struct trace_buffer *buffer, int cpu)
+{
+	struct ring_buffer_per_cpu *cpu_buffer;
+	unsigned long lost_events = 0;
+	struct buffer_page *reader;
+	unsigned long flags;
+	unsigned int read, size;
+	int err = 0;
+
+	if (!cpumask_test_cpu(cpu, buffer->cpumask))
+		return -EINVAL;
+
+	cpu_buffer = buffer->buffers[cpu];
+
+	mutex_lock(&cpu_buffer->mapping_lock);
+
+	if (!cpu_buffer->mapped) {
+		err = -ENODEV;
+		goto out;
+	}
+
+	raw_spin_lock_irqsave(&cpu_buffer->reader_lock, flags);
+
+	reader = cpu_buffer->reader_page;
+	read = reader->read;
+
+	if (rb_per_cpu_empty(cpu_buffer))
+		goto update;
+
+	if (reader->read >= rb_page_size(reader)) {
+		reader = rb_get_reader_page(cpu_buffer);
+		if (RB_WARN_ON(cpu_buffer, !reader))
+			goto update;
+		lost_events = cpu_buffer->lost_events;
+		cpu_buffer->lost_events = 0;
+		read = reader->read;
+	}
+
+	/* User space reads everything committed so far */
+	size = rb_page_size(reader);
+	while (reader->read < size)
+		rb_advance_reader(cpu_buffer);
+
+ update:
+	flush_dcache_page(virt_to_page(cpu_buffer->reader_page->page));
+	rb_update_meta_page(cpu_buffer, read, lost_events);
+
+	raw_spin_unlock_irqrestore(&cpu_buffer->reader_lock, flags);
+ out:
+	mutex_unlock(&cpu_buffer->mapping_lock);
+
+	return err;
+}
+EXPORT_SYMBOL_GPL(ring_buffer_map_get_reader);
+
 /*
  * We only allocate new buffers, never free them if the CPU goes down.
  * If we were to free the buffer, then the user would lose any trace that was in
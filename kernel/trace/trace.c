@@ -1222,6 +1222,10 @@ int tracing_alloc_snapshot_instance(struct trace_array *tr)
 
 	if (!tr->allocated_snapshot) {
 
+		/* Swapping buffers would pull the mapped one from under user space */
+		if (tr->mapped)
+			return -EBUSY;
+
 		/* allocate spare buffer */
 		ret = resize_buffer_duplicate_size(&tr->max_buffer,
 				   &tr->array_buffer, RING_BUFFER_ALL_CPUS);
@@ -8158,6 +8162,9 @@ tracing_buffers_read(struct file *filp, char __user *ubuf,
 	trace_access_unlock(iter->cpu_file);
 
 	if (ret < 0) {
+		if (ret == -EBUSY)
+			return ret;
+
 		if (trace_empty(iter)) {
 			if ((filp->f_flags & O_NONBLOCK))
 				return -EAGAIN;
@@ -8339,6 +8346,8 @@ tracing_buffers_splice_read(struct file *file, loff_t *ppos,
 			ring_buffer_free_read_page(ref->buffer, ref->cpu,
 						   ref->page);
 			kfree(ref);
+			if (r == -EBUSY)
+				ret = r;
 			break;
 		}
 
@@ -8393,14 +8402,30 @@ out:
 	return ret;
 }
 
-/* An ioctl call with cmd 0 to the ring buffer file will wake up all waiters */
+/*
+ * An ioctl call with cmd 0 to the ring buffer file will wake up all waiters.
+ * TRACE_MMAP_IOCTL_GET_READER hands the next data to a mapping of the file.
+ */
 static long tracing_buffers_ioctl(struct file *file, unsigned int cmd, unsigned long arg)
 {
 	struct ftrace_buffer_info *info = file->private_data;
 	struct trace_iterator *iter = &info->iter;
+	int err;
+
+	if (cmd == TRACE_MMAP_IOCTL_GET_READER) {
+		if (!(file->f_flags & O_NONBLOCK)) {
+			err = ring_buffer_wait(iter->array_buffer->buffer,
+					       iter->cpu_file,
+					       iter->tr->buffer_percent);
+			if (err)
+				return err;
+		}
 
-	if (cmd)
+		return ring_buffer_map_get_reader(iter->array_buffer->buffer,
+						  iter->cpu_file);
+	} else if (cmd) {
 		return -ENOIOCTLCMD;
+	}
 
 	mutex_lock(&trace_types_lock);
 
@@ -8414,6 +8439,102 @@ static long tracing_buffers_ioctl(struct file *file, unsigned int cmd, unsigned
 	return 0;
 }
 
+#ifdef CONFIG_TRACER_MAX_TRACE
+static int get_snapshot_map(struct trace_array *tr)
+{
+	int err = 0;
+
+	mutex_lock(&trace_types_lock);
+	if (tr->allocated_snapshot)
+		err = -EBUSY;
+	else
+		tr->mapped++;
+	mutex_unlock(&trace_types_lock);
+
+	return err;
+}
+
+static void dup_snapshot_map(struct trace_array *tr)
+{
+	mutex_lock(&trace_types_lock);
+	if (!WARN_ON(!tr->mapped))
+		tr->mapped++;
+	mutex_unlock(&trace_types_lock);
+}
+
+static void put_snapshot_map(struct trace_array *tr)
+{
+	mutex_lock(&trace_types_lock);
+	if (!WARN_ON(!tr->mapped))
+		tr->mapped--;
+	mutex_unlock(&trace_types_lock);
+}
+#else
+static inline int get_snapshot_map(struct trace_array *tr) { return 0; }
+static inline void dup_snapshot_map(struct trace_array *tr) { }
+static inline void put_snapshot_map(struct trace_array *tr) { }
+#endif
+
+/* A copy of the vma, from mremap() or fork(), is closed on its own */
+static void tracing_buffers_mmap_open(struct vm_area_struct *vma)
+{
+	struct ftrace_buffer_info *info = vma->vm_file->private_data;
+	struct trace_iterator *iter = &info->iter;
+
+	WARN_ON(ring_buffer_map_dup(iter->array_buffer->buffer, iter->cpu_file));
+	dup_snapshot_map(iter->tr);
+}
+
+static void tracing_buffers_mmap_close(struct vm_area_struct *vma)
+{
+	struct ftrace_buffer_info *info = vma->vm_file->private_data;
+	struct trace_iterator *iter = &info->iter;
+
+	WARN_ON(ring_buffer_unmap(iter->array_buffer->buffer, iter->cpu_file));
+	put_snapshot_map(iter->tr);
+}
+
+/* A split mapping would be unmapped twice */
+static int tracing_buffers_mmap_may_split(struct vm_area_struct *vma,
+					  unsigned long addr)
+{
+	return -EINVAL;
+}
+
+static const struct vm_operations_struct tracing_buffers_vmops = {
+	.open		= tracing_buffers_mmap_open,
+	.close		= tracing_buffers_mmap_close,
+	.may_split	= tracing_buffers_mmap_may_split,
+};
+
+static int tracing_buffers_mmap(struct file *filp, struct vm_area_struct *vma)
+{
+	struct ftrace_buffer_info *info = filp->private_data;
+	struct trace_iterator *iter = &info->iter;
+	int ret;
+
+	if (iter->cpu_file == RING_BUFFER_ALL_CPUS)
+		return -EINVAL;
+
+	/* The snapshot buffer is swapped at any time */
+	if (iter->snapshot)
+		return -EBUSY;
+
+	ret = get_snapshot_map(iter->tr);
+	if (ret)
+		return ret;
+
+	ret = ring_buffer_map(iter->array_buffer->buffer, iter->cpu_file, vma);
+	if (ret) {
+		put_snapshot_map(iter->tr);
+		return ret;
+	}
+
+	vma->vm_ops = &tracing_buffers_vmops;
+
+	return 0;
+}
+
 static const struct file_operations tracing_buffers_fops = {
 	.open		= tracing_buffers_open,
 	.read		= tracing_buffers_read,
@@ -8421,6 +8542,7 @@ static const struct file_operations tracing_buffers_fops = {
 	.release	= tracing_buffers_release,
 	.splice_read	= tracing_buffers_splice_read,
 	.unlocked_ioctl = tracing_buffers_ioctl,
+	.mmap		= tracing_buffers_mmap,
 	.llseek		= no_llseek,
 };
 
@@ -4229,58 +4229,65 @@ done:
 	return true;
 }
 
+/*
+ * mas_wr_new_end() - Number of the last slot used once the store is done
+ * @wr_mas: The maple write state
+ *
+ * Return: The end of the node after the store, which may not fit the node.
+ */
+static inline unsigned char mas_wr_new_end(struct ma_wr_state *wr_mas)
+{
+	struct ma_state *mas = wr_mas->mas;
+	unsigned char new_end = wr_mas->node_end + 2;
+
+	new_end -= wr_mas->offset_end - mas->offset;
+	if (wr_mas->r_min == mas->index)
+		new_end--;
+
+	if (wr_mas->end_piv == mas->last)
+		new_end--;
+
+	return new_end;
+}
+
 /*
  * mas_wr_slot_store: Attempt to store a value in a slot.
  * @wr_mas: the maple write state
  *
+ * Handles a store over two ranges which leaves the number of ranges in the
+ * node unchanged, that is moving the boundary between them.  This is done in
+ * place, so it also works on full nodes.
+ *
  * Return: True if stored, false otherwise
  */
 static inline bool mas_wr_slot_store(struct ma_wr_state *wr_mas)
 {
 	struct ma_state *mas = wr_mas->mas;
-	unsigned long lmax; /* Logical max. */
 	unsigned char offset = mas->offset;
+	bool gap = false;
 
-	if ((wr_mas->r_max > mas->last) && ((wr_mas->r_min != mas->index) ||
-				  (offset != wr_mas->node_end)))
+	if (wr_mas->offset_end - offset != 1)
 		return false;
 
-	if (offset == wr_mas->node_end - 1)
-		lmax = mas->max;
-	else
-		lmax = wr_mas->pivots[offset + 1];
-
-	/* going to overwrite too many slots. */
-	if (lmax < mas->last)
-		return false;
+	gap |= !mas_slot_locked(mas, wr_mas->slots, offset);
+	gap |= !mas_slot_locked(mas, wr_mas->slots, offset + 1);
 
 	if (wr_mas->r_min == mas->index) {
-		/* overwriting two or more ranges with one. */
-		if (lmax == mas->last)
-			return false;
-
 		/* Overwriting all of offset and a portion of offset + 1. */
 		rcu_assign_pointer(wr_mas->slots[offset], wr_mas->entry);
 		wr_mas->pivots[offset] = mas->last;
-		goto done;
+	} else {
+		/* Overwriting a portion of offset and all of offset + 1 */
+		rcu_assign_pointer(wr_mas->slots[offset + 1], wr_mas->entry);
+		wr_mas->pivots[offset] = mas->index - 1;
+		mas->offset++; /* Keep mas accurate. */
 	}
 
-	/* Doesn't end on the next range end. */
-	if (lmax != mas->last)
-		return false;
-
-	/* Overwriting a portion of offset and all of offset + 1 */
-	if ((offset + 1 < mt_pivots[wr_mas->type]) &&
-	    (wr_mas->entry || wr_mas->pivots[offset + 1]))
-		wr_mas->pivots[offset + 1] = mas->last;
-
-	rcu_assign_pointer(wr_mas->slots[offset + 1], wr_mas->entry);
-	wr_mas->pivots[offset] = mas->index - 1;
-	mas->offset++; /* Keep mas accurate. */
-
-done:
 	trace_ma_write(__func__, mas, 0, wr_mas->entry);
-	mas_update_gap(mas);
+	/* The gaps only change if an empty range is grown or shrunk. */
+	if (!wr_mas->entry || gap)
+		mas_update_gap(mas);
+
 	return true;
 }
 
@@ -4395,6 +4402,11 @@ static inline void mas_wr_modify(struct ma_wr_state *wr_mas)
 		return;
 	}
 
+	/* Moving the boundary between two ranges needs no room */
+	if (mas_wr_new_end(wr_mas) == wr_mas->node_end &&
+	    mas_wr_slot_store(wr_mas))
+		return;
+
 	/* Attempt to append */
 	node_slots = mt_slots[wr_mas->type];
 	node_size = wr_mas->node_end - wr_mas->offset_end + mas->offset + 2;
@@ -4412,9 +4424,7 @@ static inline void mas_wr_modify(struct ma_wr_state *wr_mas)
 		return;
 	}
 
-	if ((wr_mas->offset_end - mas->offset <= 1) && mas_wr_slot_store(wr_mas))
-		return;
-	else if (mas_wr_node_store(wr_mas))
+	if (mas_wr_node_store(wr_mas))
 		return;
 
 	if (mas_is_err(mas))
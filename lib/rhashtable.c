@@ -16,6 +16,7 @@
 #include <linux/init.h>
 #include <linux/log2.h>
 #include <linux/sched.h>
+#include <linux/sched/mm.h>
 #include <linux/rculist.h>
 #include <linux/slab.h>
 #include <linux/vmalloc.h>
@@ -29,6 +30,10 @@
 #define HASH_DEFAULT_SIZE	64UL
 #define HASH_MIN_SIZE		4U
 
+/* Tables bigger than one chunk are rehashed by up to this many workers */
+#define RHT_REHASH_CHUNK	(1U << 14)
+#define RHT_REHASH_MAX_WORKERS	8U
+
 union nested_table {
 	union nested_table __rcu *table;
 	struct rhash_lock_head __rcu *bucket;
@@ -177,11 +182,23 @@ static struct bucket_table *bucket_table_alloc(struct rhashtable *ht,
 					       gfp_t gfp)
 {
 	struct bucket_table *tbl = NULL;
+	struct mem_cgroup *old_memcg;
 	size_t size;
 	int i;
 	static struct lock_class_key __key;
 
-	tbl = kvzalloc(struct_size(tbl, buckets, nbuckets), gfp);
+	/*
+	 * Most tables are grown from the deferred worker, so charge the
+	 * memcg of the owner rather than that of the current task.
+	 */
+	if (ht->p.memcg) {
+		old_memcg = set_active_memcg(ht->p.memcg);
+		tbl = kvzalloc(struct_size(tbl, buckets, nbuckets),
+			       gfp | __GFP_ACCOUNT);
+		set_active_memcg(old_memcg);
+	} else {
+		tbl = kvzalloc(struct_size(tbl, buckets, nbuckets), gfp);
+	}
 
 	size = nbuckets;
 
@@ -222,10 +239,10 @@ static struct bucket_table *rhashtable_last_table(struct rhashtable *ht,
 }
 
 static int rhashtable_rehash_one(struct rhashtable *ht,
+				 struct bucket_table *old_tbl,
 				 struct rhash_lock_head __rcu **bkt,
 				 unsigned int old_hash)
 {
-	struct bucket_table *old_tbl = rht_dereference(ht->tbl, ht);
 	struct bucket_table *new_tbl = rhashtable_last_table(ht, old_tbl);
 	int err = -EAGAIN;
 	struct rhash_head *head, *next, *entry;
@@ -274,9 +291,9 @@ out:
 }
 
 static int rhashtable_rehash_chain(struct rhashtable *ht,
-				    unsigned int old_hash)
+				   struct bucket_table *old_tbl,
+				   unsigned int old_hash)
 {
-	struct bucket_table *old_tbl = rht_dereference(ht->tbl, ht);
 	struct rhash_lock_head __rcu **bkt = rht_bucket_var(old_tbl, old_hash);
 	unsigned long flags;
 	int err;
@@ -285,7 +302,7 @@ static int rhashtable_rehash_chain(struct rhashtable *ht,
 		return 0;
 	flags = rht_lock(old_tbl, bkt);
 
-	while (!(err = rhashtable_rehash_one(ht, bkt, old_hash)))
+	while (!(err = rhashtable_rehash_one(ht, old_tbl, bkt, old_hash)))
 		;
 
 	if (err == -ENOENT)
@@ -312,24 +329,118 @@ static int rhashtable_rehash_attach(struct rhashtable *ht,
 	return 0;
 }
 
+struct rhashtable_rehash_ctx {
+	struct rhashtable *ht;
+	struct bucket_table *old_tbl;
+	atomic_t next_chunk;
+};
+
+struct rhashtable_rehash_work {
+	struct work_struct work;
+	struct rhashtable_rehash_ctx *ctx;
+	int err;
+};
+
+/* Rehash chunks of the old table until there are none left */
+static int rhashtable_rehash_chunks(struct rhashtable_rehash_ctx *ctx)
+{
+	unsigned int size = ctx->old_tbl->size;
+	unsigned int chunk, old_hash, end;
+	int err;
+
+	while ((chunk = atomic_fetch_inc(&ctx->next_chunk)) <
+	       DIV_ROUND_UP(size, RHT_REHASH_CHUNK)) {
+		old_hash = chunk * RHT_REHASH_CHUNK;
+		end = min(old_hash + RHT_REHASH_CHUNK, size);
+
+		for (; old_hash < end; old_hash++) {
+			/*
+			 * Helpers don't hold ht->mutex, so the future tables
+			 * are looked up under RCU.
+			 */
+			rcu_read_lock();
+			err = rhashtable_rehash_chain(ctx->ht, ctx->old_tbl,
+						      old_hash);
+			rcu_read_unlock();
+			if (err)
+				return err;
+			cond_resched();
+		}
+	}
+
+	return 0;
+}
+
+static void rhashtable_rehash_work(struct work_struct *work)
+{
+	struct rhashtable_rehash_work *rw =
+		container_of(work, struct rhashtable_rehash_work, work);
+
+	rw->err = rhashtable_rehash_chunks(rw->ctx);
+}
+
+/*
+ * Rehash all chains of the old table. Chains are independent, as each one
+ * only ever takes its own bucket lock and then the new bucket locks, so big
+ * tables are split in chunks which are shared with helpers on the unbound
+ * workqueue.
+ */
+static int rhashtable_rehash_buckets(struct rhashtable *ht,
+				     struct bucket_table *old_tbl)
+{
+	struct rhashtable_rehash_ctx ctx = {
+		.ht		= ht,
+		.old_tbl	= old_tbl,
+		.next_chunk	= ATOMIC_INIT(0),
+	};
+	struct rhashtable_rehash_work *works = NULL;
+	unsigned int i, nr_works;
+	int err;
+
+	nr_works = min3(DIV_ROUND_UP(old_tbl->size, RHT_REHASH_CHUNK),
+			num_online_cpus(), RHT_REHASH_MAX_WORKERS) - 1;
+	if (nr_works)
+		works = kcalloc(nr_works, sizeof(*works),
+				GFP_KERNEL | __GFP_NOWARN);
+	if (!works)
+		nr_works = 0;
+
+	for (i = 0; i < nr_works; i++) {
+		INIT_WORK(&works[i].work, rhashtable_rehash_work);
+		works[i].ctx = &ctx;
+		queue_work(system_unbound_wq, &works[i].work);
+	}
+
+	err = rhashtable_rehash_chunks(&ctx);
+
+	/*
+	 * Every chunk has been claimed by now, so there is no point in
+	 * waiting, with ht->mutex held, for helpers that have yet to get a
+	 * worker: cancel those and only wait for the ones already running.
+	 */
+	for (i = 0; i < nr_works; i++) {
+		cancel_work_sync(&works[i].work);
+		err = err ?: works[i].err;
+	}
+	kfree(works);
+
+	return err;
+}
+
 static int rhashtable_rehash_table(struct rhashtable *ht)
 {
 	struct bucket_table *old_tbl = rht_dereference(ht->tbl, ht);
 	struct bucket_table *new_tbl;
 	struct rhashtable_walker *walker;
-	unsigned int old_hash;
 	int err;
 
 	new_tbl = rht_dereference(old_tbl->future_tbl, ht);
 	if (!new_tbl)
 		return 0;
 
-	for (old_hash = 0; old_hash < old_tbl->size; old_hash++) {
-		err = rhashtable_rehash_chain(ht, old_hash);
-		if (err)
-			return err;
-		cond_resched();
-	}
+	err = rhashtable_rehash_buckets(ht, old_tbl);
+	if (err)
+		return err;
 
 	/* Publish the new table pointer. */
 	rcu_assign_pointer(ht->tbl, new_tbl);
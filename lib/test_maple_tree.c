@@ -23,6 +23,8 @@
 /* #define BENCH_WALK */
 /* #define BENCH_MT_FOR_EACH */
 /* #define BENCH_FORK */
+/* #define BENCH_MAS_FOR_EACH */
+/* #define BENCH_BOUNDARY_STORE */
 
 #ifdef __KERNEL__
 #define mt_set_non_kernel(x)		do {} while (0)
@@ -1669,6 +1671,57 @@ static noinline void bench_mt_for_each(struct maple_tree *mt)
 }
 #endif
 
+#if defined(BENCH_MAS_FOR_EACH)
+static noinline void bench_mas_for_each(struct maple_tree *mt)
+{
+	int i, count = 1000000;
+	unsigned long max = 2500;
+	void *entry;
+	MA_STATE(mas, mt, 0, 0);
+
+	for (i = 0; i < max; i += 5)
+		mtree_store_range(mt, i, i + 4, xa_mk_value(i), GFP_KERNEL);
+
+	rcu_read_lock();
+	for (i = 0; i < count; i++) {
+		unsigned long j = 0;
+
+		mas_for_each(&mas, entry, max) {
+			MT_BUG_ON(mt, entry != xa_mk_value(j));
+			j += 5;
+		}
+		mas_set(&mas, 0);
+	}
+	rcu_read_unlock();
+}
+#endif
+
+#if defined(BENCH_BOUNDARY_STORE)
+/*
+ * Move the boundary between two adjacent ranges back and forth in a tree
+ * with 100k ranges, which is what merging part of a VMA into its neighbour
+ * does.
+ */
+static noinline void bench_boundary_store(struct maple_tree *mt)
+{
+	int i, nr_entries = 100000, count = 20000000;
+	unsigned long index = 50000 * 10;
+
+	for (i = 0; i < nr_entries; i++)
+		mtree_store_range(mt, i * 10, i * 10 + 9, xa_mk_value(i),
+				  GFP_KERNEL);
+
+	for (i = 0; i < count; i++) {
+		/* Grow the next range down over half of this one */
+		mtree_store_range(mt, index + 5, index + 19,
+				  xa_mk_value(index / 10 + 1), GFP_KERNEL);
+		/* And back */
+		mtree_store_range(mt, index, index + 9,
+				  xa_mk_value(index / 10), GFP_KERNEL);
+	}
+}
+#endif
+
 /* check_forking - simulate the kernel forking sequence with the tree. */
 static noinline void check_forking(struct maple_tree *mt)
 {
@@ -2701,6 +2754,20 @@ static int maple_tree_seed(void)
 	mtree_destroy(&tree);
 	goto skip;
 #endif
+#if defined(BENCH_MAS_FOR_EACH)
+#define BENCH
+	mt_init_flags(&tree, MT_FLAGS_ALLOC_RANGE);
+	bench_mas_for_each(&tree);
+	mtree_destroy(&tree);
+	goto skip;
+#endif
+#if defined(BENCH_BOUNDARY_STORE)
+#define BENCH
+	mt_init_flags(&tree, MT_FLAGS_ALLOC_RANGE);
+	bench_boundary_store(&tree);
+	mtree_destroy(&tree);
+	goto skip;
+#endif
 
 	mt_init_flags(&tree, MT_FLAGS_ALLOC_RANGE);
 	check_forking(&tree);
@@ -211,7 +211,7 @@ static s64 __init test_rhashtable(struct rhashtable *ht, struct test_obj *array,
 	struct test_obj *obj;
 	int err;
 	unsigned int i, insert_retries = 0;
-	s64 start, end;
+	s64 start, end, resize_start;
 
 	/*
 	 * Insertion Test:
@@ -234,6 +234,12 @@ static s64 __init test_rhashtable(struct rhashtable *ht, struct test_obj *array,
 		pr_info("  %u insertions retried due to memory pressure\n",
 			insert_retries);
 
+	/* Time the resizes the insertions left behind */
+	resize_start = ktime_get_ns();
+	flush_work(&ht->run_work);
+	pr_info("  Pending resize took %lld ns\n",
+		ktime_get_ns() - resize_start);
+
 	test_bucket_stats(ht, entries);
 	rcu_read_lock();
 	test_rht_lookup(ht, array, entries);
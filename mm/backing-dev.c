@@ -331,6 +331,33 @@ static ssize_t strict_limit_show(struct device *dev,
 }
 static DEVICE_ATTR_RW(strict_limit);
 
+static ssize_t max_pause_ms_store(struct device *dev,
+		struct device_attribute *attr, const char *buf, size_t count)
+{
+	struct backing_dev_info *bdi = dev_get_drvdata(dev);
+	unsigned int msecs;
+	ssize_t ret;
+
+	ret = kstrtouint(buf, 10, &msecs);
+	if (ret < 0)
+		return ret;
+
+	ret = bdi_set_max_pause_ms(bdi, msecs);
+	if (!ret)
+		ret = count;
+
+	return ret;
+}
+
+static ssize_t max_pause_ms_show(struct device *dev,
+		struct device_attribute *attr, char *buf)
+{
+	struct backing_dev_info *bdi = dev_get_drvdata(dev);
+
+	return sysfs_emit(buf, "%u\n", bdi_get_max_pause_ms(bdi));
+}
+static DEVICE_ATTR_RW(max_pause_ms);
+
 static struct attribute *bdi_dev_attrs[] = {
 	&dev_attr_read_ahead_kb.attr,
 	&dev_attr_min_ratio.attr,
@@ -341,6 +368,7 @@ static struct attribute *bdi_dev_attrs[] = {
 	&dev_attr_max_bytes.attr,
 	&dev_attr_stable_pages_required.attr,
 	&dev_attr_strict_limit.attr,
+	&dev_attr_max_pause_ms.attr,
 	NULL,
 };
 ATTRIBUTE_GROUPS(bdi_dev);
@@ -917,6 +945,7 @@ int bdi_init(struct backing_dev_info *bdi)
 	bdi->min_ratio = 0;
 	bdi->max_ratio = 100 * BDI_RATIO_SCALE;
 	bdi->max_prop_frac = FPROP_FRAC_BASE;
+	bdi->max_pause = 0;
 	INIT_LIST_HEAD(&bdi->bdi_list);
 	INIT_LIST_HEAD(&bdi->wb_list);
 	init_waitqueue_head(&bdi->wb_waitq);
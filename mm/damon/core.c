@@ -11,6 +11,7 @@
 #include <linux/delay.h>
 #include <linux/kthread.h>
 #include <linux/mm.h>
+#include <linux/psi.h>
 #include <linux/slab.h>
 #include <linux/string.h>
 
@@ -269,6 +270,8 @@ static struct damos_quota *damos_quota_init_priv(struct damos_quota *quota)
 	quota->total_charged_sz = 0;
 	quota->total_charged_ns = 0;
 	quota->esz = 0;
+	quota->esz_bp = 0;
+	quota->goal.last_psi_total = 0;
 	quota->charged_sz = 0;
 	quota->charged_from = 0;
 	quota->charge_target_from = NULL;
@@ -829,23 +832,109 @@ static void damon_do_apply_schemes(struct damon_ctx *c,
 	}
 }
 
-/* Shouldn't be called if quota->ms and quota->sz are zero */
+static bool damos_quota_is_set(struct damos_quota *quota)
+{
+	return quota->ms || quota->sz || quota->goal.target_value;
+}
+
+/*
+ * Returns the next input of a feedback loop that aims the score of 10,000,
+ * given the last input and its resulting score.  Over-achievement shrinks
+ * the input and under-achievement grows it, proportionally to the distance
+ * from the goal.
+ */
+static unsigned long damon_feed_loop_next_input(unsigned long last_input,
+		unsigned long score)
+{
+	const unsigned long goal = 10000;
+	/* Set minimum input as 10000 to avoid compensation be zero */
+	const unsigned long min_input = 10000;
+	unsigned long score_goal_diff, compensation;
+	bool over_achieving = score > goal;
+
+	if (score == goal)
+		return last_input;
+	if (score >= goal * 2)
+		return min_input;
+
+	if (over_achieving)
+		score_goal_diff = score - goal;
+	else
+		score_goal_diff = goal - score;
+
+	if (last_input < ULONG_MAX / score_goal_diff)
+		compensation = last_input * score_goal_diff / goal;
+	else
+		compensation = last_input / goal * score_goal_diff;
+
+	if (over_achieving)
+		return max(last_input - compensation, min_input);
+	if (last_input < ULONG_MAX - compensation)
+		return last_input + compensation;
+	return ULONG_MAX;
+}
+
+#ifdef CONFIG_PSI
+static u64 damos_get_some_mem_psi_total(void)
+{
+	if (static_branch_likely(&psi_disabled))
+		return 0;
+	return div_u64(psi_system.total[PSI_AVGS][PSI_MEM_SOME],
+			NSEC_PER_USEC);
+}
+#else	/* CONFIG_PSI */
+static inline u64 damos_get_some_mem_psi_total(void)
+{
+	return 0;
+}
+#endif	/* CONFIG_PSI */
+
+static void damos_set_quota_goal_current_value(struct damos_quota_goal *goal)
+{
+	u64 now_psi_total;
+
+	switch (goal->metric) {
+	case DAMOS_QUOTA_USER_INPUT:
+		/* User should already set it */
+		break;
+	case DAMOS_QUOTA_SOME_MEM_PSI_US:
+		now_psi_total = damos_get_some_mem_psi_total();
+		goal->current_value = now_psi_total - goal->last_psi_total;
+		goal->last_psi_total = now_psi_total;
+		break;
+	default:
+		break;
+	}
+}
+
+/* Return the score of the goal in basis points, 10,000 meaning achieved */
+static unsigned long damos_quota_goal_score(struct damos_quota_goal *goal)
+{
+	damos_set_quota_goal_current_value(goal);
+	return mult_frac(goal->current_value, 10000, goal->target_value);
+}
+
+/* Shouldn't be called if quota->ms, quota->sz and the goal are all unset */
 static void damos_set_effective_quota(struct damos_quota *quota)
 {
 	unsigned long throughput;
-	unsigned long esz;
+	unsigned long esz = ULONG_MAX;
 
-	if (!quota->ms) {
-		quota->esz = quota->sz;
-		return;
+	if (quota->goal.target_value) {
+		quota->esz_bp = damon_feed_loop_next_input(
+				max(quota->esz_bp, 10000UL),
+				damos_quota_goal_score(&quota->goal));
+		esz = quota->esz_bp / 10000;
 	}
 
-	if (quota->total_charged_ns)
-		throughput = quota->total_charged_sz * 1000000 /
-			quota->total_charged_ns;
-	else
-		throughput = PAGE_SIZE * 1024;
-	esz = throughput * quota->ms;
+	if (quota->ms) {
+		if (quota->total_charged_ns)
+			throughput = quota->total_charged_sz * 1000000 /
+				quota->total_charged_ns;
+		else
+			throughput = PAGE_SIZE * 1024;
+		esz = min(throughput * quota->ms, esz);
+	}
 
 	if (quota->sz && quota->sz < esz)
 		esz = quota->sz;
@@ -860,7 +949,7 @@ static void damos_adjust_quota(struct damon_ctx *c, struct damos *s)
 	unsigned long cumulated_sz;
 	unsigned int score, max_score = 0;
 
-	if (!quota->ms && !quota->sz)
+	if (!damos_quota_is_set(quota))
 		return;
 
 	/* New charge window starts */
@@ -7,6 +7,7 @@
 
 #define pr_fmt(fmt) "damon-pa: " fmt
 
+#include <linux/mm_inline.h>
 #include <linux/mmu_notifier.h>
 #include <linux/page_idle.h>
 #include <linux/pagemap.h>
@@ -230,6 +231,28 @@ static unsigned long damon_pa_pageout(struct damon_region *r)
 	return applied * PAGE_SIZE;
 }
 
+/*
+ * With the multi-gen LRU, folio_mark_accessed() only raises the access
+ * tier of a folio within its generation; aging, i.e. moving folios to the
+ * youngest generation, is left to the page table walks and look-arounds
+ * of the reclaim path.  A region DAMON found hot is as good a sign of
+ * access as a young PTE, so promote its folios to the youngest generation
+ * directly.  Together with the MGLRU mm walk turned off, this lets DAMON
+ * do the aging at a cost bound by its sampling rather than by the amount
+ * of mapped memory.
+ */
+static void damon_pa_mark_page_accessed(struct page *page)
+{
+	struct folio *folio = page_folio(page);
+
+	if (lru_gen_enabled()) {
+		folio_activate(folio);
+		return;
+	}
+
+	folio_mark_accessed(folio);
+}
+
 static inline unsigned long damon_pa_mark_accessed_or_deactivate(
 		struct damon_region *r, bool mark_accessed)
 {
@@ -241,7 +264,7 @@ static inline unsigned long damon_pa_mark_accessed_or_deactivate(
 		if (!page)
 			continue;
 		if (mark_accessed)
-			mark_page_accessed(page);
+			damon_pa_mark_page_accessed(page);
 		else
 			deactivate_page(page);
 		put_page(page);
@@ -62,6 +62,38 @@ static struct damos_quota damon_reclaim_quota = {
 };
 DEFINE_DAMON_MODULES_DAMOS_QUOTAS(damon_reclaim_quota);
 
+/*
+ * Desired level of memory pressure-stall time in microseconds.
+ *
+ * While keeping the caps that set by other quotas, DAMON_RECLAIM automatically
+ * increases and decreases the effective level of the quota aiming this level of
+ * memory pressure is incurred.  System-wide ``some`` memory PSI in microseconds
+ * per quota reset interval (``quota_reset_interval_ms``) is collected and
+ * compared to this value to see if the aim is satisfied.  Value zero means
+ * disabling this auto-tuning feature.
+ *
+ * Disabled by default.
+ */
+static unsigned long quota_mem_pressure_us __read_mostly;
+module_param(quota_mem_pressure_us, ulong, 0600);
+
+/*
+ * User-specifiable feedback for auto-tuning of the effective quota.
+ *
+ * While keeping the caps that set by other quotas, DAMON_RECLAIM automatically
+ * increases and decreases the effective level of the quota aiming receiving this
+ * feedback of value ``10,000`` from the user.  DAMON_RECLAIM assumes the feedback
+ * value and the quota are positively proportional, e.g. the amount of free
+ * memory observed, scaled so that the desired amount maps to ``10,000``.
+ * Value zero means disabling this auto-tuning feature.
+ *
+ * Disabled by default.  Only used when ``quota_mem_pressure_us`` is unset.
+ * Once enabled, updates to the feedback take effect without
+ * ``commit_inputs``.
+ */
+static unsigned long quota_autotune_feedback __read_mostly;
+module_param(quota_autotune_feedback, ulong, 0600);
+
 static struct damos_watermarks damon_reclaim_wmarks = {
 	.metric = DAMOS_WMARK_FREE_MEM_RATE,
 	.interval = 5000000,	/* 5 seconds */
@@ -139,6 +171,20 @@ static struct damos *damon_reclaim_new_scheme(void)
 			&damon_reclaim_wmarks);
 }
 
+static void damon_reclaim_set_quota_goal(struct damos_quota *quota)
+{
+	if (quota_mem_pressure_us) {
+		quota->goal.metric = DAMOS_QUOTA_SOME_MEM_PSI_US;
+		quota->goal.target_value = quota_mem_pressure_us;
+	} else if (quota_autotune_feedback) {
+		quota->goal.metric = DAMOS_QUOTA_USER_INPUT;
+		quota->goal.target_value = 10000;
+		quota->goal.current_value = quota_autotune_feedback;
+	} else {
+		quota->goal.target_value = 0;
+	}
+}
+
 static int damon_reclaim_apply_parameters(void)
 {
 	struct damos *scheme;
@@ -148,6 +194,8 @@ static int damon_reclaim_apply_parameters(void)
 	if (err)
 		return err;
 
+	damon_reclaim_set_quota_goal(&damon_reclaim_quota);
+
 	/* Will be freed by next 'damon_set_schemes()' below */
 	scheme = damon_reclaim_new_scheme();
 	if (!scheme)
@@ -233,9 +281,13 @@ static int damon_reclaim_after_aggregation(struct damon_ctx *c)
 {
 	struct damos *s;
 
-	/* update the stats parameter */
-	damon_for_each_scheme(s, c)
+	/* update the stats parameter and the user feedback, if in use */
+	damon_for_each_scheme(s, c) {
 		damon_reclaim_stat = s->stat;
+		if (s->quota.goal.metric == DAMOS_QUOTA_USER_INPUT &&
+		    s->quota.goal.target_value && quota_autotune_feedback)
+			s->quota.goal.current_value = quota_autotune_feedback;
+	}
 
 	return damon_reclaim_handle_commit_inputs();
 }
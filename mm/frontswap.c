@@ -167,6 +167,7 @@ int __frontswap_store(struct page *page)
 	int type = swp_type(entry);
 	struct swap_info_struct *sis = swap_info[type];
 	pgoff_t offset = swp_offset(entry);
+	int i, nr = thp_nr_pages(page);
 
 	VM_BUG_ON(!frontswap_ops);
 	VM_BUG_ON(!PageLocked(page));
@@ -178,18 +179,39 @@ int __frontswap_store(struct page *page)
 	 * and we can't rely on the new page replacing the old page as we may
 	 * not store to the same implementation that contains the old page.
 	 */
-	if (__frontswap_test(sis, offset)) {
-		__frontswap_clear(sis, offset);
-		frontswap_ops->invalidate_page(type, offset);
+	for (i = 0; i < nr; i++) {
+		if (__frontswap_test(sis, offset + i)) {
+			__frontswap_clear(sis, offset + i);
+			frontswap_ops->invalidate_page(type, offset + i);
+		}
+	}
+
+	/*
+	 * A THP occupies nr contiguous swap slots.  Implementations only deal
+	 * with base pages, so hand each subpage over on its own slot.  The
+	 * THP stays whole; swapin reads the slots back page by page.
+	 */
+	for (i = 0; i < nr; i++) {
+		ret = frontswap_ops->store(type, offset + i, nth_page(page, i));
+		if (ret)
+			break;
+		__frontswap_set(sis, offset + i);
 	}
 
-	ret = frontswap_ops->store(type, offset, page);
 	if (ret == 0) {
-		__frontswap_set(sis, offset);
 		inc_frontswap_succ_stores();
-	} else {
-		inc_frontswap_failed_stores();
+		return 0;
+	}
+
+	/*
+	 * The whole folio goes to the swap device now, drop what was stored
+	 * so far rather than keep a second copy of it.
+	 */
+	while (i--) {
+		__frontswap_clear(sis, offset + i);
+		frontswap_ops->invalidate_page(type, offset + i);
 	}
+	inc_frontswap_failed_stores();
 
 	return ret;
 }
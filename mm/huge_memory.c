@@ -65,6 +65,16 @@ unsigned long transparent_hugepage_flags __read_mostly =
 	(1<<TRANSPARENT_HUGEPAGE_DEFRAG_KHUGEPAGED_FLAG)|
 	(1<<TRANSPARENT_HUGEPAGE_USE_ZERO_PAGE_FLAG);
 
+/*
+ * Anonymous folios smaller than a PMD are controlled per size through
+ * /sys/kernel/mm/transparent_hugepage/hugepages-<size>kB/enabled. Each
+ * order is set in at most one of these masks; "inherit" follows the
+ * top-level enabled setting. All sizes start out as "never".
+ */
+unsigned long huge_anon_orders_always __read_mostly;
+unsigned long huge_anon_orders_madvise __read_mostly;
+unsigned long huge_anon_orders_inherit __read_mostly;
+
 static struct shrinker deferred_split_shrinker;
 
 static atomic_t huge_zero_refcount;
@@ -150,6 +160,35 @@ bool hugepage_vma_check(struct vm_area_struct *vma, unsigned long vm_flags,
 	return true;
 }
 
+/**
+ * thp_vma_anon_orders - sub-PMD anonymous folio orders enabled for a vma
+ * @vma: the vma being faulted
+ *
+ * Return: a bitmask of the orders in THP_ORDERS_ANON_MTHP that sysfs allows
+ * for @vma, or 0 if large anonymous folios must not be used for it.
+ */
+unsigned long thp_vma_anon_orders(struct vm_area_struct *vma)
+{
+	unsigned long vm_flags = vma->vm_flags;
+	unsigned long orders;
+
+	orders = READ_ONCE(huge_anon_orders_always);
+	if (vm_flags & VM_HUGEPAGE)
+		orders |= READ_ONCE(huge_anon_orders_madvise);
+	if (hugepage_flags_always() ||
+	    ((vm_flags & VM_HUGEPAGE) && hugepage_flags_enabled()))
+		orders |= READ_ONCE(huge_anon_orders_inherit);
+
+	orders &= THP_ORDERS_ANON_MTHP;
+	if (!orders)
+		return 0;
+
+	if (!hugepage_vma_check(vma, vm_flags, false, true, false))
+		return 0;
+
+	return orders;
+}
+
 static bool get_huge_zero_page(void)
 {
 	struct page *zero_page;
@@ -405,9 +444,126 @@ static const struct attribute_group hugepage_attr_group = {
 	.attrs = hugepage_attr,
 };
 
+struct thpsize {
+	struct kobject kobj;
+	struct list_head node;
+	int order;
+};
+
+#define to_thpsize(kobj) container_of(kobj, struct thpsize, kobj)
+
+static LIST_HEAD(thpsize_list);
+static DEFINE_SPINLOCK(huge_anon_orders_lock);
+
+static ssize_t thpsize_enabled_show(struct kobject *kobj,
+				    struct kobj_attribute *attr, char *buf)
+{
+	int order = to_thpsize(kobj)->order;
+	const char *output;
+
+	if (test_bit(order, &huge_anon_orders_always))
+		output = "[always] inherit madvise never";
+	else if (test_bit(order, &huge_anon_orders_inherit))
+		output = "always [inherit] madvise never";
+	else if (test_bit(order, &huge_anon_orders_madvise))
+		output = "always inherit [madvise] never";
+	else
+		output = "always inherit madvise [never]";
+
+	return sysfs_emit(buf, "%s\n", output);
+}
+
+static ssize_t thpsize_enabled_store(struct kobject *kobj,
+				     struct kobj_attribute *attr,
+				     const char *buf, size_t count)
+{
+	int order = to_thpsize(kobj)->order;
+	unsigned long *set = NULL;
+
+	if (sysfs_streq(buf, "always"))
+		set = &huge_anon_orders_always;
+	else if (sysfs_streq(buf, "inherit"))
+		set = &huge_anon_orders_inherit;
+	else if (sysfs_streq(buf, "madvise"))
+		set = &huge_anon_orders_madvise;
+	else if (!sysfs_streq(buf, "never"))
+		return -EINVAL;
+
+	spin_lock(&huge_anon_orders_lock);
+	clear_bit(order, &huge_anon_orders_always);
+	clear_bit(order, &huge_anon_orders_inherit);
+	clear_bit(order, &huge_anon_orders_madvise);
+	if (set)
+		set_bit(order, set);
+	spin_unlock(&huge_anon_orders_lock);
+
+	return count;
+}
+
+static struct kobj_attribute thpsize_enabled_attr =
+	__ATTR(enabled, 0644, thpsize_enabled_show, thpsize_enabled_store);
+
+static struct attribute *thpsize_attrs[] = {
+	&thpsize_enabled_attr.attr,
+	NULL,
+};
+
+static const struct attribute_group thpsize_attr_group = {
+	.attrs = thpsize_attrs,
+};
+
+static void thpsize_release(struct kobject *kobj)
+{
+	kfree(to_thpsize(kobj));
+}
+
+static struct kobj_type thpsize_ktype = {
+	.release = &thpsize_release,
+	.sysfs_ops = &kobj_sysfs_ops,
+};
+
+static struct thpsize *thpsize_create(int order, struct kobject *parent)
+{
+	unsigned long size = (PAGE_SIZE << order) / SZ_1K;
+	struct thpsize *thpsize;
+	int ret;
+
+	thpsize = kzalloc(sizeof(*thpsize), GFP_KERNEL);
+	if (!thpsize)
+		return ERR_PTR(-ENOMEM);
+
+	ret = kobject_init_and_add(&thpsize->kobj, &thpsize_ktype, parent,
+				   "hugepages-%lukB", size);
+	if (ret) {
+		kobject_put(&thpsize->kobj);
+		return ERR_PTR(ret);
+	}
+
+	ret = sysfs_create_group(&thpsize->kobj, &thpsize_attr_group);
+	if (ret) {
+		kobject_put(&thpsize->kobj);
+		return ERR_PTR(ret);
+	}
+
+	thpsize->order = order;
+	return thpsize;
+}
+
+static void thpsize_remove_all(void)
+{
+	struct thpsize *thpsize, *tmp;
+
+	list_for_each_entry_safe(thpsize, tmp, &thpsize_list, node) {
+		list_del(&thpsize->node);
+		kobject_put(&thpsize->kobj);
+	}
+}
+
 static int __init hugepage_init_sysfs(struct kobject **hugepage_kobj)
 {
-	int err;
+	unsigned long orders;
+	struct thpsize *thpsize;
+	int order, err;
 
 	*hugepage_kobj = kobject_create_and_add("transparent_hugepage", mm_kobj);
 	if (unlikely(!*hugepage_kobj)) {
@@ -427,8 +583,22 @@ static int __init hugepage_init_sysfs(struct kobject **hugepage_kobj)
 		goto remove_hp_group;
 	}
 
+	orders = THP_ORDERS_ANON_MTHP;
+	for_each_set_bit(order, &orders, BITS_PER_LONG) {
+		thpsize = thpsize_create(order, *hugepage_kobj);
+		if (IS_ERR(thpsize)) {
+			pr_err("failed to create thpsize for order %d\n", order);
+			err = PTR_ERR(thpsize);
+			goto remove_all;
+		}
+		list_add(&thpsize->node, &thpsize_list);
+	}
+
 	return 0;
 
+remove_all:
+	thpsize_remove_all();
+	sysfs_remove_group(*hugepage_kobj, &khugepaged_attr_group);
 remove_hp_group:
 	sysfs_remove_group(*hugepage_kobj, &hugepage_attr_group);
 delete_obj:
@@ -438,6 +608,7 @@ delete_obj:
 
 static void __init hugepage_exit_sysfs(struct kobject *hugepage_kobj)
 {
+	thpsize_remove_all();
 	sysfs_remove_group(hugepage_kobj, &khugepaged_attr_group);
 	sysfs_remove_group(hugepage_kobj, &hugepage_attr_group);
 	kobject_put(hugepage_kobj);
@@ -34,6 +34,7 @@
 #include <linux/nospec.h>
 #include <linux/delayacct.h>
 #include <linux/memory.h>
+#include <linux/padata.h>
 
 #include <asm/page.h>
 #include <asm/pgalloc.h>
@@ -2226,6 +2227,84 @@ static int alloc_pool_huge_page(struct hstate *h, nodemask_t *nodes_allowed,
 	return 0;
 }
 
+#ifdef CONFIG_PADATA
+/* Minimum number of non-gigantic pages one pool growing thread allocates */
+#define HUGETLB_POOL_GROW_CHUNK		64
+
+struct hugetlb_pool_grow_args {
+	struct hstate *h;
+	nodemask_t *nodes_allowed;
+	nodemask_t *node_alloc_noretry;
+	struct task_struct *caller;
+	atomic_t failed;
+};
+
+static void hugetlb_pool_grow_thread(unsigned long start, unsigned long end,
+				     void *arg)
+{
+	struct hugetlb_pool_grow_args *args = arg;
+
+	for (; start < end; start++) {
+		if (atomic_read(&args->failed))
+			return;
+
+		/* Only the caller can observe the signal, tell the others */
+		if (current == args->caller && signal_pending(current))
+			goto fail;
+
+		cond_resched();
+		if (!alloc_pool_huge_page(args->h, args->nodes_allowed,
+					  args->node_alloc_noretry))
+			goto fail;
+	}
+	return;
+fail:
+	atomic_set(&args->failed, 1);
+}
+
+/*
+ * Grow the pool by up to @count fresh huge pages, spreading the allocations
+ * over several threads.  Allocating gigantic pages is dominated by
+ * alloc_contig_range() on the target node, so allocating for different
+ * nodes at the same time cuts the time to grow the pool roughly by the
+ * number of nodes.  Stops early on allocation failure or a signal; the
+ * caller's serial loop tells the two apart and finishes the job.
+ */
+static void hugetlb_pool_grow_parallel(struct hstate *h, unsigned long count,
+				       nodemask_t *nodes_allowed,
+				       nodemask_t *node_alloc_noretry)
+{
+	struct hugetlb_pool_grow_args args = {
+		.h			= h,
+		.nodes_allowed		= nodes_allowed,
+		.node_alloc_noretry	= node_alloc_noretry,
+		.caller			= current,
+		.failed			= ATOMIC_INIT(0),
+	};
+	struct padata_mt_job job = {
+		.thread_fn	= hugetlb_pool_grow_thread,
+		.fn_arg		= &args,
+		.start		= 0,
+		.size		= count,
+		.align		= 1,
+		.min_chunk	= hstate_is_gigantic(h) ? 1 :
+				  HUGETLB_POOL_GROW_CHUNK,
+		/* Two threads per node keep each node busy while one waits */
+		.max_threads	= min_t(int, num_online_cpus(),
+					2 * nodes_weight(*nodes_allowed)),
+	};
+
+	padata_do_multithreaded(&job);
+}
+#else
+static inline void hugetlb_pool_grow_parallel(struct hstate *h,
+					      unsigned long count,
+					      nodemask_t *nodes_allowed,
+					      nodemask_t *node_alloc_noretry)
+{
+}
+#endif
+
 /*
  * Remove huge page from pool from next node to free.  Attempt to keep
  * persistent huge pages more or less balanced over allowed nodes.
@@ -3507,6 +3586,15 @@ static int set_max_huge_pages(struct hstate *h, unsigned long count, int nid,
 			break;
 	}
 
+	if (count > persistent_huge_pages(h)) {
+		unsigned long nr = count - persistent_huge_pages(h);
+
+		spin_unlock_irq(&hugetlb_lock);
+		hugetlb_pool_grow_parallel(h, nr, nodes_allowed,
+					   node_alloc_noretry);
+		spin_lock_irq(&hugetlb_lock);
+	}
+
 	while (count > persistent_huge_pages(h)) {
 		/*
 		 * If this allocation races such that we no longer need the
@@ -5755,6 +5843,66 @@ static bool hugetlb_pte_stable(struct hstate *h, struct mm_struct *mm,
 	return same;
 }
 
+#ifdef CONFIG_PADATA
+/* Upper bound on the threads zeroing one gigantic page at fault time */
+#define HUGETLB_CLEAR_MAX_THREADS	8
+
+struct hugetlb_clear_args {
+	struct page *page;
+	unsigned long addr;
+};
+
+static void hugetlb_clear_thread(unsigned long start, unsigned long end,
+				 void *arg)
+{
+	struct hugetlb_clear_args *args = arg;
+
+	for (; start < end; start++) {
+		cond_resched();
+		clear_user_highpage(nth_page(args->page, start),
+				    args->addr + start * PAGE_SIZE);
+	}
+}
+
+/*
+ * Zeroing a gigantic page on one CPU is what makes first-touch of 1G pages
+ * slow, so split the work in PMD-sized chunks over a few threads.  Smaller
+ * pages gain nothing from the coordination and use clear_huge_page(),
+ * which also keeps the faulting subpage cache hot.
+ */
+static void hugetlb_clear_page(struct hstate *h, struct page *page,
+			       unsigned long address)
+{
+	struct hugetlb_clear_args args = {
+		.page	= page,
+		.addr	= address & huge_page_mask(h),
+	};
+	struct padata_mt_job job = {
+		.thread_fn	= hugetlb_clear_thread,
+		.fn_arg		= &args,
+		.start		= 0,
+		.size		= pages_per_huge_page(h),
+		.align		= 1UL << (PMD_SHIFT - PAGE_SHIFT),
+		.min_chunk	= 1UL << (PMD_SHIFT - PAGE_SHIFT),
+		.max_threads	= min_t(int, num_online_cpus(),
+					HUGETLB_CLEAR_MAX_THREADS),
+	};
+
+	if (!hstate_is_gigantic(h)) {
+		clear_huge_page(page, address, pages_per_huge_page(h));
+		return;
+	}
+
+	padata_do_multithreaded(&job);
+}
+#else
+static inline void hugetlb_clear_page(struct hstate *h, struct page *page,
+				      unsigned long address)
+{
+	clear_huge_page(page, address, pages_per_huge_page(h));
+}
+#endif
+
 static vm_fault_t hugetlb_no_page(struct mm_struct *mm,
 			struct vm_area_struct *vma,
 			struct address_space *mapping, pgoff_t idx,
@@ -5843,7 +5991,7 @@ static vm_fault_t hugetlb_no_page(struct mm_struct *mm,
 				ret = 0;
 			goto out;
 		}
-		clear_huge_page(page, address, pages_per_huge_page(h));
+		hugetlb_clear_page(h, page, address);
 		__SetPageUptodate(page);
 		new_page = true;
 
@@ -21,6 +21,7 @@
 #include <linux/sched.h>
 #include <linux/sched/mm.h>
 #include <linux/sched/coredump.h>
+#include <linux/sched/cputime.h>
 #include <linux/rwsem.h>
 #include <linux/pagemap.h>
 #include <linux/rmap.h>
@@ -187,6 +188,8 @@ struct ksm_stable_node {
  * @mm: the memory structure this rmap_item is pointing into
  * @address: the virtual address this rmap_item tracks (+ flags in low bits)
  * @oldchecksum: previous checksum of the page at that virtual address
+ * @age: number of scan iterations since creation
+ * @remaining_skips: how many scans to skip
  * @node: rb node of this rmap_item in the unstable tree
  * @head: pointer to stable_node heading this list in the stable tree
  * @hlist: link into hlist of rmap_items hanging off that stable_node
@@ -202,6 +205,8 @@ struct ksm_rmap_item {
 	struct mm_struct *mm;
 	unsigned long address;		/* + low bits used for flags below */
 	unsigned int oldchecksum;	/* when unstable */
+	u8 age;
+	u8 remaining_skips;
 	union {
 		struct rb_node node;	/* when node of unstable tree */
 		struct {		/* when listed from stable tree */
@@ -275,6 +280,29 @@ static unsigned int zero_checksum __read_mostly;
 /* Whether to merge empty (zeroed) pages with actual zero pages */
 static bool ksm_use_zero_pages __read_mostly;
 
+/* Skip pages that couldn't be de-duplicated previously */
+static bool ksm_smart_scan __read_mostly = true;
+
+/* The number of pages skipped by smart scan */
+static unsigned long ksm_pages_skipped;
+
+/* How ksmd tunes pages_to_scan by itself, if at all */
+enum ksm_advisor_type {
+	KSM_ADVISOR_NONE,
+	KSM_ADVISOR_SCAN_TIME,
+};
+static enum ksm_advisor_type ksm_advisor;
+
+/* Target duration of a full scan, in seconds */
+static unsigned long ksm_advisor_target_scan_time = 200;
+
+/* Maximum CPU consumption of ksmd the advisor may cause, in percent */
+static unsigned long ksm_advisor_max_cpu = 70;
+
+/* Bounds for the pages_to_scan values the advisor picks */
+static unsigned long ksm_advisor_min_pages_to_scan = 500;
+static unsigned long ksm_advisor_max_pages_to_scan = 30000;
+
 #ifdef CONFIG_NUMA
 /* Zeroed when merging across nodes is not allowed */
 static unsigned int ksm_merge_across_nodes = 1;
@@ -2041,6 +2069,8 @@ static void stable_tree_append(struct ksm_rmap_item *rmap_item,
 
 	rmap_item->head = stable_node;
 	rmap_item->address |= STABLE_FLAG;
+	rmap_item->age = 0;
+	rmap_item->remaining_skips = 0;
 	hlist_add_head(&rmap_item->hlist, &stable_node->hlist);
 
 	if (rmap_item->hlist.next)
@@ -2250,6 +2280,164 @@ static struct ksm_rmap_item *get_next_rmap_item(struct ksm_mm_slot *mm_slot,
 	return rmap_item;
 }
 
+/*
+ * Number of scans a page is left alone for once it has failed to merge in
+ * @age scans: the longer a page stayed unique, the less likely it is to
+ * find a twin in the next scan.
+ */
+static unsigned int skip_age(u8 age)
+{
+	if (age <= 3)
+		return 1;
+	if (age <= 5)
+		return 2;
+	if (age <= 8)
+		return 4;
+
+	return 8;
+}
+
+/*
+ * should_skip_rmap_item - check if the page should be skipped this scan
+ * @page: the page being scanned
+ * @rmap_item: the reverse mapping of that page
+ *
+ * With smart scan enabled, pages that repeatedly could not be merged are
+ * only looked at in every n-th scan, which saves the checksum and tree
+ * walks for pages that are private or keep changing.
+ */
+static bool should_skip_rmap_item(struct page *page,
+				  struct ksm_rmap_item *rmap_item)
+{
+	u8 age;
+
+	if (!ksm_smart_scan)
+		return false;
+
+	/*
+	 * Never skip pages that are already KSM; cmp_and_merge_page()
+	 * essentially ignores them, but they still have to be processed
+	 * so that stale stable nodes get noticed.
+	 */
+	if (PageKsm(page))
+		return false;
+
+	age = rmap_item->age;
+	if (age != U8_MAX)
+		rmap_item->age++;
+
+	/*
+	 * Young pages are not skipped, they need a chance to go through
+	 * the checksum and unstable tree phases of merging first.
+	 */
+	if (age < 3)
+		return false;
+
+	/* Out of skips: scan it now and work out when to look again */
+	if (!rmap_item->remaining_skips) {
+		rmap_item->remaining_skips = skip_age(age);
+		return false;
+	}
+
+	ksm_pages_skipped++;
+	rmap_item->remaining_skips--;
+	remove_rmap_item_from_tree(rmap_item);
+	return true;
+}
+
+/*
+ * The advisor keeps some state across full scans: when the current one
+ * started, how much CPU ksmd had used by then, and the smoothed change.
+ */
+static struct {
+	ktime_t start_scan;
+	unsigned long scan_time;
+	unsigned long change;
+	unsigned long long cpu_time;
+} advisor_ctx;
+
+#define KSM_ADVISOR_MIN_CPU	10
+#define EWMA_WEIGHT		30
+
+static unsigned long ewma(unsigned long prev, unsigned long curr)
+{
+	return ((100 - EWMA_WEIGHT) * prev + EWMA_WEIGHT * curr) / 100;
+}
+
+/*
+ * scan_time_advisor - adjust pages_to_scan after a full scan
+ *
+ * Scale pages_to_scan so that a full scan takes about
+ * ksm_advisor_target_scan_time seconds, while keeping the CPU time ksmd
+ * burns between KSM_ADVISOR_MIN_CPU and ksm_advisor_max_cpu percent.
+ * Must be called from ksmd.
+ */
+static void scan_time_advisor(void)
+{
+	unsigned long long cpu_time;
+	unsigned long cpu_time_diff_ms;
+	unsigned long last_scan_time;
+	unsigned long per_page_cost;
+	unsigned long cpu_percent;
+	unsigned long scan_time;
+	unsigned long factor;
+	unsigned long change;
+	unsigned long pages;
+
+	scan_time = ktime_ms_delta(ktime_get(), advisor_ctx.start_scan) /
+		    MSEC_PER_SEC;
+	scan_time = scan_time ? scan_time : 1;
+
+	cpu_time = task_sched_runtime(current);
+	cpu_time_diff_ms = (cpu_time - advisor_ctx.cpu_time) / NSEC_PER_MSEC;
+	cpu_percent = cpu_time_diff_ms * 100 / (scan_time * MSEC_PER_SEC);
+	cpu_percent = cpu_percent ? cpu_percent : 1;
+
+	last_scan_time = advisor_ctx.scan_time ? advisor_ctx.scan_time :
+						 scan_time;
+
+	/* How far off the target the last scan was */
+	factor = ksm_advisor_target_scan_time * 100 / scan_time;
+	factor = factor ? factor : 1;
+
+	/* Smoothed trend relative to the scan before */
+	change = scan_time * 100 / last_scan_time;
+	change = change ? change : 1;
+	change = advisor_ctx.change ? ewma(advisor_ctx.change, change) : change;
+
+	pages = ksm_thread_pages_to_scan * 100 / factor;
+	pages = pages * change / 100;
+
+	/* Stay within the CPU budget: pages scanned per percent of CPU */
+	per_page_cost = ksm_thread_pages_to_scan / cpu_percent;
+	per_page_cost = per_page_cost ? per_page_cost : 1;
+
+	pages = min(pages, per_page_cost * ksm_advisor_max_cpu);
+	pages = max(pages, per_page_cost * KSM_ADVISOR_MIN_CPU);
+	pages = clamp(pages, ksm_advisor_min_pages_to_scan,
+		      ksm_advisor_max_pages_to_scan);
+
+	advisor_ctx.change = change;
+	advisor_ctx.scan_time = scan_time;
+
+	WRITE_ONCE(ksm_thread_pages_to_scan, pages);
+}
+
+static void ksm_advisor_start_scan(void)
+{
+	if (ksm_advisor == KSM_ADVISOR_SCAN_TIME) {
+		advisor_ctx.start_scan = ktime_get();
+		advisor_ctx.cpu_time = task_sched_runtime(current);
+	}
+}
+
+static void ksm_advisor_stop_scan(void)
+{
+	if (ksm_advisor == KSM_ADVISOR_SCAN_TIME &&
+	    advisor_ctx.start_scan)
+		scan_time_advisor();
+}
+
 static struct ksm_rmap_item *scan_get_next_rmap_item(struct page **page)
 {
 	struct mm_struct *mm;
@@ -2277,6 +2465,8 @@ static struct ksm_rmap_item *scan_get_next_rmap_item(struct page **page)
 		 */
 		lru_add_drain_all();
 
+		ksm_advisor_start_scan();
+
 		/*
 		 * Whereas stale stable_nodes on the stable_tree itself
 		 * get pruned in the regular course of stable_tree_search(),
@@ -2352,6 +2542,10 @@ next_mm:
 				if (rmap_item) {
 					ksm_scan.rmap_list =
 							&rmap_item->rmap_list;
+
+					if (should_skip_rmap_item(*page, rmap_item))
+						goto next_page;
+
 					ksm_scan.address += PAGE_SIZE;
 				} else
 					put_page(*page);
@@ -2415,6 +2609,7 @@ no_vmas:
 	if (mm_slot != &ksm_mm_head)
 		goto next_mm;
 
+	ksm_advisor_stop_scan();
 	ksm_scan.seqnr++;
 	return NULL;
 }
@@ -2923,6 +3118,10 @@ static ssize_t pages_to_scan_store(struct kobject *kobj,
 	unsigned int nr_pages;
 	int err;
 
+	/* The advisor owns pages_to_scan while it is enabled */
+	if (ksm_advisor != KSM_ADVISOR_NONE)
+		return -EINVAL;
+
 	err = kstrtouint(buf, 10, &nr_pages);
 	if (err)
 		return -EINVAL;
@@ -3061,6 +3260,160 @@ static ssize_t use_zero_pages_store(struct kobject *kobj,
 }
 KSM_ATTR(use_zero_pages);
 
+static ssize_t smart_scan_show(struct kobject *kobj,
+			       struct kobj_attribute *attr, char *buf)
+{
+	return sysfs_emit(buf, "%u\n", ksm_smart_scan);
+}
+
+static ssize_t smart_scan_store(struct kobject *kobj,
+				struct kobj_attribute *attr,
+				const char *buf, size_t count)
+{
+	int err;
+	bool value;
+
+	err = kstrtobool(buf, &value);
+	if (err)
+		return -EINVAL;
+
+	ksm_smart_scan = value;
+	return count;
+}
+KSM_ATTR(smart_scan);
+
+static ssize_t advisor_mode_show(struct kobject *kobj,
+				 struct kobj_attribute *attr, char *buf)
+{
+	const char *output;
+
+	if (ksm_advisor == KSM_ADVISOR_NONE)
+		output = "[none] scan-time";
+	else
+		output = "none [scan-time]";
+
+	return sysfs_emit(buf, "%s\n", output);
+}
+
+static ssize_t advisor_mode_store(struct kobject *kobj,
+				  struct kobj_attribute *attr, const char *buf,
+				  size_t count)
+{
+	enum ksm_advisor_type advisor;
+
+	if (sysfs_streq("scan-time", buf))
+		advisor = KSM_ADVISOR_SCAN_TIME;
+	else if (sysfs_streq("none", buf))
+		advisor = KSM_ADVISOR_NONE;
+	else
+		return -EINVAL;
+
+	/* Start from a clean slate, the next full scan is measured anew */
+	mutex_lock(&ksm_thread_mutex);
+	if (ksm_advisor != advisor) {
+		ksm_advisor = advisor;
+		memset(&advisor_ctx, 0, sizeof(advisor_ctx));
+		if (advisor == KSM_ADVISOR_SCAN_TIME)
+			ksm_thread_pages_to_scan = ksm_advisor_min_pages_to_scan;
+	}
+	mutex_unlock(&ksm_thread_mutex);
+
+	return count;
+}
+KSM_ATTR(advisor_mode);
+
+static ssize_t advisor_max_cpu_show(struct kobject *kobj,
+				    struct kobj_attribute *attr, char *buf)
+{
+	return sysfs_emit(buf, "%lu\n", ksm_advisor_max_cpu);
+}
+
+static ssize_t advisor_max_cpu_store(struct kobject *kobj,
+				     struct kobj_attribute *attr,
+				     const char *buf, size_t count)
+{
+	unsigned long value;
+	int err;
+
+	err = kstrtoul(buf, 10, &value);
+	if (err || value < KSM_ADVISOR_MIN_CPU || value > 100)
+		return -EINVAL;
+
+	ksm_advisor_max_cpu = value;
+	return count;
+}
+KSM_ATTR(advisor_max_cpu);
+
+static ssize_t advisor_min_pages_to_scan_show(struct kobject *kobj,
+					      struct kobj_attribute *attr,
+					      char *buf)
+{
+	return sysfs_emit(buf, "%lu\n", ksm_advisor_min_pages_to_scan);
+}
+
+static ssize_t advisor_min_pages_to_scan_store(struct kobject *kobj,
+					       struct kobj_attribute *attr,
+					       const char *buf, size_t count)
+{
+	unsigned long value;
+	int err;
+
+	err = kstrtoul(buf, 10, &value);
+	if (err || !value || value > ksm_advisor_max_pages_to_scan)
+		return -EINVAL;
+
+	ksm_advisor_min_pages_to_scan = value;
+	return count;
+}
+KSM_ATTR(advisor_min_pages_to_scan);
+
+static ssize_t advisor_max_pages_to_scan_show(struct kobject *kobj,
+					      struct kobj_attribute *attr,
+					      char *buf)
+{
+	return sysfs_emit(buf, "%lu\n", ksm_advisor_max_pages_to_scan);
+}
+
+static ssize_t advisor_max_pages_to_scan_store(struct kobject *kobj,
+					       struct kobj_attribute *attr,
+					       const char *buf, size_t count)
+{
+	unsigned long value;
+	int err;
+
+	err = kstrtoul(buf, 10, &value);
+	/* ksm_thread_pages_to_scan is an unsigned int */
+	if (err || value < ksm_advisor_min_pages_to_scan || value > UINT_MAX)
+		return -EINVAL;
+
+	ksm_advisor_max_pages_to_scan = value;
+	return count;
+}
+KSM_ATTR(advisor_max_pages_to_scan);
+
+static ssize_t advisor_target_scan_time_show(struct kobject *kobj,
+					     struct kobj_attribute *attr,
+					     char *buf)
+{
+	return sysfs_emit(buf, "%lu\n", ksm_advisor_target_scan_time);
+}
+
+static ssize_t advisor_target_scan_time_store(struct kobject *kobj,
+					      struct kobj_attribute *attr,
+					      const char *buf, size_t count)
+{
+	unsigned long value;
+	int err;
+
+	err = kstrtoul(buf, 10, &value);
+	if (err || value < 1)
+		return -EINVAL;
+
+	ksm_advisor_target_scan_time = value;
+	return count;
+}
+KSM_ATTR(advisor_target_scan_time);
+
 static ssize_t max_page_sharing_show(struct kobject *kobj,
 				     struct kobj_attribute *attr, char *buf)
 {
@@ -3140,6 +3493,13 @@ static ssize_t pages_volatile_show(struct kobject *kobj,
 }
 KSM_ATTR_RO(pages_volatile);
 
+static ssize_t pages_skipped_show(struct kobject *kobj,
+				  struct kobj_attribute *attr, char *buf)
+{
+	return sysfs_emit(buf, "%lu\n", ksm_pages_skipped);
+}
+KSM_ATTR_RO(pages_skipped);
+
 static ssize_t stable_node_dups_show(struct kobject *kobj,
 				     struct kobj_attribute *attr, char *buf)
 {
@@ -3195,6 +3555,7 @@ static struct attribute *ksm_attrs[] = {
 	&pages_sharing_attr.attr,
 	&pages_unshared_attr.attr,
 	&pages_volatile_attr.attr,
+	&pages_skipped_attr.attr,
 	&full_scans_attr.attr,
 #ifdef CONFIG_NUMA
 	&merge_across_nodes_attr.attr,
@@ -3204,6 +3565,12 @@ static struct attribute *ksm_attrs[] = {
 	&stable_node_dups_attr.attr,
 	&stable_node_chains_prune_millisecs_attr.attr,
 	&use_zero_pages_attr.attr,
+	&smart_scan_attr.attr,
+	&advisor_mode_attr.attr,
+	&advisor_max_cpu_attr.attr,
+	&advisor_min_pages_to_scan_attr.attr,
+	&advisor_max_pages_to_scan_attr.attr,
+	&advisor_target_scan_time_attr.attr,
 	NULL,
 };
 
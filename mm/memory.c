@@ -77,6 +77,7 @@
 #include <linux/ptrace.h>
 #include <linux/vmalloc.h>
 #include <linux/sched/sysctl.h>
+#include <linux/latency_hist.h>
 
 #include <trace/events/kmem.h>
 
@@ -3714,6 +3715,15 @@ vm_fault_t do_swap_page(struct vm_fault *vmf)
 	vm_fault_t ret = 0;
 	void *shadow = NULL;
 
+	/*
+	 * Swapin may need to sleep on the folio lock or on a migration entry,
+	 * which drops mmap_lock in ways the VMA lock can't express yet.
+	 */
+	if (vmf->flags & FAULT_FLAG_VMA_LOCK) {
+		ret = VM_FAULT_RETRY;
+		goto out;
+	}
+
 	if (!pte_unmap_same(vmf))
 		goto out;
 
@@ -4035,11 +4045,106 @@ out_release:
  * but allow concurrent faults), and pte mapped but not yet locked.
  * We return with mmap_lock still held, but pte unmapped and unlocked.
  */
-static vm_fault_t do_anonymous_page(struct vm_fault *vmf)
+static bool pte_range_none(pte_t *pte, int nr_pages)
+{
+	int i;
+
+	for (i = 0; i < nr_pages; i++) {
+		if (!pte_none(ptep_get(pte + i)))
+			return false;
+	}
+
+	return true;
+}
+
+static inline int highest_anon_order(unsigned long orders)
+{
+	return fls_long(orders) - 1;
+}
+
+static inline int next_anon_order(unsigned long *orders, int prev)
+{
+	*orders &= ~BIT(prev);
+	return highest_anon_order(*orders);
+}
+
+/*
+ * Allocate, zero and charge the folio for an anonymous write fault. Try the
+ * largest sub-PMD order enabled in sysfs whose naturally aligned range lies
+ * within the vma and has no ptes populated yet, and fall back to smaller
+ * orders and finally to a single page.
+ */
+static struct folio *alloc_anon_folio(struct vm_fault *vmf)
 {
 	struct vm_area_struct *vma = vmf->vma;
+	struct folio *folio;
 	struct page *page;
+#ifdef CONFIG_TRANSPARENT_HUGEPAGE
+	unsigned long orders, addr;
+	pte_t *pte;
+	gfp_t gfp;
+	int order;
+
+	/*
+	 * A missing-mode userfaultfd wants to see every single page fault, a
+	 * large folio would populate neighbouring ptes behind its back.
+	 */
+	if (unlikely(userfaultfd_armed(vma)))
+		goto fallback;
+
+	orders = thp_vma_anon_orders(vma);
+	for (order = highest_anon_order(orders); orders;
+	     order = next_anon_order(&orders, order)) {
+		addr = ALIGN_DOWN(vmf->address, PAGE_SIZE << order);
+		if (addr >= vma->vm_start &&
+		    addr + (PAGE_SIZE << order) <= vma->vm_end)
+			break;
+	}
+	if (!orders)
+		goto fallback;
+
+	pte = pte_offset_map(vmf->pmd, vmf->address & PMD_MASK);
+	for (; orders; order = next_anon_order(&orders, order)) {
+		addr = ALIGN_DOWN(vmf->address, PAGE_SIZE << order);
+		if (pte_range_none(pte + pte_index(addr), 1 << order))
+			break;
+	}
+	pte_unmap(pte);
+
+	gfp = vma_thp_gfp_mask(vma);
+	for (; orders; order = next_anon_order(&orders, order)) {
+		addr = ALIGN_DOWN(vmf->address, PAGE_SIZE << order);
+		folio = vma_alloc_folio(gfp, order, vma, addr, true);
+		if (!folio)
+			continue;
+		if (mem_cgroup_charge(folio, vma->vm_mm, gfp)) {
+			folio_put(folio);
+			continue;
+		}
+		clear_huge_page(&folio->page, vmf->address, 1 << order);
+		return folio;
+	}
+
+fallback:
+#endif
+	page = alloc_zeroed_user_highpage_movable(vma, vmf->address);
+	if (!page)
+		return NULL;
+	folio = page_folio(page);
+	if (mem_cgroup_charge(folio, vma->vm_mm, GFP_KERNEL)) {
+		folio_put(folio);
+		return NULL;
+	}
+	return folio;
+}
+
+static vm_fault_t do_anonymous_page(struct vm_fault *vmf)
+{
+	struct vm_area_struct *vma = vmf->vma;
+	unsigned long addr = vmf->address;
+	struct folio *folio;
 	vm_fault_t ret = 0;
+	int i, nr_pages = 1;
 	pte_t entry;
 
 	/* File mapping without ->vm_ops ? */
@@ -4088,30 +4193,25 @@ static vm_fault_t do_anonymous_page(struct vm_fault *vmf)
 	/* Allocate our own private page. */
 	if (unlikely(anon_vma_prepare(vma)))
 		goto oom;
-	page = alloc_zeroed_user_highpage_movable(vma, vmf->address);
-	if (!page)
+	folio = alloc_anon_folio(vmf);
+	if (!folio)
 		goto oom;
 
-	if (mem_cgroup_charge(page_folio(page), vma->vm_mm, GFP_KERNEL))
-		goto oom_free_page;
-	cgroup_throttle_swaprate(page, GFP_KERNEL);
+	nr_pages = folio_nr_pages(folio);
+	addr = ALIGN_DOWN(vmf->address, nr_pages * PAGE_SIZE);
+	cgroup_throttle_swaprate(&folio->page, GFP_KERNEL);
 
 	/*
-	 * The memory barrier inside __SetPageUptodate makes sure that
-	 * preceding stores to the page contents become visible before
+	 * The memory barrier inside __folio_mark_uptodate makes sure that
+	 * preceding stores to the folio contents become visible before
 	 * the set_pte_at() write.
 	 */
-	__SetPageUptodate(page);
+	__folio_mark_uptodate(folio);
 
-	entry = mk_pte(page, vma->vm_page_prot);
-	entry = pte_sw_mkyoung(entry);
-	if (vma->vm_flags & VM_WRITE)
-		entry = pte_mkwrite(pte_mkdirty(entry));
-
-	vmf->pte = pte_offset_map_lock(vma->vm_mm, vmf->pmd, vmf->address,
-			&vmf->ptl);
-	if (!pte_none(*vmf->pte)) {
-		update_mmu_tlb(vma, vmf->address, vmf->pte);
+	vmf->pte = pte_offset_map_lock(vma->vm_mm, vmf->pmd, addr, &vmf->ptl);
+	if (!pte_range_none(vmf->pte, nr_pages)) {
+		for (i = 0; i < nr_pages; i++)
+			update_mmu_tlb(vma, addr + i * PAGE_SIZE, vmf->pte + i);
 		goto release;
 	}
 
@@ -4122,13 +4222,28 @@ static vm_fault_t do_anonymous_page(struct vm_fault *vmf)
 	/* Deliver the page fault to userland, check inside PT lock */
 	if (userfaultfd_missing(vma)) {
 		pte_unmap_unlock(vmf->pte, vmf->ptl);
-		put_page(page);
+		folio_put(folio);
 		return handle_userfault(vmf, VM_UFFD_MISSING);
 	}
 
-	inc_mm_counter(vma->vm_mm, MM_ANONPAGES);
-	page_add_new_anon_rmap(page, vma, vmf->address);
-	lru_cache_add_inactive_or_unevictable(page, vma);
+	/* Each PTE mapping the folio holds a reference, as zap drops one per PTE */
+	folio_ref_add(folio, nr_pages - 1);
+	add_mm_counter(vma->vm_mm, MM_ANONPAGES, nr_pages);
+	folio_add_new_anon_rmap_ptes(folio, vma, addr);
+	folio_add_lru_vma(folio, vma);
+
+	for (i = 0; i < nr_pages; i++) {
+		entry = mk_pte(folio_page(folio, i), vma->vm_page_prot);
+		entry = pte_sw_mkyoung(entry);
+		if (vma->vm_flags & VM_WRITE)
+			entry = pte_mkwrite(pte_mkdirty(entry));
+		set_pte_at(vma->vm_mm, addr + i * PAGE_SIZE, vmf->pte + i,
+			   entry);
+
+		/* No need to invalidate - it was non-present before */
+		update_mmu_cache(vma, addr + i * PAGE_SIZE, vmf->pte + i);
+	}
+	goto unlock;
 setpte:
 	set_pte_at(vma->vm_mm, vmf->address, vmf->pte, entry);
 
@@ -4138,10 +4253,8 @@ unlock:
 	pte_unmap_unlock(vmf->pte, vmf->ptl);
 	return ret;
 release:
-	put_page(page);
+	folio_put(folio);
 	goto unlock;
-oom_free_page:
-	put_page(page);
 oom:
 	return VM_FAULT_OOM;
 }
@@ -5205,6 +5318,7 @@ static vm_fault_t sanitize_fault_flags(struct vm_area_struct *vma,
 vm_fault_t handle_mm_fault(struct vm_area_struct *vma, unsigned long address,
 			   unsigned int flags, struct pt_regs *regs)
 {
+	u64 start = lat_hist_start();
 	vm_fault_t ret;
 
 	__set_current_state(TASK_RUNNING);
@@ -5251,10 +5365,80 @@ vm_fault_t handle_mm_fault(struct vm_area_struct *vma, unsigned long address,
 
 	mm_account_fault(regs, address, flags, ret);
 
+	lat_hist_end(LAT_HIST_FAULT, !!(flags & FAULT_FLAG_USER), start);
+
 	return ret;
 }
 EXPORT_SYMBOL_GPL(handle_mm_fault);
 
+#ifdef CONFIG_PER_VMA_LOCK
+/*
+ * Lookup and lock a VMA under RCU protection. Returned VMA is guaranteed to be
+ * stable and not isolated. If the VMA is not found or is being modified the
+ * function returns NULL.
+ *
+ * Only anonymous VMAs which already have an anon_vma are handled, everything
+ * else still needs mmap_lock for the fault to be handled correctly.
+ */
+struct vm_area_struct *lock_vma_under_rcu(struct mm_struct *mm,
+					  unsigned long address)
+{
+	MA_STATE(mas, &mm->mm_mt, address, address);
+	struct vm_area_struct *vma;
+
+	rcu_read_lock();
+retry:
+	vma = mas_walk(&mas);
+	if (!vma)
+		goto inval;
+
+	/* Only anonymous vmas are supported for now */
+	if (!vma_is_anonymous(vma))
+		goto inval;
+
+	/* find_mergeable_anon_vma uses adjacent vmas which are not locked */
+	if (!vma->anon_vma)
+		goto inval;
+
+	/* Stack expansion updates vm_start/vm_end under mmap_read_lock */
+	if (vma->vm_flags & (VM_GROWSDOWN | VM_GROWSUP))
+		goto inval;
+
+	if (!vma_start_read(vma))
+		goto inval;
+
+	/*
+	 * Due to the possibility of userfault handler dropping mmap_lock, avoid
+	 * it for now and fall back to page fault handling under mmap_lock.
+	 */
+	if (userfaultfd_armed(vma)) {
+		vma_end_read(vma);
+		goto inval;
+	}
+
+	/* Check since vm_start/vm_end might change before we lock the VMA */
+	if (unlikely(address < vma->vm_start || address >= vma->vm_end)) {
+		vma_end_read(vma);
+		goto inval;
+	}
+
+	/* Check if the VMA got isolated after we found it */
+	if (vma->detached) {
+		vma_end_read(vma);
+		count_vm_vma_lock_event(VMA_LOCK_MISS);
+		/* The area was replaced with another one */
+		goto retry;
+	}
+
+	rcu_read_unlock();
+	return vma;
+inval:
+	rcu_read_unlock();
+	count_vm_vma_lock_event(VMA_LOCK_ABORT);
+	return NULL;
+}
+#endif /* CONFIG_PER_VMA_LOCK */
+
 #ifndef __PAGETABLE_P4D_FOLDED
 /*
  * Allocate p4d page table.
@@ -5741,12 +5925,43 @@ static void clear_subpage(unsigned long addr, int idx, void *arg)
 	clear_user_highpage(page + idx, addr);
 }
 
+/*
+ * Clear a huge page bigger than the cache without going through it, except
+ * for the target subpage which is cleared last with regular stores as it is
+ * about to be accessed.
+ */
+static void clear_huge_page_nocache(struct page *page, unsigned long addr,
+				    unsigned long addr_hint,
+				    unsigned int pages_per_huge_page)
+{
+	int target = (addr_hint - addr) / PAGE_SIZE;
+	int i;
+
+	might_sleep();
+	for (i = 0; i < pages_per_huge_page; i++) {
+		if (i == target)
+			continue;
+		cond_resched();
+		clear_user_highpage_nocache(nth_page(page, i),
+					    addr + i * PAGE_SIZE);
+	}
+	clear_page_nocache_fence();
+	clear_user_highpage(nth_page(page, target), addr + target * PAGE_SIZE);
+}
+
 void clear_huge_page(struct page *page,
 		     unsigned long addr_hint, unsigned int pages_per_huge_page)
 {
 	unsigned long addr = addr_hint &
 		~(((unsigned long)pages_per_huge_page << PAGE_SHIFT) - 1);
 
+	if ((unsigned long)pages_per_huge_page * PAGE_SIZE >
+	    clear_page_nocache_threshold()) {
+		clear_huge_page_nocache(page, addr, addr_hint,
+					pages_per_huge_page);
+		return;
+	}
+
 	if (unlikely(pages_per_huge_page > MAX_ORDER_NR_PAGES)) {
 		clear_gigantic_page(page, addr, pages_per_huge_page);
 		return;
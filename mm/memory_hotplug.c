@@ -36,6 +36,7 @@
 #include <linux/compaction.h>
 #include <linux/rmap.h>
 #include <linux/module.h>
+#include <linux/padata.h>
 
 #include <asm/tlbflush.h>
 
@@ -675,6 +676,66 @@ static inline void section_taint_zone_device(unsigned long pfn)
 }
 #endif
 
+struct memmap_init_job_arg {
+	int nid;
+	unsigned long zone_idx;
+	int migratetype;
+};
+
+static void memmap_init_hotplug_chunk(unsigned long start_pfn,
+				      unsigned long end_pfn, void *arg)
+{
+	struct memmap_init_job_arg *args = arg;
+
+	memmap_init_range(end_pfn - start_pfn, args->nid, args->zone_idx,
+			  start_pfn, 0, MEMINIT_HOTPLUG, NULL,
+			  args->migratetype);
+}
+
+/*
+ * Initializing the memmap dominates the time it takes to hot-add large
+ * ranges, so split it up section-wise across the CPUs of the node like
+ * deferred_init_memmap() does at boot. Sections don't share pageblock
+ * flags, so the chunks are independent.
+ */
+static void memmap_init_hotplug(struct zone *zone, unsigned long start_pfn,
+				unsigned long nr_pages, struct vmem_altmap *altmap,
+				int migratetype)
+{
+	int nid = zone_to_nid(zone);
+	struct memmap_init_job_arg args = {
+		.nid		= nid,
+		.zone_idx	= zone_idx(zone),
+		.migratetype	= migratetype,
+	};
+	struct padata_mt_job job = {
+		.thread_fn	= memmap_init_hotplug_chunk,
+		.fn_arg		= &args,
+		.start		= start_pfn,
+		.size		= nr_pages,
+		.align		= PAGES_PER_SECTION,
+		.min_chunk	= PAGES_PER_SECTION,
+	};
+
+	/* ZONE_DEVICE only initializes the altmap backed part here */
+	if (!IS_ENABLED(CONFIG_PADATA) || zone_is_zone_device(zone) ||
+	    nr_pages < 2 * PAGES_PER_SECTION) {
+		memmap_init_range(nr_pages, nid, zone_idx(zone), start_pfn, 0,
+				  MEMINIT_HOTPLUG, altmap, migratetype);
+		return;
+	}
+
+	/* Updated once up front instead of racing from every chunk. */
+	if (highest_memmap_pfn < start_pfn + nr_pages - 1)
+		highest_memmap_pfn = start_pfn + nr_pages - 1;
+
+	job.max_threads = cpumask_weight(cpumask_of_node(nid));
+	if (!job.max_threads)
+		job.max_threads = num_online_cpus();
+
+	padata_do_multithreaded(&job);
+}
+
 /*
  * Associate the pfn range with the given zone, initializing the memmaps
  * and resizing the pgdat/zone data to span the added pages. After this
@@ -717,8 +778,7 @@ void __ref move_pfn_range_to_zone(struct zone *zone, unsigned long start_pfn,
 	 * expects the zone spans the pfn range. All the pages in the range
 	 * are reserved so nobody should be touching them so we should be safe
 	 */
-	memmap_init_range(nr_pages, nid, zone_idx(zone), start_pfn, 0,
-			 MEMINIT_HOTPLUG, altmap, migratetype);
+	memmap_init_hotplug(zone, start_pfn, nr_pages, altmap, migratetype);
 
 	set_zone_contiguous(zone);
 }
@@ -1011,13 +1011,128 @@ out:
 	return rc;
 }
 
-static int __unmap_and_move(struct folio *src, struct folio *dst,
-				int force, enum migrate_mode mode)
+/*
+ * Returned by migrate_folio_unmap() when the source folio is locked and
+ * unmapped, and migrate_folio_move() can copy it to the destination.
+ */
+#define MIGRATEPAGE_UNMAP		1
+
+/*
+ * To record some information during migration, we use the otherwise
+ * unused private field of the destination folio. This is safe because
+ * nobody else can access the destination folio until migration completes.
+ */
+static void __migrate_folio_record(struct folio *dst,
+				   unsigned long page_was_mapped,
+				   struct anon_vma *anon_vma)
+{
+	dst->private = (void *)anon_vma + page_was_mapped;
+}
+
+static void __migrate_folio_extract(struct folio *dst,
+				   int *page_was_mappedp,
+				   struct anon_vma **anon_vmap)
+{
+	unsigned long private = (unsigned long)dst->private;
+
+	*anon_vmap = (struct anon_vma *)(private & ~1UL);
+	*page_was_mappedp = private & 1;
+	dst->private = NULL;
+}
+
+/* Account and release a source folio that is fully migrated or was freed. */
+static void migrate_folio_done(struct folio *src, enum migrate_reason reason)
+{
+	/*
+	 * Compaction can migrate also non-LRU folios which are
+	 * not accounted to NR_ISOLATED_*. They can be recognized
+	 * as __folio_test_movable
+	 */
+	if (likely(!__folio_test_movable(src)))
+		mod_node_page_state(folio_pgdat(src), NR_ISOLATED_ANON +
+				folio_is_file_lru(src), -folio_nr_pages(src));
+
+	if (reason != MR_MEMORY_FAILURE)
+		/*
+		 * We release the folio in page_handle_poison.
+		 */
+		folio_put(src);
+}
+
+/* Restore the source folio to its state before migrate_folio_unmap(). */
+static void migrate_folio_undo_src(struct folio *src, int page_was_mapped,
+				   struct anon_vma *anon_vma, bool locked,
+				   struct list_head *ret)
 {
+	if (page_was_mapped)
+		remove_migration_ptes(src, src, false);
+	/* Drop an anon_vma reference if we took one */
+	if (anon_vma)
+		put_anon_vma(anon_vma);
+	if (locked)
+		folio_unlock(src);
+	/*
+	 * A folio that has not been migrated will have kept its references
+	 * and be restored to the ret list, unless we want to retry.
+	 */
+	if (ret)
+		list_move_tail(&src->lru, ret);
+}
+
+/* Release the destination folio of a failed migration. */
+static void migrate_folio_undo_dst(struct folio *dst, bool locked,
+				   free_page_t put_new_page,
+				   unsigned long private)
+{
+	if (locked)
+		folio_unlock(dst);
+	if (put_new_page)
+		put_new_page(&dst->page, private);
+	else
+		folio_put(dst);
+}
+
+/*
+ * Obtain the lock on folio and remove all ptes. On MIGRATEPAGE_UNMAP, both
+ * folios are left locked for migrate_folio_move() and *dstp is set. The TLB
+ * flush for the removed ptes is deferred to the caller, which must call
+ * try_to_unmap_flush() before moving the folio.
+ */
+static int migrate_folio_unmap(new_page_t get_new_page,
+			       free_page_t put_new_page, unsigned long private,
+			       struct folio *src, struct folio **dstp,
+			       int force, enum migrate_mode mode,
+			       enum migrate_reason reason, struct list_head *ret)
+{
+	struct folio *dst;
 	int rc = -EAGAIN;
-	bool page_was_mapped = false;
+	struct page *newpage = NULL;
+	int page_was_mapped = 0;
 	struct anon_vma *anon_vma = NULL;
 	bool is_lru = !__PageMovable(&src->page);
+	bool locked = false;
+	bool dst_locked = false;
+
+	if (!thp_migration_supported() && folio_test_transhuge(src))
+		return -ENOSYS;
+
+	if (folio_ref_count(src) == 1) {
+		/* Folio was freed from under us. So we are done. */
+		folio_clear_active(src);
+		folio_clear_unevictable(src);
+		/* free_pages_prepare() will clear PG_isolated. */
+		list_del(&src->lru);
+		migrate_folio_done(src, reason);
+		return MIGRATEPAGE_SUCCESS;
+	}
+
+	newpage = get_new_page(&src->page, private);
+	if (!newpage)
+		return -ENOMEM;
+	dst = page_folio(newpage);
+	*dstp = dst;
+
+	dst->private = NULL;
 
 	if (!folio_trylock(src)) {
 		if (!force || mode == MIGRATE_ASYNC)
@@ -1041,6 +1156,7 @@ static int __unmap_and_move(struct folio *src, struct folio *dst,
 
 		folio_lock(src);
 	}
+	locked = true;
 
 	if (folio_test_writeback(src)) {
 		/*
@@ -1055,10 +1171,10 @@ static int __unmap_and_move(struct folio *src, struct folio *dst,
 			break;
 		default:
 			rc = -EBUSY;
-			goto out_unlock;
+			goto out;
 		}
 		if (!force)
-			goto out_unlock;
+			goto out;
 		folio_wait_writeback(src);
 	}
 
@@ -1088,11 +1204,12 @@ static int __unmap_and_move(struct folio *src, struct folio *dst,
 	 * This is much like races on refcount of oldpage: just don't BUG().
 	 */
 	if (unlikely(!folio_trylock(dst)))
-		goto out_unlock;
+		goto out;
+	dst_locked = true;
 
 	if (unlikely(!is_lru)) {
-		rc = move_to_new_folio(dst, src, mode);
-		goto out_unlock_both;
+		__migrate_folio_record(dst, page_was_mapped, anon_vma);
+		return MIGRATEPAGE_UNMAP;
 	}
 
 	/*
@@ -1110,18 +1227,54 @@ static int __unmap_and_move(struct folio *src, struct folio *dst,
 	if (!src->mapping) {
 		if (folio_test_private(src)) {
 			try_to_free_buffers(src);
-			goto out_unlock_both;
+			goto out;
 		}
 	} else if (folio_mapped(src)) {
 		/* Establish migration ptes */
 		VM_BUG_ON_FOLIO(folio_test_anon(src) &&
 			       !folio_test_ksm(src) && !anon_vma, src);
-		try_to_migrate(src, 0);
-		page_was_mapped = true;
+		try_to_migrate(src, TTU_BATCH_FLUSH);
+		page_was_mapped = 1;
 	}
 
-	if (!folio_mapped(src))
-		rc = move_to_new_folio(dst, src, mode);
+	if (!folio_mapped(src)) {
+		__migrate_folio_record(dst, page_was_mapped, anon_vma);
+		return MIGRATEPAGE_UNMAP;
+	}
+
+out:
+	/*
+	 * Flush the ptes we may have cleared before they are restored, the
+	 * rest of the batch just gets flushed a bit early.
+	 */
+	if (page_was_mapped)
+		try_to_unmap_flush();
+	migrate_folio_undo_src(src, page_was_mapped, anon_vma, locked,
+			       rc == -EAGAIN ? NULL : ret);
+	migrate_folio_undo_dst(dst, dst_locked, put_new_page, private);
+
+	return rc;
+}
+
+/*
+ * Migrate the folio unmapped by migrate_folio_unmap() to the newly allocated
+ * folio in dst. The TLB entries of the removed ptes must have been flushed.
+ */
+static int migrate_folio_move(free_page_t put_new_page, unsigned long private,
+			      struct folio *src, struct folio *dst,
+			      enum migrate_mode mode, enum migrate_reason reason,
+			      struct list_head *ret)
+{
+	int rc;
+	int page_was_mapped = 0;
+	struct anon_vma *anon_vma = NULL;
+	bool is_lru = !__PageMovable(&src->page);
+
+	__migrate_folio_extract(dst, &page_was_mapped, &anon_vma);
+
+	rc = move_to_new_folio(dst, src, mode);
+	if (unlikely(!is_lru))
+		goto out_unlock_both;
 
 	/*
 	 * When successful, push dst to LRU immediately: so that if it
@@ -1144,19 +1297,32 @@ static int __unmap_and_move(struct folio *src, struct folio *dst,
 
 out_unlock_both:
 	folio_unlock(dst);
-out_unlock:
 	/* Drop an anon_vma reference if we took one */
 	if (anon_vma)
 		put_anon_vma(anon_vma);
 	folio_unlock(src);
-out:
+
+	if (rc == MIGRATEPAGE_SUCCESS) {
+		set_page_owner_migrate_reason(&dst->page, reason);
+		/*
+		 * If migration is successful, decrease refcount of dst,
+		 * which will not free the page because new page owner
+		 * increased refcounter. The migrated src has all references
+		 * removed and will be freed.
+		 */
+		folio_put(dst);
+		list_del(&src->lru);
+		migrate_folio_done(src, reason);
+		return rc;
+	}
+
 	/*
-	 * If migration is successful, decrease refcount of dst,
-	 * which will not free the page because new page owner increased
-	 * refcounter.
+	 * A folio that has not been migrated will have kept its references
+	 * and be restored to the ret list, unless we want to retry.
 	 */
-	if (rc == MIGRATEPAGE_SUCCESS)
-		folio_put(dst);
+	if (rc != -EAGAIN)
+		list_move_tail(&src->lru, ret);
+	migrate_folio_undo_dst(dst, false, put_new_page, private);
 
 	return rc;
 }
@@ -1172,72 +1338,19 @@ static int unmap_and_move(new_page_t get_new_page,
 				   enum migrate_reason reason,
 				   struct list_head *ret)
 {
-	struct folio *dst;
-	int rc = MIGRATEPAGE_SUCCESS;
-	struct page *newpage = NULL;
-
-	if (!thp_migration_supported() && folio_test_transhuge(src))
-		return -ENOSYS;
-
-	if (folio_ref_count(src) == 1) {
-		/* Folio was freed from under us. So we are done. */
-		folio_clear_active(src);
-		folio_clear_unevictable(src);
-		/* free_pages_prepare() will clear PG_isolated. */
-		goto out;
-	}
-
-	newpage = get_new_page(&src->page, private);
-	if (!newpage)
-		return -ENOMEM;
-	dst = page_folio(newpage);
-
-	dst->private = NULL;
-	rc = __unmap_and_move(src, dst, force, mode);
-	if (rc == MIGRATEPAGE_SUCCESS)
-		set_page_owner_migrate_reason(&dst->page, reason);
-
-out:
-	if (rc != -EAGAIN) {
-		/*
-		 * A folio that has been migrated has all references
-		 * removed and will be freed. A folio that has not been
-		 * migrated will have kept its references and be restored.
-		 */
-		list_del(&src->lru);
-	}
-
-	/*
-	 * If migration is successful, releases reference grabbed during
-	 * isolation. Otherwise, restore the folio to right list unless
-	 * we want to retry.
-	 */
-	if (rc == MIGRATEPAGE_SUCCESS) {
-		/*
-		 * Compaction can migrate also non-LRU folios which are
-		 * not accounted to NR_ISOLATED_*. They can be recognized
-		 * as __folio_test_movable
-		 */
-		if (likely(!__folio_test_movable(src)))
-			mod_node_page_state(folio_pgdat(src), NR_ISOLATED_ANON +
-					folio_is_file_lru(src), -folio_nr_pages(src));
+	struct folio *dst = NULL;
+	int rc;
 
-		if (reason != MR_MEMORY_FAILURE)
-			/*
-			 * We release the folio in page_handle_poison.
-			 */
-			folio_put(src);
-	} else {
-		if (rc != -EAGAIN)
-			list_add_tail(&src->lru, ret);
+	rc = migrate_folio_unmap(get_new_page, put_new_page, private, src,
+				 &dst, force, mode, reason, ret);
+	if (rc != MIGRATEPAGE_UNMAP)
+		return rc;
 
-		if (put_new_page)
-			put_new_page(&dst->page, private);
-		else
-			folio_put(dst);
-	}
+	/* One flush for all the ptes of the folio, e.g. a pte-mapped THP */
+	try_to_unmap_flush();
 
-	return rc;
+	return migrate_folio_move(put_new_page, private, src, dst, mode,
+				  reason, ret);
 }
 
 /*
@@ -1385,11 +1498,97 @@ out:
 	return rc;
 }
 
-static inline int try_split_folio(struct folio *folio, struct list_head *split_folios)
+#ifdef CONFIG_TRANSPARENT_HUGEPAGE
+#define NR_MAX_BATCHED_MIGRATION	HPAGE_PMD_NR
+#else
+#define NR_MAX_BATCHED_MIGRATION	512
+#endif
+
+/* Results of migrate_pages(), also updated by migrate_folios_move_batch() */
+struct migrate_pages_stats {
+	int nr_succeeded;
+	int nr_thp_succeeded;
+	int nr_failed;
+	int nr_large_failed;
+	int nr_thp_failed;
+	int nr_failed_pages;
+	int retry;
+	int large_retry;
+	int thp_retry;
+	int nr_retry_pages;
+};
+
+/*
+ * Move the folios that migrate_folio_unmap() unmapped, after one TLB flush
+ * for all of them rather than one per folio. Folios to retry are put on
+ * @retry_folios, permanent failures on @ret_folios.
+ */
+static void migrate_folios_move_batch(struct list_head *unmap_folios,
+		struct list_head *dst_folios, free_page_t put_new_page,
+		unsigned long private, enum migrate_mode mode, int reason,
+		struct list_head *retry_folios, struct list_head *ret_folios,
+		bool no_split_folio_counting, struct migrate_pages_stats *stats)
+{
+	struct folio *folio, *folio2, *dst;
+	bool is_large, is_thp;
+	int rc, nr_pages;
+
+	try_to_unmap_flush();
+
+	list_for_each_entry_safe(folio, folio2, unmap_folios, lru) {
+		dst = list_first_entry(dst_folios, struct folio, lru);
+		is_large = folio_test_large(folio);
+		is_thp = is_large && folio_test_pmd_mappable(folio);
+		nr_pages = folio_nr_pages(folio);
+
+		/* dst->lru is needed for the LRU again */
+		list_del(&dst->lru);
+		rc = migrate_folio_move(put_new_page, private, folio, dst,
+					mode, reason, ret_folios);
+		switch (rc) {
+		case MIGRATEPAGE_SUCCESS:
+			stats->nr_succeeded += nr_pages;
+			stats->nr_thp_succeeded += is_thp;
+			break;
+		case -EAGAIN:
+			list_move_tail(&folio->lru, retry_folios);
+			if (is_large) {
+				stats->large_retry++;
+				stats->thp_retry += is_thp;
+			} else if (!no_split_folio_counting) {
+				stats->retry++;
+			}
+			stats->nr_retry_pages += nr_pages;
+			break;
+		default:
+			if (is_large) {
+				stats->nr_large_failed++;
+				stats->nr_thp_failed += is_thp;
+			} else if (!no_split_folio_counting) {
+				stats->nr_failed++;
+			}
+			stats->nr_failed_pages += nr_pages;
+			break;
+		}
+	}
+}
+
+static inline int try_split_folio(struct folio *folio, struct list_head *split_folios,
+				  enum migrate_mode mode)
 {
 	int rc;
 
-	folio_lock(folio);
+	/*
+	 * Batched asynchronous migration may hold the locks of unmapped
+	 * folios already: sleeping on another lock could deadlock against
+	 * another migrator doing the same.
+	 */
+	if (mode == MIGRATE_ASYNC) {
+		if (!folio_trylock(folio))
+			return -EAGAIN;
+	} else {
+		folio_lock(folio);
+	}
 	rc = split_folio_to_list(folio, split_folios);
 	folio_unlock(folio);
 	if (!rc)
@@ -1428,16 +1627,11 @@ int migrate_pages(struct list_head *from, new_page_t get_new_page,
 		free_page_t put_new_page, unsigned long private,
 		enum migrate_mode mode, int reason, unsigned int *ret_succeeded)
 {
-	int retry = 1;
-	int large_retry = 1;
-	int thp_retry = 1;
-	int nr_failed = 0;
-	int nr_failed_pages = 0;
-	int nr_retry_pages = 0;
-	int nr_succeeded = 0;
-	int nr_thp_succeeded = 0;
-	int nr_large_failed = 0;
-	int nr_thp_failed = 0;
+	struct migrate_pages_stats stats = {
+		.retry = 1,
+		.large_retry = 1,
+		.thp_retry = 1,
+	};
 	int nr_thp_split = 0;
 	int pass = 0;
 	bool is_large = false;
@@ -1446,17 +1640,28 @@ int migrate_pages(struct list_head *from, new_page_t get_new_page,
 	int rc, nr_pages;
 	LIST_HEAD(ret_folios);
 	LIST_HEAD(split_folios);
+	LIST_HEAD(unmap_folios);
+	LIST_HEAD(dst_folios);
+	LIST_HEAD(retry_folios);
+	int nr_unmap_pages = 0;
 	bool nosplit = (reason == MR_NUMA_MISPLACED);
 	bool no_split_folio_counting = false;
+	/*
+	 * Asynchronous migration, as used by NUMA balancing, demotion and
+	 * async compaction, only trylocks folios, so holding the locks of a
+	 * batch of unmapped folios can't deadlock. Unmap a batch first and
+	 * then flush the TLB once for all of them before copying.
+	 */
+	bool batch = (mode == MIGRATE_ASYNC);
 
 	trace_mm_migrate_pages_start(mode, reason);
 
 split_folio_migration:
-	for (pass = 0; pass < 10 && (retry || large_retry); pass++) {
-		retry = 0;
-		large_retry = 0;
-		thp_retry = 0;
-		nr_retry_pages = 0;
+	for (pass = 0; pass < 10 && (stats.retry || stats.large_retry); pass++) {
+		stats.retry = 0;
+		stats.large_retry = 0;
+		stats.thp_retry = 0;
+		stats.nr_retry_pages = 0;
 
 		list_for_each_entry_safe(folio, folio2, from, lru) {
 			/*
@@ -1475,10 +1680,33 @@ split_folio_migration:
 						&folio->page, pass > 2, mode,
 						reason,
 						&ret_folios);
-			else
+			else if (!batch)
 				rc = unmap_and_move(get_new_page, put_new_page,
 						private, folio, pass > 2, mode,
 						reason, &ret_folios);
+			else {
+				struct folio *dst = NULL;
+
+				rc = migrate_folio_unmap(get_new_page,
+						put_new_page, private, folio,
+						&dst, pass > 2, mode, reason,
+						&ret_folios);
+				if (rc == MIGRATEPAGE_UNMAP) {
+					list_move_tail(&folio->lru, &unmap_folios);
+					list_add_tail(&dst->lru, &dst_folios);
+					nr_unmap_pages += nr_pages;
+					if (nr_unmap_pages >= NR_MAX_BATCHED_MIGRATION) {
+						migrate_folios_move_batch(&unmap_folios,
+							&dst_folios, put_new_page,
+							private, mode, reason,
+							&retry_folios, &ret_folios,
+							no_split_folio_counting,
+							&stats);
+						nr_unmap_pages = 0;
+					}
+					continue;
+				}
+			}
 			/*
 			 * The rules are:
 			 *	Success: non hugetlb folio will be freed, hugetlb
@@ -1503,18 +1731,18 @@ split_folio_migration:
 			case -ENOSYS:
 				/* Large folio migration is unsupported */
 				if (is_large) {
-					nr_large_failed++;
-					nr_thp_failed += is_thp;
-					if (!try_split_folio(folio, &split_folios)) {
+					stats.nr_large_failed++;
+					stats.nr_thp_failed += is_thp;
+					if (!try_split_folio(folio, &split_folios, mode)) {
 						nr_thp_split += is_thp;
 						break;
 					}
 				/* Hugetlb migration is unsupported */
 				} else if (!no_split_folio_counting) {
-					nr_failed++;
+					stats.nr_failed++;
 				}
 
-				nr_failed_pages += nr_pages;
+				stats.nr_failed_pages += nr_pages;
 				list_move_tail(&folio->lru, &ret_folios);
 				break;
 			case -ENOMEM:
@@ -1523,11 +1751,11 @@ split_folio_migration:
 				 * other folios, just exit.
 				 */
 				if (is_large) {
-					nr_large_failed++;
-					nr_thp_failed += is_thp;
+					stats.nr_large_failed++;
+					stats.nr_thp_failed += is_thp;
 					/* Large folio NUMA faulting doesn't split to retry. */
 					if (!nosplit) {
-						int ret = try_split_folio(folio, &split_folios);
+						int ret = try_split_folio(folio, &split_folios, mode);
 
 						if (!ret) {
 							nr_thp_split += is_thp;
@@ -1538,17 +1766,26 @@ split_folio_migration:
 							 * Try again to split large folio to
 							 * mitigate the failure of longterm pinning.
 							 */
-							large_retry++;
-							thp_retry += is_thp;
-							nr_retry_pages += nr_pages;
+							stats.large_retry++;
+							stats.thp_retry += is_thp;
+							stats.nr_retry_pages += nr_pages;
 							break;
 						}
 					}
 				} else if (!no_split_folio_counting) {
-					nr_failed++;
+					stats.nr_failed++;
 				}
 
-				nr_failed_pages += nr_pages + nr_retry_pages;
+				/* Finish the folios already unmapped. */
+				if (nr_unmap_pages)
+					migrate_folios_move_batch(&unmap_folios,
+						&dst_folios, put_new_page,
+						private, mode, reason,
+						&retry_folios, &ret_folios,
+						no_split_folio_counting,
+						&stats);
+				list_splice_init(&retry_folios, from);
+				stats.nr_failed_pages += nr_pages + stats.nr_retry_pages;
 				/*
 				 * There might be some split folios of fail-to-migrate large
 				 * folios left in split_folios list. Move them back to migration
@@ -1557,21 +1794,21 @@ split_folio_migration:
 				 */
 				list_splice_init(&split_folios, from);
 				/* nr_failed isn't updated for not used */
-				nr_large_failed += large_retry;
-				nr_thp_failed += thp_retry;
+				stats.nr_large_failed += stats.large_retry;
+				stats.nr_thp_failed += stats.thp_retry;
 				goto out;
 			case -EAGAIN:
 				if (is_large) {
-					large_retry++;
-					thp_retry += is_thp;
+					stats.large_retry++;
+					stats.thp_retry += is_thp;
 				} else if (!no_split_folio_counting) {
-					retry++;
+					stats.retry++;
 				}
-				nr_retry_pages += nr_pages;
+				stats.nr_retry_pages += nr_pages;
 				break;
 			case MIGRATEPAGE_SUCCESS:
-				nr_succeeded += nr_pages;
-				nr_thp_succeeded += is_thp;
+				stats.nr_succeeded += nr_pages;
+				stats.nr_thp_succeeded += is_thp;
 				break;
 			default:
 				/*
@@ -1581,21 +1818,31 @@ split_folio_migration:
 				 * retried in the next outer loop.
 				 */
 				if (is_large) {
-					nr_large_failed++;
-					nr_thp_failed += is_thp;
+					stats.nr_large_failed++;
+					stats.nr_thp_failed += is_thp;
 				} else if (!no_split_folio_counting) {
-					nr_failed++;
+					stats.nr_failed++;
 				}
 
-				nr_failed_pages += nr_pages;
+				stats.nr_failed_pages += nr_pages;
 				break;
 			}
 		}
+
+		if (nr_unmap_pages) {
+			migrate_folios_move_batch(&unmap_folios, &dst_folios,
+					put_new_page, private, mode, reason,
+					&retry_folios, &ret_folios,
+					no_split_folio_counting, &stats);
+			nr_unmap_pages = 0;
+		}
+		/* Retry the folios that failed to move in the next pass. */
+		list_splice_tail_init(&retry_folios, from);
 	}
-	nr_failed += retry;
-	nr_large_failed += large_retry;
-	nr_thp_failed += thp_retry;
-	nr_failed_pages += nr_retry_pages;
+	stats.nr_failed += stats.retry;
+	stats.nr_large_failed += stats.large_retry;
+	stats.nr_thp_failed += stats.thp_retry;
+	stats.nr_failed_pages += stats.nr_retry_pages;
 	/*
 	 * Try to migrate split folios of fail-to-migrate large folios, no
 	 * nr_failed counting in this round, since all split folios of a
@@ -1609,11 +1856,11 @@ split_folio_migration:
 		list_splice_init(from, &ret_folios);
 		list_splice_init(&split_folios, from);
 		no_split_folio_counting = true;
-		retry = 1;
+		stats.retry = 1;
 		goto split_folio_migration;
 	}
 
-	rc = nr_failed + nr_large_failed;
+	rc = stats.nr_failed + stats.nr_large_failed;
 out:
 	/*
 	 * Put the permanent failure folio back to migration list, they
@@ -1628,16 +1875,16 @@ out:
 	if (list_empty(from))
 		rc = 0;
 
-	count_vm_events(PGMIGRATE_SUCCESS, nr_succeeded);
-	count_vm_events(PGMIGRATE_FAIL, nr_failed_pages);
-	count_vm_events(THP_MIGRATION_SUCCESS, nr_thp_succeeded);
-	count_vm_events(THP_MIGRATION_FAIL, nr_thp_failed);
+	count_vm_events(PGMIGRATE_SUCCESS, stats.nr_succeeded);
+	count_vm_events(PGMIGRATE_FAIL, stats.nr_failed_pages);
+	count_vm_events(THP_MIGRATION_SUCCESS, stats.nr_thp_succeeded);
+	count_vm_events(THP_MIGRATION_FAIL, stats.nr_thp_failed);
 	count_vm_events(THP_MIGRATION_SPLIT, nr_thp_split);
-	trace_mm_migrate_pages(nr_succeeded, nr_failed_pages, nr_thp_succeeded,
-			       nr_thp_failed, nr_thp_split, mode, reason);
+	trace_mm_migrate_pages(stats.nr_succeeded, stats.nr_failed_pages, stats.nr_thp_succeeded,
+			       stats.nr_thp_failed, nr_thp_split, mode, reason);
 
 	if (ret_succeeded)
-		*ret_succeeded = nr_succeeded;
+		*ret_succeeded = stats.nr_succeeded;
 
 	return rc;
 }
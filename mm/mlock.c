@@ -454,6 +454,7 @@ success:
 	 * set VM_LOCKED, populate_vma_page_range will bring it back.
 	 */
 
+	vma_start_write(vma);
 	if ((newflags & VM_LOCKED) && (oldflags & VM_LOCKED)) {
 		/* No work to do, and mlocking twice would be wrong */
 		vma->vm_flags = newflags;
@@ -520,8 +520,10 @@ inline int vma_expand(struct ma_state *mas, struct vm_area_struct *vma,
 	struct file *file = vma->vm_file;
 	bool remove_next = false;
 
+	vma_start_write(vma);
 	if (next && (vma != next) && (end == next->vm_end)) {
 		remove_next = true;
+		vma_start_write(next);
 		if (next->anon_vma && !vma->anon_vma) {
 			int error;
 
@@ -587,6 +589,7 @@ inline int vma_expand(struct ma_state *mas, struct vm_area_struct *vma,
 	}
 
 	if (remove_next) {
+		vma_mark_detached(next, true);
 		if (file) {
 			uprobe_munmap(next, next->vm_start, next->vm_end);
 			fput(file);
@@ -630,6 +633,12 @@ int __vma_adjust(struct vm_area_struct *vma, unsigned long start,
 	MA_STATE(mas, &mm->mm_mt, 0, 0);
 	struct vm_area_struct *exporter = NULL, *importer = NULL;
 
+	vma_start_write(vma);
+	if (next)
+		vma_start_write(next);
+	if (insert)
+		vma_start_write(insert);
+
 	if (next && !insert) {
 		if (end >= next->vm_end) {
 			/*
@@ -659,8 +668,11 @@ int __vma_adjust(struct vm_area_struct *vma, unsigned long start,
 				 * remove_next == 1 is case 1 or 7.
 				 */
 				remove_next = 1 + (end > next->vm_end);
-				if (remove_next == 2)
+				if (remove_next == 2) {
 					next_next = find_vma(mm, next->vm_end);
+					if (next_next)
+						vma_start_write(next_next);
+				}
 
 				VM_WARN_ON(remove_next == 2 &&
 					   end != next_next->vm_end);
@@ -828,6 +840,7 @@ int __vma_adjust(struct vm_area_struct *vma, unsigned long start,
 
 	if (remove_next) {
 again:
+		vma_mark_detached(next, true);
 		if (file) {
 			uprobe_munmap(next, next->vm_start, next->vm_end);
 			fput(file);
@@ -1383,6 +1396,27 @@ unsigned long do_mmap(struct file *file, unsigned long addr,
 			pgoff = 0;
 			vm_flags |= VM_SHARED | VM_MAYSHARE;
 			break;
+		case MAP_DROPPABLE:
+			if (VM_DROPPABLE == VM_NONE)
+				return -EOPNOTSUPP;
+			/*
+			 * A locked or stack area makes no sense to be droppable,
+			 * and don't attempt to combine with hugetlb for now.
+			 */
+			if (flags & (MAP_LOCKED | MAP_HUGETLB))
+				return -EINVAL;
+			if (vm_flags & (VM_GROWSDOWN | VM_GROWSUP))
+				return -EINVAL;
+
+			/*
+			 * The pages are not dropped under memory pressure yet,
+			 * but users like the vDSO getrandom() states rely on
+			 * the memory neither being reserved nor surviving forks
+			 * or coredumps.
+			 */
+			vm_flags |= VM_DROPPABLE | VM_NORESERVE | VM_WIPEONFORK |
+				    VM_DONTDUMP;
+			fallthrough;
 		case MAP_PRIVATE:
 			/*
 			 * Set pgoff according to addr for anon_vma.
@@ -2221,7 +2255,7 @@ static void unmap_region(struct mm_struct *mm, struct maple_tree *mt,
 	struct mmu_gather tlb;
 
 	lru_add_drain();
-	tlb_gather_mmu(&tlb, mm);
+	tlb_gather_mmu_async(&tlb, mm, end - start);
 	update_hiwater_rss(mm);
 	unmap_vmas(&tlb, mt, vma, start, end);
 	free_pgtables(&tlb, mt, vma, prev ? prev->vm_end : FIRST_USER_ADDRESS,
@@ -2314,10 +2348,13 @@ int split_vma(struct mm_struct *mm, struct vm_area_struct *vma,
 static inline int munmap_sidetree(struct vm_area_struct *vma,
 				   struct ma_state *mas_detach)
 {
+	vma_start_write(vma);
 	mas_set_range(mas_detach, vma->vm_start, vma->vm_end - 1);
 	if (mas_store_gfp(mas_detach, vma, GFP_KERNEL))
 		return -ENOMEM;
 
+	vma_mark_detached(vma, true);
+
 	if (vma->vm_flags & VM_LOCKED)
 		vma->vm_mm->locked_vm -= vma_pages(vma);
 
@@ -2492,6 +2529,10 @@ do_mas_align_munmap(struct ma_state *mas, struct vm_area_struct *vma,
 userfaultfd_error:
 munmap_sidetree_failed:
 end_split_failed:
+	/* The vmas stay in the tree, let lock_vma_under_rcu() find them again */
+	mas_set(&mas_detach, 0);
+	mas_for_each(&mas_detach, next, ULONG_MAX)
+		vma_mark_detached(next, false);
 	__mt_destroy(&mt_detach);
 start_split_failed:
 map_count_exceeded:
@@ -2994,6 +3035,7 @@ static int do_brk_flags(struct ma_state *mas, struct vm_area_struct *vma,
 		if (mas_preallocate(mas, vma, GFP_KERNEL))
 			goto unacct_fail;
 
+		vma_start_write(vma);
 		vma_adjust_trans_huge(vma, vma->vm_start, addr + len, 0);
 		if (vma->anon_vma) {
 			anon_vma_lock_write(vma->anon_vma);
@@ -3257,6 +3299,8 @@ struct vm_area_struct *copy_vma(struct vm_area_struct **vmap,
 		new_vma = vm_area_dup(vma);
 		if (!new_vma)
 			goto out;
+		/* Page tables are about to be moved in, keep faults out */
+		vma_start_write(new_vma);
 		new_vma->vm_start = addr;
 		new_vma->vm_end = addr + len;
 		new_vma->vm_pgoff = pgoff;
@@ -3587,6 +3631,7 @@ int mm_take_all_locks(struct mm_struct *mm)
 	mas_for_each(&mas, vma, ULONG_MAX) {
 		if (signal_pending(current))
 			goto out_unlock;
+		vma_start_write(vma);
 		if (vma->vm_file && vma->vm_file->f_mapping &&
 				is_vm_hugetlb_page(vma))
 			vm_lock_mapping(mm, vma->vm_file->f_mapping);
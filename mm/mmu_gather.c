@@ -9,6 +9,9 @@
 #include <linux/smp.h>
 #include <linux/swap.h>
 #include <linux/rmap.h>
+#include <linux/llist.h>
+#include <linux/sysctl.h>
+#include <linux/workqueue.h>
 
 #include <asm/pgalloc.h>
 #include <asm/tlb.h>
@@ -81,26 +84,92 @@ void tlb_flush_rmaps(struct mmu_gather *tlb, struct vm_area_struct *vma)
 }
 #endif
 
-static void tlb_batch_pages_flush(struct mmu_gather *tlb)
+static void tlb_batch_free_pages(struct mmu_gather_batch *batch)
 {
-	struct mmu_gather_batch *batch;
+	struct encoded_page **pages = batch->encoded_pages;
+
+	do {
+		/*
+		 * limit free batch count when PAGE_SIZE > 4K
+		 */
+		unsigned int nr = min(512U, batch->nr);
+
+		free_pages_and_swap_cache(pages, nr);
+		pages += nr;
+		batch->nr -= nr;
+
+		cond_resched();
+	} while (batch->nr);
+}
+
+/*
+ * Tearing down a very large address space spends most of its time freeing
+ * the pages it gathered, which stalls whoever is waiting for the exit (the
+ * parent, the OOM killer, munmap callers). With vm.mmu_gather_async_free set,
+ * exit_mmap() and large munmap()s hand their full batches to a per-node
+ * worker instead. The TLB has already been flushed when the batches are
+ * handed over, the worker only drops the last references to the pages, so
+ * memcg charges and zone free counts go down once the pages really are free.
+ */
+#define TLB_ASYNC_FREE_MIN_SIZE		SZ_1G
+
+struct tlb_async_free {
+	struct llist_head batches;
+	struct work_struct work;
+};
+
+static int sysctl_mmu_gather_async_free __read_mostly;
+static struct tlb_async_free tlb_async_free_nodes[MAX_NUMNODES];
 
-	for (batch = &tlb->local; batch && batch->nr; batch = batch->next) {
-		struct encoded_page **pages = batch->encoded_pages;
+static void tlb_async_free_work(struct work_struct *work)
+{
+	struct tlb_async_free *af = container_of(work, struct tlb_async_free,
+						 work);
+	struct mmu_gather_batch *batch, *next;
+	struct llist_node *head;
 
-		do {
-			/*
-			 * limit free batch count when PAGE_SIZE > 4K
-			 */
-			unsigned int nr = min(512U, batch->nr);
+	head = llist_del_all(&af->batches);
+	llist_for_each_entry_safe(batch, next, head, async_node) {
+		tlb_batch_free_pages(batch);
+		free_pages((unsigned long)batch, 0);
+	}
+}
 
-			free_pages_and_swap_cache(pages, nr);
-			pages += nr;
-			batch->nr -= nr;
+/*
+ * Hand the separately allocated batches over to the node that owns their
+ * first page. The on-stack local batch is always freed inline.
+ */
+static void tlb_batch_pages_defer(struct mmu_gather *tlb)
+{
+	struct mmu_gather_batch *batch, *next;
 
-			cond_resched();
-		} while (batch->nr);
+	for (batch = tlb->local.next; batch; batch = next) {
+		next = batch->next;
+		if (batch->nr) {
+			struct page *page = encoded_page_ptr(batch->encoded_pages[0]);
+			struct tlb_async_free *af;
+			int nid = page_to_nid(page);
+
+			af = &tlb_async_free_nodes[nid];
+			if (llist_add(&batch->async_node, &af->batches))
+				queue_work_node(nid, system_unbound_wq, &af->work);
+		} else {
+			free_pages((unsigned long)batch, 0);
+		}
 	}
+	tlb->local.next = NULL;
+	tlb->batch_count = 0;
+}
+
+static void tlb_batch_pages_flush(struct mmu_gather *tlb)
+{
+	struct mmu_gather_batch *batch;
+
+	if (tlb->async_free)
+		tlb_batch_pages_defer(tlb);
+
+	for (batch = &tlb->local; batch && batch->nr; batch = batch->next)
+		tlb_batch_free_pages(batch);
 	tlb->active = &tlb->local;
 }
 
@@ -312,6 +381,7 @@ static void __tlb_gather_mmu(struct mmu_gather *tlb, struct mm_struct *mm,
 	tlb->local.max  = ARRAY_SIZE(tlb->__pages);
 	tlb->active     = &tlb->local;
 	tlb->batch_count = 0;
+	tlb->async_free = fullmm && READ_ONCE(sysctl_mmu_gather_async_free);
 #endif
 	tlb->delayed_rmap = 0;
 
@@ -353,6 +423,25 @@ void tlb_gather_mmu_fullmm(struct mmu_gather *tlb, struct mm_struct *mm)
 	__tlb_gather_mmu(tlb, mm, true);
 }
 
+/**
+ * tlb_gather_mmu_async - initialize an mmu_gather structure for a large tear-down
+ * @tlb: the mmu_gather structure to initialize
+ * @mm: the mm_struct of the target address space
+ * @size: the size of the range about to be unmapped
+ *
+ * Like tlb_gather_mmu(), but the gathered pages may be freed asynchronously
+ * if @size is large enough and vm.mmu_gather_async_free is enabled.
+ */
+void tlb_gather_mmu_async(struct mmu_gather *tlb, struct mm_struct *mm,
+			  unsigned long size)
+{
+	__tlb_gather_mmu(tlb, mm, false);
+#ifndef CONFIG_MMU_GATHER_NO_GATHER
+	tlb->async_free = size >= TLB_ASYNC_FREE_MIN_SIZE &&
+			  READ_ONCE(sysctl_mmu_gather_async_free);
+#endif
+}
+
 /**
  * tlb_finish_mmu - finish an mmu_gather structure
  * @tlb: the mmu_gather structure to finish
@@ -395,3 +484,31 @@ void tlb_finish_mmu(struct mmu_gather *tlb)
 #endif
 	dec_tlb_flush_pending(tlb->mm);
 }
+
+#ifndef CONFIG_MMU_GATHER_NO_GATHER
+static struct ctl_table mmu_gather_sysctls[] = {
+	{
+		.procname	= "mmu_gather_async_free",
+		.data		= &sysctl_mmu_gather_async_free,
+		.maxlen		= sizeof(sysctl_mmu_gather_async_free),
+		.mode		= 0644,
+		.proc_handler	= proc_dointvec_minmax,
+		.extra1		= SYSCTL_ZERO,
+		.extra2		= SYSCTL_ONE,
+	},
+	{}
+};
+
+static int __init tlb_async_free_init(void)
+{
+	int nid;
+
+	for (nid = 0; nid < MAX_NUMNODES; nid++) {
+		init_llist_head(&tlb_async_free_nodes[nid].batches);
+		INIT_WORK(&tlb_async_free_nodes[nid].work, tlb_async_free_work);
+	}
+	register_sysctl_init("vm", mmu_gather_sysctls);
+	return 0;
+}
+subsys_initcall(tlb_async_free_init);
+#endif /* CONFIG_MMU_GATHER_NO_GATHER */
@@ -810,6 +810,28 @@ int bdi_set_strict_limit(struct backing_dev_info *bdi, unsigned int strict_limit
 	return 0;
 }
 
+unsigned int bdi_get_max_pause_ms(struct backing_dev_info *bdi)
+{
+	return jiffies_to_msecs(READ_ONCE(bdi->max_pause) ?: MAX_PAUSE);
+}
+
+/*
+ * Devices which write back much faster than the dirty throttling control
+ * can settle may be given a lower pause limit, so that dirtiers poll more
+ * often instead of sleeping for up to MAX_PAUSE in one go. 0 restores the
+ * default.
+ */
+int bdi_set_max_pause_ms(struct backing_dev_info *bdi, unsigned int msecs)
+{
+	unsigned long pause = msecs_to_jiffies(msecs);
+
+	if (pause > MAX_PAUSE)
+		return -EINVAL;
+
+	WRITE_ONCE(bdi->max_pause, msecs ? max(pause, 1UL) : 0);
+	return 0;
+}
+
 static unsigned long dirty_freerun_ceiling(unsigned long thresh,
 					   unsigned long bg_thresh)
 {
@@ -1528,6 +1550,7 @@ static unsigned long wb_max_pause(struct bdi_writeback *wb,
 				  unsigned long wb_dirty)
 {
 	unsigned long bw = READ_ONCE(wb->avg_write_bandwidth);
+	unsigned long limit = READ_ONCE(wb->bdi->max_pause) ?: MAX_PAUSE;
 	unsigned long t;
 
 	/*
@@ -1540,7 +1563,7 @@ static unsigned long wb_max_pause(struct bdi_writeback *wb,
 	t = wb_dirty / (1 + bw / roundup_pow_of_two(1 + HZ / 8));
 	t++;
 
-	return min_t(unsigned long, t, MAX_PAUSE);
+	return min_t(unsigned long, t, limit);
 }
 
 static long wb_min_pause(struct bdi_writeback *wb,
@@ -278,9 +278,17 @@ early_param("init_on_free", early_init_on_free);
  * index, e.g. page might have MIGRATE_CMA set but be on a pcplist with any
  * other index - this ensures that it will be put on the correct CMA freelist.
  */
+/*
+ * Set on top of the cached migratetype when the page was carved out of a free
+ * page that was zeroed in the background. The flag travels with the page over
+ * the pcplists and is consumed when the page is handed out, freeing the page
+ * back clears it by setting the migratetype again.
+ */
+#define PCPPAGE_PREZEROED	0x100UL
+
 static inline int get_pcppage_migratetype(struct page *page)
 {
-	return page->index;
+	return page->index & ~PCPPAGE_PREZEROED;
 }
 
 static inline void set_pcppage_migratetype(struct page *page, int migratetype)
@@ -288,6 +296,24 @@ static inline void set_pcppage_migratetype(struct page *page, int migratetype)
 	page->index = migratetype;
 }
 
+/*
+ * Returns the gfp mask to prepare a page fresh from the free lists with,
+ * i.e. without __GFP_ZERO if the page is known to be zero already.
+ */
+static inline gfp_t pcppage_prezeroed_gfp(struct page *page, gfp_t gfp_flags)
+{
+	if (!IS_ENABLED(CONFIG_PAGE_PREZERO) ||
+	    !(page->index & PCPPAGE_PREZEROED))
+		return gfp_flags;
+
+	page->index &= ~PCPPAGE_PREZEROED;
+	if (!(gfp_flags & __GFP_ZERO))
+		return gfp_flags;
+
+	count_vm_event(PGPREZERO_HIT);
+	return gfp_flags & ~__GFP_ZERO;
+}
+
 #ifdef CONFIG_PM_SLEEP
 /*
  * The following functions are used by the suspend/hibernate code to temporarily
@@ -1041,6 +1067,8 @@ static inline void del_page_from_free_list(struct page *page, struct zone *zone,
 	/* clear reported state and update reported page count */
 	if (page_reported(page))
 		__ClearPageReported(page);
+	if (IS_ENABLED(CONFIG_PAGE_PREZERO))
+		__ClearPageZeroed(page);
 
 	list_del(&page->buddy_list);
 	__ClearPageBuddy(page);
@@ -1808,6 +1836,70 @@ static void __free_unaccepted(struct page *page, unsigned int order)
 		static_branch_inc(&unaccepted_pages);
 }
 
+/*
+ * Accept the remaining memory of each node in the background, at the lowest
+ * priority, so that allocations rarely have to wait for acceptance.  Memory
+ * is still accepted on demand meanwhile.  "accept_memory=lazy" leaves it all
+ * to the allocations.
+ */
+static bool accept_memory_background __initdata = true;
+
+static int __init accept_memory_setup(char *str)
+{
+	if (!str)
+		return -EINVAL;
+
+	if (!strcmp(str, "lazy"))
+		accept_memory_background = false;
+	else if (!strcmp(str, "background"))
+		accept_memory_background = true;
+	else
+		return -EINVAL;
+
+	return 0;
+}
+early_param("accept_memory", accept_memory_setup);
+
+static int accept_memory_thread(void *data)
+{
+	pg_data_t *pgdat = data;
+	const struct cpumask *cpumask = cpumask_of_node(pgdat->node_id);
+	int i;
+
+	if (!cpumask_empty(cpumask))
+		set_cpus_allowed_ptr(current, cpumask);
+	set_user_nice(current, MAX_NICE);
+
+	for (i = 0; i < MAX_NR_ZONES; i++) {
+		struct zone *zone = &pgdat->node_zones[i];
+
+		while (try_to_accept_memory(zone))
+			cond_resched();
+	}
+
+	return 0;
+}
+
+static int __init accept_memory_init(void)
+{
+	struct task_struct *t;
+	int nid;
+
+	if (!accept_memory_background ||
+	    !static_branch_unlikely(&unaccepted_pages))
+		return 0;
+
+	for_each_node_state(nid, N_MEMORY) {
+		t = kthread_run(accept_memory_thread, NODE_DATA(nid),
+				"kaccept%d", nid);
+		if (IS_ERR(t))
+			pr_warn("Failed to start kaccept%d\n", nid);
+	}
+
+	return 0;
+}
+late_initcall(accept_memory_init);
+
 #else
 
 static bool try_to_accept_memory(struct zone *zone)
@@ -2449,7 +2541,7 @@ void __init init_cma_reserved_pageblock(struct page *page)
  * -- nyc
  */
 static inline void expand(struct zone *zone, struct page *page,
-	int low, int high, int migratetype)
+	int low, int high, int migratetype, bool zeroed)
 {
 	unsigned long size = 1 << high;
 
@@ -2469,6 +2561,9 @@ static inline void expand(struct zone *zone, struct page *page,
 
 		add_to_free_list(&page[size], zone, high, migratetype);
 		set_buddy_order(&page[size], high);
+		/* The halves of a zeroed page are zeroed as well */
+		if (zeroed)
+			__SetPageZeroed(&page[size]);
 	}
 }
 
@@ -2668,6 +2763,7 @@ struct page *__rmqueue_smallest(struct zone *zone, unsigned int order,
 	unsigned int current_order;
 	struct free_area *area;
 	struct page *page;
+	bool zeroed;
 
 	/* Find a page of the appropriate size in the preferred list */
 	for (current_order = order; current_order < MAX_ORDER; ++current_order) {
@@ -2675,9 +2771,12 @@ struct page *__rmqueue_smallest(struct zone *zone, unsigned int order,
 		page = get_page_from_free_area(area, migratetype);
 		if (!page)
 			continue;
+		zeroed = IS_ENABLED(CONFIG_PAGE_PREZERO) && PageZeroed(page);
 		del_page_from_free_list(page, zone, current_order);
-		expand(zone, page, order, current_order, migratetype);
+		expand(zone, page, order, current_order, migratetype, zeroed);
 		set_pcppage_migratetype(page, migratetype);
+		if (zeroed)
+			page->index |= PCPPAGE_PREZEROED;
 		trace_mm_page_alloc_zone_locked(page, order, migratetype,
 				pcp_allowed_order(order) &&
 				migratetype < MIGRATE_PCPTYPES);
@@ -3290,6 +3389,44 @@ void drain_zone_pages(struct zone *zone, struct per_cpu_pages *pcp)
 }
 #endif
 
+/*
+ * Called from the vmstat counter updater to decay pcp->high of this
+ * currently executing processor back towards pcp->high_min once the burst
+ * of allocations or frees that raised it is over, and to free the pages
+ * that are now above the lowered high. Returns non-zero while there is
+ * still work left for later updates.
+ */
+int decay_pcp_high(struct zone *zone, struct per_cpu_pages *pcp)
+{
+	int high_min, to_drain, batch;
+	int todo = 0;
+
+	high_min = READ_ONCE(pcp->high_min);
+	batch = READ_ONCE(pcp->batch);
+
+	spin_lock(&pcp->lock);
+	/*
+	 * Decrease high by 1/8th per update, but never drop it more than a
+	 * few batches below count so a single update does not hold the zone
+	 * lock for long.
+	 */
+	if (pcp->high > high_min) {
+		pcp->high = max3(pcp->count - (batch << 3),
+				 pcp->high - (pcp->high >> 3), high_min);
+		if (pcp->high > high_min)
+			todo++;
+	}
+
+	to_drain = pcp->count - pcp->high;
+	if (to_drain > 0) {
+		free_pcppages_bulk(zone, to_drain, pcp, 0);
+		todo++;
+	}
+	spin_unlock(&pcp->lock);
+
+	return todo;
+}
+
 /*
  * Drain pcplists of the indicated processor and zone.
  */
@@ -3515,29 +3652,54 @@ static int nr_pcp_free(struct per_cpu_pages *pcp, int high, int batch,
 	return batch;
 }
 
+/*
+ * pcp->high is tuned between pcp->high_min and pcp->high_max at runtime.
+ * Clamp it first as pageset_update() may have moved the bounds under us.
+ */
+static int pcp_high_clamp(struct per_cpu_pages *pcp)
+{
+	int high_min = READ_ONCE(pcp->high_min);
+	int high_max = READ_ONCE(pcp->high_max);
+
+	pcp->high = clamp(pcp->high, high_min, max(high_min, high_max));
+	return pcp->high;
+}
+
 static int nr_pcp_high(struct per_cpu_pages *pcp, struct zone *zone,
-		       bool free_high)
+		       int batch, bool free_high)
 {
-	int high = READ_ONCE(pcp->high);
+	int high = pcp_high_clamp(pcp);
 
 	if (unlikely(!high || free_high))
 		return 0;
 
-	if (!test_bit(ZONE_RECLAIM_ACTIVE, &zone->flags))
-		return high;
+	if (test_bit(ZONE_RECLAIM_ACTIVE, &zone->flags)) {
+		/*
+		 * If reclaim is active, limit the number of pages that can be
+		 * stored on pcp lists and stop growing high.
+		 */
+		pcp->high = max(high - batch, READ_ONCE(pcp->high_min));
+		return min(batch << 2, pcp->high);
+	}
 
 	/*
-	 * If reclaim is active, limit the number of pages that can be
-	 * stored on pcp lists
+	 * Pages are being freed without any allocation in between, e.g.
+	 * during mass process exit or page cache truncation. Raise high so
+	 * that the lists absorb more of the burst and each trip to the zone
+	 * lock in nr_pcp_free() returns a larger batch to the buddy.
 	 */
-	return min(READ_ONCE(pcp->batch) << 2, high);
+	if (pcp->free_factor && pcp->count >= high &&
+	    high < READ_ONCE(pcp->high_max))
+		pcp->high = min(high + batch, READ_ONCE(pcp->high_max));
+
+	return pcp->high;
 }
 
 static void free_unref_page_commit(struct zone *zone, struct per_cpu_pages *pcp,
 				   struct page *page, int migratetype,
 				   unsigned int order)
 {
-	int high;
+	int high, batch;
 	int pindex;
 	bool free_high;
 
@@ -3554,12 +3716,10 @@ static void free_unref_page_commit(struct zone *zone, struct per_cpu_pages *pcp,
 	 */
 	free_high = (pcp->free_factor && order && order <= PAGE_ALLOC_COSTLY_ORDER);
 
-	high = nr_pcp_high(pcp, zone, free_high);
-	if (pcp->count >= high) {
-		int batch = READ_ONCE(pcp->batch);
-
+	batch = READ_ONCE(pcp->batch);
+	high = nr_pcp_high(pcp, zone, batch, free_high);
+	if (pcp->count >= high)
 		free_pcppages_bulk(zone, nr_pcp_free(pcp, high, batch, free_high), pcp, pindex);
-	}
 }
 
 /*
@@ -3775,6 +3935,30 @@ void __putback_isolated_page(struct page *page, unsigned int order, int mt)
 			FPI_SKIP_REPORT_NOTIFY | FPI_TO_TAIL);
 }
 
+#ifdef CONFIG_PAGE_PREZERO
+/**
+ * putback_zeroed_page - Return a zeroed isolated page back into the allocator
+ * @page: Page that was isolated and zeroed
+ * @order: Order of the isolated page
+ * @mt: The page's pageblock's migratetype
+ *
+ * Like __putback_isolated_page(), but puts the page at the head of the
+ * freelist so that it is handed out first, and marks it as zeroed unless it
+ * got merged with a buddy that isn't.
+ */
+void putback_zeroed_page(struct page *page, unsigned int order, int mt)
+{
+	struct zone *zone = page_zone(page);
+
+	lockdep_assert_held(&zone->lock);
+
+	__free_one_page(page, page_to_pfn(page), zone, order, mt,
+			FPI_SKIP_REPORT_NOTIFY);
+	if (PageBuddy(page) && buddy_order(page) == order)
+		__SetPageZeroed(page);
+}
+#endif
+
 /*
  * Update NUMA hit/miss statistics
  */
@@ -3869,6 +4053,17 @@ struct page *__rmqueue_pcplist(struct zone *zone, unsigned int order,
 			pcp->count += alloced << order;
 			if (unlikely(list_empty(list)))
 				return NULL;
+
+			/*
+			 * The lists keep running dry, so let them hold more
+			 * pages before frees are returned to the buddy.
+			 * decay_pcp_high() shrinks high again once the
+			 * allocation burst is over.
+			 */
+			if (!test_bit(ZONE_RECLAIM_ACTIVE, &zone->flags) &&
+			    pcp_high_clamp(pcp) < READ_ONCE(pcp->high_max))
+				pcp->high = min(pcp->high + READ_ONCE(pcp->batch),
+						READ_ONCE(pcp->high_max));
 		}
 
 		page = list_first_entry(list, struct page, pcp_list);
@@ -4395,7 +4590,9 @@ try_this_zone:
 		page = rmqueue(ac->preferred_zoneref->zone, zone, order,
 				gfp_mask, alloc_flags, ac->migratetype);
 		if (page) {
-			prep_new_page(page, order, gfp_mask, alloc_flags);
+			prep_new_page(page, order,
+				      pcppage_prezeroed_gfp(page, gfp_mask),
+				      alloc_flags);
 
 			/*
 			 * If this is a high-order atomic allocation then check
@@ -5591,7 +5788,7 @@ unsigned long __alloc_pages_bulk(gfp_t gfp, int preferred_nid,
 		}
 		nr_account++;
 
-		prep_new_page(page, 0, gfp, 0);
+		prep_new_page(page, 0, pcppage_prezeroed_gfp(page, gfp), 0);
 		if (page_list)
 			list_add(&page->lru, page_list);
 		else
@@ -7304,11 +7501,13 @@ static int zone_highsize(struct zone *zone, int batch, int cpu_online)
  * outside of boot time (or some other assurance that no concurrent updaters
  * exist).
  */
-static void pageset_update(struct per_cpu_pages *pcp, unsigned long high,
-		unsigned long batch)
+static void pageset_update(struct per_cpu_pages *pcp, unsigned long high_min,
+		unsigned long high_max, unsigned long batch)
 {
 	WRITE_ONCE(pcp->batch, batch);
-	WRITE_ONCE(pcp->high, high);
+	WRITE_ONCE(pcp->high_min, high_min);
+	WRITE_ONCE(pcp->high_max, high_max);
+	WRITE_ONCE(pcp->high, high_min);
 }
 
 static void per_cpu_pages_init(struct per_cpu_pages *pcp, struct per_cpu_zonestat *pzstats)
@@ -7329,6 +7528,8 @@ static void per_cpu_pages_init(struct per_cpu_pages *pcp, struct per_cpu_zonesta
 	 * pageset yet.
 	 */
 	pcp->high = BOOT_PAGESET_HIGH;
+	pcp->high_min = BOOT_PAGESET_HIGH;
+	pcp->high_max = BOOT_PAGESET_HIGH;
 	pcp->batch = BOOT_PAGESET_BATCH;
 	pcp->free_factor = 0;
 }
@@ -7337,11 +7538,20 @@ static void __zone_set_pageset_high_and_batch(struct zone *zone, unsigned long h
 		unsigned long batch)
 {
 	struct per_cpu_pages *pcp;
+	unsigned long high_max;
 	int cpu;
 
+	/*
+	 * high is where pcp->high rests when the CPU is quiet. Let it grow up
+	 * to twice that under allocation or free bursts to batch more work
+	 * per zone->lock acquisition. An explicitly configured
+	 * percpu_pagelist_high_fraction is honoured as a fixed value.
+	 */
+	high_max = percpu_pagelist_high_fraction ? high : high << 1;
+
 	for_each_possible_cpu(cpu) {
 		pcp = per_cpu_ptr(zone->per_cpu_pageset, cpu);
-		pageset_update(pcp, high, batch);
+		pageset_update(pcp, high, high_max, batch);
 	}
 }
 
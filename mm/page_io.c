@@ -30,25 +30,33 @@
 
 static void end_swap_bio_write(struct bio *bio)
 {
-	struct page *page = bio_first_page_all(bio);
+	struct folio_iter fi;
 
-	if (bio->bi_status) {
-		SetPageError(page);
-		/*
-		 * We failed to write the page out to swap-space.
-		 * Re-dirty the page in order to avoid it being reclaimed.
-		 * Also print a dire warning that things will go BAD (tm)
-		 * very quickly.
-		 *
-		 * Also clear PG_reclaim to avoid folio_rotate_reclaimable()
-		 */
-		set_page_dirty(page);
+	if (bio->bi_status)
 		pr_alert_ratelimited("Write-error on swap-device (%u:%u:%llu)\n",
 				     MAJOR(bio_dev(bio)), MINOR(bio_dev(bio)),
 				     (unsigned long long)bio->bi_iter.bi_sector);
-		ClearPageReclaim(page);
+
+	/* A batched write carries several swap cache folios */
+	bio_for_each_folio_all(fi, bio) {
+		struct folio *folio = fi.folio;
+
+		if (bio->bi_status) {
+			folio_set_error(folio);
+			/*
+			 * We failed to write the page out to swap-space.
+			 * Re-dirty the page in order to avoid it being
+			 * reclaimed. Also print a dire warning that things
+			 * will go BAD (tm) very quickly.
+			 *
+			 * Also clear PG_reclaim to avoid
+			 * folio_rotate_reclaimable()
+			 */
+			folio_mark_dirty(folio);
+			folio_clear_reclaim(folio);
+		}
+		folio_end_writeback(folio);
 	}
-	end_page_writeback(page);
 	bio_put(bio);
 }
 
@@ -241,6 +249,8 @@ struct swap_iocb {
 	struct bio_vec		bvec[SWAP_CLUSTER_MAX];
 	int			pages;
 	int			len;
+	/* Batched write to a block device, instead of iocb and bvec */
+	struct bio		*bio;
 };
 static mempool_t *sio_pool;
 
@@ -304,7 +314,7 @@ static int swap_writepage_fs(struct page *page, struct writeback_control *wbc)
 	if (wbc->swap_plug)
 		sio = *wbc->swap_plug;
 	if (sio) {
-		if (sio->iocb.ki_filp != swap_file ||
+		if (sio->bio || sio->iocb.ki_filp != swap_file ||
 		    sio->iocb.ki_pos + sio->len != pos) {
 			swap_write_unplug(sio);
 			sio = NULL;
@@ -317,6 +327,7 @@ static int swap_writepage_fs(struct page *page, struct writeback_control *wbc)
 		sio->iocb.ki_pos = pos;
 		sio->pages = 0;
 		sio->len = 0;
+		sio->bio = NULL;
 	}
 	sio->bvec[sio->pages].bv_page = page;
 	sio->bvec[sio->pages].bv_len = thp_size(page);
@@ -333,6 +344,67 @@ static int swap_writepage_fs(struct page *page, struct writeback_control *wbc)
 	return 0;
 }
 
+/*
+ * Reclaim writes out pages in the order they were added to the swap cache,
+ * which for a batch of pages is mostly in the order of their swap slots. Put
+ * pages that are contiguous on the device into one bio, so that the block
+ * layer deals with one request per batch rather than one per page.
+ */
+static bool swap_bio_can_append(struct bio *bio, struct page *page,
+				struct swap_info_struct *sis)
+{
+	if (bio->bi_bdev != sis->bdev ||
+	    bio_end_sector(bio) != swap_page_sector(page) ||
+	    bio_full(bio, thp_size(page)))
+		return false;
+
+	/* The bio is charged to the cgroup of its first page */
+	if (IS_ENABLED(CONFIG_BLK_CGROUP) &&
+	    page_memcg(page) != page_memcg(bio_first_page_all(bio)))
+		return false;
+
+	return true;
+}
+
+static void swap_writepage_bdev_plugged(struct page *page,
+					struct writeback_control *wbc,
+					struct swap_info_struct *sis)
+{
+	struct swap_iocb *sio = *wbc->swap_plug;
+	struct bio *bio;
+
+	if (sio && (!sio->bio || !swap_bio_can_append(sio->bio, page, sis))) {
+		swap_write_unplug(sio);
+		sio = NULL;
+	}
+	if (!sio) {
+		sio = mempool_alloc(sio_pool, GFP_NOIO);
+		/* Don't let a stale iocb match in swap_writepage_fs() */
+		sio->iocb.ki_filp = NULL;
+		sio->pages = 0;
+		sio->len = 0;
+		bio = bio_alloc(sis->bdev, SWAP_CLUSTER_MAX,
+				REQ_OP_WRITE | REQ_SWAP | wbc_to_write_flags(wbc),
+				GFP_NOIO);
+		bio->bi_iter.bi_sector = swap_page_sector(page);
+		bio->bi_end_io = end_swap_bio_write;
+		bio_associate_blkg_from_page(bio, page);
+		sio->bio = bio;
+	}
+
+	bio_add_page(sio->bio, page, thp_size(page), 0);
+	sio->pages++;
+	count_swpout_vm_event(page);
+	set_page_writeback(page);
+	unlock_page(page);
+
+	if (sio->pages == SWAP_CLUSTER_MAX) {
+		swap_write_unplug(sio);
+		sio = NULL;
+	}
+	*wbc->swap_plug = sio;
+}
+
 int __swap_writepage(struct page *page, struct writeback_control *wbc)
 {
 	struct bio *bio;
@@ -354,6 +426,11 @@ int __swap_writepage(struct page *page, struct writeback_control *wbc)
 		return 0;
 	}
 
+	if (wbc->swap_plug) {
+		swap_writepage_bdev_plugged(page, wbc, sis);
+		return 0;
+	}
+
 	bio = bio_alloc(sis->bdev, 1,
 			REQ_OP_WRITE | REQ_SWAP | wbc_to_write_flags(wbc),
 			GFP_NOIO);
@@ -373,9 +450,16 @@ int __swap_writepage(struct page *page, struct writeback_control *wbc)
 void swap_write_unplug(struct swap_iocb *sio)
 {
 	struct iov_iter from;
-	struct address_space *mapping = sio->iocb.ki_filp->f_mapping;
+	struct address_space *mapping;
 	int ret;
 
+	if (sio->bio) {
+		submit_bio(sio->bio);
+		mempool_free(sio, sio_pool);
+		return;
+	}
+
+	mapping = sio->iocb.ki_filp->f_mapping;
 	iov_iter_bvec(&from, ITER_SOURCE, sio->bvec, sio->pages, sio->len);
 	ret = mapping->a_ops->swap_rw(&sio->iocb, &from);
 	if (ret != -EIOCBQUEUED)
@@ -0,0 +1,193 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * Background zeroing of free pages
+ *
+ * Zeroing on demand puts a clear_page() of every page on the path of page
+ * faults and __GFP_ZERO allocations. When the system has idle time and free
+ * memory to spare, kprezerod takes high-order pages out of the buddy free
+ * lists, zeroes them and returns them marked PageZeroed(). The allocator
+ * carries that state over to the pages it carves out of them and skips
+ * zeroing those in prep_new_page().
+ *
+ * kprezerod runs as SCHED_IDLE so that it only ever uses otherwise idle CPU
+ * time, and only isolates pages while the zone is above its high watermark.
+ */
+#include <linux/mm.h>
+#include <linux/mmzone.h>
+#include <linux/highmem.h>
+#include <linux/kthread.h>
+#include <linux/freezer.h>
+#include <linux/sysctl.h>
+#include <linux/kasan.h>
+#include <linux/vmstat.h>
+#include <uapi/linux/sched/types.h>
+
+#include "internal.h"
+
+/* Smallest order worth zeroing; smaller pages are recycled too quickly */
+#define PREZERO_ORDER		pageblock_order
+
+/* High-order pages zeroed per zone per pass */
+#define PREZERO_BATCH		64
+
+/* Free list entries looked at per isolation attempt */
+#define PREZERO_SCAN_MAX	32
+
+#define PREZERO_INTERVAL	(2 * HZ)
+
+static int sysctl_prezero_free_pages __read_mostly;
+static DECLARE_WAIT_QUEUE_HEAD(prezero_wait);
+
+static bool prezero_enabled(void)
+{
+	return READ_ONCE(sysctl_prezero_free_pages);
+}
+
+/*
+ * Take a free page of @order that isn't zeroed yet off the @mt free list of
+ * @zone. Zeroed pages are put back at the head of the lists, so look for the
+ * others from the tail.
+ */
+static struct page *prezero_isolate(struct zone *zone, unsigned int order,
+				    int mt)
+{
+	struct list_head *list = &zone->free_area[order].free_list[mt];
+	struct page *page, *found = NULL;
+	unsigned int scanned = 0;
+
+	spin_lock_irq(&zone->lock);
+
+	/* Leave the memory alone if the zone could use it */
+	if (!zone_watermark_ok(zone, 0, high_wmark_pages(zone) + (1UL << order),
+			       0, ALLOC_CMA))
+		goto out;
+
+	list_for_each_entry_reverse(page, list, buddy_list) {
+		if (++scanned > PREZERO_SCAN_MAX)
+			break;
+		if (PageZeroed(page))
+			continue;
+		if (__isolate_free_page(page, order))
+			found = page;
+		break;
+	}
+out:
+	spin_unlock_irq(&zone->lock);
+	return found;
+}
+
+static void prezero_clear(struct page *page, unsigned int order)
+{
+	unsigned long i;
+
+	for (i = 0; i < (1UL << order); i++) {
+		cond_resched();
+		clear_highpage(page + i);
+	}
+}
+
+static void prezero_zone(struct zone *zone)
+{
+	unsigned int budget = PREZERO_BATCH;
+	struct page *page;
+	int order, mt;
+
+	for (order = MAX_ORDER - 1; order >= PREZERO_ORDER; order--) {
+		for (mt = 0; mt < MIGRATE_PCPTYPES; mt++) {
+			while (budget) {
+				if (kthread_should_stop() || !prezero_enabled())
+					return;
+
+				page = prezero_isolate(zone, order, mt);
+				if (!page)
+					break;
+
+				prezero_clear(page, order);
+
+				spin_lock_irq(&zone->lock);
+				putback_zeroed_page(page, order,
+						    get_pageblock_migratetype(page));
+				spin_unlock_irq(&zone->lock);
+
+				count_vm_events(PGPREZERO, 1UL << order);
+				budget--;
+			}
+		}
+	}
+}
+
+static int prezero_thread(void *unused)
+{
+	struct sched_attr attr = { .sched_policy = SCHED_IDLE };
+	struct zone *zone;
+
+	sched_setattr_nocheck(current, &attr);
+	set_freezable();
+
+	while (!kthread_should_stop()) {
+		if (!prezero_enabled()) {
+			wait_event_freezable(prezero_wait, prezero_enabled() ||
+					     kthread_should_stop());
+			continue;
+		}
+
+		for_each_populated_zone(zone)
+			prezero_zone(zone);
+
+		wait_event_freezable_timeout(prezero_wait,
+					     kthread_should_stop(),
+					     PREZERO_INTERVAL);
+	}
+
+	return 0;
+}
+
+static int prezero_sysctl_handler(struct ctl_table *table, int write,
+				  void *buffer, size_t *lenp, loff_t *ppos)
+{
+	int ret;
+
+	ret = proc_dointvec_minmax(table, write, buffer, lenp, ppos);
+	if (!ret && write)
+		wake_up_interruptible(&prezero_wait);
+
+	return ret;
+}
+
+static struct ctl_table prezero_sysctls[] = {
+	{
+		.procname	= "prezero_free_pages",
+		.data		= &sysctl_prezero_free_pages,
+		.maxlen		= sizeof(sysctl_prezero_free_pages),
+		.mode		= 0644,
+		.proc_handler	= prezero_sysctl_handler,
+		.extra1		= SYSCTL_ZERO,
+		.extra2		= SYSCTL_ONE,
+	},
+	{ }
+};
+
+static int __init page_prezero_init(void)
+{
+	struct task_struct *thread;
+
+	/*
+	 * Pages are zeroed on free already, or on every allocation whatever
+	 * the gfp mask, or zeroing them requires them to be mapped, or the
+	 * allocator checks their contents.
+	 */
+	if (want_init_on_free() || want_init_on_alloc(0) ||
+	    debug_pagealloc_enabled() || page_poisoning_enabled() ||
+	    kasan_hw_tags_enabled())
+		return 0;
+
+	thread = kthread_run(prezero_thread, NULL, "kprezerod");
+	if (IS_ERR(thread)) {
+		pr_err("kprezerod: kthread_run failed\n");
+		return PTR_ERR(thread);
+	}
+
+	register_sysctl_init("vm", prezero_sysctls);
+	return 0;
+}
+late_initcall(page_prezero_init);
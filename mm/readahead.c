@@ -462,6 +462,57 @@ static int try_context_readahead(struct address_space *mapping,
 	return 1;
 }
 
+/*
+ * The readahead state also learns how the file is being accessed. Every
+ * readahead window the reader runs into in order makes the stream more
+ * trusted as sequential, and every standalone random read halves
+ * that trust. A trusted stream gets the largest folios the window allows
+ * straight away instead of ramping the order up window by window, and a
+ * sequential miss on it restarts with a full window.
+ *
+ * Sync misses that keep landing the same distance past the end of the
+ * previous read are a strided scan. Once the stride has been seen
+ * RA_STRIDE_HITS times in a row, the next record is read along with the
+ * current request.
+ */
+#define RA_SEQ_CONFIDENT	4
+#define RA_SEQ_CONFIDENCE_MAX	16
+#define RA_STRIDE_HITS		2
+
+static inline void ra_seq_hit(struct file_ra_state *ra)
+{
+	if (ra->seq_confidence < RA_SEQ_CONFIDENCE_MAX)
+		ra->seq_confidence++;
+	ra->stride_hits = 0;
+}
+
+static inline bool ra_seq_confident(struct file_ra_state *ra)
+{
+	return ra->seq_confidence >= RA_SEQ_CONFIDENT;
+}
+
+/*
+ * Track the gap between the previous read and this sync miss, return true
+ * once the same stride has been seen often enough to be worth prefetching.
+ */
+static bool ra_stride_miss(struct file_ra_state *ra, pgoff_t index,
+			   pgoff_t prev_index)
+{
+	long stride = (long)(index - prev_index);
+
+	ra->seq_confidence >>= 1;
+	if (stride == ra->stride) {
+		if (ra->stride_hits < RA_STRIDE_HITS)
+			ra->stride_hits++;
+	} else {
+		ra->stride = stride;
+		ra->stride_hits = 0;
+	}
+
+	/* Only forward strides that skip pages are worth reading ahead */
+	return stride > 1 && ra->stride_hits >= RA_STRIDE_HITS;
+}
+
 /*
  * There are some parts of the kernel which assume that PMD entries
  * are exactly HPAGE_PMD_ORDER.  Those should be fixed, but until then,
@@ -512,13 +563,14 @@ void page_cache_ra_order(struct readahead_control *ractl,
 
 	limit = min(limit, index + ra->size - 1);
 
-	if (new_order < MAX_PAGECACHE_ORDER) {
+	/* A stream known to be sequential needn't prove itself again */
+	if (ra_seq_confident(ra))
+		new_order = MAX_PAGECACHE_ORDER;
+	else if (new_order < MAX_PAGECACHE_ORDER)
 		new_order += 2;
-		if (new_order > MAX_PAGECACHE_ORDER)
-			new_order = MAX_PAGECACHE_ORDER;
-		while ((1 << new_order) > ra->size)
-			new_order--;
-	}
+	new_order = min_t(unsigned int, new_order, MAX_PAGECACHE_ORDER);
+	while ((1 << new_order) > ra->size)
+		new_order--;
 
 	filemap_invalidate_lock_shared(mapping);
 	while (index <= limit) {
@@ -594,6 +646,7 @@ static void ondemand_readahead(struct readahead_control *ractl,
 	expected = round_up(ra->start + ra->size - ra->async_size,
 			1UL << order);
 	if (index == expected || index == (ra->start + ra->size)) {
+		ra_seq_hit(ra);
 		ra->start += ra->size;
 		ra->size = get_next_ra_size(ra, max_pages);
 		ra->async_size = ra->size;
@@ -650,14 +703,23 @@ static void ondemand_readahead(struct readahead_control *ractl,
 
 	/*
 	 * standalone, small random read
-	 * Read as is, and do not pollute the readahead state.
+	 * Read as is, and do not pollute the readahead window. If the reads
+	 * are strided, read the next record too: it starts a stride past the
+	 * end of this one.
 	 */
+	if (ra_stride_miss(ra, index, prev_index)) {
+		do_page_cache_ra(ractl, req_size, 0);
+		ractl->_index = index + req_size + ra->stride;
+	}
 	do_page_cache_ra(ractl, req_size, 0);
 	return;
 
 initial_readahead:
 	ra->start = index;
-	ra->size = get_init_ra_size(req_size, max_pages);
+	if (ra_seq_confident(ra))
+		ra->size = max_pages;
+	else
+		ra->size = get_init_ra_size(req_size, max_pages);
 	ra->async_size = ra->size > req_size ? ra->size - req_size : ra->size;
 
 readit:
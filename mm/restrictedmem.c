@@ -1,4 +1,9 @@
 // SPDX-License-Identifier: GPL-2.0
+#include <linux/fs.h>
+#include <linux/kref.h>
+#include <linux/mempolicy.h>
+#include <linux/migrate.h>
+#include <linux/mount.h>
 #include <linux/namei.h>
 #include <linux/pagemap.h>
 #include <linux/pseudo_fs.h>
@@ -13,8 +18,19 @@ struct restrictedmem_data {
 	struct mutex lock;
 	struct file *memfd;
 	struct list_head notifiers;
+	/* Lets restrictedmem_migrate_folio() outlive the file. */
+	struct kref kref;
+	struct rcu_head rcu;
 };
 
+static void restrictedmem_data_free(struct kref *kref)
+{
+	struct restrictedmem_data *data = container_of(kref,
+					struct restrictedmem_data, kref);
+
+	kfree_rcu(data, rcu);
+}
+
 static void restrictedmem_invalidate_start(struct restrictedmem_data *data,
 					   pgoff_t start, pgoff_t end)
 {
@@ -55,8 +71,9 @@ static int restrictedmem_release(struct inode *inode, struct file *file)
 {
 	struct restrictedmem_data *data = inode->i_mapping->private_data;
 
+	WRITE_ONCE(data->memfd->f_mapping->private_data, NULL);
 	fput(data->memfd);
-	kfree(data);
+	kref_put(&data->kref, restrictedmem_data_free);
 	return 0;
 }
 
@@ -148,11 +165,39 @@ static struct file_system_type restrictedmem_fs = {
 
 static struct vfsmount *restrictedmem_mnt;
 
+/* Internal tmpfs mount with huge=always for RMFD_HUGEPAGE. */
+static struct vfsmount *restrictedmem_huge_mnt;
+
+static __init void restrictedmem_init_huge_mnt(void)
+{
+	struct file_system_type *type;
+	struct vfsmount *mnt;
+	char huge_opt[] = "huge=always";
+
+	if (!IS_ENABLED(CONFIG_TRANSPARENT_HUGEPAGE))
+		return;
+
+	type = get_fs_type("tmpfs");
+	if (!type)
+		return;
+
+	mnt = vfs_kern_mount(type, SB_KERNMOUNT, type->name, huge_opt);
+	put_filesystem(type);
+	if (IS_ERR(mnt)) {
+		pr_warn("restrictedmem: huge page mount failed: %ld\n",
+			PTR_ERR(mnt));
+		return;
+	}
+	restrictedmem_huge_mnt = mnt;
+}
+
 static __init int restrictedmem_init(void)
 {
 	restrictedmem_mnt = kern_mount(&restrictedmem_fs);
 	if (IS_ERR(restrictedmem_mnt))
 		return PTR_ERR(restrictedmem_mnt);
+
+	restrictedmem_init_huge_mnt();
 	return 0;
 }
 fs_initcall(restrictedmem_init);
@@ -171,6 +216,7 @@ static struct file *restrictedmem_file_create(struct file *memfd)
 	data->memfd = memfd;
 	mutex_init(&data->lock);
 	INIT_LIST_HEAD(&data->notifiers);
+	kref_init(&data->kref);
 
 	inode = alloc_anon_inode(restrictedmem_mnt->mnt_sb);
 	if (IS_ERR(inode)) {
@@ -194,22 +240,70 @@ static struct file *restrictedmem_file_create(struct file *memfd)
 	file->f_flags |= O_LARGEFILE;
 
 	/*
-	 * These pages are currently unmovable so don't place them into movable
-	 * pageblocks (e.g. CMA and ZONE_MOVABLE).
+	 * The pages can be moved through restrictedmem_migrate_folio(), so let
+	 * compaction and demotion (which goes through reclaim) get at them.
+	 * Pages mapped into a guest stay in place as long as the users hold
+	 * references to them.  Without migration support the pages are
+	 * unmovable, so don't place them into movable pageblocks (e.g. CMA
+	 * and ZONE_MOVABLE).
 	 */
 	mapping = memfd->f_mapping;
-	mapping_set_unevictable(mapping);
-	mapping_set_gfp_mask(mapping,
-			     mapping_gfp_mask(mapping) & ~__GFP_MOVABLE);
+	if (!IS_ENABLED(CONFIG_MIGRATION) || !mapping->a_ops->migrate_folio) {
+		mapping_set_unevictable(mapping);
+		mapping_set_gfp_mask(mapping,
+				     mapping_gfp_mask(mapping) & ~__GFP_MOVABLE);
+	}
+	/* shmem doesn't use it, see restrictedmem_migrate_folio(). */
+	mapping->private_data = data;
 
 	return file;
 }
 
-static int restrictedmem_create(struct vfsmount *mount)
+#ifdef CONFIG_NUMA
+/*
+ * Install the calling task's memory policy over the whole file.  shmem has no
+ * other way to receive a policy, restrictedmem can't be mmap()ed for mbind().
+ */
+static int restrictedmem_set_task_policy(struct file *memfd)
+{
+	struct shared_policy *sp = &SHMEM_I(file_inode(memfd))->policy;
+	struct vm_area_struct pvma;
+	struct mempolicy *mpol;
+	int err;
+
+	task_lock(current);
+	mpol = current->mempolicy;
+	mpol_get(mpol);
+	task_unlock(current);
+
+	/* Default policy, nothing to install. */
+	if (!mpol)
+		return 0;
+
+	vma_init(&pvma, NULL);
+	pvma.vm_end = TASK_SIZE;
+	err = mpol_set_shared_policy(sp, &pvma, mpol);
+	mpol_put(mpol);
+	return err;
+}
+#else
+static int restrictedmem_set_task_policy(struct file *memfd)
+{
+	return 0;
+}
+#endif
+
+static int restrictedmem_create(struct vfsmount *mount, unsigned int flags)
 {
 	struct file *file, *restricted_file;
 	int fd, err;
 
+	if (flags & RMFD_HUGEPAGE) {
+		if (!restrictedmem_huge_mnt)
+			return -EINVAL;
+		mount = restrictedmem_huge_mnt;
+	}
+
 	fd = get_unused_fd_flags(0);
 	if (fd < 0)
 		return fd;
@@ -226,6 +320,14 @@ static int restrictedmem_create(struct vfsmount *mount)
 	file->f_mode |= FMODE_LSEEK | FMODE_PREAD | FMODE_PWRITE;
 	file->f_flags |= O_LARGEFILE;
 
+	if (flags & RMFD_MPOL) {
+		err = restrictedmem_set_task_policy(file);
+		if (err) {
+			fput(file);
+			goto err_fd;
+		}
+	}
+
 	restricted_file = restrictedmem_file_create(file);
 	if (IS_ERR(restricted_file)) {
 		err = PTR_ERR(restricted_file);
@@ -250,7 +352,7 @@ static bool is_mount_root(struct file *file)
 	return file->f_path.dentry == file->f_path.mnt->mnt_root;
 }
 
-static int restrictedmem_create_on_user_mount(int mount_fd)
+static int restrictedmem_create_on_user_mount(int mount_fd, unsigned int flags)
 {
 	int ret;
 	struct fd f;
@@ -276,7 +378,7 @@ static int restrictedmem_create_on_user_mount(int mount_fd)
 	if (unlikely(ret))
 		goto out;
 
-	ret = restrictedmem_create(mnt);
+	ret = restrictedmem_create(mnt, flags);
 
 	mnt_drop_write(mnt);
 out:
@@ -287,16 +389,17 @@ out:
 
 SYSCALL_DEFINE2(memfd_restricted, unsigned int, flags, int, mount_fd)
 {
-	if (flags & ~RMFD_USERMNT)
+	if (flags & ~(RMFD_USERMNT | RMFD_HUGEPAGE | RMFD_MPOL))
 		return -EINVAL;
 
 	if (flags & RMFD_USERMNT) {
-		if (mount_fd < 0)
+		/* Huge page policy of a user mount is set with huge=. */
+		if (mount_fd < 0 || (flags & RMFD_HUGEPAGE))
 			return -EINVAL;
 
-		return restrictedmem_create_on_user_mount(mount_fd);
+		return restrictedmem_create_on_user_mount(mount_fd, flags);
 	} else {
-		return restrictedmem_create(NULL);
+		return restrictedmem_create(NULL, flags);
 	}
 }
 
@@ -347,6 +450,95 @@ int restrictedmem_get_page(struct file *file, pgoff_t offset,
 }
 EXPORT_SYMBOL_GPL(restrictedmem_get_page);
 
+#ifdef CONFIG_MIGRATION
+static int restrictedmem_notifier_migrate(struct restrictedmem_data *data,
+					  pgoff_t index, struct page *src,
+					  struct page *dst)
+{
+	struct restrictedmem_notifier *notifier;
+	bool relocated = false;
+	int ret;
+
+	list_for_each_entry(notifier, &data->notifiers, list) {
+		if (!notifier->ops->migrate)
+			continue;
+
+		ret = notifier->ops->migrate(notifier, index, src, dst);
+		if (ret < 0)
+			return ret;
+		if (ret)
+			relocated = true;
+	}
+	return relocated;
+}
+
+/*
+ * ->migrate_folio() for the shmem mapping backing a restrictedmem file.
+ *
+ * Users like KVM hold extra references on pages mapped into a confidential
+ * guest and the contents can only be moved by the hardware, e.g. with TDX
+ * TDH.MEM.PAGE.RELOCATE.  Let the notifiers relocate the page and move their
+ * references to @dst first, then migrate the page cache entry.  The contents
+ * are only copied by the kernel if no notifier had the page mapped.
+ *
+ * Large folios aren't supported because relocation is done per 4K page.
+ */
+int restrictedmem_migrate_folio(struct address_space *mapping,
+				struct folio *dst, struct folio *src,
+				enum migrate_mode mode)
+{
+	struct restrictedmem_data *data;
+	int relocated, ret;
+
+	if (folio_test_large(src))
+		return -EBUSY;
+
+	rcu_read_lock();
+	data = READ_ONCE(mapping->private_data);
+	if (data && !kref_get_unless_zero(&data->kref))
+		data = NULL;
+	rcu_read_unlock();
+	if (!data)
+		return migrate_folio(mapping, dst, src, mode);
+
+	if (mode == MIGRATE_ASYNC) {
+		if (!mutex_trylock(&data->lock)) {
+			ret = -EAGAIN;
+			goto out;
+		}
+	} else {
+		mutex_lock(&data->lock);
+	}
+
+	relocated = restrictedmem_notifier_migrate(data, src->index,
+						   &src->page, &dst->page);
+	if (relocated < 0) {
+		ret = relocated;
+		goto out_unlock;
+	}
+
+	ret = folio_migrate_mapping(mapping, dst, src, 0);
+	if (ret != MIGRATEPAGE_SUCCESS) {
+		/* Somebody else holds a reference, move the page back. */
+		if (relocated)
+			WARN_ON_ONCE(restrictedmem_notifier_migrate(data,
+					src->index, &dst->page, &src->page) < 0);
+		goto out_unlock;
+	}
+
+	if (relocated || mode == MIGRATE_SYNC_NO_COPY)
+		folio_migrate_flags(dst, src);
+	else
+		folio_migrate_copy(dst, src);
+
+out_unlock:
+	mutex_unlock(&data->lock);
+out:
+	kref_put(&data->kref, restrictedmem_data_free);
+	return ret;
+}
+#endif
+
 void restrictedmem_error_page(struct page *page, struct address_space *mapping)
 {
 	struct super_block *sb = restrictedmem_mnt->mnt_sb;
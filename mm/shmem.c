@@ -79,6 +79,7 @@ static struct vfsmount *shm_mnt;
 #include <linux/userfaultfd_k.h>
 #include <linux/rmap.h>
 #include <linux/uuid.h>
+#include <linux/restrictedmem.h>
 
 #include <linux/uaccess.h>
 
@@ -3907,6 +3908,19 @@ static int shmem_error_remove_page(struct address_space *mapping,
 	return 0;
 }
 
+#ifdef CONFIG_MIGRATION
+static int shmem_migrate_folio(struct address_space *mapping,
+			       struct folio *dst, struct folio *src,
+			       enum migrate_mode mode)
+{
+	/* Only restrictedmem sets private_data of a shmem mapping. */
+	if (IS_ENABLED(CONFIG_RESTRICTEDMEM) && mapping->private_data)
+		return restrictedmem_migrate_folio(mapping, dst, src, mode);
+
+	return migrate_folio(mapping, dst, src, mode);
+}
+#endif
+
 const struct address_space_operations shmem_aops = {
 	.writepage	= shmem_writepage,
 	.dirty_folio	= noop_dirty_folio,
@@ -3915,7 +3929,7 @@ const struct address_space_operations shmem_aops = {
 	.write_end	= shmem_write_end,
 #endif
 #ifdef CONFIG_MIGRATION
-	.migrate_folio	= migrate_folio,
+	.migrate_folio	= shmem_migrate_folio,
 #endif
 	.error_remove_page = shmem_error_remove_page,
 };
@@ -154,6 +154,12 @@ int slab_unmergeable(struct kmem_cache *s)
 	if (s->refcount < 0)
 		return 1;
 
+#if defined(CONFIG_SLUB) && !defined(CONFIG_SLUB_TINY)
+	/* See kmem_cache_setup_percpu_array() */
+	if (s->cpu_array)
+		return 1;
+#endif
+
 	return 0;
 }
 
@@ -2392,6 +2392,32 @@ static void *get_partial(struct kmem_cache *s, int node, struct partial_context
 
 #ifndef CONFIG_SLUB_TINY
 
+/* Upper bound for kmem_cache_setup_percpu_array() */
+#define SLUB_PCA_MAX_COUNT	64
+
+static void *__alloc_from_pca(struct kmem_cache *s, gfp_t gfp);
+static bool __free_to_pca(struct kmem_cache *s, struct slab *slab, void *object);
+static void flush_pca(struct kmem_cache *s, struct slub_percpu_array *pca,
+		      unsigned int count);
+
+static __always_inline void *alloc_from_pca(struct kmem_cache *s, gfp_t gfp,
+					    int node)
+{
+	if (likely(!s->cpu_array) || node != NUMA_NO_NODE)
+		return NULL;
+
+	return __alloc_from_pca(s, gfp);
+}
+
+static __always_inline bool free_to_pca(struct kmem_cache *s,
+					struct slab *slab, void *object, int cnt)
+{
+	if (likely(!s->cpu_array) || cnt != 1)
+		return false;
+
+	return __free_to_pca(s, slab, object);
+}
+
 #ifdef CONFIG_PREEMPTION
 /*
  * Calculate the next globally unique transaction for disambiguation
@@ -2780,12 +2806,23 @@ static void flush_cpu_slab(struct work_struct *w)
 	struct kmem_cache *s;
 	struct kmem_cache_cpu *c;
 	struct slub_flush_work *sfw;
+	unsigned long flags;
 
 	sfw = container_of(w, struct slub_flush_work, work);
 
 	s = sfw->s;
 	c = this_cpu_ptr(s->cpu_slab);
 
+	/* Objects from the array may land on the cpu slab, flush it first */
+	if (s->cpu_array) {
+		struct slub_percpu_array *pca;
+
+		local_lock_irqsave(&s->cpu_array->lock, flags);
+		pca = this_cpu_ptr(s->cpu_array);
+		flush_pca(s, pca, pca->used);
+		local_unlock_irqrestore(&s->cpu_array->lock, flags);
+	}
+
 	if (c->slab)
 		flush_slab(s, c);
 
@@ -2796,6 +2833,9 @@ static bool has_cpu_slab(int cpu, struct kmem_cache *s)
 {
 	struct kmem_cache_cpu *c = per_cpu_ptr(s->cpu_slab, cpu);
 
+	if (s->cpu_array && per_cpu_ptr(s->cpu_array, cpu)->used)
+		return true;
+
 	return c->slab || slub_percpu_partial(c);
 }
 
@@ -2848,8 +2888,15 @@ static int slub_cpu_dead(unsigned int cpu)
 	struct kmem_cache *s;
 
 	mutex_lock(&slab_mutex);
-	list_for_each_entry(s, &slab_caches, list)
+	list_for_each_entry(s, &slab_caches, list) {
+		if (s->cpu_array) {
+			struct slub_percpu_array *pca;
+
+			pca = per_cpu_ptr(s->cpu_array, cpu);
+			flush_pca(s, pca, pca->used);
+		}
 		__flush_cpu_slab(s, cpu);
+	}
 	mutex_unlock(&slab_mutex);
 	return 0;
 }
@@ -2859,6 +2906,15 @@ static inline void flush_all_cpus_locked(struct kmem_cache *s) { }
 static inline void flush_all(struct kmem_cache *s) { }
 static inline void __flush_cpu_slab(struct kmem_cache *s, int cpu) { }
 static inline int slub_cpu_dead(unsigned int cpu) { return 0; }
+static inline void *alloc_from_pca(struct kmem_cache *s, gfp_t gfp, int node)
+{
+	return NULL;
+}
+static inline bool free_to_pca(struct kmem_cache *s, struct slab *slab,
+			       void *object, int cnt)
+{
+	return false;
+}
 #endif /* CONFIG_SLUB_TINY */
 
 /*
@@ -3439,7 +3495,9 @@ static __fastpath_inline void *slab_alloc_node(struct kmem_cache *s, struct list
 	if (unlikely(object))
 		goto out;
 
-	object = __slab_alloc_node(s, gfpflags, node, addr, orig_size);
+	object = alloc_from_pca(s, gfpflags, node);
+	if (!object)
+		object = __slab_alloc_node(s, gfpflags, node, addr, orig_size);
 
 	maybe_wipe_obj_freeptr(s, object);
 	init = slab_want_init_on_alloc(gfpflags, s);
@@ -3784,7 +3842,8 @@ static __fastpath_inline void slab_free(struct kmem_cache *s, struct slab *slab,
 	 * With KASAN enabled slab_free_freelist_hook modifies the freelist
 	 * to remove objects, whose reuse must be delayed.
 	 */
-	if (slab_free_freelist_hook(s, &head, &tail, &cnt))
+	if (slab_free_freelist_hook(s, &head, &tail, &cnt) &&
+	    !free_to_pca(s, slab, head, cnt))
 		do_slab_free(s, slab, head, tail, cnt, addr);
 }
 
@@ -3977,6 +4036,211 @@ error:
 	return 0;
 
 }
+
+/*
+ * Return the oldest @count objects of @pca to their slabs. These are the
+ * least likely to still be cache hot. The caller holds the array lock or
+ * owns @pca because its cpu is dead.
+ */
+static void flush_pca(struct kmem_cache *s, struct slub_percpu_array *pca,
+		      unsigned int count)
+{
+	unsigned int i;
+
+	if (!count)
+		return;
+
+	for (i = 0; i < count; i++) {
+		void *object = pca->objects[i];
+
+		do_slab_free(s, virt_to_slab(object), object, NULL, 1, _RET_IP_);
+	}
+
+	pca->used -= count;
+	memmove(pca->objects, pca->objects + count,
+		pca->used * sizeof(pca->objects[0]));
+	stat(s, PCA_FLUSH);
+}
+
+/*
+ * Fill half of an empty array from the cpu slab in one go, so the cpu slab
+ * lock and the partial lists are visited once per batch of allocations.
+ */
+static bool refill_pca(struct kmem_cache *s, gfp_t gfp)
+{
+	void *objects[SLUB_PCA_MAX_COUNT / 2];
+	struct slub_percpu_array *pca;
+	unsigned long flags;
+	int filled, i, j;
+
+	filled = __kmem_cache_alloc_bulk(s, gfp,
+				this_cpu_read(s->cpu_array->count) / 2,
+				objects, NULL);
+
+	/* Keep out what __free_to_pca() would not take either */
+	for (i = 0, j = 0; i < filled; i++) {
+		void *object = objects[i];
+		struct slab *slab = virt_to_slab(object);
+
+		if (unlikely(is_kfence_address(object) ||
+			     slab_test_pfmemalloc(slab) ||
+			     slab_nid(slab) != numa_mem_id()))
+			do_slab_free(s, slab, object, NULL, 1, _RET_IP_);
+		else
+			objects[j++] = object;
+	}
+	filled = j;
+	if (!filled)
+		return false;
+
+	i = 0;
+	local_lock_irqsave(&s->cpu_array->lock, flags);
+	pca = this_cpu_ptr(s->cpu_array);
+	while (i < filled && pca->used < pca->count)
+		pca->objects[pca->used++] = objects[i++];
+	local_unlock_irqrestore(&s->cpu_array->lock, flags);
+
+	/* We may have migrated or raced with frees, return what did not fit */
+	for (; i < filled; i++)
+		do_slab_free(s, virt_to_slab(objects[i]), objects[i], NULL, 1,
+			     _RET_IP_);
+
+	stat(s, PCA_REFILL);
+	return true;
+}
+
+static void *__alloc_from_pca(struct kmem_cache *s, gfp_t gfp)
+{
+	struct slub_percpu_array *pca;
+	unsigned long flags;
+	void *object;
+
+	for (;;) {
+		local_lock_irqsave(&s->cpu_array->lock, flags);
+		pca = this_cpu_ptr(s->cpu_array);
+		if (likely(pca->used))
+			break;
+		local_unlock_irqrestore(&s->cpu_array->lock, flags);
+
+		/*
+		 * The bulk refill enables interrupts, so leave callers with
+		 * interrupts disabled to the regular fastpath.
+		 */
+		if (irqs_disabled() || !refill_pca(s, gfp))
+			return NULL;
+	}
+
+	object = pca->objects[--pca->used];
+	local_unlock_irqrestore(&s->cpu_array->lock, flags);
+
+	/* slab_alloc_node() wipes the free pointer */
+	stat(s, ALLOC_PCA);
+	return object;
+}
+
+static bool __free_to_pca(struct kmem_cache *s, struct slab *slab, void *object)
+{
+	struct slub_percpu_array *pca;
+	unsigned long flags;
+
+	/*
+	 * kfence objects are managed by kfence, and objects from pfmemalloc
+	 * slabs must not be handed out to allocations without the reserves
+	 * access rights.  The array only serves NUMA_NO_NODE allocations,
+	 * which expect local memory, so remote objects go back to their slab.
+	 */
+	if (unlikely(is_kfence_address(object) || slab_test_pfmemalloc(slab) ||
+		     slab_nid(slab) != numa_mem_id()))
+		return false;
+
+	local_lock_irqsave(&s->cpu_array->lock, flags);
+	pca = this_cpu_ptr(s->cpu_array);
+	if (unlikely(pca->used == pca->count))
+		flush_pca(s, pca, pca->count / 2);
+	pca->objects[pca->used++] = object;
+	local_unlock_irqrestore(&s->cpu_array->lock, flags);
+
+	stat(s, FREE_PCA);
+	return true;
+}
+
+/* Bulk allocations are served from the array only if it holds all of them */
+static bool alloc_bulk_from_pca(struct kmem_cache *s, size_t size, void **p)
+{
+	struct slub_percpu_array *pca;
+	unsigned long flags;
+	size_t i;
+
+	if (!s->cpu_array)
+		return false;
+
+	local_lock_irqsave(&s->cpu_array->lock, flags);
+	pca = this_cpu_ptr(s->cpu_array);
+	if (pca->used < size) {
+		local_unlock_irqrestore(&s->cpu_array->lock, flags);
+		return false;
+	}
+
+	for (i = 0; i < size; i++) {
+		p[i] = pca->objects[--pca->used];
+		maybe_wipe_obj_freeptr(s, p[i]);
+	}
+	local_unlock_irqrestore(&s->cpu_array->lock, flags);
+
+	stat(s, ALLOC_PCA);
+	return true;
+}
+
+/**
+ * kmem_cache_setup_percpu_array - cache freed objects in a per cpu array
+ * @s: the cache
+ * @count: number of objects each cpu may cache, capped at 64
+ *
+ * Put an array of free objects in front of the cpu slab of each cpu. Frees
+ * push into it and allocations pop the most recently freed object, which
+ * keeps objects cache hot and takes the cpu slab lock and the node
+ * list_lock once per batch rather than once per object. Allocations for a
+ * specific node bypass the array. Intended for caches with high alloc/free
+ * churn and set up right after the cache is created.
+ *
+ * Caches with debugging enabled are left alone as the array would bypass
+ * the consistency checks, and so are caches already merged with others.
+ * A cache with an array is not merged with caches created later.
+ *
+ * Return: 0 on success, -ENOMEM if the array could not be allocated.
+ */
+int kmem_cache_setup_percpu_array(struct kmem_cache *s, unsigned int count)
+{
+	struct slub_percpu_array __percpu *cpu_array;
+	int cpu, ret = 0;
+
+	mutex_lock(&slab_mutex);
+
+	/* The array is sized for the creator, don't impose it on aliases */
+	if (kmem_cache_debug(s) || s->cpu_array || s->refcount != 1)
+		goto out_unlock;
+
+	count = clamp(count, 2U, (unsigned int)SLUB_PCA_MAX_COUNT);
+	cpu_array = __alloc_percpu(struct_size(cpu_array, objects, count),
+				   sizeof(void *));
+	if (!cpu_array) {
+		ret = -ENOMEM;
+		goto out_unlock;
+	}
+
+	for_each_possible_cpu(cpu) {
+		struct slub_percpu_array *pca = per_cpu_ptr(cpu_array, cpu);
+
+		local_lock_init(&pca->lock);
+		pca->count = count;
+	}
+
+	/* Pairs with the dependent loads through s->cpu_array */
+	smp_store_release(&s->cpu_array, cpu_array);
+out_unlock:
+	mutex_unlock(&slab_mutex);
+	return ret;
+}
 #else /* CONFIG_SLUB_TINY */
 static int __kmem_cache_alloc_bulk(struct kmem_cache *s, gfp_t flags,
 			size_t size, void **p, struct obj_cgroup *objcg)
@@ -4006,7 +4270,19 @@ error:
 	kmem_cache_free_bulk(s, i, p);
 	return 0;
 }
+
+static inline bool alloc_bulk_from_pca(struct kmem_cache *s, size_t size,
+				       void **p)
+{
+	return false;
+}
+
+int kmem_cache_setup_percpu_array(struct kmem_cache *s, unsigned int count)
+{
+	return 0;
+}
 #endif /* CONFIG_SLUB_TINY */
+EXPORT_SYMBOL(kmem_cache_setup_percpu_array);
 
 /* Note that interrupts must be enabled when calling this function. */
 int kmem_cache_alloc_bulk(struct kmem_cache *s, gfp_t flags, size_t size,
@@ -4023,7 +4299,10 @@ int kmem_cache_alloc_bulk(struct kmem_cache *s, gfp_t flags, size_t size,
 	if (unlikely(!s))
 		return 0;
 
-	i = __kmem_cache_alloc_bulk(s, flags, size, p, objcg);
+	if (alloc_bulk_from_pca(s, size, p))
+		i = size;
+	else
+		i = __kmem_cache_alloc_bulk(s, flags, size, p, objcg);
 
 	/*
 	 * memcg and kmem_cache debug support and memory initialization.
@@ -4279,6 +4558,7 @@ void __kmem_cache_release(struct kmem_cache *s)
 {
 	cache_random_seq_destroy(s);
 #ifndef CONFIG_SLUB_TINY
+	free_percpu(s->cpu_array);
 	free_percpu(s->cpu_slab);
 #endif
 	free_kmem_cache_nodes(s);
@@ -5911,6 +6191,10 @@ STAT_ATTR(CPU_PARTIAL_ALLOC, cpu_partial_alloc);
 STAT_ATTR(CPU_PARTIAL_FREE, cpu_partial_free);
 STAT_ATTR(CPU_PARTIAL_NODE, cpu_partial_node);
 STAT_ATTR(CPU_PARTIAL_DRAIN, cpu_partial_drain);
+STAT_ATTR(ALLOC_PCA, alloc_pca);
+STAT_ATTR(FREE_PCA, free_pca);
+STAT_ATTR(PCA_REFILL, pca_refill);
+STAT_ATTR(PCA_FLUSH, pca_flush);
 #endif	/* CONFIG_SLUB_STATS */
 
 #ifdef CONFIG_KFENCE
@@ -5998,6 +6282,10 @@ static struct attribute *slab_attrs[] = {
 	&cpu_partial_free_attr.attr,
 	&cpu_partial_node_attr.attr,
 	&cpu_partial_drain_attr.attr,
+	&alloc_pca_attr.attr,
+	&free_pca_attr.attr,
+	&pca_refill_attr.attr,
+	&pca_flush_attr.attr,
 #endif
 #ifdef CONFIG_FAILSLAB
 	&failslab_attr.attr,
@@ -25,6 +25,7 @@
 #include <linux/compat.h>
 
 #include <linux/uaccess.h>
+#include <linux/workqueue.h>
 
 #include "internal.h"
 #include "swap.h"
@@ -757,6 +758,43 @@ struct address_space *folio_mapping(struct folio *folio)
 }
 EXPORT_SYMBOL(folio_mapping);
 
+/*
+ * Copies of folios spanning several FOLIO_COPY_MIN_CHUNK pages are split
+ * across up to FOLIO_COPY_MAX_THREADS threads, so that migrating e.g. a 1G
+ * hugetlb page isn't bound to the copy bandwidth of a single CPU.
+ */
+#define FOLIO_COPY_MAX_THREADS	8
+#define FOLIO_COPY_MIN_CHUNK	512
+
+struct folio_copy_work {
+	struct work_struct work;
+	struct folio *dst;
+	struct folio *src;
+	long start;
+	long end;
+};
+
+static void folio_copy_range(struct folio *dst, struct folio *src,
+			     long start, long end)
+{
+	long i = start;
+
+	for (;;) {
+		copy_highpage(folio_page(dst, i), folio_page(src, i));
+		if (++i == end)
+			break;
+		cond_resched();
+	}
+}
+
+static void folio_copy_workfn(struct work_struct *work)
+{
+	struct folio_copy_work *fcw = container_of(work, struct folio_copy_work,
+						   work);
+
+	folio_copy_range(fcw->dst, fcw->src, fcw->start, fcw->end);
+}
+
 /**
  * folio_copy - Copy the contents of one folio to another.
  * @dst: Folio to copy to.
@@ -765,18 +803,41 @@ EXPORT_SYMBOL(folio_mapping);
  * The bytes in the folio represented by @src are copied to @dst.
  * Assumes the caller has validated that @dst is at least as large as @src.
  * Can be called in atomic context for order-0 folios, but if the folio is
- * larger, it may sleep.
+ * larger, it may sleep. Very large folios are copied by several threads.
  */
 void folio_copy(struct folio *dst, struct folio *src)
 {
-	long i = 0;
+	struct folio_copy_work works[FOLIO_COPY_MAX_THREADS - 1];
 	long nr = folio_nr_pages(src);
+	long chunk, start;
+	int nr_threads, i;
+
+	nr_threads = min_t(long, nr / FOLIO_COPY_MIN_CHUNK,
+			   FOLIO_COPY_MAX_THREADS);
+	nr_threads = min_t(int, nr_threads, num_online_cpus());
+	if (nr_threads <= 1) {
+		folio_copy_range(dst, src, 0, nr);
+		return;
+	}
 
-	for (;;) {
-		copy_highpage(folio_page(dst, i), folio_page(src, i));
-		if (++i == nr)
-			break;
-		cond_resched();
+	chunk = DIV_ROUND_UP(nr, nr_threads);
+	for (i = 0, start = chunk; i < nr_threads - 1; i++, start += chunk) {
+		struct folio_copy_work *fcw = &works[i];
+
+		INIT_WORK_ONSTACK(&fcw->work, folio_copy_workfn);
+		fcw->dst = dst;
+		fcw->src = src;
+		fcw->start = start;
+		fcw->end = min(start + chunk, nr);
+		queue_work(system_unbound_wq, &fcw->work);
+	}
+
+	/* Copy the first chunk ourselves while the workers do the rest. */
+	folio_copy_range(dst, src, 0, chunk);
+
+	for (i = 0; i < nr_threads - 1; i++) {
+		flush_work(&works[i].work);
+		destroy_work_on_stack(&works[i].work);
 	}
 }
 
@@ -746,9 +746,48 @@ LIST_HEAD(vmap_area_list);
 static struct rb_root vmap_area_root = RB_ROOT;
 static bool vmap_initialized __read_mostly;
 
-static struct rb_root purge_vmap_area_root = RB_ROOT;
-static LIST_HEAD(purge_vmap_area_list);
-static DEFINE_SPINLOCK(purge_vmap_area_lock);
+/*
+ * Lazily-freed areas and a pool of ready-to-use small areas are kept per
+ * node, so that freeing and allocating don't all serialize on one lock.
+ *
+ * The pool is refilled by the purge: once the TLB has been flushed, areas of
+ * up to MAX_VA_SIZE_PAGES pages go to the pool of the node they were freed
+ * on instead of back to the global free tree, and alloc_vmap_area() looks
+ * for an exact size match there before taking free_vmap_area_lock. The pools
+ * are drained back into the free tree when an allocation runs out of space.
+ */
+#define MAX_VA_SIZE_PAGES	256
+
+/* Bounds the address space a node's pool can hold */
+#define VMAP_POOL_MAX_LEN	(IS_ENABLED(CONFIG_64BIT) ? 32 : 0)
+
+struct vmap_pool {
+	struct list_head head;
+	unsigned long len;
+};
+
+struct vmap_node {
+	/* Lazily-freed areas, waiting for a TLB flush */
+	spinlock_t lazy_lock;
+	struct rb_root lazy_root;
+	struct list_head lazy_list;
+
+	/* Detached lazy areas being purged, under vmap_purge_lock */
+	struct list_head purge_list;
+
+	/* Purged areas kept for reuse, indexed by size in pages - 1 */
+	spinlock_t pool_lock;
+	struct vmap_pool pool[MAX_VA_SIZE_PAGES];
+};
+
+static struct vmap_node single_vmap_node;
+static struct vmap_node *vmap_nodes = &single_vmap_node;
+static unsigned int nr_vmap_nodes = 1;
+
+static inline struct vmap_node *this_vmap_node(void)
+{
+	return &vmap_nodes[nr_vmap_nodes > 1 ? numa_node_id() : 0];
+}
 
 /*
  * This kmem_cache is used for vmap_area objects. Instead of
@@ -1590,6 +1629,40 @@ preload_this_cpu_lock(spinlock_t *lock, gfp_t gfp_mask, int node)
  * Allocate a region of KVA of the specified size and alignment, within the
  * vstart and vend.
  */
+/*
+ * Take an area of exactly @size bytes from this node's pool, if the request
+ * is for the vmalloc space and the pool has one that is suitably aligned.
+ */
+static struct vmap_area *vmap_pool_get(unsigned long size, unsigned long align,
+				       unsigned long vstart, unsigned long vend)
+{
+	unsigned long nr = size >> PAGE_SHIFT;
+	struct vmap_node *vn;
+	struct vmap_pool *pool;
+	struct vmap_area *va;
+
+	if (vstart != VMALLOC_START || vend != VMALLOC_END ||
+	    nr > MAX_VA_SIZE_PAGES)
+		return NULL;
+
+	vn = this_vmap_node();
+	pool = &vn->pool[nr - 1];
+	if (!READ_ONCE(pool->len))
+		return NULL;
+
+	spin_lock(&vn->pool_lock);
+	va = list_first_entry_or_null(&pool->head, struct vmap_area, list);
+	if (va && IS_ALIGNED(va->va_start, align)) {
+		list_del_init(&va->list);
+		WRITE_ONCE(pool->len, pool->len - 1);
+	} else {
+		va = NULL;
+	}
+	spin_unlock(&vn->pool_lock);
+
+	return va;
+}
+
 static struct vmap_area *alloc_vmap_area(unsigned long size,
 				unsigned long align,
 				unsigned long vstart, unsigned long vend,
@@ -1611,6 +1684,13 @@ static struct vmap_area *alloc_vmap_area(unsigned long size,
 	might_sleep();
 	gfp_mask = gfp_mask & GFP_RECLAIM_MASK;
 
+	va = vmap_pool_get(size, align, vstart, vend);
+	if (va) {
+		addr = va->va_start;
+		trace_alloc_vmap_area(addr, size, align, vstart, vend, false);
+		goto insert;
+	}
+
 	va = kmem_cache_alloc_node(vmap_area_cachep, gfp_mask, node);
 	if (unlikely(!va))
 		return ERR_PTR(-ENOMEM);
@@ -1638,6 +1718,7 @@ retry:
 
 	va->va_start = addr;
 	va->va_end = addr + size;
+insert:
 	va->vm = NULL;
 
 	spin_lock(&vmap_area_lock);
@@ -1729,38 +1810,50 @@ static DEFINE_MUTEX(vmap_purge_lock);
 static void purge_fragmented_blocks_allcpus(void);
 
 /*
- * Purges all lazily-freed vmap areas.
+ * Move the purged areas of @vn that fit into its pool there.
  */
-static bool __purge_vmap_area_lazy(unsigned long start, unsigned long end)
+static unsigned int vmap_node_fill_pool(struct vmap_node *vn)
 {
-	unsigned long resched_threshold;
-	unsigned int num_purged_areas = 0;
-	struct list_head local_purge_list;
+	unsigned int num_pooled_areas = 0;
 	struct vmap_area *va, *n_va;
+	struct vmap_pool *pool;
+	unsigned long nr;
 
-	lockdep_assert_held(&vmap_purge_lock);
+	if (!VMAP_POOL_MAX_LEN)
+		return 0;
 
-	spin_lock(&purge_vmap_area_lock);
-	purge_vmap_area_root = RB_ROOT;
-	list_replace_init(&purge_vmap_area_list, &local_purge_list);
-	spin_unlock(&purge_vmap_area_lock);
+	spin_lock(&vn->pool_lock);
+	list_for_each_entry_safe(va, n_va, &vn->purge_list, list) {
+		nr = va_size(va) >> PAGE_SHIFT;
+		if (nr > MAX_VA_SIZE_PAGES || va->va_start < VMALLOC_START ||
+		    va->va_end > VMALLOC_END)
+			continue;
 
-	if (unlikely(list_empty(&local_purge_list)))
-		goto out;
+		pool = &vn->pool[nr - 1];
+		if (pool->len >= VMAP_POOL_MAX_LEN)
+			continue;
 
-	start = min(start,
-		list_first_entry(&local_purge_list,
-			struct vmap_area, list)->va_start);
+		list_move(&va->list, &pool->head);
+		WRITE_ONCE(pool->len, pool->len + 1);
+		atomic_long_sub(nr, &vmap_lazy_nr);
+		num_pooled_areas++;
+	}
+	spin_unlock(&vn->pool_lock);
 
-	end = max(end,
-		list_last_entry(&local_purge_list,
-			struct vmap_area, list)->va_end);
+	return num_pooled_areas;
+}
 
-	flush_tlb_kernel_range(start, end);
-	resched_threshold = lazy_max_pages() << 1;
+/*
+ * Return the flushed areas on @head to the free tree.
+ */
+static unsigned int vmap_release_purged(struct list_head *head,
+					unsigned long resched_threshold)
+{
+	unsigned int num_purged_areas = 0;
+	struct vmap_area *va, *n_va;
 
 	spin_lock(&free_vmap_area_lock);
-	list_for_each_entry_safe(va, n_va, &local_purge_list, list) {
+	list_for_each_entry_safe(va, n_va, head, list) {
 		unsigned long nr = (va->va_end - va->va_start) >> PAGE_SHIFT;
 		unsigned long orig_start = va->va_start;
 		unsigned long orig_end = va->va_end;
@@ -1788,11 +1881,99 @@ static bool __purge_vmap_area_lazy(unsigned long start, unsigned long end)
 	}
 	spin_unlock(&free_vmap_area_lock);
 
+	return num_purged_areas;
+}
+
+/*
+ * Purges all lazily-freed vmap areas.
+ */
+static bool __purge_vmap_area_lazy(unsigned long start, unsigned long end)
+{
+	unsigned long resched_threshold;
+	unsigned int num_purged_areas = 0;
+	struct vmap_node *vn;
+	bool do_flush = false;
+	int i;
+
+	lockdep_assert_held(&vmap_purge_lock);
+
+	for (i = 0; i < nr_vmap_nodes; i++) {
+		vn = &vmap_nodes[i];
+
+		INIT_LIST_HEAD(&vn->purge_list);
+		if (list_empty_careful(&vn->lazy_list))
+			continue;
+
+		spin_lock(&vn->lazy_lock);
+		vn->lazy_root = RB_ROOT;
+		list_replace_init(&vn->lazy_list, &vn->purge_list);
+		spin_unlock(&vn->lazy_lock);
+
+		if (list_empty(&vn->purge_list))
+			continue;
+
+		start = min(start, list_first_entry(&vn->purge_list,
+					struct vmap_area, list)->va_start);
+		end = max(end, list_last_entry(&vn->purge_list,
+					struct vmap_area, list)->va_end);
+		do_flush = true;
+	}
+
+	if (unlikely(!do_flush))
+		goto out;
+
+	flush_tlb_kernel_range(start, end);
+	resched_threshold = lazy_max_pages() << 1;
+
+	for (i = 0; i < nr_vmap_nodes; i++) {
+		vn = &vmap_nodes[i];
+		if (list_empty(&vn->purge_list))
+			continue;
+
+		num_purged_areas += vmap_node_fill_pool(vn);
+		num_purged_areas += vmap_release_purged(&vn->purge_list,
+							resched_threshold);
+	}
+
 out:
 	trace_purge_vmap_area_lazy(start, end, num_purged_areas);
 	return num_purged_areas > 0;
 }
 
+/*
+ * Return all pooled areas to the free tree, for when an allocation is short
+ * of space. The pooled areas have been flushed already.
+ */
+static void vmap_pools_drain(void)
+{
+	struct vmap_node *vn;
+	LIST_HEAD(head);
+	int i, j;
+
+	lockdep_assert_held(&vmap_purge_lock);
+
+	for (i = 0; i < nr_vmap_nodes; i++) {
+		vn = &vmap_nodes[i];
+
+		spin_lock(&vn->pool_lock);
+		for (j = 0; j < MAX_VA_SIZE_PAGES; j++) {
+			struct vmap_pool *pool = &vn->pool[j];
+
+			/*
+			 * Pooled areas were taken off vmap_lazy_nr when they
+			 * were pooled, vmap_release_purged() takes them off
+			 * again.
+			 */
+			atomic_long_add(pool->len * (j + 1), &vmap_lazy_nr);
+			list_splice_init(&pool->head, &head);
+			WRITE_ONCE(pool->len, 0);
+		}
+		spin_unlock(&vn->pool_lock);
+	}
+
+	vmap_release_purged(&head, lazy_max_pages() << 1);
+}
+
 /*
  * Kick off a purge of the outstanding lazy areas.
  */
@@ -1801,6 +1982,7 @@ static void purge_vmap_area_lazy(void)
 	mutex_lock(&vmap_purge_lock);
 	purge_fragmented_blocks_allcpus();
 	__purge_vmap_area_lazy(ULONG_MAX, 0);
+	vmap_pools_drain();
 	mutex_unlock(&vmap_purge_lock);
 }
 
@@ -1827,6 +2009,7 @@ static void free_vmap_area_noflush(struct vmap_area *va)
 {
 	unsigned long nr_lazy_max = lazy_max_pages();
 	unsigned long va_start = va->va_start;
+	struct vmap_node *vn = this_vmap_node();
 	unsigned long nr_lazy;
 
 	spin_lock(&vmap_area_lock);
@@ -1837,12 +2020,11 @@ static void free_vmap_area_noflush(struct vmap_area *va)
 				PAGE_SHIFT, &vmap_lazy_nr);
 
 	/*
-	 * Merge or place it to the purge tree/list.
+	 * Merge or place it to this node's purge tree/list.
 	 */
-	spin_lock(&purge_vmap_area_lock);
-	merge_or_add_vmap_area(va,
-		&purge_vmap_area_root, &purge_vmap_area_list);
-	spin_unlock(&purge_vmap_area_lock);
+	spin_lock(&vn->lazy_lock);
+	merge_or_add_vmap_area(va, &vn->lazy_root, &vn->lazy_list);
+	spin_unlock(&vn->lazy_lock);
 
 	trace_free_vmap_area_noflush(va_start, nr_lazy, nr_lazy_max);
 
@@ -2420,6 +2602,35 @@ static void vmap_init_free_space(void)
 	}
 }
 
+static void __init vmap_init_nodes(void)
+{
+	struct vmap_node *vn;
+	int i, j;
+
+	if (nr_node_ids > 1) {
+		vn = kmalloc_array(nr_node_ids, sizeof(*vn), GFP_NOWAIT);
+		if (vn) {
+			vmap_nodes = vn;
+			nr_vmap_nodes = nr_node_ids;
+		}
+	}
+
+	for (i = 0; i < nr_vmap_nodes; i++) {
+		vn = &vmap_nodes[i];
+
+		spin_lock_init(&vn->lazy_lock);
+		vn->lazy_root = RB_ROOT;
+		INIT_LIST_HEAD(&vn->lazy_list);
+		INIT_LIST_HEAD(&vn->purge_list);
+
+		spin_lock_init(&vn->pool_lock);
+		for (j = 0; j < MAX_VA_SIZE_PAGES; j++) {
+			INIT_LIST_HEAD(&vn->pool[j].head);
+			vn->pool[j].len = 0;
+		}
+	}
+}
+
 void __init vmalloc_init(void)
 {
 	struct vmap_area *va;
@@ -2431,6 +2642,8 @@ void __init vmalloc_init(void)
 	 */
 	vmap_area_cachep = KMEM_CACHE(vmap_area, SLAB_PANIC);
 
+	vmap_init_nodes();
+
 	for_each_possible_cpu(i) {
 		struct vmap_block_queue *vbq;
 		struct vfree_deferred *p;
@@ -4113,15 +4326,21 @@ static void show_numa_info(struct seq_file *m, struct vm_struct *v)
 
 static void show_purge_info(struct seq_file *m)
 {
+	struct vmap_node *vn;
 	struct vmap_area *va;
+	int i;
 
-	spin_lock(&purge_vmap_area_lock);
-	list_for_each_entry(va, &purge_vmap_area_list, list) {
-		seq_printf(m, "0x%pK-0x%pK %7ld unpurged vm_area\n",
-			(void *)va->va_start, (void *)va->va_end,
-			va->va_end - va->va_start);
+	for (i = 0; i < nr_vmap_nodes; i++) {
+		vn = &vmap_nodes[i];
+
+		spin_lock(&vn->lazy_lock);
+		list_for_each_entry(va, &vn->lazy_list, list) {
+			seq_printf(m, "0x%pK-0x%pK %7ld unpurged vm_area\n",
+				(void *)va->va_start, (void *)va->va_end,
+				va->va_end - va->va_start);
+		}
+		spin_unlock(&vn->lazy_lock);
 	}
-	spin_unlock(&purge_vmap_area_lock);
 }
 
 static int s_show(struct seq_file *m, void *p)
@@ -2847,9 +2847,10 @@ static void prepare_scan_count(pg_data_t *pgdat, struct scan_control *sc)
 
 	/*
 	 * Flush the memory cgroup stats, so that we read accurate per-memcg
-	 * lruvec stats for heuristics.
+	 * lruvec stats for heuristics. Reclaim is hot and only needs a rough
+	 * picture, so don't flush more often than the periodic flusher does.
 	 */
-	mem_cgroup_flush_stats();
+	mem_cgroup_flush_stats_ratelimited(sc->target_mem_cgroup);
 
 	/*
 	 * Determine the scan balance between anon and file LRUs.
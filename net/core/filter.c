@@ -60,6 +60,7 @@
 #include <net/udp.h>
 #include <linux/bpf_trace.h>
 #include <net/xdp_sock.h>
+#include <net/xdp_sock_drv.h>
 #include <linux/inetdevice.h>
 #include <net/inet_hashtables.h>
 #include <net/inet6_hashtables.h>
@@ -4007,6 +4008,24 @@ static int bpf_xdp_frags_increase_tail(struct xdp_buff *xdp, int offset)
 	return 0;
 }
 
+/* Release a fully trimmed frag; with AF_XDP zero-copy it is the last
+ * buffer linked to the pool rather than a page.
+ */
+static void bpf_xdp_shrink_free_frag(struct xdp_buff *xdp, skb_frag_t *frag)
+{
+	struct xdp_buff *tail;
+
+	if (xdp->rxq->mem.type != MEM_TYPE_XSK_BUFF_POOL) {
+		__xdp_return(page_address(skb_frag_page(frag)), &xdp->rxq->mem,
+			     false, NULL);
+		return;
+	}
+
+	tail = xsk_buff_get_tail(xdp);
+	xsk_buff_del_tail(tail);
+	xsk_buff_free(tail);
+}
+
 static int bpf_xdp_frags_shrink_tail(struct xdp_buff *xdp, int offset)
 {
 	struct skb_shared_info *sinfo = xdp_get_shared_info_from_buff(xdp);
@@ -4023,10 +4042,7 @@ static int bpf_xdp_frags_shrink_tail(struct xdp_buff *xdp, int offset)
 		offset -= shrink;
 
 		if (skb_frag_size(frag) == shrink) {
-			struct page *page = skb_frag_page(frag);
-
-			__xdp_return(page_address(page), &xdp->rxq->mem,
-				     false, NULL);
+			bpf_xdp_shrink_free_frag(xdp, frag);
 			n_frags_free++;
 		} else {
 			skb_frag_size_sub(frag, shrink);
@@ -4287,10 +4303,11 @@ int xdp_do_redirect(struct net_device *dev, struct xdp_buff *xdp,
 
 	/* XDP_REDIRECT is not fully supported yet for xdp frags since
 	 * not all XDP capable drivers can map non-linear xdp_frame in
-	 * ndo_xdp_xmit.
+	 * ndo_xdp_xmit. AF_XDP sockets bound with XDP_USE_SG take them.
 	 */
 	if (unlikely(xdp_buff_has_frags(xdp) &&
-		     map_type != BPF_MAP_TYPE_CPUMAP))
+		     map_type != BPF_MAP_TYPE_CPUMAP &&
+		     map_type != BPF_MAP_TYPE_XSKMAP))
 		return -EOPNOTSUPP;
 
 	if (map_type == BPF_MAP_TYPE_XSKMAP)
@@ -4341,6 +4358,8 @@ static int xdp_do_generic_redirect_map(struct net_device *dev,
 			goto err;
 		break;
 	case BPF_MAP_TYPE_XSKMAP:
+		/* Let copy mode sockets busy poll the NAPI of this queue */
+		sk_mark_napi_id_once(&((struct xdp_sock *)fwd)->sk, skb);
 		err = xsk_generic_rcv(fwd, xdp);
 		if (err)
 			goto err;
@@ -27,6 +27,9 @@
 
 #define BIAS_MAX	LONG_MAX
 
+/* Sanity limit mem that can be pinned down */
+#define PP_RING_SIZE_MAX	32768
+
 #ifdef CONFIG_PAGE_POOL_STATS
 /* alloc_stat_inc is intended to be used in softirq context */
 #define alloc_stat_inc(pool, __stat)	(pool->alloc_stats.__stat++)
@@ -127,10 +130,47 @@ u64 *page_pool_ethtool_stats_get(u64 *data, void *stats)
 }
 EXPORT_SYMBOL(page_pool_ethtool_stats_get);
 
+/* How often, and up to which multiple of its initial size, the ring grows */
+#define PP_RING_RESIZE_INTERVAL	HZ
+#define PP_RING_RESIZE_FACTOR	4
+
+/* Grow the ring when more than a quarter of its size in pages went back to
+ * the page allocator since the last check, because the ring was full. That
+ * happens when pages are returned in bursts from remote CPUs, e.g. for XDP
+ * redirected or forwarded traffic.
+ *
+ * Called from the allocation side, which is the only lockless consumer of
+ * the ring; ptr_ring_resize() takes both ring locks against the producers.
+ */
+static void page_pool_ring_resize_check(struct page_pool *pool)
+{
+	u64 ring_full = 0;
+	int cpu, size;
+
+	if (time_before(jiffies, pool->ring_resize_next))
+		return;
+	pool->ring_resize_next = jiffies + PP_RING_RESIZE_INTERVAL;
+
+	for_each_possible_cpu(cpu)
+		ring_full += per_cpu_ptr(pool->recycle_stats, cpu)->ring_full;
+
+	size = pool->ring.size;
+	if (ring_full - pool->ring_full_last > size / 4 &&
+	    size < pool->ring_size_max)
+		ptr_ring_resize(&pool->ring, min_t(int, size * 2,
+						   pool->ring_size_max),
+				GFP_ATOMIC | __GFP_NOWARN, NULL);
+
+	pool->ring_full_last = ring_full;
+}
 #else
 #define alloc_stat_inc(pool, __stat)
 #define recycle_stat_inc(pool, __stat)
 #define recycle_stat_add(pool, __stat, val)
+
+static void page_pool_ring_resize_check(struct page_pool *pool)
+{
+}
 #endif
 
 static int page_pool_init(struct page_pool *pool,
@@ -147,8 +187,7 @@ static int page_pool_init(struct page_pool *pool,
 	if (pool->p.pool_size)
 		ring_qsize = pool->p.pool_size;
 
-	/* Sanity limit mem that can be pinned down */
-	if (ring_qsize > 32768)
+	if (ring_qsize > PP_RING_SIZE_MAX)
 		return -E2BIG;
 
 	/* DMA direction is either DMA_FROM_DEVICE or DMA_BIDIRECTIONAL.
@@ -184,6 +223,10 @@ static int page_pool_init(struct page_pool *pool,
 	pool->recycle_stats = alloc_percpu(struct page_pool_recycle_stats);
 	if (!pool->recycle_stats)
 		return -ENOMEM;
+
+	pool->ring_resize_next = jiffies + PP_RING_RESIZE_INTERVAL;
+	pool->ring_size_max = min(ring_qsize * PP_RING_RESIZE_FACTOR,
+				  PP_RING_SIZE_MAX);
 #endif
 
 	if (ptr_ring_init(&pool->ring, ring_qsize, GFP_KERNEL) < 0)
@@ -438,6 +481,7 @@ struct page *page_pool_alloc_pages(struct page_pool *pool, gfp_t gfp)
 		return page;
 
 	/* Slow-path: cache empty, do real allocation */
+	page_pool_ring_resize_check(pool);
 	page = __page_pool_alloc_pages_slow(pool, gfp);
 	return page;
 }
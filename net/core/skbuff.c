@@ -135,6 +135,10 @@ static void skb_under_panic(struct sk_buff *skb, unsigned int sz, void *addr)
 #define NAPI_SKB_CACHE_BULK	16
 #define NAPI_SKB_CACHE_HALF	(NAPI_SKB_CACHE_SIZE / 2)
 
+#define NAPI_EXT_CACHE_SIZE	32
+#define NAPI_EXT_CACHE_BULK	8
+#define NAPI_EXT_CACHE_HALF	(NAPI_EXT_CACHE_SIZE / 2)
+
 #if PAGE_SIZE == SZ_4K
 
 #define NAPI_HAS_SMALL_PAGE_FRAG	1
@@ -197,6 +201,10 @@ struct napi_alloc_cache {
 	struct page_frag_1k page_small;
 	unsigned int skb_count;
 	void *skb_cache[NAPI_SKB_CACHE_SIZE];
+#ifdef CONFIG_SKB_EXTENSIONS
+	unsigned int ext_count;
+	void *ext_cache[NAPI_EXT_CACHE_SIZE];
+#endif
 };
 
 static DEFINE_PER_CPU(struct page_frag_cache, netdev_alloc_cache);
@@ -250,6 +258,14 @@ void *__netdev_alloc_frag_align(unsigned int fragsz, unsigned int align_mask)
 }
 EXPORT_SYMBOL(__netdev_alloc_frag_align);
 
+/* The per-CPU NAPI caches may be used from softirq context, and from task
+ * context with BH disabled, but not from hard interrupts nesting in either.
+ */
+static bool napi_cache_usable(void)
+{
+	return in_softirq() && !in_hardirq() && !in_nmi();
+}
+
 static struct sk_buff *napi_skb_cache_get(void)
 {
 	struct napi_alloc_cache *nc = this_cpu_ptr(&napi_alloc_cache);
@@ -544,11 +560,15 @@ struct sk_buff *__alloc_skb(unsigned int size, gfp_t gfp_mask,
 	if (sk_memalloc_socks() && (flags & SKB_ALLOC_RX))
 		gfp_mask |= __GFP_MEMALLOC;
 
-	/* Get the HEAD */
-	if ((flags & (SKB_ALLOC_FCLONE | SKB_ALLOC_NAPI)) == SKB_ALLOC_NAPI &&
+	/* Get the HEAD. Allocations from BH context, e.g. on the forwarding
+	 * and Tx completion paths, use the NAPI cache like NAPI Rx does.
+	 */
+	skb = NULL;
+	if (!(flags & SKB_ALLOC_FCLONE) &&
+	    ((flags & SKB_ALLOC_NAPI) || napi_cache_usable()) &&
 	    likely(node == NUMA_NO_NODE || node == numa_mem_id()))
 		skb = napi_skb_cache_get();
-	else
+	if (!skb)
 		skb = kmem_cache_alloc_node(cache, gfp_mask & ~GFP_DMA, node);
 	if (unlikely(!skb))
 		return NULL;
@@ -862,6 +882,8 @@ exit:
 	skb->pp_recycle = 0;
 }
 
+static void napi_skb_cache_put(struct sk_buff *skb);
+
 /*
  *	Free an skbuff by memory without cleaning the state.
  */
@@ -871,7 +893,10 @@ static void kfree_skbmem(struct sk_buff *skb)
 
 	switch (skb->fclone) {
 	case SKB_FCLONE_UNAVAILABLE:
-		kmem_cache_free(skbuff_head_cache, skb);
+		if (napi_cache_usable())
+			napi_skb_cache_put(skb);
+		else
+			kmem_cache_free(skbuff_head_cache, skb);
 		return;
 
 	case SKB_FCLONE_ORIG:
@@ -6511,6 +6536,63 @@ static void *skb_ext_get_ptr(struct skb_ext *ext, enum skb_ext_id id)
 	return (void *)ext + (ext->offset[id] * SKB_EXT_ALIGN_VALUE);
 }
 
+static struct skb_ext *napi_skb_ext_cache_get(struct napi_alloc_cache *nc)
+{
+	struct skb_ext *ext;
+
+	if (unlikely(!nc->ext_count)) {
+		nc->ext_count = kmem_cache_alloc_bulk(skbuff_ext_cache,
+						      GFP_ATOMIC,
+						      NAPI_EXT_CACHE_BULK,
+						      nc->ext_cache);
+		if (unlikely(!nc->ext_count))
+			return NULL;
+	}
+
+	ext = nc->ext_cache[--nc->ext_count];
+	kasan_unpoison_object_data(skbuff_ext_cache, ext);
+
+	return ext;
+}
+
+static struct skb_ext *skb_ext_cache_alloc(gfp_t flags)
+{
+	struct skb_ext *ext;
+
+	if (napi_cache_usable()) {
+		ext = napi_skb_ext_cache_get(this_cpu_ptr(&napi_alloc_cache));
+		if (likely(ext))
+			return ext;
+	}
+
+	return kmem_cache_alloc(skbuff_ext_cache, flags);
+}
+
+static void skb_ext_cache_free(struct skb_ext *ext)
+{
+	struct napi_alloc_cache *nc;
+	u32 i;
+
+	if (!napi_cache_usable()) {
+		kmem_cache_free(skbuff_ext_cache, ext);
+		return;
+	}
+
+	nc = this_cpu_ptr(&napi_alloc_cache);
+	kasan_poison_object_data(skbuff_ext_cache, ext);
+	nc->ext_cache[nc->ext_count++] = ext;
+
+	if (unlikely(nc->ext_count == NAPI_EXT_CACHE_SIZE)) {
+		for (i = NAPI_EXT_CACHE_HALF; i < NAPI_EXT_CACHE_SIZE; i++)
+			kasan_unpoison_object_data(skbuff_ext_cache,
+						   nc->ext_cache[i]);
+
+		kmem_cache_free_bulk(skbuff_ext_cache, NAPI_EXT_CACHE_HALF,
+				     nc->ext_cache + NAPI_EXT_CACHE_HALF);
+		nc->ext_count = NAPI_EXT_CACHE_HALF;
+	}
+}
+
 /**
  * __skb_ext_alloc - allocate a new skb extensions storage
  *
@@ -6522,7 +6604,7 @@ static void *skb_ext_get_ptr(struct skb_ext *ext, enum skb_ext_id id)
  */
 struct skb_ext *__skb_ext_alloc(gfp_t flags)
 {
-	struct skb_ext *new = kmem_cache_alloc(skbuff_ext_cache, flags);
+	struct skb_ext *new = skb_ext_cache_alloc(flags);
 
 	if (new) {
 		memset(new->offset, 0, sizeof(new->offset));
@@ -6540,7 +6622,7 @@ static struct skb_ext *skb_ext_maybe_cow(struct skb_ext *old,
 	if (refcount_read(&old->refcnt) == 1)
 		return old;
 
-	new = kmem_cache_alloc(skbuff_ext_cache, GFP_ATOMIC);
+	new = skb_ext_cache_alloc(GFP_ATOMIC);
 	if (!new)
 		return NULL;
 
@@ -6691,7 +6773,7 @@ free_now:
 		skb_ext_put_mctp(skb_ext_get_ptr(ext, SKB_EXT_MCTP));
 #endif
 
-	kmem_cache_free(skbuff_ext_cache, ext);
+	skb_ext_cache_free(ext);
 }
 EXPORT_SYMBOL(__skb_ext_put);
 #endif /* CONFIG_SKB_EXTENSIONS */
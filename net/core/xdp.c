@@ -515,7 +515,9 @@ void xdp_return_buff(struct xdp_buff *xdp)
 	struct skb_shared_info *sinfo;
 	int i;
 
-	if (likely(!xdp_buff_has_frags(xdp)))
+	/* xsk_buff_free() releases the frags of a zero-copy buffer too */
+	if (likely(!xdp_buff_has_frags(xdp)) ||
+	    xdp->rxq->mem.type == MEM_TYPE_XSK_BUFF_POOL)
 		goto out;
 
 	sinfo = xdp_get_shared_info_from_buff(xdp);
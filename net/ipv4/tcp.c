@@ -1926,9 +1926,13 @@ static skb_frag_t *skb_advance_to_frag(struct sk_buff *skb, u32 offset_skb,
 	return frag;
 }
 
+/* Frags backed by high order pages, e.g. page_pool buffers of a header
+ * split NIC, are mapped page by page.
+ */
 static bool can_map_frag(const skb_frag_t *frag)
 {
-	return skb_frag_size(frag) == PAGE_SIZE && !skb_frag_off(frag);
+	return skb_frag_size(frag) && PAGE_ALIGNED(skb_frag_size(frag)) &&
+	       PAGE_ALIGNED(skb_frag_off(frag));
 }
 
 static int find_next_mappable_frag(const skb_frag_t *frag,
@@ -1962,7 +1966,7 @@ static void tcp_zerocopy_set_hint_for_skb(struct sock *sk,
 	if (!frag)
 		return;
 
-	if (frag_offset) {
+	if (frag_offset && !(can_map_frag(frag) && PAGE_ALIGNED(frag_offset))) {
 		struct skb_shared_info *info = skb_shinfo(skb);
 
 		/* We read part of the last frag, must recvmsg() rest of skb. */
@@ -2197,6 +2201,7 @@ static int tcp_zerocopy_receive(struct sock *sk,
 	struct vm_area_struct *vma;
 	struct sk_buff *skb = NULL;
 	u32 seq = tp->copied_seq;
+	u32 frag_off = 0;
 	u32 total_bytes_to_map;
 	int inq = tcp_inq(sk);
 	int ret;
@@ -2265,22 +2270,31 @@ static int tcp_zerocopy_receive(struct sock *sk,
 			}
 			zc->recv_skip_hint = skb->len - offset;
 			frags = skb_advance_to_frag(skb, offset, &offset_frag);
-			if (!frags || offset_frag)
+			if (!frags || !PAGE_ALIGNED(offset_frag) ||
+			    (offset_frag && !can_map_frag(frags)))
 				break;
+			frag_off = offset_frag;
 		}
 
-		mappable_offset = find_next_mappable_frag(frags,
-							  zc->recv_skip_hint);
-		if (mappable_offset) {
-			zc->recv_skip_hint = mappable_offset;
-			break;
+		if (!frag_off) {
+			mappable_offset = find_next_mappable_frag(frags,
+								  zc->recv_skip_hint);
+			if (mappable_offset) {
+				zc->recv_skip_hint = mappable_offset;
+				break;
+			}
 		}
-		page = skb_frag_page(frags);
+		page = nth_page(skb_frag_page(frags),
+				(skb_frag_off(frags) + frag_off) >> PAGE_SHIFT);
 		prefetchw(page);
 		pages[pages_to_map++] = page;
 		length += PAGE_SIZE;
 		zc->recv_skip_hint -= PAGE_SIZE;
-		frags++;
+		frag_off += PAGE_SIZE;
+		if (frag_off == skb_frag_size(frags)) {
+			frag_off = 0;
+			frags++;
+		}
 		if (pages_to_map == TCP_ZEROCOPY_PAGE_BATCH_SIZE ||
 		    zc->recv_skip_hint < PAGE_SIZE) {
 			/* Either full batch, or we're about to go to next skb
@@ -2413,6 +2427,76 @@ static int tcp_inq_hint(struct sock *sk)
 	return inq;
 }
 
+#ifdef CONFIG_MMU
+/*
+ * TCP_ZEROCOPY_RECEIVE on @zc, which has been copied from userspace.  Only
+ * the fields within the first *@lenp bytes are filled in, as older users pass
+ * a shorter struct.  With @run_bpf, the BPF getsockopt hook is run and may
+ * update *@lenp.
+ */
+static int __tcp_zerocopy_receive(struct sock *sk,
+				  struct tcp_zerocopy_receive *zc,
+				  int *lenp, bool run_bpf)
+{
+	struct scm_timestamping_internal tss;
+	int err;
+
+	if (zc->reserved)
+		return -EINVAL;
+	if (zc->msg_flags & ~(TCP_VALID_ZC_MSG_FLAGS))
+		return -EINVAL;
+	sockopt_lock_sock(sk);
+	err = tcp_zerocopy_receive(sk, zc, &tss);
+	if (run_bpf)
+		err = BPF_CGROUP_RUN_PROG_GETSOCKOPT_KERN(sk, SOL_TCP,
+							  TCP_ZEROCOPY_RECEIVE,
+							  zc, lenp, err);
+	sockopt_release_sock(sk);
+	if (*lenp >= offsetofend(struct tcp_zerocopy_receive, msg_flags))
+		goto zerocopy_rcv_cmsg;
+	switch (*lenp) {
+	case offsetofend(struct tcp_zerocopy_receive, msg_flags):
+		goto zerocopy_rcv_cmsg;
+	case offsetofend(struct tcp_zerocopy_receive, msg_controllen):
+	case offsetofend(struct tcp_zerocopy_receive, msg_control):
+	case offsetofend(struct tcp_zerocopy_receive, flags):
+	case offsetofend(struct tcp_zerocopy_receive, copybuf_len):
+	case offsetofend(struct tcp_zerocopy_receive, copybuf_address):
+	case offsetofend(struct tcp_zerocopy_receive, err):
+		goto zerocopy_rcv_sk_err;
+	case offsetofend(struct tcp_zerocopy_receive, inq):
+		goto zerocopy_rcv_inq;
+	case offsetofend(struct tcp_zerocopy_receive, length):
+	default:
+		return err;
+	}
+zerocopy_rcv_cmsg:
+	if (zc->msg_flags & TCP_CMSG_TS)
+		tcp_zc_finalize_rx_tstamp(sk, zc, &tss);
+	else
+		zc->msg_flags = 0;
+zerocopy_rcv_sk_err:
+	if (!err)
+		zc->err = sock_error(sk);
+zerocopy_rcv_inq:
+	zc->inq = tcp_inq_hint(sk);
+	return err;
+}
+
+/*
+ * TCP_ZEROCOPY_RECEIVE for in-kernel callers (io_uring), i.e. without the
+ * sockopt length negotiation and the BPF getsockopt hook.  @zc has already
+ * been copied from userspace and is copied back by the caller.
+ */
+int tcp_zerocopy_receive_kern(struct sock *sk, struct tcp_zerocopy_receive *zc)
+{
+	int len = sizeof(*zc);
+
+	return __tcp_zerocopy_receive(sk, zc, &len, false);
+}
+EXPORT_SYMBOL_GPL(tcp_zerocopy_receive_kern);
+#endif
+
 /*
  *	This routine copies from a sock struct into the user buffer.
  *
@@ -2628,6 +2712,15 @@ skip_copy:
 		if (used + offset < skb->len)
 			continue;
 
+		if (unlikely(tp->lat_hist) && skb->tstamp &&
+		    !(flags & MSG_PEEK)) {
+			s64 dwell = ktime_us_delta(ktime_get_real(), skb->tstamp);
+
+			if (dwell >= 0)
+				tcp_latency_hist_add(tp->lat_hist->tcpl_rcvq_dwell,
+						     dwell);
+		}
+
 		if (TCP_SKB_CB(skb)->tcp_flags & TCPHDR_FIN)
 			goto found_fin_ok;
 		if (!(flags & MSG_PEEK))
@@ -3784,6 +3877,21 @@ int do_tcp_setsockopt(struct sock *sk, int level, int optname,
 			tcp_enable_tx_delay();
 		tp->tcp_tx_delay = val;
 		break;
+	case TCP_LATENCY_HIST:
+		if (!val) {
+			kfree(tp->lat_hist);
+			tp->lat_hist = NULL;
+		} else if (!tp->lat_hist) {
+			tp->lat_hist = kzalloc(sizeof(*tp->lat_hist),
+					       GFP_KERNEL);
+			if (!tp->lat_hist) {
+				err = -ENOMEM;
+				break;
+			}
+			/* Receive queue dwell time needs skb->tstamp */
+			sock_enable_timestamp(sk, SOCK_TIMESTAMP);
+		}
+		break;
 	default:
 		err = -ENOPROTOOPT;
 		break;
@@ -4276,6 +4384,27 @@ int do_tcp_getsockopt(struct sock *sk, int level,
 	case TCP_SAVE_SYN:
 		val = tp->save_syn;
 		break;
+	case TCP_LATENCY_HIST: {
+		struct tcp_latency_hist hist;
+
+		if (copy_from_sockptr(&len, optlen, sizeof(int)))
+			return -EFAULT;
+
+		sockopt_lock_sock(sk);
+		if (tp->lat_hist) {
+			hist = *tp->lat_hist;
+			len = min_t(unsigned int, len, sizeof(hist));
+		} else {
+			len = 0;
+		}
+		sockopt_release_sock(sk);
+
+		if (copy_to_sockptr(optlen, &len, sizeof(int)))
+			return -EFAULT;
+		if (copy_to_sockptr(optval, &hist, len))
+			return -EFAULT;
+		return 0;
+	}
 	case TCP_SAVED_SYN: {
 		if (copy_from_sockptr(&len, optlen, sizeof(int)))
 			return -EFAULT;
@@ -4312,7 +4441,6 @@ int do_tcp_getsockopt(struct sock *sk, int level,
 	}
 #ifdef CONFIG_MMU
 	case TCP_ZEROCOPY_RECEIVE: {
-		struct scm_timestamping_internal tss;
 		struct tcp_zerocopy_receive zc = {};
 		int err;
 
@@ -4332,44 +4460,7 @@ int do_tcp_getsockopt(struct sock *sk, int level,
 		}
 		if (copy_from_sockptr(&zc, optval, len))
 			return -EFAULT;
-		if (zc.reserved)
-			return -EINVAL;
-		if (zc.msg_flags &  ~(TCP_VALID_ZC_MSG_FLAGS))
-			return -EINVAL;
-		sockopt_lock_sock(sk);
-		err = tcp_zerocopy_receive(sk, &zc, &tss);
-		err = BPF_CGROUP_RUN_PROG_GETSOCKOPT_KERN(sk, level, optname,
-							  &zc, &len, err);
-		sockopt_release_sock(sk);
-		if (len >= offsetofend(struct tcp_zerocopy_receive, msg_flags))
-			goto zerocopy_rcv_cmsg;
-		switch (len) {
-		case offsetofend(struct tcp_zerocopy_receive, msg_flags):
-			goto zerocopy_rcv_cmsg;
-		case offsetofend(struct tcp_zerocopy_receive, msg_controllen):
-		case offsetofend(struct tcp_zerocopy_receive, msg_control):
-		case offsetofend(struct tcp_zerocopy_receive, flags):
-		case offsetofend(struct tcp_zerocopy_receive, copybuf_len):
-		case offsetofend(struct tcp_zerocopy_receive, copybuf_address):
-		case offsetofend(struct tcp_zerocopy_receive, err):
-			goto zerocopy_rcv_sk_err;
-		case offsetofend(struct tcp_zerocopy_receive, inq):
-			goto zerocopy_rcv_inq;
-		case offsetofend(struct tcp_zerocopy_receive, length):
-		default:
-			goto zerocopy_rcv_out;
-		}
-zerocopy_rcv_cmsg:
-		if (zc.msg_flags & TCP_CMSG_TS)
-			tcp_zc_finalize_rx_tstamp(sk, &zc, &tss);
-		else
-			zc.msg_flags = 0;
-zerocopy_rcv_sk_err:
-		if (!err)
-			zc.err = sock_error(sk);
-zerocopy_rcv_inq:
-		zc.inq = tcp_inq_hint(sk);
-zerocopy_rcv_out:
+		err = __tcp_zerocopy_receive(sk, &zc, &len, true);
 		if (!err && copy_to_sockptr(optval, &zc, len))
 			err = -EFAULT;
 		return err;
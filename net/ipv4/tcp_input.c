@@ -831,6 +831,9 @@ static void tcp_rtt_estimator(struct sock *sk, long mrtt_us)
 	long m = mrtt_us; /* RTT */
 	u32 srtt = tp->srtt_us;
 
+	if (unlikely(tp->lat_hist))
+		tcp_latency_hist_add(tp->lat_hist->tcpl_rtt, mrtt_us);
+
 	/*	The following amusing code comes from Jacobson's
 	 *	article in SIGCOMM '88.  Note that rtt and mdev
 	 *	are scaled versions of rtt and mean deviation.
@@ -5519,17 +5522,8 @@ static void __tcp_ack_snd_check(struct sock *sk, int ofo_possible)
 	struct tcp_sock *tp = tcp_sk(sk);
 	unsigned long rtt, delay;
 
-	    /* More than one full frame received... */
-	if (((tp->rcv_nxt - tp->rcv_wup) > inet_csk(sk)->icsk_ack.rcv_mss &&
-	     /* ... and right edge of window advances far enough.
-	      * (tcp_recvmsg() will send ACK otherwise).
-	      * If application uses SO_RCVLOWAT, we want send ack now if
-	      * we have not received enough bytes to satisfy the condition.
-	      */
-	    (tp->rcv_nxt - tp->copied_seq < sk->sk_rcvlowat ||
-	     __tcp_select_window(sk) >= tp->rcv_wnd)) ||
-	    /* We ACK each frame or... */
-	    tcp_in_quickack_mode(sk) ||
+	/* We ACK each frame or... */
+	if (tcp_in_quickack_mode(sk) ||
 	    /* Protocol state mandates a one-time immediate ACK */
 	    inet_csk(sk)->icsk_ack.pending & ICSK_ACK_NOW) {
 send_now:
@@ -5537,6 +5531,21 @@ send_now:
 		return;
 	}
 
+	/* More than one full frame received... */
+	if ((tp->rcv_nxt - tp->rcv_wup) > inet_csk(sk)->icsk_ack.rcv_mss &&
+	    /* ... and right edge of window advances far enough.
+	     * (tcp_recvmsg() will send ACK otherwise).
+	     * If application uses SO_RCVLOWAT, we want send ack now if
+	     * we have not received enough bytes to satisfy the condition.
+	     */
+	    (tp->rcv_nxt - tp->copied_seq < sk->sk_rcvlowat ||
+	     __tcp_select_window(sk) >= tp->rcv_wnd)) {
+		/* ... one ACK covers what arrives in this softirq run. */
+		if (!tcp_ack_defer(sk))
+			goto send_now;
+		return;
+	}
+
 	if (!ofo_possible || RB_EMPTY_ROOT(&tp->out_of_order_queue)) {
 		tcp_send_delayed_ack(sk);
 		return;
@@ -2316,6 +2316,9 @@ void tcp_v4_destroy_sock(struct sock *sk)
 	}
 #endif
 
+	kfree(tp->lat_hist);
+	tp->lat_hist = NULL;
+
 	/* Clean up a referenced TCP bind bucket. */
 	if (inet_csk(sk)->icsk_bind_hash)
 		inet_put_port(sk);
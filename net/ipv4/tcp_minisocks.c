@@ -578,6 +578,9 @@ struct sock *tcp_create_openreq_child(const struct sock *sk,
 	tcp_ecn_openreq_child(newtp, req);
 	newtp->fastopen_req = NULL;
 	RCU_INIT_POINTER(newtp->fastopen_rsk, NULL);
+	/* Children of a listener with TCP_LATENCY_HIST get their own */
+	if (newtp->lat_hist)
+		newtp->lat_hist = kzalloc(sizeof(*newtp->lat_hist), GFP_ATOMIC);
 
 	newtp->bpf_chg_cc_inprogress = 0;
 	tcp_bpf_clone(sk, newsk);
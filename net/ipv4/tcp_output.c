@@ -1023,12 +1023,25 @@ static void tcp_tsq_write(struct sock *sk)
 	}
 }
 
+/* Send the ACK postponed by tcp_ack_defer(), unless data sent meanwhile
+ * already carried it.
+ */
+static void tcp_tsq_ack(struct sock *sk)
+{
+	struct tcp_sock *tp = tcp_sk(sk);
+
+	if (test_and_clear_bit(TCP_ACK_BATCHED, &sk->sk_tsq_flags) &&
+	    tp->rcv_nxt != tp->rcv_wup)
+		tcp_send_ack(sk);
+}
+
 static void tcp_tsq_handler(struct sock *sk)
 {
 	bh_lock_sock(sk);
-	if (!sock_owned_by_user(sk))
+	if (!sock_owned_by_user(sk)) {
 		tcp_tsq_write(sk);
-	else if (!test_and_set_bit(TCP_TSQ_DEFERRED, &sk->sk_tsq_flags))
+		tcp_tsq_ack(sk);
+	} else if (!test_and_set_bit(TCP_TSQ_DEFERRED, &sk->sk_tsq_flags))
 		sock_hold(sk);
 	bh_unlock_sock(sk);
 }
@@ -1064,6 +1077,50 @@ static void tcp_tasklet_func(struct tasklet_struct *t)
 	}
 }
 
+/**
+ * tcp_ack_defer - postpone an ACK to the end of the softirq receive batch
+ * @sk: socket, locked by the caller
+ *
+ * The ACK owed for the segments of a flow received in one run of the
+ * network softirq is sent once from the TSQ tasklet, which runs right
+ * after it, instead of once every two full sized segments.
+ *
+ * Returns false if the caller has to send the ACK itself.
+ */
+bool tcp_ack_defer(struct sock *sk)
+{
+	struct tcp_sock *tp = tcp_sk(sk);
+	unsigned long flags, nval, oval;
+	struct tsq_tasklet *tsq;
+	bool empty;
+
+	if (!in_serving_softirq() || sock_owned_by_user(sk))
+		return false;
+
+	oval = smp_load_acquire(&sk->sk_tsq_flags);
+	do {
+		if (oval & TCPF_ACK_BATCHED)
+			return true;
+		nval = oval | TCPF_ACK_BATCHED | TSQF_QUEUED;
+	} while (!try_cmpxchg(&sk->sk_tsq_flags, &oval, nval));
+
+	/* The socket is on the tasklet queue already */
+	if (oval & TSQF_QUEUED)
+		return true;
+
+	/* Released by sk_free() in tcp_tasklet_func(), like for tcp_wfree() */
+	refcount_inc(&sk->sk_wmem_alloc);
+
+	local_irq_save(flags);
+	tsq = this_cpu_ptr(&tsq_tasklet);
+	empty = list_empty(&tsq->head);
+	list_add(&tp->tsq_node, &tsq->head);
+	if (empty)
+		tasklet_schedule(&tsq->tasklet);
+	local_irq_restore(flags);
+	return true;
+}
+
 #define TCP_DEFERRED_ALL (TCPF_TSQ_DEFERRED |		\
 			  TCPF_WRITE_TIMER_DEFERRED |	\
 			  TCPF_DELACK_TIMER_DEFERRED |	\
@@ -1089,6 +1146,7 @@ void tcp_release_cb(struct sock *sk)
 
 	if (flags & TCPF_TSQ_DEFERRED) {
 		tcp_tsq_write(sk);
+		tcp_tsq_ack(sk);
 		__sock_put(sk);
 	}
 	/* Here begins the tricky part :
@@ -2549,6 +2607,10 @@ static void tcp_chrono_set(struct tcp_sock *tp, const enum tcp_chrono new)
 
 	if (old > TCP_CHRONO_UNSPEC)
 		tp->chrono_stat[old - 1] += now - tp->chrono_start;
+	else if (unlikely(tp->lat_hist) && tp->chrono_start)
+		/* Everything was sent and acked: the application kept us idle */
+		tcp_latency_hist_add(tp->lat_hist->tcpl_app_limited,
+				     jiffies_to_usecs(now - tp->chrono_start));
 	tp->chrono_start = now;
 	tp->chrono_type = new;
 }
@@ -1864,6 +1864,7 @@ try_again:
 	if (!skb)
 		return err;
 
+	sock_rps_record_flow_skb(sk, skb);
 	ulen = udp_skb_len(skb);
 	copied = len;
 	if (copied > ulen - off)
@@ -69,6 +69,7 @@ struct conntrack_gc_work {
 	u32			avg_timeout;
 	u32			count;
 	u32			start_time;
+	u32			entries;
 	bool			exiting;
 	bool			early_drop;
 };
@@ -96,6 +97,10 @@ static DEFINE_MUTEX(nf_conntrack_mutex);
 #define GC_SCAN_MAX_DURATION	msecs_to_jiffies(10)
 #define GC_SCAN_EXPIRED_MAX	(64000u / HZ)
 
+/* average tuple hashes per bucket that make gc double the table */
+#define GC_GROW_CHAIN_LEN	8u
+#define GC_GROW_MAX_SIZE	(1u << 24)
+
 #define MIN_CHAINLEN	50u
 #define MAX_CHAINLEN	(80u - MIN_CHAINLEN)
 
@@ -204,6 +209,7 @@ EXPORT_SYMBOL_GPL(nf_conntrack_htable_size);
 
 unsigned int nf_conntrack_max __read_mostly;
 EXPORT_SYMBOL_GPL(nf_conntrack_max);
+u8 nf_conntrack_hash_autogrow __read_mostly;
 seqcount_spinlock_t nf_conntrack_generation __read_mostly;
 static siphash_aligned_key_t nf_conntrack_hash_rnd;
 
@@ -1461,12 +1467,30 @@ static bool gc_worker_can_early_drop(const struct nf_conn *ct)
 	return false;
 }
 
+/* Grow the table once a full gc cycle has seen long average chains.
+ * Each conntrack is linked twice, so @entries counts tuple hashes.
+ */
+static bool gc_should_grow_hash(unsigned int entries, unsigned int hashsz)
+{
+	unsigned int max = READ_ONCE(nf_conntrack_max);
+
+	if (entries / GC_GROW_CHAIN_LEN <= hashsz)
+		return false;
+
+	/* no point in more buckets than conntracks can ever exist */
+	if (hashsz >= GC_GROW_MAX_SIZE || (max && hashsz >= max))
+		return false;
+
+	return true;
+}
+
 static void gc_worker(struct work_struct *work)
 {
 	unsigned int i, hashsz, nf_conntrack_max95 = 0;
 	u32 end_time, start_time = nfct_time_stamp;
 	struct conntrack_gc_work *gc_work;
 	unsigned int expired_count = 0;
+	unsigned int grow_hashsz = 0;
 	unsigned long next_run;
 	s32 delta_time;
 	long count;
@@ -1481,6 +1505,7 @@ static void gc_worker(struct work_struct *work)
 		gc_work->avg_timeout = GC_SCAN_INTERVAL_INIT;
 		gc_work->count = GC_SCAN_INITIAL_COUNT;
 		gc_work->start_time = start_time;
+		gc_work->entries = 0;
 	}
 
 	next_run = gc_work->avg_timeout;
@@ -1492,6 +1517,7 @@ static void gc_worker(struct work_struct *work)
 		struct nf_conntrack_tuple_hash *h;
 		struct hlist_nulls_head *ct_hash;
 		struct hlist_nulls_node *n;
+		unsigned int entries = 0;
 		struct nf_conn *tmp;
 
 		rcu_read_lock();
@@ -1508,6 +1534,7 @@ static void gc_worker(struct work_struct *work)
 			long expires;
 
 			tmp = nf_ct_tuplehash_to_ctrack(h);
+			entries++;
 
 			if (test_bit(IPS_OFFLOAD_BIT, &tmp->status)) {
 				nf_ct_offload_timeout(tmp);
@@ -1574,6 +1601,9 @@ static void gc_worker(struct work_struct *work)
 		cond_resched();
 		i++;
 
+		/* an early exit above rescans the bucket, count it once done */
+		gc_work->entries += entries;
+
 		delta_time = nfct_time_stamp - end_time;
 		if (delta_time > 0 && i < hashsz) {
 			gc_work->avg_timeout = next_run;
@@ -1586,6 +1616,10 @@ static void gc_worker(struct work_struct *work)
 
 	gc_work->next_bucket = 0;
 
+	if (READ_ONCE(nf_conntrack_hash_autogrow) &&
+	    gc_should_grow_hash(gc_work->entries, hashsz))
+		grow_hashsz = hashsz;
+
 	next_run = clamp(next_run, GC_SCAN_INTERVAL_MIN, GC_SCAN_INTERVAL_MAX);
 
 	delta_time = max_t(s32, nfct_time_stamp - gc_work->start_time, 1);
@@ -1598,6 +1632,12 @@ early_exit:
 	if (gc_work->exiting)
 		return;
 
+	/* Resize with no rcu read section held, synchronize_net() waits for
+	 * it, and only if nobody changed the size since the scan.
+	 */
+	if (grow_hashsz && READ_ONCE(nf_conntrack_htable_size) == grow_hashsz)
+		nf_conntrack_hash_resize(grow_hashsz * 2);
+
 	if (next_run)
 		gc_work->early_drop = false;
 
@@ -11,6 +11,8 @@
 #include <net/ip.h>
 #include <net/ipv6.h>
 #include <net/ip6_route.h>
+#include <net/route.h>
+#include <net/ndisc.h>
 #include <net/neighbour.h>
 #include <net/netfilter/nf_flow_table.h>
 #include <net/netfilter/nf_conntrack_acct.h>
@@ -336,6 +338,33 @@ static unsigned int nf_flow_queue_xmit(struct net *net, struct sk_buff *skb,
 	return NF_STOLEN;
 }
 
+/* Like ip_finish_output2(), let a connected neighbour prepend its cached
+ * hardware header rather than building it again for every packet.
+ */
+static unsigned int nf_flow_neigh_xmit(struct sk_buff *skb,
+				       struct net_device *outdev,
+				       const void *nexthop, bool ipv6)
+{
+	struct neighbour *neigh;
+
+	if (unlikely(skb_cow_head(skb, LL_RESERVED_SPACE(outdev))))
+		return NF_DROP;
+
+	rcu_read_lock_bh();
+	if (ipv6)
+		neigh = ip_neigh_gw6(outdev, nexthop);
+	else
+		neigh = ip_neigh_gw4(outdev, *(__be32 *)nexthop);
+	if (IS_ERR(neigh)) {
+		rcu_read_unlock_bh();
+		return NF_DROP;
+	}
+	neigh_output(neigh, skb, false);
+	rcu_read_unlock_bh();
+
+	return NF_STOLEN;
+}
+
 unsigned int
 nf_flow_offload_ip_hook(void *priv, struct sk_buff *skb,
 			const struct nf_hook_state *state)
@@ -413,8 +442,7 @@ nf_flow_offload_ip_hook(void *priv, struct sk_buff *skb,
 		skb->dev = outdev;
 		nexthop = rt_nexthop(rt, flow->tuplehash[!dir].tuple.src_v4.s_addr);
 		skb_dst_set_noref(skb, &rt->dst);
-		neigh_xmit(NEIGH_ARP_TABLE, outdev, &nexthop, skb);
-		ret = NF_STOLEN;
+		ret = nf_flow_neigh_xmit(skb, outdev, &nexthop, false);
 		break;
 	case FLOW_OFFLOAD_XMIT_DIRECT:
 		ret = nf_flow_queue_xmit(state->net, skb, tuplehash, ETH_P_IP);
@@ -678,8 +706,7 @@ nf_flow_offload_ipv6_hook(void *priv, struct sk_buff *skb,
 		skb->dev = outdev;
 		nexthop = rt6_nexthop(rt, &flow->tuplehash[!dir].tuple.src_v6);
 		skb_dst_set_noref(skb, &rt->dst);
-		neigh_xmit(NEIGH_ND_TABLE, outdev, nexthop, skb);
-		ret = NF_STOLEN;
+		ret = nf_flow_neigh_xmit(skb, outdev, nexthop, true);
 		break;
 	case FLOW_OFFLOAD_XMIT_DIRECT:
 		ret = nf_flow_queue_xmit(state->net, skb, tuplehash, ETH_P_IPV6);
@@ -14,6 +14,7 @@
 #include <linux/netfilter.h>
 #include <linux/netfilter/nf_tables.h>
 #include <net/netfilter/nf_tables_core.h>
+#include <asm/unaligned.h>
 
 struct nft_rbtree {
 	struct rb_root		root;
@@ -38,12 +39,49 @@ static bool nft_rbtree_interval_start(const struct nft_rbtree_elem *rbe)
 	return !nft_rbtree_interval_end(rbe);
 }
 
+/* Keys sort as big endian byte strings. Each lookup compares the key at
+ * every level of the tree, so avoid the out of line memcmp() for the usual
+ * port, IPv4 and IPv6 key lengths.
+ */
+static __always_inline int nft_rbtree_keycmp(const struct nft_set *set,
+					     const void *k1, const void *k2)
+{
+	u64 a, b;
+
+	switch (set->klen) {
+	case sizeof(u16):
+		a = get_unaligned_be16(k1);
+		b = get_unaligned_be16(k2);
+		break;
+	case sizeof(u32):
+		a = get_unaligned_be32(k1);
+		b = get_unaligned_be32(k2);
+		break;
+	case 2 * sizeof(u64):
+		a = get_unaligned_be64(k1);
+		b = get_unaligned_be64(k2);
+		if (a != b)
+			break;
+		k1 += sizeof(u64);
+		k2 += sizeof(u64);
+		fallthrough;
+	case sizeof(u64):
+		a = get_unaligned_be64(k1);
+		b = get_unaligned_be64(k2);
+		break;
+	default:
+		return memcmp(k1, k2, set->klen);
+	}
+
+	return (a > b) - (a < b);
+}
+
 static int nft_rbtree_cmp(const struct nft_set *set,
 			  const struct nft_rbtree_elem *e1,
 			  const struct nft_rbtree_elem *e2)
 {
-	return memcmp(nft_set_ext_key(&e1->ext), nft_set_ext_key(&e2->ext),
-		      set->klen);
+	return nft_rbtree_keycmp(set, nft_set_ext_key(&e1->ext),
+				 nft_set_ext_key(&e2->ext));
 }
 
 static bool __nft_rbtree_lookup(const struct net *net, const struct nft_set *set,
@@ -63,7 +101,7 @@ static bool __nft_rbtree_lookup(const struct net *net, const struct nft_set *set
 
 		rbe = rb_entry(parent, struct nft_rbtree_elem, node);
 
-		d = memcmp(nft_set_ext_key(&rbe->ext), key, set->klen);
+		d = nft_rbtree_keycmp(set, nft_set_ext_key(&rbe->ext), key);
 		if (d < 0) {
 			parent = rcu_dereference_raw(parent->rb_left);
 			if (interval &&
@@ -145,7 +183,7 @@ static bool __nft_rbtree_get(const struct net *net, const struct nft_set *set,
 		rbe = rb_entry(parent, struct nft_rbtree_elem, node);
 
 		this = nft_set_ext_key(&rbe->ext);
-		d = memcmp(this, key, set->klen);
+		d = nft_rbtree_keycmp(set, this, key);
 		if (d < 0) {
 			parent = rcu_dereference_raw(parent->rb_left);
 			if (!(flags & NFT_SET_ELEM_INTERVAL_END))
@@ -497,8 +535,8 @@ static void *nft_rbtree_deactivate(const struct net *net,
 	while (parent != NULL) {
 		rbe = rb_entry(parent, struct nft_rbtree_elem, node);
 
-		d = memcmp(nft_set_ext_key(&rbe->ext), &elem->key.val,
-					   set->klen);
+		d = nft_rbtree_keycmp(set, nft_set_ext_key(&rbe->ext),
+				      &elem->key.val);
 		if (d < 0)
 			parent = parent->rb_left;
 		else if (d > 0)
@@ -1615,7 +1615,14 @@ tls_decrypt_sw(struct sock *sk, struct tls_context *tls_ctx,
 			TLS_INC_STATS(sock_net(sk), LINUX_MIB_TLSDECRYPTERROR);
 		return err;
 	}
-	/* keep going even for ->async, the code below is TLS 1.3 */
+	/* The content type and padding of a TLS 1.3 record decrypted
+	 * asynchronously are only known once the decryption completed,
+	 * tls_rx_list_fixup_async() resolves them.
+	 */
+	if (darg->async && prot->version == TLS_1_3_VERSION) {
+		tls_msg(darg->skb)->control = 0;
+		return 0;
+	}
 
 	/* If opportunistic TLS 1.3 ZC failed retry without ZC */
 	if (unlikely(darg->zc && prot->version == TLS_1_3_VERSION &&
@@ -1742,6 +1749,41 @@ static int tls_record_content_type(struct msghdr *msg, struct tls_msg *tlm,
 	return 1;
 }
 
+/* Strip the padding and read the content type of the TLS 1.3 records on
+ * rx_list which were decrypted asynchronously. Must be called after all
+ * pending decryptions completed.
+ */
+static int tls_rx_list_fixup_async(struct tls_sw_context_rx *ctx)
+{
+	struct sk_buff *skb;
+
+	skb_queue_walk(&ctx->rx_list, skb) {
+		struct strp_msg *rxm = strp_msg(skb);
+		struct tls_msg *tlm = tls_msg(skb);
+		char content_type;
+		int err;
+
+		if (tlm->control)
+			continue;
+
+		/* The content type follows the data, zero padding follows it */
+		for (;;) {
+			err = skb_copy_bits(skb, rxm->offset + rxm->full_len,
+					    &content_type, 1);
+			if (err)
+				return err;
+			if (content_type)
+				break;
+			if (!rxm->full_len)
+				return -EBADMSG;
+			rxm->full_len--;
+		}
+		tlm->control = content_type;
+	}
+
+	return 0;
+}
+
 static void tls_rx_rec_done(struct tls_sw_context_rx *ctx)
 {
 	tls_strp_msg_done(&ctx->strp);
@@ -1982,12 +2024,23 @@ int tls_sw_recvmsg(struct sock *sk,
 
 		to_decrypt = rxm->full_len - prot->overhead_size;
 
+		/* TLS 1.3 records decrypted asynchronously are copied from
+		 * rx_list once their type is known, later records must not
+		 * bypass them.
+		 */
 		if (zc_capable && to_decrypt <= len &&
-		    tlm->control == TLS_RECORD_TYPE_DATA)
+		    tlm->control == TLS_RECORD_TYPE_DATA &&
+		    !(async && prot->version == TLS_1_3_VERSION))
 			darg.zc = true;
 
-		/* Do not use async mode if record is non-data */
-		if (tlm->control == TLS_RECORD_TYPE_DATA && !bpf_strp_enabled)
+		/* Do not use async mode if record is non-data. For TLS 1.3
+		 * every record looks like data until decrypted; only use
+		 * async mode when decrypting into an skb, so that a record
+		 * of another type can still be returned by a later call.
+		 */
+		if (tlm->control == TLS_RECORD_TYPE_DATA && !bpf_strp_enabled &&
+		    !(prot->version == TLS_1_3_VERSION &&
+		      (darg.zc || is_peek || is_kvec)))
 			darg.async = ctx->async_capable;
 		else
 			darg.async = false;
@@ -2005,9 +2058,14 @@ int tls_sw_recvmsg(struct sock *sk,
 		 * but does not match the record type just dequeued, go to end.
 		 * We always get record type here since for tls1.2, record type
 		 * is known just after record is dequeued from stream parser.
-		 * For tls1.3, we disable async.
+		 * For tls1.3, once a record went async, the types of this and
+		 * of the following records are checked by process_rx_list().
 		 */
-		err = tls_record_content_type(msg, tls_msg(darg.skb), &control);
+		if (async && prot->version == TLS_1_3_VERSION)
+			err = 1;
+		else
+			err = tls_record_content_type(msg, tls_msg(darg.skb),
+						      &control);
 		if (err <= 0) {
 			DEBUG_NET_WARN_ON_ONCE(darg.zc);
 			tls_rx_rec_done(ctx);
@@ -2033,7 +2091,10 @@ put_on_rx_list_err:
 			DEBUG_NET_WARN_ON_ONCE(darg.skb == ctx->strp.anchor);
 
 			if (async) {
-				/* TLS 1.2-only, to_decrypt must be text len */
+				/* For TLS 1.3 to_decrypt still includes the
+				 * padding, the actual length is only known
+				 * after the fixup.
+				 */
 				chunk = min_t(int, to_decrypt, len);
 				async_copy_bytes += chunk;
 put_on_rx_list:
@@ -2100,6 +2161,12 @@ recv_end:
 			ret = crypto_wait_req(-EINPROGRESS, &ctx->async_wait);
 		__skb_queue_purge(&ctx->async_hold);
 
+		if (!ret && prot->version == TLS_1_3_VERSION) {
+			ret = tls_rx_list_fixup_async(ctx);
+			if (ret)
+				tls_err_abort(sk, -EBADMSG);
+		}
+
 		if (ret) {
 			if (err >= 0 || err == -EINPROGRESS)
 				err = ret;
@@ -2108,13 +2175,16 @@ recv_end:
 		}
 
 		/* Drain records from the rx_list & copy if required */
-		if (is_peek || is_kvec)
+		if (is_peek || is_kvec) {
 			err = process_rx_list(ctx, msg, &control, copied,
 					      decrypted, is_peek);
-		else
+			decrypted += max(err, 0);
+		} else {
 			err = process_rx_list(ctx, msg, &control, 0,
 					      async_copy_bytes, is_peek);
-		decrypted += max(err, 0);
+			/* async_copy_bytes were accounted as decrypted */
+			decrypted += max(err, 0) - async_copy_bytes;
+		}
 	}
 
 	copied += decrypted;
@@ -2747,7 +2817,6 @@ int tls_set_sw_offload(struct sock *sk, struct tls_context *ctx, int tx)
 
 		tls_update_rx_zc_capable(ctx);
 		sw_ctx_rx->async_capable =
-			crypto_info->version != TLS_1_3_VERSION &&
 			!!(tfm->__crt_alg->cra_flags & CRYPTO_ALG_ASYNC);
 
 		rc = tls_strp_init(&sw_ctx_rx->strp, sk);
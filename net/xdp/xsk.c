@@ -134,14 +134,14 @@ int xsk_reg_pool_at_qid(struct net_device *dev, struct xsk_buff_pool *pool,
 	return 0;
 }
 
-static int __xsk_rcv_zc(struct xdp_sock *xs, struct xdp_buff *xdp, u32 len)
+static int __xsk_rcv_zc(struct xdp_sock *xs, struct xdp_buff_xsk *xskb, u32 len,
+			u32 flags)
 {
-	struct xdp_buff_xsk *xskb = container_of(xdp, struct xdp_buff_xsk, xdp);
 	u64 addr;
 	int err;
 
 	addr = xp_get_handle(xskb);
-	err = xskq_prod_reserve_desc(xs->rx, addr, len);
+	err = xskq_prod_reserve_desc(xs->rx, addr, len, flags);
 	if (err) {
 		xs->rx_queue_full++;
 		return err;
@@ -151,48 +151,158 @@ static int __xsk_rcv_zc(struct xdp_sock *xs, struct xdp_buff *xdp, u32 len)
 	return 0;
 }
 
-static void xsk_copy_xdp(struct xdp_buff *to, struct xdp_buff *from, u32 len)
+/*
+ * A zero-copy frame made of several buffers becomes one Rx descriptor per
+ * buffer, all but the last one flagged with XDP_PKT_CONTD. Room for all of
+ * them is checked first so that a packet is never posted partially.
+ */
+static int xsk_rcv_zc(struct xdp_sock *xs, struct xdp_buff *xdp, u32 len)
 {
-	void *from_buf, *to_buf;
-	u32 metalen;
+	struct xdp_buff_xsk *xskb = container_of(xdp, struct xdp_buff_xsk, xdp);
+	struct xdp_buff_xsk *pos, *tmp;
+	struct skb_shared_info *sinfo;
+	struct list_head *xskb_list;
+	u32 contd = 0, num_desc, i;
+	int err;
 
-	if (unlikely(xdp_data_meta_unsupported(from))) {
-		from_buf = from->data;
-		to_buf = to->data;
-		metalen = 0;
-	} else {
-		from_buf = from->data_meta;
-		metalen = from->data - from->data_meta;
-		to_buf = to->data - metalen;
+	if (likely(!xdp_buff_has_frags(xdp)))
+		return __xsk_rcv_zc(xs, xskb, len, 0);
+
+	sinfo = xdp_get_shared_info_from_buff(xdp);
+	num_desc = sinfo->nr_frags + 1;
+	if (!xs->sg) {
+		xs->rx_dropped++;
+		return -ENOSPC;
 	}
+	if (xskq_prod_nb_free(xs->rx, num_desc) < num_desc) {
+		xs->rx_queue_full++;
+		return -ENOBUFS;
+	}
+
+	contd = XDP_PKT_CONTD;
+	err = __xsk_rcv_zc(xs, xskb, len, contd);
+	if (err)
+		return err;
+
+	/* The frag sizes may have been trimmed by bpf_xdp_adjust_tail() */
+	i = 0;
+	xskb_list = &xskb->pool->xskb_list;
+	list_for_each_entry_safe(pos, tmp, xskb_list, xskb_list_node) {
+		if (list_is_singular(xskb_list))
+			contd = 0;
+		len = skb_frag_size(&sinfo->frags[i++]);
+		__xsk_rcv_zc(xs, pos, len, contd);
+		list_del(&pos->xskb_list_node);
+	}
+
+	return 0;
+}
 
-	memcpy(to_buf, from_buf, len + metalen);
+static void *xsk_copy_xdp_start(struct xdp_buff *from)
+{
+	if (unlikely(xdp_data_meta_unsupported(from)))
+		return from->data;
+	else
+		return from->data_meta;
 }
 
-static int __xsk_rcv(struct xdp_sock *xs, struct xdp_buff *xdp)
+/*
+ * Copy up to @to_len bytes of the @rem bytes left of a frame into one
+ * buffer, moving on to the next frag of the frame when the current one is
+ * exhausted. Returns the number of bytes copied.
+ */
+static u32 xsk_copy_xdp(void *to, void **from, u32 to_len,
+			u32 *from_len, skb_frag_t **frag, u32 rem)
 {
+	u32 copied = 0;
+
+	while (1) {
+		u32 copy_len = min_t(u32, *from_len, to_len);
+
+		memcpy(to, *from, copy_len);
+		copied += copy_len;
+		if (rem == copied)
+			return copied;
+
+		if (*from_len == copy_len) {
+			*from = skb_frag_address(*frag);
+			*from_len = skb_frag_size((*frag)++);
+		} else {
+			*from += copy_len;
+			*from_len -= copy_len;
+		}
+		if (to_len == copy_len)
+			return copied;
+
+		to_len -= copy_len;
+		to += copy_len;
+	}
+}
+
+static int __xsk_rcv(struct xdp_sock *xs, struct xdp_buff *xdp, u32 len)
+{
+	u32 frame_size = xsk_pool_get_rx_frame_size(xs->pool);
+	void *copy_from = xsk_copy_xdp_start(xdp), *copy_to;
+	u32 from_len, meta_len, rem, num_desc;
+	struct xdp_buff_xsk *xskb;
 	struct xdp_buff *xsk_xdp;
-	int err;
-	u32 len;
+	skb_frag_t *frag = NULL;
 
-	len = xdp->data_end - xdp->data;
-	if (len > xsk_pool_get_rx_frame_size(xs->pool)) {
-		xs->rx_dropped++;
-		return -ENOSPC;
+	from_len = xdp->data_end - copy_from;
+	meta_len = xdp->data - copy_from;
+	rem = len + meta_len;
+
+	if (len <= frame_size && !xdp_buff_has_frags(xdp)) {
+		int err;
+
+		xsk_xdp = xsk_buff_alloc(xs->pool);
+		if (!xsk_xdp) {
+			xs->rx_dropped++;
+			return -ENOMEM;
+		}
+		memcpy(xsk_xdp->data - meta_len, copy_from, rem);
+		xskb = container_of(xsk_xdp, struct xdp_buff_xsk, xdp);
+		err = __xsk_rcv_zc(xs, xskb, len, 0);
+		if (err) {
+			xsk_buff_free(xsk_xdp);
+			return err;
+		}
+
+		return 0;
 	}
 
-	xsk_xdp = xsk_buff_alloc(xs->pool);
-	if (!xsk_xdp) {
+	/* The frame is spread over as few buffers as possible */
+	num_desc = (len - 1) / frame_size + 1;
+
+	if (!xsk_buff_can_alloc(xs->pool, num_desc)) {
 		xs->rx_dropped++;
 		return -ENOMEM;
 	}
-
-	xsk_copy_xdp(xsk_xdp, xdp, len);
-	err = __xsk_rcv_zc(xs, xsk_xdp, len);
-	if (err) {
-		xsk_buff_free(xsk_xdp);
-		return err;
+	if (xskq_prod_nb_free(xs->rx, num_desc) < num_desc) {
+		xs->rx_queue_full++;
+		return -ENOBUFS;
 	}
+
+	if (xdp_buff_has_frags(xdp))
+		frag = &xdp_get_shared_info_from_buff(xdp)->frags[0];
+
+	do {
+		u32 to_len = frame_size + meta_len;
+		u32 copied;
+
+		xsk_xdp = xsk_buff_alloc(xs->pool);
+		copy_to = xsk_xdp->data - meta_len;
+
+		copied = xsk_copy_xdp(copy_to, &copy_from, to_len, &from_len,
+				      &frag, rem);
+		rem -= copied;
+
+		xskb = container_of(xsk_xdp, struct xdp_buff_xsk, xdp);
+		__xsk_rcv_zc(xs, xskb, copied - meta_len,
+			     rem ? XDP_PKT_CONTD : 0);
+		meta_len = 0;
+	} while (rem);
+
 	return 0;
 }
 
@@ -214,7 +324,7 @@ static bool xsk_is_bound(struct xdp_sock *xs)
 	return false;
 }
 
-static int xsk_rcv_check(struct xdp_sock *xs, struct xdp_buff *xdp)
+static int xsk_rcv_check(struct xdp_sock *xs, struct xdp_buff *xdp, u32 len)
 {
 	if (!xsk_is_bound(xs))
 		return -ENXIO;
@@ -222,6 +332,11 @@ static int xsk_rcv_check(struct xdp_sock *xs, struct xdp_buff *xdp)
 	if (xs->dev != xdp->rxq->dev || xs->queue_id != xdp->rxq->queue_index)
 		return -EINVAL;
 
+	if (len > xsk_pool_get_rx_frame_size(xs->pool) && !xs->sg) {
+		xs->rx_dropped++;
+		return -ENOSPC;
+	}
+
 	sk_mark_napi_id_once_xdp(&xs->sk, xdp);
 	return 0;
 }
@@ -235,12 +350,13 @@ static void xsk_flush(struct xdp_sock *xs)
 
 int xsk_generic_rcv(struct xdp_sock *xs, struct xdp_buff *xdp)
 {
+	u32 len = xdp_get_buff_len(xdp);
 	int err;
 
 	spin_lock_bh(&xs->rx_lock);
-	err = xsk_rcv_check(xs, xdp);
+	err = xsk_rcv_check(xs, xdp, len);
 	if (!err) {
-		err = __xsk_rcv(xs, xdp);
+		err = __xsk_rcv(xs, xdp, len);
 		xsk_flush(xs);
 	}
 	spin_unlock_bh(&xs->rx_lock);
@@ -249,19 +365,19 @@ int xsk_generic_rcv(struct xdp_sock *xs, struct xdp_buff *xdp)
 
 static int xsk_rcv(struct xdp_sock *xs, struct xdp_buff *xdp)
 {
+	u32 len = xdp_get_buff_len(xdp);
 	int err;
-	u32 len;
 
-	err = xsk_rcv_check(xs, xdp);
+	err = xsk_rcv_check(xs, xdp, len);
 	if (err)
 		return err;
 
 	if (xdp->rxq->mem.type == MEM_TYPE_XSK_BUFF_POOL) {
 		len = xdp->data_end - xdp->data;
-		return __xsk_rcv_zc(xs, xdp, len);
+		return xsk_rcv_zc(xs, xdp, len);
 	}
 
-	err = __xsk_rcv(xs, xdp);
+	err = __xsk_rcv(xs, xdp, len);
 	if (!err)
 		xdp_return_buff(xdp);
 	return err;
@@ -407,37 +523,128 @@ static int xsk_wakeup(struct xdp_sock *xs, u8 flags)
 	return dev->netdev_ops->ndo_xsk_wakeup(dev, xs->queue_id, flags);
 }
 
-static void xsk_destruct_skb(struct sk_buff *skb)
+/* Umem addresses of the descriptors of a multi-buffer Tx packet */
+struct xsk_addrs {
+	u32 num_descs;
+	u64 addrs[MAX_SKB_FRAGS + 1];
+};
+
+static void xsk_cq_submit_locked(struct xdp_sock *xs, u64 *addrs, u32 n)
 {
-	u64 addr = (u64)(long)skb_shinfo(skb)->destructor_arg;
-	struct xdp_sock *xs = xdp_sk(skb->sk);
 	unsigned long flags;
 
 	spin_lock_irqsave(&xs->pool->cq_lock, flags);
-	xskq_prod_submit_addr(xs->pool->cq, addr);
+	xskq_prod_submit_addr_n(xs->pool->cq, addrs, n);
 	spin_unlock_irqrestore(&xs->pool->cq_lock, flags);
+}
+
+static void xsk_cq_cancel_locked(struct xdp_sock *xs, u32 n)
+{
+	unsigned long flags;
+
+	spin_lock_irqsave(&xs->pool->cq_lock, flags);
+	xskq_prod_cancel_n(xs->pool->cq, n);
+	spin_unlock_irqrestore(&xs->pool->cq_lock, flags);
+}
+
+static void xsk_destruct_skb(struct sk_buff *skb)
+{
+	u64 addr = (u64)(long)skb_shinfo(skb)->destructor_arg;
+
+	xsk_cq_submit_locked(xdp_sk(skb->sk), &addr, 1);
+	sock_wfree(skb);
+}
 
+static void xsk_destruct_skb_mb(struct sk_buff *skb)
+{
+	struct xsk_addrs *xa = skb_shinfo(skb)->destructor_arg;
+
+	xsk_cq_submit_locked(xdp_sk(skb->sk), xa->addrs, xa->num_descs);
+	kfree(xa);
 	sock_wfree(skb);
 }
 
+/*
+ * Record the umem address of @desc for the completion of @skb. A packet
+ * whose first descriptor has XDP_PKT_CONTD set keeps all its addresses in
+ * a struct xsk_addrs, as its descriptors might complete in any order with
+ * respect to other packets.
+ */
+static int xsk_skb_add_addr(struct xdp_sock *xs, struct sk_buff *skb,
+			    struct xdp_desc *desc)
+{
+	struct xsk_addrs *xa;
+
+	if (skb->destructor == xsk_destruct_skb_mb) {
+		xa = skb_shinfo(skb)->destructor_arg;
+		if (unlikely(xa->num_descs == ARRAY_SIZE(xa->addrs)))
+			return -EOVERFLOW;
+		xa->addrs[xa->num_descs++] = desc->addr;
+		return 0;
+	}
+
+	if (!xp_mb_desc(desc)) {
+		skb_shinfo(skb)->destructor_arg = (void *)(long)desc->addr;
+		skb->destructor = xsk_destruct_skb;
+		return 0;
+	}
+
+	xa = kmalloc(sizeof(*xa), xs->sk.sk_allocation);
+	if (unlikely(!xa))
+		return -ENOMEM;
+
+	xa->num_descs = 1;
+	xa->addrs[0] = desc->addr;
+	skb_shinfo(skb)->destructor_arg = xa;
+	skb->destructor = xsk_destruct_skb_mb;
+	return 0;
+}
+
+static u32 xsk_skb_num_descs(struct sk_buff *skb)
+{
+	struct xsk_addrs *xa;
+
+	if (skb->destructor != xsk_destruct_skb_mb)
+		return 1;
+
+	xa = skb_shinfo(skb)->destructor_arg;
+	return xa->num_descs;
+}
+
+/* Drop a packet without completing its descriptors */
+static void xsk_drop_skb(struct sk_buff *skb)
+{
+	struct xdp_sock *xs = xdp_sk(skb->sk);
+	u32 num_descs = xsk_skb_num_descs(skb);
+
+	xs->tx->invalid_descs += num_descs;
+	xsk_cq_cancel_locked(xs, num_descs);
+	if (skb->destructor == xsk_destruct_skb_mb)
+		kfree(skb_shinfo(skb)->destructor_arg);
+	skb->destructor = sock_wfree;
+	consume_skb(skb);
+}
+
 static struct sk_buff *xsk_build_skb_zerocopy(struct xdp_sock *xs,
 					      struct xdp_desc *desc)
 {
 	struct xsk_buff_pool *pool = xs->pool;
 	u32 hr, len, ts, offset, copy, copied;
-	struct sk_buff *skb;
+	struct sk_buff *skb = xs->skb;
 	struct page *page;
 	void *buffer;
 	int err, i;
 	u64 addr;
 
-	hr = max(NET_SKB_PAD, L1_CACHE_ALIGN(xs->dev->needed_headroom));
+	if (!skb) {
+		hr = max(NET_SKB_PAD, L1_CACHE_ALIGN(xs->dev->needed_headroom));
 
-	skb = sock_alloc_send_skb(&xs->sk, hr, 1, &err);
-	if (unlikely(!skb))
-		return ERR_PTR(err);
+		skb = sock_alloc_send_skb(&xs->sk, hr, 1, &err);
+		if (unlikely(!skb))
+			return ERR_PTR(err);
 
-	skb_reserve(skb, hr);
+		skb_reserve(skb, hr);
+	}
 
 	addr = desc->addr;
 	len = desc->len;
@@ -447,7 +654,13 @@ static struct sk_buff *xsk_build_skb_zerocopy(struct xdp_sock *xs,
 	offset = offset_in_page(buffer);
 	addr = buffer - pool->addrs;
 
-	for (copied = 0, i = 0; copied < len; i++) {
+	for (copied = 0, i = skb_shinfo(skb)->nr_frags; copied < len; i++) {
+		if (unlikely(i >= MAX_SKB_FRAGS)) {
+			if (!xs->skb)
+				kfree_skb(skb);
+			return ERR_PTR(-EOVERFLOW);
+		}
+
 		page = pool->umem->pgs[addr >> PAGE_SHIFT];
 		get_page(page);
 
@@ -468,20 +681,52 @@ static struct sk_buff *xsk_build_skb_zerocopy(struct xdp_sock *xs,
 	return skb;
 }
 
+/* Copy a continuation descriptor into a new page frag of @skb */
+static int xsk_skb_add_frag_copy(struct xdp_sock *xs, struct sk_buff *skb,
+				 struct xdp_desc *desc)
+{
+	int nr_frags = skb_shinfo(skb)->nr_frags;
+	struct page *page;
+	void *buffer;
+	u8 *vaddr;
+
+	if (unlikely(nr_frags == MAX_SKB_FRAGS))
+		return -EOVERFLOW;
+
+	page = alloc_page(xs->sk.sk_allocation);
+	if (unlikely(!page))
+		return -EAGAIN;
+
+	buffer = xsk_buff_raw_get_data(xs->pool, desc->addr);
+	vaddr = kmap_local_page(page);
+	memcpy(vaddr, buffer, desc->len);
+	kunmap_local(vaddr);
+
+	skb_add_rx_frag(skb, nr_frags, page, 0, desc->len, PAGE_SIZE);
+	refcount_add(PAGE_SIZE, &xs->sk.sk_wmem_alloc);
+
+	return 0;
+}
+
+/*
+ * Build the skb for @desc, or add @desc to the multi-buffer packet being
+ * built in xs->skb. On error a new skb is freed, while xs->skb is left to
+ * the caller.
+ */
 static struct sk_buff *xsk_build_skb(struct xdp_sock *xs,
 				     struct xdp_desc *desc)
 {
 	struct net_device *dev = xs->dev;
-	struct sk_buff *skb;
+	struct sk_buff *skb = xs->skb;
+	int err;
 
 	if (dev->priv_flags & IFF_TX_SKB_NO_LINEAR) {
 		skb = xsk_build_skb_zerocopy(xs, desc);
 		if (IS_ERR(skb))
 			return skb;
-	} else {
+	} else if (!skb) {
 		u32 hr, tr, len;
 		void *buffer;
-		int err;
 
 		hr = max(NET_SKB_PAD, L1_CACHE_ALIGN(dev->needed_headroom));
 		tr = dev->needed_tailroom;
@@ -500,13 +745,24 @@ static struct sk_buff *xsk_build_skb(struct xdp_sock *xs,
 			kfree_skb(skb);
 			return ERR_PTR(err);
 		}
+	} else {
+		err = xsk_skb_add_frag_copy(xs, skb, desc);
+		if (unlikely(err))
+			return ERR_PTR(err);
 	}
 
-	skb->dev = dev;
-	skb->priority = xs->sk.sk_priority;
-	skb->mark = xs->sk.sk_mark;
-	skb_shinfo(skb)->destructor_arg = (void *)(long)desc->addr;
-	skb->destructor = xsk_destruct_skb;
+	if (!xs->skb) {
+		skb->dev = dev;
+		skb->priority = xs->sk.sk_priority;
+		skb->mark = xs->sk.sk_mark;
+	}
+
+	err = xsk_skb_add_addr(xs, skb, desc);
+	if (unlikely(err)) {
+		if (!xs->skb)
+			kfree_skb(skb);
+		return ERR_PTR(err);
+	}
 
 	return skb;
 }
@@ -519,6 +775,7 @@ static int __xsk_generic_xmit(struct sock *sk)
 	struct xdp_desc desc;
 	struct sk_buff *skb;
 	unsigned long flags;
+	u32 reserved = 0;
 	int err = 0;
 
 	mutex_lock(&xs->mutex);
@@ -541,31 +798,64 @@ static int __xsk_generic_xmit(struct sock *sk)
 		/* This is the backpressure mechanism for the Tx path.
 		 * Reserve space in the completion queue and only proceed
 		 * if there is space in it. This avoids having to implement
-		 * any buffering in the Tx path.
+		 * any buffering in the Tx path. The space is reserved for
+		 * all the descriptors of the batch which are already in the
+		 * Tx ring at once, and what is left over is given back at
+		 * the end.
 		 */
-		spin_lock_irqsave(&xs->pool->cq_lock, flags);
-		if (xskq_prod_reserve(xs->pool->cq)) {
+		if (!reserved) {
+			u32 nb_descs = xskq_cons_nb_entries(xs->tx, max_batch + 1);
+
+			spin_lock_irqsave(&xs->pool->cq_lock, flags);
+			reserved = xskq_prod_reserve_n(xs->pool->cq, nb_descs);
 			spin_unlock_irqrestore(&xs->pool->cq_lock, flags);
-			goto out;
+			if (!reserved)
+				goto out;
 		}
-		spin_unlock_irqrestore(&xs->pool->cq_lock, flags);
+		reserved--;
 
 		skb = xsk_build_skb(xs, &desc);
 		if (IS_ERR(skb)) {
 			err = PTR_ERR(skb);
-			spin_lock_irqsave(&xs->pool->cq_lock, flags);
-			xskq_prod_cancel(xs->pool->cq);
-			spin_unlock_irqrestore(&xs->pool->cq_lock, flags);
-			goto out;
+			reserved++;
+			if (err != -EOVERFLOW)
+				goto out;
+
+			/* Too many descriptors for one packet, drop it */
+			xs->tx->invalid_descs++;
+			xskq_cons_release(xs->tx);
+			if (xs->skb) {
+				xsk_drop_skb(xs->skb);
+				xs->skb = NULL;
+			}
+			err = 0;
+			continue;
+		}
+
+		if (xp_mb_desc(&desc)) {
+			/* Wait for the rest of the packet */
+			xskq_cons_release(xs->tx);
+			xs->skb = skb;
+			continue;
 		}
 
 		err = __dev_direct_xmit(skb, xs->queue_id);
 		if  (err == NETDEV_TX_BUSY) {
+			if (xs->skb) {
+				/* The descriptors of a multi-buffer packet
+				 * cannot be given back to the ring; treat the
+				 * packet as dropped.
+				 */
+				xskq_cons_release(xs->tx);
+				xs->skb = NULL;
+				kfree_skb(skb);
+				err = -EBUSY;
+				goto out;
+			}
+
 			/* Tell user-space to retry the send */
 			skb->destructor = sock_wfree;
-			spin_lock_irqsave(&xs->pool->cq_lock, flags);
-			xskq_prod_cancel(xs->pool->cq);
-			spin_unlock_irqrestore(&xs->pool->cq_lock, flags);
+			reserved++;
 			/* Free skb without triggering the perf drop trace */
 			consume_skb(skb);
 			err = -EAGAIN;
@@ -573,6 +863,7 @@ static int __xsk_generic_xmit(struct sock *sk)
 		}
 
 		xskq_cons_release(xs->tx);
+		xs->skb = NULL;
 		/* Ignore NET_XMIT_CN as packet might have been sent */
 		if (err == NET_XMIT_DROP) {
 			/* SKB completed but not sent */
@@ -586,6 +877,8 @@ static int __xsk_generic_xmit(struct sock *sk)
 	xs->tx->queue_empty_descs++;
 
 out:
+	if (reserved)
+		xsk_cq_cancel_locked(xs, reserved);
 	if (sent_frame)
 		if (xsk_tx_writeable(xs))
 			sk->sk_write_space(sk);
@@ -650,6 +943,9 @@ static int __xsk_sendmsg(struct socket *sock, struct msghdr *m, size_t total_len
 		sk_busy_loop(sk, 1); /* only support non-blocking sockets */
 	}
 
+	/* In copy mode the Tx ring is always processed right here, so a
+	 * single call both busy polls the Rx and completion rings and sends.
+	 */
 	if (xs->zc && xsk_no_wakeup(sk))
 		return 0;
 
@@ -841,6 +1137,10 @@ static int xsk_release(struct socket *sock)
 
 	xsk_delete_from_maps(xs);
 	mutex_lock(&xs->mutex);
+	if (xs->skb) {
+		xsk_drop_skb(xs->skb);
+		xs->skb = NULL;
+	}
 	xsk_unbind_dev(xs);
 	mutex_unlock(&xs->mutex);
 
@@ -896,7 +1196,7 @@ static int xsk_bind(struct socket *sock, struct sockaddr *addr, int addr_len)
 
 	flags = sxdp->sxdp_flags;
 	if (flags & ~(XDP_SHARED_UMEM | XDP_COPY | XDP_ZEROCOPY |
-		      XDP_USE_NEED_WAKEUP))
+		      XDP_USE_NEED_WAKEUP | XDP_USE_SG))
 		return -EINVAL;
 
 	rtnl_lock();
@@ -924,7 +1224,7 @@ static int xsk_bind(struct socket *sock, struct sockaddr *addr, int addr_len)
 		struct socket *sock;
 
 		if ((flags & XDP_COPY) || (flags & XDP_ZEROCOPY) ||
-		    (flags & XDP_USE_NEED_WAKEUP)) {
+		    (flags & XDP_USE_NEED_WAKEUP) || (flags & XDP_USE_SG)) {
 			/* Cannot specify flags for shared sockets. */
 			err = -EINVAL;
 			goto out_unlock;
@@ -1023,6 +1323,7 @@ static int xsk_bind(struct socket *sock, struct sockaddr *addr, int addr_len)
 
 	xs->dev = dev;
 	xs->zc = xs->umem->zc;
+	xs->sg = !!(xs->umem->flags & XDP_UMEM_SG_FLAG);
 	xs->queue_id = qid;
 	xp_add_xsk(xs->pool, xs);
 
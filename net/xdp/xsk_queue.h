@@ -129,6 +129,18 @@ static inline bool xskq_cons_read_addr_unchecked(struct xsk_queue *q, u64 *addr)
 	return false;
 }
 
+/* XDP_PKT_CONTD is the only option, and only valid when the socket was
+ * bound with XDP_USE_SG.
+ */
+static inline bool xp_validate_desc_options(struct xsk_buff_pool *pool,
+					    struct xdp_desc *desc)
+{
+	if (desc->options & ~XDP_PKT_CONTD)
+		return false;
+
+	return !xp_mb_desc(desc) || (pool->umem->flags & XDP_UMEM_SG_FLAG);
+}
+
 static inline bool xp_aligned_validate_desc(struct xsk_buff_pool *pool,
 					    struct xdp_desc *desc)
 {
@@ -144,9 +156,7 @@ static inline bool xp_aligned_validate_desc(struct xsk_buff_pool *pool,
 	if (chunk >= pool->addrs_cnt)
 		return false;
 
-	if (desc->options)
-		return false;
-	return true;
+	return xp_validate_desc_options(pool, desc);
 }
 
 static inline bool xp_unaligned_validate_desc(struct xsk_buff_pool *pool,
@@ -165,9 +175,7 @@ static inline bool xp_unaligned_validate_desc(struct xsk_buff_pool *pool,
 	    xp_desc_crosses_non_contig_pg(pool, addr, desc->len))
 		return false;
 
-	if (desc->options)
-		return false;
-	return true;
+	return xp_validate_desc_options(pool, desc);
 }
 
 static inline bool xp_validate_desc(struct xsk_buff_pool *pool,
@@ -211,30 +219,45 @@ static inline void xskq_cons_release_n(struct xsk_queue *q, u32 cnt)
 	q->cached_cons += cnt;
 }
 
+/* Only complete packets are returned. A packet that has an invalid
+ * descriptor, or more descriptors than the driver supports, is dropped up
+ * to and including the offending descriptor. The descriptors of a packet
+ * that is not complete yet are left in the ring.
+ */
 static inline u32 xskq_cons_read_desc_batch(struct xsk_queue *q, struct xsk_buff_pool *pool,
 					    u32 max)
 {
 	u32 cached_cons = q->cached_cons, nb_entries = 0;
 	struct xdp_desc *descs = pool->tx_descs;
+	u32 total_descs = 0, nr_frags = 0;
 
 	while (cached_cons != q->cached_prod && nb_entries < max) {
 		struct xdp_rxtx_ring *ring = (struct xdp_rxtx_ring *)q->ring;
 		u32 idx = cached_cons & q->ring_mask;
 
 		descs[nb_entries] = ring->desc[idx];
-		if (unlikely(!xskq_cons_is_valid_desc(q, &descs[nb_entries], pool))) {
-			/* Skip the entry */
-			cached_cons++;
+		cached_cons++;
+		if (unlikely(!xskq_cons_is_valid_desc(q, &descs[nb_entries], pool) ||
+			     nr_frags >= pool->netdev->xdp_zc_max_segs)) {
+			/* Drop the packet */
+			nb_entries -= nr_frags;
+			nr_frags = 0;
 			continue;
 		}
 
 		nb_entries++;
-		cached_cons++;
+		if (xp_mb_desc(&descs[nb_entries - 1])) {
+			nr_frags++;
+		} else {
+			nr_frags = 0;
+			total_descs = nb_entries;
+		}
 	}
 
-	/* Release valid plus any invalid entries */
+	/* Release complete packets plus any dropped entries */
+	cached_cons -= nr_frags;
 	xskq_cons_release_n(q, cached_cons - q->cached_cons);
-	return nb_entries;
+	return total_descs;
 }
 
 /* Functions for consumers */
@@ -326,9 +349,14 @@ static inline bool xskq_prod_is_full(struct xsk_queue *q)
 	return xskq_prod_nb_free(q, 1) ? false : true;
 }
 
+static inline void xskq_prod_cancel_n(struct xsk_queue *q, u32 cnt)
+{
+	q->cached_prod -= cnt;
+}
+
 static inline void xskq_prod_cancel(struct xsk_queue *q)
 {
-	q->cached_prod--;
+	xskq_prod_cancel_n(q, 1);
 }
 
 static inline int xskq_prod_reserve(struct xsk_queue *q)
@@ -341,6 +369,16 @@ static inline int xskq_prod_reserve(struct xsk_queue *q)
 	return 0;
 }
 
+/* Reserve up to @max entries, returns the number of entries reserved */
+static inline u32 xskq_prod_reserve_n(struct xsk_queue *q, u32 max)
+{
+	u32 nb_entries = xskq_prod_nb_free(q, max);
+
+	/* A, matches D */
+	q->cached_prod += nb_entries;
+	return nb_entries;
+}
+
 static inline int xskq_prod_reserve_addr(struct xsk_queue *q, u64 addr)
 {
 	struct xdp_umem_ring *ring = (struct xdp_umem_ring *)q->ring;
@@ -367,7 +405,7 @@ static inline void xskq_prod_write_addr_batch(struct xsk_queue *q, struct xdp_de
 }
 
 static inline int xskq_prod_reserve_desc(struct xsk_queue *q,
-					 u64 addr, u32 len)
+					 u64 addr, u32 len, u32 flags)
 {
 	struct xdp_rxtx_ring *ring = (struct xdp_rxtx_ring *)q->ring;
 	u32 idx;
@@ -379,6 +417,7 @@ static inline int xskq_prod_reserve_desc(struct xsk_queue *q,
 	idx = q->cached_prod++ & q->ring_mask;
 	ring->desc[idx].addr = addr;
 	ring->desc[idx].len = len;
+	ring->desc[idx].options = flags;
 
 	return 0;
 }
@@ -393,12 +432,16 @@ static inline void xskq_prod_submit(struct xsk_queue *q)
 	__xskq_prod_submit(q, q->cached_prod);
 }
 
-static inline void xskq_prod_submit_addr(struct xsk_queue *q, u64 addr)
+/* Write @nb_entries addresses and publish them with a single store */
+static inline void xskq_prod_submit_addr_n(struct xsk_queue *q, u64 *addrs,
+					   u32 nb_entries)
 {
 	struct xdp_umem_ring *ring = (struct xdp_umem_ring *)q->ring;
 	u32 idx = q->ring->producer;
+	u32 i;
 
-	ring->desc[idx++ & q->ring_mask] = addr;
+	for (i = 0; i < nb_entries; i++)
+		ring->desc[idx++ & q->ring_mask] = addrs[i];
 
 	__xskq_prod_submit(q, idx);
 }
@@ -943,6 +943,7 @@ enum bpf_map_type {
 	BPF_MAP_TYPE_BLOOM_FILTER,
 	BPF_MAP_TYPE_USER_RINGBUF,
 	BPF_MAP_TYPE_CGRP_STORAGE,
+	BPF_MAP_TYPE_RHASH,
 };
 
 /* Note that tracing related programs such as
@@ -1332,6 +1333,11 @@ union bpf_attr {
 		 * BPF_MAP_TYPE_BLOOM_FILTER - the lowest 4 bits indicate the
 		 * number of hash functions (if 0, the bloom filter will default
 		 * to using 5 hash functions).
+		 *
+		 * BPF_MAP_TYPE_RINGBUF - wakeup watermark: the consumer is
+		 * only woken up once at least this many bytes are pending,
+		 * unless BPF_RB_FORCE_WAKEUP is used (if 0, it is woken up
+		 * as soon as the record it waits for is committed).
 		 */
 		__u64	map_extra;
 	};
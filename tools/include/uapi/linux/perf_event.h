@@ -455,7 +455,8 @@ struct perf_event_attr {
 				inherit_thread :  1, /* children only inherit if cloned with CLONE_THREAD */
 				remove_on_exec :  1, /* event is removed from task on exec */
 				sigtrap        :  1, /* send synchronous SIGTRAP on event */
-				__reserved_1   : 26;
+				aggregate_callchain :  1, /* count callchain samples in kernel */
+				__reserved_1   : 25;
 
 	union {
 		__u32		wakeup_events;	  /* wakeup every n events */
@@ -1204,6 +1205,24 @@ enum perf_event_type {
 	 */
 	PERF_RECORD_AUX_OUTPUT_HW_ID		= 21,
 
+	/*
+	 * Samples of an event with aggregate_callchain set, counted in the
+	 * kernel per pid, tid and callchain. 'count' is the number of
+	 * samples and 'period' the sum of their periods. Callchains deeper
+	 * than 64 entries are written as regular PERF_RECORD_SAMPLE.
+	 *
+	 * struct {
+	 *	struct perf_event_header	header;
+	 *	u32				pid, tid;
+	 *	u64				count;
+	 *	u64				period;
+	 *	u64				nr;
+	 *	u64				ips[nr];
+	 *	struct sample_id		sample_id;
+	 * };
+	 */
+	PERF_RECORD_SAMPLE_AGGR			= 22,
+
 	PERF_RECORD_MAX,			/* non-ABI */
 };
 
@@ -1,5 +1,6 @@
 // SPDX-License-Identifier: GPL-2.0
 #include <errno.h>
+#include <fcntl.h>
 #include <signal.h>
 #include <inttypes.h>
 #include <linux/err.h>
@@ -2326,6 +2327,15 @@ reader__mmap(struct reader *rd, struct perf_session *session)
 	mmaps[rd->mmap_idx] = rd->mmap_cur = buf;
 	rd->mmap_idx = (rd->mmap_idx + 1) & (ARRAY_SIZE(rd->mmaps) - 1);
 	rd->file_pos = rd->file_offset + rd->head;
+
+	/*
+	 * Start readahead of the next window while this one is processed, so
+	 * that large files don't stall on a page fault at every remap.
+	 */
+	if (rd->file_offset + rd->mmap_size < rd->data_offset + rd->data_size)
+		posix_fadvise(rd->fd, rd->file_offset + rd->mmap_size,
+			      rd->mmap_size, POSIX_FADV_WILLNEED);
+
 	if (session->one_mmap) {
 		session->one_mmap_addr = buf;
 		session->one_mmap_offset = rd->file_offset;
@@ -12,6 +12,7 @@
 #include "bpf_iter_task_file.skel.h"
 #include "bpf_iter_task_vma.skel.h"
 #include "bpf_iter_task_btf.skel.h"
+#include "bpf_iter_task_stats.skel.h"
 #include "bpf_iter_tcp4.skel.h"
 #include "bpf_iter_tcp6.skel.h"
 #include "bpf_iter_udp4.skel.h"
@@ -323,6 +324,33 @@ static void test_task_sleepable(void)
 	bpf_iter_task__destroy(skel);
 }
 
+static void test_task_stats(void)
+{
+	struct bpf_iter_task_stats *skel;
+	volatile char *buf;
+
+	/* Make sure there is anonymous memory to account */
+	buf = malloc(4 * getpagesize());
+	if (!ASSERT_OK_PTR(buf, "malloc"))
+		return;
+	memset((char *)buf, 1, 4 * getpagesize());
+
+	skel = bpf_iter_task_stats__open_and_load();
+	if (!ASSERT_OK_PTR(skel, "bpf_iter_task_stats__open_and_load"))
+		goto out;
+
+	skel->bss->tid = syscall(SYS_gettid);
+	do_dummy_read(skel->progs.dump_task_stats);
+
+	ASSERT_GT(skel->bss->anon_pages, 0, "anon_pages");
+	ASSERT_GT(skel->bss->cputime, 0, "cputime");
+	ASSERT_EQ(skel->bss->kthread_ret, -ENOENT, "kthread_ret");
+
+	bpf_iter_task_stats__destroy(skel);
+out:
+	free((char *)buf);
+}
+
 static void test_task_stack(void)
 {
 	struct bpf_iter_task_stack *skel;
@@ -1651,6 +1679,8 @@ void test_bpf_iter(void)
 		test_task_pidfd();
 	if (test__start_subtest("task_sleepable"))
 		test_task_sleepable();
+	if (test__start_subtest("task_stats"))
+		test_task_stats();
 	if (test__start_subtest("task_stack"))
 		test_task_stack();
 	if (test__start_subtest("task_file"))
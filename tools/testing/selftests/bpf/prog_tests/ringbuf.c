@@ -14,6 +14,7 @@
 #include <linux/ring_buffer.h>
 #include "test_ringbuf.lskel.h"
 #include "test_ringbuf_map_key.lskel.h"
+#include "test_ringbuf_multi.skel.h"
 
 #define EDONE 7777
 
@@ -354,10 +355,104 @@ cleanup:
 	test_ringbuf_map_key_lskel__destroy(skel_map_key);
 }
 
+static int process_wm_sample(void *ctx, void *data, size_t len)
+{
+	atomic_inc(&sample_cnt);
+	return 0;
+}
+
+static void ringbuf_wakeup_wm_subtest(void)
+{
+	const size_t rec_sz = BPF_RINGBUF_HDR_SZ + sizeof(struct sample);
+	LIBBPF_OPTS(bpf_map_create_opts, opts);
+	struct test_ringbuf_multi *skel_multi;
+	int page_size = getpagesize();
+	int err, fd, rb_fd = -1, slot = 1;
+	pthread_t thread;
+	long bg_ret = -1;
+
+	opts.map_extra = page_size / 2;
+	fd = bpf_map_create(BPF_MAP_TYPE_RINGBUF, NULL, 0, 0, page_size, &opts);
+	if (ASSERT_GE(fd, 0, "ringbuf_wm_create"))
+		close(fd);
+
+	/* the watermark has to be reachable */
+	opts.map_extra = page_size;
+	fd = bpf_map_create(BPF_MAP_TYPE_RINGBUF, NULL, 0, 0, page_size, &opts);
+	if (!ASSERT_LT(fd, 0, "ringbuf_wm_too_big"))
+		close(fd);
+
+	/* only kernel producer ring buffers wake up a consumer */
+	opts.map_extra = page_size / 2;
+	fd = bpf_map_create(BPF_MAP_TYPE_USER_RINGBUF, NULL, 0, 0, page_size,
+			    &opts);
+	if (!ASSERT_LT(fd, 0, "user_ringbuf_wm"))
+		close(fd);
+
+	/* the consumer is only woken up by the third record */
+	skel_multi = test_ringbuf_multi__open_and_load();
+	if (!ASSERT_OK_PTR(skel_multi, "test_ringbuf_multi__open_and_load"))
+		return;
+
+	opts.map_extra = 3 * rec_sz;
+	rb_fd = bpf_map_create(BPF_MAP_TYPE_RINGBUF, NULL, 0, 0, page_size,
+			       &opts);
+	if (!ASSERT_GE(rb_fd, 0, "ringbuf_wm_create"))
+		goto cleanup;
+
+	err = bpf_map_update_elem(bpf_map__fd(skel_multi->maps.ringbuf_arr),
+				  &slot, &rb_fd, 0);
+	if (!ASSERT_OK(err, "ringbuf_arr_update"))
+		goto cleanup;
+
+	skel_multi->bss->pid = getpid();
+	skel_multi->bss->target_ring = slot;
+
+	ringbuf = ring_buffer__new(rb_fd, process_wm_sample, NULL, NULL);
+	if (!ASSERT_OK_PTR(ringbuf, "ring_buffer__new"))
+		goto cleanup;
+
+	err = test_ringbuf_multi__attach(skel_multi);
+	if (!ASSERT_OK(err, "test_ringbuf_multi__attach"))
+		goto cleanup_ringbuf;
+
+	err = pthread_create(&thread, NULL, poll_thread, (void *)(long)10000);
+	if (!ASSERT_OK(err, "bg_poll"))
+		goto cleanup_ringbuf;
+
+	/* two records stay below the watermark */
+	usleep(50000);
+	syscall(__NR_getpgid);
+	syscall(__NR_getpgid);
+	usleep(50000);
+	err = pthread_tryjoin_np(thread, (void **)&bg_ret);
+	if (!ASSERT_EQ(err, EBUSY, "try_join_below_wm"))
+		goto cleanup_ringbuf;
+	ASSERT_EQ(atomic_xchg(&sample_cnt, 0), 0, "cnt_below_wm");
+
+	/* the third one reaches it, well before the poll timeout */
+	syscall(__NR_getpgid);
+	err = pthread_join(thread, (void **)&bg_ret);
+	if (!ASSERT_OK(err, "join_bg"))
+		goto cleanup_ringbuf;
+	ASSERT_EQ(bg_ret, 3, "bg_ret");
+	ASSERT_EQ(atomic_xchg(&sample_cnt, 0), 3, "cnt_at_wm");
+	ASSERT_EQ(skel_multi->bss->dropped, 0, "dropped");
+
+cleanup_ringbuf:
+	ring_buffer__free(ringbuf);
+cleanup:
+	if (rb_fd >= 0)
+		close(rb_fd);
+	test_ringbuf_multi__destroy(skel_multi);
+}
+
 void test_ringbuf(void)
 {
 	if (test__start_subtest("ringbuf"))
 		ringbuf_subtest();
 	if (test__start_subtest("ringbuf_map_key"))
 		ringbuf_map_key_subtest();
+	if (test__start_subtest("ringbuf_wakeup_wm"))
+		ringbuf_wakeup_wm_subtest();
 }
@@ -0,0 +1,45 @@
+// SPDX-License-Identifier: GPL-2.0
+#include "bpf_iter.h"
+#include <bpf/bpf_helpers.h>
+
+char _license[] SEC("license") = "GPL";
+
+#define PF_KTHREAD	0x00200000
+#define EBUSY		16
+
+extern s64 bpf_task_mm_counter(struct task_struct *task, int member) __ksym;
+extern int bpf_task_cputime(struct task_struct *task, __u64 *utime,
+			    __u64 *stime) __ksym;
+
+uint32_t tid = 0;
+s64 anon_pages = -1;
+s64 kthread_ret = 0;
+__u64 cputime = 0;
+
+SEC("iter/task")
+int dump_task_stats(struct bpf_iter__task *ctx)
+{
+	struct task_struct *task = ctx->task;
+	__u64 utime = 0, stime = 0;
+
+	if (!task)
+		return 0;
+
+	if (task->flags & PF_KTHREAD) {
+		/* Try the next kthread if this one's task_lock was contended */
+		if (!kthread_ret || kthread_ret == -EBUSY)
+			kthread_ret = bpf_task_mm_counter(task, MM_ANONPAGES);
+		return 0;
+	}
+
+	if (task->pid != tid)
+		return 0;
+
+	anon_pages = bpf_task_mm_counter(task, MM_ANONPAGES);
+	if (!bpf_task_cputime(task, &utime, &stime))
+		cputime = utime + stime;
+
+	BPF_SEQ_PRINTF(ctx->meta->seq, "%8d %lld %llu\n", task->pid,
+		       anon_pages, cputime);
+	return 0;
+}
@@ -130,6 +130,68 @@ static void test_hashmap(unsigned int task, void *data)
 	close(fd);
 }
 
+#define RHASH_ENTRIES 1024
+
+/* Grow the map well past its initial table size and walk it */
+static void test_rhashmap(unsigned int task, void *data)
+{
+	bool seen[RHASH_ENTRIES] = {};
+	long long key, next_key, value;
+	int fd, i;
+
+	fd = bpf_map_create(BPF_MAP_TYPE_RHASH, NULL, sizeof(key), sizeof(value),
+			    RHASH_ENTRIES, &map_opts);
+	if (fd < 0) {
+		printf("Failed to create rhashmap '%s'!\n", strerror(errno));
+		exit(1);
+	}
+
+	for (i = 0; i < RHASH_ENTRIES; i++) {
+		key = i;
+		value = i * 2;
+		assert(bpf_map_update_elem(fd, &key, &value, BPF_NOEXIST) == 0);
+	}
+
+	/* The map is full, but existing elements can still be updated */
+	key = RHASH_ENTRIES;
+	assert(bpf_map_update_elem(fd, &key, &value, BPF_ANY) < 0 &&
+	       errno == E2BIG);
+	key = 0;
+	value = 1;
+	assert(bpf_map_update_elem(fd, &key, &value, BPF_NOEXIST) < 0 &&
+	       errno == EEXIST);
+	assert(bpf_map_update_elem(fd, &key, &value, BPF_EXIST) == 0);
+	assert(bpf_map_lookup_elem(fd, &key, &value) == 0 && value == 1);
+
+	for (i = 1; i < RHASH_ENTRIES; i++) {
+		key = i;
+		assert(bpf_map_lookup_elem(fd, &key, &value) == 0 &&
+		       value == i * 2);
+	}
+
+	/* The table may still be resizing, so keys can show up twice */
+	assert(bpf_map_get_next_key(fd, NULL, &next_key) == 0);
+	do {
+		assert(next_key >= 0 && next_key < RHASH_ENTRIES);
+		seen[next_key] = true;
+		key = next_key;
+	} while (bpf_map_get_next_key(fd, &key, &next_key) == 0);
+	assert(errno == ENOENT);
+
+	for (i = 0; i < RHASH_ENTRIES; i++) {
+		assert(seen[i]);
+		key = i;
+		assert(bpf_map_delete_elem(fd, &key) == 0);
+	}
+
+	key = 0;
+	assert(bpf_map_delete_elem(fd, &key) < 0 && errno == ENOENT);
+	assert(bpf_map_get_next_key(fd, NULL, &next_key) < 0 &&
+	       errno == ENOENT);
+
+	close(fd);
+}
+
 static void test_hashmap_sizes(unsigned int task, void *data)
 {
 	int fd, i, j;
@@ -1878,6 +1940,7 @@ static void run_all_tests(void)
 	test_hashmap_percpu(0, NULL);
 	test_hashmap_walk(0, NULL);
 	test_hashmap_zero_seed();
+	test_rhashmap(0, NULL);
 
 	test_arraymap(0, NULL);
 	test_arraymap_percpu(0, NULL);
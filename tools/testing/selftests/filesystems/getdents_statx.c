@@ -0,0 +1,135 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * Tests for getdents_statx(): entries carry the attributes that statx()
+ * reports for them, once they are in the dcache.
+ */
+
+#define _GNU_SOURCE
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <linux/stat.h>
+
+#include "../kselftest_harness.h"
+
+#ifndef __NR_getdents_statx
+#define __NR_getdents_statx 452
+#endif
+
+#define FILE_SIZE 123
+
+static int sys_getdents_statx(int fd, void *buf, unsigned int count,
+			      unsigned int mask, unsigned int flags)
+{
+	return syscall(__NR_getdents_statx, fd, buf, count, mask, flags);
+}
+
+FIXTURE(getdents_statx) {
+	char dir[32];
+	int dfd;
+};
+
+FIXTURE_SETUP(getdents_statx)
+{
+	struct stat st;
+	int fd;
+
+	strcpy(self->dir, "/tmp/getdents_statx.XXXXXX");
+	ASSERT_NE(NULL, mkdtemp(self->dir));
+
+	self->dfd = open(self->dir, O_RDONLY | O_DIRECTORY);
+	ASSERT_GE(self->dfd, 0);
+
+	fd = openat(self->dfd, "file", O_CREAT | O_WRONLY, 0600);
+	ASSERT_GE(fd, 0);
+	ASSERT_EQ(0, ftruncate(fd, FILE_SIZE));
+	close(fd);
+	ASSERT_EQ(0, mkdirat(self->dfd, "subdir", 0700));
+
+	/* Pull both entries into the dcache */
+	ASSERT_EQ(0, fstatat(self->dfd, "file", &st, 0));
+	ASSERT_EQ(0, fstatat(self->dfd, "subdir", &st, 0));
+}
+
+FIXTURE_TEARDOWN(getdents_statx)
+{
+	unlinkat(self->dfd, "file", 0);
+	unlinkat(self->dfd, "subdir", AT_REMOVEDIR);
+	close(self->dfd);
+	rmdir(self->dir);
+}
+
+TEST_F(getdents_statx, attributes)
+{
+	char buf[4096] __attribute__((aligned(8)));
+	bool seen_file = false, seen_subdir = false;
+	struct dirent_statx *d;
+	int len, pos;
+
+	if (sys_getdents_statx(self->dfd, buf, sizeof(buf),
+			       STATX_BASIC_STATS, 0) < 0 && errno == ENOSYS)
+		SKIP(return, "getdents_statx() not supported");
+	ASSERT_EQ(0, lseek(self->dfd, 0, SEEK_SET));
+
+	while ((len = sys_getdents_statx(self->dfd, buf, sizeof(buf),
+					 STATX_BASIC_STATS, 0)) > 0) {
+		for (pos = 0; pos < len; pos += d->d_reclen) {
+			d = (struct dirent_statx *)(buf + pos);
+
+			if (!strcmp(d->d_name, ".") || !strcmp(d->d_name, "..")) {
+				/* Never looked up */
+				EXPECT_EQ(0, d->d_stx.stx_mask);
+				continue;
+			}
+
+			ASSERT_TRUE(d->d_stx.stx_mask & STATX_INO);
+			EXPECT_EQ(d->d_ino, d->d_stx.stx_ino);
+			ASSERT_TRUE(d->d_stx.stx_mask & STATX_TYPE);
+
+			if (!strcmp(d->d_name, "file")) {
+				seen_file = true;
+				EXPECT_EQ(DT_REG, d->d_type);
+				EXPECT_TRUE(S_ISREG(d->d_stx.stx_mode));
+				ASSERT_TRUE(d->d_stx.stx_mask & STATX_SIZE);
+				EXPECT_EQ(FILE_SIZE, d->d_stx.stx_size);
+			} else if (!strcmp(d->d_name, "subdir")) {
+				seen_subdir = true;
+				EXPECT_EQ(DT_DIR, d->d_type);
+				EXPECT_TRUE(S_ISDIR(d->d_stx.stx_mode));
+			}
+		}
+	}
+	ASSERT_EQ(0, len);
+	EXPECT_TRUE(seen_file);
+	EXPECT_TRUE(seen_subdir);
+}
+
+TEST_F(getdents_statx, invalid)
+{
+	char buf[4096] __attribute__((aligned(8)));
+
+	if (sys_getdents_statx(self->dfd, buf, sizeof(buf),
+			       STATX_BASIC_STATS, 0) < 0 && errno == ENOSYS)
+		SKIP(return, "getdents_statx() not supported");
+
+	EXPECT_EQ(-1, sys_getdents_statx(self->dfd, buf, sizeof(buf),
+					 STATX__RESERVED, 0));
+	EXPECT_EQ(EINVAL, errno);
+
+	EXPECT_EQ(-1, sys_getdents_statx(self->dfd, buf, sizeof(buf),
+					 STATX_BASIC_STATS,
+					 AT_STATX_FORCE_SYNC));
+	EXPECT_EQ(EINVAL, errno);
+
+	EXPECT_EQ(-1, sys_getdents_statx(-1, buf, sizeof(buf),
+					 STATX_BASIC_STATS, 0));
+	EXPECT_EQ(EBADF, errno);
+}
+
+TEST_HARNESS_MAIN
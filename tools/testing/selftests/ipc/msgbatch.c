@@ -0,0 +1,192 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * Tests for msgsnd_batch() and msgrcv_batch(): partial batches, the
+ * per message results, and sleeping for the first message only.
+ */
+
+#define _GNU_SOURCE
+#include <errno.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/ipc.h>
+#include <sys/msg.h>
+#include <sys/syscall.h>
+#include <sys/wait.h>
+
+#include "../kselftest_harness.h"
+
+#ifndef __NR_msgsnd_batch
+#define __NR_msgsnd_batch 453
+#endif
+#ifndef __NR_msgrcv_batch
+#define __NR_msgrcv_batch 454
+#endif
+
+/* From <linux/msg.h>, which clashes with <sys/msg.h> */
+struct msg_batch {
+	uint64_t msgp;
+	uint64_t msgsz;
+	int64_t result;
+};
+
+#define NR_MSGS		4
+#define MSG_LEN		32
+
+struct test_msg {
+	long mtype;
+	char mtext[MSG_LEN];
+};
+
+static long msgsnd_batch(int msqid, struct msg_batch *vec,
+			 unsigned int vlen, int msgflg)
+{
+	return syscall(__NR_msgsnd_batch, msqid, vec, vlen, msgflg);
+}
+
+static long msgrcv_batch(int msqid, struct msg_batch *vec,
+			 unsigned int vlen, long msgtyp, int msgflg)
+{
+	return syscall(__NR_msgrcv_batch, msqid, vec, vlen, msgtyp, msgflg);
+}
+
+static void fill_batch(struct msg_batch *vec, struct test_msg *msgs,
+		       unsigned int nr)
+{
+	unsigned int i;
+
+	for (i = 0; i < nr; i++) {
+		msgs[i].mtype = i + 1;
+		snprintf(msgs[i].mtext, MSG_LEN, "message %u", i);
+		vec[i].msgp = (uintptr_t)&msgs[i];
+		vec[i].msgsz = MSG_LEN;
+		vec[i].result = 1;
+	}
+}
+
+FIXTURE(msgbatch) {
+	int msqid;
+};
+
+FIXTURE_SETUP(msgbatch)
+{
+	self->msqid = msgget(IPC_PRIVATE, IPC_CREAT | 0600);
+	ASSERT_GE(self->msqid, 0);
+
+	if (msgsnd_batch(self->msqid, NULL, 0, 0) < 0 && errno == ENOSYS)
+		SKIP(return, "msgsnd_batch() not supported");
+}
+
+FIXTURE_TEARDOWN(msgbatch)
+{
+	msgctl(self->msqid, IPC_RMID, NULL);
+}
+
+TEST_F(msgbatch, send_receive)
+{
+	struct test_msg snd[NR_MSGS], rcv[NR_MSGS + 1] = {};
+	struct msg_batch vec[NR_MSGS + 1];
+	unsigned int i;
+
+	fill_batch(vec, snd, NR_MSGS);
+	ASSERT_EQ(NR_MSGS, msgsnd_batch(self->msqid, vec, NR_MSGS, 0));
+	for (i = 0; i < NR_MSGS; i++)
+		EXPECT_EQ(0, vec[i].result);
+
+	/* Ask for one more than queued: the batch stops at the empty queue */
+	fill_batch(vec, rcv, NR_MSGS + 1);
+	ASSERT_EQ(NR_MSGS, msgrcv_batch(self->msqid, vec, NR_MSGS + 1, 0,
+					IPC_NOWAIT));
+	for (i = 0; i < NR_MSGS; i++) {
+		EXPECT_EQ(MSG_LEN, vec[i].result);
+		EXPECT_EQ(snd[i].mtype, rcv[i].mtype);
+		EXPECT_STREQ(snd[i].mtext, rcv[i].mtext);
+	}
+	EXPECT_EQ(-ENOMSG, vec[NR_MSGS].result);
+
+	/* Nothing left */
+	EXPECT_EQ(-1, msgrcv_batch(self->msqid, vec, 1, 0, IPC_NOWAIT));
+	EXPECT_EQ(ENOMSG, errno);
+}
+
+TEST_F(msgbatch, partial_send)
+{
+	struct test_msg snd[NR_MSGS], rcv;
+	struct msg_batch vec[NR_MSGS];
+	struct msqid_ds ds;
+
+	/* Only room for two messages */
+	ASSERT_EQ(0, msgctl(self->msqid, IPC_STAT, &ds));
+	ds.msg_qbytes = 2 * MSG_LEN;
+	ASSERT_EQ(0, msgctl(self->msqid, IPC_SET, &ds));
+
+	fill_batch(vec, snd, NR_MSGS);
+	ASSERT_EQ(2, msgsnd_batch(self->msqid, vec, NR_MSGS, IPC_NOWAIT));
+	EXPECT_EQ(0, vec[0].result);
+	EXPECT_EQ(0, vec[1].result);
+	EXPECT_EQ(-EAGAIN, vec[2].result);
+
+	/* Nothing fits, so the whole call fails */
+	EXPECT_EQ(-1, msgsnd_batch(self->msqid, vec + 2, 2, IPC_NOWAIT));
+	EXPECT_EQ(EAGAIN, errno);
+
+	/* A bad entry ends the batch, the ones before it are sent */
+	ASSERT_EQ(MSG_LEN, msgrcv(self->msqid, &rcv, MSG_LEN, 0, IPC_NOWAIT));
+	ASSERT_EQ(MSG_LEN, msgrcv(self->msqid, &rcv, MSG_LEN, 0, IPC_NOWAIT));
+	fill_batch(vec, snd, NR_MSGS);
+	vec[1].msgp = 0;
+	ASSERT_EQ(1, msgsnd_batch(self->msqid, vec, NR_MSGS, IPC_NOWAIT));
+	EXPECT_EQ(0, vec[0].result);
+	EXPECT_EQ(-EFAULT, vec[1].result);
+}
+
+TEST_F(msgbatch, partial_receive)
+{
+	struct test_msg snd[2], rcv[2] = {};
+	struct msg_batch vec[2];
+
+	fill_batch(vec, snd, 2);
+	ASSERT_EQ(2, msgsnd_batch(self->msqid, vec, 2, 0));
+
+	/* The second buffer is too small: it stays queued */
+	fill_batch(vec, rcv, 2);
+	vec[1].msgsz = 1;
+	ASSERT_EQ(1, msgrcv_batch(self->msqid, vec, 2, 0, IPC_NOWAIT));
+	EXPECT_EQ(MSG_LEN, vec[0].result);
+	EXPECT_EQ(-E2BIG, vec[1].result);
+
+	vec[0].msgsz = MSG_LEN;
+	ASSERT_EQ(1, msgrcv_batch(self->msqid, vec, 2, 0, IPC_NOWAIT));
+	EXPECT_EQ(MSG_LEN, vec[0].result);
+	EXPECT_EQ(snd[1].mtype, rcv[0].mtype);
+	EXPECT_EQ(-ENOMSG, vec[1].result);
+}
+
+TEST_F(msgbatch, blocking_first)
+{
+	struct test_msg msg = { .mtype = 1 }, rcv[NR_MSGS] = {};
+	struct msg_batch vec[NR_MSGS];
+	int status;
+	pid_t pid;
+
+	pid = fork();
+	ASSERT_GE(pid, 0);
+	if (!pid) {
+		usleep(100000);
+		strcpy(msg.mtext, "late");
+		_exit(msgsnd(self->msqid, &msg, MSG_LEN, 0) ? 1 : 0);
+	}
+
+	/* Sleeps for the first message, then returns what it got */
+	fill_batch(vec, rcv, NR_MSGS);
+	EXPECT_EQ(1, msgrcv_batch(self->msqid, vec, NR_MSGS, 0, 0));
+	EXPECT_EQ(MSG_LEN, vec[0].result);
+	EXPECT_STREQ("late", rcv[0].mtext);
+
+	ASSERT_EQ(pid, waitpid(pid, &status, 0));
+	EXPECT_TRUE(WIFEXITED(status) && !WEXITSTATUS(status));
+}
+
+TEST_HARNESS_MAIN
@@ -0,0 +1,313 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+ * TDX performance test
+ *
+ * Measures the cost of the TD exit paths that dominate TD run time:
+ * TDVMCALLs handled in KVM, TDVMCALLs forwarded to userspace, and
+ * MapGPA driven private/shared conversions.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+#include <linux/kvm.h>
+
+#include <kvm_util.h>
+#include <test_util.h>
+#include <processor.h>
+#include "../lib/x86_64/tdx.h"
+
+#define CHECK_GUEST_COMPLETION(VCPU)								\
+	(TEST_ASSERT(										\
+		((VCPU)->run->exit_reason == KVM_EXIT_IO) &&					\
+		((VCPU)->run->io.port == TDX_SUCCESS_PORT) &&					\
+		((VCPU)->run->io.size == 4) &&							\
+		((VCPU)->run->io.direction == TDX_IO_WRITE),					\
+		"Unexpected exit values while waiting for test completion: %u (%s) %d %d %d\n",	\
+		(VCPU)->run->exit_reason, exit_reason_str((VCPU)->run->exit_reason),		\
+		(VCPU)->run->io.port, (VCPU)->run->io.size, (VCPU)->run->io.direction))
+
+#define CHECK_IO(VCPU, PORT, SIZE, DIR)							\
+	do {										\
+		TEST_ASSERT(((VCPU)->run->exit_reason == KVM_EXIT_IO) &&		\
+			    ((VCPU)->run->io.port == (PORT)) &&				\
+			    ((VCPU)->run->io.size == (SIZE)) &&				\
+			    ((VCPU)->run->io.direction == (DIR)),			\
+			    "Got an unexpected IO exit values: %u (%s) %d %d %d\n",	\
+			    (VCPU)->run->exit_reason,					\
+			    exit_reason_str((VCPU)->run->exit_reason),			\
+			    (VCPU)->run->io.port, (VCPU)->run->io.size,			\
+			    (VCPU)->run->io.direction);					\
+	} while (0)
+
+#define CHECK_GUEST_FAILURE(VCPU)							\
+	do {										\
+		if ((VCPU)->run->exit_reason == KVM_EXIT_SYSTEM_EVENT)			\
+			TEST_FAIL("Guest reported error. error code: %lld (0x%llx)\n",	\
+				  (VCPU)->run->system_event.data[1],			\
+				  (VCPU)->run->system_event.data[1]);			\
+	} while (0)
+
+/* Shared memory used as the conversion target, as in tdx_vm_tests. */
+#define CONVERSION_GPA		0x80000000ULL
+#define CONVERSION_PAGES	512
+
+#define DEFAULT_ITERATIONS	100000
+
+static uint32_t iterations = DEFAULT_ITERATIONS;
+
+bool is_tdx_enabled(void)
+{
+	return !!(kvm_check_cap(KVM_CAP_VM_TYPES) & BIT(KVM_X86_TDX_VM));
+}
+
+/*
+ * Guest code can't reference host globals, so the iteration count is handed
+ * to the guest through an IO read on TDX_TEST_PORT.
+ */
+static void provide_iterations(struct kvm_vcpu *vcpu)
+{
+	vcpu_run(vcpu);
+	CHECK_GUEST_FAILURE(vcpu);
+	CHECK_IO(vcpu, TDX_TEST_PORT, 4, TDX_IO_READ);
+	*(uint32_t *)((void *)vcpu->run + vcpu->run->io.data_offset) = iterations;
+}
+
+static struct kvm_vm *create_td(struct kvm_vcpu **vcpu, void *guest_code,
+				uint64_t guest_code_size, bool shared_mem)
+{
+	struct kvm_vm *vm;
+
+	/* Create a TD VM with no memory.*/
+	vm = vm_create_tdx();
+
+	/* Allocate TD guest memory and initialize the TD.*/
+	initialize_td(vm);
+
+	/* Initialize the TD vcpu and copy the test code to the guest memory.*/
+	*vcpu = vm_vcpu_add_tdx(vm, 0);
+
+	if (shared_mem)
+		vm_userspace_mem_region_add(vm, VM_MEM_SRC_ANONYMOUS,
+					    CONVERSION_GPA, 1,
+					    CONVERSION_PAGES, 0);
+
+	/* Setup and initialize VM memory */
+	prepare_source_image(vm, guest_code, guest_code_size, 0);
+	finalize_td_memory(vm);
+
+	return vm;
+}
+
+static void report(const char *name, struct timespec ts, uint64_t nr_ops,
+		   const char *unit)
+{
+	int64_t ns = timespec_to_ns(ts);
+
+	printf("\t ... %s: %lu %s in %ld.%.9lds, %lu ns/%s\n", name, nr_ops,
+	       unit, ts.tv_sec, ts.tv_nsec, ns / (nr_ops ? nr_ops : 1), unit);
+}
+
+/*
+ * TDVMCALL<CPUID> is handled entirely within KVM, i.e. this measures the
+ * TD exit -> KVM -> TD entry round trip without a userspace exit.
+ */
+TDX_GUEST_FUNCTION(guest_tdvmcall_kvm)
+{
+	uint32_t eax, ebx, ecx, edx;
+	uint64_t iters, i;
+	uint64_t err;
+
+	err = tdvmcall_io(TDX_TEST_PORT, 4, TDX_IO_READ, &iters);
+	if (err)
+		tdvmcall_fatal(err);
+
+	for (i = 0; i < iters; i++) {
+		err = tdvmcall_cpuid(/*eax=*/1, /*ecx=*/0, &eax, &ebx, &ecx,
+				     &edx);
+		if (err)
+			tdvmcall_fatal(err);
+	}
+
+	tdvmcall_success();
+}
+
+void measure_tdvmcall_kvm(void)
+{
+	struct timespec start, ts;
+	struct kvm_vcpu *vcpu;
+	struct kvm_vm *vm;
+
+	printf("Measuring TDVMCALL round trip (handled by KVM):\n");
+	vm = create_td(&vcpu, guest_tdvmcall_kvm,
+		       TDX_FUNCTION_SIZE(guest_tdvmcall_kvm), false);
+
+	provide_iterations(vcpu);
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	vcpu_run(vcpu);
+	ts = timespec_elapsed(start);
+	CHECK_GUEST_FAILURE(vcpu);
+	CHECK_GUEST_COMPLETION(vcpu);
+
+	report("tdvmcall_cpuid", ts, iterations, "exit");
+
+	kvm_vm_free(vm);
+}
+
+/*
+ * TDVMCALL<IO> to an unhandled port exits to userspace, i.e. this measures
+ * the full TD exit -> KVM -> userspace -> KVM -> TD entry round trip.
+ */
+TDX_GUEST_FUNCTION(guest_tdvmcall_user)
+{
+	uint64_t iters, i;
+	uint64_t data = 0;
+	uint64_t err;
+
+	err = tdvmcall_io(TDX_TEST_PORT, 4, TDX_IO_READ, &iters);
+	if (err)
+		tdvmcall_fatal(err);
+
+	for (i = 0; i < iters; i++) {
+		err = tdvmcall_io(TDX_TEST_PORT, 1, TDX_IO_WRITE, &data);
+		if (err)
+			tdvmcall_fatal(err);
+	}
+
+	tdvmcall_success();
+}
+
+void measure_tdvmcall_user(void)
+{
+	struct timespec start, ts;
+	struct kvm_vcpu *vcpu;
+	struct kvm_vm *vm;
+	uint32_t i;
+
+	printf("Measuring TDVMCALL round trip (handled by userspace):\n");
+	vm = create_td(&vcpu, guest_tdvmcall_user,
+		       TDX_FUNCTION_SIZE(guest_tdvmcall_user), false);
+
+	provide_iterations(vcpu);
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	for (i = 0; i < iterations; i++) {
+		vcpu_run(vcpu);
+		CHECK_GUEST_FAILURE(vcpu);
+		CHECK_IO(vcpu, TDX_TEST_PORT, 1, TDX_IO_WRITE);
+	}
+	ts = timespec_elapsed(start);
+
+	vcpu_run(vcpu);
+	CHECK_GUEST_FAILURE(vcpu);
+	CHECK_GUEST_COMPLETION(vcpu);
+
+	report("tdvmcall_io", ts, iterations, "exit");
+
+	kvm_vm_free(vm);
+}
+
+/*
+ * Flip CONVERSION_PAGES pages between shared and private with MapGPA, one
+ * TDVMCALL per direction per iteration.
+ */
+TDX_GUEST_FUNCTION(guest_convert)
+{
+	uint64_t gpa_shared_mask;
+	uint64_t failed_gpa;
+	uint64_t gpa_width;
+	uint64_t iters, i;
+	uint64_t err;
+
+	err = tdvmcall_io(TDX_TEST_PORT, 4, TDX_IO_READ, &iters);
+	if (err)
+		tdvmcall_fatal(err);
+
+	/* Read highest order physical bit to calculate shared mask. */
+	err = tdcall_vp_info(&gpa_width, 0, 0, 0, 0, 0);
+	if (err)
+		tdvmcall_fatal(err);
+	gpa_shared_mask = BIT_ULL(gpa_width - 1);
+
+	for (i = 0; i < iters; i++) {
+		err = tdvmcall_map_gpa(CONVERSION_GPA | gpa_shared_mask,
+				       CONVERSION_PAGES * PAGE_SIZE,
+				       &failed_gpa);
+		if (err)
+			tdvmcall_fatal(err);
+
+		err = tdvmcall_map_gpa(CONVERSION_GPA,
+				       CONVERSION_PAGES * PAGE_SIZE,
+				       &failed_gpa);
+		if (err)
+			tdvmcall_fatal(err);
+	}
+
+	tdvmcall_success();
+}
+
+void measure_conversions(void)
+{
+	struct timespec start, ts;
+	struct kvm_vcpu *vcpu;
+	struct kvm_vm *vm;
+	uint64_t nr_pages;
+
+	printf("Measuring private<->shared conversion throughput:\n");
+	vm = create_td(&vcpu, guest_convert, TDX_FUNCTION_SIZE(guest_convert),
+		       true);
+
+	provide_iterations(vcpu);
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	vcpu_run(vcpu);
+	ts = timespec_elapsed(start);
+	CHECK_GUEST_FAILURE(vcpu);
+	CHECK_GUEST_COMPLETION(vcpu);
+
+	nr_pages = 2ULL * CONVERSION_PAGES * iterations;
+	report("map_gpa", ts, 2ULL * iterations, "call");
+	report("converted", ts, nr_pages, "page");
+
+	kvm_vm_free(vm);
+}
+
+static void help(char *name)
+{
+	puts("");
+	printf("usage: %s [-h] [-i iterations]\n", name);
+	printf(" -i: number of guest loop iterations per measurement.\n"
+	       "     (default: %u)\n", DEFAULT_ITERATIONS);
+	puts("");
+	exit(0);
+}
+
+int main(int argc, char **argv)
+{
+	int opt;
+
+	while ((opt = getopt(argc, argv, "hi:")) != -1) {
+		switch (opt) {
+		case 'i':
+			iterations = atoi_positive("Number of iterations", optarg);
+			break;
+		case 'h':
+		default:
+			help(argv[0]);
+			break;
+		}
+	}
+
+	if (!is_tdx_enabled()) {
+		print_skip("TDX is not supported by the KVM");
+		exit(KSFT_SKIP);
+	}
+
+	measure_tdvmcall_kvm();
+	measure_tdvmcall_user();
+	measure_conversions();
+
+	return 0;
+}
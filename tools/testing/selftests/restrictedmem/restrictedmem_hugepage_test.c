@@ -194,6 +194,39 @@ TEST_F(reset_shmem_enabled, restrictedmem_fstat_shmem_enabled_always)
 	close(fd);
 }
 
+TEST_F(reset_shmem_enabled, restrictedmem_fstat_hugepage_flag)
+{
+	int fd = -1;
+	struct stat stat;
+
+	/* RMFD_HUGEPAGE doesn't depend on the global shmem policy */
+	ASSERT_EQ(set_shmem_thp_policy("never"), 0);
+
+	fd = memfd_restricted(RMFD_HUGEPAGE, -1);
+	ASSERT_GT(fd, 0);
+
+	ASSERT_EQ(fstat(fd, &stat), 0);
+	ASSERT_EQ(stat.st_blksize, get_hpage_pmd_size());
+
+	close(fd);
+}
+
+TEST(restrictedmem_hugepage_flag_with_usermnt)
+{
+	int fd = memfd_restricted(RMFD_USERMNT | RMFD_HUGEPAGE, STDOUT_FILENO);
+
+	ASSERT_EQ(fd, -1);
+	ASSERT_EQ(errno, EINVAL);
+}
+
+TEST(restrictedmem_invalid_flags)
+{
+	int fd = memfd_restricted(0x8000U, -1);
+
+	ASSERT_EQ(fd, -1);
+	ASSERT_EQ(errno, EINVAL);
+}
+
 TEST(restrictedmem_tmpfile_invalid_fd)
 {
 	int fd = memfd_restricted(RMFD_USERMNT, -2);
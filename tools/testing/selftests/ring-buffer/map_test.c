@@ -0,0 +1,204 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * Tests for the mmap() of per CPU ring buffers through trace_pipe_raw and
+ * the TRACE_MMAP_IOCTL_GET_READER ioctl.
+ */
+
+#define _GNU_SOURCE
+#include <errno.h>
+#include <fcntl.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <linux/trace_mmap.h>
+
+#include "../kselftest_harness.h"
+
+#define TRACEFS_ROOT	"/sys/kernel/tracing"
+#define NR_MARKERS	16
+
+static int write_file(const char *path, const char *val)
+{
+	int fd, ret;
+
+	fd = open(path, O_WRONLY | O_TRUNC);
+	if (fd < 0)
+		return -errno;
+
+	ret = write(fd, val, strlen(val));
+	if (ret < 0)
+		ret = -errno;
+	close(fd);
+
+	return ret;
+}
+
+static int write_markers(int nr)
+{
+	int fd, i;
+
+	fd = open(TRACEFS_ROOT "/trace_marker", O_WRONLY);
+	if (fd < 0)
+		return -errno;
+
+	for (i = 0; i < nr; i++) {
+		if (write(fd, "map_test", 8) != 8) {
+			close(fd);
+			return -errno;
+		}
+	}
+	close(fd);
+
+	return 0;
+}
+
+FIXTURE(map) {
+	struct trace_buffer_meta *meta;
+	void *data;
+	size_t data_len;
+	int cpu_fd;
+};
+
+FIXTURE_SETUP(map)
+{
+	char path[128];
+	cpu_set_t set;
+
+	if (getuid())
+		SKIP(return, "Tests must run as root");
+	if (access(TRACEFS_ROOT "/trace_marker", W_OK))
+		SKIP(return, "tracefs is not mounted at " TRACEFS_ROOT);
+
+	/* The markers must end up in the buffer of CPU 0 */
+	CPU_ZERO(&set);
+	CPU_SET(0, &set);
+	ASSERT_EQ(0, sched_setaffinity(0, sizeof(set), &set));
+
+	ASSERT_LE(0, write_file(TRACEFS_ROOT "/tracing_on", "1"));
+	ASSERT_LE(0, write_file(TRACEFS_ROOT "/trace", ""));
+
+	snprintf(path, sizeof(path),
+		 TRACEFS_ROOT "/per_cpu/cpu0/trace_pipe_raw");
+	self->cpu_fd = open(path, O_RDONLY | O_NONBLOCK);
+	ASSERT_LE(0, self->cpu_fd);
+
+	self->meta = mmap(NULL, getpagesize(), PROT_READ, MAP_SHARED,
+			  self->cpu_fd, 0);
+	if (self->meta == MAP_FAILED && errno == ENODEV)
+		SKIP(return, "trace_pipe_raw can't be mapped");
+	ASSERT_NE(MAP_FAILED, self->meta);
+
+	/* The sub-buffers, reader included, follow the meta page */
+	self->data_len = (size_t)self->meta->subbuf_size *
+			 self->meta->nr_subbufs;
+	self->data = mmap(NULL, self->data_len, PROT_READ, MAP_SHARED,
+			  self->cpu_fd, self->meta->meta_page_size);
+	ASSERT_NE(MAP_FAILED, self->data);
+}
+
+FIXTURE_TEARDOWN(map)
+{
+	if (self->data && self->data != MAP_FAILED)
+		munmap(self->data, self->data_len);
+	if (self->meta && self->meta != MAP_FAILED)
+		munmap(self->meta, getpagesize());
+	if (self->cpu_fd > 0)
+		close(self->cpu_fd);
+}
+
+TEST_F(map, meta_page)
+{
+	EXPECT_EQ(getpagesize(), self->meta->meta_page_size);
+	EXPECT_EQ(sizeof(struct trace_buffer_meta),
+		  self->meta->meta_struct_len);
+	EXPECT_EQ(getpagesize(), self->meta->subbuf_size);
+	EXPECT_LT(1, self->meta->nr_subbufs);
+	EXPECT_GT(self->meta->nr_subbufs, self->meta->reader.id);
+	EXPECT_EQ(0, self->meta->flags);
+	EXPECT_EQ(0, self->meta->entries);
+}
+
+TEST_F(map, get_reader)
+{
+	unsigned long long commit;
+	void *subbuf;
+
+	/* Nothing to read yet, the ioctl doesn't wait with O_NONBLOCK */
+	ASSERT_EQ(0, ioctl(self->cpu_fd, TRACE_MMAP_IOCTL_GET_READER));
+	EXPECT_EQ(0, self->meta->read);
+
+	ASSERT_EQ(0, write_markers(NR_MARKERS));
+	ASSERT_EQ(0, ioctl(self->cpu_fd, TRACE_MMAP_IOCTL_GET_READER));
+
+	/* All the markers fit in the reader, and are now accounted as read */
+	EXPECT_EQ(NR_MARKERS, self->meta->entries);
+	EXPECT_EQ(NR_MARKERS, self->meta->read);
+	EXPECT_EQ(0, self->meta->overrun);
+	EXPECT_EQ(0, self->meta->reader.lost_events);
+	EXPECT_EQ(0, self->meta->reader.read);
+	ASSERT_GT(self->meta->nr_subbufs, self->meta->reader.id);
+
+	/* The reader starts with a timestamp and the size of its data */
+	subbuf = self->data +
+		 (size_t)self->meta->reader.id * self->meta->subbuf_size;
+	commit = *(unsigned long *)(subbuf + sizeof(unsigned long long));
+	EXPECT_NE(0, commit & 0xfffff);
+
+	/* More data continues where the previous call left off */
+	ASSERT_EQ(0, write_markers(1));
+	ASSERT_EQ(0, ioctl(self->cpu_fd, TRACE_MMAP_IOCTL_GET_READER));
+	EXPECT_EQ(NR_MARKERS + 1, self->meta->read);
+	EXPECT_EQ(commit & 0xfffff, self->meta->reader.read);
+}
+
+TEST_F(map, restrictions)
+{
+	char buf[4096];
+	void *map;
+
+	/* The mapping is shared and stays read-only */
+	map = mmap(NULL, getpagesize(), PROT_READ, MAP_PRIVATE,
+		   self->cpu_fd, 0);
+	EXPECT_EQ(MAP_FAILED, map);
+	EXPECT_EQ(EPERM, errno);
+	EXPECT_EQ(-1, mprotect(self->meta, getpagesize(),
+			       PROT_READ | PROT_WRITE));
+
+	/* And within the meta page and the sub-buffers */
+	map = mmap(NULL, getpagesize(), PROT_READ, MAP_SHARED, self->cpu_fd,
+		   self->meta->meta_page_size + self->data_len);
+	EXPECT_EQ(MAP_FAILED, map);
+	EXPECT_EQ(EINVAL, errno);
+
+	/* A mapped buffer can't be resized */
+	EXPECT_EQ(-EBUSY, write_file(TRACEFS_ROOT "/buffer_size_kb", "1024"));
+
+	/* Nor read in a way that swaps its pages out of the ring */
+	ASSERT_EQ(0, write_markers(1));
+	EXPECT_EQ(-1, read(self->cpu_fd, buf, sizeof(buf)));
+	EXPECT_EQ(EBUSY, errno);
+}
+
+TEST_F(map, mremap)
+{
+	void *target, *meta;
+
+	target = mmap(NULL, getpagesize(), PROT_READ,
+		      MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	ASSERT_NE(MAP_FAILED, target);
+
+	/* Moving the mapping doesn't drop the reference it holds */
+	meta = mremap(self->meta, getpagesize(), getpagesize(),
+		      MREMAP_MAYMOVE | MREMAP_FIXED, target);
+	ASSERT_EQ(target, meta);
+	self->meta = meta;
+
+	EXPECT_EQ(getpagesize(), self->meta->meta_page_size);
+	EXPECT_EQ(-EBUSY, write_file(TRACEFS_ROOT "/buffer_size_kb", "1024"));
+}
+
+TEST_HARNESS_MAIN
@@ -0,0 +1,153 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+ * vdso_test_getrandom.c: Sample code to test parse_vdso.c and vDSO getrandom()
+ */
+
+#include <errno.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/auxv.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/wait.h>
+#include <linux/random.h>
+
+#include "../kselftest.h"
+#include "parse_vdso.h"
+
+const char *version = "LINUX_2.6";
+const char *name = "__vdso_getrandom";
+
+typedef ssize_t (*getrandom_t)(void *, size_t, unsigned int, void *, size_t);
+
+static getrandom_t vgetrandom;
+static struct vgetrandom_opaque_params params;
+
+static void *alloc_state(void)
+{
+	size_t size = sysconf(_SC_PAGESIZE);
+	void *state;
+
+	/* Like libc, rely on the returned flags alone to wipe the state on fork */
+	state = mmap(NULL, size, params.mmap_prot, params.mmap_flags, -1, 0);
+	if (state == MAP_FAILED)
+		return NULL;
+	return state;
+}
+
+static int test_fork(void *state)
+{
+	uint8_t parent[32], child[32];
+	int fds[2], status;
+	pid_t pid;
+
+	/* Prime the state so that the child would inherit it if not wiped */
+	if (vgetrandom(parent, sizeof(parent), 0, state, params.size_of_opaque_state) != sizeof(parent))
+		return -1;
+
+	if (pipe(fds))
+		return -1;
+
+	pid = fork();
+	if (pid < 0)
+		return -1;
+	if (!pid) {
+		if (vgetrandom(child, sizeof(child), 0, state, params.size_of_opaque_state) != sizeof(child))
+			_exit(1);
+		if (write(fds[1], child, sizeof(child)) != sizeof(child))
+			_exit(1);
+		_exit(0);
+	}
+
+	if (vgetrandom(parent, sizeof(parent), 0, state, params.size_of_opaque_state) != sizeof(parent))
+		return -1;
+	if (read(fds[0], child, sizeof(child)) != sizeof(child))
+		return -1;
+	if (waitpid(pid, &status, 0) != pid || !WIFEXITED(status) || WEXITSTATUS(status))
+		return -1;
+
+	return memcmp(parent, child, sizeof(parent)) ? 0 : -1;
+}
+
+static void bench(void *state)
+{
+	struct timespec start, end;
+	uint64_t buf[4];
+	int i;
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	for (i = 0; i < 1000000; i++)
+		vgetrandom(buf, sizeof(buf), 0, state, params.size_of_opaque_state);
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	printf("   vdso: 1000000 x 32 bytes in %.6f seconds\n",
+	       (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9);
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	for (i = 0; i < 1000000; i++)
+		syscall(SYS_getrandom, buf, sizeof(buf), 0);
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	printf("syscall: 1000000 x 32 bytes in %.6f seconds\n",
+	       (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9);
+}
+
+int main(int argc, char **argv)
+{
+	unsigned long sysinfo_ehdr;
+	uint8_t buf[1000], zero[1000] = { 0 };
+	void *state;
+	ssize_t ret;
+
+	sysinfo_ehdr = getauxval(AT_SYSINFO_EHDR);
+	if (!sysinfo_ehdr) {
+		printf("AT_SYSINFO_EHDR is not present!\n");
+		return KSFT_SKIP;
+	}
+
+	vdso_init_from_sysinfo_ehdr(getauxval(AT_SYSINFO_EHDR));
+
+	vgetrandom = (getrandom_t)vdso_sym(version, name);
+	if (!vgetrandom) {
+		printf("Could not find %s\n", name);
+		return KSFT_SKIP;
+	}
+
+	if (vgetrandom(NULL, 0, 0, &params, ~0UL)) {
+		printf("%s does not return its parameters\n", name);
+		return KSFT_FAIL;
+	}
+
+	state = alloc_state();
+	if (!state) {
+		printf("Could not allocate the state\n");
+		return KSFT_FAIL;
+	}
+
+	memset(buf, 0, sizeof(buf));
+	ret = vgetrandom(buf, sizeof(buf), 0, state, params.size_of_opaque_state);
+	if (ret != sizeof(buf) || !memcmp(buf, zero, sizeof(buf))) {
+		printf("%s failed: %zd\n", name, ret);
+		return KSFT_FAIL;
+	}
+
+	if (test_fork(state)) {
+		printf("%s returned the same bytes in parent and child\n", name);
+		return KSFT_FAIL;
+	}
+
+	/* The state must not be made to survive a fork after the fact */
+	if (madvise(state, sysconf(_SC_PAGESIZE), MADV_KEEPONFORK) != -1 ||
+	    errno != EINVAL) {
+		printf("MADV_KEEPONFORK was not refused on the state\n");
+		return KSFT_FAIL;
+	}
+
+	if (argc > 1 && !strcmp(argv[1], "bench"))
+		bench(state);
+
+	printf("%s returned %zd random bytes\n", name, ret);
+	return 0;
+}
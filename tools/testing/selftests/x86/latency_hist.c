@@ -0,0 +1,204 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+ * latency_hist.c - checks that the syscall latency histograms only count
+ * native system calls under their own number
+ *
+ * ia32 syscall numbers overlap with different native ones: getppid() is
+ * 64 through int $0x80 but 110 through syscall, and 64 is semget() on
+ * x86_64. Issue a batch of each and check which histograms moved.
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <err.h>
+#include <setjmp.h>
+#include <signal.h>
+#include <sys/syscall.h>
+#include <linux/latency_hist.h>
+
+#include "../kselftest.h"
+
+#define NR_CALLS		10000
+#define IA32_NR_getppid		64	/* __NR_semget on x86_64 */
+
+static const char * const tracing_dirs[] = {
+	"/sys/kernel/tracing",
+	"/sys/kernel/debug/tracing",
+};
+
+static char hist_path[64], enable_path[64];
+static unsigned int nerrs;
+static sigjmp_buf jmpbuf;
+
+static bool find_latency_hist(void)
+{
+	unsigned int i;
+
+	for (i = 0; i < sizeof(tracing_dirs) / sizeof(tracing_dirs[0]); i++) {
+		snprintf(enable_path, sizeof(enable_path),
+			 "%s/latency_hist/enable", tracing_dirs[i]);
+		snprintf(hist_path, sizeof(hist_path),
+			 "%s/latency_hist/hist", tracing_dirs[i]);
+		if (!access(enable_path, W_OK))
+			return true;
+	}
+	return false;
+}
+
+static long ia32_getppid(void)
+{
+	long ret = IA32_NR_getppid;
+
+	asm volatile ("int $0x80"
+		      : "+a" (ret)
+		      :
+		      : "memory", "r8", "r9", "r10", "r11");
+	return ret;
+}
+
+/* Total number of samples in the syscall histogram of @nr */
+static unsigned long long syscall_samples(unsigned int nr)
+{
+	static char buf[1 << 20];
+	struct lat_hist_header *hdr = (void *)buf;
+	unsigned long long total = 0;
+	size_t rec_size, len = 0;
+	unsigned int i, j;
+	ssize_t ret;
+	char *p;
+	int fd;
+
+	fd = open(hist_path, O_RDONLY);
+	if (fd < 0)
+		err(1, "open %s", hist_path);
+	while ((ret = read(fd, buf + len, sizeof(buf) - len)) > 0)
+		len += ret;
+	if (ret < 0)
+		err(1, "read %s", hist_path);
+	close(fd);
+
+	if (len < sizeof(*hdr) || hdr->magic != LAT_HIST_MAGIC)
+		errx(1, "bad latency_hist header");
+
+	rec_size = sizeof(struct lat_hist_record) +
+		   hdr->nr_buckets * sizeof(__u64);
+	p = (char *)(hdr + 1);
+	for (i = 0; i < hdr->nr_records; i++, p += rec_size) {
+		struct lat_hist_record *rec = (void *)p;
+
+		if (p + rec_size > buf + len)
+			errx(1, "truncated latency_hist snapshot");
+		if (rec->type != LAT_HIST_SYSCALL || rec->id != nr)
+			continue;
+		for (j = 0; j < hdr->nr_buckets; j++)
+			total += rec->counts[j];
+	}
+
+	return total;
+}
+
+static char get_enable(void)
+{
+	int fd = open(enable_path, O_RDONLY);
+	char val;
+
+	if (fd < 0 || read(fd, &val, 1) != 1)
+		err(1, "read %s", enable_path);
+	close(fd);
+	return val;
+}
+
+static void set_enable(char val)
+{
+	int fd = open(enable_path, O_WRONLY);
+
+	if (fd < 0 || write(fd, &val, 1) != 1)
+		err(1, "write %s", enable_path);
+	close(fd);
+}
+
+static void sigsegv(int sig, siginfo_t *si, void *ctx_void)
+{
+	siglongjmp(jmpbuf, 1);
+}
+
+/* int $0x80 raises #GP without IA32_EMULATION */
+static bool have_int80(void)
+{
+	struct sigaction sa = {
+		.sa_sigaction = sigsegv,
+		.sa_flags = SA_SIGINFO,
+	};
+	bool ret = false;
+
+	sigemptyset(&sa.sa_mask);
+	if (sigaction(SIGSEGV, &sa, NULL))
+		err(1, "sigaction");
+
+	if (!sigsetjmp(jmpbuf, 1))
+		ret = ia32_getppid() == getppid();
+
+	signal(SIGSEGV, SIG_DFL);
+	return ret;
+}
+
+int main(void)
+{
+	unsigned long long native_before, native_after;
+	unsigned long long semget_before, semget_after;
+	char enabled;
+	int i;
+
+	if (!find_latency_hist()) {
+		printf("[SKIP]\tlatency_hist is not available\n");
+		return KSFT_SKIP;
+	}
+
+	enabled = get_enable();
+	set_enable('1');
+
+	printf("[RUN]\tNative getppid() is counted as syscall %d\n",
+	       SYS_getppid);
+	native_before = syscall_samples(SYS_getppid);
+	for (i = 0; i < NR_CALLS; i++)
+		syscall(SYS_getppid);
+	native_after = syscall_samples(SYS_getppid);
+
+	if (native_after - native_before >= NR_CALLS) {
+		printf("[OK]\t%llu samples\n", native_after - native_before);
+	} else {
+		printf("[FAIL]\tonly %llu samples, expected at least %d\n",
+		       native_after - native_before, NR_CALLS);
+		nerrs++;
+	}
+
+	if (!have_int80()) {
+		printf("[SKIP]\tint $0x80 is not available\n");
+		goto out;
+	}
+
+	printf("[RUN]\tia32 getppid() is not counted as syscall %d\n",
+	       IA32_NR_getppid);
+	semget_before = syscall_samples(IA32_NR_getppid);
+	for (i = 0; i < NR_CALLS; i++)
+		ia32_getppid();
+	semget_after = syscall_samples(IA32_NR_getppid);
+
+	/* Leave some room for semget() calls from other tasks */
+	if (semget_after - semget_before < NR_CALLS) {
+		printf("[OK]\t%llu samples\n", semget_after - semget_before);
+	} else {
+		printf("[FAIL]\t%llu samples, the ia32 calls were counted\n",
+		       semget_after - semget_before);
+		nerrs++;
+	}
+
+out:
+	set_enable(enabled);
+	return nerrs ? 1 : 0;
+}
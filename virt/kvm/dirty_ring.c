@@ -7,6 +7,7 @@
 #include <linux/kvm_host.h>
 #include <linux/kvm.h>
 #include <linux/vmalloc.h>
+#include <linux/sort.h>
 #include <linux/kvm_dirty_ring.h>
 #include <trace/events/kvm.h>
 #include "kvm_mm.h"
@@ -51,24 +52,89 @@ static bool kvm_dirty_ring_full(struct kvm_dirty_ring *ring)
 	return kvm_dirty_ring_used(ring) >= ring->size;
 }
 
-static void kvm_reset_dirty_gfn(struct kvm *kvm, u32 slot, u64 offset, u64 mask)
+/*
+ * Number of harvested entries that are sorted and re-protected together, i.e.
+ * with a single mmu_lock round trip, by kvm_dirty_ring_reset().
+ */
+#define KVM_DIRTY_RING_RESET_BATCH	512
+
+static struct kvm_memory_slot *kvm_dirty_ring_memslot(struct kvm *kvm, u32 slot)
 {
-	struct kvm_memory_slot *memslot;
 	int as_id, id;
 
 	as_id = slot >> 16;
 	id = (u16)slot;
 
 	if (as_id >= KVM_ADDRESS_SPACE_NUM || id >= KVM_USER_MEM_SLOTS)
-		return;
+		return NULL;
 
-	memslot = id_to_memslot(__kvm_memslots(kvm, as_id), id);
+	return id_to_memslot(__kvm_memslots(kvm, as_id), id);
+}
 
-	if (!memslot || (offset + __fls(mask)) >= memslot->npages)
+static void kvm_reset_dirty_gfn(struct kvm *kvm, struct kvm_memory_slot *memslot,
+				u64 offset, unsigned long mask)
+{
+	if (!memslot || !mask || offset >= memslot->npages)
+		return;
+
+	/*
+	 * The ring is shared with userspace, drop any bogus offsets past the
+	 * end of the slot instead of the whole word.
+	 */
+	if (memslot->npages - offset < BITS_PER_LONG)
+		mask &= GENMASK(memslot->npages - offset - 1, 0);
+	if (!mask)
 		return;
 
-	KVM_MMU_LOCK(kvm);
 	kvm_arch_mmu_enable_log_dirty_pt_masked(kvm, memslot, offset, mask);
+}
+
+static int kvm_dirty_gfn_cmp(const void *a, const void *b)
+{
+	const struct kvm_dirty_gfn *l = a, *r = b;
+
+	if (l->slot != r->slot)
+		return l->slot < r->slot ? -1 : 1;
+	if (l->offset != r->offset)
+		return l->offset < r->offset ? -1 : 1;
+	return 0;
+}
+
+/*
+ * Re-enable dirty tracking for a batch of harvested GFNs.  Sorting the batch
+ * lets GFNs that were dirtied in random order still be merged into one mask
+ * per BITS_PER_LONG-aligned word of each memslot, and the whole batch is then
+ * re-protected while holding mmu_lock once.
+ */
+static void kvm_reset_dirty_gfns(struct kvm *kvm, struct kvm_dirty_gfn *gfns,
+				 int nr)
+{
+	struct kvm_memory_slot *memslot = NULL;
+	unsigned long mask = 0;
+	u64 cur_offset = 0;
+	u32 cur_slot = 0;
+	int i;
+
+	sort(gfns, nr, sizeof(*gfns), kvm_dirty_gfn_cmp, NULL);
+
+	KVM_MMU_LOCK(kvm);
+	for (i = 0; i < nr; i++) {
+		u64 offset = ALIGN_DOWN(gfns[i].offset, BITS_PER_LONG);
+
+		if (i && gfns[i].slot == cur_slot && offset == cur_offset) {
+			mask |= 1ul << (gfns[i].offset - offset);
+			continue;
+		}
+
+		kvm_reset_dirty_gfn(kvm, memslot, cur_offset, mask);
+
+		if (!i || gfns[i].slot != cur_slot)
+			memslot = kvm_dirty_ring_memslot(kvm, gfns[i].slot);
+		cur_slot = gfns[i].slot;
+		cur_offset = offset;
+		mask = 1ul << (gfns[i].offset - offset);
+	}
+	kvm_reset_dirty_gfn(kvm, memslot, cur_offset, mask);
 	KVM_MMU_UNLOCK(kvm);
 }
 
@@ -78,6 +144,15 @@ int kvm_dirty_ring_alloc(struct kvm_dirty_ring *ring, int index, u32 size)
 	if (!ring->dirty_gfns)
 		return -ENOMEM;
 
+	ring->reset_gfns = kvmalloc_array(KVM_DIRTY_RING_RESET_BATCH,
+					  sizeof(*ring->reset_gfns),
+					  GFP_KERNEL_ACCOUNT);
+	if (!ring->reset_gfns) {
+		vfree(ring->dirty_gfns);
+		ring->dirty_gfns = NULL;
+		return -ENOMEM;
+	}
+
 	ring->size = size / sizeof(struct kvm_dirty_gfn);
 	ring->soft_limit = ring->size - kvm_dirty_ring_get_rsvd_entries();
 	ring->dirty_index = 0;
@@ -104,15 +179,8 @@ static inline bool kvm_dirty_gfn_harvested(struct kvm_dirty_gfn *gfn)
 
 int kvm_dirty_ring_reset(struct kvm *kvm, struct kvm_dirty_ring *ring)
 {
-	u32 cur_slot, next_slot;
-	u64 cur_offset, next_offset;
-	unsigned long mask;
-	int count = 0;
 	struct kvm_dirty_gfn *entry;
-	bool first_round = true;
-
-	/* This is only needed to make compilers happy */
-	cur_slot = cur_offset = mask = 0;
+	int count = 0, nr = 0;
 
 	while (true) {
 		entry = &ring->dirty_gfns[ring->reset_index & (ring->size - 1)];
@@ -120,42 +188,24 @@ int kvm_dirty_ring_reset(struct kvm *kvm, struct kvm_dirty_ring *ring)
 		if (!kvm_dirty_gfn_harvested(entry))
 			break;
 
-		next_slot = READ_ONCE(entry->slot);
-		next_offset = READ_ONCE(entry->offset);
+		ring->reset_gfns[nr].slot = READ_ONCE(entry->slot);
+		ring->reset_gfns[nr].offset = READ_ONCE(entry->offset);
 
 		/* Update the flags to reflect that this GFN is reset */
 		kvm_dirty_gfn_set_invalid(entry);
 
 		ring->reset_index++;
 		count++;
-		/*
-		 * Try to coalesce the reset operations when the guest is
-		 * scanning pages in the same slot.
-		 */
-		if (!first_round && next_slot == cur_slot) {
-			s64 delta = next_offset - cur_offset;
-
-			if (delta >= 0 && delta < BITS_PER_LONG) {
-				mask |= 1ull << delta;
-				continue;
-			}
-
-			/* Backwards visit, careful about overflows!  */
-			if (delta > -BITS_PER_LONG && delta < 0 &&
-			    (mask << -delta >> -delta) == mask) {
-				cur_offset = next_offset;
-				mask = (mask << -delta) | 1;
-				continue;
-			}
+
+		if (++nr == KVM_DIRTY_RING_RESET_BATCH) {
+			kvm_reset_dirty_gfns(kvm, ring->reset_gfns, nr);
+			nr = 0;
+			cond_resched();
 		}
-		kvm_reset_dirty_gfn(kvm, cur_slot, cur_offset, mask);
-		cur_slot = next_slot;
-		cur_offset = next_offset;
-		mask = 1;
-		first_round = false;
 	}
 
-	kvm_reset_dirty_gfn(kvm, cur_slot, cur_offset, mask);
+	if (nr)
+		kvm_reset_dirty_gfns(kvm, ring->reset_gfns, nr);
 
 	/*
 	 * The request KVM_REQ_DIRTY_RING_SOFT_FULL will be cleared
@@ -220,4 +270,6 @@ void kvm_dirty_ring_free(struct kvm_dirty_ring *ring)
 {
 	vfree(ring->dirty_gfns);
 	ring->dirty_gfns = NULL;
+	kvfree(ring->reset_gfns);
+	ring->reset_gfns = NULL;
 }
@@ -94,6 +94,14 @@ unsigned int halt_poll_ns_shrink;
 module_param(halt_poll_ns_shrink, uint, 0644);
 EXPORT_SYMBOL_GPL(halt_poll_ns_shrink);
 
+/*
+ * Keep polling a halted vCPU, without a time limit, for as long as it is the
+ * only runnable task on its pCPU.  Intended for vCPUs pinned to dedicated
+ * cores, where wake events can then be delivered without a wakeup IPI.
+ */
+static bool halt_poll_dedicated;
+module_param(halt_poll_dedicated, bool, 0644);
+
 /*
  * Ordering of locks:
  *
@@ -1025,10 +1033,34 @@ static void kvm_restrictedmem_error(struct restrictedmem_notifier *notifier,
 	kvm_put_fw(kvm, fw_idx);
 }
 
+static int kvm_restrictedmem_migrate(struct restrictedmem_notifier *notifier,
+				     pgoff_t index, struct page *src,
+				     struct page *dst)
+{
+	struct kvm_memory_slot *slot = container_of(notifier,
+						    struct kvm_memory_slot,
+						    notifier);
+	struct kvm *kvm = slot->kvm;
+	gfn_t gfn_start, gfn_end;
+	int r, fw_idx;
+
+	if (!restrictedmem_range_is_valid(slot, index, index + 1,
+					  &gfn_start, &gfn_end))
+		return 0;
+
+	fw_idx = kvm_get_fw(kvm);
+	r = kvm_arch_migrate_private_page(kvm, slot, gfn_start,
+					  page_to_pfn(src), page_to_pfn(dst));
+	kvm_put_fw(kvm, fw_idx);
+
+	return r;
+}
+
 static struct restrictedmem_notifier_ops kvm_restrictedmem_notifier_ops = {
 	.invalidate_start = kvm_restrictedmem_invalidate_begin,
 	.invalidate_end = kvm_restrictedmem_invalidate_end,
 	.error = kvm_restrictedmem_error,
+	.migrate = kvm_restrictedmem_migrate,
 };
 
 static inline void kvm_restrictedmem_register(struct kvm_memory_slot *slot)
@@ -3936,7 +3968,7 @@ void kvm_vcpu_halt(struct kvm_vcpu *vcpu)
 	bool halt_poll_allowed = !kvm_arch_no_poll(vcpu);
 	ktime_t start, cur, poll_end;
 	bool waited = false;
-	bool do_halt_poll;
+	bool do_halt_poll, do_dedicated_poll;
 	u64 halt_ns;
 
 	if (vcpu->halt_poll_ns > max_halt_poll_ns)
@@ -3944,16 +3976,39 @@ void kvm_vcpu_halt(struct kvm_vcpu *vcpu)
 
 	do_halt_poll = halt_poll_allowed && vcpu->halt_poll_ns;
 
+	do_dedicated_poll = halt_poll_allowed && READ_ONCE(halt_poll_dedicated);
+	do_halt_poll |= do_dedicated_poll;
+
 	start = cur = poll_end = ktime_get();
 	if (do_halt_poll) {
 		ktime_t stop = ktime_add_ns(start, vcpu->halt_poll_ns);
 
+		/*
+		 * Advertise that this vCPU is polling so that wakers can skip
+		 * the rcuwait wakeup (and the kick IPI), the wake event will be
+		 * observed by kvm_vcpu_check_block().  Pairs with the smp_mb()
+		 * in kvm_vcpu_wake_up().
+		 */
+		WRITE_ONCE(vcpu->halt_polling, true);
+		smp_mb();
+
 		do {
-			if (kvm_vcpu_check_block(vcpu) < 0)
+			if (kvm_vcpu_check_block(vcpu) < 0) {
+				WRITE_ONCE(vcpu->halt_polling, false);
 				goto out;
+			}
 			cpu_relax();
 			poll_end = cur = ktime_get();
-		} while (kvm_vcpu_can_poll(cur, stop));
+		} while (kvm_vcpu_can_poll(cur, stop) ||
+			 (do_dedicated_poll && single_task_running() &&
+			  !need_resched()));
+
+		/*
+		 * A waker that observed halt_polling==true did not wake the
+		 * vCPU, but kvm_vcpu_block() rechecks for pending events after
+		 * marking the task as blocking, so no wake event can be lost.
+		 */
+		WRITE_ONCE(vcpu->halt_polling, false);
 	}
 
 	waited = kvm_vcpu_block(vcpu);
@@ -3973,11 +4028,15 @@ out:
 	 * Note, halt-polling is considered successful so long as the vCPU was
 	 * never actually scheduled out, i.e. even if the wake event arrived
 	 * after of the halt-polling loop itself, but before the full wait.
+	 *
+	 * Dedicated polling has no time limit, so it neither feeds the
+	 * halt-poll stats nor adjusts vcpu->halt_poll_ns: either would only
+	 * reflect how long the pCPU stayed otherwise idle.
 	 */
-	if (do_halt_poll)
+	if (do_halt_poll && !do_dedicated_poll)
 		update_halt_poll_stats(vcpu, start, poll_end, !waited);
 
-	if (halt_poll_allowed) {
+	if (halt_poll_allowed && !do_dedicated_poll) {
 		/* Recompute the max halt poll time in case it changed. */
 		max_halt_poll_ns = kvm_vcpu_max_halt_poll_ns(vcpu);
 
@@ -4005,6 +4064,17 @@ EXPORT_SYMBOL_GPL(kvm_vcpu_halt);
 
 bool kvm_vcpu_wake_up(struct kvm_vcpu *vcpu)
 {
+	/*
+	 * Order the caller's write of the wake event (request, PIR, etc...)
+	 * before the read of halt_polling.  A halt-polling vCPU is not in
+	 * guest mode and will observe the event on its own, i.e. needs neither
+	 * an rcuwait wakeup nor an IPI.  Pairs with the smp_mb() in
+	 * kvm_vcpu_halt().
+	 */
+	smp_mb();
+	if (READ_ONCE(vcpu->halt_polling))
+		return true;
+
 	if (__kvm_vcpu_wake_up(vcpu)) {
 		WRITE_ONCE(vcpu->ready, true);
 		++vcpu->stat.generic.halt_wakeup;